@@ -12,13 +12,18 @@
 #include "Writer.h"
 #include "SymbolTable.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
+#include "llvm/ADT/CachedHashString.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/BinaryFormat/COFF.h"
 #include "llvm/Object/COFF.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 #include <algorithm>
+#include <numeric>
 
 using namespace llvm;
 using namespace llvm::object;
@@ -55,7 +60,7 @@ SectionChunk::SectionChunk(ObjFile *f, const coff_section *h)
 // SectionChunk is one of the most frequently allocated classes, so it is
 // important to keep it as compact as possible. As of this writing, the number
 // below is the size of this class on x64 platforms.
-static_assert(sizeof(SectionChunk) <= 88, "SectionChunk grew unexpectedly");
+static_assert(sizeof(SectionChunk) <= 80, "SectionChunk grew unexpectedly");
 
 static void add16(uint8_t *p, int16_t v) { write16le(p, read16le(p) + v); }
 static void add32(uint8_t *p, int32_t v) { write32le(p, read32le(p) + v); }
@@ -575,12 +580,14 @@ bool SectionChunk::isCOMDAT() const {
 void SectionChunk::printDiscardedMessage() const {
   // Removed by dead-stripping. If it's removed by ICF, ICF already
   // printed out the name, so don't repeat that here.
-  if (sym && this == repl)
+  if (this != repl)
+    return;
+  if (DefinedRegular *sym = getComdatLeader())
     message("Discarded " + sym->getName());
 }
 
 StringRef SectionChunk::getDebugName() const {
-  if (sym)
+  if (DefinedRegular *sym = getComdatLeader())
     return sym->getName();
   return "";
 }
@@ -641,6 +648,13 @@ uint32_t SectionChunk::getSectionNumber() const {
   return s.getIndex() + 1;
 }
 
+DefinedRegular *SectionChunk::getComdatLeader() const {
+  ArrayRef<DefinedRegular *> leaders = file->comdatLeaders;
+  if (leaders.empty())
+    return nullptr;
+  return leaders[getSectionNumber()];
+}
+
 CommonChunk::CommonChunk(const COFFSymbolRef s) : sym(s) {
   // The value of a common symbol is its size. Align all common symbols smaller
   // than 32 bytes naturally, i.e. round the size up to the next power of two.
@@ -829,22 +843,24 @@ void PseudoRelocTableChunk::writeTo(uint8_t *buf) const {
 //
 // Usually we have a lot of relocations for each page, so the number of
 // bytes for one .reloc entry is close to 2 bytes on average.
-BaserelChunk::BaserelChunk(uint32_t page, Baserel *begin, Baserel *end) {
+BaserelChunk::BaserelChunk(uint32_t page, Baserel *begin, Baserel *end)
+    : page(page), rels(begin, end) {
   // Block header consists of 4 byte page RVA and 4 byte block size.
   // Each entry is 2 byte. Last entry may be padding.
-  data.resize(alignTo((end - begin) * 2 + 8, 4));
-  uint8_t *p = data.data();
-  write32le(p, page);
-  write32le(p + 4, data.size());
-  p += 8;
-  for (Baserel *i = begin; i != end; ++i) {
-    write16le(p, (i->type << 12) | (i->rva - page));
-    p += 2;
-  }
+  size = alignTo(rels.size() * 2 + 8, 4);
 }
 
 void BaserelChunk::writeTo(uint8_t *buf) const {
-  memcpy(buf, data.data(), data.size());
+  write32le(buf, page);
+  write32le(buf + 4, size);
+  uint8_t *p = buf + 8;
+  for (const Baserel &rel : rels) {
+    write16le(p, (rel.type << 12) | (rel.rva - page));
+    p += 2;
+  }
+  // The padding entry, if any, is IMAGE_REL_BASED_ABSOLUTE.
+  if (rels.size() % 2)
+    write16le(p, 0);
 }
 
 uint8_t Baserel::getDefaultType() {
@@ -862,10 +878,7 @@ uint8_t Baserel::getDefaultType() {
 
 MergeChunk *MergeChunk::instances[Log2MaxSectionAlignment + 1] = {};
 
-MergeChunk::MergeChunk(uint32_t alignment)
-    : builder(StringTableBuilder::RAW, alignment) {
-  setAlignment(alignment);
-}
+MergeChunk::MergeChunk(uint32_t alignment) { setAlignment(alignment); }
 
 void MergeChunk::addSection(SectionChunk *c) {
   assert(isPowerOf2_32(c->getAlignment()));
@@ -877,34 +890,118 @@ void MergeChunk::addSection(SectionChunk *c) {
   mc->sections.push_back(c);
 }
 
+// Returns true if a should come before b in a tail merged string table:
+// strings are sorted in descending order of their reversed contents, so that
+// a string comes right after the longest one that it is a suffix of.
+static bool isTailMergeOrdered(StringRef a, StringRef b) {
+  size_t n = std::min(a.size(), b.size());
+  for (size_t i = 1; i <= n; ++i) {
+    unsigned char x = a[a.size() - i];
+    unsigned char y = b[b.size() - i];
+    if (x != y)
+      return x > y;
+  }
+  return a.size() > b.size();
+}
+
+// This gives the same contents as StringTableBuilder::finalize() for a RAW
+// table, which is serial and is slow for the huge string pools of large C++
+// programs. The strings are deduplicated in shards selected by their hashes
+// and then sorted in parallel. One linear pass over the sorted strings then
+// places each string at the end of the previous one if it is a suffix of
+// that and the alignment allows it, or after everything else otherwise.
 void MergeChunk::finalizeContents() {
   assert(!finalized && "should only finalize once");
-  for (SectionChunk *c : sections)
-    if (c->live)
-      builder.add(toStringRef(c->getContents()));
-  builder.finalize();
+  constexpr size_t numShards = 32;
+  size_t concurrency = 1;
+  if (threadsEnabled)
+    concurrency = std::min<size_t>(PowerOf2Floor(getThreadCount()), numShards);
+
+  std::vector<StringRef> contents(sections.size());
+  std::vector<uint32_t> hashes(sections.size());
+  parallelForEachN(0, sections.size(), [&](size_t i) {
+    if (!sections[i]->live)
+      return;
+    contents[i] = toStringRef(sections[i]->getContents());
+    hashes[i] = xxHash64(contents[i]);
+  });
+
+  // Deduplicate the strings. For now, the index of each section's string in
+  // its shard is stored as its offset.
+  offsets.resize(sections.size());
+  std::vector<std::vector<StringRef>> shards(numShards);
+  std::vector<DenseMap<CachedHashStringRef, uint32_t>> maps(numShards);
+  parallelForEachN(0, concurrency, [&](size_t threadId) {
+    for (size_t i = 0, e = sections.size(); i != e; ++i) {
+      if (!sections[i]->live)
+        continue;
+      size_t shardId = hashes[i] % numShards;
+      if ((shardId & (concurrency - 1)) != threadId)
+        continue;
+      auto it = maps[shardId].try_emplace(
+          CachedHashStringRef(contents[i], hashes[i]), shards[shardId].size());
+      if (it.second)
+        shards[shardId].push_back(contents[i]);
+      offsets[i] = it.first->second;
+    }
+  });
+
+  size_t shardBase[numShards];
+  std::vector<StringRef> all;
+  for (size_t i = 0; i < numShards; ++i) {
+    shardBase[i] = all.size();
+    all.insert(all.end(), shards[i].begin(), shards[i].end());
+  }
+
+  std::vector<uint32_t> order(all.size());
+  std::iota(order.begin(), order.end(), 0);
+  parallelSort(order, [&](uint32_t a, uint32_t b) {
+    return isTailMergeOrdered(all[a], all[b]);
+  });
+
+  uint32_t alignment = getAlignment();
+  std::vector<uint32_t> stringOffsets(all.size());
+  StringRef prev;
+  for (uint32_t i : order) {
+    StringRef s = all[i];
+    if (prev.endswith(s)) {
+      size_t pos = size - s.size();
+      if (!(pos & (alignment - 1))) {
+        stringOffsets[i] = pos;
+        continue;
+      }
+    }
+    size = alignTo(size, alignment);
+    stringOffsets[i] = size;
+    strings.push_back({s, size});
+    size += s.size();
+    prev = s;
+  }
+
+  parallelForEachN(0, sections.size(), [&](size_t i) {
+    if (sections[i]->live)
+      offsets[i] =
+          stringOffsets[shardBase[hashes[i] % numShards] + offsets[i]];
+  });
   finalized = true;
 }
 
 void MergeChunk::assignSubsectionRVAs() {
-  for (SectionChunk *c : sections) {
-    if (!c->live)
-      continue;
-    size_t off = builder.getOffset(toStringRef(c->getContents()));
-    c->setRVA(rva + off);
-  }
+  for (size_t i = 0, e = sections.size(); i != e; ++i)
+    if (sections[i]->live)
+      sections[i]->setRVA(rva + offsets[i]);
 }
 
 uint32_t MergeChunk::getOutputCharacteristics() const {
   return IMAGE_SCN_MEM_READ | IMAGE_SCN_CNT_INITIALIZED_DATA;
 }
 
-size_t MergeChunk::getSize() const {
-  return builder.getSize();
-}
+size_t MergeChunk::getSize() const { return size; }
 
 void MergeChunk::writeTo(uint8_t *buf) const {
-  builder.write(buf);
+  parallelForEach(strings, [&](const std::pair<StringRef, uint32_t> &p) {
+    memcpy(buf + p.second, p.first.data(), p.first.size());
+  });
 }
 
 // MinGW specific.
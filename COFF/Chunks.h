@@ -293,6 +293,9 @@ public:
   // The section ID this chunk belongs to in its Obj.
   uint32_t getSectionNumber() const;
 
+  // The COMDAT leader symbol if this is a COMDAT chunk.
+  DefinedRegular *getComdatLeader() const;
+
   ArrayRef<uint8_t> consumeDebugMagic();
 
   static ArrayRef<uint8_t> consumeDebugMagic(ArrayRef<uint8_t> data,
@@ -307,9 +310,6 @@ public:
   // Pointer to the COFF section header in the input file.
   const coff_section *header;
 
-  // The COMDAT leader symbol if this is a COMDAT chunk.
-  DefinedRegular *sym = nullptr;
-
   // The CRC of the contents as described in the COFF spec 4.5.5.
   // Auxiliary Format 5: Section Definitions. Used for ICF.
   uint32_t checksum = 0;
@@ -398,9 +398,9 @@ inline StringRef Chunk::getDebugName() const {
 //
 // If string tail merging is enabled and a section is identified as containing a
 // string literal, it is added to a MergeChunk with an appropriate alignment.
-// The MergeChunk then tail merges the strings using the StringTableBuilder
-// class and assigns RVAs and section offsets to each of the member chunks based
-// on the offsets assigned by the StringTableBuilder.
+// The MergeChunk then tail merges the strings in the same way as the
+// StringTableBuilder class, but in parallel, and assigns RVAs and section
+// offsets to each of the member chunks based on the offsets of the strings.
 class MergeChunk : public NonSectionChunk {
 public:
   MergeChunk(uint32_t alignment);
@@ -417,7 +417,13 @@ public:
   std::vector<SectionChunk *> sections;
 
 private:
-  llvm::StringTableBuilder builder;
+  // The output offsets of the strings of sections.
+  std::vector<uint32_t> offsets;
+
+  // The strings that are not tail merged into others, and their offsets.
+  std::vector<std::pair<StringRef, uint32_t>> strings;
+
+  size_t size = 0;
   bool finalized = false;
 };
 
@@ -536,41 +542,28 @@ private:
   Defined *sym;
 };
 
-// Duplicate RVAs are not allowed in RVA tables, so unique symbols by chunk and
-// offset into the chunk. Order does not matter as the RVA table will be sorted
-// later.
+// Symbol RVAs are represented by chunk and offset into the chunk, since the
+// RVAs are not known yet when RVA tables are built. Order does not matter as
+// the RVA table will be sorted later.
 struct ChunkAndOffset {
   Chunk *inputChunk;
   uint32_t offset;
-
-  struct DenseMapInfo {
-    static ChunkAndOffset getEmptyKey() {
-      return {llvm::DenseMapInfo<Chunk *>::getEmptyKey(), 0};
-    }
-    static ChunkAndOffset getTombstoneKey() {
-      return {llvm::DenseMapInfo<Chunk *>::getTombstoneKey(), 0};
-    }
-    static unsigned getHashValue(const ChunkAndOffset &co) {
-      return llvm::DenseMapInfo<std::pair<Chunk *, uint32_t>>::getHashValue(
-          {co.inputChunk, co.offset});
-    }
-    static bool isEqual(const ChunkAndOffset &lhs, const ChunkAndOffset &rhs) {
-      return lhs.inputChunk == rhs.inputChunk && lhs.offset == rhs.offset;
-    }
-  };
 };
 
-using SymbolRVASet = llvm::DenseSet<ChunkAndOffset>;
+// A list of symbol RVAs. It is filled in parallel and may contain duplicates,
+// which are not allowed in RVA tables, until it is uniqued by
+// Writer::maybeAddRVATable.
+using SymbolRVAList = std::vector<ChunkAndOffset>;
 
 // Table which contains symbol RVAs. Used for /safeseh and /guard:cf.
 class RVATableChunk : public NonSectionChunk {
 public:
-  explicit RVATableChunk(SymbolRVASet s) : syms(std::move(s)) {}
+  explicit RVATableChunk(SymbolRVAList s) : syms(std::move(s)) {}
   size_t getSize() const override { return syms.size() * 4; }
   void writeTo(uint8_t *buf) const override;
 
 private:
-  SymbolRVASet syms;
+  SymbolRVAList syms;
 };
 
 // Windows-specific.
@@ -579,11 +572,14 @@ private:
 class BaserelChunk : public NonSectionChunk {
 public:
   BaserelChunk(uint32_t page, Baserel *begin, Baserel *end);
-  size_t getSize() const override { return data.size(); }
+  size_t getSize() const override { return size; }
   void writeTo(uint8_t *buf) const override;
 
 private:
-  std::vector<uint8_t> data;
+  uint32_t page;
+  // The entries are owned by the Writer until the output is written.
+  ArrayRef<Baserel> rels;
+  uint32_t size;
 };
 
 class Baserel {
@@ -677,10 +673,4 @@ void applyArm64Branch26(uint8_t *off, int64_t v);
 } // namespace coff
 } // namespace lld
 
-namespace llvm {
-template <>
-struct DenseMapInfo<lld::coff::ChunkAndOffset>
-    : lld::coff::ChunkAndOffset::DenseMapInfo {};
-}
-
 #endif
@@ -9,6 +9,7 @@
 #ifndef LLD_COFF_CONFIG_H
 #define LLD_COFF_CONFIG_H
 
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Object/COFF.h"
@@ -26,6 +27,7 @@ using llvm::COFF::WindowsSubsystem;
 using llvm::StringRef;
 class DefinedAbsolute;
 class DefinedRelative;
+class SectionChunk;
 class StringChunk;
 class Symbol;
 class InputFile;
@@ -105,6 +107,10 @@ struct Configuration {
   bool debugSymtab = false;
   bool showTiming = false;
   bool showSummary = false;
+  bool timeTraceEnabled = false;
+  unsigned timeTraceGranularity = 500;
+  llvm::StringRef timeJsonFile;
+  llvm::StringRef timeTraceFile;
   unsigned debugTypes = static_cast<unsigned>(DebugType::None);
   std::vector<std::string> natvisFiles;
   llvm::SmallString<128> pdbAltPath;
@@ -145,6 +151,9 @@ struct Configuration {
   // Used for /opt:lldltopartitions=N
   unsigned ltoPartitions = 1;
 
+  // Used for /lldghashcache:path
+  StringRef ghashCache;
+
   // Used for /opt:lldltocache=path
   StringRef ltoCache;
   // Used for /opt:lldltocachepolicy=policy
@@ -178,6 +187,12 @@ struct Configuration {
   // Used for /order.
   llvm::StringMap<int> order;
 
+  // Used for /call-graph-profile-sort and /call-graph-ordering-file.
+  llvm::MapVector<std::pair<const SectionChunk *, const SectionChunk *>,
+                  uint64_t>
+      callGraphProfile;
+  bool callGraphProfileSort = false;
+
   // Used for /lldmap.
   std::string mapFile;
 
@@ -193,6 +208,9 @@ struct Configuration {
   // Used for /lto-obj-path:
   llvm::StringRef ltoObjPath;
 
+  // Used for /thinlto-backend-command:
+  llvm::StringRef thinLTOBackendCommand;
+
   uint64_t align = 4096;
   uint64_t imageBase = -1;
   uint64_t fileAlign = 512;
@@ -219,6 +237,7 @@ struct Configuration {
   bool warnLocallyDefinedImported = true;
   bool warnDebugInfoUnusable = true;
   bool incremental = true;
+  bool incrementalPdb = false;
   bool integrityCheck = false;
   bool killAt = false;
   bool repro = false;
@@ -34,67 +34,107 @@ namespace {
 
 // Import table
 
-// A chunk for the import descriptor table.
-class HintNameChunk : public NonSectionChunk {
+// A chunk for the hint/name table. It contains the names of all symbols
+// that are imported by name.
+class HintNameTableChunk : public NonSectionChunk {
 public:
-  HintNameChunk(StringRef n, uint16_t h) : name(n), hint(h) {}
-
-  size_t getSize() const override {
-    // Starts with 2 byte Hint field, followed by a null-terminated string,
-    // ends with 0 or 1 byte padding.
-    return alignTo(name.size() + 3, 2);
+  // Adds an entry and returns its offset in the table.
+  uint32_t add(StringRef name, uint16_t hint) {
+    uint32_t offset = size;
+    entries.push_back({name, hint});
+    size += getEntrySize(name);
+    return offset;
   }
 
+  bool empty() const { return entries.empty(); }
+  size_t getSize() const override { return size; }
+
   void writeTo(uint8_t *buf) const override {
-    memset(buf, 0, getSize());
-    write16le(buf, hint);
-    memcpy(buf + 2, name.data(), name.size());
+    memset(buf, 0, size);
+    for (const std::pair<StringRef, uint16_t> &e : entries) {
+      write16le(buf, e.second);
+      memcpy(buf + 2, e.first.data(), e.first.size());
+      buf += getEntrySize(e.first);
+    }
   }
 
 private:
-  StringRef name;
-  uint16_t hint;
+  // Each entry starts with 2 byte Hint field, followed by a null-terminated
+  // string, ends with 0 or 1 byte padding.
+  static size_t getEntrySize(StringRef name) {
+    return alignTo(name.size() + 3, 2);
+  }
+
+  std::vector<std::pair<StringRef, uint16_t>> entries;
+  size_t size = 0;
 };
 
-// A chunk for the import descriptor table.
-class LookupChunk : public NonSectionChunk {
+// A chunk for the import lookup table or the import address table of all
+// DLLs, or for the delay import name table. Each entry refers to a hint/name
+// table entry or contains an ordinal, and the entries of each DLL are
+// terminated by a null entry. Storing the entries in one chunk rather than
+// in a chunk for each imported symbol keeps large import tables cheap.
+class ImportTableChunk : public NonSectionChunk {
 public:
-  explicit LookupChunk(Chunk *c) : hintName(c) {
+  ImportTableChunk(Chunk *hintNames, size_t nullSize)
+      : hintNames(hintNames), nullSize(nullSize) {
     setAlignment(config->wordsize);
   }
-  size_t getSize() const override { return config->wordsize; }
 
-  void writeTo(uint8_t *buf) const override {
-    if (config->is64())
-      write64le(buf, hintName->getRVA());
-    else
-      write32le(buf, hintName->getRVA());
+  // Add entries and return their offsets in the table.
+  uint32_t addName(uint32_t hintNameOffset) {
+    return add({Entry::Name, 0, hintNameOffset}, config->wordsize);
   }
-
-  Chunk *hintName;
-};
-
-// A chunk for the import descriptor table.
-// This chunk represent import-by-ordinal symbols.
-// See Microsoft PE/COFF spec 7.1. Import Header for details.
-class OrdinalOnlyChunk : public NonSectionChunk {
-public:
-  explicit OrdinalOnlyChunk(uint16_t v) : ordinal(v) {
-    setAlignment(config->wordsize);
+  uint32_t addOrdinal(uint16_t ordinal) {
+    return add({Entry::Ordinal, ordinal, 0}, config->wordsize);
   }
-  size_t getSize() const override { return config->wordsize; }
+  void addNull() { add({Entry::Null, 0, 0}, nullSize); }
+
+  size_t getSize() const override { return size; }
 
   void writeTo(uint8_t *buf) const override {
-    // An import-by-ordinal slot has MSB 1 to indicate that
-    // this is import-by-ordinal (and not import-by-name).
-    if (config->is64()) {
-      write64le(buf, (1ULL << 63) | ordinal);
-    } else {
-      write32le(buf, (1ULL << 31) | ordinal);
+    memset(buf, 0, size);
+    for (size_t i = 0, e = entries.size(); i != e; ++i) {
+      uint64_t v = 0;
+      switch (entries[i].kind) {
+      case Entry::Null:
+        continue;
+      case Entry::Name:
+        v = hintNames->getRVA() + entries[i].value;
+        break;
+      case Entry::Ordinal:
+        // An import-by-ordinal slot has MSB 1 to indicate that
+        // this is import-by-ordinal (and not import-by-name).
+        v = (config->is64() ? (1ULL << 63) : (1ULL << 31)) | entries[i].ordinal;
+        break;
+      }
+      if (config->is64())
+        write64le(buf + offsets[i], v);
+      else
+        write32le(buf + offsets[i], v);
     }
   }
 
-  uint16_t ordinal;
+private:
+  struct Entry {
+    enum Kind : uint8_t { Null, Name, Ordinal } kind;
+    uint16_t ordinal;
+    uint32_t value;
+  };
+
+  uint32_t add(Entry e, size_t entrySize) {
+    uint32_t offset = alignTo(size, config->wordsize);
+    entries.push_back(e);
+    offsets.push_back(offset);
+    size = offset + entrySize;
+    return offset;
+  }
+
+  Chunk *hintNames;
+  size_t nullSize;
+  std::vector<Entry> entries;
+  std::vector<uint32_t> offsets;
+  size_t size = 0;
 };
 
 // A chunk for the import descriptor table.
@@ -107,14 +147,17 @@ public:
     memset(buf, 0, getSize());
 
     auto *e = (coff_import_directory_table_entry *)(buf);
-    e->ImportLookupTableRVA = lookupTab->getRVA();
+    e->ImportLookupTableRVA = lookupTab->getRVA() + tableOffset;
     e->NameRVA = dllName->getRVA();
-    e->ImportAddressTableRVA = addressTab->getRVA();
+    e->ImportAddressTableRVA = addressTab->getRVA() + tableOffset;
   }
 
   Chunk *dllName;
   Chunk *lookupTab;
   Chunk *addressTab;
+
+  // The offset of the DLL's entries in the lookup and address tables.
+  uint32_t tableOffset;
 };
 
 // A chunk representing null terminator in the import table.
@@ -176,14 +219,18 @@ public:
     e->Attributes = 1;
     e->Name = dllName->getRVA();
     e->ModuleHandle = moduleHandle->getRVA();
-    e->DelayImportAddressTable = addressTab->getRVA();
-    e->DelayImportNameTable = nameTab->getRVA();
+    e->DelayImportAddressTable = addressTab->getRVA() + addressOffset;
+    e->DelayImportNameTable = nameTab->getRVA() + nameOffset;
   }
 
   Chunk *dllName;
   Chunk *moduleHandle;
   Chunk *addressTab;
   Chunk *nameTab;
+
+  // The offsets of the DLL's entries in the address and name tables.
+  uint32_t addressOffset;
+  uint32_t nameOffset;
 };
 
 // Initial contents for delay-loaded functions.
@@ -438,30 +485,48 @@ public:
 };
 
 // A chunk for the import descriptor table.
-class DelayAddressChunk : public NonSectionChunk {
+// A chunk for the delay import address table of all DLLs. Each entry
+// initially points to the delay import thunk of a symbol, and the entries of
+// each DLL are terminated by a null entry.
+class DelayAddressTableChunk : public NonSectionChunk {
 public:
-  explicit DelayAddressChunk(Chunk *c) : thunk(c) {
-    setAlignment(config->wordsize);
+  DelayAddressTableChunk() { setAlignment(config->wordsize); }
+
+  // Adds an entry and returns its offset in the table.
+  uint32_t add(Chunk *thunk) {
+    uint32_t offset = alignTo(size, config->wordsize);
+    entries.push_back({thunk, offset});
+    size = offset + config->wordsize;
+    return offset;
   }
-  size_t getSize() const override { return config->wordsize; }
+  void addNull() { size += 8; }
+
+  size_t getSize() const override { return size; }
 
   void writeTo(uint8_t *buf) const override {
-    if (config->is64()) {
-      write64le(buf, thunk->getRVA() + config->imageBase);
-    } else {
-      uint32_t bit = 0;
-      // Pointer to thumb code must have the LSB set, so adjust it.
-      if (config->machine == ARMNT)
-        bit = 1;
-      write32le(buf, (thunk->getRVA() + config->imageBase) | bit);
+    memset(buf, 0, size);
+    for (const std::pair<Chunk *, uint32_t> &e : entries) {
+      if (config->is64()) {
+        write64le(buf + e.second, e.first->getRVA() + config->imageBase);
+      } else {
+        uint32_t bit = 0;
+        // Pointer to thumb code must have the LSB set, so adjust it.
+        if (config->machine == ARMNT)
+          bit = 1;
+        write32le(buf + e.second,
+                  (e.first->getRVA() + config->imageBase) | bit);
+      }
     }
   }
 
   void getBaserels(std::vector<Baserel> *res) override {
-    res->emplace_back(rva);
+    for (const std::pair<Chunk *, uint32_t> &e : entries)
+      res->emplace_back(rva + e.second);
   }
 
-  Chunk *thunk;
+private:
+  std::vector<std::pair<Chunk *, uint32_t>> entries;
+  size_t size = 0;
 };
 
 // Export table
@@ -564,41 +629,49 @@ private:
 void IdataContents::create() {
   std::vector<std::vector<DefinedImportData *>> v = binImports(imports);
 
+  auto *hintNames = make<HintNameTableChunk>();
+  auto *lookupTab = make<ImportTableChunk>(hintNames, config->wordsize);
+  auto *addressTab = make<ImportTableChunk>(hintNames, config->wordsize);
+
   // Create .idata contents for each DLL.
   for (std::vector<DefinedImportData *> &syms : v) {
-    // Create lookup and address tables. If they have external names,
-    // we need to create hintName chunks to store the names.
+    // Create lookup and address table entries. If they have external names,
+    // we need to create hint/name entries to store the names.
     // If they don't (if they are import-by-ordinals), we store only
     // ordinal values to the table.
-    size_t base = lookups.size();
+    uint32_t tableOffset = lookupTab->getSize();
     for (DefinedImportData *s : syms) {
       uint16_t ord = s->getOrdinal();
+      uint32_t offset;
       if (s->getExternalName().empty()) {
-        lookups.push_back(make<OrdinalOnlyChunk>(ord));
-        addresses.push_back(make<OrdinalOnlyChunk>(ord));
-        continue;
+        offset = lookupTab->addOrdinal(ord);
+        addressTab->addOrdinal(ord);
+      } else {
+        uint32_t hintName = hintNames->add(s->getExternalName(), ord);
+        offset = lookupTab->addName(hintName);
+        addressTab->addName(hintName);
       }
-      auto *c = make<HintNameChunk>(s->getExternalName(), ord);
-      lookups.push_back(make<LookupChunk>(c));
-      addresses.push_back(make<LookupChunk>(c));
-      hints.push_back(c);
+      s->setLocation(addressTab, offset);
     }
     // Terminate with null values.
-    lookups.push_back(make<NullChunk>(config->wordsize));
-    addresses.push_back(make<NullChunk>(config->wordsize));
-
-    for (int i = 0, e = syms.size(); i < e; ++i)
-      syms[i]->setLocation(addresses[base + i]);
+    lookupTab->addNull();
+    addressTab->addNull();
 
     // Create the import table header.
     dllNames.push_back(make<StringChunk>(syms[0]->getDLLName()));
     auto *dir = make<ImportDirectoryChunk>(dllNames.back());
-    dir->lookupTab = lookups[base];
-    dir->addressTab = addresses[base];
+    dir->lookupTab = lookupTab;
+    dir->addressTab = addressTab;
+    dir->tableOffset = tableOffset;
     dirs.push_back(dir);
   }
   // Add null terminator.
   dirs.push_back(make<NullChunk>(sizeof(ImportDirectoryTableEntry)));
+
+  lookups.push_back(lookupTab);
+  addresses.push_back(addressTab);
+  if (!hintNames->empty())
+    hints.push_back(hintNames);
 }
 
 std::vector<Chunk *> DelayLoadContents::getChunks() {
@@ -625,47 +698,51 @@ void DelayLoadContents::create(Defined *h) {
   helper = h;
   std::vector<std::vector<DefinedImportData *>> v = binImports(imports);
 
+  auto *hintNameTab = make<HintNameTableChunk>();
+  auto *addressTab = make<DelayAddressTableChunk>();
+  auto *nameTab = make<ImportTableChunk>(hintNameTab, 8);
+
   // Create .didat contents for each DLL.
   for (std::vector<DefinedImportData *> &syms : v) {
     // Create the delay import table header.
     dllNames.push_back(make<StringChunk>(syms[0]->getDLLName()));
     auto *dir = make<DelayDirectoryChunk>(dllNames.back());
+    dir->addressOffset = addressTab->getSize();
+    dir->nameOffset = nameTab->getSize();
 
-    size_t base = addresses.size();
     Chunk *tm = newTailMergeChunk(dir);
     for (DefinedImportData *s : syms) {
       Chunk *t = newThunkChunk(s, tm);
-      auto *a = make<DelayAddressChunk>(t);
-      addresses.push_back(a);
+      s->setLocation(addressTab, addressTab->add(t));
       thunks.push_back(t);
       StringRef extName = s->getExternalName();
-      if (extName.empty()) {
-        names.push_back(make<OrdinalOnlyChunk>(s->getOrdinal()));
-      } else {
-        auto *c = make<HintNameChunk>(extName, 0);
-        names.push_back(make<LookupChunk>(c));
-        hintNames.push_back(c);
-      }
+      if (extName.empty())
+        nameTab->addOrdinal(s->getOrdinal());
+      else
+        nameTab->addName(hintNameTab->add(extName, 0));
     }
     thunks.push_back(tm);
     // Terminate with null values.
-    addresses.push_back(make<NullChunk>(8));
-    names.push_back(make<NullChunk>(8));
+    addressTab->addNull();
+    nameTab->addNull();
 
-    for (int i = 0, e = syms.size(); i < e; ++i)
-      syms[i]->setLocation(addresses[base + i]);
     auto *mh = make<NullChunk>(8);
     mh->setAlignment(8);
     moduleHandles.push_back(mh);
 
     // Fill the delay import table header fields.
     dir->moduleHandle = mh;
-    dir->addressTab = addresses[base];
-    dir->nameTab = names[base];
+    dir->addressTab = addressTab;
+    dir->nameTab = nameTab;
     dirs.push_back(dir);
   }
   // Add null terminator.
   dirs.push_back(make<NullChunk>(sizeof(delay_import_directory_table_entry)));
+
+  addresses.push_back(addressTab);
+  names.push_back(nameTab);
+  if (!hintNameTab->empty())
+    hintNames.push_back(hintNameTab);
 }
 
 Chunk *DelayLoadContents::newTailMergeChunk(Chunk *dir) {
@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "DebugTypes.h"
+#include "Config.h"
 #include "Driver.h"
 #include "InputFiles.h"
 #include "lld/Common/ErrorHandler.h"
@@ -15,7 +16,10 @@
 #include "llvm/DebugInfo/PDB/Native/InfoStream.h"
 #include "llvm/DebugInfo/PDB/Native/NativeSession.h"
 #include "llvm/DebugInfo/PDB/Native/PDBFile.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
 using namespace llvm::codeview;
@@ -263,5 +267,102 @@ Expected<TypeServerSource *> TypeServerSource::getInstance(MemoryBufferRef m) {
   return new TypeServerSource(m, session.release());
 }
 
+// A cache file consists of a header followed by the hashes. The number and
+// the total size of the records are stored to detect a key that is reused
+// for different records.
+namespace {
+struct GHashCacheHeader {
+  char magic[8];
+  support::ulittle32_t numRecords;
+  support::ulittle32_t hashSize;
+  support::ulittle64_t size;
+};
+} // namespace
+
+static const char ghashCacheMagic[] = {'L', 'L', 'D', 'G', 'H', 'S', 'H', '1'};
+
+static Optional<std::vector<GloballyHashedType>>
+readGHashCache(StringRef path, uint32_t numRecords, uint64_t size) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr = MemoryBuffer::getFile(
+      path, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  if (!mbOrErr)
+    return None;
+
+  StringRef buf = (*mbOrErr)->getBuffer();
+  if (buf.size() != sizeof(GHashCacheHeader) +
+                        uint64_t(numRecords) * sizeof(GloballyHashedType))
+    return None;
+
+  auto *hdr = reinterpret_cast<const GHashCacheHeader *>(buf.data());
+  if (memcmp(hdr->magic, ghashCacheMagic, sizeof(ghashCacheMagic)) != 0 ||
+      hdr->numRecords != numRecords ||
+      hdr->hashSize != sizeof(GloballyHashedType) || hdr->size != size)
+    return None;
+
+  std::vector<GloballyHashedType> hashes(numRecords);
+  memcpy(hashes.data(), buf.data() + sizeof(GHashCacheHeader),
+         numRecords * sizeof(GloballyHashedType));
+  return hashes;
+}
+
+static void writeGHashCache(StringRef path, uint64_t size,
+                            ArrayRef<GloballyHashedType> hashes) {
+  // Other links may read or write the same file at the same time, so write
+  // to a temporary file and rename it.
+  sys::fs::create_directories(config->ghashCache);
+  int fd;
+  SmallString<128> tmpPath;
+  if (std::error_code ec =
+          sys::fs::createUniqueFile(path + ".%%%%%%.tmp", fd, tmpPath)) {
+    warn("cannot create a file in the ghash cache: " + ec.message());
+    return;
+  }
+
+  {
+    GHashCacheHeader hdr;
+    memcpy(hdr.magic, ghashCacheMagic, sizeof(ghashCacheMagic));
+    hdr.numRecords = hashes.size();
+    hdr.hashSize = sizeof(GloballyHashedType);
+    hdr.size = size;
+
+    raw_fd_ostream os(fd, /*shouldClose=*/true);
+    os.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    os.write(reinterpret_cast<const char *>(hashes.data()),
+             hashes.size() * sizeof(GloballyHashedType));
+  }
+
+  if (std::error_code ec = sys::fs::rename(tmpPath, path)) {
+    warn("cannot write " + path + ": " + ec.message());
+    sys::fs::remove(tmpPath);
+  }
+}
+
+std::vector<GloballyHashedType>
+getCachedGHashes(StringRef key, const CVTypeArray &types,
+                 function_ref<std::vector<GloballyHashedType>()> hash) {
+  if (config->ghashCache.empty())
+    return hash();
+
+  uint32_t numRecords = 0;
+  uint64_t size = 0;
+  for (const CVType &type : types) {
+    ++numRecords;
+    size += type.length();
+  }
+
+  SmallString<128> path(config->ghashCache);
+  sys::path::append(path, key + ".ghash");
+
+  if (Optional<std::vector<GloballyHashedType>> hashes =
+          readGHashCache(path, numRecords, size)) {
+    log("ghash cache: using " + path);
+    return std::move(*hashes);
+  }
+
+  std::vector<GloballyHashedType> hashes = hash();
+  writeGHashCache(path, size, hashes);
+  return hashes;
+}
+
 } // namespace coff
 } // namespace lld
@@ -9,6 +9,9 @@
 #ifndef LLD_COFF_DEBUGTYPES_H
 #define LLD_COFF_DEBUGTYPES_H
 
+#include "lld/Common/LLVM.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/DebugInfo/CodeView/TypeHashing.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
 
@@ -54,6 +57,16 @@ template <typename T> const T &retrieveDependencyInfo(const TpiSource *source);
 llvm::Expected<llvm::pdb::NativeSession *>
 findTypeServerSource(const ObjFile *f);
 
+// Returns the global hashes of type records that are shared by many links,
+// such as those of a type server PDB or a precompiled header object. The
+// records are identified by key. If /lldghashcache is given, the hashes are
+// read from the cache if a previous link put them there, and are otherwise
+// computed by hash() and put there. This is thread-safe.
+std::vector<llvm::codeview::GloballyHashedType> getCachedGHashes(
+    StringRef key, const llvm::codeview::CVTypeArray &types,
+    llvm::function_ref<std::vector<llvm::codeview::GloballyHashedType>()>
+        hash);
+
 } // namespace coff
 } // namespace lld
 
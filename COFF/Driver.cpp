@@ -10,6 +10,7 @@
 #include "Config.h"
 #include "DebugTypes.h"
 #include "ICF.h"
+#include "Incremental.h"
 #include "InputFiles.h"
 #include "MarkLive.h"
 #include "MinGW.h"
@@ -20,7 +21,9 @@
 #include "lld/Common/Driver.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Filesystem.h"
+#include "lld/Common/InputCache.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/PerfCounters.h"
 #include "lld/Common/Threads.h"
 #include "lld/Common/Timer.h"
 #include "lld/Common/Version.h"
@@ -35,13 +38,14 @@
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Option/Option.h"
+#include "llvm/Support/BinaryStreamReader.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
-#include "llvm/Support/TarWriter.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/ToolDrivers/llvm-lib/LibDriver.h"
 #include <algorithm>
@@ -73,9 +77,14 @@ bool link(ArrayRef<const char *> args, bool canExitEarly, raw_ostream &diag) {
   config = make<Configuration>();
   symtab = make<SymbolTable>();
   driver = make<LinkerDriver>();
+  errorHandler().cleanupCallback = [] { driver->tar = nullptr; };
 
   driver->link(args);
 
+  // Finish the /linkrepro tar file, so that it is complete when we return.
+  driver->tar = nullptr;
+  errorHandler().cleanupCallback = nullptr;
+
   // Call exit() if we can to avoid calling destructors.
   if (canExitEarly)
     exitLld(errorCount() ? 1 : 0);
@@ -85,6 +94,7 @@ bool link(ArrayRef<const char *> args, bool canExitEarly, raw_ostream &diag) {
   ImportFile::instances.clear();
   BitcodeFile::instances.clear();
   memset(MergeChunk::instances, 0, sizeof(MergeChunk::instances));
+  incrementalInputs.clear();
   return !errorCount();
 }
 
@@ -138,6 +148,15 @@ static std::future<MBErrPair> createFutureForFile(std::string path) {
   auto strategy = std::launch::deferred;
 #endif
   return std::async(strategy, [=]() {
+    // The link server keeps the file in memory for later links, so we get a
+    // buffer that does not own its contents.
+    if (inputCacheEnabled) {
+      ErrorOr<MemoryBufferRef> mbOrErr = readCachedInput(path);
+      if (!mbOrErr)
+        return MBErrPair{nullptr, mbOrErr.getError()};
+      return MBErrPair{MemoryBuffer::getMemBuffer(*mbOrErr, false),
+                       std::error_code()};
+    }
     auto mbOrErr = MemoryBuffer::getFile(path,
                                          /*FileSize*/ -1,
                                          /*RequiresNullTerminator*/ false);
@@ -194,20 +213,25 @@ void LinkerDriver::addBuffer(std::unique_ptr<MemoryBuffer> mb,
         addArchiveBuffer(m, "<whole-archive>", filename, memberIndex++);
       return;
     }
-    symtab->addFile(make<ArchiveFile>(mbref));
+    addFile(make<ArchiveFile>(mbref));
     break;
   case file_magic::bitcode:
     if (lazy)
-      symtab->addFile(make<LazyObjFile>(mbref));
+      addFile(make<LazyObjFile>(mbref));
     else
-      symtab->addFile(make<BitcodeFile>(mbref, "", 0));
+      addObjFile(make<BitcodeFile>(mbref, "", 0), "");
     break;
   case file_magic::coff_object:
+    if (lazy)
+      addFile(make<LazyObjFile>(mbref));
+    else
+      addObjFile(make<ObjFile>(mbref), "");
+    break;
   case file_magic::coff_import_library:
     if (lazy)
-      symtab->addFile(make<LazyObjFile>(mbref));
+      addFile(make<LazyObjFile>(mbref));
     else
-      symtab->addFile(make<ObjFile>(mbref));
+      addFile(make<ObjFile>(mbref));
     break;
   case file_magic::pdb:
     loadTypeServerSource(mbref);
@@ -247,8 +271,12 @@ void LinkerDriver::enqueuePath(StringRef path, bool wholeArchive, bool lazy) {
         error(msg);
       else
         error(msg + "; did you mean '" + nearest + "'");
-    } else
+    } else {
+      if (config->incremental)
+        incrementalInputs.push_back(
+            {pathStr, mbOrErr.first->getMemBufferRef()});
       driver->addBuffer(std::move(mbOrErr.first), wholeArchive, lazy);
+    }
   });
 }
 
@@ -259,23 +287,63 @@ void LinkerDriver::addArchiveBuffer(MemoryBufferRef mb, StringRef symName,
   if (magic == file_magic::coff_import_library) {
     InputFile *imp = make<ImportFile>(mb);
     imp->parentName = parentName;
-    symtab->addFile(imp);
+    addFile(imp);
     return;
   }
 
-  InputFile *obj;
   if (magic == file_magic::coff_object) {
-    obj = make<ObjFile>(mb);
-  } else if (magic == file_magic::bitcode) {
-    obj = make<BitcodeFile>(mb, parentName, offsetInArchive);
-  } else {
+    ObjFile *obj = make<ObjFile>(mb);
+    obj->parentName = parentName;
+    addObjFile(obj, symName);
+    return;
+  }
+
+  if (magic != file_magic::bitcode) {
     error("unknown file type: " + mb.getBufferIdentifier());
     return;
   }
 
+  InputFile *obj = make<BitcodeFile>(mb, parentName, offsetInArchive);
   obj->parentName = parentName;
-  symtab->addFile(obj);
-  log("Loaded " + toString(obj) + " for " + symName);
+  addObjFile(obj, symName);
+}
+
+void LinkerDriver::addFile(InputFile *file) {
+  addPendingObjFiles();
+  symtab->addFile(file);
+}
+
+void LinkerDriver::addObjFile(InputFile *file, StringRef symName) {
+  pendingObjFiles.push_back({file, symName});
+}
+
+void LinkerDriver::addPendingObjFiles() {
+  if (pendingObjFiles.empty())
+    return;
+
+  // Adding a file may enqueue more tasks but never appends to
+  // pendingObjFiles, so it is safe to take the list here.
+  std::vector<std::pair<InputFile *, std::string>> v;
+  v.swap(pendingObjFiles);
+
+  std::vector<ObjFile *> files;
+  std::vector<BitcodeFile *> bitcodeFiles;
+  for (auto &p : v) {
+    if (auto *f = dyn_cast<ObjFile>(p.first))
+      files.push_back(f);
+    else
+      bitcodeFiles.push_back(cast<BitcodeFile>(p.first));
+  }
+  preparseFiles(files);
+  parallelForEach(bitcodeFiles, [](BitcodeFile *f) { f->initializeObj(); });
+
+  // Symbols are resolved serially in command line order so that the
+  // result is deterministic.
+  for (auto &p : v) {
+    symtab->addFile(p.first);
+    if (!p.second.empty())
+      log("Loaded " + toString(p.first) + " for " + p.second);
+  }
 }
 
 void LinkerDriver::enqueueArchiveMember(const Archive::Child &c,
@@ -311,6 +379,9 @@ void LinkerDriver::enqueueArchiveMember(const Archive::Child &c,
     auto mbOrErr = future->get();
     if (mbOrErr.second)
       reportBufferError(errorCodeToError(mbOrErr.second), childName);
+    if (config->incremental)
+      incrementalInputs.push_back(
+          {childName, mbOrErr.first->getMemBufferRef()});
     // Pass empty string as archive name so that the original filename is
     // used as the buffer identifier.
     driver->addArchiveBuffer(takeBuffer(std::move(mbOrErr.first)),
@@ -742,7 +813,7 @@ static std::string getImportName(bool asLib) {
   return out.str();
 }
 
-static void createImportLibrary(bool asLib) {
+static std::vector<COFFShortExport> getShortExports() {
   std::vector<COFFShortExport> exports;
   for (Export &e1 : config->exports) {
     COFFShortExport e2;
@@ -756,13 +827,17 @@ static void createImportLibrary(bool asLib) {
     e2.Constant = e1.constant;
     exports.push_back(e2);
   }
+  return exports;
+}
 
+// Writes an import library. This does not read the global state other than
+// the machine type and the flags, so it may run on a background thread.
+static void writeImportLibraryFile(std::string libName, std::string path,
+                                   std::vector<COFFShortExport> exports) {
   auto handleError = [](Error &&e) {
     handleAllErrors(std::move(e),
                     [](ErrorInfoBase &eib) { error(eib.message()); });
   };
-  std::string libName = getImportName(asLib);
-  std::string path = getImplibPath();
 
   if (!config->incremental) {
     handleError(writeImportLibrary(libName, path, exports, config->machine,
@@ -782,9 +857,11 @@ static void createImportLibrary(bool asLib) {
 
   SmallString<128> tmpName;
   if (std::error_code ec =
-          sys::fs::createUniqueFile(path + ".tmp-%%%%%%%%.lib", tmpName))
-    fatal("cannot create temporary file for import library " + path + ": " +
+          sys::fs::createUniqueFile(path + ".tmp-%%%%%%%%.lib", tmpName)) {
+    error("cannot create temporary file for import library " + path + ": " +
           ec.message());
+    return;
+  }
 
   if (Error e = writeImportLibrary(libName, tmpName, exports, config->machine,
                                    config->mingw)) {
@@ -792,9 +869,13 @@ static void createImportLibrary(bool asLib) {
     return;
   }
 
-  std::unique_ptr<MemoryBuffer> newBuf = check(MemoryBuffer::getFile(
-      tmpName, /*FileSize*/ -1, /*RequiresNullTerminator*/ false));
-  if ((*oldBuf)->getBuffer() != newBuf->getBuffer()) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> newBuf = MemoryBuffer::getFile(
+      tmpName, /*FileSize*/ -1, /*RequiresNullTerminator*/ false);
+  if (!newBuf) {
+    error("cannot open " + tmpName + ": " + newBuf.getError().message());
+    return;
+  }
+  if ((*oldBuf)->getBuffer() != (*newBuf)->getBuffer()) {
     oldBuf->reset();
     handleError(errorCodeToError(sys::fs::rename(tmpName, path)));
   } else {
@@ -802,6 +883,22 @@ static void createImportLibrary(bool asLib) {
   }
 }
 
+static void createImportLibrary(bool asLib) {
+  writeImportLibraryFile(getImportName(asLib), getImplibPath(),
+                         getShortExports());
+}
+
+// Starts writing the import library for the output. The import library only
+// depends on the exports, so it is written on a background thread while the
+// image is being created. The returned future must be waited on before the
+// link completes.
+static std::future<void> createImportLibraryAsync() {
+  auto strategy = threadsEnabled ? std::launch::async : std::launch::deferred;
+  return std::async(strategy, writeImportLibraryFile,
+                    getImportName(/*asLib=*/false), getImplibPath(),
+                    getShortExports());
+}
+
 static void parseModuleDefs(StringRef path) {
   std::unique_ptr<MemoryBuffer> mb = CHECK(
       MemoryBuffer::getFile(path, -1, false, true), "could not open " + path);
@@ -864,6 +961,8 @@ bool LinkerDriver::run() {
   while (!taskQueue.empty()) {
     taskQueue.front()();
     taskQueue.pop_front();
+    if (taskQueue.empty())
+      addPendingObjFiles();
   }
   return didWork;
 }
@@ -883,8 +982,8 @@ static void parseOrderFile(StringRef arg) {
   DenseSet<StringRef> set;
   for (Chunk *c : symtab->getChunks())
     if (auto *sec = dyn_cast<SectionChunk>(c))
-      if (sec->sym)
-        set.insert(sec->sym->getName());
+      if (DefinedRegular *sym = sec->getComdatLeader())
+        set.insert(sym->getName());
 
   // Open a file.
   StringRef path = arg.substr(1);
@@ -908,6 +1007,85 @@ static void parseOrderFile(StringRef arg) {
   }
 }
 
+// Parse a call graph ordering file. Each line of the file is of the form
+// "<from symbol> <to symbol> <count>" and describes an edge of the call graph
+// used by /call-graph-profile-sort.
+static void parseCallGraphFile(StringRef path) {
+  std::unique_ptr<MemoryBuffer> mb = CHECK(
+      MemoryBuffer::getFile(path, -1, false, true), "could not open " + path);
+
+  // Build a map from symbol name to symbol.
+  DenseMap<StringRef, Symbol *> map;
+  for (ObjFile *file : ObjFile::instances)
+    for (Symbol *sym : file->getSymbols())
+      if (sym)
+        map[sym->getName()] = sym;
+
+  auto findSection = [&](StringRef name) -> SectionChunk * {
+    Symbol *sym = map.lookup(name);
+    if (!sym) {
+      if (config->warnMissingOrderSymbol)
+        warn(path + ": no such symbol: " + name);
+      return nullptr;
+    }
+
+    if (auto *dr = dyn_cast<DefinedRegular>(sym))
+      if (dr->getChunk()->live)
+        return dr->getChunk();
+    return nullptr;
+  };
+
+  for (StringRef line : args::getLines(*mb)) {
+    SmallVector<StringRef, 3> fields;
+    line.split(fields, ' ');
+    uint64_t count;
+
+    if (fields.size() != 3 || !to_integer(fields[2], count)) {
+      error(path + ": parse error");
+      return;
+    }
+
+    if (SectionChunk *from = findSection(fields[0]))
+      if (SectionChunk *to = findSection(fields[1]))
+        config->callGraphProfile[{from, to}] += count;
+  }
+}
+
+// Read the .llvm.call-graph-profile sections of the object files. Each entry
+// is a pair of symbol table indices followed by a 64-bit call count.
+static void readCallGraphsFromObjectFiles() {
+  for (ObjFile *obj : ObjFile::instances) {
+    if (!obj->callgraphSec)
+      continue;
+    ArrayRef<uint8_t> contents;
+    cantFail(
+        obj->getCOFFObj()->getSectionContents(obj->callgraphSec, contents));
+    BinaryStreamReader reader(contents, support::little);
+    while (!reader.empty()) {
+      uint32_t fromIndex, toIndex;
+      uint64_t count;
+      if (Error err = reader.readInteger(fromIndex))
+        fatal(toString(obj) + ": " + toString(std::move(err)));
+      if (Error err = reader.readInteger(toIndex))
+        fatal(toString(obj) + ": " + toString(std::move(err)));
+      if (Error err = reader.readInteger(count))
+        fatal(toString(obj) + ": " + toString(std::move(err)));
+      ArrayRef<Symbol *> syms = obj->getSymbols();
+      if (fromIndex >= syms.size() || toIndex >= syms.size())
+        fatal(toString(obj) +
+              ": invalid symbol index in .llvm.call-graph-profile section");
+      auto *fromSym = dyn_cast_or_null<DefinedRegular>(syms[fromIndex]);
+      auto *toSym = dyn_cast_or_null<DefinedRegular>(syms[toIndex]);
+      if (!fromSym || !toSym)
+        continue;
+      SectionChunk *from = fromSym->getChunk();
+      SectionChunk *to = toSym->getChunk();
+      if (from->live && to->live)
+        config->callGraphProfile[{from, to}] += count;
+    }
+  }
+}
+
 static void markAddrsig(Symbol *s) {
   if (auto *d = dyn_cast_or_null<Defined>(s))
     if (SectionChunk *c = dyn_cast_or_null<SectionChunk>(d->getChunk()))
@@ -1000,10 +1178,27 @@ static void parsePDBAltPath(StringRef altPath) {
   config->pdbAltPath = buf;
 }
 
+// Merging .res files does not depend on the other inputs, so the .res files
+// read so far are merged while the rest of the link proceeds. Any .res files
+// added later are merged by convertResources().
+void LinkerDriver::startResourceMerging() {
+  if (resources.empty())
+    return;
+  resourceTree = std::make_unique<ResourceTree>(config->mingw);
+  auto strategy = threadsEnabled ? std::launch::async : std::launch::deferred;
+  resourceMerging =
+      std::async(strategy, [tree = resourceTree.get(), mbs = resources] {
+        mergeResFiles(*tree, mbs);
+      });
+}
+
 /// Convert resource files and potentially merge input resource object
 /// trees into one resource tree.
 /// Call after ObjFile::Instances is complete.
 void LinkerDriver::convertResources() {
+  if (resourceMerging.valid())
+    resourceMerging.get();
+
   std::vector<ObjFile *> resourceObjFiles;
 
   for (ObjFile *f : ObjFile::instances) {
@@ -1028,7 +1223,12 @@ void LinkerDriver::convertResources() {
       f->includeResourceChunks();
     return;
   }
-  ObjFile *f = make<ObjFile>(convertResToCOFF(resources, resourceObjFiles));
+
+  if (!resourceTree)
+    resourceTree = std::make_unique<ResourceTree>(config->mingw);
+  mergeResFiles(*resourceTree,
+                makeArrayRef(resources).drop_front(resourceTree->numResFiles));
+  ObjFile *f = make<ObjFile>(convertResToCOFF(*resourceTree, resourceObjFiles));
   symtab->addFile(f);
   f->includeResourceChunks();
 }
@@ -1056,11 +1256,23 @@ void LinkerDriver::maybeExportMinGWSymbols(const opt::InputArgList &args) {
     if (Optional<StringRef> path = doFindFile(arg->getValue()))
       exporter.addWholeArchive(*path);
 
+  std::vector<Defined *> syms;
   symtab->forEachSymbol([&](Symbol *s) {
-    auto *def = dyn_cast<Defined>(s);
-    if (!exporter.shouldExport(def))
-      return;
+    if (auto *def = dyn_cast<Defined>(s))
+      syms.push_back(def);
+  });
 
+  // A DLL may have hundreds of thousands of candidate symbols, so they are
+  // checked in parallel. The exports are added in the original order.
+  std::vector<uint8_t> shouldExport(syms.size());
+  parallelForEachN(0, syms.size(), [&](size_t i) {
+    shouldExport[i] = exporter.shouldExport(syms[i]);
+  });
+
+  for (size_t i = 0; i < syms.size(); ++i) {
+    if (!shouldExport[i])
+      continue;
+    Defined *def = syms[i];
     Export e;
     e.name = def->getName();
     e.sym = def;
@@ -1068,7 +1280,7 @@ void LinkerDriver::maybeExportMinGWSymbols(const opt::InputArgList &args) {
       if (!(c->getOutputCharacteristics() & IMAGE_SCN_MEM_EXECUTE))
         e.data = true;
     config->exports.push_back(e);
-  });
+  }
 }
 
 // lld has a feature to create a tar file containing all input files as well as
@@ -1133,13 +1345,32 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
     return;
   }
 
-  lld::threadsEnabled = args.hasFlag(OPT_threads, OPT_threads_no, true);
+  args::setThreads(args, OPT_threads, OPT_threads_no, OPT_threads_eq);
+  // The memory budget and NUMA-aware threading are only set by ld.lld, but
+  // they are process-wide, so clear what an earlier link in this process set.
+  setNumaAware(false);
+  setMemoryBudget(0);
 
   if (args.hasArg(OPT_show_timing))
     config->showTiming = true;
+  arenaUsageEnabled = args.hasArg(OPT_print_arena_usage);
+  perfCountersEnabled = false;
+  if (args.hasArg(OPT_perf_counters))
+    enablePerfCounters();
 
   config->showSummary = args.hasArg(OPT_summary);
 
+  config->timeTraceEnabled = args.hasArg(OPT_time_trace);
+  config->timeTraceFile = args.getLastArgValue(OPT_time_trace_file);
+  config->timeJsonFile = args.getLastArgValue(OPT_time_json);
+  if (auto *arg = args.getLastArg(OPT_time_trace_granularity)) {
+    StringRef s = arg->getValue();
+    if (s.getAsInteger(10, config->timeTraceGranularity))
+      error(arg->getSpelling() + " number expected, but got " + s);
+  }
+  if (config->timeTraceEnabled)
+    timeTraceProfilerInitialize(config->timeTraceGranularity, argsArr[0]);
+
   ScopedTimer t(Timer::root());
   // Handle --version, which is an lld extension. This option is a bit odd
   // because it doesn't start with "/", but we deliberately chose "--" to
@@ -1155,8 +1386,8 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
 
   // Handle /linkrepro and /reproduce.
   if (Optional<std::string> path = getReproduceFile(args)) {
-    Expected<std::unique_ptr<TarWriter>> errOrWriter =
-        TarWriter::create(*path, sys::path::stem(*path));
+    Expected<std::unique_ptr<AsyncTarWriter>> errOrWriter =
+        AsyncTarWriter::create(*path, sys::path::stem(*path));
 
     if (errOrWriter) {
       tar = std::move(*errOrWriter);
@@ -1422,6 +1653,10 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
   if (args.hasArg(OPT_kill_at))
     config->killAt = true;
 
+  // Handle /lldghashcache
+  if (auto *arg = args.getLastArg(OPT_lldghashcache))
+    config->ghashCache = arg->getValue();
+
   // Handle /lldltocache
   if (auto *arg = args.getLastArg(OPT_lldltocache))
     config->ltoCache = arg->getValue();
@@ -1511,13 +1746,21 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
   config->thinLTOObjectSuffixReplace =
       getOldNewOptions(args, OPT_thinlto_object_suffix_replace);
   config->ltoObjPath = args.getLastArgValue(OPT_lto_obj_path);
+  config->thinLTOBackendCommand =
+      args.getLastArgValue(OPT_thinlto_backend_command);
+  if (config->thinLTOIndexOnly && !config->thinLTOBackendCommand.empty())
+    error("-thinlto-backend-command: cannot be used with -thinlto-index-only");
   // Handle miscellaneous boolean flags.
   config->allowBind = args.hasFlag(OPT_allowbind, OPT_allowbind_no, true);
   config->allowIsolation =
       args.hasFlag(OPT_allowisolation, OPT_allowisolation_no, true);
+  config->callGraphProfileSort = args.hasFlag(
+      OPT_call_graph_profile_sort, OPT_call_graph_profile_sort_no,
+      args.hasArg(OPT_call_graph_ordering_file));
   config->incremental =
       args.hasFlag(OPT_incremental, OPT_incremental_no,
                    !config->doGC && !config->doICF && !args.hasArg(OPT_order) &&
+                       !config->callGraphProfileSort &&
                        !args.hasArg(OPT_profile));
   config->integrityCheck =
       args.hasFlag(OPT_integritycheck, OPT_integritycheck_no, false);
@@ -1542,6 +1785,12 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
     config->incremental = false;
   }
 
+  if (config->incremental && config->callGraphProfileSort) {
+    warn("ignoring '/incremental' due to '/call-graph-profile-sort' "
+         "specification");
+    config->incremental = false;
+  }
+
   if (config->incremental && config->doGC) {
     warn("ignoring '/incremental' because REF is enabled; use '/opt:noref' to "
          "disable");
@@ -1557,6 +1806,15 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
   if (errorCount())
     return;
 
+  // Try to patch the previous output before reading any input. This is done
+  // only if /incremental is given explicitly, unlike the other effects of
+  // /incremental, which /debug implies. The same goes for reusing the
+  // previous PDB if the output has to be linked again.
+  bool relink = config->incremental && args.hasArg(OPT_incremental);
+  config->incrementalPdb = relink;
+  if (relink && linkIncrementally(args))
+    return;
+
   std::set<sys::fs::UniqueID> wholeArchives;
   for (auto *arg : args.filtered(OPT_wholearchive_file))
     if (Optional<StringRef> path = doFindFile(arg->getValue()))
@@ -1621,6 +1879,8 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
   if (errorCount())
     return;
 
+  startResourceMerging();
+
   // We should have inferred a machine type by now from the input files, but if
   // not we assume x64.
   if (config->machine == IMAGE_FILE_MACHINE_UNKNOWN) {
@@ -1908,10 +2168,11 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
   // Windows specific -- when we are creating a .dll file, we also
   // need to create a .lib file. In MinGW mode, we only do that when the
   // -implib option is given explicitly, for compatibility with GNU ld.
+  std::future<void> importLibrary;
   if (!config->exports.empty() || config->dll) {
     fixupExports();
     if (!config->mingw || !config->implib.empty())
-      createImportLibrary(/*asLib=*/false);
+      importLibrary = createImportLibraryAsync();
     assignExportOrdinals();
   }
 
@@ -1947,13 +2208,25 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
   // Handle /order. We want to do this at this moment because we
   // need a complete list of comdat sections to warn on nonexistent
   // functions.
-  if (auto *arg = args.getLastArg(OPT_order))
+  if (auto *arg = args.getLastArg(OPT_order)) {
+    if (args.hasArg(OPT_call_graph_ordering_file))
+      error("/order and /call-graph-ordering-file may not be used together");
     parseOrderFile(arg->getValue());
+    config->callGraphProfileSort = false;
+  }
 
   // Identify unreferenced COMDAT sections.
   if (config->doGC)
     markLive(symtab->getChunks());
 
+  // Read the call graph profile after markLive so that edges between dead
+  // sections are dropped.
+  if (config->callGraphProfileSort) {
+    if (auto *arg = args.getLastArg(OPT_call_graph_ordering_file))
+      parseCallGraphFile(arg->getValue());
+    readCallGraphsFromObjectFiles();
+  }
+
   // Needs to happen after the last call to addFile().
   convertResources();
 
@@ -1965,11 +2238,36 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
 
   // Write the result.
   writeResult();
+  if (relink) {
+    // The incremental state records the output file, so wait for it.
+    waitForOutputs();
+    if (!errorCount())
+      writeIncrementalState(args);
+  }
+  if (importLibrary.valid())
+    importLibrary.get();
 
   // Stop early so we can print the results.
-  Timer::root().stop();
+  t.stop();
   if (config->showTiming)
     Timer::root().print();
+  if (!config->timeJsonFile.empty())
+    writeTimersJSON(config->timeJsonFile);
+  if (arenaUsageEnabled)
+    printArenaUsage();
+
+  if (config->timeTraceEnabled) {
+    std::string path = config->timeTraceFile.empty()
+                           ? config->outputFile + ".time-trace"
+                           : config->timeTraceFile.str();
+    std::error_code ec;
+    raw_fd_ostream os(path, ec, sys::fs::OF_Text);
+    if (ec)
+      error("cannot open " + path + ": " + ec.message());
+    else
+      timeTraceProfilerWrite(os);
+    timeTraceProfilerCleanup();
+  }
 }
 
 } // namespace coff
@@ -18,10 +18,11 @@
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Object/Archive.h"
 #include "llvm/Object/COFF.h"
+#include "llvm/Object/WindowsResource.h"
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/FileSystem.h"
-#include "llvm/Support/TarWriter.h"
+#include <future>
 #include <memory>
 #include <set>
 #include <vector>
@@ -36,6 +37,20 @@ using llvm::COFF::MachineTypes;
 using llvm::COFF::WindowsSubsystem;
 using llvm::Optional;
 
+// The resource tree that .res files and resource object files are merged
+// into. The .res files given on the command line are merged on a background
+// thread, so errors are recorded here rather than reported.
+struct ResourceTree {
+  explicit ResourceTree(bool mingw) : parser(mingw) {}
+
+  llvm::object::WindowsResourceParser parser;
+  std::vector<std::string> duplicates;
+  std::string error;
+
+  // The number of .res files that have been merged.
+  size_t numResFiles = 0;
+};
+
 class COFFOptTable : public llvm::opt::OptTable {
 public:
   COFFOptTable();
@@ -79,9 +94,9 @@ public:
 
   void enqueuePath(StringRef path, bool wholeArchive, bool lazy);
 
-private:
-  std::unique_ptr<llvm::TarWriter> tar; // for /linkrepro
+  std::unique_ptr<AsyncTarWriter> tar; // for /linkrepro
 
+private:
   // Opens a file. Path has to be resolved already.
   MemoryBufferRef openFile(StringRef path);
 
@@ -98,6 +113,9 @@ private:
   // Library search path. The first element is always "" (current directory).
   std::vector<StringRef> searchPaths;
 
+  // Start merging the .res files on a background thread.
+  void startResourceMerging();
+
   // Convert resource files and potentially merge input resource object
   // trees into one resource tree.
   void convertResources();
@@ -129,12 +147,23 @@ private:
   void addArchiveBuffer(MemoryBufferRef mbref, StringRef symName,
                         StringRef parentName, uint64_t offsetInArchive);
 
+  // Object and bitcode files are not added to the symbol table right away
+  // but batched, so that their section tables or module symbol tables can be
+  // read in parallel. addFile() adds any pending object files first to keep
+  // the order of files intact.
+  void addFile(InputFile *file);
+  void addObjFile(InputFile *file, StringRef symName);
+  void addPendingObjFiles();
+
   void enqueueTask(std::function<void()> task);
   bool run();
 
   std::list<std::function<void()>> taskQueue;
+  std::vector<std::pair<InputFile *, std::string>> pendingObjFiles;
   std::vector<StringRef> filePaths;
   std::vector<MemoryBufferRef> resources;
+  std::unique_ptr<ResourceTree> resourceTree;
+  std::future<void> resourceMerging;
 
   llvm::StringSet<> directivesExports;
 };
@@ -188,9 +217,13 @@ void assignExportOrdinals();
 // incompatible objects.
 void checkFailIfMismatch(StringRef arg, InputFile *source);
 
-// Convert Windows resource files (.res files) to a .obj file.
-MemoryBufferRef convertResToCOFF(ArrayRef<MemoryBufferRef> mbs,
-                                 ArrayRef<ObjFile *> objs);
+// Merge Windows resource files (.res files) into a resource tree. This is
+// thread-safe as long as the tree is not shared.
+void mergeResFiles(ResourceTree &tree, ArrayRef<MemoryBufferRef> mbs);
+
+// Convert a resource tree and the resource trees of resource object files to
+// a .obj file.
+MemoryBufferRef convertResToCOFF(ResourceTree &tree, ArrayRef<ObjFile *> objs);
 
 void runMSVCLinker(std::string rsp, ArrayRef<StringRef> objects);
 
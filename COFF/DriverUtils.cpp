@@ -17,6 +17,7 @@
 #include "Symbols.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/BinaryFormat/COFF.h"
@@ -662,11 +663,11 @@ void fixupExports() {
   }
   config->exports = std::move(v);
 
-  // Sort by name.
-  std::sort(config->exports.begin(), config->exports.end(),
-            [](const Export &a, const Export &b) {
-              return a.exportName < b.exportName;
-            });
+  // Sort by name. Export names are unique by now, so the sort does not need
+  // to be stable.
+  parallelSort(config->exports, [](const Export &a, const Export &b) {
+    return a.exportName < b.exportName;
+  });
 }
 
 void assignExportOrdinals() {
@@ -698,22 +699,35 @@ void checkFailIfMismatch(StringRef arg, InputFile *source) {
   config->mustMatch[k] = {v, source};
 }
 
-// Convert Windows resource files (.res files) to a .obj file.
-// Does what cvtres.exe does, but in-process and cross-platform.
-MemoryBufferRef convertResToCOFF(ArrayRef<MemoryBufferRef> mbs,
-                                 ArrayRef<ObjFile *> objs) {
-  object::WindowsResourceParser parser(/* MinGW */ config->mingw);
-
-  std::vector<std::string> duplicates;
+void mergeResFiles(ResourceTree &tree, ArrayRef<MemoryBufferRef> mbs) {
   for (MemoryBufferRef mb : mbs) {
-    std::unique_ptr<object::Binary> bin = check(object::createBinary(mb));
-    object::WindowsResource *rf = dyn_cast<object::WindowsResource>(bin.get());
-    if (!rf)
-      fatal("cannot compile non-resource file as resource");
+    if (!tree.error.empty())
+      return;
+    ++tree.numResFiles;
 
-    if (auto ec = parser.parse(rf, duplicates))
-      fatal(toString(std::move(ec)));
+    Expected<std::unique_ptr<object::Binary>> bin = object::createBinary(mb);
+    if (!bin) {
+      tree.error = toString(bin.takeError());
+      return;
+    }
+    auto *rf = dyn_cast<object::WindowsResource>(bin->get());
+    if (!rf) {
+      tree.error = "cannot compile non-resource file as resource";
+      return;
+    }
+    if (Error e = tree.parser.parse(rf, tree.duplicates))
+      tree.error = toString(std::move(e));
   }
+}
+
+// Convert Windows resource files (.res files) to a .obj file.
+// Does what cvtres.exe does, but in-process and cross-platform.
+MemoryBufferRef convertResToCOFF(ResourceTree &tree, ArrayRef<ObjFile *> objs) {
+  if (!tree.error.empty())
+    fatal(tree.error);
+
+  object::WindowsResourceParser &parser = tree.parser;
+  std::vector<std::string> &duplicates = tree.duplicates;
 
   // Note: This processes all .res files before all objs. Ideally they'd be
   // handled in the same order they were linked (to keep the right one, if
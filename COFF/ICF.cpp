@@ -23,6 +23,7 @@
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Threads.h"
 #include "lld/Common/Timer.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Parallel.h"
@@ -60,9 +61,28 @@ private:
 
   void forEachClass(std::function<void(size_t, size_t)> fn);
 
+  void forEachDependency(SectionChunk *sc, function_ref<void(uint32_t)> fn);
+  void computeUsers();
+  bool isDirty(size_t begin, size_t end);
+  void updateDirty();
+
   std::vector<SectionChunk *> chunks;
   int cnt = 0;
   std::atomic<bool> repeat = {false};
+
+  // Chunks are identified by their index in the original order of Chunks,
+  // since Chunks is reordered.
+  DenseMap<const SectionChunk *, uint32_t> ids;
+
+  // users[userBegin[i]] to users[userBegin[i + 1]] are the IDs of the chunks
+  // that refer to the chunk with ID i or that have it as a child, which need
+  // to be compared again if its class changes.
+  std::vector<uint32_t> userBegin;
+  std::vector<uint32_t> users;
+
+  // True for the chunks whose dependencies changed classes in the last
+  // iteration, indexed by ID.
+  std::vector<uint8_t> dirty;
 };
 
 // Returns true if section S is subject of ICF.
@@ -77,23 +97,35 @@ private:
 // section is insignificant to the user program and the behaviour matches that
 // of the Visual C++ linker.
 bool ICF::isEligible(SectionChunk *c) {
-  // Non-comdat chunks, dead chunks, and writable chunks are not eligible.
+  // Dead chunks and writable chunks are not eligible.
   bool writable = c->getOutputCharacteristics() & llvm::COFF::IMAGE_SCN_MEM_WRITE;
-  if (!c->isCOMDAT() || !c->live || writable)
+  if (!c->live || writable)
+    return false;
+
+  // Unwind info is only referenced from .pdata entries, so its address is
+  // insignificant, and identical .xdata sections can be folded even if they
+  // are not COMDAT. Compilers put the unwind info of all non-COMDAT functions
+  // of an object in one such section.
+  StringRef outSecName = c->getSectionName().split('$').first;
+  if (outSecName == ".xdata")
+    return true;
+
+  // Other non-comdat chunks are not eligible.
+  if (!c->isCOMDAT())
     return false;
 
   // Code sections are eligible.
   if (c->getOutputCharacteristics() & llvm::COFF::IMAGE_SCN_MEM_EXECUTE)
     return true;
 
-  // .pdata and .xdata unwind info sections are eligible.
-  StringRef outSecName = c->getSectionName().split('$').first;
-  if (outSecName == ".pdata" || outSecName == ".xdata")
+  // .pdata unwind info sections are eligible.
+  if (outSecName == ".pdata")
     return true;
 
   // So are vtables.
-  if (c->sym && c->sym->getName().startswith("??_7"))
-    return true;
+  if (DefinedRegular *sym = c->getComdatLeader())
+    if (sym->getName().startswith("??_7"))
+      return true;
 
   // Anything else not in an address-significance table is eligible.
   return !c->keepUnique;
@@ -125,17 +157,28 @@ void ICF::segregate(size_t begin, size_t end, bool constant) {
   }
 }
 
+// Returns true if an associative child is not compared by assocEquals.
+static bool isIgnoredChild(const SectionChunk &c) {
+  StringRef name = c.getSectionName();
+  return name.startswith(".debug") || name == ".gfids$y" || name == ".gljmp$y";
+}
+
 // Returns true if two sections' associative children are equal.
 bool ICF::assocEquals(const SectionChunk *a, const SectionChunk *b) {
-  auto childClasses = [&](const SectionChunk *sc) {
-    std::vector<uint32_t> classes;
-    for (const SectionChunk &c : sc->children())
-      if (!c.getSectionName().startswith(".debug") &&
-          c.getSectionName() != ".gfids$y" && c.getSectionName() != ".gljmp$y")
-        classes.push_back(c.eqClass[cnt % 2]);
-    return classes;
-  };
-  return childClasses(a) == childClasses(b);
+  auto ia = a->children().begin(), ea = a->children().end();
+  auto ib = b->children().begin(), eb = b->children().end();
+  for (;;) {
+    while (ia != ea && isIgnoredChild(*ia))
+      ++ia;
+    while (ib != eb && isIgnoredChild(*ib))
+      ++ib;
+    if (ia == ea || ib == eb)
+      return ia == ea && ib == eb;
+    if ((*ia).eqClass[cnt % 2] != (*ib).eqClass[cnt % 2])
+      return false;
+    ++ia;
+    ++ib;
+  }
 }
 
 // Compare "non-moving" part of two sections, namely everything
@@ -237,6 +280,68 @@ void ICF::forEachClass(std::function<void(size_t, size_t)> fn) {
   ++cnt;
 }
 
+// Calls Fn with the ID of each chunk whose class is compared when SC is
+// compared with other chunks. Chunks that are not eligible for ICF are
+// skipped because their classes never change.
+void ICF::forEachDependency(SectionChunk *sc,
+                            function_ref<void(uint32_t)> fn) {
+  for (Symbol *b : sc->symbols()) {
+    if (auto *sym = dyn_cast_or_null<DefinedRegular>(b)) {
+      auto it = ids.find(sym->getChunk());
+      if (it != ids.end())
+        fn(it->second);
+    }
+  }
+  for (const SectionChunk &c : sc->children()) {
+    if (isIgnoredChild(c))
+      continue;
+    auto it = ids.find(&c);
+    if (it != ids.end())
+      fn(it->second);
+  }
+}
+
+// Computes the reverse of the dependency graph, so that updateDirty can
+// find the chunks affected by a class change.
+void ICF::computeUsers() {
+  for (uint32_t i = 0, e = chunks.size(); i != e; ++i)
+    ids[chunks[i]] = i;
+
+  userBegin.assign(chunks.size() + 1, 0);
+  for (SectionChunk *sc : chunks)
+    forEachDependency(sc, [&](uint32_t dep) { ++userBegin[dep + 1]; });
+  for (size_t i = 1; i < userBegin.size(); ++i)
+    userBegin[i] += userBegin[i - 1];
+
+  users.resize(userBegin.back());
+  std::vector<uint32_t> pos(userBegin.begin(), userBegin.end() - 1);
+  for (uint32_t i = 0, e = chunks.size(); i != e; ++i)
+    forEachDependency(chunks[i], [&](uint32_t dep) { users[pos[dep]++] = i; });
+}
+
+// Returns true if the class [Begin, End) may be split by the next
+// iteration. If no chunk that its members depend on changed classes in the
+// last iteration, comparing the members again would give the same result.
+bool ICF::isDirty(size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i)
+    if (dirty[ids.lookup(chunks[i])])
+      return true;
+  return false;
+}
+
+void ICF::updateDirty() {
+  std::fill(dirty.begin(), dirty.end(), 0);
+  if (!repeat)
+    return;
+  for (SectionChunk *sc : chunks) {
+    if (sc->eqClass[0] == sc->eqClass[1])
+      continue;
+    uint32_t id = ids.lookup(sc);
+    for (uint32_t i = userBegin[id], e = userBegin[id + 1]; i != e; ++i)
+      dirty[users[i]] = 1;
+  }
+}
+
 // Merge identical COMDAT sections.
 // Two sections are considered the same if their section headers,
 // contents and relocations are all the same.
@@ -261,19 +366,28 @@ void ICF::run(ArrayRef<Chunk *> vec) {
       for (SectionChunk *sc : mc->sections)
         sc->eqClass[0] = nextId++;
 
-  // Initially, we use hash values to partition sections.
+  computeUsers();
+
+  // Initially, we use hash values to partition sections. Everything that
+  // equalsConstant compares cheaply is hashed too, to make the initial
+  // classes smaller.
   parallelForEach(chunks, [&](SectionChunk *sc) {
-    sc->eqClass[0] = xxHash64(sc->getContents());
+    sc->eqClass[0] =
+        hash_combine(sc->relocsSize, sc->getOutputCharacteristics(),
+                     xxHash64(sc->getContents()));
   });
 
-  // Combine the hashes of the sections referenced by each section into its
-  // hash.
+  // Combine the hashes of the sections referenced by each section and of its
+  // associative children into its hash.
   for (unsigned cnt = 0; cnt != 2; ++cnt) {
     parallelForEach(chunks, [&](SectionChunk *sc) {
       uint32_t hash = sc->eqClass[cnt % 2];
       for (Symbol *b : sc->symbols())
         if (auto *sym = dyn_cast_or_null<DefinedRegular>(b))
           hash += sym->getChunk()->eqClass[cnt % 2];
+      for (const SectionChunk &c : sc->children())
+        if (!isIgnoredChild(c))
+          hash = hash * 31 + c.eqClass[cnt % 2];
       // Set MSB to 1 to avoid collisions with non-hash classes.
       sc->eqClass[(cnt + 1) % 2] = hash | (1U << 31);
     });
@@ -289,10 +403,22 @@ void ICF::run(ArrayRef<Chunk *> vec) {
   forEachClass([&](size_t begin, size_t end) { segregate(begin, end, true); });
 
   // Split groups by comparing relocations until convergence is obtained.
+  // All classes are compared in the first iteration because the constant
+  // comparison assigned new IDs to all of them. After that, only the classes
+  // that depend on a chunk whose class changed need to be compared again.
+  // The others keep their classes.
+  dirty.assign(chunks.size(), 1);
   do {
     repeat = false;
-    forEachClass(
-        [&](size_t begin, size_t end) { segregate(begin, end, false); });
+    forEachClass([&](size_t begin, size_t end) {
+      if (isDirty(begin, end)) {
+        segregate(begin, end, false);
+        return;
+      }
+      for (size_t i = begin; i < end; ++i)
+        chunks[i]->eqClass[(cnt + 1) % 2] = chunks[i]->eqClass[cnt % 2];
+    });
+    updateDirty();
   } while (repeat);
 
   log("ICF needed " + Twine(cnt) + " iterations");
@@ -0,0 +1,1319 @@
+//===- Incremental.cpp ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements incremental relinking for /incremental.
+//
+// In a typical edit-compile-link cycle only a few object files change between
+// two links, and usually only the contents of their functions change. With an
+// explicit /incremental, a full link writes <output>.ilk, which records where
+// the sections of each object file ended up in the image and what their
+// symbols resolved to, and leaves some room after each code section and after
+// the base relocation table so that they can grow. The next link with the
+// same command line compares the inputs against the state file, and if only
+// object files changed, and only in ways that do not affect the layout of the
+// image or the rest of the link, copies the new section contents over the old
+// ones, applies their relocations and updates the exception table and the
+// base relocations that they affect.
+//
+// Anything else makes the linker fall back to a full link, which writes a new
+// state file. This includes added or removed symbols and sections, external
+// symbols that move, sections that outgrow their room, and relocations that
+// refer to discarded or undefined symbols. The output of an incremental link
+// is not the same as that of a full link; it is only equivalent to it.
+//
+// Only x64 images linked without /debug are supported.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Incremental.h"
+#include "Chunks.h"
+#include "Config.h"
+#include "Driver.h"
+#include "InputFiles.h"
+#include "Symbols.h"
+#include "Writer.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
+#include "lld/Common/Version.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/BinaryFormat/Magic.h"
+#include "llvm/Object/COFF.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/xxhash.h"
+#include "llvm/Support/raw_ostream.h"
+#include <array>
+
+using namespace llvm;
+using namespace llvm::COFF;
+using namespace llvm::object;
+using namespace llvm::support;
+using namespace llvm::support::endian;
+
+namespace lld {
+namespace coff {
+
+std::vector<std::pair<std::string, MemoryBufferRef>> incrementalInputs;
+
+// True if the current link may write a state file, in which case code
+// sections and the base relocation table are followed by some room to grow.
+static bool slackEnabled = false;
+
+namespace {
+const char stateMagic[] = "LLDILK01";
+
+// The state file is a sequence of little-endian integers and length-prefixed
+// strings.
+class StateWriter {
+public:
+  void u8(uint8_t v) { buf.push_back(v); }
+
+  void u32(uint32_t v) {
+    char b[4];
+    write32le(b, v);
+    buf.append(b, 4);
+  }
+
+  void u64(uint64_t v) {
+    char b[8];
+    write64le(b, v);
+    buf.append(b, 8);
+  }
+
+  void str(StringRef s) {
+    u64(s.size());
+    buf.append(s.begin(), s.end());
+  }
+
+  std::string buf;
+};
+
+// Reads what StateWriter wrote. Reading past the end returns zeros and makes
+// ok() return false.
+class StateReader {
+public:
+  explicit StateReader(StringRef data) : data(data) {}
+
+  uint8_t u8() {
+    const uint8_t *p = take(1);
+    return p ? *p : 0;
+  }
+
+  uint32_t u32() {
+    const uint8_t *p = take(4);
+    return p ? read32le(p) : 0;
+  }
+
+  uint64_t u64() {
+    const uint8_t *p = take(8);
+    return p ? read64le(p) : 0;
+  }
+
+  StringRef str() {
+    uint64_t size = u64();
+    const uint8_t *p = take(size);
+    return p ? StringRef(reinterpret_cast<const char *>(p), size) : "";
+  }
+
+  bool ok() const { return !failed; }
+  bool atEnd() const { return pos == data.size(); }
+
+private:
+  const uint8_t *take(uint64_t size) {
+    if (failed || size > data.size() - pos) {
+      failed = true;
+      return nullptr;
+    }
+    pos += size;
+    return reinterpret_cast<const uint8_t *>(data.data()) + pos - size;
+  }
+
+  StringRef data;
+  size_t pos = 0;
+  bool failed = false;
+};
+
+// How a section of an object file is handled when the file changes.
+enum SectionKind : uint8_t {
+  // Not part of the image, like .debug$S and discarded COMDAT sections.
+  Ignored,
+  // Must not change.
+  Fixed,
+  // A section that may change and grow up to its capacity.
+  Patch,
+  // A .pdata section, whose entries are sorted with those of the other
+  // files, so they are found by the function that they describe.
+  Pdata,
+};
+
+struct SectionState {
+  SectionKind kind = Ignored;
+  uint64_t hash = 0;
+
+  // For Patch sections.
+  uint64_t fileOff = 0;
+  uint32_t rva = 0;
+  uint32_t size = 0;
+  uint32_t capacity = 0;
+  bool hasData = false;
+  bool code = false;
+  // True if the base relocations of the section are in the image.
+  bool baserels = false;
+  uint64_t baserelHash = 0;
+
+  // For Pdata sections, the begin addresses of the entries.
+  std::vector<uint32_t> pdataBegins;
+};
+
+enum SymbolFlags : uint32_t {
+  DefinedHere = 1 << 0,
+  Absolute = 1 << 1,
+  // Undefined or discarded, so relocations against the symbol are skipped.
+  NoTarget = 1 << 2,
+  // The symbol is in an output section.
+  HasSection = 1 << 3,
+};
+
+// What a symbol of an object file resolved to.
+struct SymbolState {
+  uint32_t flags = 0;
+  uint32_t rva = 0;
+  uint32_t sectionIndex = 0;
+  uint32_t sectionRVA = 0;
+};
+
+// The state of a patchable object file.
+struct FileState {
+  void write(StateWriter &w) const;
+  bool read(StringRef data);
+
+  uint64_t fingerprint = 0;
+  std::vector<SectionState> sections;
+  std::vector<SymbolState> symbols;
+};
+
+// An input file of the link.
+struct InputState {
+  std::string path;
+  uint64_t size = 0;
+  uint64_t mtime = 0;
+  uint64_t hash = 0;
+  // The serialized FileState, or empty if the file is not patchable.
+  std::string block;
+};
+
+struct StateHeader {
+  uint64_t argsHash = 0;
+  uint64_t outputSize = 0;
+  uint64_t outputTime = 0;
+};
+
+// The parts of a COFF object file that the state refers to.
+struct RawObject {
+  explicit RawObject(MemoryBufferRef mb);
+
+  ArrayRef<uint8_t> getContents(size_t i) const;
+  ArrayRef<coff_relocation> getRelocs(size_t i) const;
+
+  std::unique_ptr<COFFObjectFile> obj;
+  // Section i + 1 of the file.
+  std::vector<const coff_section *> sections;
+  std::vector<StringRef> sectionNames;
+  // Indexed by symbol table index. Auxiliary records are None.
+  std::vector<Optional<COFFSymbolRef>> symbols;
+  std::vector<StringRef> symbolNames;
+};
+
+// The headers of the image being patched.
+struct ImageHeaders {
+  bool parse(MutableArrayRef<uint8_t> buf);
+  data_directory *getDir(uint32_t i);
+  MutableArrayRef<uint8_t> getSectionData(uint32_t rva);
+  uint8_t *getData(uint32_t rva, uint32_t size);
+
+  MutableArrayRef<uint8_t> buf;
+  coff_file_header *coff = nullptr;
+  pe32plus_header *pe = nullptr;
+  MutableArrayRef<data_directory> dirs;
+  MutableArrayRef<coff_section> sections;
+};
+} // namespace
+
+void FileState::write(StateWriter &w) const {
+  w.u64(fingerprint);
+  w.u64(sections.size());
+  for (const SectionState &s : sections) {
+    w.u8(s.kind);
+    switch (s.kind) {
+    case Ignored:
+      break;
+    case Fixed:
+      w.u64(s.hash);
+      break;
+    case Patch:
+      w.u64(s.fileOff);
+      w.u32(s.rva);
+      w.u32(s.size);
+      w.u32(s.capacity);
+      w.u8(s.hasData);
+      w.u8(s.code);
+      w.u8(s.baserels);
+      w.u64(s.baserelHash);
+      break;
+    case Pdata:
+      w.u64(s.pdataBegins.size());
+      for (uint32_t begin : s.pdataBegins)
+        w.u32(begin);
+      break;
+    }
+  }
+
+  w.u64(symbols.size());
+  for (const SymbolState &s : symbols) {
+    w.u32(s.flags);
+    w.u32(s.rva);
+    w.u32(s.sectionIndex);
+    w.u32(s.sectionRVA);
+  }
+}
+
+bool FileState::read(StringRef data) {
+  StateReader r(data);
+  fingerprint = r.u64();
+  sections.resize(std::min<uint64_t>(r.u64(), data.size()));
+  for (SectionState &s : sections) {
+    s.kind = SectionKind(r.u8());
+    switch (s.kind) {
+    case Ignored:
+      break;
+    case Fixed:
+      s.hash = r.u64();
+      break;
+    case Patch:
+      s.fileOff = r.u64();
+      s.rva = r.u32();
+      s.size = r.u32();
+      s.capacity = r.u32();
+      s.hasData = r.u8();
+      s.code = r.u8();
+      s.baserels = r.u8();
+      s.baserelHash = r.u64();
+      break;
+    case Pdata:
+      s.pdataBegins.resize(std::min<uint64_t>(r.u64(), data.size()));
+      for (uint32_t &begin : s.pdataBegins)
+        begin = r.u32();
+      break;
+    default:
+      return false;
+    }
+    if (!r.ok())
+      return false;
+  }
+
+  symbols.resize(std::min<uint64_t>(r.u64(), data.size()));
+  for (SymbolState &s : symbols) {
+    s.flags = r.u32();
+    s.rva = r.u32();
+    s.sectionIndex = r.u32();
+    s.sectionRVA = r.u32();
+  }
+  return r.ok() && r.atEnd();
+}
+
+RawObject::RawObject(MemoryBufferRef mb) {
+  auto prefix = [&] { return mb.getBufferIdentifier().str(); };
+  std::unique_ptr<Binary> bin = check2(createBinary(mb), prefix);
+  if (!isa<COFFObjectFile>(bin.get()))
+    fatal(mb.getBufferIdentifier() + " is not a COFF file");
+  obj.reset(cast<COFFObjectFile>(bin.release()));
+
+  for (uint32_t i = 1, e = obj->getNumberOfSections(); i <= e; ++i) {
+    const coff_section *sec;
+    if (std::error_code ec = obj->getSection(i, sec))
+      fatal(mb.getBufferIdentifier() + ": getSection failed: #" + Twine(i) +
+            ": " + ec.message());
+    sections.push_back(sec);
+    sectionNames.push_back(check2(obj->getSectionName(sec), prefix));
+  }
+
+  uint32_t numSymbols = obj->getNumberOfSymbols();
+  symbols.resize(numSymbols);
+  symbolNames.resize(numSymbols);
+  for (uint32_t i = 0; i < numSymbols; ++i) {
+    COFFSymbolRef sym = check2(obj->getSymbol(i), prefix);
+    obj->getSymbolName(sym, symbolNames[i]);
+    symbols[i] = sym;
+    i += sym.getNumberOfAuxSymbols();
+  }
+}
+
+ArrayRef<uint8_t> RawObject::getContents(size_t i) const {
+  ArrayRef<uint8_t> data;
+  cantFail(obj->getSectionContents(sections[i], data));
+  return data;
+}
+
+ArrayRef<coff_relocation> RawObject::getRelocs(size_t i) const {
+  return obj->getRelocations(sections[i]);
+}
+
+bool ImageHeaders::parse(MutableArrayRef<uint8_t> b) {
+  buf = b;
+  if (buf.size() < sizeof(dos_header))
+    return false;
+  uint64_t off =
+      reinterpret_cast<const dos_header *>(buf.data())->AddressOfNewExeHeader;
+  if (off + sizeof(PEMagic) + sizeof(coff_file_header) +
+          sizeof(pe32plus_header) >
+          buf.size() ||
+      memcmp(buf.data() + off, PEMagic, sizeof(PEMagic)) != 0)
+    return false;
+  off += sizeof(PEMagic);
+  coff = reinterpret_cast<coff_file_header *>(buf.data() + off);
+  off += sizeof(coff_file_header);
+  pe = reinterpret_cast<pe32plus_header *>(buf.data() + off);
+  if (pe->Magic != PE32Header::PE32_PLUS)
+    return false;
+
+  uint64_t dirsOff = off + sizeof(pe32plus_header);
+  uint64_t sectionsOff = off + coff->SizeOfOptionalHeader;
+  uint64_t numDirs = pe->NumberOfRvaAndSize;
+  if (dirsOff + numDirs * sizeof(data_directory) > sectionsOff ||
+      sectionsOff + coff->NumberOfSections * sizeof(coff_section) >
+          buf.size())
+    return false;
+  dirs = makeMutableArrayRef(
+      reinterpret_cast<data_directory *>(buf.data() + dirsOff), numDirs);
+  sections = makeMutableArrayRef(
+      reinterpret_cast<coff_section *>(buf.data() + sectionsOff),
+      coff->NumberOfSections);
+  return true;
+}
+
+data_directory *ImageHeaders::getDir(uint32_t i) {
+  if (i >= dirs.size() || dirs[i].RelativeVirtualAddress == 0)
+    return nullptr;
+  return &dirs[i];
+}
+
+// Returns the contents of the section that contains an RVA, from the RVA to
+// the end of the section.
+MutableArrayRef<uint8_t> ImageHeaders::getSectionData(uint32_t rva) {
+  for (coff_section &sec : sections) {
+    uint64_t size = std::min<uint32_t>(sec.VirtualSize, sec.SizeOfRawData);
+    if (rva < sec.VirtualAddress || rva >= sec.VirtualAddress + size ||
+        sec.PointerToRawData + size > buf.size())
+      continue;
+    uint32_t off = rva - sec.VirtualAddress;
+    return buf.slice(sec.PointerToRawData + off, size - off);
+  }
+  return {};
+}
+
+uint8_t *ImageHeaders::getData(uint32_t rva, uint32_t size) {
+  MutableArrayRef<uint8_t> data = getSectionData(rva);
+  return data.size() < size ? nullptr : data.data();
+}
+
+static void add16(uint8_t *p, int16_t v) { write16le(p, read16le(p) + v); }
+static void add32(uint8_t *p, int32_t v) { write32le(p, read32le(p) + v); }
+static void add64(uint8_t *p, int64_t v) { write64le(p, read64le(p) + v); }
+
+// Returns true if the value of a symbol may change without affecting
+// anything outside its file.
+static bool hasPatchableValue(COFFSymbolRef sym,
+                              ArrayRef<SectionState> sections) {
+  int32_t secNum = sym.getSectionNumber();
+  return sym.getStorageClass() == IMAGE_SYM_CLASS_STATIC && secNum > 0 &&
+         (size_t)secNum <= sections.size() &&
+         sections[secNum - 1].kind == Patch;
+}
+
+// Returns a hash of the parts of the section and symbol tables of an object
+// file that must stay the same for the file to be patched. The sizes of the
+// patchable sections and the values of the static symbols in them may change.
+static uint64_t getFingerprint(const RawObject &o,
+                               ArrayRef<SectionState> sections) {
+  StateWriter w;
+  w.u32(o.obj->getMachine());
+  for (size_t i = 0, e = o.sections.size(); i != e; ++i) {
+    const coff_section *sec = o.sections[i];
+    w.str(o.sectionNames[i]);
+    w.u32(sec->Characteristics);
+    if (sections[i].kind != Patch)
+      w.u32(sec->SizeOfRawData);
+  }
+
+  for (size_t i = 0, e = o.symbols.size(); i != e; ++i) {
+    if (!o.symbols[i])
+      continue;
+    COFFSymbolRef sym = *o.symbols[i];
+    w.str(o.symbolNames[i]);
+    w.u32(sym.getSectionNumber());
+    w.u8(sym.getStorageClass());
+    w.u32(sym.getType());
+    w.u8(sym.getNumberOfAuxSymbols());
+    if (!hasPatchableValue(sym, sections))
+      w.u32(sym.getValue());
+    if (const coff_aux_section_definition *def = sym.getSectionDefinition()) {
+      w.u32(def->getNumber(sym.isBigObj()));
+      w.u8(def->Selection);
+      if (def->Selection == IMAGE_COMDAT_SELECT_LARGEST)
+        w.u32(def->Length);
+    }
+    if (sym.isWeakExternal()) {
+      const coff_aux_weak_external *aux = sym.getAux<coff_aux_weak_external>();
+      w.u32(aux->TagIndex);
+      w.u32(aux->Characteristics);
+    }
+  }
+  return xxHash64(w.buf);
+}
+
+// Returns a hash of the contents and relocations of a section.
+static uint64_t getContentHash(const RawObject &o, size_t i) {
+  ArrayRef<coff_relocation> relocs = o.getRelocs(i);
+  StateWriter w;
+  w.u64(xxHash64(toStringRef(o.getContents(i))));
+  w.u64(xxHash64(StringRef(reinterpret_cast<const char *>(relocs.data()),
+                           relocs.size() * sizeof(coff_relocation))));
+  return xxHash64(w.buf);
+}
+
+// Returns the base relocations that SectionChunk::getBaserels() creates for
+// a section, relative to the start of the section.
+static std::vector<Baserel> getBaserels(ArrayRef<coff_relocation> relocs,
+                                        ArrayRef<SymbolState> symbols) {
+  std::vector<Baserel> v;
+  for (const coff_relocation &rel : relocs) {
+    if (rel.Type != IMAGE_REL_AMD64_ADDR64 ||
+        rel.SymbolTableIndex >= symbols.size())
+      continue;
+    if (symbols[rel.SymbolTableIndex].flags & (Absolute | NoTarget))
+      continue;
+    v.push_back({rel.VirtualAddress, IMAGE_REL_BASED_DIR64});
+  }
+  return v;
+}
+
+static uint64_t getBaserelHash(ArrayRef<Baserel> v) {
+  StateWriter w;
+  for (const Baserel &r : v) {
+    w.u32(r.rva);
+    w.u8(r.type);
+  }
+  return xxHash64(w.buf);
+}
+
+static uint64_t getArgsHash(opt::InputArgList &args) {
+  StateWriter w;
+  w.str(getLLDVersion());
+  for (opt::Arg *arg : args) {
+    // Skip the options that do not affect the output.
+    switch (arg->getOption().getID()) {
+    case OPT_errorlimit:
+    case OPT_threads:
+    case OPT_threads_no:
+    case OPT_show_timing:
+    case OPT_summary:
+    case OPT_verbose:
+      continue;
+    }
+    w.str(arg->getAsString(args));
+  }
+
+  // The LIB environment variable affects which libraries are found.
+  if (!args.hasArg(OPT_lldignoreenv))
+    if (Optional<std::string> env = sys::Process::GetEnv("LIB"))
+      w.str(*env);
+  return xxHash64(w.buf);
+}
+
+static bool getFileStatus(StringRef path, uint64_t &size, uint64_t &mtime) {
+  sys::fs::file_status st;
+  if (sys::fs::status(path, st))
+    return false;
+  size = st.getSize();
+  mtime = st.getLastModificationTime().time_since_epoch().count();
+  return true;
+}
+
+// The state is written to foo.ilk for foo.exe, like MSVC's link.exe does.
+static std::string getStatePath() {
+  SmallString<128> path(config->outputFile);
+  sys::path::replace_extension(path, ".ilk");
+  return path.str().str();
+}
+
+static bool readStateFile(MemoryBufferRef mb, StateHeader &hdr,
+                          std::vector<InputState> &inputs) {
+  StateReader r(mb.getBuffer());
+  if (r.str() != stateMagic)
+    return false;
+  hdr.argsHash = r.u64();
+  hdr.outputSize = r.u64();
+  hdr.outputTime = r.u64();
+
+  inputs.resize(std::min<uint64_t>(r.u64(), mb.getBufferSize()));
+  for (InputState &in : inputs) {
+    in.path = r.str();
+    in.size = r.u64();
+    in.mtime = r.u64();
+    in.hash = r.u64();
+    in.block = r.str();
+  }
+  return r.ok() && r.atEnd();
+}
+
+static void writeStateFile(const StateHeader &hdr,
+                           ArrayRef<InputState> inputs) {
+  StateWriter w;
+  w.str(stateMagic);
+  w.u64(hdr.argsHash);
+  w.u64(hdr.outputSize);
+  w.u64(hdr.outputTime);
+  w.u64(inputs.size());
+  for (const InputState &in : inputs) {
+    w.str(in.path);
+    w.u64(in.size);
+    w.u64(in.mtime);
+    w.u64(in.hash);
+    w.str(in.block);
+  }
+
+  // Write to a temporary file first so that a failed write does not leave a
+  // state file that does not match the output.
+  std::string path = getStatePath();
+  std::string tmp = path + ".tmp";
+  {
+    std::error_code ec;
+    raw_fd_ostream os(tmp, ec, sys::fs::OF_None);
+    if (ec) {
+      error("cannot open " + tmp + ": " + ec.message());
+      return;
+    }
+    os << w.buf;
+  }
+  if (std::error_code ec = sys::fs::rename(tmp, path))
+    error("cannot rename " + tmp + " to " + path + ": " + ec.message());
+}
+
+// Returns why the configuration of the link does not support incremental
+// relinking, or an empty string if it does.
+static std::string getUnsupportedReason(opt::InputArgList &args) {
+  if (config->machine != IMAGE_FILE_MACHINE_UNKNOWN &&
+      config->machine != AMD64)
+    return "only x64 is supported";
+  if (config->debug)
+    return "/debug is not supported";
+  if (config->mingw)
+    return "MinGW is not supported";
+  if (config->guardCF != GuardCFLevel::Off)
+    return "/guard:cf is not supported";
+  if (config->manifest == Configuration::Embed)
+    return "/manifest:embed is not supported";
+  if (!config->mapFile.empty())
+    return "/lldmap is not supported";
+  if (args.hasArg(OPT_linkrepro) || args.hasArg(OPT_reproduce))
+    return "/linkrepro and /reproduce are not supported";
+  if (config->outputFile.empty())
+    return "/out is required";
+  return "";
+}
+
+uint64_t getIncrementalSlack(const Chunk *c) {
+  if (!slackEnabled)
+    return 0;
+  auto *sc = dyn_cast<SectionChunk>(c);
+  if (!sc || !sc->file->parentName.empty() ||
+      !(sc->getOutputCharacteristics() & IMAGE_SCN_CNT_CODE))
+    return 0;
+  return std::max<uint64_t>(sc->getSize() / 4, 16);
+}
+
+uint64_t getIncrementalBaserelSlack(uint64_t size) {
+  if (!slackEnabled || size == 0)
+    return 0;
+  return std::max<uint64_t>(size / 4, pageSize);
+}
+
+namespace {
+// Patches the previous output.
+class Relinker {
+public:
+  explicit Relinker(opt::InputArgList &args) : args(args) {}
+
+  // Returns false with the reason set if a full link is needed.
+  bool run();
+
+  std::string reason;
+
+private:
+  bool fail(const Twine &msg) {
+    reason = msg.str();
+    return false;
+  }
+
+  bool findChangedInputs(
+      std::vector<std::pair<size_t, MemoryBufferRef>> &changed);
+
+  bool patchFile(InputState &in, MemoryBufferRef mb);
+  bool patchSection(size_t i);
+  bool patchPdata(size_t i);
+  void patchSymbols();
+  bool updateExceptionTable();
+  bool updateBaserels();
+  void updateTimestamps();
+  uint64_t getSymbolRVA(uint32_t symIndex);
+  bool hasMoved(uint32_t symIndex);
+  bool relocate(const coff_relocation &rel, uint8_t *loc, uint64_t p);
+
+  opt::InputArgList &args;
+  StateHeader hdr;
+  std::vector<InputState> inputs;
+  std::vector<std::unique_ptr<MemoryBuffer>> buffers;
+  uint8_t *out = nullptr;
+  ImageHeaders image;
+
+  // The .pdata entries to replace, by the begin address of the old entry.
+  std::vector<std::pair<uint32_t, std::array<uint8_t, 12>>> pdataUpdates;
+
+  // The ranges of the image whose base relocations changed, and their new
+  // base relocations.
+  std::vector<std::pair<uint32_t, uint32_t>> baserelRanges;
+  std::vector<Baserel> newBaserels;
+
+  // The file being patched.
+  StringRef path;
+  FileState *file = nullptr;
+  RawObject *obj = nullptr;
+};
+} // namespace
+
+// Finds the inputs that changed since the previous link. This runs before
+// the driver reads any input, so the files are read here.
+bool Relinker::findChangedInputs(
+    std::vector<std::pair<size_t, MemoryBufferRef>> &changed) {
+  for (size_t i = 0, e = inputs.size(); i != e; ++i) {
+    InputState &in = inputs[i];
+    uint64_t size, mtime;
+    if (!getFileStatus(in.path, size, mtime))
+      return fail("cannot stat " + in.path);
+    if (size == in.size && mtime == in.mtime)
+      continue;
+
+    auto mbOrErr = MemoryBuffer::getFile(in.path, -1, false);
+    if (!mbOrErr)
+      return fail("cannot read " + in.path);
+    buffers.push_back(std::move(*mbOrErr));
+    MemoryBufferRef mb = buffers.back()->getMemBufferRef();
+
+    in.size = size;
+    in.mtime = mtime;
+    uint64_t hash = xxHash64(mb.getBuffer());
+    if (hash == in.hash)
+      continue;
+    if (in.block.empty())
+      return fail(in.path + " changed and cannot be patched");
+    in.hash = hash;
+    changed.push_back({i, mb});
+  }
+  return true;
+}
+
+bool Relinker::run() {
+  std::string statePath = getStatePath();
+  auto mbOrErr = MemoryBuffer::getFile(statePath, -1, false);
+  if (!mbOrErr)
+    return fail("no state from a previous link");
+  std::unique_ptr<MemoryBuffer> stateBuf = std::move(*mbOrErr);
+  if (!readStateFile(stateBuf->getMemBufferRef(), hdr, inputs))
+    return fail(statePath + " is corrupted");
+  if (hdr.argsHash != getArgsHash(args))
+    return fail("the command line changed");
+
+  uint64_t size, mtime;
+  if (!getFileStatus(config->outputFile, size, mtime) ||
+      size != hdr.outputSize || mtime != hdr.outputTime)
+    return fail(config->outputFile + " was changed by another program");
+
+  std::vector<std::pair<size_t, MemoryBufferRef>> changed;
+  if (!findChangedInputs(changed))
+    return false;
+
+  if (changed.empty()) {
+    // Touch the output so that build systems see that it is up to date.
+    int fd;
+    if (std::error_code ec = sys::fs::openFileForReadWrite(
+            config->outputFile, fd, sys::fs::CD_OpenExisting,
+            sys::fs::OF_None))
+      return fail("cannot open " + config->outputFile + ": " + ec.message());
+    std::error_code ec = sys::fs::setLastAccessAndModificationTime(
+        fd, std::chrono::system_clock::now());
+    sys::Process::SafelyCloseFileDescriptor(fd);
+    if (ec)
+      return fail("cannot touch " + config->outputFile + ": " + ec.message());
+    log("incremental: output is up to date");
+  } else {
+    auto oldOrErr = MemoryBuffer::getFile(config->outputFile, -1, false);
+    if (!oldOrErr)
+      return fail("cannot read " + config->outputFile);
+    if ((*oldOrErr)->getBufferSize() != hdr.outputSize)
+      return fail(config->outputFile + " was changed by another program");
+
+    Expected<std::unique_ptr<FileOutputBuffer>> bufferOrErr =
+        FileOutputBuffer::create(config->outputFile, hdr.outputSize,
+                                 FileOutputBuffer::F_executable);
+    if (!bufferOrErr) {
+      error("failed to open " + config->outputFile + ": " +
+            llvm::toString(bufferOrErr.takeError()));
+      return true;
+    }
+    std::unique_ptr<FileOutputBuffer> buffer = std::move(*bufferOrErr);
+    out = buffer->getBufferStart();
+    memcpy(out, (*oldOrErr)->getBufferStart(), hdr.outputSize);
+    // Windows cannot replace a file that is mapped.
+    oldOrErr->reset();
+
+    if (!image.parse({out, size_t(hdr.outputSize)}))
+      return fail(config->outputFile + " is not a PE32+ image");
+    if (image.coff->Machine != AMD64)
+      return fail("only x64 is supported");
+
+    for (std::pair<size_t, MemoryBufferRef> &p : changed)
+      if (!patchFile(inputs[p.first], p.second))
+        return false;
+    if (!updateExceptionTable() || !updateBaserels())
+      return false;
+    updateTimestamps();
+
+    if (errorCount())
+      return true;
+    if (Error e = buffer->commit()) {
+      error("failed to write the output file: " + toString(std::move(e)));
+      return true;
+    }
+    for (std::pair<size_t, MemoryBufferRef> &p : changed)
+      log("incremental: patched " + inputs[p.first].path);
+  }
+
+  if (!getFileStatus(config->outputFile, hdr.outputSize, hdr.outputTime))
+    error("cannot stat " + config->outputFile);
+  else
+    writeStateFile(hdr, inputs);
+  return true;
+}
+
+bool Relinker::patchFile(InputState &in, MemoryBufferRef mb) {
+  FileState state;
+  if (!state.read(in.block))
+    return fail(getStatePath() + " is corrupted");
+  if (identify_magic(mb.getBuffer()) != file_magic::coff_object)
+    return fail(in.path + " is not a COFF object file");
+
+  RawObject raw(mb);
+  path = in.path;
+  file = &state;
+  obj = &raw;
+
+  if (raw.sections.size() != state.sections.size() ||
+      raw.symbols.size() != state.symbols.size() ||
+      getFingerprint(raw, state.sections) != state.fingerprint)
+    return fail(path + ": the section or symbol table changed");
+
+  for (size_t i = 0, e = raw.sections.size(); i != e; ++i)
+    if (!patchSection(i))
+      return false;
+  patchSymbols();
+
+  StateWriter w;
+  state.write(w);
+  in.block = std::move(w.buf);
+  return true;
+}
+
+bool Relinker::patchSection(size_t i) {
+  SectionState &sec = file->sections[i];
+  StringRef name = obj->sectionNames[i];
+
+  switch (sec.kind) {
+  case Ignored:
+    return true;
+  case Pdata:
+    return patchPdata(i);
+  case Fixed:
+    if (getContentHash(*obj, i) != sec.hash)
+      return fail(path + ": " + name + " changed");
+
+    // The section is not rewritten, so what it refers to must not move.
+    for (const coff_relocation &rel : obj->getRelocs(i))
+      if (hasMoved(rel.SymbolTableIndex))
+        return fail(path + ": " + name + " refers to a symbol that moved");
+    return true;
+  case Patch:
+    break;
+  }
+
+  uint32_t size = obj->sections[i]->SizeOfRawData;
+  if (size > sec.capacity)
+    return fail(path + ": " + name + " grew too much");
+  sec.size = size;
+  if (!sec.hasData)
+    return true;
+
+  uint8_t *buf = out + sec.fileOff;
+  ArrayRef<uint8_t> data = obj->getContents(i);
+  if (data.size() != size)
+    return fail(path + ": " + name + " has no contents");
+  memcpy(buf, data.data(), size);
+  memset(buf + size, sec.code ? 0xCC : 0, sec.capacity - size);
+
+  ArrayRef<coff_relocation> relocs = obj->getRelocs(i);
+  for (const coff_relocation &rel : relocs) {
+    if (rel.VirtualAddress >= size)
+      return fail(path + ": " + name + " has a relocation out of bounds");
+    if (!relocate(rel, buf + rel.VirtualAddress, sec.rva + rel.VirtualAddress))
+      return false;
+  }
+
+  if (!sec.baserels)
+    return true;
+  std::vector<Baserel> v = getBaserels(relocs, file->symbols);
+  uint64_t hash = getBaserelHash(v);
+  if (hash == sec.baserelHash)
+    return true;
+  sec.baserelHash = hash;
+  baserelRanges.push_back({sec.rva, sec.rva + sec.capacity});
+  for (Baserel &r : v)
+    newBaserels.push_back({sec.rva + r.rva, r.type});
+  return true;
+}
+
+// .pdata sections are sorted by Writer::sortExceptionTable(), so the entries
+// of a file are not where the file put them. Each of them is replaced in
+// updateExceptionTable() by the function that it used to describe.
+bool Relinker::patchPdata(size_t i) {
+  SectionState &sec = file->sections[i];
+  ArrayRef<uint8_t> data = obj->getContents(i);
+  if (data.size() != sec.pdataBegins.size() * 12)
+    return fail(path + ": .pdata changed");
+
+  std::vector<uint8_t> buf(data.begin(), data.end());
+  for (const coff_relocation &rel : obj->getRelocs(i)) {
+    if (rel.Type != IMAGE_REL_AMD64_ADDR32NB ||
+        uint64_t(rel.VirtualAddress) + 4 > buf.size())
+      return fail(path + ": unsupported .pdata relocation");
+    if (!relocate(rel, buf.data() + rel.VirtualAddress, 0))
+      return false;
+  }
+
+  for (size_t j = 0, e = sec.pdataBegins.size(); j != e; ++j) {
+    std::array<uint8_t, 12> entry;
+    memcpy(entry.data(), buf.data() + j * 12, 12);
+    pdataUpdates.push_back({sec.pdataBegins[j], entry});
+    sec.pdataBegins[j] = read32le(entry.data());
+  }
+  return true;
+}
+
+// Updates the addresses of the symbols that moved within their sections.
+void Relinker::patchSymbols() {
+  for (size_t i = 0, e = obj->symbols.size(); i != e; ++i)
+    if (obj->symbols[i] && hasMoved(i))
+      file->symbols[i].rva = getSymbolRVA(i);
+}
+
+bool Relinker::updateExceptionTable() {
+  if (pdataUpdates.empty())
+    return true;
+  data_directory *dir = image.getDir(EXCEPTION_TABLE);
+  uint8_t *buf = dir ? image.getData(dir->RelativeVirtualAddress, dir->Size)
+                     : nullptr;
+  if (!buf)
+    return fail("the output has no exception table");
+
+  struct Entry {
+    ulittle32_t begin, end, unwind;
+  };
+  MutableArrayRef<Entry> table(reinterpret_cast<Entry *>(buf),
+                               dir->Size / sizeof(Entry));
+
+  // Find all the entries before replacing any, since the table must stay
+  // sorted for the search.
+  std::vector<Entry *> slots;
+  for (std::pair<uint32_t, std::array<uint8_t, 12>> &p : pdataUpdates) {
+    Entry *it = partition_point(
+        table, [&](const Entry &e) { return e.begin < p.first; });
+    if (it == table.end() || it->begin != p.first)
+      return fail("the exception table has no entry for 0x" +
+                  Twine::utohexstr(p.first));
+    slots.push_back(it);
+  }
+  for (size_t i = 0, e = slots.size(); i != e; ++i)
+    memcpy(slots[i], pdataUpdates[i].second.data(), sizeof(Entry));
+
+  parallelSort(table, [](const Entry &a, const Entry &b) {
+    return a.begin < b.begin;
+  });
+  return true;
+}
+
+// Rewrites the base relocation table with the base relocations of the
+// patched sections, in the format of BaserelChunk.
+bool Relinker::updateBaserels() {
+  if (baserelRanges.empty())
+    return true;
+  data_directory *dir = image.getDir(BASE_RELOCATION_TABLE);
+  if (!dir)
+    return fail("the output has no base relocation table");
+  MutableArrayRef<uint8_t> buf =
+      image.getSectionData(dir->RelativeVirtualAddress);
+  if (buf.size() < dir->Size)
+    return fail("the base relocation table is corrupted");
+
+  llvm::sort(baserelRanges);
+  auto isPatched = [&](uint32_t rva) {
+    auto it = partition_point(baserelRanges,
+                              [=](const std::pair<uint32_t, uint32_t> &r) {
+                                return r.first <= rva;
+                              });
+    return it != baserelRanges.begin() && rva < std::prev(it)->second;
+  };
+
+  std::vector<Baserel> v;
+  for (uint32_t off = 0; off + 8 <= dir->Size;) {
+    uint32_t page = read32le(buf.data() + off);
+    uint32_t blockSize = read32le(buf.data() + off + 4);
+    if (blockSize < 8 || off + blockSize > dir->Size)
+      return fail("the base relocation table is corrupted");
+    for (uint32_t j = off + 8; j + 2 <= off + blockSize; j += 2) {
+      uint16_t e = read16le(buf.data() + j);
+      uint32_t rva = page + (e & 0xfff);
+      if ((e >> 12) != IMAGE_REL_BASED_ABSOLUTE && !isPatched(rva))
+        v.push_back({rva, uint8_t(e >> 12)});
+    }
+    off += blockSize;
+  }
+  v.insert(v.end(), newBaserels.begin(), newBaserels.end());
+  llvm::sort(v,
+             [](const Baserel &a, const Baserel &b) { return a.rva < b.rva; });
+
+  // Group the addresses by page. The last entry of a block may be padding.
+  std::vector<uint8_t> data;
+  const uint32_t mask = ~uint32_t(pageSize - 1);
+  for (size_t i = 0, e = v.size(); i != e;) {
+    uint32_t page = v[i].rva & mask;
+    size_t j = i;
+    while (j != e && (v[j].rva & mask) == page)
+      ++j;
+    size_t blockOff = data.size();
+    data.resize(blockOff + alignTo((j - i) * 2 + 8, 4));
+    uint8_t *p = data.data() + blockOff;
+    write32le(p, page);
+    write32le(p + 4, data.size() - blockOff);
+    p += 8;
+    for (; i != j; ++i) {
+      write16le(p, (v[i].type << 12) | (v[i].rva - page));
+      p += 2;
+    }
+  }
+
+  if (data.size() > buf.size())
+    return fail("the base relocation table outgrew its room");
+  memcpy(buf.data(), data.data(), data.size());
+  memset(buf.data() + data.size(), 0, buf.size() - data.size());
+  dir->Size = data.size();
+  return true;
+}
+
+// Sets the timestamps the way Writer::writeBuildId() does.
+void Relinker::updateTimestamps() {
+  MutableArrayRef<debug_directory> debugDirs;
+  if (data_directory *dir = image.getDir(DEBUG_DIRECTORY))
+    if (uint8_t *buf = image.getData(dir->RelativeVirtualAddress, dir->Size))
+      debugDirs = makeMutableArrayRef(reinterpret_cast<debug_directory *>(buf),
+                                      dir->Size / sizeof(debug_directory));
+
+  uint32_t timestamp = config->timestamp;
+  if (config->repro) {
+    image.coff->TimeDateStamp = 0;
+    for (debug_directory &d : debugDirs)
+      d.TimeDateStamp = 0;
+    timestamp = xxHash64(toStringRef(image.buf));
+  }
+  image.coff->TimeDateStamp = timestamp;
+  for (debug_directory &d : debugDirs)
+    d.TimeDateStamp = timestamp;
+}
+
+// Returns true if a symbol defined by the patched file has a new address.
+bool Relinker::hasMoved(uint32_t symIndex) {
+  if (symIndex >= obj->symbols.size() || !obj->symbols[symIndex] ||
+      !(file->symbols[symIndex].flags & DefinedHere))
+    return false;
+  return getSymbolRVA(symIndex) != file->symbols[symIndex].rva;
+}
+
+// Computes the address of a symbol of the patched file.
+uint64_t Relinker::getSymbolRVA(uint32_t symIndex) {
+  const SymbolState &s = file->symbols[symIndex];
+  if (!(s.flags & DefinedHere))
+    return s.rva;
+  COFFSymbolRef sym = *obj->symbols[symIndex];
+  int32_t secNum = sym.getSectionNumber();
+  if (secNum <= 0 || (size_t)secNum > file->sections.size() ||
+      file->sections[secNum - 1].kind != Patch)
+    return s.rva;
+  return file->sections[secNum - 1].rva + sym.getValue();
+}
+
+// Applies a relocation the way SectionChunk::applyRelX64() does.
+bool Relinker::relocate(const coff_relocation &rel, uint8_t *loc,
+                        uint64_t p) {
+  uint32_t symIndex = rel.SymbolTableIndex;
+  if (symIndex >= obj->symbols.size() || !obj->symbols[symIndex])
+    return fail(path + ": invalid symbol index " + Twine(symIndex));
+  const SymbolState &sym = file->symbols[symIndex];
+  if (sym.flags & NoTarget)
+    return fail(path + ": a relocation refers to " +
+                obj->symbolNames[symIndex] +
+                ", which is undefined or discarded");
+
+  uint64_t s = getSymbolRVA(symIndex);
+  uint64_t imageBase = image.pe->ImageBase;
+  switch (rel.Type) {
+  case IMAGE_REL_AMD64_ADDR32:   add32(loc, s + imageBase); break;
+  case IMAGE_REL_AMD64_ADDR64:   add64(loc, s + imageBase); break;
+  case IMAGE_REL_AMD64_ADDR32NB: add32(loc, s); break;
+  case IMAGE_REL_AMD64_REL32:    add32(loc, s - p - 4); break;
+  case IMAGE_REL_AMD64_REL32_1:  add32(loc, s - p - 5); break;
+  case IMAGE_REL_AMD64_REL32_2:  add32(loc, s - p - 6); break;
+  case IMAGE_REL_AMD64_REL32_3:  add32(loc, s - p - 7); break;
+  case IMAGE_REL_AMD64_REL32_4:  add32(loc, s - p - 8); break;
+  case IMAGE_REL_AMD64_REL32_5:  add32(loc, s - p - 9); break;
+  case IMAGE_REL_AMD64_SECTION:  add16(loc, sym.sectionIndex); break;
+  case IMAGE_REL_AMD64_SECREL:
+    if (!(sym.flags & HasSection) || s - sym.sectionRVA > UINT32_MAX)
+      return fail(path + ": unsupported SECREL relocation against " +
+                  obj->symbolNames[symIndex]);
+    add32(loc, s - sym.sectionRVA);
+    break;
+  default:
+    return fail(path + ": unsupported relocation type 0x" +
+                Twine::utohexstr(rel.Type));
+  }
+  return true;
+}
+
+bool linkIncrementally(opt::InputArgList &args) {
+  slackEnabled = false;
+  std::string reason = getUnsupportedReason(args);
+  if (!reason.empty()) {
+    // Build systems pass /incremental along with /debug by default, so this
+    // is not worth a warning.
+    log("incremental: " + reason + "; doing a full link");
+    return false;
+  }
+  slackEnabled = true;
+
+  Relinker relinker(args);
+  if (relinker.run())
+    return true;
+  if (!errorCount())
+    log("incremental: " + relinker.reason + "; doing a full link");
+  return false;
+}
+
+static SymbolState getSymbolState(Symbol *sym, const ObjFile *file) {
+  SymbolState s;
+  auto *d = dyn_cast_or_null<Defined>(sym);
+  if (!d) {
+    s.flags = NoTarget;
+    return s;
+  }
+
+  // See SectionChunk::writeTo().
+  Chunk *c = d->getChunk();
+  OutputSection *os = c ? c->getOutputSection() : nullptr;
+  if (!os && !isa<DefinedAbsolute>(d) && !isa<DefinedSynthetic>(d)) {
+    s.flags = NoTarget;
+    return s;
+  }
+
+  if (isa<DefinedAbsolute>(d))
+    s.flags |= Absolute;
+  if (auto *dc = dyn_cast<DefinedCOFF>(d))
+    if (dc->file == file)
+      s.flags |= DefinedHere;
+  s.rva = d->getRVA();
+  if (os) {
+    s.flags |= HasSection;
+    s.sectionIndex = os->sectionIndex;
+    s.sectionRVA = os->getRVA();
+  } else {
+    s.sectionIndex = DefinedAbsolute::numOutputSections + 1;
+  }
+  return s;
+}
+
+// Returns the begin addresses of the entries of a .pdata section, or None if
+// the section is not a plain function table.
+static Optional<std::vector<uint32_t>>
+getPdataBegins(const RawObject &raw, size_t i,
+               ArrayRef<SymbolState> symbols) {
+  std::vector<uint8_t> buf(raw.getContents(i).begin(),
+                           raw.getContents(i).end());
+  if (buf.size() % 12)
+    return None;
+  for (const coff_relocation &rel : raw.getRelocs(i)) {
+    if (rel.Type != IMAGE_REL_AMD64_ADDR32NB ||
+        uint64_t(rel.VirtualAddress) + 4 > buf.size() ||
+        rel.SymbolTableIndex >= symbols.size() ||
+        (symbols[rel.SymbolTableIndex].flags & NoTarget))
+      return None;
+    add32(buf.data() + rel.VirtualAddress,
+          symbols[rel.SymbolTableIndex].rva);
+  }
+
+  std::vector<uint32_t> v;
+  for (size_t j = 0, e = buf.size(); j != e; j += 12)
+    v.push_back(read32le(buf.data() + j));
+  return v;
+}
+
+static SectionState getSectionState(const RawObject &raw, size_t i,
+                                    SectionChunk *c,
+                                    ArrayRef<SymbolState> symbols) {
+  const coff_section *hdr = raw.sections[i];
+  StringRef name = raw.sectionNames[i];
+  SectionState s;
+
+  // See ObjFile::readSection().
+  if ((hdr->Characteristics & IMAGE_SCN_LNK_REMOVE) ||
+      name.startswith(".debug") || name == ".gfids$y" || name == ".gljmp$y" ||
+      name == ".sxdata" || name == ".llvm_addrsig")
+    return s;
+
+  // Discarded COMDAT sections do not matter, but other sections that are
+  // not chunks, like .drectve, are read by the linker.
+  if (!c && (hdr->Characteristics & IMAGE_SCN_LNK_COMDAT))
+    return s;
+  OutputSection *os = c ? c->getOutputSection() : nullptr;
+  if (!os || c->repl != c) {
+    s.kind = Fixed;
+    s.hash = getContentHash(raw, i);
+    return s;
+  }
+
+  if (os->name == ".pdata") {
+    if (Optional<std::vector<uint32_t>> begins =
+            getPdataBegins(raw, i, symbols)) {
+      s.kind = Pdata;
+      s.pdataBegins = std::move(*begins);
+    } else {
+      s.kind = Fixed;
+      s.hash = getContentHash(raw, i);
+    }
+    return s;
+  }
+
+  s.kind = Patch;
+  s.fileOff = os->getFileOff() + c->getRVA() - os->getRVA();
+  s.rva = c->getRVA();
+  s.size = c->getSize();
+  s.capacity = s.size + getIncrementalSlack(c);
+  s.hasData = c->hasData;
+  s.code = os->header.Characteristics & IMAGE_SCN_CNT_CODE;
+  s.baserels = config->relocatable &&
+               !(os->header.Characteristics & IMAGE_SCN_MEM_DISCARDABLE);
+  s.baserelHash = getBaserelHash(getBaserels(raw.getRelocs(i), symbols));
+  return s;
+}
+
+static std::string getFileBlock(ObjFile *f) {
+  RawObject raw(f->mb);
+  FileState state;
+  ArrayRef<Symbol *> syms = f->getSymbols();
+  for (size_t i = 0, e = raw.symbols.size(); i != e; ++i)
+    state.symbols.push_back(raw.symbols[i] ? getSymbolState(syms[i], f)
+                                           : SymbolState());
+
+  DenseMap<uint32_t, SectionChunk *> chunks;
+  for (Chunk *c : f->getChunks())
+    if (auto *sc = dyn_cast<SectionChunk>(c))
+      chunks[sc->getSectionNumber()] = sc;
+  for (size_t i = 0, e = raw.sections.size(); i != e; ++i)
+    state.sections.push_back(
+        getSectionState(raw, i, chunks.lookup(i + 1), state.symbols));
+  state.fingerprint = getFingerprint(raw, state.sections);
+
+  StateWriter w;
+  state.write(w);
+  return std::move(w.buf);
+}
+
+void writeIncrementalState(opt::InputArgList &args) {
+  std::string path = getStatePath();
+  std::string reason;
+  if (!slackEnabled)
+    reason = getUnsupportedReason(args);
+  else if (config->machine != AMD64)
+    reason = "only x64 is supported";
+  else if (!BitcodeFile::instances.empty())
+    reason = "LTO is not supported";
+  if (!reason.empty()) {
+    log("incremental: " + reason + "; not saving the link state");
+    sys::fs::remove(path);
+    return;
+  }
+
+  StateHeader hdr;
+  hdr.argsHash = getArgsHash(args);
+  if (!getFileStatus(config->outputFile, hdr.outputSize, hdr.outputTime)) {
+    error("cannot stat " + config->outputFile);
+    return;
+  }
+
+  // Object files that are not archive members can be patched.
+  StringMap<ObjFile *> patchable;
+  for (ObjFile *f : ObjFile::instances)
+    if (f->parentName.empty() && !f->isResourceObjFile())
+      patchable[f->getName()] = f;
+
+  // An input may be read more than once, like a library given twice.
+  std::vector<InputState> inputs;
+  std::vector<MemoryBufferRef> buffers;
+  StringSet<> seen;
+  for (std::pair<std::string, MemoryBufferRef> &p : incrementalInputs) {
+    if (!seen.insert(p.first).second)
+      continue;
+    InputState input;
+    input.path = p.first;
+    inputs.push_back(std::move(input));
+    buffers.push_back(p.second);
+  }
+
+  parallelForEachN(0, inputs.size(), [&](size_t i) {
+    InputState &input = inputs[i];
+    getFileStatus(input.path, input.size, input.mtime);
+    input.hash = xxHash64(buffers[i].getBuffer());
+    if (ObjFile *f = patchable.lookup(input.path))
+      input.block = getFileBlock(f);
+  });
+  writeStateFile(hdr, inputs);
+}
+
+} // namespace coff
+} // namespace lld
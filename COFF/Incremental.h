@@ -0,0 +1,47 @@
+//===- Incremental.h --------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_COFF_INCREMENTAL_H
+#define LLD_COFF_INCREMENTAL_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/Option/ArgList.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lld {
+namespace coff {
+class Chunk;
+
+// The files read by a link with /incremental, so that a later link can tell
+// whether they have changed.
+extern std::vector<std::pair<std::string, MemoryBufferRef>> incrementalInputs;
+
+// Returns the number of bytes to leave free after a chunk, so that the chunk
+// can grow when it is patched by a later link.
+uint64_t getIncrementalSlack(const Chunk *c);
+
+// Returns the number of bytes to leave free after the base relocation table
+// of the given size, so that a later link can add base relocations.
+uint64_t getIncrementalBaserelSlack(uint64_t size);
+
+// Tries to update the previous output by patching the object files that
+// changed since it was linked. Returns true if that was done, or if it
+// failed with an error, and false if a full link is needed.
+bool linkIncrementally(llvm::opt::InputArgList &args);
+
+// Writes the state that linkIncrementally() needs next to the output.
+void writeIncrementalState(llvm::opt::InputArgList &args);
+
+} // namespace coff
+} // namespace lld
+
+#endif
@@ -15,6 +15,7 @@
 #include "Symbols.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
 #include "llvm-c/lto.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Triple.h"
@@ -181,7 +182,7 @@ void LazyObjFile::parse() {
   }
 }
 
-void ObjFile::parse() {
+void ObjFile::initializeCOFFObj() {
   // Parse a memory buffer as a COFF file.
   std::unique_ptr<Binary> bin = CHECK(createBinary(mb), this);
 
@@ -191,9 +192,15 @@ void ObjFile::parse() {
   } else {
     fatal(toString(this) + " is not a COFF file");
   }
+}
 
-  // Read section and symbol tables.
-  initializeChunks();
+void ObjFile::parse() {
+  // Read section and symbol tables. preparseFiles() may have read the
+  // section table already.
+  if (!coffObj) {
+    initializeCOFFObj();
+    initializeChunks();
+  }
   initializeSymbols();
   initializeFlags();
   initializeDependencies();
@@ -216,6 +223,8 @@ static SectionChunk *const pendingComdat = reinterpret_cast<SectionChunk *>(1);
 
 void ObjFile::initializeChunks() {
   uint32_t numSections = coffObj->getNumberOfSections();
+  if (!chunkMem)
+    chunkMem = bAlloc.Allocate<SectionChunk>(numSections);
   chunks.reserve(numSections);
   sparseChunks.resize(numSections + 1);
   for (uint32_t i = 1; i < numSections + 1; ++i) {
@@ -251,6 +260,11 @@ SectionChunk *ObjFile::readSection(uint32_t sectionNumber,
     return nullptr;
   }
 
+  if (name == ".llvm.call-graph-profile") {
+    callgraphSec = sec;
+    return nullptr;
+  }
+
   // Object files may have DWARF debug info or MS CodeView debug info
   // (or both).
   //
@@ -267,7 +281,7 @@ SectionChunk *ObjFile::readSection(uint32_t sectionNumber,
 
   if (sec->Characteristics & llvm::COFF::IMAGE_SCN_LNK_REMOVE)
     return nullptr;
-  auto *c = make<SectionChunk>(this, sec);
+  auto *c = new (&chunkMem[sectionNumber - 1]) SectionChunk(this, sec);
   if (def)
     c->checksum = def->CheckSum;
 
@@ -295,6 +309,23 @@ SectionChunk *ObjFile::readSection(uint32_t sectionNumber,
   return c;
 }
 
+// Chunks placed in memory from bAlloc are never destroyed.
+static_assert(std::is_trivially_destructible<SectionChunk>::value,
+              "SectionChunk must be trivially destructible");
+
+void preparseFiles(ArrayRef<ObjFile *> files) {
+  parallelForEach(files, [](ObjFile *f) { f->initializeCOFFObj(); });
+
+  // Memory allocators are not thread-safe, so allocate the chunks here.
+  for (ObjFile *f : files)
+    f->chunkMem =
+        bAlloc.Allocate<SectionChunk>(f->coffObj->getNumberOfSections());
+
+  // Only non-COMDAT sections are read here. COMDAT sections are read when
+  // their leader symbols are resolved, which must be done in order.
+  parallelForEach(files, [](ObjFile *f) { f->initializeChunks(); });
+}
+
 void ObjFile::includeResourceChunks() {
   chunks.insert(chunks.end(), resourceChunks.begin(), resourceChunks.end());
 }
@@ -654,7 +685,9 @@ Optional<Symbol *> ObjFile::createDefined(
     if (prevailing) {
       SectionChunk *c = readSection(sectionNumber, def, getName());
       sparseChunks[sectionNumber] = c;
-      c->sym = cast<DefinedRegular>(leader);
+      if (comdatLeaders.empty())
+        comdatLeaders.resize(sparseChunks.size());
+      comdatLeaders[sectionNumber] = cast<DefinedRegular>(leader);
       c->selection = selection;
       cast<DefinedRegular>(leader)->data = &c->repl;
     } else {
@@ -789,16 +822,17 @@ void ObjFile::initializeDependencies() {
   debugTypesObj = makeTpiSource(this);
 }
 
+void ObjFile::initializeDwarf() {
+  if (!dwarf)
+    dwarf = make<DWARFCache>(DWARFContext::create(*getCOFFObj()));
+}
+
 // Used only for DWARF debug info, which is not common (except in MinGW
 // environments). This returns an optional pair of file name and line
 // number for where the variable was defined.
 Optional<std::pair<StringRef, uint32_t>>
 ObjFile::getVariableLocation(StringRef var) {
-  if (!dwarf) {
-    dwarf = make<DWARFCache>(DWARFContext::create(*getCOFFObj()));
-    if (!dwarf)
-      return None;
-  }
+  initializeDwarf();
   if (config->machine == I386)
     var.consume_front("_");
   Optional<std::pair<std::string, unsigned>> ret = dwarf->getVariableLoc(var);
@@ -811,11 +845,7 @@ ObjFile::getVariableLocation(StringRef var) {
 // environments).
 Optional<DILineInfo> ObjFile::getDILineInfo(uint32_t offset,
                                             uint32_t sectionIndex) {
-  if (!dwarf) {
-    dwarf = make<DWARFCache>(DWARFContext::create(*getCOFFObj()));
-    if (!dwarf)
-      return None;
-  }
+  initializeDwarf();
 
   return dwarf->getDILineInfo(offset, sectionIndex);
 }
@@ -890,15 +920,19 @@ BitcodeFile::BitcodeFile(MemoryBufferRef mb, StringRef archiveName,
   // into consideration at LTO time (which very likely causes undefined
   // symbols later in the link stage). So we append file offset to make
   // filename unique.
-  MemoryBufferRef mbref(
+  ltoBuffer = MemoryBufferRef(
       mb.getBuffer(),
       saver.save(archiveName + path +
                  (archiveName.empty() ? "" : utostr(offsetInArchive))));
+}
 
-  obj = check(lto::InputFile::create(mbref));
+void BitcodeFile::initializeObj() {
+  obj = check(lto::InputFile::create(ltoBuffer));
 }
 
 void BitcodeFile::parse() {
+  if (!obj)
+    initializeObj();
   std::vector<std::pair<Symbol *, bool>> comdat(obj->getComdatTable().size());
   for (size_t i = 0; i != obj->getComdatTable().size(); ++i)
     // FIXME: lto::InputFile doesn't keep enough data to do correct comdat
@@ -187,6 +187,8 @@ public:
 
   const coff_section *addrsigSec = nullptr;
 
+  const coff_section *callgraphSec = nullptr;
+
   // When using Microsoft precompiled headers, this is the PCH's key.
   // The same key is used by both the precompiled object, and objects using the
   // precompiled object. Any difference indicates out-of-date objects.
@@ -204,18 +206,30 @@ public:
   // The .debug$T stream if there's one.
   llvm::Optional<llvm::codeview::CVTypeArray> debugTypes;
 
+  // COMDAT leader symbols indexed by section number. They are rarely needed
+  // after symbol resolution, so they are stored here to keep SectionChunk
+  // small. Empty if this file has no prevailing COMDAT sections.
+  std::vector<DefinedRegular *> comdatLeaders;
+
   llvm::Optional<std::pair<StringRef, uint32_t>>
   getVariableLocation(StringRef var);
 
   llvm::Optional<llvm::DILineInfo> getDILineInfo(uint32_t offset,
                                                  uint32_t sectionIndex);
 
+  // Creates the DWARF context used by the two functions above. This is not
+  // thread-safe, so it must be called before they are used in parallel.
+  void initializeDwarf();
+
 private:
+  friend void preparseFiles(ArrayRef<ObjFile *> files);
+
   const coff_section* getSection(uint32_t i);
   const coff_section *getSection(COFFSymbolRef sym) {
     return getSection(sym.getSectionNumber());
   }
 
+  void initializeCOFFObj();
   void initializeChunks();
   void initializeSymbols();
   void initializeFlags();
@@ -288,6 +302,11 @@ private:
   // null pointer.)
   std::vector<SectionChunk *> sparseChunks;
 
+  // Storage for the SectionChunks of this file, indexed by section number
+  // minus one. Allocating them together keeps them close in memory, and
+  // lets preparseFiles() allocate them before creating them in parallel.
+  SectionChunk *chunkMem = nullptr;
+
   // This vector contains a list of all symbols defined or referenced by this
   // file. They are indexed such that you can get a Symbol by symbol
   // index. Nonexistent indices (which are occupied by auxiliary
@@ -319,6 +338,7 @@ public:
   StringRef externalName;
   const coff_import_header *hdr;
   Chunk *location = nullptr;
+  uint32_t locationOffset = 0;
 
   // We want to eliminate dllimported symbols if no one actually refers them.
   // These "Live" bits are used to keep track of which import library members
@@ -347,10 +367,18 @@ public:
   static std::vector<BitcodeFile *> instances;
   std::unique_ptr<llvm::lto::InputFile> obj;
 
+  // Reads the symbol table of the module. This is the expensive part of
+  // adding a bitcode file, and the driver calls it for a batch of files in
+  // parallel. parse() calls it if the driver has not.
+  void initializeObj();
+
 private:
   void parse() override;
 
   std::vector<Symbol *> symbols;
+
+  // The buffer under the unique name that LTO knows this file by.
+  MemoryBufferRef ltoBuffer;
 };
 
 inline bool isBitcode(MemoryBufferRef mb) {
@@ -358,6 +386,11 @@ inline bool isBitcode(MemoryBufferRef mb) {
 }
 
 std::string replaceThinLTOSuffix(StringRef path);
+
+// Decodes the section tables of the given object files and creates their
+// section chunks in parallel, so that ObjFile::parse() only needs to read
+// the symbol tables afterwards.
+void preparseFiles(ArrayRef<ObjFile *> files);
 } // namespace coff
 
 std::string toString(const coff::InputFile *file);
@@ -12,8 +12,11 @@
 #include "Symbols.h"
 #include "lld/Common/Args.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Filesystem.h"
+#include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/TargetOptionsCommandFlags.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
@@ -25,15 +28,19 @@
 #include "llvm/LTO/LTO.h"
 #include "llvm/Object/SymbolicFile.h"
 #include "llvm/Support/CodeGen.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Program.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <memory>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <vector>
 
 using namespace llvm;
@@ -101,6 +108,15 @@ BitcodeCompiler::BitcodeCompiler() {
     backend = lto::createWriteIndexesThinBackend(
         config->thinLTOPrefixReplace.first, config->thinLTOPrefixReplace.second,
         config->thinLTOEmitImportsFiles, indexFile.get(), OnIndexWrite);
+  } else if (!config->thinLTOBackendCommand.empty()) {
+    // The backends are run by the commands, which read the index files.
+    auto onIndexWrite = [&](const std::string &s) {
+      std::lock_guard<std::mutex> lock(backendModulesMutex);
+      backendModules.push_back(s);
+    };
+    backend = lto::createWriteIndexesThinBackend(
+        config->thinLTOPrefixReplace.first, config->thinLTOPrefixReplace.second,
+        config->thinLTOEmitImportsFiles, nullptr, onIndexWrite);
   } else if (config->thinLTOJobs != 0) {
     backend = lto::createInProcessThinBackend(config->thinLTOJobs);
   }
@@ -121,6 +137,8 @@ void BitcodeCompiler::add(BitcodeFile &f) {
 
   if (config->thinLTOIndexOnly)
     thinIndices.insert(obj.getName());
+  if (!config->thinLTOBackendCommand.empty() && !f.parentName.empty())
+    archiveMembers[obj.getName()] = f.mb.getBuffer();
 
   // Provide a resolution to the LTO API for each symbol.
   for (const lto::InputFile::Symbol &objSym : obj.symbols()) {
@@ -184,8 +202,16 @@ std::vector<StringRef> BitcodeCompiler::compile() {
     return {};
   }
 
-  if (!config->ltoCache.empty())
-    pruneCache(config->ltoCache, config->ltoCachePolicy);
+  if (!config->thinLTOBackendCommand.empty())
+    runBackendCommands();
+
+  // Pruning scans the whole cache directory, and nothing else in the link
+  // depends on it.
+  if (!config->ltoCache.empty()) {
+    std::string dir = config->ltoCache;
+    CachePruningPolicy policy = config->ltoCachePolicy;
+    runInBackground([=] { pruneCache(dir, policy); });
+  }
 
   std::vector<StringRef> ret;
   for (unsigned i = 0; i != maxTasks; ++i) {
@@ -207,5 +233,120 @@ std::vector<StringRef> BitcodeCompiler::compile() {
   return ret;
 }
 
+// Replaces the placeholders of a -thinlto-backend-command argument.
+static std::string substitutePlaceholders(StringRef arg, StringRef module,
+                                          StringRef index, StringRef out) {
+  std::string ret;
+  while (!arg.empty()) {
+    size_t pos = arg.find('%');
+    ret += arg.substr(0, pos);
+    if (pos == StringRef::npos)
+      break;
+    arg = arg.substr(pos);
+    if (arg.consume_front("%module"))
+      ret += module;
+    else if (arg.consume_front("%index"))
+      ret += index;
+    else if (arg.consume_front("%out"))
+      ret += out;
+    else if (arg.consume_front("%%"))
+      ret += '%';
+    else {
+      ret += '%';
+      arg = arg.drop_front();
+    }
+  }
+  return ret;
+}
+
+// Runs the command given by -thinlto-backend-command once for each ThinLTO
+// module for which an index file was written, and reads the native objects
+// that the commands created. The commands typically hand the job to a remote
+// build worker, so up to /opt:lldltojobs of them (by default, one per
+// hardware thread) run at the same time.
+void BitcodeCompiler::runBackendCommands() {
+  SmallVector<const char *, 16> argv;
+  cl::TokenizeWindowsCommandLine(config->thinLTOBackendCommand, saver, argv);
+  if (argv.empty()) {
+    error("-thinlto-backend-command: no command given");
+    return;
+  }
+
+  ErrorOr<std::string> program = sys::findProgramByName(argv[0]);
+  if (!program) {
+    error("-thinlto-backend-command: cannot find " + StringRef(argv[0]) +
+          ": " + program.getError().message());
+    return;
+  }
+
+  struct Job {
+    std::string module;
+    std::string index;
+    std::string out;
+  };
+  std::vector<Job> jobs;
+  for (const std::string &module : backendModules) {
+    std::string path = getThinLTOOutputFile(module);
+    jobs.push_back({module, path + ".thinlto.bc", path + ".thinlto.obj"});
+
+    // The commands and the ThinLTO backends read the modules by their names,
+    // so archive members are extracted to files of those names.
+    auto it = archiveMembers.find(module);
+    if (it != archiveMembers.end())
+      saveBuffer(it->second, module);
+  }
+  if (errorCount())
+    return;
+
+  auto run = [&](const Job &job) {
+    std::vector<std::string> args;
+    args.push_back(*program);
+    for (const char *arg : makeArrayRef(argv).drop_front())
+      args.push_back(
+          substitutePlaceholders(arg, job.module, job.index, job.out));
+    std::vector<StringRef> argRefs(args.begin(), args.end());
+
+    std::string errMsg;
+    int ret = sys::ExecuteAndWait(*program, argRefs, /*Env=*/None,
+                                  /*Redirects=*/{}, /*SecondsToWait=*/0,
+                                  /*MemoryLimit=*/0, &errMsg);
+    if (ret != 0)
+      error("-thinlto-backend-command: command failed for " + job.module +
+            (errMsg.empty() ? "" : ": " + errMsg));
+  };
+
+  size_t numThreads = 1;
+  if (threadsEnabled)
+    numThreads = config->thinLTOJobs ? config->thinLTOJobs
+                                     : std::thread::hardware_concurrency();
+  numThreads = std::max<size_t>(1, std::min(numThreads, jobs.size()));
+
+  std::atomic<size_t> next{0};
+  auto worker = [&] {
+    for (size_t i = next++; i < jobs.size(); i = next++)
+      run(jobs[i]);
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < numThreads; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &t : threads)
+    t.join();
+  if (errorCount())
+    return;
+
+  for (const Job &job : jobs) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+        MemoryBuffer::getFile(job.out, /*FileSize=*/-1,
+                              /*RequiresNullTerminator=*/false);
+    if (!mbOrErr) {
+      error("-thinlto-backend-command: cannot open " + job.out + ": " +
+            mbOrErr.getError().message());
+      continue;
+    }
+    files.push_back(std::move(*mbOrErr));
+  }
+}
+
 } // namespace coff
 } // namespace lld
@@ -21,10 +21,13 @@
 #define LLD_COFF_LTO_H
 
 #include "lld/Common/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Support/raw_ostream.h"
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 namespace llvm {
@@ -48,11 +51,19 @@ public:
   std::vector<StringRef> compile();
 
 private:
+  void runBackendCommands();
+
   std::unique_ptr<llvm::lto::LTO> ltoObj;
   std::vector<SmallString<0>> buf;
   std::vector<std::unique_ptr<MemoryBuffer>> files;
   std::unique_ptr<llvm::raw_fd_ostream> indexFile;
   llvm::DenseSet<StringRef> thinIndices;
+
+  // With -thinlto-backend-command, the modules for which an index file was
+  // written, and the contents of the modules that were archive members.
+  std::mutex backendModulesMutex;
+  std::vector<std::string> backendModules;
+  llvm::DenseMap<StringRef, StringRef> archiveMembers;
 };
 }
 }
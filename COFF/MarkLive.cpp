@@ -8,8 +8,10 @@
 
 #include "Chunks.h"
 #include "Symbols.h"
+#include "lld/Common/Threads.h"
 #include "lld/Common/Timer.h"
 #include "llvm/ADT/STLExtras.h"
+#include <atomic>
 #include <vector>
 
 namespace lld {
@@ -17,6 +19,71 @@ namespace coff {
 
 static Timer gctimer("GC", Timer::root());
 
+// Sets the live bit of a chunk and returns true if it was not set, so that
+// only one of the threads that find a chunk live visits it.
+static bool markChunk(SectionChunk *c) {
+  static_assert(sizeof(std::atomic<bool>) == sizeof(c->live),
+                "live must be usable as an atomic");
+  auto *p = reinterpret_cast<std::atomic<bool> *>(&c->live);
+  return !p->load(std::memory_order_relaxed) &&
+         !p->exchange(true, std::memory_order_relaxed);
+}
+
+static void addSym(Symbol *b, std::vector<SectionChunk *> &worklist) {
+  if (auto *sym = dyn_cast<DefinedRegular>(b)) {
+    if (markChunk(sym->getChunk()))
+      worklist.push_back(sym->getChunk());
+  } else if (auto *sym = dyn_cast<DefinedImportData>(b)) {
+    sym->file->live = true;
+  } else if (auto *sym = dyn_cast<DefinedImportThunk>(b)) {
+    sym->wrappedSym->file->live = sym->wrappedSym->file->thunkLive = true;
+  }
+}
+
+// Adds the chunks that a live chunk refers to to the worklist.
+static void visit(SectionChunk *sc, std::vector<SectionChunk *> &worklist) {
+  assert(sc->live && "We mark as live when pushing onto the worklist!");
+
+  // Mark all symbols listed in the relocation table for this section.
+  for (Symbol *b : sc->symbols())
+    if (b)
+      addSym(b, worklist);
+
+  // Mark associative sections if any.
+  for (SectionChunk &c : sc->children())
+    if (markChunk(&c))
+      worklist.push_back(&c);
+}
+
+// Marks chunks reachable from the worklist in rounds. In each round, the
+// chunks that were found live in the previous one are split into groups that
+// are visited in parallel, each of which collects the chunks it finds live
+// into its own worklist.
+//
+// Each chunk is visited by the thread that sets its live bit. Other than
+// that, threads only set the live bits of import files, which are only ever
+// set to true during marking, so they are not atomic. The Writer reports
+// discarded chunks in chunk order, so /verbose output does not depend on the
+// order in which chunks are marked.
+static void markParallel(std::vector<SectionChunk *> &worklist) {
+  const size_t groupSize = 256;
+
+  std::vector<SectionChunk *> current = std::move(worklist);
+  while (!current.empty()) {
+    size_t numGroups = (current.size() + groupSize - 1) / groupSize;
+    std::vector<std::vector<SectionChunk *>> worklists(numGroups);
+    parallelForEachN(0, numGroups, [&](size_t i) {
+      size_t end = std::min(current.size(), (i + 1) * groupSize);
+      for (size_t j = i * groupSize; j != end; ++j)
+        visit(current[j], worklists[i]);
+    });
+
+    current.clear();
+    for (std::vector<SectionChunk *> &v : worklists)
+      current.insert(current.end(), v.begin(), v.end());
+  }
+}
+
 // Set live bit on for each reachable chunk. Unmarked (unreachable)
 // COMDAT chunks will be ignored by Writer, so they will be excluded
 // from the final output.
@@ -26,7 +93,7 @@ void markLive(ArrayRef<Chunk *> chunks) {
   // We build up a worklist of sections which have been marked as live. We only
   // push into the worklist when we discover an unmarked section, and we mark
   // as we push, so sections never appear twice in the list.
-  SmallVector<SectionChunk *, 256> worklist;
+  std::vector<SectionChunk *> worklist;
 
   // COMDAT section chunks are dead by default. Add non-COMDAT chunks.
   for (Chunk *c : chunks)
@@ -34,38 +101,19 @@ void markLive(ArrayRef<Chunk *> chunks) {
       if (sc->live)
         worklist.push_back(sc);
 
-  auto enqueue = [&](SectionChunk *c) {
-    if (c->live)
-      return;
-    c->live = true;
-    worklist.push_back(c);
-  };
-
-  auto addSym = [&](Symbol *b) {
-    if (auto *sym = dyn_cast<DefinedRegular>(b))
-      enqueue(sym->getChunk());
-    else if (auto *sym = dyn_cast<DefinedImportData>(b))
-      sym->file->live = true;
-    else if (auto *sym = dyn_cast<DefinedImportThunk>(b))
-      sym->wrappedSym->file->live = sym->wrappedSym->file->thunkLive = true;
-  };
-
   // Add GC root chunks.
   for (Symbol *b : config->gcroot)
-    addSym(b);
-
-  while (!worklist.empty()) {
-    SectionChunk *sc = worklist.pop_back_val();
-    assert(sc->live && "We mark as live when pushing onto the worklist!");
+    addSym(b, worklist);
 
-    // Mark all symbols listed in the relocation table for this section.
-    for (Symbol *b : sc->symbols())
-      if (b)
-        addSym(b);
+  if (threadsEnabled) {
+    markParallel(worklist);
+    return;
+  }
 
-    // Mark associative sections if any.
-    for (SectionChunk &c : sc->children())
-      enqueue(&c);
+  while (!worklist.empty()) {
+    SectionChunk *sc = worklist.back();
+    worklist.pop_back();
+    visit(sc, worklist);
   }
 }
 
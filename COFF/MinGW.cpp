@@ -128,7 +128,9 @@ bool AutoExporter::shouldExport(Defined *sym) const {
       return false;
 
   // If a corresponding __imp_ symbol exists and is defined, don't export it.
-  if (symtab->find(("__imp_" + sym->getName()).str()))
+  SmallString<128> impName("__imp_");
+  impName += sym->getName();
+  if (symtab->find(impName))
     return false;
 
   // Check that file is non-null before dereferencing it, symbols not
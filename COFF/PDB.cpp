@@ -16,14 +16,17 @@
 #include "TypeMerger.h"
 #include "Writer.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Filesystem.h"
 #include "lld/Common/Timer.h"
 #include "lld/Common/Threads.h"
+#include "llvm/ADT/CachedHashString.h"
 #include "llvm/DebugInfo/CodeView/DebugFrameDataSubsection.h"
 #include "llvm/DebugInfo/CodeView/DebugSubsectionRecord.h"
 #include "llvm/DebugInfo/CodeView/GlobalTypeTableBuilder.h"
 #include "llvm/DebugInfo/CodeView/LazyRandomTypeCollection.h"
 #include "llvm/DebugInfo/CodeView/MergingTypeTableBuilder.h"
 #include "llvm/DebugInfo/CodeView/RecordName.h"
+#include "llvm/DebugInfo/CodeView/RecordSerialization.h"
 #include "llvm/DebugInfo/CodeView/SymbolDeserializer.h"
 #include "llvm/DebugInfo/CodeView/SymbolRecordHelpers.h"
 #include "llvm/DebugInfo/CodeView/SymbolSerializer.h"
@@ -35,14 +38,17 @@
 #include "llvm/DebugInfo/MSF/MSFCommon.h"
 #include "llvm/DebugInfo/PDB/GenericError.h"
 #include "llvm/DebugInfo/PDB/Native/DbiModuleDescriptorBuilder.h"
+#include "llvm/DebugInfo/PDB/Native/DbiModuleList.h"
 #include "llvm/DebugInfo/PDB/Native/DbiStream.h"
 #include "llvm/DebugInfo/PDB/Native/DbiStreamBuilder.h"
 #include "llvm/DebugInfo/PDB/Native/GSIStreamBuilder.h"
 #include "llvm/DebugInfo/PDB/Native/InfoStream.h"
 #include "llvm/DebugInfo/PDB/Native/InfoStreamBuilder.h"
+#include "llvm/DebugInfo/PDB/Native/ModuleDebugStream.h"
 #include "llvm/DebugInfo/PDB/Native/NativeSession.h"
 #include "llvm/DebugInfo/PDB/Native/PDBFile.h"
 #include "llvm/DebugInfo/PDB/Native/PDBFileBuilder.h"
+#include "llvm/DebugInfo/PDB/Native/PDBStringTable.h"
 #include "llvm/DebugInfo/PDB/Native/PDBStringTableBuilder.h"
 #include "llvm/DebugInfo/PDB/Native/TpiHashing.h"
 #include "llvm/DebugInfo/PDB/Native/TpiStream.h"
@@ -51,13 +57,17 @@
 #include "llvm/Object/COFF.h"
 #include "llvm/Object/CVDebugRecord.h"
 #include "llvm/Support/BinaryByteStream.h"
+#include "llvm/Support/BinaryStreamWriter.h"
 #include "llvm/Support/CRC.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/ScopedPrinter.h"
+#include "llvm/Support/xxhash.h"
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 using namespace llvm;
 using namespace llvm::codeview;
@@ -81,6 +91,36 @@ static Timer diskCommitTimer("Commit to Disk", totalPdbLinkTimer);
 namespace {
 class DebugSHandler;
 
+/// What an incremental link remembers about the module of an object file, so
+/// that the next link can copy the module from the PDB if it is unchanged.
+struct ModuleState {
+  /// A hash of the debug sections of the object and of the addresses that
+  /// their relocations refer to.
+  uint64_t key = 0;
+
+  /// False if the module can't be copied, e.g. because it has frame data,
+  /// which goes to the DBI stream rather than to the module stream.
+  bool reusable = false;
+
+  /// The type index map of the object.
+  CVIndexMap indexMap;
+
+  /// The records that the module adds to the globals stream and their
+  /// offsets in the module symbol stream.
+  std::vector<std::pair<uint32_t, CVSymbol>> globals;
+};
+
+/// The state of an incremental link, which is kept in a named stream of the
+/// PDB.
+struct IncrementalState {
+  /// A hash of the type records of all object files in link order, or 0 if
+  /// they can't be reused.
+  uint64_t typesKey = 0;
+
+  /// The modules of the object files, indexed by module index.
+  std::vector<ModuleState> modules;
+};
+
 class PDBLinker {
   friend DebugSHandler;
 
@@ -105,8 +145,9 @@ public:
   /// Link info for each import file in the symbol table into the PDB.
   void addImportFilesToPDB(ArrayRef<OutputSection *> outputSections);
 
-  /// Link CodeView from a single object file into the target (output) PDB.
-  /// When a precompiled headers object is linked, its TPI map might be provided
+  /// Merge the types of a single object file into the target (output) PDB,
+  /// and queue its symbols to be merged by addObjectsToPDB(). When a
+  /// precompiled headers object is linked, its TPI map might be provided
   /// externally.
   void addObjFile(ObjFile *file, CVIndexMap *externIndexMap = nullptr);
 
@@ -124,6 +165,12 @@ public:
   Expected<const CVIndexMap &> mergeDebugT(ObjFile *file,
                                            CVIndexMap *objectIndexMap);
 
+  /// With /DEBUG:GHASH, computes the global hashes of all object files that
+  /// don't have .debug$H in parallel. If no object uses a type server PDB or
+  /// precompiled headers, this also merges all of their type records, so
+  /// that mergeDebugT() only returns the resulting index maps.
+  void mergeGHashTypesInParallel();
+
   /// Reads and makes available a PDB.
   Expected<const CVIndexMap &> maybeMergeTypeServerPDB(ObjFile *file);
 
@@ -147,9 +194,21 @@ public:
   std::pair<CVIndexMap &, bool /*already there*/>
   registerPrecompiledHeaders(uint32_t signature);
 
-  void mergeSymbolRecords(ObjFile *file, const CVIndexMap &indexMap,
-                          std::vector<ulittle32_t *> &stringTableRefs,
-                          BinaryStreamRef symData);
+  /// With /incremental, computes the state of this link and compares it to
+  /// the one stored in the previous PDB. If the type records of all objects
+  /// are unchanged, the type streams of the previous PDB are reused, and so
+  /// are the modules whose debug sections did not change.
+  void initIncrementalState();
+
+  /// Opens the previous PDB and reads its state.
+  Error loadPreviousPDB();
+
+  /// Copies the module of an object file from the previous PDB if it is
+  /// unchanged. Returns false if the module has to be built.
+  bool reuseModule(ObjFile *file);
+
+  /// Adds the state of this link to the PDB for the next link.
+  void addIncrementalState();
 
   /// Add the section map and section contributions to the PDB.
   void addSections(ArrayRef<OutputSection *> outputSections,
@@ -185,10 +244,80 @@ private:
   /// far.
   std::map<uint32_t, CVIndexMap> precompTypeIndexMappings;
 
+  /// Global hashes computed by mergeGHashTypesInParallel() for object files
+  /// that are merged by mergeDebugT().
+  DenseMap<const ObjFile *, std::vector<GloballyHashedType>> ownedGHashes;
+
+  /// Type index mappings of object files whose types were merged by
+  /// mergeGHashTypesInParallel().
+  DenseMap<const ObjFile *, CVIndexMap> ghashIndexMappings;
+
+  /// The object files whose symbols are merged, in the order in which their
+  /// types were merged. They also own the memory of the symbol records.
+  std::vector<std::unique_ptr<DebugSHandler>> debugSHandlers;
+
+  /// The previous PDB. Its type records are referred to by the TPI and IPI
+  /// stream builders if they are reused.
+  std::unique_ptr<pdb::NativeSession> previousSession;
+
+  /// The state that was read from the previous PDB and the one of this link.
+  IncrementalState previousState;
+  IncrementalState state;
+  std::string stateData;
+
+  /// True if the type streams of the previous PDB are reused.
+  bool reuseTypes = false;
+
   // For statistics
   uint64_t globalSymbols = 0;
   uint64_t moduleSymbols = 0;
   uint64_t publicSymbols = 0;
+  uint64_t reusedModules = 0;
+};
+
+/// A set of strings that many threads add to at once. The PDB string table
+/// assigns offsets in the order strings are inserted, so each string is
+/// tagged with the smallest key it was added with, and the strings are then
+/// inserted into the PDB string table in the order of their keys. The set is
+/// sharded by hash to reduce lock contention.
+class StringPool {
+public:
+  void add(StringRef s, uint64_t key);
+
+  /// Inserts the strings into the PDB string table. Must not be called
+  /// concurrently with add().
+  void addTo(DebugStringTableSubsection &strTab);
+
+private:
+  struct Shard {
+    std::mutex mu;
+    StringMap<uint64_t> keys;
+  };
+
+  static constexpr size_t numShards = 64;
+  Shard shards[numShards];
+};
+
+/// The S_UDT and S_CONSTANT records of all modules, which the globals stream
+/// contains only once each. Like StringPool, each record is tagged with the
+/// smallest key it was added with, so that the copy that is kept is the one
+/// that used to come first when records were added serially.
+class GlobalRecordSet {
+public:
+  void add(ArrayRef<uint8_t> record, uint64_t key);
+
+  /// Returns true if key is the one the record is kept with. Must not be
+  /// called concurrently with add().
+  bool isKept(ArrayRef<uint8_t> record, uint64_t key) const;
+
+private:
+  struct Shard {
+    std::mutex mu;
+    DenseMap<CachedHashStringRef, uint64_t> keys;
+  };
+
+  static constexpr size_t numShards = 64;
+  Shard shards[numShards];
 };
 
 class DebugSHandler {
@@ -197,8 +326,20 @@ class DebugSHandler {
   /// The object file whose .debug$S sections we're processing.
   ObjFile &file;
 
+public:
   /// The result of merging type indices.
-  const CVIndexMap &indexMap;
+  const CVIndexMap *indexMap = nullptr;
+
+  /// The index map of an object that was merged by mergeDebugT() if it is
+  /// not shared with other objects.
+  CVIndexMap objectIndexMap;
+
+private:
+  /// Memory for relocated debug sections and realigned symbol records, which
+  /// are referred to by the module and globals streams until the PDB is
+  /// written. Each object has its own allocator so that objects are handled
+  /// in parallel.
+  BumpPtrAllocator alloc;
 
   /// The DEBUG_S_STRINGTABLE subsection.  These strings are referred to by
   /// index from other records in the .debug$S section.  All of these strings
@@ -231,16 +372,69 @@ class DebugSHandler {
   /// references.
   std::vector<ulittle32_t *> stringTableReferences;
 
+  /// The number of references to strings that are not in cVStrTab.
+  uint32_t numBadStringReferences = 0;
+
+  /// The absolute names of the files in the checksums subsection.
+  std::vector<std::string> checksumFileNames;
+
+  /// The DEBUG_S_FRAMEDATA records and the checksums subsection, rewritten to
+  /// refer to the PDB string table by remapStrings().
+  std::vector<codeview::FrameData> remappedFpoFrames;
+  std::unique_ptr<DebugChecksumsSubsection> newChecksums;
+
+  /// The records from .debug$F sections, which are added to the DBI stream
+  /// by finish().
+  std::vector<object::FpoData> oldFpoFrames;
+
+  /// Symbols that go to the globals stream and their offsets in the module
+  /// symbol stream. The globals stream is shared by all objects, so they are
+  /// added to it by finish().
+  std::vector<std::pair<uint32_t, CVSymbol>> globalSymbols;
+
+  /// The records that globalSymbols become in the globals stream.
+  std::vector<CVSymbol> globalRecords;
+
+  uint64_t numModuleSymbols = 0;
+
 public:
-  DebugSHandler(PDBLinker &linker, ObjFile &file, const CVIndexMap &indexMap)
-      : linker(linker), file(file), indexMap(indexMap) {}
+  DebugSHandler(PDBLinker &linker, ObjFile &file)
+      : linker(linker), file(file) {}
+
+  /// Handles the live .debug$S and .debug$F sections of the object. This
+  /// only modifies the state of the object and its module, so it is called
+  /// for many objects in parallel.
+  void handleDebugChunks();
 
   void handleDebugS(lld::coff::SectionChunk &debugS);
 
+  void mergeSymbolRecords(BinaryStreamRef symData);
+
   std::shared_ptr<DebugInlineeLinesSubsection>
   mergeInlineeLines(DebugChecksumsSubsection *newChecksums);
 
-  void finish();
+  /// Adds the strings that the module refers to to the pool, so that they
+  /// can be added to the PDB string table. Called for many objects in
+  /// parallel.
+  void collectStrings(StringPool &pool);
+
+  /// Rewrites the string table references of the module to refer to the PDB
+  /// string table, which must contain all the strings by now. Called for
+  /// many objects in parallel.
+  void remapStrings();
+
+  /// Creates the globals stream records of the module and adds its S_UDT
+  /// and S_CONSTANT records to udts. Called for many objects in parallel.
+  void createGlobalRecords(GlobalRecordSet &udts);
+
+  /// Adds what handleDebugChunks() found to the PDB-wide streams. This must
+  /// be called for objects in order.
+  void finish(const GlobalRecordSet &udts);
+
+  uint32_t getModuleIndex() const { return file.moduleDBI->getModuleIndex(); }
+
+  /// Records what the next incremental link needs to reuse the module.
+  void saveState(ModuleState &m) const;
 };
 }
 
@@ -283,6 +477,17 @@ static void pdbMakeAbsolute(SmallVectorImpl<char> &fileName) {
   fileName = std::move(absoluteFileName);
 }
 
+// Returns the ghash cache key of an object that has no usable .debug$H
+// section. Hashing the records with xxHash64 is much cheaper than computing
+// their SHA1 global hashes.
+static std::string getTypesCacheKey(const CVTypeArray &types) {
+  BinaryStreamReader reader(types.getUnderlyingStream());
+  ArrayRef<uint8_t> data;
+  cantFail(reader.readBytes(data, reader.getLength()));
+  return "obj-" + utohexstr(xxHash64(toStringRef(data))) + "-" +
+         utostr(data.size());
+}
+
 // A COFF .debug$H section is currently a clang extension.  This function checks
 // if a .debug$H section is in a format that we expect / understand, so that we
 // can ignore any sections which are coincidentally also named .debug$H but do
@@ -333,13 +538,37 @@ static void addTypeInfo(pdb::TpiStreamBuilder &tpiBuilder,
   });
 }
 
+// Copies the records of a TPI or IPI stream of the previous PDB.
+static void addTypeInfo(pdb::TpiStreamBuilder &tpiBuilder,
+                        pdb::TpiStream &tpi) {
+  tpiBuilder.setVersionHeader(pdb::PdbTpiV80);
+
+  for (const CVType &type : tpi.typeArray()) {
+    auto hash = pdb::hashTypeRecord(type);
+    if (auto e = hash.takeError())
+      fatal("type hashing error");
+    tpiBuilder.addTypeRecord(type.RecordData, *hash);
+  }
+}
+
 Expected<const CVIndexMap &>
 PDBLinker::mergeDebugT(ObjFile *file, CVIndexMap *objectIndexMap) {
   ScopedTimer t(typeMergingTimer);
 
+  // The types of an incremental link are those of the previous link.
+  if (reuseTypes) {
+    uint32_t modi = file->moduleDBI->getModuleIndex();
+    *objectIndexMap = previousState.modules[modi].indexMap;
+    return *objectIndexMap;
+  }
+
   if (!file->debugTypesObj)
     return *objectIndexMap; // no Types stream
 
+  auto it = ghashIndexMappings.find(file);
+  if (it != ghashIndexMappings.end())
+    return it->second;
+
   // Precompiled headers objects need to save the index map for further
   // reference by other objects which use the precompiled headers.
   if (file->debugTypesObj->kind == TpiSource::PCH) {
@@ -394,7 +623,10 @@ PDBLinker::mergeDebugT(ObjFile *file, CVIndexMap *objectIndexMap) {
   if (config->debugGHashes) {
     ArrayRef<GloballyHashedType> hashes;
     std::vector<GloballyHashedType> ownedHashes;
-    if (Optional<ArrayRef<uint8_t>> debugH = getDebugH(file))
+    auto it = ownedGHashes.find(file);
+    if (it != ownedGHashes.end())
+      hashes = it->second;
+    else if (Optional<ArrayRef<uint8_t>> debugH = getDebugH(file))
       hashes = getHashesFromDebugH(*debugH);
     else {
       ownedHashes = GloballyHashedType::hashTypes(types);
@@ -416,6 +648,256 @@ PDBLinker::mergeDebugT(ObjFile *file, CVIndexMap *objectIndexMap) {
   return *objectIndexMap;
 }
 
+namespace {
+// The .debug$T of an object file that is merged by
+// mergeGHashTypesInParallel().
+struct GHashSource {
+  ObjFile *file;
+  std::vector<CVType> records;
+  ArrayRef<GloballyHashedType> hashes;
+  std::vector<GloballyHashedType> ownedHashes;
+
+  // Set for records that go to the IPI stream rather than the TPI stream.
+  std::vector<bool> isItem;
+
+  // The destination index of each record that is the first one with its
+  // hash. Other elements are unused.
+  std::vector<TypeIndex> destIndices;
+};
+
+// A lock-free hash table from global hashes to the first record that has
+// each hash. A cell is 0 if it is empty, and is otherwise a source index
+// plus one in the upper 32 bits and a record index in the lower 32 bits.
+// "first" means the smallest cell value, so the result does not depend on
+// the order of insertions.
+class GHashTable {
+public:
+  GHashTable(ArrayRef<GHashSource> sources, size_t numRecords)
+      : sources(sources),
+        cells(PowerOf2Ceil(numRecords + numRecords / 2 + 1)) {}
+
+  void insert(uint32_t srcIdx, uint32_t recIdx) {
+    uint64_t newCell = (uint64_t(srcIdx + 1) << 32) | recIdx;
+    GloballyHashedType hash = sources[srcIdx].hashes[recIdx];
+    for (size_t i = getStart(hash);; i = (i + 1) & (cells.size() - 1)) {
+      uint64_t cell = cells[i].load(std::memory_order_relaxed);
+      for (;;) {
+        if (cell == 0) {
+          if (cells[i].compare_exchange_weak(cell, newCell))
+            return;
+          continue;
+        }
+        if (getHash(cell) != hash)
+          break;
+        if (cell <= newCell)
+          return;
+        if (cells[i].compare_exchange_weak(cell, newCell))
+          return;
+      }
+    }
+  }
+
+  // Returns the first record with a given hash, which must be in the table.
+  uint64_t find(GloballyHashedType hash) const {
+    for (size_t i = getStart(hash);; i = (i + 1) & (cells.size() - 1)) {
+      uint64_t cell = cells[i].load(std::memory_order_relaxed);
+      if (getHash(cell) == hash)
+        return cell;
+    }
+  }
+
+  std::vector<uint64_t> getCells() const {
+    std::vector<uint64_t> ret;
+    for (const std::atomic<uint64_t> &cell : cells)
+      if (uint64_t v = cell.load(std::memory_order_relaxed))
+        ret.push_back(v);
+    return ret;
+  }
+
+private:
+  size_t getStart(GloballyHashedType hash) const {
+    return support::endian::read64le(hash.Hash.data()) & (cells.size() - 1);
+  }
+
+  GloballyHashedType getHash(uint64_t cell) const {
+    return sources[(cell >> 32) - 1].hashes[uint32_t(cell)];
+  }
+
+  ArrayRef<GHashSource> sources;
+  std::vector<std::atomic<uint64_t>> cells;
+};
+} // namespace
+
+// The same as the one in TypeStreamMerger.
+static bool isIdRecord(TypeLeafKind kind) {
+  switch (kind) {
+  case LF_FUNC_ID:
+  case LF_MFUNC_ID:
+  case LF_STRING_ID:
+  case LF_SUBSTR_LIST:
+  case LF_BUILDINFO:
+  case LF_UDT_SRC_LINE:
+  case LF_UDT_MOD_SRC_LINE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Copies a type record to dest, which is the record size rounded up to 4
+// bytes, and rewrites the type and item indices in it, as TypeStreamMerger
+// does.
+static void remapTypeRecord(MutableArrayRef<uint8_t> dest, const CVType &type,
+                            ArrayRef<TypeIndex> indexMap) {
+  ArrayRef<uint8_t> data = type.RecordData;
+  memcpy(dest.data(), data.data(), data.size());
+  for (size_t i = data.size(); i < dest.size(); ++i)
+    dest[i] = LF_PAD0 + dest.size() - i;
+  reinterpret_cast<RecordPrefix *>(dest.data())->RecordLen = dest.size() - 2;
+
+  SmallVector<TiReference, 32> refs;
+  discoverTypeIndices(type, refs);
+  uint8_t *content = dest.data() + sizeof(RecordPrefix);
+  for (const TiReference &ref : refs) {
+    auto *tis = reinterpret_cast<TypeIndex *>(content + ref.Offset);
+    for (uint32_t i = 0; i < ref.Count; ++i) {
+      if (tis[i].isSimple())
+        continue;
+      uint32_t idx = tis[i].toArrayIndex();
+      tis[i] = idx < indexMap.size() ? indexMap[idx]
+                                     : TypeIndex(SimpleTypeKind::NotTranslated);
+    }
+  }
+}
+
+void PDBLinker::mergeGHashTypesInParallel() {
+  ScopedTimer t(typeMergingTimer);
+
+  // Objects that use precompiled headers may drop records before they are
+  // hashed, and type server PDBs are hashed when they are loaded.
+  std::vector<GHashSource> sources;
+  bool canMerge = true;
+  for (ObjFile *file : ObjFile::instances) {
+    if (!file->debugTypesObj)
+      continue;
+    TpiSource::TpiKind kind = file->debugTypesObj->kind;
+    if (kind == TpiSource::Regular || kind == TpiSource::PCH)
+      sources.push_back({file, {}, {}, {}, {}, {}});
+    if (kind != TpiSource::Regular)
+      canMerge = false;
+  }
+
+  parallelForEach(sources, [](GHashSource &src) {
+    CVTypeArray &types = *src.file->debugTypes;
+    if (Optional<ArrayRef<uint8_t>> debugH = getDebugH(src.file))
+      src.hashes = getHashesFromDebugH(*debugH);
+    for (const CVType &type : types) {
+      src.records.push_back(type);
+      src.isItem.push_back(isIdRecord(type.kind()));
+    }
+    if (src.hashes.size() != src.records.size()) {
+      // Precompiled header objects are shared by many links and are
+      // identified by their signatures, so their hashes can be cached.
+      // Other objects are identified by the contents of their records.
+      auto hash = [&] { return GloballyHashedType::hashTypes(types); };
+      if (src.file->debugTypesObj->kind == TpiSource::PCH &&
+          src.file->pchSignature)
+        src.ownedHashes = getCachedGHashes(
+            "pch-" + utohexstr(*src.file->pchSignature), types, hash);
+      else if (src.file->debugTypesObj->kind == TpiSource::Regular &&
+               !config->ghashCache.empty())
+        src.ownedHashes =
+            getCachedGHashes(getTypesCacheKey(types), types, hash);
+      else
+        src.ownedHashes = hash();
+      src.hashes = src.ownedHashes;
+    }
+    src.destIndices.resize(src.records.size());
+  });
+
+  if (!canMerge) {
+    for (GHashSource &src : sources)
+      if (!src.ownedHashes.empty())
+        ownedGHashes[src.file] = std::move(src.ownedHashes);
+    return;
+  }
+
+  size_t numRecords = 0;
+  for (const GHashSource &src : sources)
+    numRecords += src.records.size();
+  if (numRecords >= UINT32_MAX || sources.size() >= UINT32_MAX)
+    fatal("too many type records for /DEBUG:GHASH");
+
+  // Find the first record of each hash in parallel.
+  GHashTable table(sources, numRecords);
+  parallelForEachN(0, sources.size(), [&](size_t i) {
+    for (size_t j = 0, e = sources[i].records.size(); j != e; ++j)
+      table.insert(i, j);
+  });
+
+  // Sort the first records by source and record indices, and number them in
+  // that order. This is the order in which mergeTypeAndIdRecords() would
+  // have added them to the type and ID tables.
+  std::vector<uint64_t> cells = table.getCells();
+  parallelSort(cells, std::less<uint64_t>());
+
+  std::vector<size_t> offsets(cells.size() + 1);
+  uint32_t numTypes = 0;
+  uint32_t numIds = 0;
+  for (size_t i = 0, e = cells.size(); i != e; ++i) {
+    GHashSource &src = sources[(cells[i] >> 32) - 1];
+    uint32_t recIdx = uint32_t(cells[i]);
+    src.destIndices[recIdx] = TypeIndex::fromArrayIndex(
+        src.isItem[recIdx] ? numIds++ : numTypes++);
+    offsets[i + 1] =
+        offsets[i] + alignTo(src.records[recIdx].RecordData.size(), 4);
+  }
+
+  // Compute the index map of each object.
+  std::vector<CVIndexMap> indexMaps(sources.size());
+  parallelForEachN(0, sources.size(), [&](size_t i) {
+    SmallVectorImpl<TypeIndex> &tpiMap = indexMaps[i].tpiMap;
+    tpiMap.reserve(sources[i].records.size());
+    for (GloballyHashedType hash : sources[i].hashes) {
+      uint64_t cell = table.find(hash);
+      tpiMap.push_back(
+          sources[(cell >> 32) - 1].destIndices[uint32_t(cell)]);
+    }
+  });
+
+  // Remap the first records in parallel, and add them to the type and ID
+  // tables in order.
+  std::vector<uint8_t> buf(offsets.back());
+  auto getRecord = [&](size_t i) {
+    return makeMutableArrayRef(buf.data() + offsets[i],
+                               offsets[i + 1] - offsets[i]);
+  };
+  parallelForEachN(0, cells.size(), [&](size_t i) {
+    size_t srcIdx = (cells[i] >> 32) - 1;
+    remapTypeRecord(getRecord(i), sources[srcIdx].records[uint32_t(cells[i])],
+                    indexMaps[srcIdx].tpiMap);
+  });
+
+  for (size_t i = 0, e = cells.size(); i != e; ++i) {
+    GHashSource &src = sources[(cells[i] >> 32) - 1];
+    uint32_t recIdx = uint32_t(cells[i]);
+    ArrayRef<uint8_t> data = getRecord(i);
+    GlobalTypeTableBuilder &dest = src.isItem[recIdx] ? tMerger.globalIDTable
+                                                      : tMerger.globalTypeTable;
+    TypeIndex ti = dest.insertRecordAs(
+        src.hashes[recIdx], data.size(), [&](MutableArrayRef<uint8_t> mem) {
+          memcpy(mem.data(), data.data(), data.size());
+          return mem;
+        });
+    (void)ti;
+    assert(ti == src.destIndices[recIdx]);
+  }
+
+  ghashIndexMappings.reserve(sources.size());
+  for (size_t i = 0, e = sources.size(); i != e; ++i)
+    ghashIndexMappings[sources[i].file] = std::move(indexMaps[i]);
+}
+
 Expected<const CVIndexMap &> PDBLinker::maybeMergeTypeServerPDB(ObjFile *file) {
   Expected<llvm::pdb::NativeSession *> pdbSession = findTypeServerSource(file);
   if (!pdbSession)
@@ -448,8 +930,14 @@ Expected<const CVIndexMap &> PDBLinker::maybeMergeTypeServerPDB(ObjFile *file) {
     // PDB we have to synthesize global hashes.  To do this, we first synthesize
     // global hashes for the TPI stream, since it is independent, then we
     // synthesize hashes for the IPI stream, using the hashes for the TPI stream
-    // as inputs.
-    auto tpiHashes = GloballyHashedType::hashTypes(expectedTpi->typeArray());
+    // as inputs. The hashes depend only on the PDB, so they can be cached
+    // across links by the GUID and age of the PDB.
+    std::string key = "pdb-" + toHex(makeArrayRef(info.getGuid().Guid)) + "-" +
+                      utostr(info.getAge());
+    const CVTypeArray &tpiTypes = expectedTpi->typeArray();
+    std::vector<GloballyHashedType> tpiHashes =
+        getCachedGHashes(key + "-tpi", tpiTypes,
+                         [&] { return GloballyHashedType::hashTypes(tpiTypes); });
     Optional<uint32_t> endPrecomp;
     // Merge TPI first, because the IPI stream will reference type indices.
     if (auto err =
@@ -459,8 +947,11 @@ Expected<const CVIndexMap &> PDBLinker::maybeMergeTypeServerPDB(ObjFile *file) {
 
     // Merge IPI.
     if (maybeIpi) {
-      auto ipiHashes =
-          GloballyHashedType::hashIds(maybeIpi->typeArray(), tpiHashes);
+      const CVTypeArray &ipiTypes = maybeIpi->typeArray();
+      std::vector<GloballyHashedType> ipiHashes =
+          getCachedGHashes(key + "-ipi", ipiTypes, [&] {
+            return GloballyHashedType::hashIds(ipiTypes, tpiHashes);
+          });
       if (auto err =
               mergeIdRecords(tMerger.globalIDTable, indexMap.tpiMap,
                              indexMap.ipiMap, maybeIpi->typeArray(), ipiHashes))
@@ -790,8 +1281,10 @@ static bool symbolGoesInGlobalsStream(const CVSymbol &sym, bool isGlobalScope) {
   }
 }
 
-static void addGlobalSymbol(pdb::GSIStreamBuilder &builder, uint16_t modIndex,
-                            unsigned symOffset, const CVSymbol &sym) {
+// Returns the record that sym becomes in the globals stream. Procedures are
+// referred to by S_PROCREF records, which are created in alloc.
+static CVSymbol createGlobalRecord(BumpPtrAllocator &alloc, uint16_t modIndex,
+                                   unsigned symOffset, const CVSymbol &sym) {
   switch (sym.kind()) {
   case SymbolKind::S_CONSTANT:
   case SymbolKind::S_UDT:
@@ -799,8 +1292,7 @@ static void addGlobalSymbol(pdb::GSIStreamBuilder &builder, uint16_t modIndex,
   case SymbolKind::S_LDATA32:
   case SymbolKind::S_PROCREF:
   case SymbolKind::S_LPROCREF:
-    builder.addGlobalSymbol(sym);
-    break;
+    return sym;
   case SymbolKind::S_GPROC32:
   case SymbolKind::S_LPROC32: {
     SymbolRecordKind k = SymbolRecordKind::ProcRefSym;
@@ -813,17 +1305,14 @@ static void addGlobalSymbol(pdb::GSIStreamBuilder &builder, uint16_t modIndex,
     ps.Name = getSymbolName(sym);
     ps.SumName = 0;
     ps.SymOffset = symOffset;
-    builder.addGlobalSymbol(ps);
-    break;
+    return SymbolSerializer::writeOneSymbol(ps, alloc, CodeViewContainer::Pdb);
   }
   default:
     llvm_unreachable("Invalid symbol kind!");
   }
 }
 
-void PDBLinker::mergeSymbolRecords(ObjFile *file, const CVIndexMap &indexMap,
-                                   std::vector<ulittle32_t *> &stringTableRefs,
-                                   BinaryStreamRef symData) {
+void DebugSHandler::mergeSymbolRecords(BinaryStreamRef symData) {
   ArrayRef<uint8_t> symsBuffer;
   cantFail(symData.readBytes(0, symData.getLength(), symsBuffer));
   SmallVector<SymbolScope, 4> scopes;
@@ -844,7 +1333,7 @@ void PDBLinker::mergeSymbolRecords(ObjFile *file, const CVIndexMap &indexMap,
   // If any of the symbol record lengths was corrupt, ignore them all, warn
   // about it, and move on.
   if (ec) {
-    warn("corrupt symbol records in " + file->getName());
+    warn("corrupt symbol records in " + file.getName());
     consumeError(std::move(ec));
     return;
   }
@@ -861,7 +1350,7 @@ void PDBLinker::mergeSymbolRecords(ObjFile *file, const CVIndexMap &indexMap,
   }
 
   // Iterate again, this time doing the real work.
-  unsigned curSymOffset = file->moduleDBI->getNextSymbolOffset();
+  unsigned curSymOffset = file.moduleDBI->getNextSymbolOffset();
   ArrayRef<uint8_t> bulkSymbols;
   cantFail(forEachCodeViewRecord<CVSymbol>(
       symsBuffer, [&](CVSymbol sym) -> llvm::Error {
@@ -887,33 +1376,31 @@ void PDBLinker::mergeSymbolRecords(ObjFile *file, const CVIndexMap &indexMap,
         }
 
         // Re-map all the type index references.
-        remapTypesInSymbolRecord(file, sym.kind(), recordBytes, indexMap,
+        remapTypesInSymbolRecord(&file, sym.kind(), recordBytes, *indexMap,
                                  typeRefs);
 
         // An object file may have S_xxx_ID symbols, but these get converted to
         // "real" symbols in a PDB.
-        translateIdSymbols(recordBytes, tMerger.getIDTable());
+        translateIdSymbols(recordBytes, linker.tMerger.getIDTable());
         sym = CVSymbol(recordBytes);
 
         // If this record refers to an offset in the object file's string table,
         // add that item to the global PDB string table and re-write the index.
-        recordStringTableReferences(sym.kind(), recordBytes, stringTableRefs);
+        recordStringTableReferences(sym.kind(), recordBytes,
+                                    stringTableReferences);
 
         // Fill in "Parent" and "End" fields by maintaining a stack of scopes.
         if (symbolOpensScope(sym.kind()))
           scopeStackOpen(scopes, curSymOffset, sym);
         else if (symbolEndsScope(sym.kind()))
-          scopeStackClose(scopes, curSymOffset, file);
+          scopeStackClose(scopes, curSymOffset, &file);
 
         // Add the symbol to the globals stream if necessary.  Do this before
         // adding the symbol to the module since we may need to get the next
         // symbol offset, and writing to the module's symbol stream will update
         // that offset.
-        if (symbolGoesInGlobalsStream(sym, scopes.empty())) {
-          addGlobalSymbol(builder.getGsiBuilder(),
-                          file->moduleDBI->getModuleIndex(), curSymOffset, sym);
-          ++globalSymbols;
-        }
+        if (symbolGoesInGlobalsStream(sym, scopes.empty()))
+          globalSymbols.push_back({curSymOffset, sym});
 
         if (symbolGoesInModuleStream(sym, scopes.empty())) {
           // Add symbols to the module in bulk. If this symbol is contiguous
@@ -923,17 +1410,17 @@ void PDBLinker::mergeSymbolRecords(ObjFile *file, const CVIndexMap &indexMap,
             bulkSymbols = makeArrayRef(bulkSymbols.data(),
                                        bulkSymbols.size() + sym.length());
           } else {
-            file->moduleDBI->addSymbolsInBulk(bulkSymbols);
+            file.moduleDBI->addSymbolsInBulk(bulkSymbols);
             bulkSymbols = recordBytes;
           }
           curSymOffset += sym.length();
-          ++moduleSymbols;
+          ++numModuleSymbols;
         }
         return Error::success();
       }));
 
   // Add any remaining symbols we've accumulated.
-  file->moduleDBI->addSymbolsInBulk(bulkSymbols);
+  file.moduleDBI->addSymbolsInBulk(bulkSymbols);
 }
 
 // Allocate memory for a .debug$S / .debug$F section and relocate it.
@@ -969,25 +1456,73 @@ static pdb::SectionContrib createSectionContrib(const Chunk *c, uint32_t modi) {
   return sc;
 }
 
-static uint32_t
-translateStringTableIndex(uint32_t objIndex,
-                          const DebugStringTableSubsectionRef &objStrTable,
-                          DebugStringTableSubsection &pdbStrTable) {
-  auto expectedString = objStrTable.getString(objIndex);
+void StringPool::add(StringRef s, uint64_t key) {
+  Shard &shard = shards[hash_value(s) % numShards];
+  std::lock_guard<std::mutex> lock(shard.mu);
+  auto p = shard.keys.insert({s, key});
+  if (!p.second)
+    p.first->second = std::min(p.first->second, key);
+}
+
+static bool isUdtOrConstant(const CVSymbol &sym) {
+  return sym.kind() == SymbolKind::S_UDT ||
+         sym.kind() == SymbolKind::S_CONSTANT;
+}
+
+void GlobalRecordSet::add(ArrayRef<uint8_t> record, uint64_t key) {
+  CachedHashStringRef s(toStringRef(record));
+  Shard &shard = shards[s.hash() % numShards];
+  std::lock_guard<std::mutex> lock(shard.mu);
+  auto p = shard.keys.insert({s, key});
+  if (!p.second)
+    p.first->second = std::min(p.first->second, key);
+}
+
+bool GlobalRecordSet::isKept(ArrayRef<uint8_t> record, uint64_t key) const {
+  CachedHashStringRef s(toStringRef(record));
+  return shards[s.hash() % numShards].keys.lookup(s) == key;
+}
+
+void StringPool::addTo(DebugStringTableSubsection &strTab) {
+  std::vector<std::pair<uint64_t, StringRef>> v;
+  for (Shard &shard : shards)
+    for (StringMapEntry<uint64_t> &e : shard.keys)
+      v.push_back({e.second, e.first()});
+
+  // A key is given to only one string, so this order is deterministic.
+  parallelSort(v, [](const std::pair<uint64_t, StringRef> &a,
+                     const std::pair<uint64_t, StringRef> &b) {
+    return a.first < b.first;
+  });
+  for (std::pair<uint64_t, StringRef> &p : v)
+    strTab.insert(p.second);
+}
+
+static Optional<StringRef>
+getObjString(uint32_t objIndex,
+             const DebugStringTableSubsectionRef &objStrTable) {
+  Expected<StringRef> expectedString = objStrTable.getString(objIndex);
   if (!expectedString) {
-    warn("Invalid string table reference");
     consumeError(expectedString.takeError());
-    return 0;
+    return None;
   }
+  return *expectedString;
+}
 
-  return pdbStrTable.insert(*expectedString);
+static uint32_t
+translateStringTableIndex(uint32_t objIndex,
+                          const DebugStringTableSubsectionRef &objStrTable,
+                          const DebugStringTableSubsection &pdbStrTable) {
+  if (Optional<StringRef> s = getObjString(objIndex, objStrTable))
+    return pdbStrTable.getIdForString(*s);
+  return 0;
 }
 
 void DebugSHandler::handleDebugS(lld::coff::SectionChunk &debugS) {
   DebugSubsectionArray subsections;
 
   ArrayRef<uint8_t> relocatedDebugContents = SectionChunk::consumeDebugMagic(
-      relocateDebugChunk(linker.alloc, debugS), debugS.getSectionName());
+      relocateDebugChunk(alloc, debugS), debugS.getSectionName());
 
   BinaryStreamReader reader(relocatedDebugContents, support::little);
   exitOnErr(reader.readArray(subsections, relocatedDebugContents.size()));
@@ -1030,8 +1565,7 @@ void DebugSHandler::handleDebugS(lld::coff::SectionChunk &debugS) {
       break;
     }
     case DebugSubsectionKind::Symbols: {
-      linker.mergeSymbolRecords(&file, indexMap, stringTableReferences,
-                                ss.getRecordData());
+      mergeSymbolRecords(ss.getRecordData());
       break;
     }
 
@@ -1081,7 +1615,7 @@ DebugSHandler::mergeInlineeLines(DebugChecksumsSubsection *newChecksums) {
     uint32_t sourceLine = line.Header->SourceLineNum;
 
     ArrayRef<TypeIndex> typeOrItemMap =
-        indexMap.isTypeServerMap ? indexMap.ipiMap : indexMap.tpiMap;
+        indexMap->isTypeServerMap ? indexMap->ipiMap : indexMap->tpiMap;
     if (!remapTypeIndex(inlinee, typeOrItemMap)) {
       log("ignoring inlinee line record in " + file.getName() +
           " with bad inlinee index 0x" + utohexstr(inlinee.getIndex()));
@@ -1105,22 +1639,40 @@ DebugSHandler::mergeInlineeLines(DebugChecksumsSubsection *newChecksums) {
   return newInlineeLines;
 }
 
-void DebugSHandler::finish() {
-  pdb::DbiStreamBuilder &dbiBuilder = linker.builder.getDbiBuilder();
+void DebugSHandler::collectStrings(StringPool &pool) {
+  // finish() reports a missing string table.
+  if (!cVStrTab.valid())
+    return;
 
-  // We should have seen all debug subsections across the entire object file now
-  // which means that if a StringTable subsection and Checksums subsection were
-  // present, now is the time to handle them.
-  if (!cVStrTab.valid()) {
-    if (checksums.valid())
-      fatal(".debug$S sections with a checksums subsection must also contain a "
-            "string table subsection");
+  // Strings are keyed by the module and the order of their use in the module,
+  // which is the order in which they used to be added serially.
+  uint64_t key = uint64_t(getModuleIndex()) << 32;
+  auto add = [&](uint32_t objIndex) {
+    if (Optional<StringRef> str = getObjString(objIndex, cVStrTab))
+      pool.add(*str, key++);
+    else
+      ++numBadStringReferences;
+  };
 
-    if (!stringTableReferences.empty())
-      warn("No StringTable subsection was encountered, but there are string "
-           "table references");
-    return;
+  for (DebugFrameDataSubsectionRef &fds : newFpoFrames)
+    for (const codeview::FrameData &fd : fds)
+      add(fd.FrameFunc);
+
+  for (ulittle32_t *ref : stringTableReferences)
+    add(*ref);
+
+  for (const FileChecksumEntry &fc : checksums) {
+    SmallString<128> filename =
+        exitOnErr(cVStrTab.getString(fc.FileNameOffset));
+    pdbMakeAbsolute(filename);
+    checksumFileNames.push_back(std::string(filename.str()));
+    pool.add(filename, key++);
   }
+}
+
+void DebugSHandler::remapStrings() {
+  if (!cVStrTab.valid())
+    return;
 
   // Rewrite string table indices in the Fpo Data and symbol records to refer to
   // the global PDB string table instead of the object file string table.
@@ -1130,7 +1682,7 @@ void DebugSHandler::finish() {
       fd.RvaStart += *reloc;
       fd.FrameFunc =
           translateStringTableIndex(fd.FrameFunc, cVStrTab, linker.pdbStrTab);
-      dbiBuilder.addNewFpoData(fd);
+      remappedFpoFrames.push_back(fd);
     }
   }
 
@@ -1140,15 +1692,67 @@ void DebugSHandler::finish() {
   // Make a new file checksum table that refers to offsets in the PDB-wide
   // string table. Generally the string table subsection appears after the
   // checksum table, so we have to do this after looping over all the
-  // subsections.
-  auto newChecksums = std::make_unique<DebugChecksumsSubsection>(linker.pdbStrTab);
-  for (FileChecksumEntry &fc : checksums) {
-    SmallString<128> filename =
-        exitOnErr(cVStrTab.getString(fc.FileNameOffset));
-    pdbMakeAbsolute(filename);
-    exitOnErr(dbiBuilder.addModuleSourceFile(*file.moduleDBI, filename));
-    newChecksums->addChecksum(filename, fc.Kind, fc.Checksum);
+  // subsections. The file names are in the PDB string table already, so
+  // this only reads the table.
+  newChecksums = std::make_unique<DebugChecksumsSubsection>(linker.pdbStrTab);
+  auto it = checksumFileNames.begin();
+  for (const FileChecksumEntry &fc : checksums)
+    newChecksums->addChecksum(*it++, fc.Kind, fc.Checksum);
+}
+
+void DebugSHandler::createGlobalRecords(GlobalRecordSet &udts) {
+  uint16_t modIndex = getModuleIndex();
+  uint64_t key = uint64_t(modIndex) << 32;
+  globalRecords.reserve(globalSymbols.size());
+  for (const std::pair<uint32_t, CVSymbol> &p : globalSymbols) {
+    globalRecords.push_back(
+        createGlobalRecord(alloc, modIndex, p.first, p.second));
+    if (isUdtOrConstant(p.second))
+      udts.add(p.second.data(), key++);
+  }
+}
+
+void DebugSHandler::finish(const GlobalRecordSet &udts) {
+  pdb::DbiStreamBuilder &dbiBuilder = linker.builder.getDbiBuilder();
+
+  for (const object::FpoData &fd : oldFpoFrames)
+    dbiBuilder.addOldFpoData(fd);
+
+  // Only the first copy of each S_UDT and S_CONSTANT record is added, which
+  // spares the globals stream builder from hashing the duplicates.
+  pdb::GSIStreamBuilder &gsiBuilder = linker.builder.getGsiBuilder();
+  uint64_t key = uint64_t(getModuleIndex()) << 32;
+  for (const CVSymbol &sym : globalRecords) {
+    if (!isUdtOrConstant(sym))
+      gsiBuilder.addGlobalSymbol(sym);
+    else if (udts.isKept(sym.data(), key++))
+      gsiBuilder.addGlobalSymbol(sym);
   }
+  linker.globalSymbols += globalSymbols.size();
+  linker.moduleSymbols += numModuleSymbols;
+
+  // We should have seen all debug subsections across the entire object file now
+  // which means that if a StringTable subsection and Checksums subsection were
+  // present, now is the time to handle them.
+  if (!cVStrTab.valid()) {
+    if (checksums.valid())
+      fatal(".debug$S sections with a checksums subsection must also contain a "
+            "string table subsection");
+
+    if (!stringTableReferences.empty())
+      warn("No StringTable subsection was encountered, but there are string "
+           "table references");
+    return;
+  }
+
+  for (uint32_t i = 0; i < numBadStringReferences; ++i)
+    warn("Invalid string table reference");
+
+  for (const codeview::FrameData &fd : remappedFpoFrames)
+    dbiBuilder.addNewFpoData(fd);
+
+  for (StringRef filename : checksumFileNames)
+    exitOnErr(dbiBuilder.addModuleSourceFile(*file.moduleDBI, filename));
 
   // Rewrite inlinee item indices if present.
   if (inlineeLines.valid())
@@ -1157,6 +1761,12 @@ void DebugSHandler::finish() {
   file.moduleDBI->addDebugSubsection(std::move(newChecksums));
 }
 
+void DebugSHandler::saveState(ModuleState &m) const {
+  m.reusable = oldFpoFrames.empty() && newFpoFrames.empty();
+  m.indexMap = *indexMap;
+  m.globals = globalSymbols;
+}
+
 void PDBLinker::addObjFile(ObjFile *file, CVIndexMap *externIndexMap) {
   if (file->mergedIntoPDB)
     return;
@@ -1166,12 +1776,14 @@ void PDBLinker::addObjFile(ObjFile *file, CVIndexMap *externIndexMap) {
   // type information, file checksums, and the string table.  Add type info to
   // the PDB first, so that we can get the map from object file type and item
   // indices to PDB type and item indices.
-  CVIndexMap objectIndexMap;
+  auto dsh = std::make_unique<DebugSHandler>(*this, *file);
   auto indexMapResult =
-      mergeDebugT(file, externIndexMap ? externIndexMap : &objectIndexMap);
+      mergeDebugT(file, externIndexMap ? externIndexMap : &dsh->objectIndexMap);
 
   // If the .debug$T sections fail to merge, assume there is no debug info.
   if (!indexMapResult) {
+    // The next link would not know that the object has no debug info.
+    state.typesKey = 0;
     if (!config->warnDebugInfoUnusable) {
       consumeError(indexMapResult.takeError());
       return;
@@ -1182,17 +1794,17 @@ void PDBLinker::addObjFile(ObjFile *file, CVIndexMap *externIndexMap) {
     return;
   }
 
-  ScopedTimer t(symbolMergingTimer);
+  dsh->indexMap = &*indexMapResult;
+  debugSHandlers.push_back(std::move(dsh));
+}
 
-  pdb::DbiStreamBuilder &dbiBuilder = builder.getDbiBuilder();
-  DebugSHandler dsh(*this, *file, *indexMapResult);
-  // Now do all live .debug$S and .debug$F sections.
-  for (SectionChunk *debugChunk : file->getDebugChunks()) {
+void DebugSHandler::handleDebugChunks() {
+  for (SectionChunk *debugChunk : file.getDebugChunks()) {
     if (!debugChunk->live || debugChunk->getSize() == 0)
       continue;
 
     if (debugChunk->getSectionName() == ".debug$S") {
-      dsh.handleDebugS(*debugChunk);
+      handleDebugS(*debugChunk);
       continue;
     }
 
@@ -1207,14 +1819,11 @@ void PDBLinker::addObjFile(ObjFile *file, CVIndexMap *externIndexMap) {
 
       // These are already relocated and don't refer to the string table, so we
       // can just copy it.
-      for (const object::FpoData &fd : fpoRecords)
-        dbiBuilder.addOldFpoData(fd);
+      oldFpoFrames.insert(oldFpoFrames.end(), fpoRecords.begin(),
+                          fpoRecords.end());
       continue;
     }
   }
-
-  // Do any post-processing now that all .debug$S sections have been processed.
-  dsh.finish();
 }
 
 // Add a module descriptor for every object file. We need to put an absolute
@@ -1249,6 +1858,327 @@ static void createModuleDBI(pdb::PDBFileBuilder &builder) {
   }
 }
 
+static const char pdbStateMagic[] = "LLDPDB01";
+static const char pdbStateStream[] = "/LLDIncrementalState";
+
+static uint64_t hashWords(ArrayRef<uint64_t> words) {
+  return xxHash64(StringRef(reinterpret_cast<const char *>(words.data()),
+                            words.size() * sizeof(uint64_t)));
+}
+
+// Returns a hash of the type records of all object files in link order, or 0
+// if an object uses a type server PDB or precompiled headers, whose type
+// records are not part of the object.
+static uint64_t getTypesKey() {
+  SmallString<128> cwd;
+  sys::fs::current_path(cwd);
+  std::vector<uint64_t> words = {config->debugGHashes, xxHash64(cwd),
+                                 xxHash64(config->pdbSourcePath)};
+  for (ObjFile *file : ObjFile::instances) {
+    if (file->debugTypesObj && file->debugTypesObj->kind != TpiSource::Regular)
+      return 0;
+    words.push_back(xxHash64(file->moduleDBI->getModuleName()));
+    words.push_back(xxHash64(file->moduleDBI->getObjFileName()));
+    words.push_back(xxHash64(toStringRef(file->getDebugSection(".debug$T"))));
+    words.push_back(xxHash64(toStringRef(file->getDebugSection(".debug$P"))));
+  }
+  return hashWords(words);
+}
+
+// Returns a hash of the live debug sections of an object file and of where
+// their relocations point to, which is what its module stream is made of if
+// the type index map of the object is the same.
+static uint64_t getModuleKey(ObjFile *file) {
+  std::vector<uint64_t> words;
+  for (SectionChunk *c : file->getDebugChunks()) {
+    if (!c->live || c->getSize() == 0)
+      continue;
+    words.push_back(xxHash64(c->getSectionName()));
+    words.push_back(xxHash64(toStringRef(c->getContents())));
+
+    for (const coff_relocation &r : c->getRelocs()) {
+      words.push_back(r.VirtualAddress | uint64_t(r.Type) << 32);
+      auto *d = dyn_cast_or_null<Defined>(file->getSymbol(r.SymbolTableIndex));
+      Chunk *chunk = d ? d->getChunk() : nullptr;
+      OutputSection *os = chunk ? chunk->getOutputSection() : nullptr;
+      words.push_back(d ? d->getRVA() : 0);
+      words.push_back(os ? uint64_t(os->sectionIndex) << 32 | os->getRVA() : 0);
+    }
+  }
+  return hashWords(words);
+}
+
+static void writeState(BinaryStreamWriter &writer,
+                       const IncrementalState &state) {
+  cantFail(writer.writeFixedString(pdbStateMagic));
+  cantFail(writer.writeInteger(state.typesKey));
+  cantFail(writer.writeInteger<uint32_t>(state.modules.size()));
+
+  for (const ModuleState &m : state.modules) {
+    cantFail(writer.writeInteger(m.key));
+    cantFail(writer.writeInteger<uint32_t>(m.reusable));
+    cantFail(writer.writeInteger<uint32_t>(m.indexMap.tpiMap.size()));
+    cantFail(writer.writeArray(makeArrayRef(m.indexMap.tpiMap)));
+    cantFail(writer.writeInteger<uint32_t>(m.indexMap.ipiMap.size()));
+    cantFail(writer.writeArray(makeArrayRef(m.indexMap.ipiMap)));
+    cantFail(writer.writeInteger<uint32_t>(m.globals.size()));
+    for (const std::pair<uint32_t, CVSymbol> &p : m.globals) {
+      cantFail(writer.writeInteger(p.first));
+      cantFail(writer.writeInteger<uint32_t>(p.second.RecordData.size()));
+      cantFail(writer.writeBytes(p.second.RecordData));
+    }
+  }
+}
+
+static Error readState(BinaryStreamReader &reader, IncrementalState &state) {
+  auto corrupted = [] {
+    return createStringError(inconvertibleErrorCode(),
+                             "the incremental link state is corrupted");
+  };
+
+  StringRef magic;
+  uint32_t numModules;
+  if (auto e = reader.readFixedString(magic, strlen(pdbStateMagic)))
+    return e;
+  if (magic != pdbStateMagic)
+    return corrupted();
+  if (auto e = reader.readInteger(state.typesKey))
+    return e;
+  if (auto e = reader.readInteger(numModules))
+    return e;
+  if (numModules > reader.bytesRemaining())
+    return corrupted();
+  state.modules.resize(numModules);
+
+  for (ModuleState &m : state.modules) {
+    uint32_t reusable, numTypes, numGlobals;
+    ArrayRef<TypeIndex> types;
+    if (auto e = reader.readInteger(m.key))
+      return e;
+    if (auto e = reader.readInteger(reusable))
+      return e;
+    m.reusable = reusable;
+
+    if (auto e = reader.readInteger(numTypes))
+      return e;
+    if (auto e = reader.readArray(types, numTypes))
+      return e;
+    m.indexMap.tpiMap.assign(types.begin(), types.end());
+    if (auto e = reader.readInteger(numTypes))
+      return e;
+    if (auto e = reader.readArray(types, numTypes))
+      return e;
+    m.indexMap.ipiMap.assign(types.begin(), types.end());
+
+    if (auto e = reader.readInteger(numGlobals))
+      return e;
+    for (uint32_t i = 0; i != numGlobals; ++i) {
+      uint32_t offset, size;
+      ArrayRef<uint8_t> data;
+      if (auto e = reader.readInteger(offset))
+        return e;
+      if (auto e = reader.readInteger(size))
+        return e;
+      if (auto e = reader.readBytes(data, size))
+        return e;
+      CVSymbol sym(data);
+      if (size < sizeof(RecordPrefix) ||
+          !symbolGoesInGlobalsStream(sym, /*isGlobalScope=*/true))
+        return corrupted();
+      m.globals.push_back({offset, sym});
+    }
+  }
+  return Error::success();
+}
+
+// Copies a stream of the previous PDB, whose stream objects don't live until
+// the PDB is written.
+static Expected<ArrayRef<uint8_t>> copyStream(BumpPtrAllocator &alloc,
+                                              BinaryStreamRef stream) {
+  ArrayRef<uint8_t> data;
+  if (auto e = stream.readBytes(0, stream.getLength(), data))
+    return std::move(e);
+  uint8_t *buffer = alloc.Allocate<uint8_t>(data.size());
+  memcpy(buffer, data.data(), data.size());
+  return makeArrayRef(buffer, data.size());
+}
+
+// Reads the symbols and the debug subsections of a module of the previous PDB.
+static Error readModule(BumpPtrAllocator &alloc,
+                        pdb::ModuleDebugStreamRef &modStream,
+                        ArrayRef<uint8_t> &symbols,
+                        DebugSubsectionArray &subsections) {
+  if (auto e = modStream.reload())
+    return e;
+  Expected<ArrayRef<uint8_t>> syms =
+      copyStream(alloc, modStream.getSymbolsSubstream().StreamData);
+  if (!syms)
+    return syms.takeError();
+  Expected<ArrayRef<uint8_t>> c13 =
+      copyStream(alloc, modStream.getC13LinesSubstream().StreamData);
+  if (!c13)
+    return c13.takeError();
+
+  symbols = *syms;
+  BinaryStreamReader reader(*c13, support::little);
+  return reader.readArray(subsections, c13->size());
+}
+
+Error PDBLinker::loadPreviousPDB() {
+  // The previous PDB is read into memory because it is overwritten.
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr = MemoryBuffer::getFile(
+      config->pdbPath, /*FileSize=*/-1, /*RequiresNullTerminator=*/false,
+      /*IsVolatile=*/true);
+  if (!mbOrErr)
+    return errorCodeToError(mbOrErr.getError());
+
+  std::unique_ptr<pdb::IPDBSession> iSession;
+  if (auto e = pdb::NativeSession::createFromPdb(std::move(*mbOrErr), iSession))
+    return e;
+  previousSession.reset(static_cast<pdb::NativeSession *>(iSession.release()));
+  pdb::PDBFile &pdbFile = previousSession->getPDBFile();
+
+  Expected<pdb::InfoStream &> info = pdbFile.getPDBInfoStream();
+  if (!info)
+    return info.takeError();
+  Expected<uint32_t> sn = info->getNamedStreamIndex(pdbStateStream);
+  if (!sn)
+    return sn.takeError();
+  if (*sn >= pdbFile.getNumStreams())
+    return createStringError(inconvertibleErrorCode(), "invalid stream index");
+  Expected<ArrayRef<uint8_t>> data =
+      copyStream(alloc, *pdbFile.createIndexedStream(*sn));
+  if (!data)
+    return data.takeError();
+
+  BinaryStreamReader reader(*data, support::little);
+  if (auto e = readState(reader, previousState))
+    return e;
+  if (previousState.typesKey != state.typesKey)
+    return createStringError(inconvertibleErrorCode(),
+                             "the type records changed");
+
+  Expected<pdb::DbiStream &> dbi = pdbFile.getPDBDbiStream();
+  if (!dbi)
+    return dbi.takeError();
+  if (previousState.modules.size() != state.modules.size() ||
+      dbi->modules().getModuleCount() < state.modules.size())
+    return createStringError(inconvertibleErrorCode(),
+                             "the number of modules changed");
+  Expected<pdb::TpiStream &> tpi = pdbFile.getPDBTpiStream();
+  if (!tpi)
+    return tpi.takeError();
+  Expected<pdb::TpiStream &> ipi = pdbFile.getPDBIpiStream();
+  if (!ipi)
+    return ipi.takeError();
+
+  // Modules refer to strings by their offsets in the PDB string table, so the
+  // strings of the previous PDB are added first and at the same offsets. The
+  // table was written by an earlier link, so its strings are contiguous.
+  Expected<pdb::PDBStringTable &> strTab = pdbFile.getStringTable();
+  if (!strTab)
+    return strTab.takeError();
+  std::vector<uint32_t> ids(strTab->name_ids().begin(),
+                            strTab->name_ids().end());
+  llvm::sort(ids);
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+  std::vector<StringRef> strings;
+  uint32_t offset = 1;
+  for (uint32_t id : ids) {
+    if (id == 0)
+      continue;
+    Expected<StringRef> str = strTab->getStringForID(id);
+    if (!str)
+      return str.takeError();
+    if (id != offset)
+      return createStringError(inconvertibleErrorCode(),
+                               "the string table has a gap");
+    strings.push_back(*str);
+    offset += str->size() + 1;
+  }
+  for (StringRef str : strings)
+    pdbStrTab.insert(str);
+  return Error::success();
+}
+
+void PDBLinker::initIncrementalState() {
+  state.typesKey = getTypesKey();
+  state.modules.resize(ObjFile::instances.size());
+  parallelForEachN(0, ObjFile::instances.size(), [&](size_t i) {
+    state.modules[i].key = getModuleKey(ObjFile::instances[i]);
+  });
+
+  if (!state.typesKey) {
+    log("incremental: an object uses a type server or precompiled headers; "
+        "rebuilding " + config->pdbPath);
+    return;
+  }
+  if (auto e = loadPreviousPDB()) {
+    log("incremental: rebuilding " + config->pdbPath + ": " +
+        toString(std::move(e)));
+    previousSession.reset();
+    return;
+  }
+  reuseTypes = true;
+}
+
+bool PDBLinker::reuseModule(ObjFile *file) {
+  pdb::DbiModuleDescriptorBuilder &mod = *file->moduleDBI;
+  uint32_t modi = mod.getModuleIndex();
+  const ModuleState &prev = previousState.modules[modi];
+  if (!prev.reusable || prev.key != state.modules[modi].key)
+    return false;
+
+  pdb::PDBFile &pdbFile = previousSession->getPDBFile();
+  const pdb::DbiModuleList &modules =
+      cantFail(pdbFile.getPDBDbiStream()).modules();
+  pdb::DbiModuleDescriptor desc = modules.getModuleDescriptor(modi);
+  uint16_t sn = desc.getModuleStreamIndex();
+  if (desc.getModuleName() != mod.getModuleName() ||
+      sn >= pdbFile.getNumStreams())
+    return false;
+
+  pdb::ModuleDebugStreamRef modStream(desc, pdbFile.createIndexedStream(sn));
+  ArrayRef<uint8_t> symbols;
+  DebugSubsectionArray subsections;
+  if (auto e = readModule(alloc, modStream, symbols, subsections)) {
+    log("incremental: cannot reuse the module " + mod.getModuleName() + ": " +
+        toString(std::move(e)));
+    return false;
+  }
+
+  // The module is copied as is. Only what it adds to the PDB-wide streams
+  // has to be added again.
+  mod.addSymbolsInBulk(symbols);
+  for (const DebugSubsectionRecord &ss : subsections)
+    mod.addDebugSubsection(ss);
+  for (StringRef filename : modules.source_files(modi))
+    exitOnErr(builder.getDbiBuilder().addModuleSourceFile(mod, filename));
+  for (const std::pair<uint32_t, CVSymbol> &p : prev.globals)
+    builder.getGsiBuilder().addGlobalSymbol(
+        createGlobalRecord(alloc, modi, p.first, p.second));
+  globalSymbols += prev.globals.size();
+
+  state.modules[modi] = prev;
+  file->mergedIntoPDB = true;
+  ++reusedModules;
+  return true;
+}
+
+void PDBLinker::addIncrementalState() {
+  if (!state.typesKey) {
+    log("incremental: not saving the state of " + config->pdbPath);
+    return;
+  }
+
+  AppendingBinaryByteStream stream(support::little);
+  BinaryStreamWriter writer(stream);
+  writeState(writer, state);
+  stateData = std::string(toStringRef(stream.data()));
+  exitOnErr(builder.addNamedStream(pdbStateStream, stateData));
+}
+
 static PublicSym32 createPublic(Defined *def) {
   PublicSym32 pub(SymbolKind::S_PUB32);
   pub.Name = def->getName();
@@ -1273,16 +2203,57 @@ void PDBLinker::addObjectsToPDB() {
 
   createModuleDBI(builder);
 
+  if (config->incrementalPdb)
+    initIncrementalState();
+
+  if (config->debugGHashes && !reuseTypes)
+    mergeGHashTypesInParallel();
+
   for (ObjFile *file : ObjFile::instances)
-    addObjFile(file);
+    if (!reuseTypes || !reuseModule(file))
+      addObjFile(file);
+
+  // Now that all types are merged, symbols of objects are merged in
+  // parallel. Only what goes to the PDB-wide streams is added serially.
+  {
+    ScopedTimer t(symbolMergingTimer);
+    StringPool pool;
+    GlobalRecordSet udts;
+    parallelForEach(debugSHandlers, [&](std::unique_ptr<DebugSHandler> &dsh) {
+      dsh->handleDebugChunks();
+      dsh->collectStrings(pool);
+      dsh->createGlobalRecords(udts);
+    });
+    pool.addTo(pdbStrTab);
+    parallelForEach(debugSHandlers, [](std::unique_ptr<DebugSHandler> &dsh) {
+      dsh->remapStrings();
+    });
+    for (std::unique_ptr<DebugSHandler> &dsh : debugSHandlers)
+      dsh->finish(udts);
+  }
+
+  if (config->incrementalPdb) {
+    for (std::unique_ptr<DebugSHandler> &dsh : debugSHandlers)
+      dsh->saveState(state.modules[dsh->getModuleIndex()]);
+    if (reuseTypes)
+      log("incremental: reused the types and " + Twine(reusedModules) +
+          " of " + Twine(ObjFile::instances.size()) + " modules of " +
+          config->pdbPath);
+  }
 
   builder.getStringTableBuilder().setStrings(pdbStrTab);
   t1.stop();
 
   // Construct TPI and IPI stream contents.
   ScopedTimer t2(tpiStreamLayoutTimer);
-  addTypeInfo(builder.getTpiBuilder(), tMerger.getTypeTable());
-  addTypeInfo(builder.getIpiBuilder(), tMerger.getIDTable());
+  if (reuseTypes) {
+    pdb::PDBFile &pdbFile = previousSession->getPDBFile();
+    addTypeInfo(builder.getTpiBuilder(), cantFail(pdbFile.getPDBTpiStream()));
+    addTypeInfo(builder.getIpiBuilder(), cantFail(pdbFile.getPDBIpiStream()));
+  } else {
+    addTypeInfo(builder.getTpiBuilder(), tMerger.getTypeTable());
+    addTypeInfo(builder.getIpiBuilder(), tMerger.getIDTable());
+  }
   t2.stop();
 
   ScopedTimer t3(globalsLayoutTimer);
@@ -1331,6 +2302,7 @@ void PDBLinker::printStats() {
   print(globalSymbols, "Global symbol records");
   print(moduleSymbols, "Module symbol records");
   print(publicSymbols, "Public symbol records");
+  print(reusedModules, "Module streams reused from the previous PDB");
 
   message(buffer);
 }
@@ -1602,6 +2574,8 @@ void createPDB(SymbolTable *symtab,
   pdb.addImportFilesToPDB(outputSections);
   pdb.addSections(outputSections, sectionTable);
   pdb.addNatvisFiles();
+  if (config->incrementalPdb)
+    pdb.addIncrementalState();
 
   ScopedTimer t2(diskCommitTimer);
   codeview::GUID guid;
@@ -1685,7 +2659,17 @@ void PDBLinker::addSections(ArrayRef<OutputSection *> outputSections,
 
 void PDBLinker::commit(codeview::GUID *guid) {
   ExitOnError exitOnErr((config->pdbPath + ": ").str());
-  // Write to a file.
+
+  // PDBs can be gigabytes in size, and removing the previous one can take a
+  // noticeable part of the commit time on Unix. Any part of it that is still
+  // used by an incremental link stays mapped after the file is removed.
+  unlinkAsync(config->pdbPath);
+
+  // Write to a file. The MSF layout is finalized and the streams are
+  // serialized one after another by PDBFileBuilder::commit, which is part of
+  // LLVM rather than lld. It writes into a memory-mapped output buffer, but
+  // serializing the TPI, IPI, module and globals streams in parallel would
+  // have to be done there; lld only sees the finished file.
   exitOnErr(builder.commit(config->pdbPath, guid));
 }
 
@@ -1704,33 +2688,45 @@ static uint32_t getSecrelReloc() {
   }
 }
 
-// Try to find a line table for the given offset Addr into the given chunk C.
-// If a line table was found, the line table, the string and checksum tables
-// that are used to interpret the line table, and the offset of Addr in the line
-// table are stored in the output arguments. Returns whether a line table was
-// found.
-static bool findLineTable(const SectionChunk *c, uint32_t addr,
-                          DebugStringTableSubsectionRef &cVStrTab,
-                          DebugChecksumsSubsectionRef &checksums,
-                          DebugLinesSubsectionRef &lines,
-                          uint32_t &offsetInLinetable) {
+struct CodeViewLineTables::Tables {
+  // A line table and the range of offsets in its section that it covers.
+  struct LineTable {
+    uint32_t begin;
+    uint32_t end;
+    DebugLinesSubsectionRef lines;
+  };
+
+  DebugStringTableSubsectionRef cVStrTab;
+  DebugChecksumsSubsectionRef checksums;
+  DenseMap<const SectionChunk *, std::vector<LineTable>> lineTables;
+};
+
+CodeViewLineTables::CodeViewLineTables(ObjFile *file) : file(file) {}
+
+CodeViewLineTables::~CodeViewLineTables() = default;
+
+// Reads the line tables of all .debug$S sections of a file, and the string
+// and checksum tables that are used to interpret them.
+void CodeViewLineTables::readTables() {
   ExitOnError exitOnErr;
+  tables = std::make_unique<Tables>();
+  Tables &t = *tables;
   uint32_t secrelReloc = getSecrelReloc();
 
-  for (SectionChunk *dbgC : c->file->getDebugChunks()) {
+  for (SectionChunk *dbgC : file->getDebugChunks()) {
     if (dbgC->getSectionName() != ".debug$S")
       continue;
 
-    // Build a mapping of SECREL relocations in dbgC that refer to `c`.
-    DenseMap<uint32_t, uint32_t> secrels;
+    // Build a mapping of SECREL relocations in dbgC to the symbols they
+    // refer to.
+    DenseMap<uint32_t, DefinedRegular *> secrels;
     for (const coff_relocation &r : dbgC->getRelocs()) {
       if (r.Type != secrelReloc)
         continue;
-
       if (auto *s = dyn_cast_or_null<DefinedRegular>(
-              c->file->getSymbols()[r.SymbolTableIndex]))
-        if (s->getChunk() == c)
-          secrels[r.VirtualAddress] = s->getValue();
+              file->getSymbols()[r.SymbolTableIndex]))
+        if (s->data)
+          secrels[r.VirtualAddress] = s;
     }
 
     ArrayRef<uint8_t> contents =
@@ -1741,16 +2737,13 @@ static bool findLineTable(const SectionChunk *c, uint32_t addr,
 
     for (const DebugSubsectionRecord &ss : subsections) {
       switch (ss.kind()) {
-      case DebugSubsectionKind::StringTable: {
-        assert(!cVStrTab.valid() &&
-               "Encountered multiple string table subsections!");
-        exitOnErr(cVStrTab.initialize(ss.getRecordData()));
+      case DebugSubsectionKind::StringTable:
+        if (!t.cVStrTab.valid())
+          exitOnErr(t.cVStrTab.initialize(ss.getRecordData()));
         break;
-      }
       case DebugSubsectionKind::FileChecksums:
-        assert(!checksums.valid() &&
-               "Encountered multiple checksum subsections!");
-        exitOnErr(checksums.initialize(ss.getRecordData()));
+        if (!t.checksums.valid())
+          exitOnErr(t.checksums.initialize(ss.getRecordData()));
         break;
       case DebugSubsectionKind::Lines: {
         ArrayRef<uint8_t> bytes;
@@ -1758,54 +2751,55 @@ static bool findLineTable(const SectionChunk *c, uint32_t addr,
         exitOnErr(ref.readLongestContiguousChunk(0, bytes));
         size_t offsetInDbgC = bytes.data() - dbgC->getContents().data();
 
-        // Check whether this line table refers to C.
+        // Find the section that this line table refers to.
         auto i = secrels.find(offsetInDbgC);
         if (i == secrels.end())
           break;
 
-        // Check whether this line table covers Addr in C.
-        DebugLinesSubsectionRef linesTmp;
-        exitOnErr(linesTmp.initialize(BinaryStreamReader(ref)));
-        uint32_t offsetInC = i->second + linesTmp.header()->RelocOffset;
-        if (addr < offsetInC || addr >= offsetInC + linesTmp.header()->CodeSize)
-          break;
-
-        assert(!lines.header() &&
-               "Encountered multiple line tables for function!");
+        DebugLinesSubsectionRef lines;
         exitOnErr(lines.initialize(BinaryStreamReader(ref)));
-        offsetInLinetable = addr - offsetInC;
+        DefinedRegular *s = i->second;
+        uint32_t begin = s->getValue() + lines.header()->RelocOffset;
+        t.lineTables[s->getChunk()].push_back(
+            {begin, begin + lines.header()->CodeSize, lines});
         break;
       }
       default:
         break;
       }
-
-      if (cVStrTab.valid() && checksums.valid() && lines.header())
-        return true;
     }
   }
-
-  return false;
 }
 
-// Use CodeView line tables to resolve a file and line number for the given
-// offset into the given chunk and return them, or None if a line table was
-// not found.
 Optional<std::pair<StringRef, uint32_t>>
-getFileLineCodeView(const SectionChunk *c, uint32_t addr) {
+CodeViewLineTables::getFileLine(const SectionChunk *c, uint32_t addr) {
   ExitOnError exitOnErr;
 
-  DebugStringTableSubsectionRef cVStrTab;
-  DebugChecksumsSubsectionRef checksums;
-  DebugLinesSubsectionRef lines;
-  uint32_t offsetInLinetable;
+  if (!tables)
+    readTables();
+  if (!tables->cVStrTab.valid() || !tables->checksums.valid())
+    return None;
 
-  if (!findLineTable(c, addr, cVStrTab, checksums, lines, offsetInLinetable))
+  // Find the line table that covers Addr in C.
+  auto it = tables->lineTables.find(c);
+  if (it == tables->lineTables.end())
+    return None;
+  const Tables::LineTable *table = nullptr;
+  for (const Tables::LineTable &t : it->second) {
+    if (t.begin <= addr && addr < t.end) {
+      table = &t;
+      break;
+    }
+  }
+  if (!table)
     return None;
 
+  uint32_t offsetInLinetable = addr - table->begin;
+  const DebugStringTableSubsectionRef &cVStrTab = tables->cVStrTab;
+  const DebugChecksumsSubsectionRef &checksums = tables->checksums;
   Optional<uint32_t> nameIndex;
   Optional<uint32_t> lineNumber;
-  for (LineColumnEntry &entry : lines) {
+  for (LineColumnEntry &entry : table->lines) {
     for (const LineNumberEntry &ln : entry.LineNumbers) {
       LineInfo li(ln.Flags);
       if (ln.Offset > offsetInLinetable) {
@@ -1827,5 +2821,13 @@ getFileLineCodeView(const SectionChunk *c, uint32_t addr) {
   return std::make_pair(filename, *lineNumber);
 }
 
+// Use CodeView line tables to resolve a file and line number for the given
+// offset into the given chunk and return them, or None if a line table was
+// not found.
+Optional<std::pair<StringRef, uint32_t>>
+getFileLineCodeView(const SectionChunk *c, uint32_t addr) {
+  return CodeViewLineTables(c->file).getFileLine(c, addr);
+}
+
 } // namespace coff
 } // namespace lld
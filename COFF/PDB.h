@@ -12,6 +12,7 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringRef.h"
+#include <memory>
 
 namespace llvm {
 namespace codeview {
@@ -21,6 +22,7 @@ union DebugInfo;
 
 namespace lld {
 namespace coff {
+class ObjFile;
 class OutputSection;
 class SectionChunk;
 class SymbolTable;
@@ -32,6 +34,26 @@ void createPDB(SymbolTable *symtab,
 
 llvm::Optional<std::pair<llvm::StringRef, uint32_t>>
 getFileLineCodeView(const SectionChunk *c, uint32_t addr);
+
+// The CodeView line tables of an object file, which are read when they are
+// first needed. Use this instead of getFileLineCodeView() to look up many
+// addresses in the same file. Different instances can be used in parallel.
+class CodeViewLineTables {
+public:
+  explicit CodeViewLineTables(ObjFile *file);
+  ~CodeViewLineTables();
+
+  llvm::Optional<std::pair<llvm::StringRef, uint32_t>>
+  getFileLine(const SectionChunk *c, uint32_t addr);
+
+private:
+  struct Tables;
+
+  void readTables();
+
+  ObjFile *file;
+  std::unique_ptr<Tables> tables;
+};
 } // namespace coff
 } // namespace lld
 
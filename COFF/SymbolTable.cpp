@@ -14,6 +14,7 @@
 #include "Symbols.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
 #include "lld/Common/Timer.h"
 #include "llvm/DebugInfo/Symbolize/Symbolize.h"
 #include "llvm/IR/LLVMContext.h"
@@ -80,16 +81,15 @@ static void forceLazy(Symbol *s) {
   }
 }
 
-// Returns the symbol in SC whose value is <= Addr that is closest to Addr.
-// This is generally the global variable or function whose definition contains
-// Addr.
-static Symbol *getSymbol(SectionChunk *sc, uint32_t addr) {
+// Returns the symbol among Candidates whose value is <= Addr that is closest
+// to Addr. This is generally the global variable or function whose definition
+// contains Addr.
+static Symbol *getSymbol(ArrayRef<DefinedRegular *> candidates,
+                         uint32_t addr) {
   DefinedRegular *candidate = nullptr;
 
-  for (Symbol *s : sc->file->getSymbols()) {
-    auto *d = dyn_cast_or_null<DefinedRegular>(s);
-    if (!d || !d->data || d->file != sc->file || d->getChunk() != sc ||
-        d->getValue() > addr ||
+  for (DefinedRegular *d : candidates) {
+    if (d->getValue() > addr ||
         (candidate && d->getValue() < candidate->getValue()))
       continue;
 
@@ -108,7 +108,9 @@ static std::vector<std::string> getSymbolLocations(BitcodeFile *file) {
   return {res};
 }
 
-static Optional<std::pair<StringRef, uint32_t>>
+// The file names returned by the functions below are not saved, so that they
+// can be used in parallel.
+static Optional<std::pair<std::string, uint32_t>>
 getFileLineDwarf(const SectionChunk *c, uint32_t addr) {
   Optional<DILineInfo> optionalLineInfo =
       c->file->getDILineInfo(addr, c->getSectionNumber() - 1);
@@ -117,66 +119,111 @@ getFileLineDwarf(const SectionChunk *c, uint32_t addr) {
   const DILineInfo &lineInfo = *optionalLineInfo;
   if (lineInfo.FileName == DILineInfo::BadString)
     return None;
-  return std::make_pair(saver.save(lineInfo.FileName), lineInfo.Line);
+  return std::make_pair(lineInfo.FileName, lineInfo.Line);
 }
 
-static Optional<std::pair<StringRef, uint32_t>>
-getFileLine(const SectionChunk *c, uint32_t addr) {
+static Optional<std::pair<std::string, uint32_t>>
+getFileLine(CodeViewLineTables &lineTables, const SectionChunk *c,
+            uint32_t addr) {
   // MinGW can optionally use codeview, even if the default is dwarf.
   Optional<std::pair<StringRef, uint32_t>> fileLine =
-      getFileLineCodeView(c, addr);
+      lineTables.getFileLine(c, addr);
+  if (fileLine)
+    return std::make_pair(std::string(fileLine->first), fileLine->second);
   // If codeview didn't yield any result, check dwarf in MinGW mode.
-  if (!fileLine && config->mingw)
-    fileLine = getFileLineDwarf(c, addr);
-  return fileLine;
+  if (config->mingw)
+    return getFileLineDwarf(c, addr);
+  return None;
 }
 
-// Given a file and the index of a symbol in that file, returns a description
-// of all references to that symbol from that file. If no debug information is
-// available, returns just the name of the file, else one string per actual
-// reference as described in the debug info.
-std::vector<std::string> getSymbolLocations(ObjFile *file, uint32_t symIndex) {
+// Given a file and the indices of some symbols in that file, returns a
+// description of all references to each symbol from that file. If no debug
+// information is available, returns just the name of the file, else one
+// string per actual reference as described in the debug info.
+//
+// The relocations of the file are scanned once for all symbols, and its line
+// tables are read only once. This does not modify any global state, so it can
+// be called for different files in parallel, as long as the DWARF context of
+// the file has been created in MinGW mode.
+static std::vector<std::vector<std::string>>
+getSymbolLocations(ObjFile *file, ArrayRef<uint32_t> symIndices) {
   struct Location {
     Symbol *sym;
-    std::pair<StringRef, uint32_t> fileLine;
+    std::pair<std::string, uint32_t> fileLine;
+  };
+  std::vector<std::vector<Location>> locations(symIndices.size());
+
+  DenseMap<uint32_t, size_t> slots;
+  for (size_t i = 0; i < symIndices.size(); ++i)
+    slots.insert({symIndices[i], i});
+
+  // The symbols defined in each chunk, which are the candidates for
+  // getSymbol(). They are computed when they are first needed.
+  DenseMap<const SectionChunk *, std::vector<DefinedRegular *>> chunkSymbols;
+  bool hasChunkSymbols = false;
+  auto getChunkSymbols = [&](SectionChunk *sc) -> ArrayRef<DefinedRegular *> {
+    if (!hasChunkSymbols) {
+      hasChunkSymbols = true;
+      for (Symbol *s : file->getSymbols()) {
+        auto *d = dyn_cast_or_null<DefinedRegular>(s);
+        if (d && d->data && d->file == file)
+          if (auto *c = dyn_cast<SectionChunk>(d->getChunk()))
+            chunkSymbols[c].push_back(d);
+      }
+    }
+    return chunkSymbols.lookup(sc);
   };
-  std::vector<Location> locations;
 
+  CodeViewLineTables lineTables(file);
   for (Chunk *c : file->getChunks()) {
     auto *sc = dyn_cast<SectionChunk>(c);
     if (!sc)
       continue;
     for (const coff_relocation &r : sc->getRelocs()) {
-      if (r.SymbolTableIndex != symIndex)
+      auto it = slots.find(r.SymbolTableIndex);
+      if (it == slots.end())
         continue;
-      Optional<std::pair<StringRef, uint32_t>> fileLine =
-          getFileLine(sc, r.VirtualAddress);
-      Symbol *sym = getSymbol(sc, r.VirtualAddress);
+      Optional<std::pair<std::string, uint32_t>> fileLine =
+          getFileLine(lineTables, sc, r.VirtualAddress);
+      Symbol *sym = getSymbol(getChunkSymbols(sc), r.VirtualAddress);
       if (fileLine)
-        locations.push_back({sym, *fileLine});
+        locations[it->second].push_back({sym, std::move(*fileLine)});
       else if (sym)
-        locations.push_back({sym, {"", 0}});
+        locations[it->second].push_back({sym, {"", 0}});
     }
   }
 
-  if (locations.empty())
-    return std::vector<std::string>({"\n>>> referenced by " + toString(file)});
-
-  std::vector<std::string> symbolLocations(locations.size());
-  size_t i = 0;
-  for (Location loc : locations) {
-    llvm::raw_string_ostream os(symbolLocations[i++]);
-    os << "\n>>> referenced by ";
-    if (!loc.fileLine.first.empty())
-      os << loc.fileLine.first << ":" << loc.fileLine.second
-         << "\n>>>               ";
-    os << toString(file);
-    if (loc.sym)
-      os << ":(" << toString(*loc.sym) << ')';
+  std::vector<std::vector<std::string>> symbolLocations(symIndices.size());
+  for (size_t i = 0; i < symIndices.size(); ++i) {
+    size_t slot = slots.lookup(symIndices[i]);
+    if (slot != i) {
+      symbolLocations[i] = symbolLocations[slot];
+      continue;
+    }
+    if (locations[i].empty()) {
+      symbolLocations[i].push_back("\n>>> referenced by " + toString(file));
+      continue;
+    }
+    for (const Location &loc : locations[i]) {
+      std::string str;
+      llvm::raw_string_ostream os(str);
+      os << "\n>>> referenced by ";
+      if (!loc.fileLine.first.empty())
+        os << loc.fileLine.first << ":" << loc.fileLine.second
+           << "\n>>>               ";
+      os << toString(file);
+      if (loc.sym)
+        os << ":(" << toString(*loc.sym) << ')';
+      symbolLocations[i].push_back(os.str());
+    }
   }
   return symbolLocations;
 }
 
+std::vector<std::string> getSymbolLocations(ObjFile *file, uint32_t symIndex) {
+  return std::move(getSymbolLocations(file, makeArrayRef(symIndex))[0]);
+}
+
 std::vector<std::string> getSymbolLocations(InputFile *file,
                                             uint32_t symIndex) {
   if (auto *o = dyn_cast<ObjFile>(file))
@@ -194,6 +241,9 @@ struct UndefinedDiag {
   struct File {
     InputFile *file;
     uint32_t symIndex;
+    // The description of each reference, which is computed in parallel
+    // before the diagnostic is reported.
+    std::vector<std::string> locations;
   };
   std::vector<File> files;
 };
@@ -206,10 +256,8 @@ static void reportUndefinedSymbol(const UndefinedDiag &undefDiag) {
   const size_t maxUndefReferences = 10;
   size_t i = 0, numRefs = 0;
   for (const UndefinedDiag::File &ref : undefDiag.files) {
-    std::vector<std::string> symbolLocations =
-        getSymbolLocations(ref.file, ref.symIndex);
-    numRefs += symbolLocations.size();
-    for (const std::string &s : symbolLocations) {
+    numRefs += ref.locations.size();
+    for (const std::string &s : ref.locations) {
       if (i >= maxUndefReferences)
         break;
       os << s;
@@ -340,9 +388,9 @@ reportProblemSymbols(const SmallPtrSetImpl<Symbol *> &undefs,
         auto it = firstDiag.find(sym);
         if (it == firstDiag.end()) {
           firstDiag[sym] = undefDiags.size();
-          undefDiags.push_back({sym, {{file, symIndex}}});
+          undefDiags.push_back({sym, {{file, symIndex, {}}}});
         } else {
-          undefDiags[it->second].files.push_back({file, symIndex});
+          undefDiags[it->second].files.push_back({file, symIndex, {}});
         }
       }
       if (localImports)
@@ -360,6 +408,43 @@ reportProblemSymbols(const SmallPtrSetImpl<Symbol *> &undefs,
     for (BitcodeFile *file : *bitcodeFiles)
       processFile(file, file->getSymbols());
 
+  // Finding the references to undefined symbols requires reading debug info,
+  // which can be slow, so the references in each object file are found in
+  // parallel. The diagnostics are then reported in the same order as before.
+  struct FileRefs {
+    ObjFile *file;
+    std::vector<uint32_t> symIndices;
+    std::vector<UndefinedDiag::File *> refs;
+  };
+  std::vector<FileRefs> fileRefs;
+  DenseMap<ObjFile *, size_t> fileRefsIndex;
+  for (UndefinedDiag &undefDiag : undefDiags) {
+    for (UndefinedDiag::File &ref : undefDiag.files) {
+      auto *obj = dyn_cast<ObjFile>(ref.file);
+      if (!obj) {
+        ref.locations = getSymbolLocations(ref.file, ref.symIndex);
+        continue;
+      }
+      auto p = fileRefsIndex.insert({obj, fileRefs.size()});
+      if (p.second)
+        fileRefs.push_back({obj, {}, {}});
+      FileRefs &f = fileRefs[p.first->second];
+      f.symIndices.push_back(ref.symIndex);
+      f.refs.push_back(&ref);
+    }
+  }
+
+  if (config->mingw)
+    for (FileRefs &f : fileRefs)
+      f.file->initializeDwarf();
+
+  parallelForEach(fileRefs, [](FileRefs &f) {
+    std::vector<std::vector<std::string>> locations =
+        getSymbolLocations(f.file, f.symIndices);
+    for (size_t i = 0; i < f.refs.size(); ++i)
+      f.refs[i]->locations = std::move(locations[i]);
+  });
+
   for (const UndefinedDiag &undefDiag : undefDiags)
     reportUndefinedSymbol(undefDiag);
 }
@@ -529,11 +614,15 @@ static std::string getSourceLocationBitcode(BitcodeFile *file) {
 
 static std::string getSourceLocationObj(ObjFile *file, SectionChunk *sc,
                                         uint32_t offset, StringRef name) {
-  Optional<std::pair<StringRef, uint32_t>> fileLine;
-  if (sc)
-    fileLine = getFileLine(sc, offset);
+  Optional<std::pair<std::string, uint32_t>> fileLine;
+  if (sc) {
+    CodeViewLineTables lineTables(file);
+    fileLine = getFileLine(lineTables, sc, offset);
+  }
   if (!fileLine)
-    fileLine = file->getVariableLocation(name);
+    if (Optional<std::pair<StringRef, uint32_t>> varLoc =
+            file->getVariableLocation(name))
+      fileLine = std::make_pair(std::string(varLoc->first), varLoc->second);
 
   std::string res;
   llvm::raw_string_ostream os(res);
@@ -726,19 +815,29 @@ Symbol *SymbolTable::findUnderscore(StringRef name) {
   return find(name);
 }
 
-// Return all symbols that start with Prefix, possibly ignoring the first
-// character of Prefix or the first character symbol.
-std::vector<Symbol *> SymbolTable::getSymsWithPrefix(StringRef prefix) {
-  std::vector<Symbol *> syms;
-  for (auto pair : symMap) {
-    StringRef name = pair.first.val();
-    if (name.startswith(prefix) || name.startswith(prefix.drop_front()) ||
-        name.drop_front().startswith(prefix) ||
-        name.drop_front().startswith(prefix.drop_front())) {
-      syms.push_back(pair.second);
-    }
+// Returns the symbol with the smallest name that starts with Prefix.
+Symbol *SymbolTable::findFirstWithPrefix(StringRef prefix) {
+  // findMangle is usually called many times in a row between additions of
+  // new symbols, so the cost of sorting is shared by those calls.
+  if (sortedSymbols.size() != symMap.size()) {
+    sortedSymbols.clear();
+    sortedSymbols.reserve(symMap.size());
+    for (auto &pair : symMap)
+      sortedSymbols.push_back({pair.first.val(), pair.second});
+    parallelSort(sortedSymbols, [](const std::pair<StringRef, Symbol *> &a,
+                                   const std::pair<StringRef, Symbol *> &b) {
+      return a.first < b.first;
+    });
   }
-  return syms;
+
+  auto it = llvm::lower_bound(
+      sortedSymbols, prefix,
+      [](const std::pair<StringRef, Symbol *> &a, StringRef b) {
+        return a.first < b;
+      });
+  if (it != sortedSymbols.end() && it->first.startswith(prefix))
+    return it->second;
+  return nullptr;
 }
 
 Symbol *SymbolTable::findMangle(StringRef name) {
@@ -746,17 +845,11 @@ Symbol *SymbolTable::findMangle(StringRef name) {
     if (!isa<Undefined>(sym))
       return sym;
 
-  // Efficient fuzzy string lookup is impossible with a hash table, so iterate
-  // the symbol table once and collect all possibly matching symbols into this
-  // vector. Then compare each possibly matching symbol with each possible
-  // mangling.
-  std::vector<Symbol *> syms = getSymsWithPrefix(name);
-  auto findByPrefix = [&syms](const Twine &t) -> Symbol * {
-    std::string prefix = t.str();
-    for (auto *s : syms)
-      if (s->getName().startswith(prefix))
-        return s;
-    return nullptr;
+  // Efficient fuzzy string lookup is impossible with a hash table, so look up
+  // each possible mangling in a list of all symbols sorted by name.
+  auto findByPrefix = [&](const Twine &t) -> Symbol * {
+    SmallString<128> buf;
+    return findFirstWithPrefix(t.toStringRef(buf));
   };
 
   // For non-x86, just look for C++ functions.
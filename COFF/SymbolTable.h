@@ -125,9 +125,14 @@ private:
   /// Same as insert(Name), but also sets isUsedInRegularObj.
   std::pair<Symbol *, bool> insert(StringRef name, InputFile *f);
 
-  std::vector<Symbol *> getSymsWithPrefix(StringRef prefix);
+  Symbol *findFirstWithPrefix(StringRef prefix);
 
   llvm::DenseMap<llvm::CachedHashStringRef, Symbol *> symMap;
+
+  // All symbols sorted by name, which findMangle uses to look up symbols by
+  // prefix. Symbols are never removed from symMap, so this is rebuilt when
+  // its size differs from the size of symMap.
+  std::vector<std::pair<StringRef, Symbol *>> sortedSymbols;
   std::unique_ptr<BitcodeCompiler> lto;
 };
 
@@ -319,9 +319,14 @@ public:
     return s->kind() == DefinedImportDataKind;
   }
 
-  uint64_t getRVA() { return file->location->getRVA(); }
+  uint64_t getRVA() {
+    return file->location->getRVA() + file->locationOffset;
+  }
   Chunk *getChunk() { return file->location; }
-  void setLocation(Chunk *addressTable) { file->location = addressTable; }
+  void setLocation(Chunk *addressTable, uint32_t offset) {
+    file->location = addressTable;
+    file->locationOffset = offset;
+  }
 
   StringRef getDLLName() { return file->dllName; }
   StringRef getExternalName() { return file->externalName; }
@@ -7,14 +7,17 @@
 //===----------------------------------------------------------------------===//
 
 #include "Writer.h"
+#include "CallGraphSort.h"
 #include "Config.h"
 #include "DLL.h"
+#include "Incremental.h"
 #include "InputFiles.h"
 #include "MapFile.h"
 #include "PDB.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Filesystem.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Threads.h"
 #include "lld/Common/Timer.h"
@@ -33,6 +36,7 @@
 #include <cstdio>
 #include <map>
 #include <memory>
+#include <thread>
 #include <utility>
 
 using namespace llvm;
@@ -211,8 +215,8 @@ private:
   void createGuardCFTables();
   void markSymbolsForRVATable(ObjFile *file,
                               ArrayRef<SectionChunk *> symIdxChunks,
-                              SymbolRVASet &tableSymbols);
-  void maybeAddRVATable(SymbolRVASet tableSymbols, StringRef tableSym,
+                              SymbolRVAList &tableSymbols);
+  void maybeAddRVATable(SymbolRVAList tableSymbols, StringRef tableSym,
                         StringRef countSym);
   void setSectionPermissions();
   void writeSections();
@@ -225,8 +229,8 @@ private:
   PartialSection *createPartialSection(StringRef name, uint32_t outChars);
   PartialSection *findPartialSection(StringRef name, uint32_t outChars);
 
-  llvm::Optional<coff_symbol16> createSymbol(Defined *d);
-  size_t addEntryToStringTable(StringRef str);
+  llvm::Optional<coff_symbol16> createSymbol(Defined *d,
+                                             std::vector<char> &strtab);
 
   OutputSection *findSection(StringRef name);
   void addBaserels();
@@ -258,6 +262,11 @@ private:
   uint32_t pointerToSymbolTable = 0;
   uint64_t sizeOfImage;
   uint64_t sizeOfHeaders;
+  // The size of the base relocation table, which may be followed by some
+  // room for incremental relinking.
+  uint32_t baserelsSize = 0;
+  // The base relocations of each section, which BaserelChunks refer to.
+  std::vector<std::vector<Baserel>> baserels;
 
   OutputSection *textSec;
   OutputSection *rdataSec;
@@ -397,18 +406,22 @@ getThunk(DenseMap<uint64_t, Defined *> &lastThunks, Defined *target, uint64_t p,
 // After adding thunks, we verify that all relocations are in range (with
 // no extra margin requirements). If this failed, we restart (throwing away
 // the previously created thunks) and retry with a wider margin.
+//
+// Thunks are not inserted into the chunk list one at a time, which would
+// take quadratic time for a large section. Instead, a new list is built
+// with the thunks placed after the chunks that need them.
 static bool createThunks(OutputSection *os, int margin) {
   bool addressesChanged = false;
   DenseMap<uint64_t, Defined *> lastThunks;
   DenseMap<std::pair<ObjFile *, Defined *>, uint32_t> thunkSymtabIndices;
   size_t thunksSize = 0;
-  // Recheck Chunks.size() each iteration, since we can insert more
-  // elements into it.
-  for (size_t i = 0; i != os->chunks.size(); ++i) {
-    SectionChunk *sc = dyn_cast_or_null<SectionChunk>(os->chunks[i]);
+  std::vector<Chunk *> newChunks;
+  newChunks.reserve(os->chunks.size());
+  for (Chunk *c : os->chunks) {
+    newChunks.push_back(c);
+    SectionChunk *sc = dyn_cast_or_null<SectionChunk>(c);
     if (!sc)
       continue;
-    size_t thunkInsertionSpot = i + 1;
 
     // Try to get a good enough estimate of where new thunks will be placed.
     // Offset this by the size of the new thunks added so far, to make the
@@ -446,8 +459,7 @@ static bool createThunks(OutputSection *os, int margin) {
         Chunk *thunkChunk = thunk->getChunk();
         thunkChunk->setRVA(
             thunkInsertionRVA); // Estimate of where it will be located.
-        os->chunks.insert(os->chunks.begin() + thunkInsertionSpot, thunkChunk);
-        thunkInsertionSpot++;
+        newChunks.push_back(thunkChunk);
         thunksSize += thunkChunk->getSize();
         thunkInsertionRVA += thunkChunk->getSize();
         addressesChanged = true;
@@ -492,6 +504,9 @@ static bool createThunks(OutputSection *os, int margin) {
 
     sc->setRelocs(newRelocs);
   }
+
+  if (addressesChanged)
+    os->chunks = std::move(newChunks);
   return addressesChanged;
 }
 
@@ -610,14 +625,37 @@ void Writer::run() {
   } else {
     writeHeader<pe32_header>();
   }
+
+  // Record the number of sections to apply section index relocations
+  // against absolute symbols. See applySecIdx in Chunks.cpp. The PDB needs
+  // this too, since it applies the relocations of debug sections.
+  DefinedAbsolute::numOutputSections = outputSections.size();
+
+  // The PDB depends only on the layout of the image, not on its contents,
+  // so it is created on another thread while the image is written. Its
+  // build ID is copied into the image once both are done, before the image
+  // is hashed by writeBuildId.
+  codeview::DebugInfo pdbBuildId;
+  std::thread pdbThread;
+  bool createsPdb = !config->pdbPath.empty() && config->debug;
+  auto runCreatePDB = [&] {
+    createPDB(symtab, outputSections, sectionTable, &pdbBuildId);
+  };
+  if (createsPdb && threadsEnabled)
+    pdbThread = std::thread(runCreatePDB);
+
   writeSections();
   sortExceptionTable();
 
   t1.stop();
 
-  if (!config->pdbPath.empty() && config->debug) {
-    assert(buildId);
-    createPDB(symtab, outputSections, sectionTable, buildId->buildId);
+  if (createsPdb) {
+    if (pdbThread.joinable())
+      pdbThread.join();
+    else
+      runCreatePDB();
+    assert(buildId && buildId->buildId);
+    memcpy(buildId->buildId, &pdbBuildId, sizeof(pdbBuildId));
   }
   writeBuildId();
 
@@ -626,9 +664,10 @@ void Writer::run() {
   if (errorCount())
     return;
 
+  // If the time is reported, commit right away so that it is measured.
   ScopedTimer t2(diskCommitTimer);
-  if (auto e = buffer->commit())
-    fatal("failed to write the output file: " + toString(std::move(e)));
+  bool sync = config->showTiming || !config->timeJsonFile.empty();
+  commitOutput(std::move(buffer), "failed to write the output file: ", sync);
 }
 
 static StringRef getOutputSectionName(StringRef name) {
@@ -639,12 +678,20 @@ static StringRef getOutputSectionName(StringRef name) {
   return s.substr(0, s.find('.', 1));
 }
 
-// For /order.
-static void sortBySectionOrder(std::vector<Chunk *> &chunks) {
-  auto getPriority = [](const Chunk *c) {
-    if (auto *sec = dyn_cast<SectionChunk>(c))
-      if (sec->sym)
-        return config->order.lookup(sec->sym->getName());
+// For /order and /call-graph-profile-sort. Sections that appear in the call
+// graph order come first, in that order, followed by the rest.
+static void
+sortBySectionOrder(std::vector<Chunk *> &chunks,
+                   const DenseMap<const SectionChunk *, int> &cgOrder) {
+  auto getPriority = [&](const Chunk *c) {
+    if (auto *sec = dyn_cast<SectionChunk>(c)) {
+      if (!cgOrder.empty()) {
+        auto it = cgOrder.find(sec);
+        return it == cgOrder.end() ? 0 : INT_MIN + it->second;
+      }
+      if (DefinedRegular *sym = sec->getComdatLeader())
+        return config->order.lookup(sym->getName());
+    }
     return 0;
   };
 
@@ -848,10 +895,13 @@ void Writer::createSections() {
   if (hasIdata)
     addSyntheticIdata();
 
-  // Process an /order option.
-  if (!config->order.empty())
+  // Process an /order option or the call graph profile.
+  DenseMap<const SectionChunk *, int> cgOrder;
+  if (!config->callGraphProfile.empty())
+    cgOrder = computeCallGraphProfileOrder();
+  if (!config->order.empty() || !cgOrder.empty())
     for (auto it : partialSections)
-      sortBySectionOrder(it.second->chunks);
+      sortBySectionOrder(it.second->chunks, cgOrder);
 
   if (hasIdata)
     locateImportTables();
@@ -1072,7 +1122,8 @@ void Writer::assignOutputSectionIndices() {
           sc->setOutputSectionIdx(mc->getOutputSectionIdx());
 }
 
-size_t Writer::addEntryToStringTable(StringRef str) {
+static size_t addEntryToStringTable(std::vector<char> &strtab,
+                                    StringRef str) {
   assert(str.size() > COFF::NameSize);
   size_t offsetOfEntry = strtab.size() + 4; // +4 for the size field
   strtab.insert(strtab.end(), str.begin(), str.end());
@@ -1080,7 +1131,10 @@ size_t Writer::addEntryToStringTable(StringRef str) {
   return offsetOfEntry;
 }
 
-Optional<coff_symbol16> Writer::createSymbol(Defined *def) {
+// Creates a symbol table record for a symbol. A long name is appended to the
+// given string table, and the record refers to it by its offset there.
+Optional<coff_symbol16> Writer::createSymbol(Defined *def,
+                                             std::vector<char> &strtab) {
   coff_symbol16 sym;
   switch (def->kind()) {
   case Symbol::DefinedAbsoluteKind:
@@ -1116,7 +1170,7 @@ Optional<coff_symbol16> Writer::createSymbol(Defined *def) {
   StringRef name = def->getName();
   if (name.size() > COFF::NameSize) {
     sym.Name.Offset.Zeroes = 0;
-    sym.Name.Offset.Offset = addEntryToStringTable(name);
+    sym.Name.Offset.Offset = addEntryToStringTable(strtab, name);
   } else {
     memset(sym.Name.ShortName, 0, COFF::NameSize);
     memcpy(sym.Name.ShortName, name.data(), name.size());
@@ -1148,20 +1202,44 @@ void Writer::createSymbolAndStringTable() {
       continue;
     if ((sec->header.Characteristics & IMAGE_SCN_MEM_DISCARDABLE) == 0)
       continue;
-    sec->setStringTableOff(addEntryToStringTable(sec->name));
+    sec->setStringTableOff(addEntryToStringTable(strtab, sec->name));
   }
 
   if (config->debugDwarf || config->debugSymtab) {
-    for (ObjFile *file : ObjFile::instances) {
-      for (Symbol *b : file->getSymbols()) {
+    // A symbol is written by the first file that refers to it, which is
+    // decided serially. The records and long names of each file are then
+    // created in parallel and concatenated in the order of the files.
+    size_t numFiles = ObjFile::instances.size();
+    std::vector<std::vector<Defined *>> fileSyms(numFiles);
+    for (size_t i = 0; i != numFiles; ++i) {
+      for (Symbol *b : ObjFile::instances[i]->getSymbols()) {
         auto *d = dyn_cast_or_null<Defined>(b);
         if (!d || d->writtenToSymtab)
           continue;
         d->writtenToSymtab = true;
+        fileSyms[i].push_back(d);
+      }
+    }
 
-        if (Optional<coff_symbol16> sym = createSymbol(d))
-          outputSymtab.push_back(*sym);
+    std::vector<std::vector<coff_symbol16>> fileSymtabs(numFiles);
+    std::vector<std::vector<char>> fileStrtabs(numFiles);
+    parallelForEachN(0, numFiles, [&](size_t i) {
+      for (Defined *d : fileSyms[i])
+        if (Optional<coff_symbol16> sym = createSymbol(d, fileStrtabs[i]))
+          fileSymtabs[i].push_back(*sym);
+    });
+
+    for (size_t i = 0; i != numFiles; ++i) {
+      // Long names start at offset 4 or later, so a zero offset is an
+      // empty short name.
+      size_t base = strtab.size();
+      for (coff_symbol16 &sym : fileSymtabs[i]) {
+        if (sym.Name.Offset.Zeroes == 0 && sym.Name.Offset.Offset != 0)
+          sym.Name.Offset.Offset += base;
+        outputSymtab.push_back(sym);
       }
+      strtab.insert(strtab.end(), fileStrtabs[i].begin(),
+                    fileStrtabs[i].end());
     }
   }
 
@@ -1241,9 +1319,16 @@ void Writer::assignAddresses() {
       virtualSize = alignTo(virtualSize, c->getAlignment());
       c->setRVA(rva + virtualSize);
       virtualSize += c->getSize();
+      virtualSize += getIncrementalSlack(c);
       if (c->hasData)
         rawSize = alignTo(virtualSize, config->fileAlign);
     }
+    if (sec == relocSec) {
+      baserelsSize = virtualSize;
+      virtualSize += getIncrementalBaserelSlack(baserelsSize);
+      if (virtualSize != baserelsSize)
+        rawSize = alignTo(virtualSize, config->fileAlign);
+    }
     if (virtualSize > UINT32_MAX)
       error("section larger than 4 GiB: " + sec->name);
     sec->header.VirtualSize = virtualSize;
@@ -1396,9 +1481,9 @@ template <typename PEHeaderTy> void Writer::writeHeader() {
     dir[EXCEPTION_TABLE].Size =
         lastPdata->getRVA() + lastPdata->getSize() - firstPdata->getRVA();
   }
-  if (relocSec->getVirtualSize()) {
+  if (baserelsSize) {
     dir[BASE_RELOCATION_TABLE].RelativeVirtualAddress = relocSec->getRVA();
-    dir[BASE_RELOCATION_TABLE].Size = relocSec->getVirtualSize();
+    dir[BASE_RELOCATION_TABLE].Size = baserelsSize;
   }
   if (Symbol *sym = symtab->findUnderscore("_tls_used")) {
     if (Defined *b = dyn_cast<Defined>(sym)) {
@@ -1468,7 +1553,7 @@ void Writer::openFile(StringRef path) {
 }
 
 void Writer::createSEHTable() {
-  SymbolRVASet handlers;
+  SymbolRVAList handlers;
   for (ObjFile *file : ObjFile::instances) {
     if (!file->hasSafeSEH())
       error("/safeseh: " + file->getName() + " is not compatible with SEH");
@@ -1484,20 +1569,20 @@ void Writer::createSEHTable() {
                    "__safe_se_handler_count");
 }
 
-// Add a symbol to an RVA set. Two symbols may have the same RVA, but an RVA set
-// cannot contain duplicates. Therefore, the set is uniqued by Chunk and the
-// symbol's offset into that Chunk.
-static void addSymbolToRVASet(SymbolRVASet &rvaSet, Defined *s) {
+// Add a symbol to an RVA list. Two symbols may have the same RVA, but an RVA
+// table cannot contain duplicates. Therefore, the list is later uniqued by
+// Chunk and the symbol's offset into that Chunk.
+static void addSymbolToRVAList(SymbolRVAList &rvaList, Defined *s) {
   Chunk *c = s->getChunk();
   if (auto *sc = dyn_cast<SectionChunk>(c))
     c = sc->repl; // Look through ICF replacement.
   uint32_t off = s->getRVA() - (c ? c->getRVA() : 0);
-  rvaSet.insert({c, off});
+  rvaList.push_back({c, off});
 }
 
 // Given a symbol, add it to the GFIDs table if it is a live, defined, function
 // symbol in an executable section.
-static void maybeAddAddressTakenFunction(SymbolRVASet &addressTakenSyms,
+static void maybeAddAddressTakenFunction(SymbolRVAList &addressTakenSyms,
                                          Symbol *s) {
   if (!s)
     return;
@@ -1524,7 +1609,7 @@ static void maybeAddAddressTakenFunction(SymbolRVASet &addressTakenSyms,
 
   case Symbol::DefinedImportThunkKind:
     // Thunks are always code, include them.
-    addSymbolToRVASet(addressTakenSyms, cast<Defined>(s));
+    addSymbolToRVAList(addressTakenSyms, cast<Defined>(s));
     break;
 
   case Symbol::DefinedRegularKind: {
@@ -1536,7 +1621,7 @@ static void maybeAddAddressTakenFunction(SymbolRVASet &addressTakenSyms,
       SectionChunk *sc = dyn_cast<SectionChunk>(d->getChunk());
       if (sc && sc->live &&
           sc->getOutputCharacteristics() & IMAGE_SCN_MEM_EXECUTE)
-        addSymbolToRVASet(addressTakenSyms, d);
+        addSymbolToRVAList(addressTakenSyms, d);
     }
     break;
   }
@@ -1546,7 +1631,7 @@ static void maybeAddAddressTakenFunction(SymbolRVASet &addressTakenSyms,
 // Visit all relocations from all section contributions of this object file and
 // mark the relocation target as address-taken.
 static void markSymbolsWithRelocations(ObjFile *file,
-                                       SymbolRVASet &usedSymbols) {
+                                       SymbolRVAList &usedSymbols) {
   for (Chunk *c : file->getChunks()) {
     // We only care about live section chunks. Common chunks and other chunks
     // don't generally contain relocations.
@@ -1570,21 +1655,40 @@ static void markSymbolsWithRelocations(ObjFile *file,
 // address-taken functions. It is sorted and uniqued, just like the safe SEH
 // table.
 void Writer::createGuardCFTables() {
-  SymbolRVASet addressTakenSyms;
-  SymbolRVASet longJmpTargets;
-  for (ObjFile *file : ObjFile::instances) {
+  // The symbols of each object file are collected in parallel, and then
+  // concatenated in the order of the files.
+  size_t numFiles = ObjFile::instances.size();
+  std::vector<SymbolRVAList> fileAddressTakenSyms(numFiles);
+  std::vector<SymbolRVAList> fileLongJmpTargets(numFiles);
+  parallelForEachN(0, numFiles, [&](size_t i) {
+    ObjFile *file = ObjFile::instances[i];
     // If the object was compiled with /guard:cf, the address taken symbols
     // are in .gfids$y sections, and the longjmp targets are in .gljmp$y
     // sections. If the object was not compiled with /guard:cf, we assume there
     // were no setjmp targets, and that all code symbols with relocations are
     // possibly address-taken.
     if (file->hasGuardCF()) {
-      markSymbolsForRVATable(file, file->getGuardFidChunks(), addressTakenSyms);
-      markSymbolsForRVATable(file, file->getGuardLJmpChunks(), longJmpTargets);
+      markSymbolsForRVATable(file, file->getGuardFidChunks(),
+                             fileAddressTakenSyms[i]);
+      markSymbolsForRVATable(file, file->getGuardLJmpChunks(),
+                             fileLongJmpTargets[i]);
     } else {
-      markSymbolsWithRelocations(file, addressTakenSyms);
+      markSymbolsWithRelocations(file, fileAddressTakenSyms[i]);
     }
-  }
+  });
+
+  auto concat = [](std::vector<SymbolRVAList> &lists) {
+    size_t size = 0;
+    for (SymbolRVAList &list : lists)
+      size += list.size();
+    SymbolRVAList ret;
+    ret.reserve(size);
+    for (SymbolRVAList &list : lists)
+      ret.insert(ret.end(), list.begin(), list.end());
+    return ret;
+  };
+  SymbolRVAList addressTakenSyms = concat(fileAddressTakenSyms);
+  SymbolRVAList longJmpTargets = concat(fileLongJmpTargets);
 
   // Mark the image entry as address-taken.
   if (config->entry)
@@ -1622,7 +1726,7 @@ void Writer::createGuardCFTables() {
 // depend on the table size, so we can't directly build a set of integers.
 void Writer::markSymbolsForRVATable(ObjFile *file,
                                     ArrayRef<SectionChunk *> symIdxChunks,
-                                    SymbolRVASet &tableSymbols) {
+                                    SymbolRVAList &tableSymbols) {
   for (SectionChunk *c : symIdxChunks) {
     // Skip sections discarded by linker GC. This comes up when a .gfids section
     // is associated with something like a vtable and the vtable is discarded.
@@ -1652,7 +1756,7 @@ void Writer::markSymbolsForRVATable(ObjFile *file,
       }
       if (Symbol *s = objSymbols[symIndex]) {
         if (s->isLive())
-          addSymbolToRVASet(tableSymbols, cast<Defined>(s));
+          addSymbolToRVAList(tableSymbols, cast<Defined>(s));
       }
     }
   }
@@ -1661,11 +1765,26 @@ void Writer::markSymbolsForRVATable(ObjFile *file,
 // Replace the absolute table symbol with a synthetic symbol pointing to
 // tableChunk so that we can emit base relocations for it and resolve section
 // relative relocations.
-void Writer::maybeAddRVATable(SymbolRVASet tableSymbols, StringRef tableSym,
+void Writer::maybeAddRVATable(SymbolRVAList tableSymbols, StringRef tableSym,
                               StringRef countSym) {
   if (tableSymbols.empty())
     return;
 
+  // Remove duplicates. The order doesn't matter because RVATableChunk sorts
+  // the table by RVA when it is written.
+  parallelSort(tableSymbols,
+               [](const ChunkAndOffset &a, const ChunkAndOffset &b) {
+                 return std::tie(a.inputChunk, a.offset) <
+                        std::tie(b.inputChunk, b.offset);
+               });
+  tableSymbols.erase(
+      std::unique(tableSymbols.begin(), tableSymbols.end(),
+                  [](const ChunkAndOffset &a, const ChunkAndOffset &b) {
+                    return a.inputChunk == b.inputChunk &&
+                           a.offset == b.offset;
+                  }),
+      tableSymbols.end());
+
   RVATableChunk *tableChunk = make<RVATableChunk>(std::move(tableSymbols));
   rdataSec->addChunk(tableChunk);
 
@@ -1739,10 +1858,6 @@ void Writer::setSectionPermissions() {
 
 // Write section contents to a mmap'ed file.
 void Writer::writeSections() {
-  // Record the number of sections to apply section index relocations
-  // against absolute symbols. See applySecIdx in Chunks.cpp..
-  DefinedAbsolute::numOutputSections = outputSections.size();
-
   uint8_t *buf = buffer->getBufferStart();
   for (OutputSection *sec : outputSections) {
     uint8_t *secBuf = buf + sec->getFileOff();
@@ -1809,6 +1924,18 @@ void Writer::writeBuildId() {
 }
 
 // Sort .pdata section contents according to PE/COFF spec 5.5.
+// Sorts the function table entries in [Begin, End) by function address.
+template <typename Entry> static void sortPdata(uint8_t *begin, uint8_t *end) {
+  if ((end - begin) % sizeof(Entry) != 0) {
+    warn(".pdata size is not a multiple of the function table entry size; "
+         "not sorting it");
+    return;
+  }
+  parallelSort(
+      MutableArrayRef<Entry>((Entry *)begin, (Entry *)end),
+      [](const Entry &a, const Entry &b) { return a.begin < b.begin; });
+}
+
 void Writer::sortExceptionTable() {
   if (!firstPdata)
     return;
@@ -1822,16 +1949,12 @@ void Writer::sortExceptionTable() {
   uint8_t *end = bufAddr(lastPdata) + lastPdata->getSize();
   if (config->machine == AMD64) {
     struct Entry { ulittle32_t begin, end, unwind; };
-    parallelSort(
-        MutableArrayRef<Entry>((Entry *)begin, (Entry *)end),
-        [](const Entry &a, const Entry &b) { return a.begin < b.begin; });
+    sortPdata<Entry>(begin, end);
     return;
   }
   if (config->machine == ARMNT || config->machine == ARM64) {
     struct Entry { ulittle32_t begin, unwind; };
-    parallelSort(
-        MutableArrayRef<Entry>((Entry *)begin, (Entry *)end),
-        [](const Entry &a, const Entry &b) { return a.begin < b.begin; });
+    sortPdata<Entry>(begin, end);
     return;
   }
   errs() << "warning: don't know how to handle .pdata.\n";
@@ -1893,21 +2016,40 @@ void Writer::addBaserels() {
   if (!config->relocatable)
     return;
   relocSec->chunks.clear();
-  std::vector<Baserel> v;
+  baserels.clear();
   for (OutputSection *sec : outputSections) {
     if (sec->header.Characteristics & IMAGE_SCN_MEM_DISCARDABLE)
       continue;
-    // Collect all locations for base relocations.
-    for (Chunk *c : sec->chunks)
-      c->getBaserels(&v);
-    // Add the addresses to .reloc section.
-    if (!v.empty())
-      addBaserelBlocks(v);
-    v.clear();
+    // Collect all locations for base relocations. Chunks are visited in
+    // parallel, each of them appending to a vector of its own.
+    std::vector<std::vector<Baserel>> chunkRels(sec->chunks.size());
+    parallelForEachN(0, sec->chunks.size(), [&](size_t i) {
+      sec->chunks[i]->getBaserels(&chunkRels[i]);
+    });
+
+    size_t size = 0;
+    for (const std::vector<Baserel> &rels : chunkRels)
+      size += rels.size();
+    if (size == 0)
+      continue;
+    std::vector<Baserel> v;
+    v.reserve(size);
+    for (const std::vector<Baserel> &rels : chunkRels)
+      v.insert(v.end(), rels.begin(), rels.end());
+
+    // Add the addresses to .reloc section. They are sorted so that each page
+    // gets a single block.
+    parallelSort(v, [](const Baserel &a, const Baserel &b) {
+      return std::tie(a.rva, a.type) < std::tie(b.rva, b.type);
+    });
+    baserels.push_back(std::move(v));
+    addBaserelBlocks(baserels.back());
   }
 }
 
 // Add addresses to .reloc section. Note that addresses are grouped by page.
+// The blocks are written by BaserelChunk::writeTo(), so that they are
+// written in parallel along with other chunks.
 void Writer::addBaserelBlocks(std::vector<Baserel> &v) {
   const uint32_t mask = ~uint32_t(pageSize - 1);
   uint32_t page = v[0].rva & mask;
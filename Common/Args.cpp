@@ -8,6 +8,7 @@
 
 #include "lld/Common/Args.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
@@ -80,3 +81,28 @@ StringRef lld::args::getFilenameWithoutExe(StringRef path) {
     return sys::path::stem(path);
   return sys::path::filename(path);
 }
+
+void lld::args::setThreads(opt::InputArgList &args, unsigned threads,
+                           unsigned noThreads, unsigned threadsEq) {
+  threadsEnabled = true;
+  setThreadCount(0);
+
+  auto *a = args.getLastArg(threads, noThreads, threadsEq);
+  if (!a || a->getOption().getID() == threads)
+    return;
+  if (a->getOption().getID() == noThreads) {
+    threadsEnabled = false;
+    return;
+  }
+
+  unsigned n;
+  if (!to_integer(a->getValue(), n, 10) || n == 0) {
+    error(a->getSpelling().rtrim("=:") +
+          ": expected a positive integer, but got '" + a->getValue() + "'");
+    return;
+  }
+  // Much of the linker checks threadsEnabled to choose between a serial and
+  // a parallel algorithm, so one thread is the same as no threads.
+  threadsEnabled = n > 1;
+  setThreadCount(n);
+}
@@ -16,24 +16,62 @@ namespace lld {
 DWARFCache::DWARFCache(std::unique_ptr<llvm::DWARFContext> d)
     : dwarf(std::move(d)) {
   for (std::unique_ptr<DWARFUnit> &cu : dwarf->compile_units()) {
-    auto report = [](Error err) {
-      handleAllErrors(std::move(err),
-                      [](ErrorInfoBase &info) { warn(info.message()); });
-    };
-    Expected<const DWARFDebugLine::LineTable *> expectedLT =
-        dwarf->getLineTableForUnit(cu.get(), report);
-    const DWARFDebugLine::LineTable *lt = nullptr;
-    if (expectedLT)
-      lt = *expectedLT;
+    units.emplace_back();
+    units.back().cu = cu.get();
+  }
+}
+
+static void report(Error err) {
+  handleAllErrors(std::move(err),
+                  [](ErrorInfoBase &info) { warn(info.message()); });
+}
+
+// Returns the line table of a compile unit, parsing it if needed.
+const DWARFDebugLine::LineTable *DWARFCache::getLineTable(Unit &u) {
+  if (u.parsed)
+    return u.lt;
+  u.parsed = true;
+  Expected<const DWARFDebugLine::LineTable *> expectedLT =
+      dwarf->getLineTableForUnit(u.cu, report);
+  if (expectedLT)
+    u.lt = *expectedLT;
+  else
+    report(expectedLT.takeError());
+  return u.lt;
+}
+
+// Returns false if the address ranges of a compile unit tell that an
+// address is not in it. That only needs the unit DIE, while the line table
+// may be large.
+bool DWARFCache::mayContain(Unit &u, uint64_t offset, uint64_t sectionIndex) {
+  if (!u.rangesParsed) {
+    u.rangesParsed = true;
+    Expected<DWARFAddressRangesVector> ranges = u.cu->collectAddressRanges();
+    if (ranges)
+      u.ranges = std::move(*ranges);
     else
-      report(expectedLT.takeError());
+      consumeError(ranges.takeError());
+  }
+  if (u.ranges.empty())
+    return true;
+  for (const DWARFAddressRange &r : u.ranges)
+    if ((r.SectionIndex == object::SectionedAddress::UndefSection ||
+         r.SectionIndex == sectionIndex) &&
+        r.LowPC <= offset && offset < r.HighPC)
+      return true;
+  return false;
+}
+
+void DWARFCache::collectVariables() {
+  variablesCollected = true;
+  for (Unit &u : units) {
+    const DWARFDebugLine::LineTable *lt = getLineTable(u);
     if (!lt)
       continue;
-    lineTables.push_back(lt);
 
     // Loop over variable records and insert them to variableLoc.
-    for (const auto &entry : cu->dies()) {
-      DWARFDie die(cu.get(), &entry);
+    for (const auto &entry : u.cu->dies()) {
+      DWARFDie die(u.cu, &entry);
       // Skip all tags that are not variables.
       if (die.getTag() != dwarf::DW_TAG_variable)
         continue;
@@ -71,6 +109,10 @@ DWARFCache::DWARFCache(std::unique_ptr<llvm::DWARFContext> d)
 // object (variable, array, etc) definition.
 Optional<std::pair<std::string, unsigned>>
 DWARFCache::getVariableLoc(StringRef name) {
+  std::lock_guard<std::mutex> lock(mu);
+  if (!variablesCollected)
+    collectVariables();
+
   // Return if we have no debug information about data object.
   auto it = variableLoc.find(name);
   if (it == variableLoc.end())
@@ -90,13 +132,28 @@ DWARFCache::getVariableLoc(StringRef name) {
 // using DWARF debug info.
 Optional<DILineInfo> DWARFCache::getDILineInfo(uint64_t offset,
                                                uint64_t sectionIndex) {
+  std::lock_guard<std::mutex> lock(mu);
+  auto lookup = [&](Unit &u, DILineInfo &info) {
+    const DWARFDebugLine::LineTable *lt = getLineTable(u);
+    return lt &&
+           lt->getFileLineInfoForAddress(
+               {offset, sectionIndex}, nullptr,
+               DILineInfoSpecifier::FileLineInfoKind::AbsoluteFilePath, info);
+  };
+
+  // Try the units that may contain the address first, and then the others,
+  // in case their address ranges are incomplete.
   DILineInfo info;
-  for (const llvm::DWARFDebugLine::LineTable *lt : lineTables) {
-    if (lt->getFileLineInfoForAddress(
-            {offset, sectionIndex}, nullptr,
-            DILineInfoSpecifier::FileLineInfoKind::AbsoluteFilePath, info))
+  std::vector<Unit *> rest;
+  for (Unit &u : units) {
+    if (!mayContain(u, offset, sectionIndex))
+      rest.push_back(&u);
+    else if (lookup(u, info))
       return info;
   }
+  for (Unit *u : rest)
+    if (lookup(*u, info))
+      return info;
   return None;
 }
 
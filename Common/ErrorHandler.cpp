@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Filesystem.h"
 
 #include "lld/Common/Threads.h"
 
@@ -49,6 +50,15 @@ void lld::enableColors(bool enable) {
 }
 
 void lld::exitLld(int val) {
+  // Wait for the outputs that are still being committed. They may have
+  // failed to be written.
+  waitForOutputs();
+  waitForBackgroundTasks();
+  if (errorHandler().cleanupCallback)
+    errorHandler().cleanupCallback();
+  if (val == 0 && errorCount())
+    val = 1;
+
   // Delete any temporary file, while keeping the memory mapping open.
   if (errorHandler().outputBuffer)
     errorHandler().outputBuffer->discard();
@@ -145,17 +155,128 @@ std::string ErrorHandler::getLocation(const Twine &msg) {
   return logName;
 }
 
+// The buffer of the current thread, if any.
+static LLVM_THREAD_LOCAL DiagnosticBuffer *currentBuffer = nullptr;
+
+DiagnosticBuffer *DiagnosticBuffer::setCurrent(DiagnosticBuffer *b) {
+  DiagnosticBuffer *old = currentBuffer;
+  currentBuffer = b;
+  return old;
+}
+
+DiagnosticBuffer *DiagnosticBuffer::getCurrent() { return currentBuffer; }
+
+void DiagnosticBuffer::add(Kind kind, std::string msg) {
+  if (kind == Error) {
+    // At least as many errors come before an error as there are before it in
+    // its buffer, so errors past the limit in a buffer are never printed.
+    uint64_t limit = errorHandler().errorLimit;
+    bool keep = limit == 0 || numErrors <= limit;
+    ++numErrors;
+    if (!keep)
+      return;
+  }
+  diags.emplace_back(kind, std::move(msg));
+}
+
+void DiagnosticBuffer::flush(MutableArrayRef<DiagnosticBuffer> buffers) {
+  if (DiagnosticBuffer *parent = currentBuffer) {
+    for (DiagnosticBuffer &b : buffers) {
+      uint64_t numKept = 0;
+      for (std::pair<Kind, std::string> &d : b.diags) {
+        if (d.first == Error)
+          ++numKept;
+        parent->add(d.first, std::move(d.second));
+      }
+      parent->numErrors += b.numErrors - numKept;
+      b.diags.clear();
+      b.numErrors = 0;
+    }
+    return;
+  }
+
+  ErrorHandler &eh = errorHandler();
+  bool exit = false;
+  {
+    std::lock_guard<std::mutex> lock(mu);
+
+    // The errors were counted when they were reported. Number them as if
+    // they had been reported in order.
+    uint64_t total = 0;
+    for (DiagnosticBuffer &b : buffers)
+      total += b.numErrors;
+    uint64_t index = eh.errorCount - total;
+
+    for (DiagnosticBuffer &b : buffers) {
+      uint64_t next = index + b.numErrors;
+      for (std::pair<Kind, std::string> &d : b.diags) {
+        if (!exit)
+          exit = eh.print(d.first, d.second, index);
+        if (d.first == Error)
+          ++index;
+      }
+      index = next;
+      b.diags.clear();
+      b.numErrors = 0;
+    }
+  }
+  if (exit)
+    exitLld(1);
+}
+
+// Prints a diagnostic. index is the number of errors reported before an
+// error. Returns true if the process should exit because there were too
+// many errors. mu must be held.
+bool ErrorHandler::print(DiagnosticBuffer::Kind kind, const Twine &msg,
+                         uint64_t index) {
+  switch (kind) {
+  case DiagnosticBuffer::Log:
+    *errorOS << logName << ": " << msg << "\n";
+    return false;
+  case DiagnosticBuffer::Message:
+    outs() << msg << "\n";
+    outs().flush();
+    return false;
+  case DiagnosticBuffer::Warning:
+    *errorOS << sep << getLocation(msg) << ": " << Colors::MAGENTA
+             << "warning: " << Colors::RESET << msg << "\n";
+    sep = getSeparator(msg);
+    return false;
+  case DiagnosticBuffer::Error:
+    break;
+  }
+
+  bool exit = false;
+  if (errorLimit == 0 || index < errorLimit) {
+    *errorOS << sep << getLocation(msg) << ": " << Colors::RED
+             << "error: " << Colors::RESET << msg << "\n";
+  } else if (index == errorLimit) {
+    *errorOS << sep << getLocation(msg) << ": " << Colors::RED
+             << "error: " << Colors::RESET << errorLimitExceededMsg << "\n";
+    exit = exitEarly;
+  }
+  sep = getSeparator(msg);
+  return exit;
+}
+
 void ErrorHandler::log(const Twine &msg) {
   if (!verbose)
     return;
+  if (currentBuffer) {
+    currentBuffer->add(DiagnosticBuffer::Log, msg.str());
+    return;
+  }
   std::lock_guard<std::mutex> lock(mu);
-  *errorOS << logName << ": " << msg << "\n";
+  print(DiagnosticBuffer::Log, msg, 0);
 }
 
 void ErrorHandler::message(const Twine &msg) {
+  if (currentBuffer) {
+    currentBuffer->add(DiagnosticBuffer::Message, msg.str());
+    return;
+  }
   std::lock_guard<std::mutex> lock(mu);
-  outs() << msg << "\n";
-  outs().flush();
+  print(DiagnosticBuffer::Message, msg, 0);
 }
 
 void ErrorHandler::warn(const Twine &msg) {
@@ -164,10 +285,12 @@ void ErrorHandler::warn(const Twine &msg) {
     return;
   }
 
+  if (currentBuffer) {
+    currentBuffer->add(DiagnosticBuffer::Warning, msg.str());
+    return;
+  }
   std::lock_guard<std::mutex> lock(mu);
-  *errorOS << sep << getLocation(msg) << ": " << Colors::MAGENTA
-           << "warning: " << Colors::RESET << msg << "\n";
-  sep = getSeparator(msg);
+  print(DiagnosticBuffer::Warning, msg, 0);
 }
 
 void ErrorHandler::error(const Twine &msg) {
@@ -187,23 +310,26 @@ void ErrorHandler::error(const Twine &msg) {
     }
   }
 
-  std::lock_guard<std::mutex> lock(mu);
-
-  if (errorLimit == 0 || errorCount < errorLimit) {
-    *errorOS << sep << getLocation(msg) << ": " << Colors::RED
-             << "error: " << Colors::RESET << msg << "\n";
-  } else if (errorCount == errorLimit) {
-    *errorOS << sep << getLocation(msg) << ": " << Colors::RED
-             << "error: " << Colors::RESET << errorLimitExceededMsg << "\n";
-    if (exitEarly)
-      exitLld(1);
+  // A buffered error is counted right away, so that code checking
+  // errorCount() in the meantime sees it, but it is printed on flush.
+  if (currentBuffer) {
+    ++errorCount;
+    currentBuffer->add(DiagnosticBuffer::Error, msg.str());
+    return;
   }
 
-  sep = getSeparator(msg);
-  ++errorCount;
+  bool exit;
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    exit = print(DiagnosticBuffer::Error, msg, errorCount++);
+  }
+  if (exit)
+    exitLld(1);
 }
 
 void ErrorHandler::fatal(const Twine &msg) {
+  // The process exits, so there is no point in buffering the error.
+  DiagnosticBuffer::setCurrent(nullptr);
   error(msg);
   exitLld(1);
 }
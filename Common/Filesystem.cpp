@@ -11,14 +11,20 @@
 //===----------------------------------------------------------------------===//
 
 #include "lld/Common/Filesystem.h"
+#include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Threads.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/Support/FileOutputBuffer.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Memory.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #if LLVM_ON_UNIX
 #include <unistd.h>
 #endif
+#include <mutex>
 #include <thread>
+#include <vector>
 
 using namespace llvm;
 using namespace lld;
@@ -78,6 +84,194 @@ void lld::unlinkAsync(StringRef path) {
 #endif
 }
 
+// Committing a large output is not free: FileOutputBuffer has to unmap
+// the dirty pages of the temporary file and rename it. There is nothing left
+// to do for the link at that point, so when the process is going to exit
+// anyway, the commit runs on a background thread while the driver prints
+// its reports and tears down. exitLld() waits for it, so that the output
+// exists and any error is reported before the process exits.
+static std::mutex outputsMutex;
+static std::vector<std::thread> outputThreads;
+
+static void commit(std::unique_ptr<FileOutputBuffer> buffer,
+                   const std::string &msg, const std::function<void()> &fn) {
+  if (Error e = buffer->commit())
+    error(msg + toString(std::move(e)));
+  else if (fn)
+    fn();
+}
+
+void lld::commitOutput(std::unique_ptr<FileOutputBuffer> buffer,
+                       const Twine &msg, bool sync,
+                       std::function<void()> fn) {
+  if (sync || !threadsEnabled || !errorHandler().exitEarly) {
+    commit(std::move(buffer), msg.str(), fn);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(outputsMutex);
+  outputThreads.emplace_back(commit, std::move(buffer), msg.str(),
+                             std::move(fn));
+}
+
+void lld::waitForOutputs() {
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(outputsMutex);
+    threads.swap(outputThreads);
+  }
+
+  // A commit that fails after too many errors calls exitLld() itself.
+  for (std::thread &t : threads) {
+    if (t.get_id() == std::this_thread::get_id())
+      t.detach();
+    else
+      t.join();
+  }
+}
+
+static std::mutex tasksMutex;
+static std::vector<std::thread> backgroundTasks;
+
+void lld::runInBackground(std::function<void()> fn) {
+  if (!threadsEnabled || !errorHandler().exitEarly) {
+    fn();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(tasksMutex);
+  backgroundTasks.emplace_back(std::move(fn));
+}
+
+void lld::waitForBackgroundTasks() {
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    threads.swap(backgroundTasks);
+  }
+
+  for (std::thread &t : threads) {
+    if (t.get_id() == std::this_thread::get_id())
+      t.detach();
+    else
+      t.join();
+  }
+}
+
+namespace {
+// The output buffer of createStagedOutputBuffer(). The memory is either
+// anonymous memory or a mapped temporary file in the staging directory.
+class StagedOutputBuffer : public FileOutputBuffer {
+public:
+  StagedOutputBuffer(StringRef path, size_t size, unsigned flags,
+                     sys::MemoryBlock block)
+      : FileOutputBuffer(path), size(size), flags(flags), block(block) {}
+
+  StagedOutputBuffer(StringRef path, size_t size, unsigned flags,
+                     sys::fs::TempFile temp,
+                     std::unique_ptr<sys::fs::mapped_file_region> region)
+      : FileOutputBuffer(path), size(size), flags(flags),
+        temp(std::move(temp)), region(std::move(region)) {}
+
+  ~StagedOutputBuffer() override { discard(); }
+
+  uint8_t *getBufferStart() const override {
+    return (uint8_t *)(region ? region->data() : block.base());
+  }
+
+  uint8_t *getBufferEnd() const override {
+    return getBufferStart() + getBufferSize();
+  }
+
+  size_t getBufferSize() const override { return size; }
+
+  Error commit() override;
+
+  void discard() override {
+    region.reset();
+    if (temp)
+      consumeError(temp->discard());
+    temp.reset();
+    if (block.base())
+      sys::Memory::releaseMappedMemory(block);
+    block = sys::MemoryBlock();
+  }
+
+private:
+  size_t size;
+  unsigned flags;
+  sys::MemoryBlock block;
+  Optional<sys::fs::TempFile> temp;
+  std::unique_ptr<sys::fs::mapped_file_region> region;
+};
+} // namespace
+
+Error StagedOutputBuffer::commit() {
+  unsigned mode = sys::fs::all_read | sys::fs::all_write;
+  if (flags & F_executable)
+    mode |= sys::fs::all_exe;
+
+  // The destination is written with a single sequential stream into a
+  // temporary file next to it, which is then renamed over it, so that
+  // readers never see a partially written output.
+  Expected<sys::fs::TempFile> dest =
+      sys::fs::TempFile::create(FinalPath + ".tmp%%%%%%%", mode);
+  if (!dest)
+    return dest.takeError();
+
+  {
+    raw_fd_ostream os(dest->FD, /*shouldClose=*/false);
+    os.write((const char *)getBufferStart(), getBufferSize());
+    os.flush();
+    if (std::error_code ec = os.error()) {
+      os.clear_error();
+      consumeError(dest->discard());
+      return errorCodeToError(ec);
+    }
+  }
+
+  discard();
+  return dest->keep(FinalPath);
+}
+
+Expected<std::unique_ptr<FileOutputBuffer>>
+lld::createStagedOutputBuffer(StringRef path, size_t size, unsigned flags,
+                              StringRef stagingDir) {
+  if (path == "-")
+    return FileOutputBuffer::create(path, size, flags);
+
+  std::error_code ec;
+  if (stagingDir.empty()) {
+    // Anonymous memory is zero-filled like a new file.
+    sys::MemoryBlock block = sys::Memory::allocateMappedMemory(
+        size, nullptr, sys::Memory::MF_READ | sys::Memory::MF_WRITE, ec);
+    if (ec)
+      return errorCodeToError(ec);
+    return std::make_unique<StagedOutputBuffer>(path, size, flags, block);
+  }
+
+  SmallString<128> model = stagingDir;
+  sys::path::append(model, sys::path::filename(path) + ".stage%%%%%%%");
+  Expected<sys::fs::TempFile> temp = sys::fs::TempFile::create(model);
+  if (!temp)
+    return temp.takeError();
+
+  if ((ec = sys::fs::resize_file(temp->FD, size))) {
+    consumeError(temp->discard());
+    return errorCodeToError(ec);
+  }
+
+  auto region = std::make_unique<sys::fs::mapped_file_region>(
+      sys::fs::convertFDToNativeFile(temp->FD),
+      sys::fs::mapped_file_region::readwrite, size, 0, ec);
+  if (ec) {
+    consumeError(temp->discard());
+    return errorCodeToError(ec);
+  }
+  return std::make_unique<StagedOutputBuffer>(
+      path, size, flags, std::move(*temp), std::move(region));
+}
+
 // Simulate file creation to see if Path is writable.
 //
 // Determining whether a file is writable or not is amazingly hard,
@@ -0,0 +1,135 @@
+//===- InputCache.cpp -----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The cache is keyed by absolute path, and an entry is valid as long as the
+// size and the modification time of the file do not change. The contents are
+// stored once per distinct content, so that copies of the same library in
+// different directories do not use more memory.
+//
+// Files are read rather than mapped. A mapped file would change under us
+// when a build rewrites it in place, and we want to keep the old contents
+// until we notice that.
+//
+//===----------------------------------------------------------------------===//
+
+#include "lld/Common/InputCache.h"
+#include "lld/Common/Memory.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Chrono.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <mutex>
+
+using namespace llvm;
+using namespace lld;
+
+bool lld::inputCacheEnabled;
+
+namespace {
+struct Blob {
+  std::unique_ptr<MemoryBuffer> mb;
+  uint64_t lastUse;
+};
+
+struct Entry {
+  sys::TimePoint<> mtime;
+  uint64_t size;
+  uint64_t hash;
+};
+} // namespace
+
+static std::mutex mu;
+static StringMap<Entry> entries;
+static DenseMap<uint64_t, Blob> blobs;
+static uint64_t totalSize;
+static uint64_t sizeLimit = 1024 * 1024 * 1024;
+static uint64_t generation = 1;
+
+ErrorOr<MemoryBufferRef> lld::readCachedInput(StringRef path) {
+  SmallString<128> absPath = path;
+  if (std::error_code ec = sys::fs::make_absolute(absPath))
+    return ec;
+  sys::fs::file_status st;
+  if (std::error_code ec = sys::fs::status(absPath, st))
+    return ec;
+
+  // The identifier is the path we were given, as the drivers use it in
+  // diagnostics.
+  std::lock_guard<std::mutex> lock(mu);
+  StringRef id = saver.save(path);
+
+  auto it = entries.find(absPath);
+  if (it != entries.end() && it->second.size == st.getSize() &&
+      it->second.mtime == st.getLastModificationTime()) {
+    Blob &blob = blobs[it->second.hash];
+    blob.lastUse = generation;
+    return MemoryBufferRef(blob.mb->getBuffer(), id);
+  }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+      MemoryBuffer::getFile(absPath, /*FileSize=*/-1,
+                            /*RequiresNullTerminator=*/false,
+                            /*IsVolatile=*/true);
+  if (!mbOrErr)
+    return mbOrErr.getError();
+  std::unique_ptr<MemoryBuffer> &mb = *mbOrErr;
+
+  uint64_t hash = xxHash64(mb->getBuffer());
+  auto blobIt = blobs.find(hash);
+  if (blobIt != blobs.end() &&
+      blobIt->second.mb->getBuffer() != mb->getBuffer()) {
+    // A hash collision. Do not cache the file; it lives until the end of
+    // this link like any other input.
+    MemoryBufferRef mbref(mb->getBuffer(), id);
+    make<std::unique_ptr<MemoryBuffer>>(std::move(mb));
+    return mbref;
+  }
+
+  if (blobIt == blobs.end()) {
+    totalSize += mb->getBufferSize();
+    blobIt = blobs.insert({hash, Blob{std::move(mb), 0}}).first;
+  }
+  blobIt->second.lastUse = generation;
+  entries[absPath] = {st.getLastModificationTime(), st.getSize(), hash};
+  return MemoryBufferRef(blobIt->second.mb->getBuffer(), id);
+}
+
+void lld::setInputCacheLimit(uint64_t bytes) {
+  std::lock_guard<std::mutex> lock(mu);
+  sizeLimit = bytes;
+}
+
+void lld::trimInputCache() {
+  std::lock_guard<std::mutex> lock(mu);
+  ++generation;
+  if (totalSize <= sizeLimit)
+    return;
+
+  std::vector<std::pair<uint64_t, uint64_t>> byAge;
+  for (auto &kv : blobs)
+    byAge.push_back({kv.second.lastUse, kv.first});
+  llvm::sort(byAge);
+
+  for (auto &p : byAge) {
+    if (totalSize <= sizeLimit)
+      break;
+    auto it = blobs.find(p.second);
+    totalSize -= it->second.mb->getBufferSize();
+    blobs.erase(it);
+  }
+
+  std::vector<StringRef> stale;
+  for (auto &kv : entries)
+    if (!blobs.count(kv.second.hash))
+      stale.push_back(kv.first());
+  for (StringRef key : stale)
+    entries.erase(key);
+}
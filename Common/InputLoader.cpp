@@ -0,0 +1,108 @@
+//===- InputLoader.cpp ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The loader uses more threads than there are cores, because its threads
+// spend most of their time blocked in open, fstat, mmap and read. Each
+// thread takes the next file in command line order, so the files that the
+// driver needs first are read first, and the driver only waits for a file
+// that has not arrived yet.
+//
+// Submitting the reads through io_uring would save the threads, but it
+// needs kernel support and headers that LLVM does not depend on, so a
+// thread pool is used everywhere.
+//
+//===----------------------------------------------------------------------===//
+
+#include "lld/Common/InputLoader.h"
+#include "lld/Common/Threads.h"
+#include "llvm/ADT/StringMap.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace llvm;
+using namespace lld;
+
+namespace {
+struct Entry {
+  std::string path;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mb = std::error_code();
+  bool done = false;
+  bool taken = false;
+};
+} // namespace
+
+static const unsigned numLoaderThreads = 16;
+
+static std::vector<Entry> entries;
+static StringMap<size_t> entryIndex;
+static std::vector<std::thread> loaderThreads;
+static std::atomic<size_t> nextEntry;
+static std::mutex mu;
+static std::condition_variable cv;
+
+void lld::startPreloadingInputs(std::vector<std::string> paths,
+                                bool requiresNullTerminator) {
+  finishPreloadingInputs();
+  if (getThreadCount() == 1 || paths.empty())
+    return;
+
+  entries = std::vector<Entry>(paths.size());
+  for (size_t i = 0, e = paths.size(); i != e; ++i) {
+    // A file named twice is read once; the second readFile reads it again.
+    if (!entryIndex.insert({paths[i], i}).second)
+      entries[i].done = entries[i].taken = true;
+    entries[i].path = std::move(paths[i]);
+  }
+
+  nextEntry = 0;
+  auto load = [=] {
+    for (;;) {
+      size_t i = nextEntry++;
+      if (i >= entries.size())
+        return;
+      Entry &e = entries[i];
+      if (e.taken)
+        continue;
+      ErrorOr<std::unique_ptr<MemoryBuffer>> mb =
+          MemoryBuffer::getFile(e.path, -1, requiresNullTerminator);
+      std::lock_guard<std::mutex> lock(mu);
+      e.mb = std::move(mb);
+      e.done = true;
+      cv.notify_all();
+    }
+  };
+
+  unsigned n = std::min<size_t>(numLoaderThreads, entries.size());
+  for (unsigned i = 0; i != n; ++i)
+    loaderThreads.emplace_back(load);
+}
+
+Optional<ErrorOr<std::unique_ptr<MemoryBuffer>>>
+lld::takePreloadedInput(StringRef path) {
+  auto it = entryIndex.find(path);
+  if (it == entryIndex.end())
+    return None;
+  Entry &e = entries[it->second];
+
+  std::unique_lock<std::mutex> lock(mu);
+  if (e.taken)
+    return None;
+  cv.wait(lock, [&] { return e.done; });
+  e.taken = true;
+  return std::move(e.mb);
+}
+
+void lld::finishPreloadingInputs() {
+  for (std::thread &t : loaderThreads)
+    t.join();
+  loaderThreads.clear();
+  entries.clear();
+  entryIndex.clear();
+}
@@ -0,0 +1,281 @@
+//===- LinkServer.cpp -----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The protocol is as follows. The client connects to the Unix domain socket
+// and sends a header with the size of the request, along with its stdout and
+// stderr as SCM_RIGHTS. The request is the working directory followed by the
+// command line, separated by NUL characters. The server replies with one
+// byte when it starts the link and then with the exit code.
+//
+// If the client cannot connect, or the server does not start the link, the
+// client links by itself. A fatal error ends the server in the middle of a
+// link, after the error was printed to the client's stderr; the client then
+// fails too.
+//
+//===----------------------------------------------------------------------===//
+
+#include "lld/Common/LinkServer.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/InputCache.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#if LLVM_ON_UNIX
+#include <csignal>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include <cerrno>
+#include <cstring>
+
+using namespace llvm;
+using namespace lld;
+
+#if LLVM_ON_UNIX
+static const uint32_t requestMagic = 0x4c4c4431; // "LLD1"
+
+static bool writeAll(int fd, const void *buf, size_t size) {
+  const char *p = static_cast<const char *>(buf);
+  while (size) {
+    ssize_t n = ::write(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+static bool readAll(int fd, void *buf, size_t size) {
+  char *p = static_cast<char *>(buf);
+  while (size) {
+    ssize_t n = ::read(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+static bool getSocketAddress(StringRef path, sockaddr_un &addr) {
+  memset(&addr, 0, sizeof(addr));
+  if (path.size() >= sizeof(addr.sun_path))
+    return false;
+  addr.sun_family = AF_UNIX;
+  memcpy(addr.sun_path, path.data(), path.size());
+  return true;
+}
+
+// Reads a request from a client. Returns false if it is malformed.
+static bool readRequest(int fd, std::string &payload, int (&fds)[2]) {
+  uint32_t header[2];
+  struct iovec iov = {header, sizeof(header)};
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t n;
+  do {
+    n = recvmsg(fd, &msg, 0);
+  } while (n < 0 && errno == EINTR);
+  if (n <= 0)
+    return false;
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (!cmsg || cmsg->cmsg_level != SOL_SOCKET ||
+      cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+    return false;
+  memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+  if (n != sizeof(header) || header[0] != requestMagic) {
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+  payload.resize(header[1]);
+  if (!readAll(fd, &payload[0], payload.size())) {
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+  return true;
+}
+
+static void serve(int fd,
+                  function_ref<int(std::vector<const char *> &)> link) {
+  std::string payload;
+  int fds[2];
+  if (!readRequest(fd, payload, fds))
+    return;
+
+  // The payload is NUL-terminated strings: the working directory and then
+  // the command line.
+  std::vector<const char *> args;
+  for (size_t i = 0; i < payload.size(); i += strlen(&payload[i]) + 1)
+    args.push_back(&payload[i]);
+
+  int cwd = open(".", O_RDONLY);
+  if (args.size() < 2 || cwd < 0 || chdir(args[0]) != 0) {
+    if (cwd >= 0)
+      close(cwd);
+    close(fds[0]);
+    close(fds[1]);
+    return;
+  }
+  args.erase(args.begin());
+
+  outs().flush();
+  errs().flush();
+  int savedOut = dup(STDOUT_FILENO);
+  int savedErr = dup(STDERR_FILENO);
+  dup2(fds[0], STDOUT_FILENO);
+  dup2(fds[1], STDERR_FILENO);
+  close(fds[0]);
+  close(fds[1]);
+
+  char started = 1;
+  writeAll(fd, &started, 1);
+  errorHandler().errorCount = 0;
+  int32_t status = link(args);
+
+  outs().flush();
+  errs().flush();
+  dup2(savedOut, STDOUT_FILENO);
+  dup2(savedErr, STDERR_FILENO);
+  close(savedOut);
+  close(savedErr);
+  if (fchdir(cwd) != 0)
+    fatal("link server: cannot restore working directory");
+  close(cwd);
+
+  writeAll(fd, &status, sizeof(status));
+}
+#endif
+
+int lld::runLinkServer(StringRef socketPath,
+                       function_ref<int(std::vector<const char *> &)> link) {
+#if LLVM_ON_UNIX
+  sockaddr_un addr;
+  if (!getSocketAddress(socketPath, addr)) {
+    error("link server: socket path is too long: " + socketPath);
+    return 1;
+  }
+
+  int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenFd < 0) {
+    error("link server: cannot create socket: " + Twine(strerror(errno)));
+    return 1;
+  }
+
+  // The socket is only accessible to the owner, as the server reads and
+  // writes files on behalf of its clients.
+  ::unlink(addr.sun_path);
+  mode_t oldMask = umask(077);
+  int ret = bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+  umask(oldMask);
+  if (ret != 0 || listen(listenFd, 16) != 0) {
+    error("link server: cannot listen on " + socketPath + ": " +
+          strerror(errno));
+    close(listenFd);
+    return 1;
+  }
+
+  // A client that goes away must not kill the server.
+  signal(SIGPIPE, SIG_IGN);
+  inputCacheEnabled = true;
+
+  for (;;) {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      error("link server: accept failed: " + Twine(strerror(errno)));
+      close(listenFd);
+      return 1;
+    }
+    serve(fd, link);
+    close(fd);
+    trimInputCache();
+  }
+#else
+  error("link server: not supported on this host");
+  return 1;
+#endif
+}
+
+Optional<int> lld::forwardToLinkServer(StringRef socketPath,
+                                       ArrayRef<const char *> args) {
+#if LLVM_ON_UNIX
+  sockaddr_un addr;
+  SmallString<128> cwd;
+  if (!getSocketAddress(socketPath, addr) || sys::fs::current_path(cwd))
+    return None;
+
+  std::string payload(cwd.begin(), cwd.end());
+  payload += '\0';
+  for (const char *arg : args) {
+    payload += arg;
+    payload += '\0';
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return None;
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+    close(fd);
+    return None;
+  }
+
+  uint32_t header[2] = {requestMagic, static_cast<uint32_t>(payload.size())};
+  int fds[2] = {STDOUT_FILENO, STDERR_FILENO};
+  struct iovec iov = {header, sizeof(header)};
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  outs().flush();
+  char started;
+  if (sendmsg(fd, &msg, 0) != sizeof(header) ||
+      !writeAll(fd, payload.data(), payload.size()) ||
+      !readAll(fd, &started, 1)) {
+    close(fd);
+    return None;
+  }
+
+  int32_t status;
+  bool ok = readAll(fd, &status, sizeof(status));
+  close(fd);
+  if (!ok) {
+    errs() << args[0] << ": error: the link server exited during the link\n";
+    return 1;
+  }
+  return status;
+#else
+  return None;
+#endif
+}
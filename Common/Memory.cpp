@@ -7,16 +7,179 @@
 //===----------------------------------------------------------------------===//
 
 #include "lld/Common/Memory.h"
+#include "lld/Common/ErrorHandler.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 
 using namespace llvm;
 using namespace lld;
 
-BumpPtrAllocator lld::bAlloc;
-StringSaver lld::saver{bAlloc};
+ArenaAllocator lld::bAlloc;
+ArenaStringSaver lld::saver{bAlloc};
 std::vector<SpecificAllocBase *> lld::SpecificAllocBase::instances;
 
+// Function-local statics of make<>() for different types may be initialized
+// by different threads at the same time.
+static std::mutex instancesMutex;
+
+SpecificAllocBase::SpecificAllocBase() {
+  std::lock_guard<std::mutex> lock(instancesMutex);
+  instances.push_back(this);
+}
+
+ArenaAllocator::Shard *ArenaAllocator::addShard() {
+  std::lock_guard<std::mutex> lock(mu);
+  shards.push_back(std::make_unique<Shard>());
+  return shards.back().get();
+}
+
+// Shards are reset rather than freed, since threads keep pointers to them.
+void ArenaAllocator::Reset() {
+  std::lock_guard<std::mutex> lock(mu);
+  for (std::unique_ptr<Shard> &shard : shards) {
+    shard->alloc.Reset();
+    shard->stringAlloc.Reset();
+    shard->numAllocations = 0;
+    shard->numStrings = 0;
+  }
+  unsharded.Reset();
+}
+
+size_t ArenaAllocator::getBytesAllocated() const {
+  std::lock_guard<std::mutex> lock(mu);
+  size_t ret = unsharded.getBytesAllocated();
+  for (const std::unique_ptr<Shard> &shard : shards)
+    ret += shard->alloc.getBytesAllocated() +
+           shard->stringAlloc.getBytesAllocated();
+  return ret;
+}
+
+void ArenaAllocator::addUsage(std::vector<ArenaUsage> &v) const {
+  std::lock_guard<std::mutex> lock(mu);
+  ArenaUsage allocs, strings;
+  allocs.name = "bAlloc";
+  strings.name = "saver";
+  strings.bytes = unsharded.getBytesAllocated();
+  for (const std::unique_ptr<Shard> &shard : shards) {
+    allocs.bytes += shard->alloc.getBytesAllocated();
+    allocs.objects += shard->numAllocations;
+    strings.bytes += shard->stringAlloc.getBytesAllocated();
+    strings.objects += shard->numStrings;
+  }
+  v.push_back(allocs);
+  v.push_back(strings);
+}
+
 void lld::freeArena() {
+  std::lock_guard<std::mutex> lock(instancesMutex);
   for (SpecificAllocBase *alloc : SpecificAllocBase::instances)
     alloc->reset();
   bAlloc.Reset();
 }
+
+size_t lld::getArenaMemoryUsage() {
+  std::lock_guard<std::mutex> lock(instancesMutex);
+  size_t ret = bAlloc.getBytesAllocated();
+  for (SpecificAllocBase *alloc : SpecificAllocBase::instances)
+    ret += alloc->getBytesAllocated();
+  return ret;
+}
+
+std::vector<ArenaUsage> lld::getArenaUsage() {
+  std::vector<ArenaUsage> v;
+  bAlloc.addUsage(v);
+  {
+    std::lock_guard<std::mutex> lock(instancesMutex);
+    for (SpecificAllocBase *alloc : SpecificAllocBase::instances) {
+      ArenaUsage u;
+      u.name = alloc->getName().str();
+      u.bytes = alloc->getBytesAllocated();
+      u.objects = alloc->getObjectsAllocated();
+      v.push_back(u);
+    }
+  }
+
+  // make<>() has an arena for each set of constructor argument types, so
+  // merge the arenas of the same type.
+  llvm::StringMap<size_t> index;
+  std::vector<ArenaUsage> ret;
+  for (ArenaUsage &u : v) {
+    auto it = index.insert({u.name, ret.size()});
+    if (it.second) {
+      ret.push_back(std::move(u));
+      continue;
+    }
+    ret[it.first->second].bytes += u.bytes;
+    ret[it.first->second].objects += u.objects;
+  }
+  std::stable_sort(ret.begin(), ret.end(),
+                   [](const ArenaUsage &a, const ArenaUsage &b) {
+                     return a.bytes > b.bytes;
+                   });
+  return ret;
+}
+
+bool lld::arenaUsageEnabled;
+
+static std::vector<std::pair<std::string, std::vector<ArenaUsage>>> phases;
+
+void lld::recordArenaUsage(StringRef phase) {
+  phases.push_back({phase.str(), getArenaUsage()});
+}
+
+static std::string formatMB(size_t bytes) {
+  std::string s;
+  raw_string_ostream os(s);
+  os << format("%.1f MB", bytes / (1024.0 * 1024.0));
+  return os.str();
+}
+
+void lld::printArenaUsage() {
+  message("Arena growth by phase:");
+  StringMap<size_t> prev;
+  for (const auto &phase : phases) {
+    size_t total = 0;
+    std::vector<std::pair<size_t, StringRef>> growth;
+    for (const ArenaUsage &u : phase.second) {
+      total += u.bytes;
+      size_t before = prev.lookup(u.name);
+      if (u.bytes > before)
+        growth.push_back({u.bytes - before, u.name});
+    }
+    std::stable_sort(growth.begin(), growth.end(),
+                     [](const std::pair<size_t, StringRef> &a,
+                        const std::pair<size_t, StringRef> &b) {
+                       return a.first > b.first;
+                     });
+
+    // Show the arenas that grew the most.
+    std::string s;
+    raw_string_ostream os(s);
+    os << format("  %-30s%10s", (phase.first + ":").c_str(),
+                 formatMB(total).c_str());
+    for (size_t i = 0, e = std::min<size_t>(growth.size(), 3); i != e; ++i)
+      os << (i ? ", " : "  (") << "+" << formatMB(growth[i].first) << " "
+         << growth[i].second;
+    if (!growth.empty())
+      os << ")";
+    message(os.str());
+
+    prev.clear();
+    for (const ArenaUsage &u : phase.second)
+      prev[u.name] = u.bytes;
+  }
+  phases.clear();
+
+  message("Arena usage:");
+  message("           Bytes      Objects  Arena");
+  for (const ArenaUsage &u : getArenaUsage()) {
+    if (!u.bytes)
+      continue;
+    std::string s;
+    raw_string_ostream os(s);
+    os << format("  %14zu %12zu  ", u.bytes, u.objects) << u.name;
+    message(os.str());
+  }
+}
@@ -0,0 +1,153 @@
+//===- PerfCounters.cpp ---------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The counters are Linux perf events of the calling thread, counted in user
+// and kernel mode unless perf_event_paranoid forbids the latter. Each event
+// is opened on its own rather than as a group, so that a machine that lacks
+// one of them, such as a virtual machine without a PMU, still counts the
+// others. If the kernel multiplexes the events because there are more of
+// them than hardware counters, the counts are scaled by the time they were
+// actually counted.
+//
+//===----------------------------------------------------------------------===//
+
+#include "lld/Common/PerfCounters.h"
+#include "lld/Common/ErrorHandler.h"
+#include <atomic>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+using namespace lld;
+
+bool lld::perfCountersEnabled;
+
+static std::atomic<unsigned> numThreads{0};
+
+unsigned lld::getPerfThreadIndex() {
+  static thread_local unsigned index = numThreads++;
+  return index;
+}
+
+StringRef lld::getPerfEventName(unsigned event) {
+  static const char *names[] = {"cycles", "instructions", "llc-misses",
+                                "dtlb-misses", "page-faults"};
+  static_assert(sizeof(names) / sizeof(names[0]) == NumPerfEvents,
+                "one name per event");
+  return names[event];
+}
+
+#ifdef __linux__
+static int openEvent(uint32_t type, uint64_t config, bool excludeKernel) {
+  perf_event_attr attr = {};
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr.exclude_kernel = excludeKernel;
+  attr.exclude_hv = 1;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+static int openEvent(unsigned event) {
+  static const uint64_t llcReadMiss =
+      PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  static const uint64_t dtlbReadMiss =
+      PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+  uint32_t type;
+  uint64_t config;
+  switch (event) {
+  case PerfCycles:
+    type = PERF_TYPE_HARDWARE;
+    config = PERF_COUNT_HW_CPU_CYCLES;
+    break;
+  case PerfInstructions:
+    type = PERF_TYPE_HARDWARE;
+    config = PERF_COUNT_HW_INSTRUCTIONS;
+    break;
+  case PerfLLCMisses:
+    type = PERF_TYPE_HW_CACHE;
+    config = llcReadMiss;
+    break;
+  case PerfDTLBMisses:
+    type = PERF_TYPE_HW_CACHE;
+    config = dtlbReadMiss;
+    break;
+  default:
+    type = PERF_TYPE_SOFTWARE;
+    config = PERF_COUNT_SW_PAGE_FAULTS;
+    break;
+  }
+
+  int fd = openEvent(type, config, false);
+  if (fd < 0)
+    fd = openEvent(type, config, true);
+  return fd;
+}
+
+namespace {
+// The events of one thread. The file descriptors are closed when the thread
+// exits.
+struct ThreadCounters {
+  ThreadCounters() {
+    for (unsigned i = 0; i != NumPerfEvents; ++i)
+      fds[i] = openEvent(i);
+  }
+
+  ~ThreadCounters() {
+    for (int fd : fds)
+      if (fd >= 0)
+        close(fd);
+  }
+
+  int fds[NumPerfEvents];
+};
+} // namespace
+
+PerfCounts lld::readPerfCounters() {
+  static thread_local ThreadCounters counters;
+  PerfCounts ret;
+  for (unsigned i = 0; i != NumPerfEvents; ++i) {
+    uint64_t buf[3];
+    if (counters.fds[i] < 0 ||
+        read(counters.fds[i], buf, sizeof(buf)) != sizeof(buf) || !buf[2])
+      continue;
+    // buf is {value, time enabled, time running}.
+    ret.values[i] =
+        buf[1] == buf[2] ? buf[0] : uint64_t(buf[0] * (double)buf[1] / buf[2]);
+  }
+  return ret;
+}
+
+bool lld::enablePerfCounters() {
+  int fd = openEvent(PerfPageFaults);
+  if (fd < 0) {
+    warn("--perf-counters: cannot open performance counters: " +
+         std::error_code(errno, std::generic_category()).message());
+    return false;
+  }
+  close(fd);
+  perfCountersEnabled = true;
+  return true;
+}
+#else
+PerfCounts lld::readPerfCounters() { return {}; }
+
+bool lld::enablePerfCounters() {
+  warn("--perf-counters is not supported on this platform");
+  return false;
+}
+#endif
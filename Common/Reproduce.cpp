@@ -7,10 +7,14 @@
 //===----------------------------------------------------------------------===//
 
 #include "lld/Common/Reproduce.h"
+#include "lld/Common/Threads.h"
 #include "llvm/Option/Arg.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/TarWriter.h"
+#include <algorithm>
+#include <vector>
 
 using namespace lld;
 using namespace llvm;
@@ -59,3 +63,75 @@ std::string lld::toString(const opt::Arg &arg) {
     return k + v;
   return k + " " + v;
 }
+
+// The number of bytes that may wait to be written before append() blocks.
+static const uint64_t maxQueuedBytes = 64 * 1024 * 1024;
+
+Expected<std::unique_ptr<AsyncTarWriter>>
+AsyncTarWriter::create(StringRef outputPath, StringRef baseDir) {
+  Expected<std::unique_ptr<TarWriter>> tarOrErr =
+      TarWriter::create(outputPath, baseDir);
+  if (!tarOrErr)
+    return tarOrErr.takeError();
+  return std::unique_ptr<AsyncTarWriter>(
+      new AsyncTarWriter(std::move(*tarOrErr)));
+}
+
+AsyncTarWriter::AsyncTarWriter(std::unique_ptr<TarWriter> tar)
+    : tar(std::move(tar)) {
+  if (threadsEnabled)
+    thread = std::thread([this] { run(); });
+}
+
+// run() writes the members that are still queued before it returns.
+AsyncTarWriter::~AsyncTarWriter() {
+  if (thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mu);
+      stopping = true;
+    }
+    workCond.notify_one();
+    thread.join();
+  }
+}
+
+void AsyncTarWriter::append(StringRef path, StringRef data) {
+  if (!thread.joinable()) {
+    tar->append(path, data);
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mu);
+  doneCond.wait(lock, [&] {
+    return queuedBytes + data.size() <= maxQueuedBytes || queue.empty();
+  });
+  queue.push_back({path.str(), data.str()});
+  queuedBytes += data.size();
+  lock.unlock();
+  workCond.notify_one();
+}
+
+void AsyncTarWriter::run() {
+  std::unique_lock<std::mutex> lock(mu);
+  for (;;) {
+    workCond.wait(lock, [&] { return !queue.empty() || stopping; });
+    if (queue.empty())
+      return;
+    Member m = std::move(queue.front());
+    queue.pop_front();
+    writing = true;
+    lock.unlock();
+
+    tar->append(m.path, m.data);
+
+    lock.lock();
+    writing = false;
+    queuedBytes -= m.data.size();
+    doneCond.notify_all();
+  }
+}
+
+void AsyncTarWriter::wait() {
+  std::unique_lock<std::mutex> lock(mu);
+  doneCond.wait(lock, [&] { return queue.empty() && !writing; });
+}
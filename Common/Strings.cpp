@@ -34,10 +34,12 @@ std::string lld::demangleItanium(StringRef name) {
 StringMatcher::StringMatcher(ArrayRef<StringRef> pat) {
   for (StringRef s : pat) {
     Expected<GlobPattern> pat = GlobPattern::create(s);
-    if (!pat)
+    if (!pat) {
       error(toString(pat.takeError()));
-    else
-      patterns.push_back(*pat);
+      continue;
+    }
+    patterns.push_back(*pat);
+    prefixes.push_back(std::string(s.substr(0, s.find_first_of("?*[\\"))));
   }
 }
 
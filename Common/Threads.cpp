@@ -5,7 +5,473 @@
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 //
 //===----------------------------------------------------------------------===//
+//
+// This file implements the thread pool that runs the tasks of TaskGroups.
+//
+// Each worker thread has its own queue of tasks. A thread pushes the tasks it
+// spawns to its own queue and pops them from the same end, so that the tasks
+// of a nested TaskGroup run before the older and larger ones. A thread whose
+// queue is empty steals the oldest task of another queue. Threads that are
+// not workers, such as the main thread, share one more queue.
+//
+// With setNumaAware(true), the workers are split into groups, one per NUMA
+// node, and each worker is pinned to the CPUs of its node. A thread steals
+// from the queues of its own node before those of other nodes, and a task
+// may be pushed to the queue of a worker of a given node.
+//
+//===----------------------------------------------------------------------===//
 
 #include "lld/Common/Threads.h"
+#include "lld/Common/ErrorHandler.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Threading.h"
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <thread>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+using namespace llvm;
+using namespace lld;
 
 bool lld::threadsEnabled = true;
+
+static unsigned threadCount = 0;
+static bool numaAware = false;
+
+static std::atomic<uint64_t> memoryBudget{0};
+static std::atomic<uint64_t> throttleCount{0};
+
+namespace {
+class Executor {
+public:
+  explicit Executor(unsigned numThreads);
+  ~Executor();
+
+  unsigned getNumThreads() const { return threads.size() + 1; }
+  unsigned getNumNodes() const {
+    return nodeQueues.empty() ? 1 : nodeQueues.size();
+  }
+
+  // Pushes a task to the queue of the current thread, or to that of a
+  // worker of the given node.
+  void push(std::function<void()> task, int node = -1);
+
+  // Runs one pending task on the calling thread. Returns false if there was
+  // none.
+  bool runOne();
+
+private:
+  struct Queue {
+    std::mutex mu;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void work(unsigned index);
+  void initNuma(unsigned numThreads);
+
+  // queues[0] belongs to the threads that are not workers.
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> threads;
+
+  // With NUMA-aware threading, the indices of the queues of the workers of
+  // each node, the CPUs of each node, the node of each queue, and the order
+  // in which each queue steals from the others.
+  std::vector<std::vector<unsigned>> nodeQueues;
+  std::vector<std::vector<unsigned>> nodeCpus;
+  std::vector<unsigned> queueNode;
+  std::vector<std::vector<unsigned>> stealOrder;
+  std::atomic<unsigned> nextQueue{0};
+
+  std::mutex mu;
+  std::condition_variable cond;
+  std::atomic<size_t> numQueued{0};
+  bool stop = false;
+};
+} // namespace
+
+// The index of the queue of the current thread.
+static LLVM_THREAD_LOCAL unsigned queueIndex = 0;
+
+std::vector<unsigned> lld::parseCpuList(StringRef s) {
+  std::vector<unsigned> ret;
+  SmallVector<StringRef, 8> ranges;
+  s.trim().split(ranges, ',', -1, false);
+  for (StringRef range : ranges) {
+    std::pair<StringRef, StringRef> p = range.split('-');
+    unsigned first, last;
+    if (!to_integer(p.first, first, 10))
+      continue;
+    if (p.second.empty())
+      last = first;
+    else if (!to_integer(p.second, last, 10))
+      continue;
+    for (unsigned cpu = first; cpu <= last; ++cpu)
+      ret.push_back(cpu);
+  }
+  return ret;
+}
+
+// Returns the CPUs that this process may run on of each NUMA node that has
+// any.
+static std::vector<std::vector<unsigned>> getNumaNodes() {
+  std::vector<std::vector<unsigned>> ret;
+#if defined(__linux__)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed))
+    return ret;
+
+  // Node numbers may have gaps, so look at all of them up to a limit.
+  for (unsigned node = 0; node < 1024; ++node) {
+    std::string path =
+        "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+    FILE *f = fopen(path.c_str(), "r");
+    if (!f)
+      continue;
+    char buf[4096];
+    StringRef line = fgets(buf, sizeof(buf), f) ? buf : "";
+    fclose(f);
+    std::vector<unsigned> cpus;
+    for (unsigned cpu : parseCpuList(line))
+      if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+        cpus.push_back(cpu);
+    if (!cpus.empty())
+      ret.push_back(std::move(cpus));
+  }
+#endif
+  return ret;
+}
+
+// Splits the workers into nodes in proportion to the CPUs of the nodes that
+// the process may use.
+void Executor::initNuma(unsigned numThreads) {
+  nodeCpus = getNumaNodes();
+  if (nodeCpus.size() < 2 || numThreads < nodeCpus.size() + 1) {
+    nodeCpus.clear();
+    return;
+  }
+
+  size_t totalCpus = 0;
+  for (std::vector<unsigned> &cpus : nodeCpus)
+    totalCpus += cpus.size();
+
+  // queues[0] is for the threads that are not workers, which are not pinned
+  // and are said to be on node 0.
+  nodeQueues.resize(nodeCpus.size());
+  queueNode.assign(numThreads, 0);
+  size_t cpusBefore = 0;
+  for (unsigned node = 0, e = nodeCpus.size(); node < e; ++node) {
+    unsigned begin = 1 + cpusBefore * (numThreads - 1) / totalCpus;
+    cpusBefore += nodeCpus[node].size();
+    unsigned end = 1 + cpusBefore * (numThreads - 1) / totalCpus;
+    for (unsigned i = begin; i < end; ++i) {
+      nodeQueues[node].push_back(i);
+      queueNode[i] = node;
+    }
+  }
+
+  // Each queue steals from the queues of its node first, then from the
+  // others in order.
+  stealOrder.resize(numThreads);
+  for (unsigned i = 0; i < numThreads; ++i) {
+    for (unsigned j = 1; j < numThreads; ++j) {
+      unsigned k = (i + j) % numThreads;
+      if (queueNode[k] == queueNode[i])
+        stealOrder[i].push_back(k);
+    }
+    for (unsigned j = 1; j < numThreads; ++j) {
+      unsigned k = (i + j) % numThreads;
+      if (queueNode[k] != queueNode[i])
+        stealOrder[i].push_back(k);
+    }
+  }
+}
+
+Executor::Executor(unsigned numThreads) {
+  for (unsigned i = 0; i < numThreads; ++i)
+    queues.push_back(std::make_unique<Queue>());
+  if (numaAware)
+    initNuma(numThreads);
+  for (unsigned i = 1; i < numThreads; ++i)
+    threads.emplace_back([=] { work(i); });
+}
+
+Executor::~Executor() {
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    stop = true;
+  }
+  cond.notify_all();
+  for (std::thread &t : threads)
+    t.join();
+}
+
+void Executor::push(std::function<void()> task, int node) {
+  unsigned index = queueIndex;
+  if (node >= 0 && !nodeQueues.empty()) {
+    const std::vector<unsigned> &v = nodeQueues[node % nodeQueues.size()];
+    if (!v.empty() && queueNode[index] != unsigned(node % nodeQueues.size()))
+      index = v[nextQueue++ % v.size()];
+  }
+  Queue &q = *queues[index];
+  {
+    std::lock_guard<std::mutex> lock(q.mu);
+    q.tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    ++numQueued;
+  }
+  cond.notify_one();
+}
+
+bool Executor::runOne() {
+  std::function<void()> task;
+  {
+    Queue &q = *queues[queueIndex];
+    std::lock_guard<std::mutex> lock(q.mu);
+    if (!q.tasks.empty()) {
+      task = std::move(q.tasks.back());
+      q.tasks.pop_back();
+    }
+  }
+
+  for (size_t i = 1, e = queues.size(); !task && i < e; ++i) {
+    size_t index = stealOrder.empty() ? (queueIndex + i) % e
+                                      : stealOrder[queueIndex][i - 1];
+    Queue &q = *queues[index];
+    std::lock_guard<std::mutex> lock(q.mu);
+    if (!q.tasks.empty()) {
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+    }
+  }
+
+  if (!task)
+    return false;
+  --numQueued;
+
+  // The task may come from a different loop than the one that this thread
+  // is running, so it must not report to that loop's diagnostic buffer.
+  DiagnosticBuffer *diags = DiagnosticBuffer::setCurrent(nullptr);
+  task();
+  DiagnosticBuffer::setCurrent(diags);
+  return true;
+}
+
+void Executor::work(unsigned index) {
+  queueIndex = index;
+#if defined(__linux__)
+  if (!nodeCpus.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu : nodeCpus[queueNode[index]])
+      CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+  }
+#endif
+  for (;;) {
+    if (runOne())
+      continue;
+    std::unique_lock<std::mutex> lock(mu);
+    cond.wait(lock, [&] { return stop || numQueued > 0; });
+    if (stop)
+      return;
+  }
+}
+
+static std::mutex executorMutex;
+static std::unique_ptr<Executor> executor;
+
+static Executor &getExecutor() {
+  std::lock_guard<std::mutex> lock(executorMutex);
+  if (!executor)
+    executor = std::make_unique<Executor>(getThreadCount());
+  return *executor;
+}
+
+// This must not be called while tasks are running.
+void lld::setThreadCount(unsigned n) {
+  std::lock_guard<std::mutex> lock(executorMutex);
+  if (n == threadCount)
+    return;
+  threadCount = n;
+  executor.reset();
+}
+
+void lld::setNumaAware(bool enabled) {
+  std::lock_guard<std::mutex> lock(executorMutex);
+  if (enabled == numaAware)
+    return;
+  numaAware = enabled;
+  executor.reset();
+}
+
+unsigned lld::getNumaNodeCount() {
+  if (!numaAware || getThreadCount() == 1)
+    return 1;
+  return getExecutor().getNumNodes();
+}
+
+unsigned lld::getThreadCount() {
+  if (!threadsEnabled)
+    return 1;
+  if (threadCount)
+    return threadCount;
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void lld::setMemoryBudget(uint64_t bytes) {
+  memoryBudget = bytes;
+  throttleCount = 0;
+}
+
+uint64_t lld::getMemoryBudget() { return memoryBudget; }
+
+// Returns the resident set size of the process, or 0 if it is unknown.
+static uint64_t readResidentSetSize() {
+#if defined(__linux__)
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (!f)
+    return 0;
+  unsigned long long size = 0, resident = 0;
+  int n = fscanf(f, "%llu %llu", &size, &resident);
+  fclose(f);
+  if (n != 2)
+    return 0;
+  return resident * sys::Process::getPageSizeEstimate();
+#else
+  return 0;
+#endif
+}
+
+// Reading the resident set size takes a system call, and this is called
+// for every task, so the value is reused for a while.
+static uint64_t getResidentSetSize() {
+  static std::atomic<uint64_t> lastSize{0};
+  static std::atomic<int64_t> lastTime{0};
+  int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+  int64_t last = lastTime;
+  if (now - last >= 5 && lastTime.compare_exchange_strong(last, now))
+    lastSize = readResidentSetSize();
+  return lastSize;
+}
+
+bool lld::isNearMemoryBudget() {
+  uint64_t budget = memoryBudget;
+  // The last tenth of the budget is left for the tasks that still run.
+  return budget && getResidentSetSize() >= budget - budget / 10;
+}
+
+uint64_t lld::getMemoryHeadroom() {
+  uint64_t budget = memoryBudget;
+  if (!budget)
+    return UINT64_MAX;
+  uint64_t rss = getResidentSetSize();
+  return rss < budget ? budget - rss : 0;
+}
+
+uint64_t lld::getMemoryThrottleCount() { return throttleCount; }
+
+void lld::addMemoryThrottleCount() { ++throttleCount; }
+
+// Returns true if parallel work should run on the calling thread because the
+// process is running out of its memory budget.
+static bool shouldThrottle() {
+  if (!isNearMemoryBudget())
+    return false;
+  addMemoryThrottleCount();
+  return true;
+}
+
+void TaskGroup::spawn(std::function<void()> fn, int node) {
+  if (getThreadCount() == 1 || shouldThrottle()) {
+    fn();
+    return;
+  }
+
+  ++pending;
+  getExecutor().push(
+      [this, fn = std::move(fn)] {
+        fn();
+        std::lock_guard<std::mutex> lock(mu);
+        if (--pending == 0)
+          cond.notify_all();
+      },
+      node);
+}
+
+void TaskGroup::wait() {
+  // Help running tasks while there are any. If there are none, the remaining
+  // tasks of this group are running on other threads, which may still spawn
+  // more, so check again from time to time.
+  if (pending != 0) {
+    Executor &e = getExecutor();
+    while (pending != 0) {
+      if (e.runOne())
+        continue;
+      std::unique_lock<std::mutex> lock(mu);
+      cond.wait_for(lock, std::chrono::milliseconds(1),
+                    [&] { return pending == 0; });
+    }
+  }
+
+  // The last task may still hold mu. Make sure it has released it before
+  // this group can be destroyed.
+  std::lock_guard<std::mutex> lock(mu);
+}
+
+size_t lld::getTaskSize(size_t n, size_t grainSize) {
+  if (grainSize)
+    return grainSize;
+  // Create up to 1024 tasks, like llvm::parallel does.
+  return std::max<size_t>(n / 1024, 1);
+}
+
+void lld::parallelForEachN(size_t begin, size_t end,
+                           function_ref<void(size_t)> fn, size_t grainSize) {
+  if (begin >= end)
+    return;
+  size_t taskSize = getTaskSize(end - begin, grainSize);
+  if (getThreadCount() == 1 || end - begin <= taskSize || shouldThrottle()) {
+    for (size_t i = begin; i < end; ++i)
+      fn(i);
+    return;
+  }
+
+  // Each task reports diagnostics to its own buffer. They are printed in
+  // the order of the tasks after all of them have finished, so the output
+  // is the same as if the loop ran serially.
+  size_t numTasks = (end - begin + taskSize - 1) / taskSize;
+  std::vector<DiagnosticBuffer> diags(numTasks);
+  auto runTask = [=, &diags](size_t task) {
+    DiagnosticBuffer *old = DiagnosticBuffer::setCurrent(&diags[task]);
+    size_t first = begin + task * taskSize;
+    for (size_t i = first, e = std::min(first + taskSize, end); i < e; ++i)
+      fn(i);
+    DiagnosticBuffer::setCurrent(old);
+  };
+
+  // With several NUMA nodes, each node runs a contiguous range of tasks.
+  // The last task, which runs on this thread, is not bound to a node.
+  unsigned numNodes = getNumaNodeCount();
+  {
+    TaskGroup tg;
+    for (size_t task = 0; task + 1 < numTasks; ++task) {
+      int node = numNodes > 1 ? task * numNodes / numTasks : -1;
+      tg.spawn([=] { runTask(task); }, node);
+    }
+    runTask(numTasks - 1);
+  }
+  DiagnosticBuffer::flush(diags);
+}
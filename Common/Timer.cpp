@@ -8,17 +8,61 @@
 
 #include "lld/Common/Timer.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Memory.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include <thread>
 
 using namespace lld;
 using namespace llvm;
 
-ScopedTimer::ScopedTimer(Timer &t) : t(&t) { t.start(); }
+using Clock = std::chrono::high_resolution_clock;
+
+// Guards the children of all timers.
+static std::mutex childrenMutex;
+
+// The time trace profiler is not thread-safe, so only the thread that
+// starts the link records trace events.
+static const std::thread::id mainThread = std::this_thread::get_id();
+
+static std::chrono::nanoseconds getProcessCPUTime() {
+  sys::TimePoint<> elapsed;
+  std::chrono::nanoseconds user, system;
+  sys::Process::GetTimeUsage(elapsed, user, system);
+  return user + system;
+}
+
+// If the time trace profiler is enabled, each scoped timer also records a
+// trace event with the name of its timer. The events of top-level phases
+// also record the arena memory usage at the start of the phase.
+ScopedTimer::ScopedTimer(Timer &t) : t(&t) {
+  t.start();
+  startTime = Clock::now();
+  if (perfCountersEnabled)
+    startCounts = readPerfCounters();
+  if (!timeTraceProfilerEnabled() || std::this_thread::get_id() != mainThread)
+    return;
+  std::string detail;
+  if (t.isTopLevel())
+    detail = ("arena memory: " + Twine(getArenaMemoryUsage()) + " bytes").str();
+  timeTraceProfilerBegin(t.getName(), detail);
+}
 
 void ScopedTimer::stop() {
   if (!t)
     return;
-  t->stop();
+  if (perfCountersEnabled) {
+    PerfCounts counts = readPerfCounters();
+    for (unsigned i = 0; i != NumPerfEvents; ++i)
+      counts.values[i] -= std::min(counts.values[i], startCounts.values[i]);
+    t->addPerfCounts(getPerfThreadIndex(), counts);
+  }
+  t->stop(Clock::now() - startTime);
+  if (timeTraceProfilerEnabled() && std::this_thread::get_id() == mainThread)
+    timeTraceProfilerEnd();
   t = nullptr;
 }
 
@@ -28,14 +72,42 @@ Timer::Timer(llvm::StringRef name) : name(name), parent(nullptr) {}
 Timer::Timer(llvm::StringRef name, Timer &parent)
     : name(name), parent(&parent) {}
 
+// The wall and CPU times are measured from when the timer starts running on
+// some thread to when it stops running on all of them.
 void Timer::start() {
-  if (parent && total.count() == 0)
-    parent->children.push_back(this);
-  startTime = std::chrono::high_resolution_clock::now();
+  if (parent && !registered) {
+    std::lock_guard<std::mutex> lock(childrenMutex);
+    if (!registered)
+      parent->children.push_back(this);
+    registered = true;
+  }
+
+  std::lock_guard<std::mutex> lock(mu);
+  if (numRunning++ == 0) {
+    startTime = Clock::now();
+    startCPUTime = getProcessCPUTime();
+  }
 }
 
-void Timer::stop() {
-  total += (std::chrono::high_resolution_clock::now() - startTime);
+void Timer::stop(std::chrono::nanoseconds busy) {
+  std::lock_guard<std::mutex> lock(mu);
+  ++count;
+  busyTotal += busy;
+  if (--numRunning != 0)
+    return;
+  total += Clock::now() - startTime;
+  cpuTotal += getProcessCPUTime() - startCPUTime;
+  if (isTopLevel()) {
+    arenaMemory = getArenaMemoryUsage();
+    if (arenaUsageEnabled)
+      recordArenaUsage(name);
+  }
+}
+
+void Timer::addPerfCounts(unsigned thread, const PerfCounts &counts) {
+  std::lock_guard<std::mutex> lock(mu);
+  perfTotal += counts;
+  perfByThread[thread] += counts;
 }
 
 Timer &Timer::root() {
@@ -43,37 +115,159 @@ Timer &Timer::root() {
   return rootTimer;
 }
 
+std::vector<Timer *> Timer::getChildren() const {
+  std::lock_guard<std::mutex> lock(childrenMutex);
+  return children;
+}
+
 void Timer::print() {
   double totalDuration = static_cast<double>(root().millis());
 
   // We want to print the grand total under all the intermediate phases, so we
   // print all children first, then print the total under that.
-  for (const auto &child : children)
+  for (const auto &child : getChildren())
     child->print(1, totalDuration);
 
-  message(std::string(49, '-'));
+  message(std::string(63, '-'));
 
   root().print(0, root().millis(), false);
 }
 
-double Timer::millis() const {
+static double toMillis(std::chrono::nanoseconds d) {
   return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
-             total)
+             d)
       .count();
 }
 
+double Timer::millis() const {
+  std::lock_guard<std::mutex> lock(mu);
+  return toMillis(total);
+}
+
+double Timer::cpuMillis() const {
+  std::lock_guard<std::mutex> lock(mu);
+  return toMillis(cpuTotal);
+}
+
+double Timer::busyMillis() const {
+  std::lock_guard<std::mutex> lock(mu);
+  return toMillis(busyTotal);
+}
+
+uint64_t Timer::getCount() const {
+  std::lock_guard<std::mutex> lock(mu);
+  return count;
+}
+
 void Timer::print(int depth, double totalDuration, bool recurse) const {
   double p = 100.0 * millis() / totalDuration;
 
   SmallString<32> str;
   llvm::raw_svector_ostream stream(str);
   std::string s = std::string(depth * 2, ' ') + name + std::string(":");
-  stream << format("%-30s%5d ms (%5.1f%%)", s.c_str(), (int)millis(), p);
+  stream << format("%-30s%5d ms (%5.1f%%) %6d ms cpu", s.c_str(), (int)millis(),
+                   p, (int)cpuMillis());
+  if (arenaUsageEnabled && isTopLevel())
+    stream << format(" %8.1f MB arena", arenaMemory / (1024.0 * 1024.0));
 
   message(str);
+  if (perfCountersEnabled)
+    printPerfCounts(depth);
 
   if (recurse) {
-    for (const auto &child : children)
+    for (const auto &child : getChildren())
       child->print(depth + 1, totalDuration);
   }
 }
+
+// Prints the event counts of this timer and how many threads they came from,
+// e.g. "cycles=1.2G instructions=2.0G (IPC 1.67) llc-misses=3.1M ...".
+void Timer::printPerfCounts(int depth) const {
+  PerfCounts counts;
+  size_t numThreads;
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    counts = perfTotal;
+    numThreads = perfByThread.size();
+  }
+
+  SmallString<128> str;
+  raw_svector_ostream os(str);
+  os.indent(depth * 2 + 2);
+  for (unsigned i = 0; i != NumPerfEvents; ++i) {
+    double v = counts.values[i];
+    os << getPerfEventName(i) << "=";
+    if (v >= 1e9)
+      os << format("%.1fG ", v / 1e9);
+    else if (v >= 1e6)
+      os << format("%.1fM ", v / 1e6);
+    else if (v >= 1e3)
+      os << format("%.1fK ", v / 1e3);
+    else
+      os << counts.values[i] << " ";
+    if (i == PerfInstructions && counts.values[PerfCycles])
+      os << format("(IPC %.2f) ", v / counts.values[PerfCycles]);
+  }
+  os << "on " << numThreads << (numThreads == 1 ? " thread" : " threads");
+  message(str);
+}
+
+static void writePerfCounts(json::OStream &j, const PerfCounts &counts) {
+  for (unsigned i = 0; i != NumPerfEvents; ++i)
+    j.attribute(getPerfEventName(i), int64_t(counts.values[i]));
+}
+
+void Timer::writeJSON(json::OStream &j) const {
+  j.object([&] {
+    j.attribute("name", name);
+    j.attribute("ms", millis());
+    j.attribute("cpu_ms", cpuMillis());
+    j.attribute("busy_ms", busyMillis());
+    j.attribute("count", int64_t(getCount()));
+    if (isTopLevel()) {
+      std::lock_guard<std::mutex> lock(mu);
+      j.attribute("arena_bytes", int64_t(arenaMemory));
+    }
+    if (perfCountersEnabled) {
+      std::lock_guard<std::mutex> lock(mu);
+      j.attributeObject("perf", [&] {
+        writePerfCounts(j, perfTotal);
+        j.attributeArray("threads", [&] {
+          for (const std::pair<const unsigned, PerfCounts> &p : perfByThread)
+            j.object([&] {
+              j.attribute("thread", int64_t(p.first));
+              writePerfCounts(j, p.second);
+            });
+        });
+      });
+    }
+    j.attributeArray("children", [&] {
+      for (const Timer *child : getChildren())
+        child->writeJSON(j);
+    });
+  });
+}
+
+// The output looks like this:
+//
+//   {
+//     "name": "Total Link Time",
+//     "ms": 120.5,
+//     "cpu_ms": 410.2,
+//     "busy_ms": 120.5,
+//     "count": 1,
+//     "arena_bytes": 123456,
+//     "perf": {"cycles": 1234, ..., "threads": [{"thread": 0, ...}]},
+//     "children": [{"name": "Input File Reading", ...}]
+//   }
+void lld::writeTimersJSON(StringRef path) {
+  std::error_code ec;
+  raw_fd_ostream os(path, ec, sys::fs::OF_Text);
+  if (ec) {
+    error("cannot open " + path + ": " + ec.message());
+    return;
+  }
+  json::OStream j(os, 2);
+  Timer::root().writeJSON(j);
+  os << "\n";
+}
@@ -35,6 +35,7 @@
 #include "Target.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
+#include "lld/Common/Threads.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -438,9 +439,12 @@ void AArch64Err843419Patcher::init() {
     return b->getName() == "$d" || b->getName().startswith("$d.");
   };
 
-  // Collect mapping symbols for every executable InputSection.
-  for (InputFile *file : objectFiles) {
-    auto *f = cast<ObjFile<ELF64LE>>(file);
+  // Collect mapping symbols for every executable InputSection. The files are
+  // read in parallel, and sectionMap is then filled in the order of the files
+  // so that the order of mapping symbols at the same address is stable.
+  std::vector<std::vector<const Defined *>> fileMapSyms(objectFiles.size());
+  parallelForEachN(0, objectFiles.size(), [&](size_t i) {
+    auto *f = cast<ObjFile<ELF64LE>>(objectFiles[i]);
     for (Symbol *b : f->getLocalSymbols()) {
       auto *def = dyn_cast<Defined>(b);
       if (!def)
@@ -449,28 +453,34 @@ void AArch64Err843419Patcher::init() {
         continue;
       if (auto *sec = dyn_cast_or_null<InputSection>(def->section))
         if (sec->flags & SHF_EXECINSTR)
-          sectionMap[sec].push_back(def);
+          fileMapSyms[i].push_back(def);
     }
-  }
+  });
+  for (std::vector<const Defined *> &syms : fileMapSyms)
+    for (const Defined *def : syms)
+      sectionMap[cast<InputSection>(def->section)].push_back(def);
+
   // For each InputSection make sure the mapping symbols are in sorted in
   // ascending order and free from consecutive runs of mapping symbols with
   // the same type. For example we must remove the redundant $d.1 from $x.0
   // $d.0 $d.1 $x.1.
-  for (auto &kv : sectionMap) {
-    std::vector<const Defined *> &mapSyms = kv.second;
-    llvm::stable_sort(mapSyms, [](const Defined *a, const Defined *b) {
+  std::vector<std::vector<const Defined *> *> mapSymLists;
+  for (auto &kv : sectionMap)
+    mapSymLists.push_back(&kv.second);
+  parallelForEach(mapSymLists, [&](std::vector<const Defined *> *mapSyms) {
+    llvm::stable_sort(*mapSyms, [](const Defined *a, const Defined *b) {
       return a->value < b->value;
     });
-    mapSyms.erase(
-        std::unique(mapSyms.begin(), mapSyms.end(),
+    mapSyms->erase(
+        std::unique(mapSyms->begin(), mapSyms->end(),
                     [=](const Defined *a, const Defined *b) {
                       return isCodeMapSymbol(a) == isCodeMapSymbol(b);
                     }),
-        mapSyms.end());
+        mapSyms->end());
     // Always start with a Code Mapping Symbol.
-    if (!mapSyms.empty() && !isCodeMapSymbol(mapSyms.front()))
-      mapSyms.erase(mapSyms.begin());
-  }
+    if (!mapSyms->empty() && !isCodeMapSymbol(mapSyms->front()))
+      mapSyms->erase(mapSyms->begin());
+  });
   initialized = true;
 }
 
@@ -576,17 +586,34 @@ static void implementPatch(uint64_t adrpAddr, uint64_t patcheeOffset,
 std::vector<Patch843419Section *>
 AArch64Err843419Patcher::patchInputSectionDescription(
     InputSectionDescription &isd) {
-  std::vector<Patch843419Section *> patches;
-  for (InputSection *isec : isd.sections) {
+  // Scanning does not modify anything, so the sections are scanned in
+  // parallel and the patches are created afterwards in section order.
+  //
+  // Whether an instruction sequence triggers the erratum depends only on its
+  // address. If a section has not moved since it was last scanned, every
+  // sequence in it has already been patched, so there is no need to scan it
+  // again.
+  std::vector<InputSection *> &sections = isd.sections;
+  std::vector<std::vector<std::pair<uint64_t, uint64_t>>> found(
+      sections.size());
+  parallelForEachN(0, sections.size(), [&](size_t i) {
+    InputSection *isec = sections[i];
     //  LLD doesn't use the erratum sequence in SyntheticSections.
     if (isa<SyntheticSection>(isec))
-      continue;
+      return;
+    auto it = sectionMap.find(isec);
+    if (it == sectionMap.end())
+      return;
+    auto addrIt = scannedAddrs.find(isec);
+    if (addrIt != scannedAddrs.end() && addrIt->second == isec->getVA(0))
+      return;
+
     // Use sectionMap to make sure we only scan code and not inline data.
     // We have already sorted MapSyms in ascending order and removed consecutive
     // mapping symbols of the same type. Our range of executable instructions to
     // scan is therefore [codeSym->value, dataSym->value) or [codeSym->value,
     // section size).
-    std::vector<const Defined *> &mapSyms = sectionMap[isec];
+    std::vector<const Defined *> &mapSyms = it->second;
 
     auto codeSym = mapSyms.begin();
     while (codeSym != mapSyms.end()) {
@@ -599,12 +626,21 @@ AArch64Err843419Patcher::patchInputSectionDescription(
         uint64_t startAddr = isec->getVA(off);
         if (uint64_t patcheeOffset =
                 scanCortexA53Errata843419(isec, off, limit))
-          implementPatch(startAddr, patcheeOffset, isec, patches);
+          found[i].push_back({startAddr, patcheeOffset});
       }
       if (dataSym == mapSyms.end())
         break;
       codeSym = std::next(dataSym);
     }
+  });
+
+  std::vector<Patch843419Section *> patches;
+  for (size_t i = 0, e = sections.size(); i != e; ++i) {
+    InputSection *isec = sections[i];
+    for (std::pair<uint64_t, uint64_t> &p : found[i])
+      implementPatch(p.first, p.second, isec, patches);
+    if (!isa<SyntheticSection>(isec) && sectionMap.count(isec))
+      scannedAddrs[isec] = isec->getVA(0);
   }
   return patches;
 }
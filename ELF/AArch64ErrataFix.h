@@ -10,6 +10,7 @@
 #define LLD_ELF_AARCH64ERRATAFIX_H
 
 #include "lld/Common/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
 #include <map>
 #include <vector>
 
@@ -41,6 +42,9 @@ private:
   // the ranges of code and data in an executable InputSection.
   std::map<InputSection *, std::vector<const Defined *>> sectionMap;
 
+  // The addresses of the InputSections when they were last scanned.
+  llvm::DenseMap<InputSection *, uint64_t> scannedAddrs;
+
   bool initialized = false;
 };
 
@@ -24,6 +24,7 @@
 #include "Target.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
+#include "lld/Common/Threads.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -239,9 +240,11 @@ struct ScanResult {
 // and a decoding of the branch. If the erratum sequence is not found then
 // return an offset of 0 for the branch. 0 is a safe value to use for no patch
 // as there must be at least one 32-bit non-branch instruction before the
-// branch so the minimum offset for a patch is 4.
+// branch so the minimum offset for a patch is 4. If the erratum sequence is
+// found but cannot be patched, numTooLarge is incremented.
 static ScanResult scanCortexA8Errata657417(InputSection *isec, uint64_t &off,
-                                           uint64_t limit) {
+                                           uint64_t limit,
+                                           size_t &numTooLarge) {
   uint64_t isecAddr = isec->getVA(0);
   // Advance Off so that (isecAddr + off) modulo 0x1000 is at least 0xffa. We
   // need to check for a 32-bit instruction immediately before a 32-bit branch
@@ -281,9 +284,7 @@ static ScanResult scanCortexA8Errata657417(InputSection *isec, uint64_t &off,
           scanRes.off = branchOff;
           scanRes.instr = instr2;
         } else {
-          warn(toString(isec->file) +
-               ": skipping cortex-a8 657417 erratum sequence, section " +
-               isec->name + " is too large to patch");
+          ++numTooLarge;
         }
       }
     }
@@ -314,9 +315,12 @@ void ARMErr657417Patcher::init() {
     return s->getName() == "$d" || s->getName().startswith("$d.");
   };
 
-  // Collect mapping symbols for every executable InputSection.
-  for (InputFile *file : objectFiles) {
-    auto *f = cast<ObjFile<ELF32LE>>(file);
+  // Collect mapping symbols for every executable InputSection. The files are
+  // read in parallel, and sectionMap is then filled in the order of the files
+  // so that the order of mapping symbols at the same address is stable.
+  std::vector<std::vector<const Defined *>> fileMapSyms(objectFiles.size());
+  parallelForEachN(0, objectFiles.size(), [&](size_t i) {
+    auto *f = cast<ObjFile<ELF32LE>>(objectFiles[i]);
     for (Symbol *s : f->getLocalSymbols()) {
       auto *def = dyn_cast<Defined>(s);
       if (!def)
@@ -326,26 +330,32 @@ void ARMErr657417Patcher::init() {
         continue;
       if (auto *sec = dyn_cast_or_null<InputSection>(def->section))
         if (sec->flags & SHF_EXECINSTR)
-          sectionMap[sec].push_back(def);
+          fileMapSyms[i].push_back(def);
     }
-  }
+  });
+  for (std::vector<const Defined *> &syms : fileMapSyms)
+    for (const Defined *def : syms)
+      sectionMap[cast<InputSection>(def->section)].push_back(def);
+
   // For each InputSection make sure the mapping symbols are in sorted in
   // ascending order and are in alternating Thumb, non-Thumb order.
-  for (auto &kv : sectionMap) {
-    std::vector<const Defined *> &mapSyms = kv.second;
-    llvm::stable_sort(mapSyms, [](const Defined *a, const Defined *b) {
+  std::vector<std::vector<const Defined *> *> mapSymLists;
+  for (auto &kv : sectionMap)
+    mapSymLists.push_back(&kv.second);
+  parallelForEach(mapSymLists, [&](std::vector<const Defined *> *mapSyms) {
+    llvm::stable_sort(*mapSyms, [](const Defined *a, const Defined *b) {
       return a->value < b->value;
     });
-    mapSyms.erase(std::unique(mapSyms.begin(), mapSyms.end(),
-                              [=](const Defined *a, const Defined *b) {
-                                return (isThumbMapSymbol(a) ==
-                                        isThumbMapSymbol(b));
-                              }),
-                  mapSyms.end());
+    mapSyms->erase(std::unique(mapSyms->begin(), mapSyms->end(),
+                               [=](const Defined *a, const Defined *b) {
+                                 return (isThumbMapSymbol(a) ==
+                                         isThumbMapSymbol(b));
+                               }),
+                   mapSyms->end());
     // Always start with a Thumb Mapping Symbol
-    if (!mapSyms.empty() && !isThumbMapSymbol(mapSyms.front()))
-      mapSyms.erase(mapSyms.begin());
-  }
+    if (!mapSyms->empty() && !isThumbMapSymbol(mapSyms->front()))
+      mapSyms->erase(mapSyms->begin());
+  });
   initialized = true;
 }
 
@@ -471,17 +481,26 @@ static void implementPatch(ScanResult sr, InputSection *isec,
 std::vector<Patch657417Section *>
 ARMErr657417Patcher::patchInputSectionDescription(
     InputSectionDescription &isd) {
-  std::vector<Patch657417Section *> patches;
-  for (InputSection *isec : isd.sections) {
+  // Scanning does not modify anything, so the sections are scanned in
+  // parallel and the patches are created afterwards in section order.
+  std::vector<InputSection *> &sections = isd.sections;
+  std::vector<std::vector<ScanResult>> found(sections.size());
+  std::vector<size_t> numTooLarge(sections.size());
+  parallelForEachN(0, sections.size(), [&](size_t i) {
+    InputSection *isec = sections[i];
     // LLD doesn't use the erratum sequence in SyntheticSections.
     if (isa<SyntheticSection>(isec))
-      continue;
+      return;
+    auto it = sectionMap.find(isec);
+    if (it == sectionMap.end())
+      return;
+
     // Use sectionMap to make sure we only scan Thumb code and not Arm or inline
     // data. We have already sorted mapSyms in ascending order and removed
     // consecutive mapping symbols of the same type. Our range of executable
     // instructions to scan is therefore [thumbSym->value, nonThumbSym->value)
     // or [thumbSym->value, section size).
-    std::vector<const Defined *> &mapSyms = sectionMap[isec];
+    std::vector<const Defined *> &mapSyms = it->second;
 
     auto thumbSym = mapSyms.begin();
     while (thumbSym != mapSyms.end()) {
@@ -491,14 +510,40 @@ ARMErr657417Patcher::patchInputSectionDescription(
                                                       : (*nonThumbSym)->value;
 
       while (off < limit) {
-        ScanResult sr = scanCortexA8Errata657417(isec, off, limit);
+        ScanResult sr =
+            scanCortexA8Errata657417(isec, off, limit, numTooLarge[i]);
         if (sr.off)
-          implementPatch(sr, isec, patches);
+          found[i].push_back(sr);
       }
       if (nonThumbSym == mapSyms.end())
         break;
       thumbSym = std::next(nonThumbSym);
     }
+  });
+
+  std::vector<Patch657417Section *> patches;
+  for (size_t i = 0, e = sections.size(); i != e; ++i) {
+    InputSection *isec = sections[i];
+    for (size_t j = 0; j != numTooLarge[i]; ++j)
+      warn(toString(isec->file) +
+           ": skipping cortex-a8 657417 erratum sequence, section " +
+           isec->name + " is too large to patch");
+
+    std::vector<ScanResult> &results = found[i];
+    if (results.empty())
+      continue;
+
+    // implementPatch may add a relocation to isec for each result, which
+    // must not move the relocations that the results point to.
+    std::vector<ptrdiff_t> relIdx;
+    for (const ScanResult &sr : results)
+      relIdx.push_back(sr.rel ? sr.rel - isec->relocations.data() : -1);
+    isec->relocations.reserve(isec->relocations.size() + results.size());
+    for (size_t j = 0, f = results.size(); j != f; ++j) {
+      if (relIdx[j] != -1)
+        results[j].rel = &isec->relocations[relIdx[j]];
+      implementPatch(results[j], isec, patches);
+    }
   }
   return patches;
 }
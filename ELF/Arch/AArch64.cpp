@@ -45,6 +45,8 @@ public:
   bool inBranchRange(RelType type, uint64_t src, uint64_t dst) const override;
   bool usesOnlyLowPageBits(RelType type) const override;
   void relocateOne(uint8_t *loc, RelType type, uint64_t val) const override;
+  void relocateAlloc(InputSectionBase &sec, uint8_t *buf,
+                     uint8_t *bufEnd) const override;
   RelExpr adjustRelaxExpr(RelType type, const uint8_t *data,
                           RelExpr expr) const override;
   void relaxTlsGdToLe(uint8_t *loc, RelType type, uint64_t val) const override;
@@ -282,6 +284,45 @@ static void or32AArch64Imm(uint8_t *l, uint64_t imm) {
   or32le(l, (imm & 0xFFF) << 10);
 }
 
+// A non-preemptible symbol whose address is loaded from the GOT with
+//   adrp x0, :got:sym                 [R_AARCH64_ADR_GOT_PAGE]
+//   ldr  x0, [x0, :got_lo12:sym]      [R_AARCH64_LD64_GOT_LO12_NC]
+// doesn't need a GOT entry, because its address can be computed with
+//   adrp x0, sym
+//   add  x0, x0, :lo12:sym
+// or, if the symbol is within 1 MiB of the ldr, with
+//   nop
+//   adr  x0, sym
+//
+// Returns true if loc points to such an adrp followed by such an ldr. The
+// registers have to be the same so that the value of the adrp is not used
+// by any other instruction.
+bool canRelaxAArch64GotLoad(const uint8_t *loc) {
+  uint32_t adrp = read32le(loc);
+  uint32_t ldr = read32le(loc + 4);
+  if ((adrp & 0x9f000000) != 0x90000000 || (ldr & 0xffc00000) != 0xf9400000)
+    return false;
+  uint32_t reg = adrp & 0x1f;
+  return (ldr & 0x1f) == reg && ((ldr >> 5) & 0x1f) == reg &&
+         ((ldr >> 10) & 0xfff) == 0;
+}
+
+// Rewrites the ldr at loc, whose address is p, of a pair accepted by
+// canRelaxAArch64GotLoad() to compute val. The adrp before it has already
+// been relocated to point to the page of val.
+void relaxAArch64GotLoad(uint8_t *loc, uint64_t p, uint64_t val) {
+  uint32_t reg = read32le(loc) & 0x1f;
+  int64_t disp = val - p;
+  if (isInt<21>(disp)) {
+    write32le(loc - 4, 0xd503201f); // nop
+    write32le(loc, 0x10000000 | reg); // adr
+    write32AArch64Addr(loc, disp);
+    return;
+  }
+  write32le(loc, 0x91000000 | (reg << 5) | reg); // add
+  or32AArch64Imm(loc, val);
+}
+
 // Update the immediate field in an AArch64 movk, movn or movz instruction
 // for a signed relocation, and update the opcode of a movn or movz instruction
 // to match the sign of the operand.
@@ -448,6 +489,23 @@ void AArch64::relocateOne(uint8_t *loc, RelType type, uint64_t val) const {
   }
 }
 
+void AArch64::relocateAlloc(InputSectionBase &sec, uint8_t *buf,
+                            uint8_t *bufEnd) const {
+  // Most relocations are calls and absolute pointers, which are handled
+  // before the switch in relocateOne().
+  sec.relocateAllocWith(
+      buf, bufEnd, [&](uint8_t *loc, RelType type, uint64_t val) {
+        if (type == R_AARCH64_CALL26) {
+          checkInt(loc, val, 28, type);
+          or32le(loc, (val & 0x0FFFFFFC) >> 2);
+        } else if (type == R_AARCH64_ABS64) {
+          write64le(loc, val);
+        } else {
+          AArch64::relocateOne(loc, type, val);
+        }
+      });
+}
+
 void AArch64::relaxTlsGdToLe(uint8_t *loc, RelType type, uint64_t val) const {
   // TLSDESC Global-Dynamic relocation are in the form:
   //   adrp    x0, :tlsdesc:v             [R_AARCH64_TLSDESC_ADR_PAGE21]
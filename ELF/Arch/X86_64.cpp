@@ -36,6 +36,8 @@ public:
   void writePlt(uint8_t *buf, uint64_t gotPltEntryAddr, uint64_t pltEntryAddr,
                 int32_t index, unsigned relOff) const override;
   void relocateOne(uint8_t *loc, RelType type, uint64_t val) const override;
+  void relocateAlloc(InputSectionBase &sec, uint8_t *buf,
+                     uint8_t *bufEnd) const override;
 
   RelExpr adjustRelaxExpr(RelType type, const uint8_t *data,
                           RelExpr expr) const override;
@@ -46,6 +48,11 @@ public:
   void relaxTlsLdToLe(uint8_t *loc, RelType type, uint64_t val) const override;
   bool adjustPrologueForCrossSplitStack(uint8_t *loc, uint8_t *end,
                                         uint8_t stOther) const override;
+  bool deleteFallThruJmpInsn(InputSection &is,
+                             InputSection *nextIS) const override;
+  bool relaxJmpInsn(InputSection &is) const override;
+  void applyJumpInstrMod(uint8_t *loc, JumpModType type,
+                         unsigned size) const override;
 };
 } // namespace
 
@@ -64,6 +71,16 @@ X86_64::X86_64() {
   pltEntrySize = 16;
   pltHeaderSize = 16;
   trapInstr = {0xcc, 0xcc, 0xcc, 0xcc}; // 0xcc = INT3
+  nopInstrs = {
+      {0x90},
+      {0x66, 0x90},
+      {0x0f, 0x1f, 0x00},
+      {0x0f, 0x1f, 0x40, 0x00},
+      {0x0f, 0x1f, 0x44, 0x00, 0x00},
+      {0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00},
+      {0x0f, 0x1f, 0x80, 0x00, 0x00, 0x00, 0x00},
+      {0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x66, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00}};
 
   // Align to the large page size (known as a superpage or huge page).
   // FreeBSD automatically promotes large, superpage-aligned allocations.
@@ -401,6 +418,203 @@ void X86_64::relocateOne(uint8_t *loc, RelType type, uint64_t val) const {
   }
 }
 
+void X86_64::relocateAlloc(InputSectionBase &sec, uint8_t *buf,
+                           uint8_t *bufEnd) const {
+  // Most relocations are calls, PC-relative references and absolute
+  // pointers, which are handled before the switch in relocateOne().
+  sec.relocateAllocWith(
+      buf, bufEnd, [&](uint8_t *loc, RelType type, uint64_t val) {
+        if (type == R_X86_64_PC32 || type == R_X86_64_PLT32) {
+          checkInt(loc, val, 32, type);
+          write32le(loc, val);
+        } else if (type == R_X86_64_64) {
+          write64le(loc, val);
+        } else {
+          X86_64::relocateOne(loc, type, val);
+        }
+      });
+}
+
+// The jumps that --optimize-bb-jumps rewrites are "jmp rel32" (e9), "jcc
+// rel32" (0f 80+cc), and their short forms "jmp rel8" (eb) and "jcc rel8"
+// (70+cc). A conditional jump is represented by its condition code, which
+// is inverted by flipping the lowest bit.
+static const JumpModType jmpInsn = 16;
+static const JumpModType unknownJmpInsn = 17;
+
+// Returns the size of the opcode of a jump with a displacement of the given
+// size.
+static unsigned getJmpOpcodeSize(JumpModType type, unsigned dispSize) {
+  return (type == jmpInsn || dispSize == 1) ? 1 : 2;
+}
+
+// Returns the relocation of the direct jump whose displacement of the given
+// size ends at the end of is, or nullptr.
+static Relocation *getTailJmpReloc(InputSection &is, unsigned dispSize,
+                                   uint64_t end) {
+  if (end < dispSize)
+    return nullptr;
+  uint64_t off = end - dispSize;
+  // Compilers emit relocations sorted by offset, so the search stops at the
+  // first relocation before the displacement.
+  for (Relocation &rel : llvm::reverse(is.relocations)) {
+    if (rel.offset < off)
+      break;
+    if (rel.offset != off || (rel.expr != R_PC && rel.expr != R_PLT_PC))
+      continue;
+    if (dispSize == 1) {
+      if (rel.type == R_X86_64_PC8)
+        return &rel;
+    } else if (rel.type == R_X86_64_PC32 || rel.type == R_X86_64_PLT32) {
+      return &rel;
+    }
+  }
+  return nullptr;
+}
+
+// Returns the type of the jump whose displacement of the given size is at
+// off, and sets opOff to the offset of its opcode. Jumps that were already
+// rewritten are looked up in jumpInstrMods.
+static JumpModType getJmpInsnType(const InputSection &is, uint64_t off,
+                                  unsigned dispSize, uint64_t &opOff) {
+  for (const JumpInstrMod &mod : is.jumpInstrMods) {
+    if (mod.size == dispSize &&
+        mod.offset + getJmpOpcodeSize(mod.type, mod.size) == off) {
+      opOff = mod.offset;
+      return mod.type;
+    }
+  }
+  if (dispSize != 4)
+    return unknownJmpInsn;
+
+  ArrayRef<uint8_t> data = is.data();
+  if (off >= 1 && data[off - 1] == 0xe9) {
+    opOff = off - 1;
+    return jmpInsn;
+  }
+  if (off >= 2 && data[off - 2] == 0x0f && (data[off - 1] & 0xf0) == 0x80) {
+    opOff = off - 2;
+    return data[off - 1] & 0xf;
+  }
+  return unknownJmpInsn;
+}
+
+// Returns the address that the jump with a relocation rel jumps to.
+static uint64_t getJmpTarget(const InputSection &is, const Relocation &rel,
+                             unsigned dispSize) {
+  uint64_t p = is.getVA(rel.offset);
+  uint64_t val = getRelocTargetVA(is.file, rel.type, rel.addend, p, *rel.sym,
+                                  rel.expr);
+  return p + dispSize + val;
+}
+
+bool X86_64::deleteFallThruJmpInsn(InputSection &is,
+                                   InputSection *nextIS) const {
+  if (!nextIS)
+    return false;
+
+  // The section has to end with "jmp rel32".
+  uint64_t size = is.getSize();
+  Relocation *rel = getTailJmpReloc(is, 4, size);
+  uint64_t opOff;
+  if (!rel || getJmpInsnType(is, rel->offset, 4, opOff) != jmpInsn)
+    return false;
+
+  // If it jumps to the next section, it can be deleted.
+  uint64_t next = nextIS->getVA();
+  if (getJmpTarget(is, *rel, 4) == next) {
+    is.relocations.erase(is.relocations.begin() + (rel - &is.relocations[0]));
+    is.bytesDropped += 5;
+    is.nopFiller = true;
+    return true;
+  }
+
+  // If it is preceded by a "jcc rel32" to the next section, the condition of
+  // the jcc can be inverted to jump to the target of the jmp instead, and
+  // then the jmp can be deleted.
+  Relocation *jccRel = getTailJmpReloc(is, 4, size - 5);
+  uint64_t jccOff;
+  if (!jccRel)
+    return false;
+  JumpModType jcc = getJmpInsnType(is, jccRel->offset, 4, jccOff);
+  if (jcc >= jmpInsn || getJmpTarget(is, *jccRel, 4) != next)
+    return false;
+
+  is.jumpInstrMods.push_back({jccOff, jcc ^ 1, 4});
+  *jccRel = {rel->expr, rel->type, jccRel->offset, rel->addend, rel->sym};
+  is.relocations.erase(is.relocations.begin() + (rel - &is.relocations[0]));
+  is.bytesDropped += 5;
+  is.nopFiller = true;
+  return true;
+}
+
+bool X86_64::relaxJmpInsn(InputSection &is) const {
+  uint64_t size = is.getSize();
+  uint64_t opOff;
+
+  // If the jump at the end was shrunk, check that its target is still in
+  // range, and grow it back otherwise. The displacement is relative to the
+  // end of the instruction, so the addend changes by the difference of the
+  // sizes of the displacements.
+  if (Relocation *rel = getTailJmpReloc(is, 1, size)) {
+    JumpModType type = getJmpInsnType(is, rel->offset, 1, opOff);
+    if (type == unknownJmpInsn)
+      return false;
+    if (isInt<8>(getJmpTarget(is, *rel, 1) - (is.getVA(rel->offset) + 1)))
+      return false;
+    for (JumpInstrMod &mod : is.jumpInstrMods)
+      if (mod.offset == opOff)
+        mod.size = 4;
+    rel->type = R_X86_64_PC32;
+    rel->offset = opOff + getJmpOpcodeSize(type, 4);
+    rel->addend -= 3;
+    is.bytesDropped -= (type == jmpInsn) ? 3 : 4;
+    is.keepLongJmp = true;
+    return true;
+  }
+
+  if (is.keepLongJmp)
+    return false;
+  Relocation *rel = getTailJmpReloc(is, 4, size);
+  if (!rel)
+    return false;
+  JumpModType type = getJmpInsnType(is, rel->offset, 4, opOff);
+  if (type == unknownJmpInsn)
+    return false;
+
+  // The short form has a 1-byte opcode followed by the displacement.
+  uint64_t target = getJmpTarget(is, *rel, 4);
+  if (!isInt<8>(target - (is.getVA(opOff + 1) + 1)))
+    return false;
+
+  bool found = false;
+  for (JumpInstrMod &mod : is.jumpInstrMods) {
+    if (mod.offset == opOff) {
+      mod.size = 1;
+      found = true;
+    }
+  }
+  if (!found)
+    is.jumpInstrMods.push_back({opOff, type, 1});
+  rel->type = R_X86_64_PC8;
+  rel->offset = opOff + 1;
+  rel->addend += 3;
+  is.bytesDropped += (type == jmpInsn) ? 3 : 4;
+  return true;
+}
+
+void X86_64::applyJumpInstrMod(uint8_t *loc, JumpModType type,
+                               unsigned size) const {
+  if (type == jmpInsn) {
+    *loc = (size == 4) ? 0xe9 : 0xeb;
+  } else if (size == 4) {
+    loc[0] = 0x0f;
+    loc[1] = 0x80 | type;
+  } else {
+    loc[0] = 0x70 | type;
+  }
+}
+
 RelExpr X86_64::adjustRelaxExpr(RelType type, const uint8_t *data,
                                 RelExpr relExpr) const {
   if (type != R_X86_64_GOTPCRELX && type != R_X86_64_REX_GOTPCRELX)
@@ -0,0 +1,169 @@
+//===- ArchiveCache.cpp ---------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --archive-cache-dir.
+//
+// For each archive, the linker walks the archive symbol table, which
+// computes the length of every name, and hashes every name to insert a lazy
+// symbol into the symbol table. Programs that are linked against hundreds of
+// large archives spend a noticeable amount of time doing that in every link,
+// even though the archives rarely change.
+//
+// With --archive-cache-dir, the offset, size and hash of every symbol name of
+// an archive are stored in a file in the cache directory, keyed by the path,
+// the size and the modification time of the archive. Later links map the
+// file and insert the symbols with the precomputed hashes.
+//
+// The lazy symbols are still inserted into the symbol table, because the
+// order in which archive members are fetched, and therefore the output,
+// depends on them being there from the beginning.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ArchiveCache.h"
+#include "Config.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Memory.h"
+#include "lld/Common/Version.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <cstring>
+
+using namespace llvm;
+using namespace llvm::support;
+
+namespace lld {
+namespace elf {
+
+namespace {
+struct Header {
+  char magic[8];
+  ulittle32_t version;
+  ulittle32_t numSymbols;
+  // The hash of the linker version, because the hash function of the keys is
+  // not guaranteed to be the same in all versions.
+  ulittle64_t lldVersion;
+  ulittle64_t archiveSize;
+  ulittle64_t archiveTime;
+  ulittle32_t symbolTableSize;
+  ulittle32_t pathSize;
+};
+} // namespace
+
+static const char magic[8] = {'\x7f', 'L', 'L', 'D', 'A', 'R', 'C', 'C'};
+static const uint32_t version = 1;
+
+// Returns the absolute path of an archive, or an empty string if it cannot
+// be determined.
+static std::string getArchivePath(MemoryBufferRef mb) {
+  SmallString<128> path(mb.getBufferIdentifier());
+  if (sys::fs::make_absolute(path))
+    return "";
+  return path.str();
+}
+
+static std::string getCachePath(StringRef archivePath) {
+  SmallString<128> path(config->archiveCacheDir);
+  sys::path::append(path, "archive-" + utohexstr(xxHash64(archivePath)));
+  return path.str();
+}
+
+// Fills in a header for an archive. Returns false if the archive cannot be
+// cached.
+static bool getHeader(MemoryBufferRef mb, StringRef archivePath,
+                      StringRef symbolTable, uint32_t numSymbols,
+                      Header &hdr) {
+  sys::fs::file_status st;
+  if (archivePath.empty() || sys::fs::status(archivePath, st) ||
+      st.getSize() != mb.getBufferSize())
+    return false;
+
+  memcpy(hdr.magic, magic, sizeof(magic));
+  hdr.version = version;
+  hdr.numSymbols = numSymbols;
+  hdr.lldVersion = xxHash64(getLLDVersion());
+  hdr.archiveSize = mb.getBufferSize();
+  hdr.archiveTime = st.getLastModificationTime().time_since_epoch().count();
+  hdr.symbolTableSize = symbolTable.size();
+  hdr.pathSize = archivePath.size();
+  return true;
+}
+
+Optional<ArrayRef<ArchiveCacheSymbol>>
+readArchiveCache(MemoryBufferRef mb, StringRef symbolTable) {
+  std::string archivePath = getArchivePath(mb);
+  auto mbOrErr = MemoryBuffer::getFile(getCachePath(archivePath), -1, false);
+  if (!mbOrErr)
+    return None;
+  StringRef data = (*mbOrErr)->getBuffer();
+  if (data.size() < sizeof(Header))
+    return None;
+
+  Header hdr;
+  const auto *cached = reinterpret_cast<const Header *>(data.data());
+  if (!getHeader(mb, archivePath, symbolTable, cached->numSymbols, hdr) ||
+      memcmp(&hdr, cached, sizeof(Header)))
+    return None;
+
+  uint64_t size = sizeof(Header) + hdr.pathSize +
+                  uint64_t(hdr.numSymbols) * sizeof(ArchiveCacheSymbol);
+  if (data.size() != size ||
+      data.substr(sizeof(Header), hdr.pathSize) != archivePath)
+    return None;
+
+  ArrayRef<ArchiveCacheSymbol> syms(
+      reinterpret_cast<const ArchiveCacheSymbol *>(data.data() +
+                                                   sizeof(Header) +
+                                                   hdr.pathSize),
+      hdr.numSymbols);
+  for (const ArchiveCacheSymbol &sym : syms)
+    if (uint64_t(sym.nameOffset) + sym.nameSize >= symbolTable.size() ||
+        sym.keySize > sym.nameSize)
+      return None;
+
+  log("using archive symbol cache for " + mb.getBufferIdentifier());
+  make<std::unique_ptr<MemoryBuffer>>(std::move(*mbOrErr));
+  return syms;
+}
+
+void writeArchiveCache(MemoryBufferRef mb, StringRef symbolTable,
+                       ArrayRef<ArchiveCacheSymbol> syms) {
+  std::string archivePath = getArchivePath(mb);
+  Header hdr;
+  if (!getHeader(mb, archivePath, symbolTable, syms.size(), hdr))
+    return;
+
+  auto fail = [&](const Twine &msg) {
+    warn("cannot write archive symbol cache for " +
+         mb.getBufferIdentifier() + ": " + msg);
+  };
+  if (std::error_code ec = sys::fs::create_directories(config->archiveCacheDir))
+    return fail(ec.message());
+
+  // Write to a temporary file and rename it, so that concurrent links never
+  // see a partially written file.
+  Expected<sys::fs::TempFile> temp =
+      sys::fs::TempFile::create(getCachePath(archivePath) + ".tmp%%%%%%");
+  if (!temp)
+    return fail(toString(temp.takeError()));
+  {
+    raw_fd_ostream os(temp->FD, /*shouldClose=*/false);
+    os.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    os << archivePath;
+    os.write(reinterpret_cast<const char *>(syms.data()),
+             syms.size() * sizeof(ArchiveCacheSymbol));
+  }
+  if (Error e = temp->keep(getCachePath(archivePath)))
+    fail(toString(std::move(e)));
+}
+
+} // namespace elf
+} // namespace lld
@@ -0,0 +1,45 @@
+//===- ArchiveCache.h -------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_ARCHIVE_CACHE_H
+#define LLD_ELF_ARCHIVE_CACHE_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace lld {
+namespace elf {
+
+// A symbol of an archive as it is stored in the cache. It refers to the name
+// in the symbol table of the archive, and records the key that
+// SymbolTable::insert() looks the name up by.
+struct ArchiveCacheSymbol {
+  // The offset and the size of the name in the archive symbol table.
+  llvm::support::ulittle32_t nameOffset;
+  llvm::support::ulittle32_t nameSize;
+  // The size of the name without the version, and its hash.
+  llvm::support::ulittle32_t keySize;
+  llvm::support::ulittle32_t keyHash;
+};
+
+// Returns the symbols of an archive if --archive-cache-dir has an entry for
+// it that matches the archive and its symbol table. The symbols are in the
+// order of the archive symbol table.
+Optional<ArrayRef<ArchiveCacheSymbol>>
+readArchiveCache(MemoryBufferRef mb, StringRef symbolTable);
+
+// Adds the symbols of an archive to --archive-cache-dir.
+void writeArchiveCache(MemoryBufferRef mb, StringRef symbolTable,
+                       ArrayRef<ArchiveCacheSymbol> syms);
+
+} // namespace elf
+} // namespace lld
+
+#endif
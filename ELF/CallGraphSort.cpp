@@ -38,6 +38,13 @@
 ///   * If not, then combine the clusters.
 /// * Sort non-empty clusters by density
 ///
+/// --call-graph-profile-sort=ext-tsp uses the Ext-TSP layout from: Improved
+/// Basic Block Reordering, https://arxiv.org/abs/1809.04676
+/// on the same call graph instead. It maximizes the number of calls that are
+/// short forward or backward jumps, or fall-throughs from a caller to a callee
+/// placed right after it, by greedily merging the pair of chains of sections
+/// whose best concatenation gains the most.
+///
 //===----------------------------------------------------------------------===//
 
 #include "CallGraphSort.h"
@@ -177,6 +184,38 @@ static void mergeClusters(std::vector<Cluster> &cs, Cluster &into, int intoIdx,
   from.weight = 0;
 }
 
+// Returns the section order for a list of sections in their layout order,
+// and prints it if --print-symbol-order is given.
+static DenseMap<const InputSectionBase *, int>
+getOrderMap(ArrayRef<const InputSectionBase *> order) {
+  DenseMap<const InputSectionBase *, int> orderMap;
+  int curOrder = 1;
+  for (const InputSectionBase *sec : order)
+    orderMap[sec] = curOrder++;
+
+  if (!config->printSymbolOrder.empty()) {
+    std::error_code ec;
+    raw_fd_ostream os(config->printSymbolOrder, ec, sys::fs::OF_None);
+    if (ec) {
+      error("cannot open " + config->printSymbolOrder + ": " + ec.message());
+      return orderMap;
+    }
+
+    // Print the symbols in the order of their sections.
+    for (const InputSectionBase *sec : order) {
+      // Search all the symbols in the file of the section
+      // and find out a Defined symbol with name that is within the section.
+      for (Symbol *sym : sec->file->getSymbols())
+        if (!sym->isSection()) // Filter out section-type symbols here.
+          if (auto *d = dyn_cast<Defined>(sym))
+            if (sec == d->section)
+              os << sym->getName() << "\n";
+    }
+  }
+
+  return orderMap;
+}
+
 // Group InputSections into clusters using the Call-Chain Clustering heuristic
 // then sort the clusters by density.
 DenseMap<const InputSectionBase *, int> CallGraphSort::run() {
@@ -222,42 +261,297 @@ DenseMap<const InputSectionBase *, int> CallGraphSort::run() {
     return clusters[a].getDensity() > clusters[b].getDensity();
   });
 
-  DenseMap<const InputSectionBase *, int> orderMap;
-  int curOrder = 1;
+  std::vector<const InputSectionBase *> order;
   for (int leader : sorted)
     for (int i = leader;;) {
-      orderMap[sections[i]] = curOrder++;
+      order.push_back(sections[i]);
       i = clusters[i].next;
       if (i == leader)
         break;
     }
+  return getOrderMap(order);
+}
 
-  if (!config->printSymbolOrder.empty()) {
-    std::error_code ec;
-    raw_fd_ostream os(config->printSymbolOrder, ec, sys::fs::OF_None);
-    if (ec) {
-      error("cannot open " + config->printSymbolOrder + ": " + ec.message());
-      return orderMap;
+namespace {
+struct TspEdge {
+  int from;
+  int to;
+  uint64_t weight;
+};
+
+// A sequence of input sections that are laid out together.
+struct Chain {
+  std::vector<int> nodes;
+  uint64_t size = 0;
+  uint64_t weight = 0;
+  // The Ext-TSP score of the edges within this chain.
+  double score = 0;
+  std::vector<int> innerEdges;
+  // The edges to each adjacent chain.
+  MapVector<int, std::vector<int>> adjacent;
+};
+
+// How two chains X and Y are concatenated. X1 and X2 are the parts of X
+// before and after the split point.
+enum class MergeType { X_Y, X1_Y_X2, Y_X2_X1, X2_X1_Y };
+
+struct MergeResult {
+  double gain = -1;
+  bool swapped = false;
+  size_t split = 0;
+  MergeType type = MergeType::X_Y;
+};
+
+class ExtTspSort {
+public:
+  ExtTspSort();
+
+  DenseMap<const InputSectionBase *, int> run();
+
+private:
+  double getEdgeScore(const TspEdge &e) const;
+  std::vector<int> concat(int x, int y, const MergeResult &m) const;
+  MergeResult computeMerge(int a, int b);
+  void mergeChains(int a, int b, const MergeResult &m);
+
+  std::vector<const InputSectionBase *> sections;
+  std::vector<uint64_t> sizes;
+  std::vector<uint64_t> weights;
+  std::vector<TspEdge> edges;
+  std::vector<Chain> chains;
+
+  // Scratch space for the addresses of the nodes of a merge candidate.
+  std::vector<uint64_t> addrs;
+};
+
+// The weights and distances of the Ext-TSP objective, from "Improved Basic
+// Block Reordering" by Newell and Pupyrev. A call counts as a jump from the
+// end of the caller to the start of the callee, so placing a callee right
+// after its caller is a fall-through.
+constexpr double FALLTHROUGH_WEIGHT = 1.0;
+constexpr double FORWARD_WEIGHT = 0.1;
+constexpr double BACKWARD_WEIGHT = 0.1;
+constexpr uint64_t FORWARD_DISTANCE = 1024;
+constexpr uint64_t BACKWARD_DISTANCE = 640;
+
+// Chains with more sections than this are not split when they are merged,
+// which bounds the running time.
+constexpr size_t CHAIN_SPLIT_THRESHOLD = 128;
+} // end anonymous namespace
+
+// Builds the same graph as CallGraphSort, without clustering.
+ExtTspSort::ExtTspSort() {
+  MapVector<SectionPair, uint64_t> &profile = config->callGraphProfile;
+  DenseMap<const InputSectionBase *, int> secToNode;
+
+  auto getOrCreateNode = [&](const InputSectionBase *isec) -> int {
+    auto res = secToNode.try_emplace(isec, sections.size());
+    if (res.second) {
+      sections.push_back(isec);
+      sizes.push_back(isec->getSize());
+      weights.push_back(0);
     }
+    return res.first->second;
+  };
 
-    // Print the symbols ordered by C3, in the order of increasing curOrder
-    // Instead of sorting all the orderMap, just repeat the loops above.
-    for (int leader : sorted)
-      for (int i = leader;;) {
-        // Search all the symbols in the file of the section
-        // and find out a Defined symbol with name that is within the section.
-        for (Symbol *sym : sections[i]->file->getSymbols())
-          if (!sym->isSection()) // Filter out section-type symbols here.
-            if (auto *d = dyn_cast<Defined>(sym))
-              if (sections[i] == d->section)
-                os << sym->getName() << "\n";
-        i = clusters[i].next;
-        if (i == leader)
-          break;
+  for (std::pair<SectionPair, uint64_t> &c : profile) {
+    const auto *fromSB = cast<InputSectionBase>(c.first.first->repl);
+    const auto *toSB = cast<InputSectionBase>(c.first.second->repl);
+    uint64_t weight = c.second;
+
+    // See CallGraphSort::CallGraphSort() for why these edges are ignored.
+    if (fromSB->getOutputSection() != toSB->getOutputSection())
+      continue;
+
+    int from = getOrCreateNode(fromSB);
+    int to = getOrCreateNode(toSB);
+    weights[to] += weight;
+    if (from != to)
+      edges.push_back({from, to, weight});
+  }
+
+  chains.resize(sections.size());
+  addrs.resize(sections.size());
+  for (size_t i = 0, e = sections.size(); i != e; ++i) {
+    chains[i].nodes.push_back(i);
+    chains[i].size = sizes[i];
+    chains[i].weight = weights[i];
+  }
+  for (size_t i = 0, e = edges.size(); i != e; ++i) {
+    chains[edges[i].from].adjacent[edges[i].to].push_back(i);
+    chains[edges[i].to].adjacent[edges[i].from].push_back(i);
+  }
+}
+
+double ExtTspSort::getEdgeScore(const TspEdge &e) const {
+  uint64_t src = addrs[e.from] + sizes[e.from];
+  uint64_t dst = addrs[e.to];
+  if (src == dst)
+    return FALLTHROUGH_WEIGHT * e.weight;
+  if (src < dst) {
+    uint64_t dist = dst - src;
+    if (dist >= FORWARD_DISTANCE)
+      return 0;
+    return FORWARD_WEIGHT * e.weight * (1 - double(dist) / FORWARD_DISTANCE);
+  }
+  uint64_t dist = src - dst;
+  if (dist >= BACKWARD_DISTANCE)
+    return 0;
+  return BACKWARD_WEIGHT * e.weight * (1 - double(dist) / BACKWARD_DISTANCE);
+}
+
+std::vector<int> ExtTspSort::concat(int x, int y,
+                                    const MergeResult &m) const {
+  if (m.swapped)
+    std::swap(x, y);
+  ArrayRef<int> xs = chains[x].nodes;
+  ArrayRef<int> ys = chains[y].nodes;
+  ArrayRef<int> x1 = xs.take_front(m.split);
+  ArrayRef<int> x2 = xs.drop_front(m.split);
+
+  std::vector<ArrayRef<int>> parts;
+  switch (m.type) {
+  case MergeType::X_Y:
+    parts = {xs, ys};
+    break;
+  case MergeType::X1_Y_X2:
+    parts = {x1, ys, x2};
+    break;
+  case MergeType::Y_X2_X1:
+    parts = {ys, x2, x1};
+    break;
+  case MergeType::X2_X1_Y:
+    parts = {x2, x1, ys};
+    break;
+  }
+
+  std::vector<int> ret;
+  ret.reserve(xs.size() + ys.size());
+  for (ArrayRef<int> part : parts)
+    ret.insert(ret.end(), part.begin(), part.end());
+  return ret;
+}
+
+// Finds the best way to merge two adjacent chains, trying both orders and,
+// for chains that are not too long, splitting the first one.
+MergeResult ExtTspSort::computeMerge(int a, int b) {
+  ArrayRef<int> lists[] = {chains[a].innerEdges, chains[b].innerEdges,
+                           chains[a].adjacent.find(b)->second};
+  double base = chains[a].score + chains[b].score;
+
+  MergeResult best;
+  auto tryMerge = [&](MergeResult m) {
+    uint64_t addr = 0;
+    for (int node : concat(a, b, m)) {
+      addrs[node] = addr;
+      addr += sizes[node];
+    }
+    double score = 0;
+    for (ArrayRef<int> list : lists)
+      for (int e : list)
+        score += getEdgeScore(edges[e]);
+    m.gain = score - base;
+    if (m.gain > best.gain)
+      best = m;
+  };
+
+  for (bool swapped : {false, true}) {
+    tryMerge({0, swapped, 0, MergeType::X_Y});
+    size_t n = chains[swapped ? b : a].nodes.size();
+    if (n > CHAIN_SPLIT_THRESHOLD)
+      continue;
+    for (size_t split = 1; split < n; ++split)
+      for (MergeType type :
+           {MergeType::X1_Y_X2, MergeType::Y_X2_X1, MergeType::X2_X1_Y})
+        tryMerge({0, swapped, split, type});
+  }
+  return best;
+}
+
+// Merges chain b into chain a.
+void ExtTspSort::mergeChains(int a, int b, const MergeResult &m) {
+  Chain &x = chains[a];
+  Chain &y = chains[b];
+  x.nodes = concat(a, b, m);
+  x.size += y.size;
+  x.weight += y.weight;
+  x.score += y.score + m.gain;
+
+  // The edges between the two chains are now within the chain.
+  std::vector<int> &between = x.adjacent.find(b)->second;
+  x.innerEdges.insert(x.innerEdges.end(), between.begin(), between.end());
+  x.innerEdges.insert(x.innerEdges.end(), y.innerEdges.begin(),
+                      y.innerEdges.end());
+  x.adjacent.erase(x.adjacent.find(b));
+
+  for (std::pair<int, std::vector<int>> &p : y.adjacent) {
+    if (p.first == a)
+      continue;
+    std::vector<int> &v = x.adjacent[p.first];
+    v.insert(v.end(), p.second.begin(), p.second.end());
+
+    Chain &z = chains[p.first];
+    auto it = z.adjacent.find(b);
+    std::vector<int> moved = std::move(it->second);
+    z.adjacent.erase(it);
+    std::vector<int> &w = z.adjacent[a];
+    w.insert(w.end(), moved.begin(), moved.end());
+  }
+  y = Chain();
+}
+
+// Greedily merges the pair of chains with the largest gain in Ext-TSP score
+// until no merge improves it, then sorts the chains by density.
+DenseMap<const InputSectionBase *, int> ExtTspSort::run() {
+  DenseMap<std::pair<int, int>, MergeResult> cache;
+
+  for (;;) {
+    int bestA = -1;
+    int bestB = -1;
+    MergeResult best;
+    for (int a = 0, e = chains.size(); a != e; ++a) {
+      for (std::pair<int, std::vector<int>> &p : chains[a].adjacent) {
+        int b = p.first;
+        if (b < a)
+          continue;
+        auto it = cache.find({a, b});
+        if (it == cache.end())
+          it = cache.insert({{a, b}, computeMerge(a, b)}).first;
+        if (it->second.gain > best.gain) {
+          best = it->second;
+          bestA = a;
+          bestB = b;
+        }
       }
+    }
+    if (bestA == -1 || best.gain <= 0)
+      break;
+
+    // Forget the merges that involve either chain.
+    for (int c : {bestA, bestB})
+      for (std::pair<int, std::vector<int>> &p : chains[c].adjacent)
+        cache.erase({std::min(c, p.first), std::max(c, p.first)});
+    mergeChains(bestA, bestB, best);
   }
 
-  return orderMap;
+  std::vector<int> sorted;
+  for (int i = 0, e = chains.size(); i != e; ++i)
+    if (!chains[i].nodes.empty())
+      sorted.push_back(i);
+  auto getDensity = [&](int i) {
+    if (chains[i].size == 0)
+      return 0.0;
+    return double(chains[i].weight) / double(chains[i].size);
+  };
+  llvm::stable_sort(sorted, [&](int a, int b) {
+    return getDensity(a) > getDensity(b);
+  });
+
+  std::vector<const InputSectionBase *> order;
+  for (int i : sorted)
+    for (int node : chains[i].nodes)
+      order.push_back(sections[node]);
+  return getOrderMap(order);
 }
 
 // Sort sections by the profile data provided by -callgraph-profile-file
@@ -266,6 +560,8 @@ DenseMap<const InputSectionBase *, int> CallGraphSort::run() {
 // according to the C³ huristic. All clusters are then sorted by a density
 // metric to further improve locality.
 DenseMap<const InputSectionBase *, int> computeCallGraphProfileOrder() {
+  if (config->callGraphProfileSortKind == CGProfileSortKind::ExtTsp)
+    return ExtTspSort().run();
   return CallGraphSort().run();
 }
 
@@ -10,6 +10,7 @@
 #define LLD_ELF_CONFIG_H
 
 #include "lld/Common/ErrorHandler.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
@@ -25,6 +26,7 @@ namespace elf {
 
 class InputFile;
 class InputSectionBase;
+class Symbol;
 
 enum ELFKind {
   ELFNoneKind,
@@ -37,11 +39,17 @@ enum ELFKind {
 // For --build-id.
 enum class BuildIdKind { None, Fast, Md5, Sha1, Hexstring, Uuid };
 
+// For --call-graph-profile-sort=.
+enum class CGProfileSortKind { Hfsort, ExtTsp };
+
+// For --compress-debug-sections.
+enum class DebugCompressionKind { None, Zlib, Zstd };
+
 // For --discard-{all,locals,none}.
 enum class DiscardPolicy { Default, All, Locals, None };
 
-// For --icf={none,safe,all}.
-enum class ICFLevel { None, Safe, All };
+// For --icf={none,data,safe,all}.
+enum class ICFLevel { None, Data, Safe, All };
 
 // For --strip-{all,debug}.
 enum class StripPolicy { None, All, Debug };
@@ -52,6 +60,9 @@ enum class UnresolvedPolicy { ReportError, Warn, Ignore };
 // For --orphan-handling.
 enum class OrphanHandlingPolicy { Place, Warn, Error };
 
+// For --prefetch-inputs.
+enum class PrefetchKind { None, WillNeed, Prefault };
+
 // For --sort-section and linkerscript sorting rules.
 enum class SortSectionPolicy { Default, None, Alignment, Name, Priority };
 
@@ -87,13 +98,17 @@ struct Configuration {
   uint32_t andFeatures = 0;
   llvm::CachePruningPolicy thinLTOCachePolicy;
   llvm::StringMap<uint64_t> sectionStartMap;
+  llvm::StringRef archiveCacheDir;
   llvm::StringRef chroot;
+  llvm::StringRef determinismLog;
   llvm::StringRef dynamicLinker;
   llvm::StringRef dwoDir;
   llvm::StringRef entry;
   llvm::StringRef emulation;
   llvm::StringRef fini;
+  llvm::StringRef gdbIndexCacheDir;
   llvm::StringRef init;
+  llvm::StringRef linkCacheDir;
   llvm::StringRef ltoAAPipeline;
   llvm::StringRef ltoCSProfileFile;
   llvm::StringRef ltoNewPmPasses;
@@ -107,9 +122,13 @@ struct Configuration {
   llvm::StringRef progName;
   llvm::StringRef printSymbolOrder;
   llvm::StringRef soName;
+  llvm::StringRef stageOutputDir;
   llvm::StringRef sysroot;
   llvm::StringRef thinLTOCacheDir;
   llvm::StringRef thinLTOIndexOnlyArg;
+  llvm::StringRef timeJsonFile;
+  llvm::StringRef timeTraceFile;
+  llvm::StringRef verifyDeterminism;
   std::pair<llvm::StringRef, llvm::StringRef> thinLTOObjectSuffixReplace;
   std::pair<llvm::StringRef, llvm::StringRef> thinLTOPrefixReplace;
   std::string rpath;
@@ -118,12 +137,17 @@ struct Configuration {
   std::vector<llvm::StringRef> filterList;
   std::vector<llvm::StringRef> searchPaths;
   std::vector<llvm::StringRef> symbolOrderingFile;
+  std::vector<std::pair<llvm::StringRef, uint64_t>> dataOrderingFile;
+  llvm::StringRef symbolOrderingIndex;
   std::vector<llvm::StringRef> undefined;
   std::vector<SymbolVersion> dynamicList;
   std::vector<uint8_t> buildIdVector;
   llvm::MapVector<std::pair<const InputSectionBase *, const InputSectionBase *>,
                   uint64_t>
       callGraphProfile;
+  // The call counts of functions that are not defined in the output, from
+  // the call graph profile, for --sort-plt-entries.
+  llvm::DenseMap<const Symbol *, uint64_t> pltCallCounts;
   bool allowMultipleDefinition;
   bool allowShlibUndefined;
   bool androidPackDynRelocs;
@@ -134,8 +158,11 @@ struct Configuration {
   bool bsymbolic;
   bool bsymbolicFunctions;
   bool callGraphProfileSort;
+  bool dataOrderingProfile;
+  CGProfileSortKind callGraphProfileSortKind;
   bool checkSections;
-  bool compressDebugSections;
+  DebugCompressionKind compressDebugSections;
+  bool copyFileRange;
   bool cref;
   bool defineCommon;
   bool demangle = true;
@@ -152,6 +179,7 @@ struct Configuration {
   bool forceBTI;
   bool formatBinary = false;
   bool requireCET;
+  bool debugNames;
   bool gcSections;
   bool gdbIndex;
   bool gnuHash = false;
@@ -160,6 +188,8 @@ struct Configuration {
   bool hasDynSymTab;
   bool ignoreDataAddressEquality;
   bool ignoreFunctionAddressEquality;
+  bool incremental;
+  bool lazySharedSymbols;
   bool ltoCSProfileGenerate;
   bool ltoDebugPassManager;
   bool ltoNewPassManager;
@@ -170,24 +200,32 @@ struct Configuration {
   bool nostdlib;
   bool oFormatBinary;
   bool omagic;
+  bool optimizeBBJumps;
   bool optRemarksWithHotness;
   bool pacPlt;
   bool picThunk;
   bool pie;
+  bool preloadInputs;
   bool printGcSections;
   bool printIcfSections;
+  bool releaseInputMemory;
   bool relocatable;
   bool relrPackDynRelocs;
   bool saveTemps;
   bool singleRoRx;
   bool shared;
+  bool showTiming;
+  bool sortPltEntries;
+  bool stageOutput;
   bool isStatic = false;
   bool sysvHash = false;
   bool target1Rel;
   bool trace;
   bool thinLTOEmitImportsFiles;
   bool thinLTOIndexOnly;
+  bool timeTraceEnabled;
   bool tocOptimize;
+  bool tuneGnuHash;
   bool undefinedVersion;
   bool useAndroidRelrTags = false;
   bool warnBackrefs;
@@ -201,6 +239,7 @@ struct Configuration {
   bool zExecstack;
   bool zGlobal;
   bool zHazardplt;
+  bool zHugepageHotText;
   bool zIfuncNoplt;
   bool zInitfirst;
   bool zInterpose;
@@ -218,6 +257,7 @@ struct Configuration {
   DiscardPolicy discard;
   ICFLevel icf;
   OrphanHandlingPolicy orphanHandling;
+  PrefetchKind prefetchInputs;
   SortSectionPolicy sortSection;
   StripPolicy strip;
   UnresolvedPolicy unresolvedSymbols;
@@ -230,12 +270,14 @@ struct Configuration {
   llvm::Optional<uint64_t> imageBase;
   uint64_t commonPageSize;
   uint64_t maxPageSize;
+  uint64_t memoryBudget;
   uint64_t mipsGotSize;
   uint64_t zStackSize;
   unsigned ltoPartitions;
   unsigned ltoo;
   unsigned optimize;
   unsigned thinLTOJobs;
+  unsigned timeTraceGranularity;
   int32_t splitStackAdjustSize;
 
   // The following config options do not directly correspond to any
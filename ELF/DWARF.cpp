@@ -17,6 +17,7 @@
 #include "Symbols.h"
 #include "Target.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
 #include "llvm/DebugInfo/DWARF/DWARFDebugPubTable.h"
 #include "llvm/Object/ELFObjectFile.h"
 
@@ -40,6 +41,7 @@ template <class ELFT> LLDDwarfObj<ELFT>::LLDDwarfObj(ObjFile<ELFT> *obj) {
                 .Case(".debug_rnglists", &rnglistsSection)
                 .Case(".debug_str_offsets", &strOffsetsSection)
                 .Case(".debug_line", &lineSection)
+                .Case(".debug_names", &namesSection)
                 .Default(nullptr)) {
       m->Data = toStringRef(sec->data());
       m->sec = sec;
@@ -48,8 +50,10 @@ template <class ELFT> LLDDwarfObj<ELFT>::LLDDwarfObj(ObjFile<ELFT> *obj) {
 
     if (sec->name == ".debug_abbrev")
       abbrevSection = toStringRef(sec->data());
-    else if (sec->name == ".debug_str")
+    else if (sec->name == ".debug_str") {
       strSection = toStringRef(sec->data());
+      strInputSection = sec;
+    }
     else if (sec->name == ".debug_line_str")
       lineStrSection = toStringRef(sec->data());
   }
@@ -124,6 +128,26 @@ Optional<RelocAddrEntry> LLDDwarfObj<ELFT>::find(const llvm::DWARFSection &s,
   return findAux(*sec.sec, pos, sec.sec->template rels<ELFT>());
 }
 
+void uncompressDwarfSections(ArrayRef<InputFile *> files) {
+  std::vector<InputSectionBase *> sections;
+  for (InputFile *file : files) {
+    for (InputSectionBase *sec : file->getSections()) {
+      if (!sec || sec == &InputSection::discarded || !sec->isCompressed())
+        continue;
+      if (StringSwitch<bool>(sec->name)
+              .Cases(".debug_addr", ".debug_gnu_pubnames",
+                     ".debug_gnu_pubtypes", ".debug_info", ".debug_ranges",
+                     true)
+              .Cases(".debug_rnglists", ".debug_str_offsets", ".debug_line",
+                     ".debug_names", ".debug_abbrev", true)
+              .Cases(".debug_str", ".debug_line_str", true)
+              .Default(false))
+        sections.push_back(sec);
+    }
+  }
+  parallelForEach(sections, [](InputSectionBase *sec) { sec->data(); });
+}
+
 template class LLDDwarfObj<ELF32LE>;
 template class LLDDwarfObj<ELF32BE>;
 template class LLDDwarfObj<ELF64LE>;
@@ -60,6 +60,13 @@ public:
     return gnuPubtypesSection;
   }
 
+  const llvm::DWARFSection &getNamesSection() const override {
+    return namesSection;
+  }
+
+  const LLDDWARFSection &getInfoSection() const { return infoSection; }
+  InputSectionBase *getStrInputSection() const { return strInputSection; }
+
   StringRef getFileName() const override { return ""; }
   StringRef getAbbrevSection() const override { return abbrevSection; }
   StringRef getStrSection() const override { return strSection; }
@@ -86,11 +93,18 @@ private:
   LLDDWARFSection strOffsetsSection;
   LLDDWARFSection lineSection;
   LLDDWARFSection addrSection;
+  LLDDWARFSection namesSection;
+  InputSectionBase *strInputSection = nullptr;
   StringRef abbrevSection;
   StringRef strSection;
   StringRef lineStrSection;
 };
 
+// Uncompresses the compressed sections of files that LLDDwarfObj reads. The
+// sections are uncompressed in parallel, which balances the work better than
+// uncompressing them on the threads that read each file.
+void uncompressDwarfSections(ArrayRef<InputFile *> files);
+
 } // namespace elf
 } // namespace lld
 
@@ -0,0 +1,180 @@
+//===- Determinism.cpp ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --determinism-log and --verify-determinism, which
+// check that the parallel parts of the linker produce the same output with
+// any number of threads.
+//
+// A link with --determinism-log writes a record of its output. The record
+// holds the decisions that the layout depends on first: the order of the
+// symbol tables and the GOT and PLT slots of the symbols. Then it holds a
+// hash of the contents of each output section, in file order. A link with
+// --verify-determinism compares its own record with one written by a
+// reference link, typically run with --threads=1, and reports the first
+// record that differs. Because the decisions come first, a different symbol
+// order is reported rather than the sections that it changes.
+//
+// The build ID section is not hashed, since it is a hash of everything else
+// and would differ whenever any other section does.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Determinism.h"
+#include "Config.h"
+#include "InputFiles.h"
+#include "OutputSections.h"
+#include "SymbolTable.h"
+#include "Symbols.h"
+#include "SyntheticSections.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+using namespace llvm::ELF;
+using namespace lld;
+using namespace lld::elf;
+
+static std::string hashRange(ArrayRef<uint8_t> buf, uint64_t off,
+                             uint64_t size) {
+  if (off > buf.size() || size > buf.size() - off)
+    return "out-of-range";
+  return utohexstr(xxHash64(toStringRef(buf.slice(off, size))));
+}
+
+static void addSymbolRecords(std::vector<std::string> &records) {
+  if (in.symTab)
+    for (size_t i = 0, e = in.symTab->getSymbols().size(); i != e; ++i)
+      records.push_back(("symtab " + Twine(i + 1) + " " +
+                         in.symTab->getSymbols()[i].sym->getName())
+                            .str());
+
+  for (size_t p = 0, e = partitions.size(); p != e; ++p)
+    if (SymbolTableBaseSection *dynSymTab = partitions[p].dynSymTab)
+      for (size_t i = 0, e = dynSymTab->getSymbols().size(); i != e; ++i)
+        records.push_back(("dynsym " + Twine(p) + ":" + Twine(i + 1) + " " +
+                           dynSymTab->getSymbols()[i].sym->getName())
+                              .str());
+
+  // The GOT and PLT slots, by slot.
+  std::vector<std::pair<uint32_t, Symbol *>> got, plt;
+  auto addSym = [&](Symbol *sym) {
+    if (sym->isInGot())
+      got.push_back({sym->aux().gotIndex, sym});
+    if (sym->isInPlt())
+      plt.push_back({sym->aux().pltIndex, sym});
+  };
+  symtab->forEachSymbol(addSym);
+  for (InputFile *file : objectFiles)
+    for (Symbol *sym : file->getSymbols())
+      if (sym->isLocal())
+        addSym(sym);
+
+  auto less = [](const std::pair<uint32_t, Symbol *> &a,
+                 const std::pair<uint32_t, Symbol *> &b) {
+    return a.first < b.first;
+  };
+  llvm::stable_sort(got, less);
+  llvm::stable_sort(plt, less);
+  for (std::pair<uint32_t, Symbol *> &p : got)
+    records.push_back(
+        ("got " + Twine(p.first) + " " + p.second->getName()).str());
+  for (std::pair<uint32_t, Symbol *> &p : plt)
+    records.push_back(
+        ("plt " + Twine(p.first) + " " + p.second->getName()).str());
+}
+
+static void addSectionRecords(std::vector<std::string> &records,
+                              ArrayRef<uint8_t> buf) {
+  if (config->oFormatBinary) {
+    records.push_back("output " + hashRange(buf, 0, buf.size()));
+    return;
+  }
+
+  if (Out::programHeaders)
+    records.push_back(
+        "headers " +
+        hashRange(buf, 0,
+                  Out::programHeaders->offset + Out::programHeaders->size));
+
+  std::vector<OutputSection *> sections;
+  for (OutputSection *sec : outputSections)
+    if (sec->type != SHT_NOBITS && sec->size)
+      sections.push_back(sec);
+  llvm::stable_sort(sections, [](OutputSection *a, OutputSection *b) {
+    return a->offset < b->offset;
+  });
+
+  auto isBuildId = [](OutputSection *sec) {
+    for (Partition &part : partitions)
+      if (part.buildId && part.buildId->getParent() == sec)
+        return true;
+    return false;
+  };
+
+  std::vector<std::string> hashes(sections.size());
+  parallelForEachN(0, sections.size(), [&](size_t i) {
+    if (!isBuildId(sections[i]))
+      hashes[i] = hashRange(buf, sections[i]->offset, sections[i]->size);
+  });
+  for (size_t i = 0, e = sections.size(); i != e; ++i)
+    if (!hashes[i].empty())
+      records.push_back("section " + sections[i]->name.str() + " " +
+                        hashes[i]);
+}
+
+static void writeRecords(StringRef path, ArrayRef<std::string> records) {
+  std::error_code ec;
+  raw_fd_ostream os(path, ec, sys::fs::OF_None);
+  if (ec) {
+    error("cannot open " + path + ": " + ec.message());
+    return;
+  }
+  for (const std::string &r : records)
+    os << r << "\n";
+}
+
+static void verifyRecords(StringRef path, ArrayRef<std::string> records) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr = MemoryBuffer::getFile(path);
+  if (std::error_code ec = mbOrErr.getError()) {
+    error("cannot open " + path + ": " + ec.message());
+    return;
+  }
+
+  SmallVector<StringRef, 0> ref;
+  (*mbOrErr)->getBuffer().split(ref, '\n', -1, false);
+
+  for (size_t i = 0, e = std::min(ref.size(), records.size()); i != e; ++i) {
+    if (ref[i] == records[i])
+      continue;
+    error("--verify-determinism: output differs from the reference link at "
+          "record " + Twine(i + 1) + " of " + path +
+          "\n>>> reference: " + ref[i] + "\n>>> this link: " + records[i]);
+    return;
+  }
+
+  if (ref.size() != records.size())
+    error("--verify-determinism: the reference link in " + path + " has " +
+          Twine(ref.size()) + " records, but this link has " +
+          Twine(records.size()) + "; the first extra record is: " +
+          (ref.size() < records.size() ? records[ref.size()]
+                                       : ref[records.size()].str()));
+}
+
+void elf::checkDeterminism(ArrayRef<uint8_t> buf) {
+  std::vector<std::string> records;
+  addSymbolRecords(records);
+  addSectionRecords(records, buf);
+
+  if (!config->determinismLog.empty())
+    writeRecords(config->determinismLog, records);
+  if (!config->verifyDeterminism.empty())
+    verifyRecords(config->verifyDeterminism, records);
+}
@@ -0,0 +1,23 @@
+//===- Determinism.h --------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_DETERMINISM_H
+#define LLD_ELF_DETERMINISM_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+
+namespace lld {
+namespace elf {
+// Handles --determinism-log and --verify-determinism for the output in buf,
+// which must be completely written.
+void checkDeterminism(ArrayRef<uint8_t> buf);
+} // namespace elf
+} // namespace lld
+
+#endif
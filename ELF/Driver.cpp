@@ -25,12 +25,18 @@
 #include "Driver.h"
 #include "Config.h"
 #include "ICF.h"
+#include "Incremental.h"
 #include "InputFiles.h"
 #include "InputSection.h"
+#include "LinkCache.h"
 #include "LinkerScript.h"
 #include "MarkLive.h"
 #include "OutputSections.h"
+#include "PassThrough.h"
+#include "Prefetch.h"
+#include "ReleaseMemory.h"
 #include "ScriptParser.h"
+#include "SymbolOrder.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "SyntheticSections.h"
@@ -40,10 +46,14 @@
 #include "lld/Common/Driver.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Filesystem.h"
+#include "lld/Common/InputCache.h"
+#include "lld/Common/InputLoader.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/PerfCounters.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/TargetOptionsCommandFlags.h"
 #include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
 #include "lld/Common/Version.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/StringExtras.h"
@@ -54,8 +64,8 @@
 #include "llvm/Support/GlobPattern.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/Path.h"
-#include "llvm/Support/TarWriter.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdlib>
 #include <utility>
@@ -75,6 +85,12 @@ LinkerDriver *driver;
 static void setConfigs(opt::InputArgList &args);
 static void readConfigs(opt::InputArgList &args);
 
+static Timer inputFileTimer("Input File Reading", Timer::root());
+static Timer symbolResolutionTimer("Symbol Resolution", Timer::root());
+static Timer ltoTimer("LTO", Timer::root());
+static Timer splitSectionsTimer("Split Sections", Timer::root());
+static Timer scriptTimer("Assign Sections", Timer::root());
+
 bool link(ArrayRef<const char *> args, bool canExitEarly, raw_ostream &error) {
   errorHandler().logName = args::getFilenameWithoutExe(args[0]);
   errorHandler().errorLimitExceededMsg =
@@ -90,6 +106,12 @@ bool link(ArrayRef<const char *> args, bool canExitEarly, raw_ostream &error) {
   bitcodeFiles.clear();
   objectFiles.clear();
   sharedFiles.clear();
+  incrementalInputs.clear();
+  linkCacheInputs.clear();
+  passThroughInputs.clear();
+  prefetchedInputs.clear();
+  mappedInputs.clear();
+  symAux.clear();
 
   config = make<Configuration>();
   driver = make<LinkerDriver>();
@@ -97,6 +119,7 @@ bool link(ArrayRef<const char *> args, bool canExitEarly, raw_ostream &error) {
   symtab = make<SymbolTable>();
 
   tar = nullptr;
+  errorHandler().cleanupCallback = [] { tar = nullptr; };
   memset(&in, 0, sizeof(in));
 
   partitions = {Partition()};
@@ -107,6 +130,33 @@ bool link(ArrayRef<const char *> args, bool canExitEarly, raw_ostream &error) {
 
   driver->main(args);
 
+  // Finish the --reproduce tar file, so that it is complete when we return.
+  tar = nullptr;
+
+  if (uint64_t n = getMemoryThrottleCount())
+    message("--memory-budget: held back parallel work " + Twine(n) +
+            " times to stay within " + Twine(config->memoryBudget) + " bytes");
+
+  if (config->showTiming)
+    Timer::root().print();
+  if (!config->timeJsonFile.empty())
+    writeTimersJSON(config->timeJsonFile);
+  if (arenaUsageEnabled)
+    printArenaUsage();
+
+  if (config->timeTraceEnabled) {
+    std::string path = config->timeTraceFile.empty()
+                           ? (config->outputFile + ".time-trace").str()
+                           : config->timeTraceFile.str();
+    std::error_code ec;
+    raw_fd_ostream os(path, ec, sys::fs::OF_Text);
+    if (ec)
+      error("cannot open " + path + ": " + ec.message());
+    else
+      timeTraceProfilerWrite(os);
+    timeTraceProfilerCleanup();
+  }
+
   // Exit immediately if we don't need to return to the caller.
   // This saves time because the overhead of calling destructors
   // for all globally-allocated objects is not negligible.
@@ -179,8 +229,11 @@ std::vector<std::pair<MemoryBufferRef, uint64_t>> static getArchiveMembers(
           toString(std::move(err)));
 
   // Take ownership of memory buffers created for members of thin archives.
-  for (std::unique_ptr<MemoryBuffer> &mb : file->takeThinBuffers())
+  for (std::unique_ptr<MemoryBuffer> &mb : file->takeThinBuffers()) {
+    prefetchInput(mb->getMemBufferRef());
+    addMappedInput(*mb);
     make<std::unique_ptr<MemoryBuffer>>(std::move(mb));
+  }
 
   return v;
 }
@@ -305,6 +358,14 @@ static void checkOptions() {
   if (config->tocOptimize && config->emachine != EM_PPC64)
     error("--toc-optimize is only supported on the PowerPC64 target");
 
+  if (config->optimizeBBJumps && config->emachine != EM_X86_64)
+    error("--optimize-bb-jumps is only supported on x86-64 targets");
+
+  if (config->sortPltEntries &&
+      (config->emachine == EM_MIPS || config->emachine == EM_PPC ||
+       config->emachine == EM_PPC64))
+    error("--sort-plt-entries is not supported on MIPS and PowerPC targets");
+
   if (config->pie && config->shared)
     error("-shared and -pie may not be used together");
 
@@ -330,12 +391,16 @@ static void checkOptions() {
       error("-r and --gc-sections may not be used together");
     if (config->gdbIndex)
       error("-r and --gdb-index may not be used together");
+    if (config->debugNames)
+      error("-r and --debug-names may not be used together");
     if (config->icf != ICFLevel::None)
       error("-r and --icf may not be used together");
     if (config->pie)
       error("-r and -pie may not be used together");
     if (config->exportDynamic)
       error("-r and --export-dynamic may not be used together");
+    if (config->optimizeBBJumps)
+      error("-r and --optimize-bb-jumps may not be used together");
   }
 
   if (config->executeOnly) {
@@ -397,7 +462,8 @@ static SeparateSegmentKind getZSeparate(opt::InputArgList &args) {
 static bool isKnownZFlag(StringRef s) {
   return s == "combreloc" || s == "copyreloc" || s == "defs" ||
          s == "execstack" || s == "global" || s == "hazardplt" ||
-         s == "ifunc-noplt" || s == "initfirst" || s == "interpose" ||
+         s == "hugepage-hot-text" || s == "ifunc-noplt" || s == "initfirst" ||
+         s == "interpose" ||
          s == "keep-text-section-prefix" || s == "lazy" || s == "muldefs" ||
          s == "separate-code" || s == "separate-loadable-segments" ||
          s == "nocombreloc" || s == "nocopyreloc" || s == "nodefaultlib" ||
@@ -452,8 +518,8 @@ void LinkerDriver::main(ArrayRef<const char *> argsArr) {
   if (const char *path = getReproduceOption(args)) {
     // Note that --reproduce is a debug option so you can ignore it
     // if you are trying to understand the whole picture of the code.
-    Expected<std::unique_ptr<TarWriter>> errOrWriter =
-        TarWriter::create(path, path::stem(path));
+    Expected<std::unique_ptr<AsyncTarWriter>> errOrWriter =
+        AsyncTarWriter::create(path, path::stem(path));
     if (errOrWriter) {
       tar = std::move(*errOrWriter);
       tar->append("response.txt", createResponseFile(args));
@@ -472,8 +538,16 @@ void LinkerDriver::main(ArrayRef<const char *> argsArr) {
   if (args.hasArg(OPT_version))
     return;
 
+  if (config->timeTraceEnabled)
+    timeTraceProfilerInitialize(config->timeTraceGranularity, config->progName);
+  ScopedTimer t(Timer::root());
+
   initLLVM();
-  createFiles(args);
+  {
+    ScopedTimer t(inputFileTimer);
+    createFiles(args);
+  }
+  prefaultInputs();
   if (errorCount())
     return;
 
@@ -593,9 +667,12 @@ static StringRef getDynamicLinker(opt::InputArgList &args) {
 }
 
 static ICFLevel getICF(opt::InputArgList &args) {
-  auto *arg = args.getLastArg(OPT_icf_none, OPT_icf_safe, OPT_icf_all);
+  auto *arg = args.getLastArg(OPT_icf_none, OPT_icf_data, OPT_icf_safe,
+                              OPT_icf_all);
   if (!arg || arg->getOption().getID() == OPT_icf_none)
     return ICFLevel::None;
+  if (arg->getOption().getID() == OPT_icf_data)
+    return ICFLevel::Data;
   if (arg->getOption().getID() == OPT_icf_safe)
     return ICFLevel::Safe;
   return ICFLevel::All;
@@ -641,6 +718,62 @@ static StringMap<uint64_t> getSectionStartMap(opt::InputArgList &args) {
   return ret;
 }
 
+static CGProfileSortKind getCGProfileSortKind(opt::InputArgList &args) {
+  StringRef s = args.getLastArgValue(OPT_call_graph_profile_sort_eq, "hfsort");
+  if (s == "ext-tsp")
+    return CGProfileSortKind::ExtTsp;
+  if (s != "hfsort")
+    error("unknown --call-graph-profile-sort= value: " + s);
+  return CGProfileSortKind::Hfsort;
+}
+
+// Parses --memory-budget, or LLD_MEMORY_BUDGET if the option is not given.
+// The size may have a K, M or G suffix.
+static uint64_t parseMemoryBudget(opt::InputArgList &args) {
+  StringRef s;
+  std::string env;
+  if (auto *arg = args.getLastArg(OPT_memory_budget)) {
+    s = arg->getValue();
+  } else if (const char *p = getenv("LLD_MEMORY_BUDGET")) {
+    env = p;
+    s = env;
+  }
+  if (s.empty())
+    return 0;
+
+  unsigned shift = 0;
+  switch (s.back()) {
+  case 'K':
+  case 'k':
+    shift = 10;
+    break;
+  case 'M':
+  case 'm':
+    shift = 20;
+    break;
+  case 'G':
+  case 'g':
+    shift = 30;
+    break;
+  }
+  uint64_t v;
+  if (to_integer(shift ? s.drop_back() : s, v) && v < (UINT64_MAX >> shift))
+    return v << shift;
+  error("invalid memory budget: " + s);
+  return 0;
+}
+
+static PrefetchKind getPrefetchKind(opt::InputArgList &args) {
+  StringRef s = args.getLastArgValue(OPT_prefetch_inputs, "none");
+  if (s == "willneed")
+    return PrefetchKind::WillNeed;
+  if (s == "prefault")
+    return PrefetchKind::Prefault;
+  if (s != "none")
+    error("unknown --prefetch-inputs value: " + s);
+  return PrefetchKind::None;
+}
+
 static SortSectionPolicy getSortSection(opt::InputArgList &args) {
   StringRef s = args.getLastArgValue(OPT_sort_section);
   if (s == "alignment")
@@ -737,6 +870,14 @@ static void readCallGraph(MemoryBufferRef mb) {
       return;
     }
 
+    if (config->sortPltEntries) {
+      Symbol *to = map.lookup(fields[1]);
+      if (to && !to->isDefined())
+        config->pltCallCounts[to] += count;
+    }
+
+    if (!config->callGraphProfileSort)
+      continue;
     if (InputSectionBase *from = findSection(fields[0]))
       if (InputSectionBase *to = findSection(fields[1]))
         config->callGraphProfile[std::make_pair(from, to)] += count;
@@ -748,6 +889,14 @@ template <class ELFT> static void readCallGraphsFromObjectFiles() {
     auto *obj = cast<ObjFile<ELFT>>(file);
 
     for (const Elf_CGProfile_Impl<ELFT> &cgpe : obj->cgProfile) {
+      if (config->sortPltEntries) {
+        Symbol &to = obj->getSymbol(cgpe.cgp_to);
+        if (!to.isDefined())
+          config->pltCallCounts[&to] += cgpe.cgp_weight;
+      }
+      if (!config->callGraphProfileSort)
+        continue;
+
       auto *fromSym = dyn_cast<Defined>(&obj->getSymbol(cgpe.cgp_from));
       auto *toSym = dyn_cast<Defined>(&obj->getSymbol(cgpe.cgp_to));
       if (!fromSym || !toSym)
@@ -761,15 +910,22 @@ template <class ELFT> static void readCallGraphsFromObjectFiles() {
   }
 }
 
-static bool getCompressDebugSections(opt::InputArgList &args) {
+static DebugCompressionKind
+getCompressDebugSections(opt::InputArgList &args) {
   StringRef s = args.getLastArgValue(OPT_compress_debug_sections, "none");
   if (s == "none")
-    return false;
+    return DebugCompressionKind::None;
+  if (s == "zstd") {
+#ifndef LLD_HAS_ZSTD
+    error("--compress-debug-sections: zstd is not available");
+#endif
+    return DebugCompressionKind::Zstd;
+  }
   if (s != "zlib")
     error("unknown --compress-debug-sections value: " + s);
   if (!zlib::isAvailable())
     error("--compress-debug-sections: zlib is not available");
-  return true;
+  return DebugCompressionKind::Zlib;
 }
 
 static StringRef getAliasSpelling(opt::Arg *arg) {
@@ -801,6 +957,35 @@ static std::vector<StringRef> getSymbolOrderingFile(MemoryBufferRef mb) {
   return names.takeVector();
 }
 
+// Parses a --data-ordering-file. The file is either a list of symbols, one
+// per line, in the order they should be placed, or a data access profile
+// whose lines are "<symbol> <count>". Returns true for the latter.
+static bool
+getDataOrderingFile(MemoryBufferRef mb,
+                    std::vector<std::pair<StringRef, uint64_t>> &entries) {
+  std::vector<StringRef> lines = args::getLines(mb);
+  bool isProfile = !lines.empty() && lines[0].contains(' ');
+  DenseSet<StringRef> names;
+  for (StringRef line : lines) {
+    SmallVector<StringRef, 2> fields;
+    line.split(fields, ' ', -1, false);
+    uint64_t count = 0;
+    if (fields.size() != (isProfile ? 2 : 1) ||
+        (isProfile && !to_integer(fields[1], count))) {
+      error(mb.getBufferIdentifier() + ": parse error: " + line);
+      return isProfile;
+    }
+    if (!names.insert(fields[0]).second) {
+      if (config->warnSymbolOrdering)
+        warn(mb.getBufferIdentifier() + ": duplicate ordered symbol: " +
+             fields[0]);
+      continue;
+    }
+    entries.push_back({fields[0], count});
+  }
+  return isProfile;
+}
+
 static void parseClangOption(StringRef opt, const Twine &msg) {
   std::string err;
   raw_string_ostream os(err);
@@ -819,7 +1004,8 @@ static void readConfigs(opt::InputArgList &args) {
       args.hasFlag(OPT_fatal_warnings, OPT_no_fatal_warnings, false);
   errorHandler().vsDiagnostics =
       args.hasArg(OPT_visual_studio_diagnostics_format, false);
-  threadsEnabled = args.hasFlag(OPT_threads, OPT_no_threads, true);
+  args::setThreads(args, OPT_threads, OPT_no_threads, OPT_threads_eq);
+  setNumaAware(args.hasFlag(OPT_numa_threads, OPT_no_numa_threads, false));
 
   config->allowMultipleDefinition =
       args.hasFlag(OPT_allow_multiple_definition,
@@ -828,18 +1014,24 @@ static void readConfigs(opt::InputArgList &args) {
   config->allowShlibUndefined =
       args.hasFlag(OPT_allow_shlib_undefined, OPT_no_allow_shlib_undefined,
                    args.hasArg(OPT_shared));
+  config->archiveCacheDir = args.getLastArgValue(OPT_archive_cache_dir);
   config->auxiliaryList = args::getStrings(args, OPT_auxiliary);
   config->bsymbolic = args.hasArg(OPT_Bsymbolic);
   config->bsymbolicFunctions = args.hasArg(OPT_Bsymbolic_functions);
   config->checkSections =
       args.hasFlag(OPT_check_sections, OPT_no_check_sections, true);
   config->chroot = args.getLastArgValue(OPT_chroot);
+  config->determinismLog = args.getLastArgValue(OPT_determinism_log);
   config->compressDebugSections = getCompressDebugSections(args);
+  config->copyFileRange =
+      args.hasFlag(OPT_copy_file_range, OPT_no_copy_file_range, false);
   config->cref = args.hasFlag(OPT_cref, OPT_no_cref, false);
   config->defineCommon = args.hasFlag(OPT_define_common, OPT_no_define_common,
                                       !args.hasArg(OPT_relocatable));
   config->demangle = args.hasFlag(OPT_demangle, OPT_no_demangle, true);
   config->dependentLibraries = args.hasFlag(OPT_dependent_libraries, OPT_no_dependent_libraries, true);
+  config->debugNames =
+      args.hasFlag(OPT_debug_names, OPT_no_debug_names, false);
   config->disableVerify = args.hasArg(OPT_disable_verify);
   config->discard = getDiscard(args);
   config->dwoDir = args.getLastArgValue(OPT_plugin_opt_dwo_dir_eq);
@@ -850,6 +1042,9 @@ static void readConfigs(opt::InputArgList &args) {
   config->emitRelocs = args.hasArg(OPT_emit_relocs);
   config->callGraphProfileSort = args.hasFlag(
       OPT_call_graph_profile_sort, OPT_no_call_graph_profile_sort, true);
+  config->callGraphProfileSortKind = getCGProfileSortKind(args);
+  config->sortPltEntries =
+      args.hasFlag(OPT_sort_plt_entries, OPT_no_sort_plt_entries, false);
   config->enableNewDtags =
       args.hasFlag(OPT_enable_new_dtags, OPT_disable_new_dtags, true);
   config->entry = args.getLastArgValue(OPT_entry);
@@ -866,12 +1061,17 @@ static void readConfigs(opt::InputArgList &args) {
   config->gcSections = args.hasFlag(OPT_gc_sections, OPT_no_gc_sections, false);
   config->gnuUnique = args.hasFlag(OPT_gnu_unique, OPT_no_gnu_unique, true);
   config->gdbIndex = args.hasFlag(OPT_gdb_index, OPT_no_gdb_index, false);
+  config->gdbIndexCacheDir = args.getLastArgValue(OPT_gdb_index_cache_dir);
   config->icf = getICF(args);
   config->ignoreDataAddressEquality =
       args.hasArg(OPT_ignore_data_address_equality);
   config->ignoreFunctionAddressEquality =
       args.hasArg(OPT_ignore_function_address_equality);
+  config->incremental =
+      args.hasFlag(OPT_incremental, OPT_no_incremental, false);
   config->init = args.getLastArgValue(OPT_init, "_init");
+  config->lazySharedSymbols = args.hasArg(OPT_lazy_shared_symbols);
+  config->linkCacheDir = args.getLastArgValue(OPT_link_cache_dir);
   config->ltoAAPipeline = args.getLastArgValue(OPT_lto_aa_pipeline);
   config->ltoCSProfileGenerate = args.hasArg(OPT_lto_cs_profile_generate);
   config->ltoCSProfileFile = args.getLastArgValue(OPT_lto_cs_profile_file);
@@ -891,6 +1091,8 @@ static void readConfigs(opt::InputArgList &args) {
   config->nostdlib = args.hasArg(OPT_nostdlib);
   config->oFormatBinary = isOutputFormatBinary(args);
   config->omagic = args.hasFlag(OPT_omagic, OPT_no_omagic, false);
+  config->optimizeBBJumps =
+      args.hasFlag(OPT_optimize_bb_jumps, OPT_no_optimize_bb_jumps, false);
   config->optRemarksFilename = args.getLastArgValue(OPT_opt_remarks_filename);
   config->optRemarksPasses = args.getLastArgValue(OPT_opt_remarks_passes);
   config->optRemarksWithHotness = args.hasArg(OPT_opt_remarks_with_hotness);
@@ -900,6 +1102,9 @@ static void readConfigs(opt::InputArgList &args) {
   config->outputFile = args.getLastArgValue(OPT_o);
   config->pacPlt = args.hasArg(OPT_pac_plt);
   config->pie = args.hasFlag(OPT_pie, OPT_no_pie, false);
+  config->preloadInputs =
+      args.hasFlag(OPT_preload_inputs, OPT_no_preload_inputs, false);
+  config->prefetchInputs = getPrefetchKind(args);
   config->printIcfSections =
       args.hasFlag(OPT_print_icf_sections, OPT_no_print_icf_sections, false);
   config->printGcSections =
@@ -907,6 +1112,9 @@ static void readConfigs(opt::InputArgList &args) {
   config->printSymbolOrder =
       args.getLastArgValue(OPT_print_symbol_order);
   config->rpath = getRpath(args);
+  config->memoryBudget = parseMemoryBudget(args);
+  setMemoryBudget(config->memoryBudget);
+  config->releaseInputMemory = args.hasArg(OPT_release_input_memory);
   config->relocatable = args.hasArg(OPT_relocatable);
   config->saveTemps = args.hasArg(OPT_save_temps);
   config->searchPaths = args::getStrings(args, OPT_library_path);
@@ -914,6 +1122,9 @@ static void readConfigs(opt::InputArgList &args) {
   config->shared = args.hasArg(OPT_shared);
   config->singleRoRx = args.hasArg(OPT_no_rosegment);
   config->soName = args.getLastArgValue(OPT_soname);
+  config->stageOutputDir = args.getLastArgValue(OPT_stage_output_dir);
+  config->stageOutput =
+      args.hasArg(OPT_stage_output) || !config->stageOutputDir.empty();
   config->sortSection = getSortSection(args);
   config->splitStackAdjustSize = args::getInteger(args, OPT_split_stack_adjust_size, 16384);
   config->strip = getStrip(args);
@@ -933,7 +1144,19 @@ static void readConfigs(opt::InputArgList &args) {
       getOldNewOptions(args, OPT_thinlto_object_suffix_replace_eq);
   config->thinLTOPrefixReplace =
       getOldNewOptions(args, OPT_thinlto_prefix_replace_eq);
+  config->showTiming = args.hasArg(OPT_time);
+  config->timeJsonFile = args.getLastArgValue(OPT_time_json);
+  config->verifyDeterminism = args.getLastArgValue(OPT_verify_determinism);
+  arenaUsageEnabled = args.hasArg(OPT_print_arena_usage);
+  perfCountersEnabled = false;
+  if (args.hasArg(OPT_perf_counters))
+    enablePerfCounters();
+  config->timeTraceEnabled = args.hasArg(OPT_time_trace);
+  config->timeTraceFile = args.getLastArgValue(OPT_time_trace_file);
+  config->timeTraceGranularity =
+      args::getInteger(args, OPT_time_trace_granularity, 500);
   config->trace = args.hasArg(OPT_trace);
+  config->tuneGnuHash = args.hasArg(OPT_tune_gnu_hash);
   config->undefined = args::getStrings(args, OPT_undefined);
   config->undefinedVersion =
       args.hasFlag(OPT_undefined_version, OPT_no_undefined_version, true);
@@ -952,6 +1175,7 @@ static void readConfigs(opt::InputArgList &args) {
   config->zExecstack = getZFlag(args, "execstack", "noexecstack", false);
   config->zGlobal = hasZOption(args, "global");
   config->zHazardplt = hasZOption(args, "hazardplt");
+  config->zHugepageHotText = hasZOption(args, "hugepage-hot-text");
   config->zIfuncNoplt = hasZOption(args, "ifunc-noplt");
   config->zInitfirst = hasZOption(args, "initfirst");
   config->zInterpose = hasZOption(args, "interpose");
@@ -1034,13 +1258,36 @@ static void readConfigs(opt::InputArgList &args) {
       error("--symbol-ordering-file and --call-graph-order-file "
             "may not be used together");
     if (Optional<MemoryBufferRef> buffer = readFile(arg->getValue())){
-      config->symbolOrderingFile = getSymbolOrderingFile(*buffer);
+      if (!SymbolOrderIndex::isIndex(*buffer))
+        config->symbolOrderingFile = getSymbolOrderingFile(*buffer);
+      else if (SymbolOrderIndex::verify(*buffer))
+        config->symbolOrderingIndex = buffer->getBuffer();
       // Also need to disable CallGraphProfileSort to prevent
       // LLD order symbols with CGProfile
       config->callGraphProfileSort = false;
     }
   }
 
+  config->dataOrderingProfile = false;
+  if (auto *arg = args.getLastArg(OPT_data_ordering_file))
+    if (Optional<MemoryBufferRef> buffer = readFile(arg->getValue()))
+      config->dataOrderingProfile =
+          getDataOrderingFile(*buffer, config->dataOrderingFile);
+
+  if (auto *arg = args.getLastArg(OPT_print_symbol_ordering_index)) {
+    if (!config->symbolOrderingIndex.empty()) {
+      SymbolOrderIndex index(config->symbolOrderingIndex);
+      std::vector<StringRef> names;
+      for (uint32_t i = 0, e = index.size(); i != e; ++i)
+        names.push_back(index.getName(i));
+      writeSymbolOrderIndex(arg->getValue(), names);
+    } else if (args.hasArg(OPT_symbol_ordering_file)) {
+      writeSymbolOrderIndex(arg->getValue(), config->symbolOrderingFile);
+    } else {
+      error("--print-symbol-ordering-index requires --symbol-ordering-file");
+    }
+  }
+
   assert(config->versionDefinitions.empty());
   config->versionDefinitions.push_back({"local", (uint16_t)VER_NDX_LOCAL, {}});
   config->versionDefinitions.push_back(
@@ -1148,6 +1395,16 @@ void LinkerDriver::createFiles(opt::InputArgList &args) {
   // For --{push,pop}-state.
   std::vector<std::tuple<bool, bool, bool>> stack;
 
+  // With --preload-inputs, start reading the input files named on the
+  // command line while the files before them are parsed. Files that are
+  // read through --chroot or the link server's cache are not preloaded.
+  if (config->preloadInputs && config->chroot.empty() && !inputCacheEnabled) {
+    std::vector<std::string> paths;
+    for (auto *arg : args.filtered(OPT_INPUT))
+      paths.push_back(arg->getValue());
+    startPreloadingInputs(std::move(paths), /*requiresNullTerminator=*/false);
+  }
+
   // Iterate over argv to process input files and positional arguments.
   for (auto *arg : args) {
     switch (arg->getOption().getID()) {
@@ -1244,6 +1501,7 @@ void LinkerDriver::createFiles(opt::InputArgList &args) {
     }
   }
 
+  finishPreloadingInputs();
   if (files.empty() && errorCount() == 0)
     error("no input files");
 }
@@ -1575,13 +1833,14 @@ template <class ELFT> void LinkerDriver::compileBitcodeFiles() {
   for (BitcodeFile *file : bitcodeFiles)
     lto->add(*file);
 
-  for (InputFile *file : lto->compile()) {
+  // Native objects are parsed as their LTO backends finish.
+  lto->compile([](InputFile *file) {
     auto *obj = cast<ObjFile<ELFT>>(file);
     obj->parse(/*ignoreComdats=*/true);
     for (Symbol *sym : obj->getGlobalSymbols())
       sym->parseSymbolVersion();
     objectFiles.push_back(file);
-  }
+  });
 }
 
 // The --wrap option is a feature to rename symbols so that you can write
@@ -1695,6 +1954,46 @@ template <class ELFT> static uint32_t getAndFeatures() {
 
 // Do actual linking. Note that when this function is called,
 // all linker scripts have already been parsed.
+// With --lazy-shared-symbols, SymbolTable::find() does not see the symbols
+// of shared files that are not referenced. Load those that the driver and
+// the writer look up by name, so that they are found as if the shared files
+// had been added eagerly. This is done serially, as find() is also called
+// from parallel code.
+static void loadLazySharedRoots(opt::InputArgList &args) {
+  for (StringRef name : config->undefined)
+    symtab->loadLazyShared(name);
+  for (auto *arg : args.filtered(OPT_wrap, OPT_keep_unique))
+    symtab->loadLazyShared(arg->getValue());
+  symtab->loadLazyShared(config->entry);
+  symtab->loadLazyShared(config->init);
+  symtab->loadLazyShared(config->fini);
+  symtab->loadLazyShared("__morestack_non_split");
+}
+
+// A copy relocation also interposes the aliases of a symbol in its shared
+// file (see addCopyRelSymbol), which are looked up by name while relocations
+// are scanned. Load the aliases of the data symbols that may be copied
+// before that.
+template <class ELFT> static void loadLazySharedAliases() {
+  if (config->shared)
+    return;
+
+  std::vector<SharedSymbol *> syms;
+  symtab->forEachSymbol([&](Symbol *sym) {
+    if (auto *ss = dyn_cast<SharedSymbol>(sym))
+      if (ss->isObject())
+        syms.push_back(ss);
+  });
+
+  for (SharedSymbol *ss : syms) {
+    SharedFile &file = ss->getFile();
+    ArrayRef<typename ELFT::Sym> elfSyms = file.getGlobalELFSyms<ELFT>();
+    for (uint32_t i : file.getSymbolsAt<ELFT>(ss->value))
+      symtab->loadLazyShared(
+          check(elfSyms[i].getName(file.getStringTable())));
+  }
+}
+
 template <class ELFT> void LinkerDriver::link(opt::InputArgList &args) {
   // If a -hash-style option was not given, set to a default value,
   // which varies depending on the target.
@@ -1719,6 +2018,15 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &args) {
   if (errorCount())
     return;
 
+  // With --incremental, the previous output may only need a few object
+  // files patched in.
+  if (config->incremental && linkIncrementally(args))
+    return;
+
+  // With --link-cache-dir, an identical link may have been done before.
+  if (!config->linkCacheDir.empty() && useLinkCache(args))
+    return;
+
   // Use default entry point name if no name was given via the command
   // line nor linker scripts. For some reason, MIPS entry point name is
   // different from others.
@@ -1728,15 +2036,28 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &args) {
     config->entry = (config->emachine == EM_MIPS) ? "__start" : "_start";
 
   // Handle --trace-symbol.
-  for (auto *arg : args.filtered(OPT_trace_symbol))
-    symtab->insert(arg->getValue())->traced = true;
+  for (auto *arg : args.filtered(OPT_trace_symbol)) {
+    Symbol *sym = symtab->insert(arg->getValue());
+    sym->traced = true;
+    if (config->lazySharedSymbols)
+      symtab->unresolvedSymbols.push_back(sym);
+  }
 
   // Add all files to the symbol table. This will add almost all
   // symbols that we need to the symbol table. This process might
   // add files to the link, via autolinking, these files are always
   // appended to the Files vector.
-  for (size_t i = 0; i < files.size(); ++i)
-    parseFile(files[i]);
+  //
+  // Symbols have to be resolved in order, but the names of the global
+  // symbols of regular object files are read beforehand and their local
+  // symbols are created afterwards, both in parallel.
+  {
+    ScopedTimer t(symbolResolutionTimer);
+    preparseFiles(files);
+    for (size_t i = 0; i < files.size(); ++i)
+      parseFile(files[i]);
+    initializeLocalSymbols();
+  }
 
   // Now that we have every file, we can decide if we will need a
   // dynamic symbol table.
@@ -1747,6 +2068,9 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &args) {
   config->hasDynSymTab =
       !sharedFiles.empty() || config->isPic || config->exportDynamic;
 
+  if (config->lazySharedSymbols)
+    loadLazySharedRoots(args);
+
   // Some symbols (such as __ehdr_start) are defined lazily only when there
   // are undefined symbols for them, so we add these to trigger that logic.
   for (StringRef name : script->referencedSymbols)
@@ -1828,7 +2152,10 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &args) {
   //
   // With this the symbol table should be complete. After this, no new names
   // except a few linker-synthesized ones will be added to the symbol table.
-  compileBitcodeFiles<ELFT>();
+  {
+    ScopedTimer t(ltoTimer);
+    compileBitcodeFiles<ELFT>();
+  }
   if (errorCount())
     return;
 
@@ -1916,7 +2243,10 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &args) {
   replaceCommonSymbols();
 
   // Split SHF_MERGE and .eh_frame sections into pieces in preparation for garbage collection.
-  splitSections<ELFT>();
+  {
+    ScopedTimer t(splitSectionsTimer);
+    splitSections<ELFT>();
+  }
 
   // Garbage collection and removal of shared symbols from unused shared objects.
   markLive<ELFT>();
@@ -1936,13 +2266,18 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &args) {
   if (!config->relocatable)
     combineEhSections();
 
-  // Create output sections described by SECTIONS commands.
-  script->processSectionCommands();
+  {
+    ScopedTimer t(scriptTimer);
 
-  // Linker scripts control how input sections are assigned to output sections.
-  // Input sections that were not handled by scripts are called "orphans", and
-  // they are assigned to output sections by the default rule. Process that.
-  script->addOrphanSections();
+    // Create output sections described by SECTIONS commands.
+    script->processSectionCommands();
+
+    // Linker scripts control how input sections are assigned to output
+    // sections. Input sections that were not handled by scripts are called
+    // "orphans", and they are assigned to output sections by the default rule.
+    // Process that.
+    script->addOrphanSections();
+  }
 
   // Migrate InputSectionDescription::sectionBases to sections. This includes
   // merging MergeInputSections into a single MergeSyntheticSection. From this
@@ -1962,15 +2297,31 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &args) {
   }
 
   // Read the callgraph now that we know what was gced or icfed
-  if (config->callGraphProfileSort) {
+  if (config->callGraphProfileSort || config->sortPltEntries) {
     if (auto *arg = args.getLastArg(OPT_call_graph_ordering_file))
       if (Optional<MemoryBufferRef> buffer = readFile(arg->getValue()))
         readCallGraph(*buffer);
     readCallGraphsFromObjectFiles<ELFT>();
   }
 
+  if (config->lazySharedSymbols)
+    loadLazySharedAliases<ELFT>();
+
   // Write the result to the file.
   writeResult<ELFT>();
+
+  // The incremental state records the output file, so wait for it.
+  if (config->incremental) {
+    waitForOutputs();
+    if (!errorCount())
+      writeIncrementalState(args);
+  }
+
+  if (!config->linkCacheDir.empty()) {
+    waitForOutputs();
+    if (!errorCount())
+      addToLinkCache();
+  }
 }
 
 } // namespace elf
@@ -185,6 +185,7 @@ std::string createResponseFile(const opt::InputArgList &args) {
       // Strip directories to prevent the issue.
       os << "-o " << quote(sys::path::filename(arg->getValue())) << "\n";
       break;
+    case OPT_data_ordering_file:
     case OPT_dynamic_list:
     case OPT_library_path:
     case OPT_rpath:
@@ -9,7 +9,8 @@
 // ICF is short for Identical Code Folding. This is a size optimization to
 // identify and merge two or more read-only sections (typically functions)
 // that happened to have the same contents. It usually reduces output size
-// by a few percent.
+// by a few percent. With --icf=data, only read-only data sections (such as
+// .rodata constants and vtables) are folded.
 //
 // In ICF, two sections are considered identical if they have the same
 // section flags, section data, and relocations. Relocations are tricky,
@@ -47,7 +48,9 @@
 // 3. If we split an equivalence class in step 2, two relocations
 //    previously target the same equivalence class may now target
 //    different equivalence classes. Therefore, we repeat step 2 until a
-//    convergence is obtained.
+//    convergence is obtained. Only classes that contain a section that
+//    refers to a section whose class changed in the previous iteration
+//    can split, so we visit only those classes.
 //
 // 4. For each equivalence class C, pick an arbitrary section in C, and
 //    merge all the other sections in C with it.
@@ -81,6 +84,7 @@
 #include "SyntheticSections.h"
 #include "Writer.h"
 #include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/BinaryFormat/ELF.h"
 #include "llvm/Object/ELF.h"
@@ -94,6 +98,9 @@ using namespace llvm::object;
 
 namespace lld {
 namespace elf {
+
+static Timer icfTimer("ICF", Timer::root());
+
 namespace {
 template <class ELFT> class ICF {
 public:
@@ -115,6 +122,10 @@ private:
 
   size_t findBoundary(size_t begin, size_t end);
 
+  void initReferrers();
+  bool isDirty(size_t begin, size_t end);
+  void markReferrers(const InputSection *s);
+
   void forEachClassRange(size_t begin, size_t end,
                          llvm::function_ref<void(size_t, size_t)> fn);
 
@@ -128,6 +139,19 @@ private:
   // The main loop counter.
   int cnt = 0;
 
+  // Sections are identified by their indices in `sections` before it is
+  // sorted. The sections that refer to section I are
+  // referrers[referrerBegin[I]] to referrers[referrerBegin[I + 1] - 1].
+  llvm::DenseMap<const InputSection *, uint32_t> sectionIds;
+  std::vector<uint32_t> referrerBegin;
+  std::vector<uint32_t> referrers;
+
+  // A section is dirty if a section it refers to changed its equivalence
+  // class in the previous iteration, so that its class needs to be
+  // segregated again. `nextDirty` is set for the next iteration.
+  std::vector<std::atomic<bool>> dirty;
+  std::vector<std::atomic<bool>> nextDirty;
+
   // We have two locations for equivalence classes. On the first iteration
   // of the main loop, Class[0] has a valid value, and Class[1] contains
   // garbage. We read equivalence classes from slot 0 and write to slot 1.
@@ -162,6 +186,11 @@ static bool isEligible(InputSection *s) {
   if (!s->isLive() || s->keepUnique || !(s->flags & SHF_ALLOC))
     return false;
 
+  // --icf=data folds read-only data but leaves code alone, so that function
+  // addresses and backtraces are not affected.
+  if (config->icf == ICFLevel::Data && (s->flags & SHF_EXECINSTR))
+    return false;
+
   // Don't merge writable sections. .data.rel.ro sections are marked as writable
   // but are semantically read-only.
   if ((s->flags & SHF_WRITE) && s->name != ".data.rel.ro" &&
@@ -218,9 +247,13 @@ void ICF<ELFT>::segregate(size_t begin, size_t end, bool constant) {
 
     // Now we split [Begin, End) into [Begin, Mid) and [Mid, End) by
     // updating the sections in [Begin, Mid). We use Mid as an equivalence
-    // class ID because every group ends with a unique index.
-    for (size_t i = begin; i < mid; ++i)
+    // class ID because every group ends with a unique index. Sections
+    // referring to a section whose class changed need to be visited again.
+    for (size_t i = begin; i < mid; ++i) {
+      if (!constant && sections[i]->eqClass[current] != mid)
+        markReferrers(sections[i]);
       sections[i]->eqClass[next] = mid;
+    }
 
     // If we created a group, we need to iterate the main loop again.
     if (mid != end)
@@ -372,6 +405,73 @@ template <class ELFT> size_t ICF<ELFT>::findBoundary(size_t begin, size_t end) {
   return end;
 }
 
+// Collect the target sections of relocations that are subject of ICF.
+template <class ELFT, class RelTy>
+static void
+getTargetIds(InputSection *isec, ArrayRef<RelTy> rels,
+             const DenseMap<const InputSection *, uint32_t> &sectionIds,
+             std::vector<uint32_t> &ids) {
+  for (const RelTy &rel : rels) {
+    Symbol &s = isec->template getFile<ELFT>()->getRelocTargetSym(rel);
+    if (auto *d = dyn_cast<Defined>(&s))
+      if (auto *relSec = dyn_cast_or_null<InputSection>(d->section)) {
+        auto it = sectionIds.find(relSec);
+        if (it != sectionIds.end())
+          ids.push_back(it->second);
+      }
+  }
+  llvm::sort(ids);
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+// Build the reverse graph of relocations, so that we know which classes
+// may split after a class split.
+template <class ELFT> void ICF<ELFT>::initReferrers() {
+  for (size_t i = 0, e = sections.size(); i != e; ++i)
+    sectionIds[sections[i]] = i;
+
+  std::vector<std::vector<uint32_t>> targets(sections.size());
+  parallelForEachN(0, sections.size(), [&](size_t i) {
+    InputSection *s = sections[i];
+    if (s->areRelocsRela)
+      getTargetIds<ELFT>(s, s->template relas<ELFT>(), sectionIds, targets[i]);
+    else
+      getTargetIds<ELFT>(s, s->template rels<ELFT>(), sectionIds, targets[i]);
+  });
+
+  referrerBegin.assign(sections.size() + 1, 0);
+  for (const std::vector<uint32_t> &ids : targets)
+    for (uint32_t id : ids)
+      ++referrerBegin[id + 1];
+  for (size_t i = 1, e = referrerBegin.size(); i != e; ++i)
+    referrerBegin[i] += referrerBegin[i - 1];
+
+  std::vector<uint32_t> pos(referrerBegin.begin(), referrerBegin.end() - 1);
+  referrers.resize(referrerBegin.back());
+  for (size_t i = 0, e = targets.size(); i != e; ++i)
+    for (uint32_t id : targets[i])
+      referrers[pos[id]++] = i;
+
+  // All classes are visited in the first iteration.
+  dirty = std::vector<std::atomic<bool>>(sections.size());
+  nextDirty = std::vector<std::atomic<bool>>(sections.size());
+  for (std::atomic<bool> &d : dirty)
+    d = true;
+}
+
+template <class ELFT> bool ICF<ELFT>::isDirty(size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i)
+    if (dirty[sectionIds.find(sections[i])->second])
+      return true;
+  return false;
+}
+
+template <class ELFT> void ICF<ELFT>::markReferrers(const InputSection *s) {
+  uint32_t id = sectionIds.find(s)->second;
+  for (uint32_t i = referrerBegin[id], e = referrerBegin[id + 1]; i != e; ++i)
+    nextDirty[referrers[i]] = true;
+}
+
 // Sections in the same equivalence class are contiguous in Sections
 // vector. Therefore, Sections vector can be considered as contiguous
 // groups of sections, grouped by the class.
@@ -452,6 +552,8 @@ template <class ELFT> void ICF<ELFT>::run() {
       sections.push_back(s);
   }
 
+  initReferrers();
+
   // Initially, we use hash values to partition sections.
   parallelForEach(sections, [&](InputSection *s) {
     s->eqClass[0] = xxHash64(s->data());
@@ -478,8 +580,18 @@ template <class ELFT> void ICF<ELFT>::run() {
   // Split groups by comparing relocations until convergence is obtained.
   do {
     repeat = false;
-    forEachClass(
-        [&](size_t begin, size_t end) { segregate(begin, end, false); });
+    forEachClass([&](size_t begin, size_t end) {
+      if (isDirty(begin, end)) {
+        segregate(begin, end, false);
+        return;
+      }
+      // The class cannot split. Carry it over to the next slot.
+      for (size_t i = begin; i < end; ++i)
+        sections[i]->eqClass[next] = sections[i]->eqClass[current];
+    });
+
+    std::swap(dirty, nextDirty);
+    parallelForEach(nextDirty, [](std::atomic<bool> &d) { d = false; });
   } while (repeat);
 
   log("ICF needed " + Twine(cnt) + " iterations");
@@ -512,7 +624,10 @@ template <class ELFT> void ICF<ELFT>::run() {
 }
 
 // ICF entry point function.
-template <class ELFT> void doIcf() { ICF<ELFT>().run(); }
+template <class ELFT> void doIcf() {
+  ScopedTimer t(icfTimer);
+  ICF<ELFT>().run();
+}
 
 template void doIcf<ELF32LE>();
 template void doIcf<ELF32BE>();
@@ -0,0 +1,1413 @@
+//===- Incremental.cpp ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --incremental.
+//
+// In a typical edit-compile-link cycle only a few object files change between
+// two links, and usually only the contents of their functions change. With
+// --incremental, a full link writes <output>.incremental, which records where
+// the sections of each object file ended up in the output and what their
+// symbols resolved to, and leaves some room after each code section so that
+// it can grow. The next link with the same command line compares the inputs
+// against the state file, and if only object files changed, and only in ways
+// that do not affect the layout of the output or the rest of the link, copies
+// the new section contents over the old ones and applies their relocations.
+//
+// Anything else makes the linker fall back to a full link, which writes a new
+// state file. This includes added or removed symbols and sections, symbols
+// that move in a way that other files or linker-generated sections may
+// depend on, sections that outgrow their room, and relocations that need a
+// GOT or PLT entry, a dynamic relocation or a thunk that the previous link
+// did not create. The output of an incremental link is not the same as that
+// of a full link; it is only equivalent to it.
+//
+// Only x86-64 executables and shared objects linked without a SECTIONS
+// command are supported.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Incremental.h"
+#include "Config.h"
+#include "Driver.h"
+#include "InputFiles.h"
+#include "InputSection.h"
+#include "LinkerScript.h"
+#include "OutputSections.h"
+#include "Symbols.h"
+#include "SyntheticSections.h"
+#include "Target.h"
+#include "Writer.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
+#include "lld/Common/Version.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Object/ELF.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/xxhash.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace llvm::ELF;
+using namespace llvm::object;
+using namespace llvm::support::endian;
+
+namespace lld {
+namespace elf {
+
+std::vector<std::pair<std::string, MemoryBufferRef>> incrementalInputs;
+
+// True if the current link may write a state file, in which case code
+// sections are followed by some room to grow.
+static bool slackEnabled = false;
+
+namespace {
+using Elf_Shdr = ELF64LE::Shdr;
+using Elf_Sym = ELF64LE::Sym;
+using Elf_Rela = ELF64LE::Rela;
+
+const char stateMagic[] = "LLDINCR1";
+
+// The state file is a sequence of little-endian integers and length-prefixed
+// strings.
+class StateWriter {
+public:
+  void u8(uint8_t v) { buf.push_back(v); }
+
+  void u32(uint32_t v) {
+    char b[4];
+    write32le(b, v);
+    buf.append(b, 4);
+  }
+
+  void u64(uint64_t v) {
+    char b[8];
+    write64le(b, v);
+    buf.append(b, 8);
+  }
+
+  void str(StringRef s) {
+    u64(s.size());
+    buf.append(s.begin(), s.end());
+  }
+
+  std::string buf;
+};
+
+// Reads what StateWriter wrote. Reading past the end returns zeros and makes
+// ok() return false.
+class StateReader {
+public:
+  explicit StateReader(StringRef data) : data(data) {}
+
+  uint8_t u8() {
+    const uint8_t *p = take(1);
+    return p ? *p : 0;
+  }
+
+  uint32_t u32() {
+    const uint8_t *p = take(4);
+    return p ? read32le(p) : 0;
+  }
+
+  uint64_t u64() {
+    const uint8_t *p = take(8);
+    return p ? read64le(p) : 0;
+  }
+
+  StringRef str() {
+    uint64_t size = u64();
+    const uint8_t *p = take(size);
+    return p ? StringRef(reinterpret_cast<const char *>(p), size) : "";
+  }
+
+  bool ok() const { return !failed; }
+  bool atEnd() const { return pos == data.size(); }
+
+private:
+  const uint8_t *take(uint64_t size) {
+    if (failed || size > data.size() - pos) {
+      failed = true;
+      return nullptr;
+    }
+    pos += size;
+    return reinterpret_cast<const uint8_t *>(data.data()) + pos - size;
+  }
+
+  StringRef data;
+  size_t pos = 0;
+  bool failed = false;
+};
+
+// How a section of an object file is handled when the file changes.
+enum SectionKind : uint8_t {
+  // Not part of the output, like relocation sections and dead sections.
+  Ignored,
+  // Must not change.
+  Fixed,
+  // A regular input section, which may change and grow up to its capacity.
+  Patch,
+  // A mergeable section, which must not change, but whose pieces are needed
+  // to resolve references to it.
+  Merge,
+  // An .eh_frame section, whose FDEs may change but not grow.
+  Eh,
+};
+
+// Where the pieces of a mergeable section ended up.
+struct MergePiece {
+  uint64_t inputOff;
+  uint64_t va; // UINT64_MAX if dead
+};
+
+// A CIE or FDE record of an .eh_frame section.
+struct EhPiece {
+  uint64_t inputOff;
+  uint64_t size;
+  uint64_t outputOff; // UINT64_MAX if dead
+  bool isCie;
+  // The hash of a CIE, or the address that a live FDE describes.
+  uint64_t value;
+};
+
+struct SectionState {
+  SectionKind kind = Ignored;
+  uint64_t hash = 0;
+
+  // For Patch sections.
+  uint64_t fileOff = 0;
+  uint64_t va = 0;
+  uint64_t size = 0;
+  uint64_t capacity = 0;
+  uint32_t filler = 0;
+  bool alloc = false;
+  bool nobits = false;
+
+  std::vector<MergePiece> mergePieces;
+  std::vector<EhPiece> ehPieces;
+};
+
+enum SymbolFlags : uint32_t {
+  Preemptible = 1 << 0,
+  Absolute = 1 << 1,
+  Tls = 1 << 2,
+  Ifunc = 1 << 3,
+  Undef = 1 << 4,
+  UndefWeak = 1 << 5,
+  Dead = 1 << 6,
+  InGot = 1 << 7,
+  InPlt = 1 << 8,
+  DefinedHere = 1 << 9,
+};
+
+// What a symbol of an object file resolved to.
+struct SymbolState {
+  uint32_t flags = 0;
+  uint64_t va = 0;
+  uint64_t gotVA = 0;
+  uint64_t pltVA = 0;
+  uint64_t size = 0;
+  uint32_t symtabIndex = 0;
+  uint32_t dynsymIndex = 0;
+};
+
+// The state of a patchable object file.
+struct FileState {
+  void write(StateWriter &w) const;
+  bool read(StringRef data);
+
+  uint64_t fingerprint = 0;
+  std::vector<SectionState> sections;
+  std::vector<SymbolState> symbols;
+};
+
+// An input file of the link.
+struct InputState {
+  std::string path;
+  uint64_t size = 0;
+  uint64_t mtime = 0;
+  uint64_t hash = 0;
+  // The serialized FileState, or empty if the file is not patchable.
+  std::string block;
+};
+
+struct StateHeader {
+  uint64_t argsHash = 0;
+  uint64_t outputSize = 0;
+  uint64_t outputTime = 0;
+  uint64_t symtabOff = 0;
+  uint64_t dynsymOff = 0;
+  uint64_t ehFrameOff = 0;
+  uint64_t ehFrameVA = 0;
+  uint64_t buildIdOff = 0;
+  uint32_t buildIdSize = 0;
+  bool hasSizeRelocs = false;
+  bool hasTlsPhdr = false;
+};
+
+// The parts of an ELF object file that the state refers to.
+struct RawObject {
+  explicit RawObject(MemoryBufferRef mb);
+
+  ArrayRef<uint8_t> getContents(size_t i) const;
+  ArrayRef<Elf_Rela> getRelas(size_t i) const;
+
+  MemoryBufferRef mb;
+  ELFFile<ELF64LE> obj;
+  ArrayRef<Elf_Shdr> sections;
+  std::vector<StringRef> sectionNames;
+  ArrayRef<Elf_Sym> symbols;
+  StringRef stringTable;
+  // The SHT_RELA section that applies to each section, if any.
+  std::vector<const Elf_Shdr *> relaSections;
+  // True if the file uses SHT_REL or extended section indices, which are not
+  // supported.
+  bool unsupported = false;
+};
+} // namespace
+
+void FileState::write(StateWriter &w) const {
+  w.u64(fingerprint);
+  w.u64(sections.size());
+  for (const SectionState &s : sections) {
+    w.u8(s.kind);
+    switch (s.kind) {
+    case Ignored:
+      break;
+    case Fixed:
+      w.u64(s.hash);
+      break;
+    case Patch:
+      w.u64(s.fileOff);
+      w.u64(s.va);
+      w.u64(s.size);
+      w.u64(s.capacity);
+      w.u32(s.filler);
+      w.u8(s.alloc);
+      w.u8(s.nobits);
+      break;
+    case Merge:
+      w.u64(s.hash);
+      w.u64(s.mergePieces.size());
+      for (const MergePiece &p : s.mergePieces) {
+        w.u64(p.inputOff);
+        w.u64(p.va);
+      }
+      break;
+    case Eh:
+      w.u64(s.ehPieces.size());
+      for (const EhPiece &p : s.ehPieces) {
+        w.u64(p.inputOff);
+        w.u64(p.size);
+        w.u64(p.outputOff);
+        w.u8(p.isCie);
+        w.u64(p.value);
+      }
+      break;
+    }
+  }
+
+  w.u64(symbols.size());
+  for (const SymbolState &s : symbols) {
+    w.u32(s.flags);
+    w.u64(s.va);
+    w.u64(s.gotVA);
+    w.u64(s.pltVA);
+    w.u64(s.size);
+    w.u32(s.symtabIndex);
+    w.u32(s.dynsymIndex);
+  }
+}
+
+bool FileState::read(StringRef data) {
+  StateReader r(data);
+  fingerprint = r.u64();
+  sections.resize(std::min<uint64_t>(r.u64(), data.size()));
+  for (SectionState &s : sections) {
+    s.kind = SectionKind(r.u8());
+    switch (s.kind) {
+    case Ignored:
+      break;
+    case Fixed:
+      s.hash = r.u64();
+      break;
+    case Patch:
+      s.fileOff = r.u64();
+      s.va = r.u64();
+      s.size = r.u64();
+      s.capacity = r.u64();
+      s.filler = r.u32();
+      s.alloc = r.u8();
+      s.nobits = r.u8();
+      break;
+    case Merge:
+      s.hash = r.u64();
+      s.mergePieces.resize(std::min<uint64_t>(r.u64(), data.size()));
+      for (MergePiece &p : s.mergePieces) {
+        p.inputOff = r.u64();
+        p.va = r.u64();
+      }
+      break;
+    case Eh:
+      s.ehPieces.resize(std::min<uint64_t>(r.u64(), data.size()));
+      for (EhPiece &p : s.ehPieces) {
+        p.inputOff = r.u64();
+        p.size = r.u64();
+        p.outputOff = r.u64();
+        p.isCie = r.u8();
+        p.value = r.u64();
+      }
+      break;
+    default:
+      return false;
+    }
+    if (!r.ok())
+      return false;
+  }
+
+  symbols.resize(std::min<uint64_t>(r.u64(), data.size()));
+  for (SymbolState &s : symbols) {
+    s.flags = r.u32();
+    s.va = r.u64();
+    s.gotVA = r.u64();
+    s.pltVA = r.u64();
+    s.size = r.u64();
+    s.symtabIndex = r.u32();
+    s.dynsymIndex = r.u32();
+  }
+  return r.ok() && r.atEnd();
+}
+
+RawObject::RawObject(MemoryBufferRef mb)
+    : mb(mb), obj(check(ELFFile<ELF64LE>::create(mb.getBuffer()))) {
+  auto prefix = [&] { return mb.getBufferIdentifier().str(); };
+  sections = check2(obj.sections(), prefix);
+  StringRef shstrtab = check2(obj.getSectionStringTable(sections), prefix);
+
+  relaSections.resize(sections.size());
+  for (const Elf_Shdr &sec : sections) {
+    sectionNames.push_back(check2(obj.getSectionName(&sec, shstrtab), prefix));
+    if (sec.sh_type == SHT_REL || sec.sh_type == SHT_SYMTAB_SHNDX)
+      unsupported = true;
+    if (sec.sh_type == SHT_RELA && sec.sh_info < sections.size())
+      relaSections[sec.sh_info] = &sec;
+    if (sec.sh_type == SHT_SYMTAB) {
+      symbols = check2(obj.symbols(&sec), prefix);
+      stringTable =
+          check2(obj.getStringTableForSymtab(sec, sections), prefix);
+    }
+  }
+}
+
+ArrayRef<uint8_t> RawObject::getContents(size_t i) const {
+  if (sections[i].sh_type == SHT_NOBITS)
+    return {};
+  return check2(obj.getSectionContents(&sections[i]),
+                [&] { return mb.getBufferIdentifier().str(); });
+}
+
+ArrayRef<Elf_Rela> RawObject::getRelas(size_t i) const {
+  if (!relaSections[i])
+    return {};
+  return check2(obj.relas(relaSections[i]),
+                [&] { return mb.getBufferIdentifier().str(); });
+}
+
+// Returns a hash of the parts of the section and symbol tables of an object
+// file that must stay the same for the file to be patched. The sizes of the
+// patchable sections and the values of the local symbols in them may change.
+static uint64_t getFingerprint(const RawObject &o,
+                               ArrayRef<SectionState> sections) {
+  StateWriter w;
+  for (size_t i = 0, e = o.sections.size(); i != e; ++i) {
+    const Elf_Shdr &sec = o.sections[i];
+    w.str(o.sectionNames[i]);
+    w.u32(sec.sh_type);
+    w.u64(sec.sh_flags);
+    w.u64(sec.sh_addralign);
+    w.u64(sec.sh_entsize);
+    w.u32(sec.sh_link);
+    w.u32(sec.sh_info);
+    if (sections[i].kind != Patch)
+      w.u64(sec.sh_size);
+    if (sec.sh_type == SHT_GROUP)
+      w.u64(xxHash64(toStringRef(o.getContents(i))));
+  }
+
+  for (const Elf_Sym &sym : o.symbols) {
+    w.str(check(sym.getName(o.stringTable)));
+    w.u8(sym.st_info);
+    w.u8(sym.st_other);
+    w.u32(sym.st_shndx);
+    bool inPatch = sym.st_shndx < sections.size() &&
+                   sections[sym.st_shndx].kind == Patch;
+    if (sym.getBinding() != STB_LOCAL || !inPatch ||
+        sym.getType() == STT_TLS)
+      w.u64(sym.st_value);
+    if (sym.st_shndx == SHN_COMMON)
+      w.u64(sym.st_size);
+  }
+  return xxHash64(w.buf);
+}
+
+// Returns a hash of the contents and relocations of a section.
+static uint64_t getContentHash(const RawObject &o, size_t i) {
+  StateWriter w;
+  w.u64(xxHash64(toStringRef(o.getContents(i))));
+  if (o.relaSections[i])
+    w.u64(xxHash64(toStringRef(check(o.obj.getSectionContents(
+        o.relaSections[i])))));
+  return xxHash64(w.buf);
+}
+
+// Returns the relocations of an .eh_frame section that apply to a record.
+static ArrayRef<Elf_Rela> getRecordRelas(ArrayRef<Elf_Rela> rels,
+                                         uint64_t off, uint64_t size) {
+  auto begin = partition_point(
+      rels, [=](const Elf_Rela &rel) { return rel.r_offset < off; });
+  auto end = std::find_if(begin, rels.end(), [=](const Elf_Rela &rel) {
+    return rel.r_offset >= off + size;
+  });
+  return makeArrayRef(begin, end);
+}
+
+// Returns a hash of a CIE. CIEs are shared between object files, so they
+// must not change.
+static uint64_t getCieHash(ArrayRef<uint8_t> data, uint64_t off, uint64_t size,
+                           ArrayRef<Elf_Rela> rels) {
+  StateWriter w;
+  w.u64(xxHash64(toStringRef(data.slice(off, size))));
+  for (const Elf_Rela &rel : getRecordRelas(rels, off, size)) {
+    w.u64(rel.r_offset - off);
+    w.u64(rel.r_info);
+    w.u64(rel.r_addend);
+  }
+  return xxHash64(w.buf);
+}
+
+static bool isCie(ArrayRef<uint8_t> data, uint64_t off, uint64_t size) {
+  return size != 4 && read32le(data.data() + off + 4) == 0;
+}
+
+static uint64_t getArgsHash(opt::InputArgList &args) {
+  StateWriter w;
+  w.str(getLLDVersion());
+  for (opt::Arg *arg : args) {
+    // Skip the options that do not affect the output.
+    switch (arg->getOption().getID()) {
+    case OPT_error_limit:
+    case OPT_threads:
+    case OPT_no_threads:
+    case OPT_time:
+    case OPT_time_trace:
+    case OPT_time_trace_file:
+    case OPT_time_trace_granularity:
+    case OPT_verbose:
+      continue;
+    }
+    w.str(arg->getAsString(args));
+  }
+  return xxHash64(w.buf);
+}
+
+static bool getFileStatus(StringRef path, uint64_t &size, uint64_t &mtime) {
+  sys::fs::file_status st;
+  if (sys::fs::status(path, st))
+    return false;
+  size = st.getSize();
+  mtime = st.getLastModificationTime().time_since_epoch().count();
+  return true;
+}
+
+static std::string getStatePath() {
+  return (config->outputFile + ".incremental").str();
+}
+
+static bool readStateFile(MemoryBufferRef mb, StateHeader &hdr,
+                          std::vector<InputState> &inputs) {
+  StateReader r(mb.getBuffer());
+  if (r.str() != stateMagic)
+    return false;
+  hdr.argsHash = r.u64();
+  hdr.outputSize = r.u64();
+  hdr.outputTime = r.u64();
+  hdr.symtabOff = r.u64();
+  hdr.dynsymOff = r.u64();
+  hdr.ehFrameOff = r.u64();
+  hdr.ehFrameVA = r.u64();
+  hdr.buildIdOff = r.u64();
+  hdr.buildIdSize = r.u32();
+  hdr.hasSizeRelocs = r.u8();
+  hdr.hasTlsPhdr = r.u8();
+
+  inputs.resize(std::min<uint64_t>(r.u64(), mb.getBufferSize()));
+  for (InputState &in : inputs) {
+    in.path = r.str();
+    in.size = r.u64();
+    in.mtime = r.u64();
+    in.hash = r.u64();
+    in.block = r.str();
+  }
+  return r.ok() && r.atEnd();
+}
+
+static void writeStateFile(const StateHeader &hdr,
+                           ArrayRef<InputState> inputs) {
+  StateWriter w;
+  w.str(stateMagic);
+  w.u64(hdr.argsHash);
+  w.u64(hdr.outputSize);
+  w.u64(hdr.outputTime);
+  w.u64(hdr.symtabOff);
+  w.u64(hdr.dynsymOff);
+  w.u64(hdr.ehFrameOff);
+  w.u64(hdr.ehFrameVA);
+  w.u64(hdr.buildIdOff);
+  w.u32(hdr.buildIdSize);
+  w.u8(hdr.hasSizeRelocs);
+  w.u8(hdr.hasTlsPhdr);
+  w.u64(inputs.size());
+  for (const InputState &in : inputs) {
+    w.str(in.path);
+    w.u64(in.size);
+    w.u64(in.mtime);
+    w.u64(in.hash);
+    w.str(in.block);
+  }
+
+  // Write to a temporary file first so that a failed write does not leave a
+  // state file that does not match the output.
+  std::string path = getStatePath();
+  std::string tmp = path + ".tmp";
+  {
+    std::error_code ec;
+    raw_fd_ostream os(tmp, ec, sys::fs::OF_None);
+    if (ec) {
+      error("cannot open " + tmp + ": " + ec.message());
+      return;
+    }
+    os << w.buf;
+  }
+  if (std::error_code ec = sys::fs::rename(tmp, path))
+    error("cannot rename " + tmp + " to " + path + ": " + ec.message());
+}
+
+// Returns why the configuration of the link does not support --incremental,
+// or an empty string if it does.
+static std::string getUnsupportedReason() {
+  if (config->ekind != ELF64LEKind || config->emachine != EM_X86_64)
+    return "only x86-64 is supported";
+  if (config->relocatable)
+    return "-r is not supported";
+  if (config->emitRelocs)
+    return "--emit-relocs is not supported";
+  if (config->icf != ICFLevel::None)
+    return "--icf is not supported";
+  if (config->optimizeBBJumps)
+    return "--optimize-bb-jumps is not supported";
+  if (config->gdbIndex)
+    return "--gdb-index is not supported";
+  if (config->debugNames)
+    return "--debug-names is not supported";
+  if (config->compressDebugSections != DebugCompressionKind::None)
+    return "--compress-debug-sections is not supported";
+  if (!config->mapFile.empty() || config->cref)
+    return "-Map and --cref are not supported";
+  if (config->oFormatBinary)
+    return "--oformat binary is not supported";
+  if (config->printGcSections || config->printIcfSections || config->trace)
+    return "--print-gc-sections, --print-icf-sections and --trace are not "
+           "supported";
+  if (script->hasSectionsCommand)
+    return "linker scripts with SECTIONS commands are not supported";
+  if (config->outputFile == "-")
+    return "writing to the standard output is not supported";
+  return "";
+}
+
+uint64_t getIncrementalSlack(const InputSection *sec) {
+  if (!slackEnabled || sec->kind() != SectionBase::Regular || !sec->file ||
+      !sec->file->archiveName.empty())
+    return 0;
+  // Code and the LSDAs that describe it usually change together.
+  if (!(sec->flags & SHF_EXECINSTR) &&
+      !sec->name.startswith(".gcc_except_table"))
+    return 0;
+  return std::max<uint64_t>(sec->getSize() / 4, 16);
+}
+
+namespace {
+// Patches the previous output.
+class Relinker {
+public:
+  explicit Relinker(opt::InputArgList &args) : args(args) {}
+
+  // Returns false with the reason set if a full link is needed.
+  bool run();
+
+  std::string reason;
+
+private:
+  bool fail(const Twine &msg) {
+    reason = msg.str();
+    return false;
+  }
+
+  bool findChangedInputs(
+      std::vector<std::pair<size_t, MemoryBufferRef>> &changed);
+
+  bool patchFile(InputState &in, MemoryBufferRef mb);
+  bool patchSection(size_t i);
+  bool patchEhFrame(size_t i);
+  bool patchSymbols();
+  bool getSymbolVA(uint32_t symIndex, int64_t &addend, uint64_t &va);
+  bool hasMoved(uint32_t symIndex);
+  bool relocate(const Elf_Rela &rel, uint8_t *loc, uint64_t p, bool alloc);
+
+  opt::InputArgList &args;
+  StateHeader hdr;
+  std::vector<InputState> inputs;
+  uint8_t *out = nullptr;
+
+  // The file being patched.
+  StringRef path;
+  FileState *file = nullptr;
+  RawObject *obj = nullptr;
+};
+} // namespace
+
+// Finds the inputs that changed since the previous link.
+bool Relinker::findChangedInputs(
+    std::vector<std::pair<size_t, MemoryBufferRef>> &changed) {
+  StringMap<MemoryBufferRef> buffers;
+  for (std::pair<std::string, MemoryBufferRef> &p : incrementalInputs)
+    buffers.try_emplace(p.first, p.second);
+
+  StringMap<size_t> known;
+  for (size_t i = 0, e = inputs.size(); i != e; ++i)
+    known[inputs[i].path] = i;
+  for (std::pair<std::string, MemoryBufferRef> &p : incrementalInputs)
+    if (!known.count(p.first))
+      return fail(p.first + " is a new input");
+
+  for (size_t i = 0, e = inputs.size(); i != e; ++i) {
+    InputState &in = inputs[i];
+    uint64_t size, mtime;
+    if (!getFileStatus(in.path, size, mtime))
+      return fail("cannot stat " + in.path);
+    if (size == in.size && mtime == in.mtime)
+      continue;
+
+    // Files that the driver has not read yet, like archive members that were
+    // not needed so far, are read here.
+    MemoryBufferRef mb;
+    auto it = buffers.find(in.path);
+    if (it != buffers.end()) {
+      mb = it->second;
+    } else {
+      Optional<MemoryBufferRef> buf = readFile(in.path);
+      if (!buf)
+        return fail("cannot read " + in.path);
+      mb = *buf;
+    }
+
+    in.size = size;
+    in.mtime = mtime;
+    uint64_t hash = xxHash64(mb.getBuffer());
+    if (hash == in.hash)
+      continue;
+    if (in.block.empty())
+      return fail(in.path + " changed and cannot be patched");
+    in.hash = hash;
+    changed.push_back({i, mb});
+  }
+  return true;
+}
+
+bool Relinker::run() {
+  std::string statePath = getStatePath();
+  auto mbOrErr = MemoryBuffer::getFile(statePath, -1, false);
+  if (!mbOrErr)
+    return fail("no state from a previous link");
+  std::unique_ptr<MemoryBuffer> stateBuf = std::move(*mbOrErr);
+  if (!readStateFile(stateBuf->getMemBufferRef(), hdr, inputs))
+    return fail(statePath + " is corrupted");
+  if (hdr.argsHash != getArgsHash(args))
+    return fail("the command line changed");
+
+  uint64_t size, mtime;
+  if (!getFileStatus(config->outputFile, size, mtime) ||
+      size != hdr.outputSize || mtime != hdr.outputTime)
+    return fail(config->outputFile + " was changed by another program");
+
+  std::vector<std::pair<size_t, MemoryBufferRef>> changed;
+  if (!findChangedInputs(changed))
+    return false;
+
+  if (changed.empty()) {
+    // Touch the output so that build systems see that it is up to date.
+    int fd;
+    if (std::error_code ec = sys::fs::openFileForReadWrite(
+            config->outputFile, fd, sys::fs::CD_OpenExisting,
+            sys::fs::OF_None))
+      return fail("cannot open " + config->outputFile + ": " + ec.message());
+    std::error_code ec = sys::fs::setLastAccessAndModificationTime(
+        fd, std::chrono::system_clock::now());
+    sys::Process::SafelyCloseFileDescriptor(fd);
+    if (ec)
+      return fail("cannot touch " + config->outputFile + ": " + ec.message());
+    log("incremental: output is up to date");
+  } else {
+    auto oldOrErr = MemoryBuffer::getFile(config->outputFile, -1, false);
+    if (!oldOrErr)
+      return fail("cannot read " + config->outputFile);
+    if ((*oldOrErr)->getBufferSize() != hdr.outputSize)
+      return fail(config->outputFile + " was changed by another program");
+
+    Expected<std::unique_ptr<FileOutputBuffer>> bufferOrErr =
+        FileOutputBuffer::create(config->outputFile, hdr.outputSize,
+                                 FileOutputBuffer::F_executable);
+    if (!bufferOrErr) {
+      error("failed to open " + config->outputFile + ": " +
+            llvm::toString(bufferOrErr.takeError()));
+      return true;
+    }
+    std::unique_ptr<FileOutputBuffer> buffer = std::move(*bufferOrErr);
+    out = buffer->getBufferStart();
+    Out::bufferStart = out;
+    memcpy(out, (*oldOrErr)->getBufferStart(), hdr.outputSize);
+
+    for (std::pair<size_t, MemoryBufferRef> &p : changed)
+      if (!patchFile(inputs[p.first], p.second))
+        return false;
+
+    if (hdr.buildIdOff) {
+      MutableArrayRef<uint8_t> buildId(out + hdr.buildIdOff, hdr.buildIdSize);
+      memset(buildId.data(), 0, buildId.size());
+      computeBuildId(buildId, {out, size_t(hdr.outputSize)});
+    }
+
+    // Relocations that do not fit are reported as errors.
+    if (errorCount())
+      return true;
+    if (Error e = buffer->commit()) {
+      error("failed to write to the output file: " + toString(std::move(e)));
+      return true;
+    }
+    for (std::pair<size_t, MemoryBufferRef> &p : changed)
+      log("incremental: patched " + inputs[p.first].path);
+  }
+
+  if (!getFileStatus(config->outputFile, hdr.outputSize, hdr.outputTime))
+    error("cannot stat " + config->outputFile);
+  else
+    writeStateFile(hdr, inputs);
+  return true;
+}
+
+bool Relinker::patchFile(InputState &in, MemoryBufferRef mb) {
+  FileState state;
+  if (!state.read(in.block))
+    return fail(getStatePath() + " is corrupted");
+
+  RawObject raw(mb);
+  path = in.path;
+  file = &state;
+  obj = &raw;
+
+  if (raw.unsupported)
+    return fail(path + ": SHT_REL and SHT_SYMTAB_SHNDX are not supported");
+  if (raw.sections.size() != state.sections.size() ||
+      raw.symbols.size() != state.symbols.size() ||
+      getFingerprint(raw, state.sections) != state.fingerprint)
+    return fail(path + ": the section or symbol table changed");
+
+  for (size_t i = 0, e = raw.sections.size(); i != e; ++i)
+    if (!patchSection(i))
+      return false;
+  if (!patchSymbols())
+    return false;
+
+  StateWriter w;
+  state.write(w);
+  in.block = std::move(w.buf);
+  return true;
+}
+
+bool Relinker::patchSection(size_t i) {
+  SectionState &sec = file->sections[i];
+  StringRef name = obj->sectionNames[i];
+
+  switch (sec.kind) {
+  case Ignored:
+    return true;
+  case Eh:
+    return patchEhFrame(i);
+  case Fixed:
+  case Merge:
+    if (getContentHash(*obj, i) != sec.hash)
+      return fail(path + ": " + name + " changed");
+
+    // The section is not rewritten, so what it refers to must not move.
+    for (const Elf_Rela &rel : obj->getRelas(i))
+      if (hasMoved(rel.getSymbol(false)))
+        return fail(path + ": " + name + " refers to a symbol that moved");
+    return true;
+  case Patch:
+    break;
+  }
+
+  uint64_t size = obj->sections[i].sh_size;
+  if (size > sec.capacity)
+    return fail(path + ": " + name + " grew too much");
+  sec.size = size;
+  if (sec.nobits)
+    return true;
+
+  uint8_t *buf = out + sec.fileOff;
+  ArrayRef<uint8_t> data = obj->getContents(i);
+  memcpy(buf, data.data(), size);
+  uint8_t filler[4];
+  write32le(filler, sec.filler);
+  for (uint64_t j = size; j != sec.capacity; ++j)
+    buf[j] = filler[(j - size) % 4];
+
+  for (const Elf_Rela &rel : obj->getRelas(i)) {
+    if (rel.r_offset >= size)
+      return fail(path + ": " + name + " has a relocation out of bounds");
+    if (!relocate(rel, buf + rel.r_offset, sec.va + rel.r_offset, sec.alloc))
+      return false;
+  }
+  return true;
+}
+
+// FDEs may change as long as their sizes and the functions they describe do
+// not. CIEs are shared between files and must not change at all.
+bool Relinker::patchEhFrame(size_t i) {
+  SectionState &sec = file->sections[i];
+  ArrayRef<uint8_t> data = obj->getContents(i);
+  ArrayRef<Elf_Rela> rels = obj->getRelas(i);
+  if (!std::is_sorted(rels.begin(), rels.end(),
+                      [](const Elf_Rela &a, const Elf_Rela &b) {
+                        return a.r_offset < b.r_offset;
+                      }))
+    return fail(path + ": unsorted .eh_frame relocations");
+
+  uint64_t off = 0;
+  for (EhPiece &piece : sec.ehPieces) {
+    if (off + 4 > data.size())
+      return fail(path + ": .eh_frame changed");
+    uint64_t size = read32le(data.data() + off) + 4;
+    if (piece.inputOff != off || piece.size != size ||
+        off + size > data.size() || piece.isCie != isCie(data, off, size))
+      return fail(path + ": .eh_frame changed");
+
+    ArrayRef<Elf_Rela> recordRels = getRecordRelas(rels, off, size);
+    if (piece.isCie) {
+      if (getCieHash(data, off, size, rels) != piece.value)
+        return fail(path + ": a CIE changed");
+    } else if (size != 4 && piece.outputOff == UINT64_MAX) {
+      // A dead FDE must stay dead.
+      if (!recordRels.empty() &&
+          !(file->symbols[recordRels[0].getSymbol(false)].flags & Dead))
+        return fail(path + ": an FDE became live");
+    } else if (size != 4) {
+      // A live FDE must describe the same function.
+      if (recordRels.empty())
+        return fail(path + ": .eh_frame changed");
+      int64_t addend = recordRels[0].r_addend;
+      uint64_t va;
+      if (!getSymbolVA(recordRels[0].getSymbol(false), addend, va))
+        return false;
+      if (va + addend != piece.value)
+        return fail(path + ": an FDE describes a different function");
+
+      // The length and the CIE pointer stay the same.
+      uint8_t *buf = out + hdr.ehFrameOff + piece.outputOff;
+      memcpy(buf + 8, data.data() + off + 8, size - 8);
+      for (const Elf_Rela &rel : recordRels) {
+        uint64_t relOff = piece.outputOff + rel.r_offset - off;
+        if (!relocate(rel, out + hdr.ehFrameOff + relOff,
+                      hdr.ehFrameVA + relOff, true))
+          return false;
+      }
+    }
+
+    off += size;
+    if (size == 4)
+      break;
+  }
+  return true;
+}
+
+// Updates the values and sizes of the symbols defined by the patched file in
+// the symbol tables.
+bool Relinker::patchSymbols() {
+  for (size_t i = 0, e = obj->symbols.size(); i != e; ++i) {
+    const Elf_Sym &sym = obj->symbols[i];
+    SymbolState &s = file->symbols[i];
+    if (!(s.flags & DefinedHere))
+      continue;
+
+    if (hasMoved(i)) {
+      if (s.flags & (InGot | InPlt))
+        return fail(path + ": a symbol in the GOT or PLT moved");
+      int64_t addend = 0;
+      if (!getSymbolVA(i, addend, s.va))
+        return false;
+      if (s.symtabIndex)
+        write64le(out + hdr.symtabOff + s.symtabIndex * sizeof(Elf_Sym) + 8,
+                  s.va);
+    }
+
+    if (sym.st_size == s.size)
+      continue;
+    if (hdr.hasSizeRelocs)
+      return fail(path + ": a symbol size changed and the output has "
+                  "R_X86_64_SIZE relocations");
+    s.size = sym.st_size;
+    if (s.symtabIndex)
+      write64le(out + hdr.symtabOff + s.symtabIndex * sizeof(Elf_Sym) + 16,
+                s.size);
+    if (s.dynsymIndex)
+      write64le(out + hdr.dynsymOff + s.dynsymIndex * sizeof(Elf_Sym) + 16,
+                s.size);
+  }
+  return true;
+}
+
+// Returns true if a local symbol of the patched file has a new address.
+bool Relinker::hasMoved(uint32_t symIndex) {
+  if (symIndex >= obj->symbols.size())
+    return false;
+  const Elf_Sym &sym = obj->symbols[symIndex];
+  const SymbolState &s = file->symbols[symIndex];
+  if (!(s.flags & DefinedHere) || sym.st_shndx >= file->sections.size() ||
+      file->sections[sym.st_shndx].kind != Patch ||
+      sym.getType() == STT_SECTION)
+    return false;
+  return file->sections[sym.st_shndx].va + sym.st_value != s.va;
+}
+
+// Computes the address of a symbol of the patched file. For section symbols
+// of mergeable sections, the addend is folded into the address, as
+// Symbol::getVA() does.
+bool Relinker::getSymbolVA(uint32_t symIndex, int64_t &addend,
+                           uint64_t &va) {
+  if (symIndex >= obj->symbols.size())
+    return fail(path + ": invalid symbol index " + Twine(symIndex));
+  const Elf_Sym &sym = obj->symbols[symIndex];
+  const SymbolState &s = file->symbols[symIndex];
+  va = s.va;
+  if (!(s.flags & DefinedHere) || (s.flags & Tls) ||
+      sym.st_shndx >= file->sections.size())
+    return true;
+
+  const SectionState &sec = file->sections[sym.st_shndx];
+  if (sec.kind == Patch) {
+    va = sec.va + sym.st_value;
+    return true;
+  }
+  if (sec.kind != Merge)
+    return true;
+
+  uint64_t off = sym.st_value;
+  if (sym.getType() == STT_SECTION) {
+    off += addend;
+    addend = 0;
+  }
+  auto it = partition_point(sec.mergePieces, [=](const MergePiece &p) {
+    return p.inputOff <= off;
+  });
+  if (it == sec.mergePieces.begin() || std::prev(it)->va == UINT64_MAX)
+    return fail(path + ": a reference to a dead piece of " +
+                obj->sectionNames[sym.st_shndx]);
+  --it;
+  va = it->va + off - it->inputOff;
+  return true;
+}
+
+// Applies a relocation the way Relocations.cpp and relocateAlloc() would,
+// or fails if the previous link did something that this does not know about,
+// like creating a dynamic relocation.
+bool Relinker::relocate(const Elf_Rela &rel, uint8_t *loc, uint64_t p,
+                        bool alloc) {
+  RelType type = rel.getType(false);
+  uint32_t symIndex = rel.getSymbol(false);
+  static Undefined dummy(nullptr, "", STB_LOCAL, 0, 0);
+  RelExpr expr = target->getRelExpr(type, dummy, loc);
+  if (expr == R_NONE || expr == R_HINT)
+    return true;
+  if (symIndex >= file->symbols.size())
+    return fail(path + ": invalid symbol index " + Twine(symIndex));
+
+  const SymbolState &s = file->symbols[symIndex];
+  auto unsupported = [&] {
+    return fail(path + ": unsupported relocation " + toString(type) +
+                " against " +
+                check(obj->symbols[symIndex].getName(obj->stringTable)));
+  };
+  int64_t a = rel.r_addend;
+  uint64_t va;
+
+  // See InputSection::relocateNonAlloc().
+  if (!alloc) {
+    if (expr != R_ABS && expr != R_DTPREL)
+      return unsupported();
+    if ((s.flags & Tls) && !hdr.hasTlsPhdr) {
+      target->relocateOne(loc, type, 0);
+      return true;
+    }
+    if (!getSymbolVA(symIndex, a, va))
+      return false;
+    target->relocateOne(loc, type, va + a);
+    return true;
+  }
+
+  if (s.flags & (Tls | Ifunc | Dead))
+    return unsupported();
+  if ((s.flags & Undef) && !(s.flags & (UndefWeak | Preemptible)))
+    return unsupported();
+
+  bool preemptible = s.flags & Preemptible;
+  uint64_t v;
+  switch (expr) {
+  case R_ABS:
+    if (preemptible || (config->isPic && !(s.flags & Absolute)))
+      return unsupported();
+    if (!getSymbolVA(symIndex, a, va))
+      return false;
+    v = va + a;
+    break;
+  case R_PC:
+  case R_PLT_PC:
+    if (preemptible) {
+      if (expr == R_PC || !(s.flags & InPlt))
+        return unsupported();
+      v = s.pltVA + a - p;
+      break;
+    }
+    if (config->isPic && (s.flags & Absolute) && !(s.flags & UndefWeak))
+      return unsupported();
+    if (!getSymbolVA(symIndex, a, va))
+      return false;
+    v = va + a - p;
+    break;
+  case R_GOT_PC:
+    if (!preemptible && !(s.flags & Absolute)) {
+      RelExpr relaxed = target->adjustRelaxExpr(type, loc, expr);
+      if (relaxed == R_RELAX_GOT_PC || relaxed == R_RELAX_GOT_PC_NOPIC) {
+        if (!getSymbolVA(symIndex, a, va))
+          return false;
+        v = va + a;
+        if (relaxed == R_RELAX_GOT_PC)
+          v -= p;
+        target->relaxGot(loc, type, v);
+        return true;
+      }
+    }
+    if (!(s.flags & InGot))
+      return unsupported();
+    v = s.gotVA + a - p;
+    break;
+  default:
+    return unsupported();
+  }
+  target->relocateOne(loc, type, v);
+  return true;
+}
+
+bool linkIncrementally(opt::InputArgList &args) {
+  slackEnabled = false;
+  std::string reason = getUnsupportedReason();
+  if (!reason.empty()) {
+    warn("--incremental: " + reason + "; ignoring");
+    return false;
+  }
+  slackEnabled = true;
+
+  Relinker relinker(args);
+  if (relinker.run())
+    return true;
+  if (!errorCount())
+    log("incremental: " + relinker.reason + "; doing a full link");
+  return false;
+}
+
+namespace {
+// What writeIncrementalState() needs to know about the link.
+struct SaveContext {
+  DenseMap<const InputSectionBase *, uint64_t> capacities;
+  DenseSet<const InputSectionBase *> dynRelocSections;
+  DenseMap<const Symbol *, uint32_t> symtabIndices;
+};
+} // namespace
+
+static bool isAbsolute(const Symbol &sym) {
+  if (sym.isUndefWeak())
+    return true;
+  if (auto *d = dyn_cast<Defined>(&sym))
+    return !d->section;
+  return false;
+}
+
+static SymbolState getSymbolState(const Symbol *sym, const InputFile *file,
+                                  const SaveContext &ctx) {
+  SymbolState s;
+  if (!sym)
+    return s;
+  if (sym->isPreemptible)
+    s.flags |= Preemptible;
+  if (isAbsolute(*sym))
+    s.flags |= Absolute;
+  if (sym->isTls())
+    s.flags |= Tls;
+  if (sym->isGnuIFunc())
+    s.flags |= Ifunc;
+  if (sym->isUndefined())
+    s.flags |= Undef;
+  if (sym->isUndefWeak())
+    s.flags |= UndefWeak;
+  if (sym->isInGot()) {
+    s.flags |= InGot;
+    s.gotVA = sym->getGotVA();
+  }
+  if (sym->isInPlt()) {
+    s.flags |= InPlt;
+    s.pltVA = sym->getPltVA();
+  }
+
+  if (auto *d = dyn_cast<Defined>(sym)) {
+    if (d->section && !d->section->isLive())
+      s.flags |= Dead;
+    if (d->file == file)
+      s.flags |= DefinedHere;
+    s.size = d->size;
+  }
+  if (isa<Defined>(sym) || isa<SharedSymbol>(sym))
+    s.va = sym->getVA();
+  s.symtabIndex = ctx.symtabIndices.lookup(sym);
+  s.dynsymIndex = sym->aux().dynsymIndex;
+  return s;
+}
+
+static SectionState getSectionState(const RawObject &raw, size_t i,
+                                    InputSectionBase *sec,
+                                    const SaveContext &ctx) {
+  const Elf_Shdr &hdr = raw.sections[i];
+  SectionState s;
+  switch (hdr.sh_type) {
+  case SHT_NULL:
+  case SHT_REL:
+  case SHT_RELA:
+  case SHT_SYMTAB:
+  case SHT_STRTAB:
+  case SHT_SYMTAB_SHNDX:
+  case SHT_GROUP:
+    return s;
+  }
+
+  // Members of discarded COMDAT groups do not matter, but other discarded
+  // sections may be read by the linker, like .note.gnu.property.
+  if (sec == &InputSection::discarded && (hdr.sh_flags & SHF_GROUP))
+    return s;
+  if (!sec || sec == &InputSection::discarded) {
+    s.kind = Fixed;
+    s.hash = getContentHash(raw, i);
+    return s;
+  }
+  if (!sec->isLive())
+    return s;
+
+  if (auto *eh = dyn_cast<EhInputSection>(sec)) {
+    if (!eh->getParent() || !eh->getParent()->getParent())
+      return s;
+    s.kind = Eh;
+    ArrayRef<uint8_t> data = eh->data();
+    ArrayRef<Elf_Rela> rels = raw.getRelas(i);
+    for (const EhSectionPiece &piece : eh->pieces) {
+      EhPiece p;
+      p.inputOff = piece.inputOff;
+      p.size = piece.size;
+      p.outputOff = piece.outputOff == -1 ? UINT64_MAX : piece.outputOff;
+      p.isCie = isCie(data, piece.inputOff, piece.size);
+      if (p.isCie) {
+        p.value = getCieHash(data, piece.inputOff, piece.size, rels);
+      } else if (p.outputOff != UINT64_MAX &&
+                 piece.firstRelocation != (unsigned)-1) {
+        const Elf_Rela &rel = rels[piece.firstRelocation];
+        Symbol &target = eh->getFile<ELF64LE>()->getRelocTargetSym(rel);
+        p.value = target.getVA(rel.r_addend);
+      }
+      s.ehPieces.push_back(p);
+    }
+    return s;
+  }
+
+  if (auto *ms = dyn_cast<MergeInputSection>(sec)) {
+    if (!ms->getParent() || !ms->getParent()->getParent())
+      return s;
+    s.kind = Merge;
+    s.hash = getContentHash(raw, i);
+    for (const SectionPiece &piece : ms->pieces) {
+      uint64_t va = piece.live ? ms->getVA(piece.inputOff) : UINT64_MAX;
+      s.mergePieces.push_back({piece.inputOff, va});
+    }
+    return s;
+  }
+
+  auto *isec = cast<InputSection>(sec);
+  OutputSection *os = isec->getParent();
+  if (!os || isec->repl != isec)
+    return s;
+
+  // Compressed sections and sections with dynamic relocations, which we
+  // cannot update, must stay the same.
+  if ((hdr.sh_flags & SHF_COMPRESSED) || isec->name.startswith(".zdebug") ||
+      ctx.dynRelocSections.count(isec)) {
+    s.kind = Fixed;
+    s.hash = getContentHash(raw, i);
+    return s;
+  }
+
+  s.kind = Patch;
+  s.fileOff = os->offset + isec->outSecOff;
+  s.va = isec->getVA(0);
+  s.size = isec->getSize();
+  s.capacity = ctx.capacities.lookup(isec);
+  s.filler = read32le(os->getFiller().data());
+  s.alloc = isec->flags & SHF_ALLOC;
+  s.nobits = isec->type == SHT_NOBITS;
+  return s;
+}
+
+static std::string getFileBlock(ObjFile<ELF64LE> *f, const SaveContext &ctx) {
+  RawObject raw(f->mb);
+  if (raw.unsupported)
+    return "";
+
+  FileState state;
+  ArrayRef<InputSectionBase *> sections = f->getSections();
+  for (size_t i = 0, e = raw.sections.size(); i != e; ++i)
+    state.sections.push_back(getSectionState(
+        raw, i, i < sections.size() ? sections[i] : nullptr, ctx));
+  for (const Symbol *sym : f->getSymbols())
+    state.symbols.push_back(getSymbolState(sym, f, ctx));
+  state.fingerprint = getFingerprint(raw, state.sections);
+
+  StateWriter w;
+  state.write(w);
+  return std::move(w.buf);
+}
+
+static uint64_t getFileOffset(const InputSection *sec) {
+  if (!sec || !sec->getParent())
+    return 0;
+  return sec->getParent()->offset + sec->outSecOff;
+}
+
+void writeIncrementalState(opt::InputArgList &args) {
+  std::string path = getStatePath();
+  std::string reason;
+  if (!slackEnabled)
+    reason = getUnsupportedReason();
+  else if (!bitcodeFiles.empty())
+    reason = "LTO is not supported";
+  else if (partitions.size() > 1)
+    reason = "partitions are not supported";
+  if (!reason.empty()) {
+    log("incremental: " + reason + "; not saving the link state");
+    sys::fs::remove(path);
+    return;
+  }
+
+  SaveContext ctx;
+  for (OutputSection *os : outputSections) {
+    std::vector<InputSection *> sections = getInputSections(os);
+    for (size_t i = 0, e = sections.size(); i != e; ++i) {
+      uint64_t end = i + 1 == e ? os->size : sections[i + 1]->outSecOff;
+      ctx.capacities[sections[i]] = end - sections[i]->outSecOff;
+    }
+  }
+  for (const DynamicReloc &rel : mainPart->relaDyn->relocs)
+    ctx.dynRelocSections.insert(rel.inputSec);
+  if (mainPart->relrDyn)
+    for (const RelativeReloc &rel : mainPart->relrDyn->relocs)
+      ctx.dynRelocSections.insert(rel.inputSec);
+  if (in.symTab) {
+    ArrayRef<SymbolTableEntry> syms = in.symTab->getSymbols();
+    for (size_t i = 0, e = syms.size(); i != e; ++i)
+      ctx.symtabIndices[syms[i].sym] = i + 1;
+  }
+
+  StateHeader hdr;
+  hdr.argsHash = getArgsHash(args);
+  if (!getFileStatus(config->outputFile, hdr.outputSize, hdr.outputTime)) {
+    error("cannot stat " + config->outputFile);
+    return;
+  }
+  hdr.symtabOff = getFileOffset(in.symTab);
+  hdr.dynsymOff = getFileOffset(mainPart->dynSymTab);
+  hdr.ehFrameOff = getFileOffset(mainPart->ehFrame);
+  if (mainPart->ehFrame)
+    hdr.ehFrameVA = mainPart->ehFrame->getVA(0);
+  if (mainPart->buildId && mainPart->buildId->getParent() &&
+      config->buildId != BuildIdKind::Hexstring) {
+    // The hash follows the 16-byte note header.
+    hdr.buildIdOff = getFileOffset(mainPart->buildId) + 16;
+    hdr.buildIdSize = mainPart->buildId->hashSize;
+  }
+  hdr.hasSizeRelocs = llvm::any_of(inputSections, [](InputSectionBase *sec) {
+    return llvm::any_of(sec->relocations, [](const Relocation &rel) {
+      return rel.expr == R_SIZE;
+    });
+  });
+  hdr.hasTlsPhdr = Out::tlsPhdr;
+
+  // Object files that are not archive members can be patched.
+  StringMap<ObjFile<ELF64LE> *> patchable;
+  for (InputFile *f : objectFiles) {
+    if (!isa<ObjFile<ELF64LE>>(f) || !f->archiveName.empty() ||
+        f->justSymbols)
+      continue;
+    auto *obj = cast<ObjFile<ELF64LE>>(f);
+    if (!obj->splitStack)
+      patchable[f->getName()] = obj;
+  }
+
+  // An input may be read more than once, like an archive given twice.
+  std::vector<InputState> inputs;
+  std::vector<MemoryBufferRef> buffers;
+  StringSet<> seen;
+  for (std::pair<std::string, MemoryBufferRef> &p : incrementalInputs) {
+    if (!seen.insert(p.first).second)
+      continue;
+    InputState input;
+    input.path = p.first;
+    inputs.push_back(std::move(input));
+    buffers.push_back(p.second);
+  }
+
+  parallelForEachN(0, inputs.size(), [&](size_t i) {
+    InputState &input = inputs[i];
+    getFileStatus(input.path, input.size, input.mtime);
+    input.hash = xxHash64(buffers[i].getBuffer());
+    if (ObjFile<ELF64LE> *f = patchable.lookup(input.path))
+      input.block = getFileBlock(f, ctx);
+  });
+  writeStateFile(hdr, inputs);
+}
+
+} // namespace elf
+} // namespace lld
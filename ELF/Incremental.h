@@ -0,0 +1,43 @@
+//===- Incremental.h --------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_INCREMENTAL_H
+#define LLD_ELF_INCREMENTAL_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/Option/ArgList.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lld {
+namespace elf {
+class InputSection;
+
+// The files read by the link with --incremental, so that a later link can
+// tell whether they have changed.
+extern std::vector<std::pair<std::string, MemoryBufferRef>> incrementalInputs;
+
+// Returns the number of bytes to leave free after an input section, so that
+// the section can grow when it is patched by a later link.
+uint64_t getIncrementalSlack(const InputSection *sec);
+
+// Tries to update the previous output by patching the object files that
+// changed since it was linked. Returns true if that was done, or if it
+// failed with an error, and false if a full link is needed.
+bool linkIncrementally(llvm::opt::InputArgList &args);
+
+// Writes the state that linkIncrementally() needs next to the output.
+void writeIncrementalState(llvm::opt::InputArgList &args);
+
+} // namespace elf
+} // namespace lld
+
+#endif
@@ -7,15 +7,25 @@
 //===----------------------------------------------------------------------===//
 
 #include "InputFiles.h"
+#include "ArchiveCache.h"
 #include "Driver.h"
+#include "Incremental.h"
 #include "InputSection.h"
+#include "LinkCache.h"
 #include "LinkerScript.h"
+#include "PassThrough.h"
+#include "Prefetch.h"
+#include "ReleaseMemory.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "SyntheticSections.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/InputCache.h"
+#include "lld/Common/InputLoader.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/CodeGen/Analysis.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -26,7 +36,6 @@
 #include "llvm/Support/ARMBuildAttributes.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/Path.h"
-#include "llvm/Support/TarWriter.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -60,7 +69,7 @@ std::vector<LazyObjFile *> lazyObjFiles;
 std::vector<InputFile *> objectFiles;
 std::vector<SharedFile *> sharedFiles;
 
-std::unique_ptr<TarWriter> tar;
+std::unique_ptr<AsyncTarWriter> tar;
 
 static ELFKind getELFKind(MemoryBufferRef mb, StringRef archiveName) {
   unsigned char size;
@@ -108,16 +117,38 @@ Optional<MemoryBufferRef> readFile(StringRef path) {
 
   log(path);
 
-  auto mbOrErr = MemoryBuffer::getFile(path, -1, false);
-  if (auto ec = mbOrErr.getError()) {
-    error("cannot open " + path + ": " + ec.message());
-    return None;
-  }
+  MemoryBufferRef mbref;
+  if (inputCacheEnabled) {
+    // The link server keeps the file in memory for later links.
+    ErrorOr<MemoryBufferRef> mbOrErr = readCachedInput(path);
+    if (auto ec = mbOrErr.getError()) {
+      error("cannot open " + path + ": " + ec.message());
+      return None;
+    }
+    mbref = *mbOrErr;
+  } else {
+    Optional<ErrorOr<std::unique_ptr<MemoryBuffer>>> preloaded =
+        takePreloadedInput(path);
+    auto mbOrErr = preloaded ? std::move(*preloaded)
+                             : MemoryBuffer::getFile(path, -1, false);
+    if (auto ec = mbOrErr.getError()) {
+      error("cannot open " + path + ": " + ec.message());
+      return None;
+    }
 
-  std::unique_ptr<MemoryBuffer> &mb = *mbOrErr;
-  MemoryBufferRef mbref = mb->getMemBufferRef();
-  make<std::unique_ptr<MemoryBuffer>>(std::move(mb)); // take MB ownership
+    std::unique_ptr<MemoryBuffer> &mb = *mbOrErr;
+    mbref = mb->getMemBufferRef();
+    addMappedInput(*mb);
+    make<std::unique_ptr<MemoryBuffer>>(std::move(mb)); // take MB ownership
+  }
 
+  if (config->incremental)
+    incrementalInputs.push_back({path, mbref});
+  if (!config->linkCacheDir.empty())
+    linkCacheInputs.push_back({path, mbref});
+  if (config->copyFileRange)
+    passThroughInputs.push_back({path, mbref});
+  prefetchInput(mbref);
   if (tar)
     tar->append(relativeToRoot(path), mbref.getBuffer());
   return mbref;
@@ -219,6 +250,72 @@ void parseFile(InputFile *file) {
   }
 }
 
+template <class ELFT> static void doPreparseFiles(ArrayRef<InputFile *> files) {
+  std::vector<ObjFile<ELFT> *> objs;
+  std::vector<BitcodeFile *> bitcode;
+  for (InputFile *f : files) {
+    if (f->ekind != config->ekind)
+      continue;
+    if (f->kind() == InputFile::ObjKind && !cast<ObjFile<ELFT>>(f)->justSymbols)
+      objs.push_back(cast<ObjFile<ELFT>>(f));
+    else if (auto *bc = dyn_cast<BitcodeFile>(f))
+      bitcode.push_back(bc);
+  }
+  parallelForEach(objs, [](ObjFile<ELFT> *f) { f->preparse(); });
+  parallelForEach(bitcode, [](BitcodeFile *f) { f->preparse(); });
+}
+
+void preparseFiles(ArrayRef<InputFile *> files) {
+  switch (config->ekind) {
+  case ELF32LEKind:
+    doPreparseFiles<ELF32LE>(files);
+    return;
+  case ELF32BEKind:
+    doPreparseFiles<ELF32BE>(files);
+    return;
+  case ELF64LEKind:
+    doPreparseFiles<ELF64LE>(files);
+    return;
+  case ELF64BEKind:
+    doPreparseFiles<ELF64BE>(files);
+    return;
+  default:
+    llvm_unreachable("unknown ELFT");
+  }
+}
+
+template <class ELFT> static void doInitializeLocalSymbols() {
+  // The symbols are allocated here because the allocator is not thread-safe.
+  std::vector<std::pair<ObjFile<ELFT> *, SymbolUnion *>> objs;
+  for (InputFile *f : objectFiles) {
+    auto *obj = cast<ObjFile<ELFT>>(f);
+    if (size_t n = obj->getNumDeferredLocals())
+      objs.push_back({obj, bAlloc.Allocate<SymbolUnion>(n)});
+  }
+  parallelForEach(objs, [](std::pair<ObjFile<ELFT> *, SymbolUnion *> &p) {
+    p.first->initializeLocalSymbols(p.second);
+  });
+}
+
+void initializeLocalSymbols() {
+  switch (config->ekind) {
+  case ELF32LEKind:
+    doInitializeLocalSymbols<ELF32LE>();
+    return;
+  case ELF32BEKind:
+    doInitializeLocalSymbols<ELF32BE>();
+    return;
+  case ELF64LEKind:
+    doInitializeLocalSymbols<ELF64LE>();
+    return;
+  case ELF64BEKind:
+    doInitializeLocalSymbols<ELF64BE>();
+    return;
+  default:
+    llvm_unreachable("unknown ELFT");
+  }
+}
+
 // Concatenates arguments to construct a string representing an error location.
 static std::string createFileLineMsg(StringRef path, unsigned line) {
   std::string filename = path::filename(path);
@@ -264,6 +361,11 @@ std::string InputFile::getSrcMsg(const Symbol &sym, InputSectionBase &sec,
 }
 
 template <class ELFT> void ObjFile<ELFT>::initializeDwarf() {
+  // Relocations in the debug sections refer to local symbols, and a
+  // diagnostic can ask for a line number while the files are being parsed.
+  if (deferLocals && !this->symbols.empty())
+    initializeLocalSymbols(bAlloc.Allocate<SymbolUnion>(this->firstGlobal));
+
   dwarf = make<DWARFCache>(std::make_unique<DWARFContext>(
       std::make_unique<LLDDwarfObj<ELFT>>(this)));
 }
@@ -390,6 +492,28 @@ template <class ELFT> void ObjFile<ELFT>::parse(bool ignoreComdats) {
   initializeSymbols();
 }
 
+// Computes the symbol table keys of the global symbols, which only depends on
+// this file. Local symbols have to point to sections, which parse() creates,
+// so they are deferred instead.
+template <class ELFT> void ObjFile<ELFT>::preparse() {
+  ArrayRef<Elf_Sym> eSyms = this->getELFSyms<ELFT>();
+  if (eSyms.empty())
+    return;
+
+  globalKeys.reserve(eSyms.size() - this->firstGlobal);
+  for (const Elf_Sym &eSym : eSyms.slice(this->firstGlobal)) {
+    Expected<StringRef> name = eSym.getName(this->stringTable);
+    if (!name) {
+      // initializeSymbols() reports the error.
+      consumeError(name.takeError());
+      globalKeys.clear();
+      break;
+    }
+    globalKeys.push_back(SymbolTable::getKey(*name));
+  }
+  deferLocals = true;
+}
+
 // Sections with SHT_GROUP and comdat bits define comdat section groups.
 // They are identified and deduplicated by group name. This function
 // returns a group name.
@@ -529,6 +653,9 @@ void ObjFile<ELFT>::initializeSections(bool ignoreComdats) {
         else if (config->icf == ICFLevel::Safe)
           warn(toString(this) + ": --icf=safe is incompatible with object "
                                 "files created using objcopy or ld -r");
+        else if (config->icf == ICFLevel::Data)
+          warn(toString(this) + ": --icf=data is incompatible with object "
+                                "files created using objcopy or ld -r");
       }
       this->sections[i] = &InputSection::discarded;
       continue;
@@ -985,49 +1112,44 @@ template <class ELFT> void ObjFile<ELFT>::initializeSymbols() {
 
   // Our symbol table may have already been partially initialized
   // because of LazyObjFile.
-  for (size_t i = 0, end = eSyms.size(); i != end; ++i)
-    if (!this->symbols[i] && eSyms[i].getBinding() != STB_LOCAL)
+  for (size_t i = 0, end = eSyms.size(); i != end; ++i) {
+    if (this->symbols[i] || eSyms[i].getBinding() == STB_LOCAL)
+      continue;
+    if (i >= this->firstGlobal && !globalKeys.empty())
+      this->symbols[i] = symtab->insert(globalKeys[i - this->firstGlobal]);
+    else
       this->symbols[i] =
           symtab->insert(CHECK(eSyms[i].getName(this->stringTable), this));
+  }
+  globalKeys = {};
 
   // Fill this->Symbols. A symbol is either local or global.
   for (size_t i = 0, end = eSyms.size(); i != end; ++i) {
     const Elf_Sym &eSym = eSyms[i];
+    uint8_t binding = eSym.getBinding();
+    if (binding == STB_LOCAL && deferLocals && i < this->firstGlobal)
+      continue;
 
     // Read symbol attributes.
     uint32_t secIdx = getSectionIndex(eSym);
     if (secIdx >= this->sections.size())
       fatal(toString(this) + ": invalid section index: " + Twine(secIdx));
 
-    InputSectionBase *sec = this->sections[secIdx];
-    uint8_t binding = eSym.getBinding();
-    uint8_t stOther = eSym.st_other;
-    uint8_t type = eSym.getType();
-    uint64_t value = eSym.st_value;
-    uint64_t size = eSym.st_size;
-    StringRefZ name = this->stringTable.data() + eSym.st_name;
-
     // Handle local symbols. Local symbols are not added to the symbol
     // table because they are not visible from other object files. We
     // allocate symbol instances and add their pointers to Symbols.
     if (binding == STB_LOCAL) {
-      if (eSym.getType() == STT_FILE)
-        sourceFile = CHECK(eSym.getName(this->stringTable), this);
-
-      if (this->stringTable.size() <= eSym.st_name)
-        fatal(toString(this) + ": invalid symbol name offset");
-
-      if (eSym.st_shndx == SHN_UNDEF)
-        this->symbols[i] = make<Undefined>(this, name, binding, stOther, type);
-      else if (sec == &InputSection::discarded)
-        this->symbols[i] = make<Undefined>(this, name, binding, stOther, type,
-                                           /*DiscardedSecIdx=*/secIdx);
-      else
-        this->symbols[i] =
-            make<Defined>(this, name, binding, stOther, type, value, size, sec);
+      initializeLocalSymbol(i, secIdx, nullptr);
       continue;
     }
 
+    InputSectionBase *sec = this->sections[secIdx];
+    uint8_t stOther = eSym.st_other;
+    uint8_t type = eSym.getType();
+    uint64_t value = eSym.st_value;
+    uint64_t size = eSym.st_size;
+    StringRefZ name = this->stringTable.data() + eSym.st_name;
+
     // Handle global undefined symbols.
     if (eSym.st_shndx == SHN_UNDEF) {
       this->symbols[i]->resolve(Undefined{this, name, binding, stOther, type});
@@ -1068,13 +1190,103 @@ template <class ELFT> void ObjFile<ELFT>::initializeSymbols() {
   }
 }
 
+// Constructs a symbol in Mem, or allocates it if Mem is null.
+template <class T, class... ArgT>
+static Symbol *newSymbol(SymbolUnion *mem, ArgT &&... arg) {
+  if (mem)
+    return new (mem) T(std::forward<ArgT>(arg)...);
+  return make<T>(std::forward<ArgT>(arg)...);
+}
+
+template <class ELFT>
+void ObjFile<ELFT>::initializeLocalSymbol(size_t i, uint32_t secIdx,
+                                          SymbolUnion *mem) {
+  const Elf_Sym &eSym = this->getELFSyms<ELFT>()[i];
+  if (eSym.getType() == STT_FILE)
+    sourceFile = CHECK(eSym.getName(this->stringTable), this);
+
+  if (this->stringTable.size() <= eSym.st_name)
+    fatal(toString(this) + ": invalid symbol name offset");
+
+  InputSectionBase *sec = this->sections[secIdx];
+  uint8_t binding = eSym.getBinding();
+  uint8_t stOther = eSym.st_other;
+  uint8_t type = eSym.getType();
+  StringRefZ name = this->stringTable.data() + eSym.st_name;
+
+  if (eSym.st_shndx == SHN_UNDEF)
+    this->symbols[i] =
+        newSymbol<Undefined>(mem, this, name, binding, stOther, type);
+  else if (sec == &InputSection::discarded)
+    this->symbols[i] = newSymbol<Undefined>(mem, this, name, binding, stOther,
+                                            type, /*DiscardedSecIdx=*/secIdx);
+  else
+    this->symbols[i] = newSymbol<Defined>(mem, this, name, binding, stOther,
+                                          type, eSym.st_value, eSym.st_size,
+                                          sec);
+}
+
+// Creates the local symbols that initializeSymbols() skipped. Mem has room
+// for all of them. This only reads this file, so files can be processed in
+// parallel once the global symbols have been resolved.
+template <class ELFT>
+void ObjFile<ELFT>::initializeLocalSymbols(SymbolUnion *mem) {
+  if (!deferLocals)
+    return;
+  deferLocals = false;
+
+  ArrayRef<Elf_Sym> eSyms = this->getELFSyms<ELFT>();
+  for (size_t i = 0, end = this->firstGlobal; i != end; ++i) {
+    if (eSyms[i].getBinding() != STB_LOCAL)
+      continue;
+    uint32_t secIdx = getSectionIndex(eSyms[i]);
+    if (secIdx >= this->sections.size())
+      fatal(toString(this) + ": invalid section index: " + Twine(secIdx));
+    initializeLocalSymbol(i, secIdx, &mem[i]);
+  }
+}
+
 ArchiveFile::ArchiveFile(std::unique_ptr<Archive> &&file)
     : InputFile(ArchiveKind, file->getMemoryBufferRef()),
       file(std::move(file)) {}
 
 void ArchiveFile::parse() {
-  for (const Archive::Symbol &sym : file->symbols())
-    symtab->addSymbol(LazyArchive{*this, sym});
+  if (config->archiveCacheDir.empty()) {
+    for (const Archive::Symbol &sym : file->symbols())
+      symtab->addSymbol(LazyArchive{*this, sym});
+    return;
+  }
+
+  // With --archive-cache-dir, the names of the symbols and their hashes may
+  // be read from the cache.
+  StringRef symTab = file->getSymbolTable();
+  Optional<ArrayRef<ArchiveCacheSymbol>> cached = readArchiveCache(mb, symTab);
+  if (cached && cached->size() == file->getNumberOfSymbols()) {
+    for (size_t i = 0, e = cached->size(); i != e; ++i) {
+      const ArchiveCacheSymbol &s = (*cached)[i];
+      StringRef name(symTab.data() + s.nameOffset, s.nameSize);
+      Symbol *sym = symtab->insert(
+          CachedHashStringRef(name.take_front(s.keySize), s.keyHash));
+      Archive::Symbol archiveSym(file.get(), i, s.nameOffset);
+      sym->resolve(LazyArchive{*this, archiveSym, name});
+    }
+    return;
+  }
+
+  std::vector<ArchiveCacheSymbol> syms;
+  for (const Archive::Symbol &sym : file->symbols()) {
+    StringRef name = sym.getName();
+    CachedHashStringRef key = SymbolTable::getKey(name);
+    symtab->insert(key)->resolve(LazyArchive{*this, sym, name});
+
+    ArchiveCacheSymbol s;
+    s.nameOffset = name.data() - symTab.data();
+    s.nameSize = name.size();
+    s.keySize = key.size();
+    s.keyHash = key.hash();
+    syms.push_back(s);
+  }
+  writeArchiveCache(mb, symTab, syms);
 }
 
 // Returns a buffer pointing to a member file containing a given symbol.
@@ -1148,6 +1360,32 @@ static uint64_t getAlignment(ArrayRef<typename ELFT::Shdr> sections,
   return (ret > UINT32_MAX) ? 0 : ret;
 }
 
+// The hash function of .gnu.hash.
+static uint32_t hashGnu(StringRef name) {
+  uint32_t h = 5381;
+  for (uint8_t c : name)
+    h = (h << 5) + h + c;
+  return h;
+}
+
+// Returns true if a .gnu.hash section is large enough for its header and
+// covers only symbols in the symbol table.
+template <class ELFT>
+static bool isValidGnuHash(ArrayRef<uint8_t> data, size_t numSyms) {
+  using Elf_Word = typename ELFT::Word;
+  if (data.size() < 4 * sizeof(Elf_Word))
+    return false;
+  const Elf_Word *hdr = reinterpret_cast<const Elf_Word *>(data.data());
+  uint32_t nBuckets = hdr[0], symOffset = hdr[1], maskWords = hdr[2];
+  if (nBuckets == 0 || maskWords == 0 || symOffset == 0 ||
+      symOffset > numSyms)
+    return false;
+  uint64_t size = 4 * sizeof(Elf_Word) +
+                  uint64_t(maskWords) * sizeof(typename ELFT::Off) +
+                  (uint64_t(nBuckets) + numSyms - symOffset) * sizeof(Elf_Word);
+  return size <= data.size();
+}
+
 // Fully parse the shared object file.
 //
 // This function parses symbol versions. If a DSO has version information,
@@ -1169,6 +1407,7 @@ template <class ELFT> void SharedFile::parse() {
   using Elf_Sym = typename ELFT::Sym;
   using Elf_Verdef = typename ELFT::Verdef;
   using Elf_Versym = typename ELFT::Versym;
+  using Elf_Word = typename ELFT::Word;
 
   ArrayRef<Elf_Dyn> dynamicTags;
   const ELFFile<ELFT> obj = this->getObj<ELFT>();
@@ -1176,8 +1415,10 @@ template <class ELFT> void SharedFile::parse() {
 
   const Elf_Shdr *versymSec = nullptr;
   const Elf_Shdr *verdefSec = nullptr;
+  const Elf_Shdr *gnuHashSec = nullptr;
 
-  // Search for .dynsym, .dynamic, .symtab, .gnu.version and .gnu.version_d.
+  // Search for .dynsym, .dynamic, .symtab, .gnu.version, .gnu.version_d and
+  // .gnu.hash.
   for (const Elf_Shdr &sec : sections) {
     switch (sec.sh_type) {
     default:
@@ -1192,6 +1433,9 @@ template <class ELFT> void SharedFile::parse() {
     case SHT_GNU_verdef:
       verdefSec = &sec;
       break;
+    case SHT_GNU_HASH:
+      gnuHashSec = &sec;
+      break;
     }
   }
 
@@ -1240,12 +1484,26 @@ template <class ELFT> void SharedFile::parse() {
   if (versymSec) {
     ArrayRef<Elf_Versym> versym =
         CHECK(obj.template getSectionContentsAsArray<Elf_Versym>(versymSec),
-              this)
-            .slice(firstGlobal);
+              this);
+    if (versym.size() >= numELFSyms)
+      versymData = versym.data();
+    versym = versym.slice(firstGlobal);
     for (size_t i = 0; i < size; ++i)
       versyms[i] = versym[i].vs_index;
   }
 
+  // With --lazy-shared-symbols, the symbols that the .gnu.hash table covers
+  // are added to the symbol table only when they are referenced.
+  uint32_t lazyBegin = numELFSyms;
+  if (config->lazySharedSymbols && gnuHashSec && (!versymSec || versymData)) {
+    ArrayRef<uint8_t> data = CHECK(obj.getSectionContents(gnuHashSec), this);
+    if (isValidGnuHash<ELFT>(data, numELFSyms)) {
+      gnuHash = data.data();
+      lazyBegin = std::max<uint32_t>(
+          firstGlobal, reinterpret_cast<const Elf_Word *>(gnuHash)[1]);
+    }
+  }
+
   // System libraries can have a lot of symbols with versions. Using a
   // fixed buffer for computing the versions name (foo@ver) can save a
   // lot of allocations.
@@ -1282,8 +1540,9 @@ template <class ELFT> void SharedFile::parse() {
         name == "_gp_disp")
       continue;
 
+    bool isLazy = firstGlobal + i >= lazyBegin;
     uint32_t alignment = getAlignment<ELFT>(sections, sym);
-    if (!(versyms[i] & VERSYM_HIDDEN)) {
+    if (!isLazy && !(versyms[i] & VERSYM_HIDDEN)) {
       symtab->addSymbol(SharedSymbol{*this, name, sym.getBinding(),
                                      sym.st_other, sym.getType(), sym.st_value,
                                      sym.st_size, alignment, idx});
@@ -1300,6 +1559,8 @@ template <class ELFT> void SharedFile::parse() {
             toString(this));
       continue;
     }
+    if (isLazy)
+      continue;
 
     StringRef verName =
         this->stringTable.data() +
@@ -1310,6 +1571,167 @@ template <class ELFT> void SharedFile::parse() {
                                    sym.st_other, sym.getType(), sym.st_value,
                                    sym.st_size, alignment, idx});
   }
+
+  if (gnuHash)
+    symtab->addLazySharedFile(this);
+}
+
+// Looks up a name in .gnu.hash and returns the index of the dynamic symbol
+// that parse() would have added to the symbol table with that name, or 0.
+template <class ELFT> uint32_t SharedFile::findLazy(StringRef name) {
+  using Elf_Off = typename ELFT::Off;
+  using Elf_Sym = typename ELFT::Sym;
+  using Elf_Verdef = typename ELFT::Verdef;
+  using Elf_Versym = typename ELFT::Versym;
+  using Elf_Word = typename ELFT::Word;
+
+  // parse() adds foo@ver for each symbol foo of the non-global version ver,
+  // but never foo@@ver.
+  StringRef verName;
+  size_t pos = name.find('@');
+  if (pos != StringRef::npos) {
+    verName = name.substr(pos + 1);
+    name = name.substr(0, pos);
+    if (verName.empty() || verName[0] == '@')
+      return 0;
+  }
+
+  const Elf_Word *hdr = reinterpret_cast<const Elf_Word *>(gnuHash);
+  uint32_t nBuckets = hdr[0], symOffset = hdr[1], maskWords = hdr[2];
+  uint32_t shift2 = hdr[3];
+  const Elf_Off *bloom = reinterpret_cast<const Elf_Off *>(hdr + 4);
+  const Elf_Word *buckets =
+      reinterpret_cast<const Elf_Word *>(bloom + maskWords);
+  const Elf_Word *chains = buckets + nBuckets;
+
+  uint32_t hash = hashGnu(name);
+  const unsigned c = sizeof(Elf_Off) * 8;
+  uint64_t word = bloom[(hash / c) % maskWords];
+  uint64_t mask = (uint64_t(1) << (hash % c)) |
+                  (uint64_t(1) << ((hash >> shift2) % c));
+  if ((word & mask) != mask)
+    return 0;
+
+  ArrayRef<Elf_Sym> syms = getELFSyms<ELFT>();
+  const Elf_Versym *versyms = reinterpret_cast<const Elf_Versym *>(versymData);
+
+  // This mirrors the checks in parse().
+  auto isMatch = [&](uint32_t i) {
+    const Elf_Sym &sym = syms[i];
+    if (i < firstGlobal || sym.isUndefined() || sym.getBinding() == STB_LOCAL ||
+        CHECK(sym.getName(stringTable), this) != name)
+      return false;
+
+    uint32_t versym = versyms ? versyms[i].vs_index : VER_NDX_GLOBAL;
+    uint32_t idx = versym & ~VERSYM_HIDDEN;
+    if (config->emachine == EM_MIPS && idx == VER_NDX_LOCAL &&
+        name == "_gp_disp")
+      return false;
+    if (verName.empty())
+      return !(versym & VERSYM_HIDDEN);
+    if (idx == VER_NDX_GLOBAL || idx == VER_NDX_LOCAL || idx >= verdefs.size())
+      return false;
+    const auto *verdef = reinterpret_cast<const Elf_Verdef *>(verdefs[idx]);
+    return stringTable.data() + verdef->getAux()->vda_name == verName;
+  };
+
+  // The symbols of a hash chain are in the order of the symbol table, so the
+  // first match is the one that parse() would have added first.
+  for (uint32_t i = buckets[hash % nBuckets];
+       i >= symOffset && i < syms.size(); ++i) {
+    uint32_t chain = chains[i - symOffset];
+    if ((chain | 1) == (hash | 1) && isMatch(i))
+      return i;
+    if (chain & 1)
+      break;
+  }
+  return 0;
+}
+
+// Resolves a symbol with the dynamic symbol at index i, which findLazy()
+// returned for its name.
+template <class ELFT> void SharedFile::addLazy(Symbol *sym, uint32_t i) {
+  using Elf_Versym = typename ELFT::Versym;
+  const ELFFile<ELFT> obj = this->getObj<ELFT>();
+  const typename ELFT::Sym &esym = getELFSyms<ELFT>()[i];
+  const Elf_Versym *versyms = reinterpret_cast<const Elf_Versym *>(versymData);
+  uint32_t idx =
+      versyms ? versyms[i].vs_index & ~VERSYM_HIDDEN : VER_NDX_GLOBAL;
+  uint32_t alignment =
+      getAlignment<ELFT>(CHECK(obj.sections(), this), esym);
+  sym->resolve(SharedSymbol{*this, sym->getName(), esym.getBinding(),
+                            esym.st_other, esym.getType(), esym.st_value,
+                            esym.st_size, alignment, idx});
+
+  // The symbol may be added after the preemptibility of all symbols has been
+  // computed, which is always true for shared symbols.
+  if (sym->isShared())
+    sym->isPreemptible = true;
+}
+
+uint32_t SharedFile::findLazySymbol(StringRef name) {
+  switch (config->ekind) {
+  default:
+    llvm_unreachable("Invalid kind");
+  case ELF32LEKind:
+    return findLazy<ELF32LE>(name);
+  case ELF32BEKind:
+    return findLazy<ELF32BE>(name);
+  case ELF64LEKind:
+    return findLazy<ELF64LE>(name);
+  case ELF64BEKind:
+    return findLazy<ELF64BE>(name);
+  }
+}
+
+void SharedFile::addLazySymbol(Symbol *sym, uint32_t i) {
+  switch (config->ekind) {
+  default:
+    llvm_unreachable("Invalid kind");
+  case ELF32LEKind:
+    return addLazy<ELF32LE>(sym, i);
+  case ELF32BEKind:
+    return addLazy<ELF32BE>(sym, i);
+  case ELF64LEKind:
+    return addLazy<ELF64LE>(sym, i);
+  case ELF64BEKind:
+    return addLazy<ELF64BE>(sym, i);
+  }
+}
+
+template <class ELFT> void SharedFile::buildAddressIndex() {
+  using Elf_Sym = typename ELFT::Sym;
+
+  ArrayRef<Elf_Sym> syms = getGlobalELFSyms<ELFT>();
+  std::vector<std::pair<uint64_t, uint32_t>> v;
+  for (size_t i = 0, e = syms.size(); i != e; ++i) {
+    const Elf_Sym &s = syms[i];
+    if (s.st_shndx == SHN_UNDEF || s.st_shndx == SHN_ABS ||
+        s.getType() == STT_TLS)
+      continue;
+    v.push_back({s.st_value, i});
+  }
+  parallelSort(v.begin(), v.end());
+
+  addressSyms.resize(v.size());
+  for (size_t i = 0, e = v.size(); i != e;) {
+    size_t j = i;
+    for (; j != e && v[j].first == v[i].first; ++j)
+      addressSyms[j] = v[j].second;
+    addressIndex[v[i].first] = {i, j - i};
+    i = j;
+  }
+  addressIndexBuilt = true;
+}
+
+template <class ELFT>
+ArrayRef<uint32_t> SharedFile::getSymbolsAt(uint64_t value) {
+  if (!addressIndexBuilt)
+    buildAddressIndex<ELFT>();
+  auto it = addressIndex.find(value);
+  if (it == addressIndex.end())
+    return {};
+  return makeArrayRef(addressSyms).slice(it->second.first, it->second.second);
 }
 
 static ELFKind getBitcodeELFKind(const Triple &t) {
@@ -1375,15 +1797,19 @@ BitcodeFile::BitcodeFile(MemoryBufferRef mb, StringRef archiveName,
                        ? saver.save(path)
                        : saver.save(archiveName + "(" + path + " at " +
                                     utostr(offsetInArchive) + ")");
-  MemoryBufferRef mbref(mb.getBuffer(), name);
+  ltoBuffer = MemoryBufferRef(mb.getBuffer(), name);
 
-  obj = CHECK(lto::InputFile::create(mbref), this);
-
-  Triple t(obj->getTargetTriple());
+  // Only the target triple is read here. The symbol table is read later by
+  // preparse(), in parallel with other files.
+  Triple t(CHECK(getBitcodeTargetTriple(ltoBuffer), this));
   ekind = getBitcodeELFKind(t);
   emachine = getBitcodeMachineKind(mb.getBufferIdentifier(), t);
 }
 
+void BitcodeFile::preparse() {
+  obj = CHECK(lto::InputFile::create(ltoBuffer), this);
+}
+
 static uint8_t mapVisibility(GlobalValue::VisibilityTypes gvVisibility) {
   switch (gvVisibility) {
   case GlobalValue::DefaultVisibility:
@@ -1428,6 +1854,10 @@ static Symbol *createBitcodeSymbol(const std::vector<bool> &keptComdats,
 }
 
 template <class ELFT> void BitcodeFile::parse() {
+  // Archive members and files added by autolinking were not preparsed.
+  if (!obj)
+    preparse();
+
   std::vector<bool> keptComdats;
   for (StringRef s : obj->getComdatTable())
     keptComdats.push_back(
@@ -1584,5 +2014,10 @@ template void SharedFile::parse<ELF32BE>();
 template void SharedFile::parse<ELF64LE>();
 template void SharedFile::parse<ELF64BE>();
 
+template ArrayRef<uint32_t> SharedFile::getSymbolsAt<ELF32LE>(uint64_t);
+template ArrayRef<uint32_t> SharedFile::getSymbolsAt<ELF32BE>(uint64_t);
+template ArrayRef<uint32_t> SharedFile::getSymbolsAt<ELF64LE>(uint64_t);
+template ArrayRef<uint32_t> SharedFile::getSymbolsAt<ELF64BE>(uint64_t);
+
 } // namespace elf
 } // namespace lld
@@ -15,6 +15,7 @@
 #include "lld/Common/LLVM.h"
 #include "lld/Common/Reproduce.h"
 #include "llvm/ADT/CachedHashString.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/Comdat.h"
@@ -25,7 +26,6 @@
 #include <map>
 
 namespace llvm {
-class TarWriter;
 namespace lto {
 class InputFile;
 }
@@ -43,10 +43,11 @@ class InputSectionBase;
 using llvm::object::Archive;
 
 class Symbol;
+union SymbolUnion;
 
 // If -reproduce option is given, all input files are written
 // to this tar archive.
-extern std::unique_ptr<llvm::TarWriter> tar;
+extern std::unique_ptr<AsyncTarWriter> tar;
 
 // Opens a given file.
 llvm::Optional<MemoryBufferRef> readFile(StringRef path);
@@ -54,6 +55,15 @@ llvm::Optional<MemoryBufferRef> readFile(StringRef path);
 // Add symbols in File to the symbol table.
 void parseFile(InputFile *file);
 
+// Reads ahead, in parallel, the parts of the regular object files in Files
+// that parseFile does not need to do in order, and makes parseFile leave
+// their local symbols to initializeLocalSymbols. The symbol tables of the
+// bitcode files in Files are read ahead as well.
+void preparseFiles(ArrayRef<InputFile *> files);
+
+// Creates, in parallel, the local symbols that were left by parseFile.
+void initializeLocalSymbols();
+
 // The root class of input files.
 class InputFile {
 public:
@@ -169,6 +179,10 @@ public:
     return getELFSyms<ELFT>().slice(firstGlobal);
   }
 
+  // For -r and --emit-relocs, the indices of this file's symbols in the
+  // output symbol table. See SymbolTableBaseSection::initFileSymbolIndices.
+  std::vector<uint32_t> symtabIndices;
+
 protected:
   // Initializes this class's member variables.
   template <typename ELFT> void init();
@@ -204,6 +218,13 @@ public:
 
   void parse(bool ignoreComdats = false);
 
+  // See preparseFiles and initializeLocalSymbols.
+  void preparse();
+  void initializeLocalSymbols(SymbolUnion *mem);
+  size_t getNumDeferredLocals() const {
+    return deferLocals ? this->firstGlobal : 0;
+  }
+
   StringRef getShtGroupSignature(ArrayRef<Elf_Shdr> sections,
                                  const Elf_Shdr &sec);
 
@@ -252,6 +273,7 @@ public:
 private:
   void initializeSections(bool ignoreComdats);
   void initializeSymbols();
+  void initializeLocalSymbol(size_t i, uint32_t secIdx, SymbolUnion *mem);
   void initializeJustSymbols();
   void initializeDwarf();
   InputSectionBase *getRelocTarget(const Elf_Shdr &sec);
@@ -283,6 +305,13 @@ private:
   // parse it only once for each object file we link.
   DWARFCache *dwarf;
   llvm::once_flag initDwarfLine;
+
+  // The symbol table keys of the global symbols, read by preparse().
+  std::vector<llvm::CachedHashStringRef> globalKeys;
+
+  // True if the local symbols are yet to be created by
+  // initializeLocalSymbols().
+  bool deferLocals = false;
 };
 
 // LazyObjFile is analogous to ArchiveFile in the sense that
@@ -333,7 +362,16 @@ public:
               uint64_t offsetInArchive);
   static bool classof(const InputFile *f) { return f->kind() == BitcodeKind; }
   template <class ELFT> void parse();
+
+  // Reads the symbol table of the module, which is the expensive part of
+  // adding a bitcode file. See preparseFiles.
+  void preparse();
+
   std::unique_ptr<llvm::lto::InputFile> obj;
+
+private:
+  // The buffer under the unique name that LTO knows this file by.
+  MemoryBufferRef ltoBuffer;
 };
 
 // .so file.
@@ -360,11 +398,42 @@ public:
 
   template <typename ELFT> void parse();
 
+  // With --lazy-shared-symbols, the defined symbols in .gnu.hash are not
+  // added to the symbol table by parse(). Instead, findLazySymbol() looks up
+  // a name in .gnu.hash and returns the index of the dynamic symbol that
+  // parse() would have added with that name, or 0, and addLazySymbol()
+  // resolves a symbol with it.
+  uint32_t findLazySymbol(StringRef name);
+  void addLazySymbol(Symbol *sym, uint32_t i);
+
+  // Returns the indices into getGlobalELFSyms() of the non-TLS symbols that
+  // this file defines at a given address. Used to find the aliases of a
+  // symbol that is copy relocated. The index is built on first use.
+  template <typename ELFT> ArrayRef<uint32_t> getSymbolsAt(uint64_t value);
+
   // Used for --no-allow-shlib-undefined.
   bool allNeededIsKnown;
 
   // Used for --as-needed
   bool isNeeded;
+
+private:
+  template <typename ELFT> uint32_t findLazy(StringRef name);
+  template <typename ELFT> void addLazy(Symbol *sym, uint32_t i);
+  template <typename ELFT> void buildAddressIndex();
+
+  // The contents of .gnu.hash if this file's symbols are added lazily.
+  const uint8_t *gnuHash = nullptr;
+
+  // The contents of .gnu.version, if it exists and is large enough.
+  const void *versymData = nullptr;
+
+  // The address index for getSymbolsAt(). Symbols at the same address are
+  // contiguous in addressSyms, and addressIndex maps an address to the
+  // start and length of its run.
+  std::vector<uint32_t> addressSyms;
+  llvm::DenseMap<uint64_t, std::pair<uint32_t, uint32_t>> addressIndex;
+  bool addressIndexBuilt = false;
 };
 
 class BinaryFile : public InputFile {
@@ -20,6 +20,7 @@
 #include "Thunks.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Endian.h"
@@ -138,7 +139,7 @@ size_t InputSectionBase::getSize() const {
     return s->getSize();
   if (uncompressedSize >= 0)
     return uncompressedSize;
-  return rawData.size();
+  return rawData.size() - bytesDropped;
 }
 
 void InputSectionBase::uncompress() const {
@@ -408,10 +409,10 @@ InputSectionBase *InputSection::getRelocatedSection() const {
 template <class ELFT, class RelTy>
 void InputSection::copyRelocations(uint8_t *buf, ArrayRef<RelTy> rels) {
   InputSectionBase *sec = getRelocatedSection();
+  const ObjFile<ELFT> *file = getFile<ELFT>();
 
   for (const RelTy &rel : rels) {
     RelType type = rel.getType(config->isMips64EL);
-    const ObjFile<ELFT> *file = getFile<ELFT>();
     Symbol &sym = file->getRelocTargetSym(rel);
 
     auto *p = reinterpret_cast<typename ELFT::Rela *>(buf);
@@ -423,8 +424,9 @@ void InputSection::copyRelocations(uint8_t *buf, ArrayRef<RelTy> rels) {
     // Output section VA is zero for -r, so r_offset is an offset within the
     // section, but for --emit-relocs it is an virtual address.
     p->r_offset = sec->getVA(rel.r_offset);
-    p->setSymbolAndType(in.symTab->getSymbolIndex(&sym), type,
-                        config->isMips64EL);
+    p->setSymbolAndType(
+        file->symtabIndices[rel.getSymbol(config->isMips64EL)], type,
+        config->isMips64EL);
 
     if (sym.type == STT_SECTION) {
       // We combine multiple section symbols into only one per
@@ -645,10 +647,11 @@ static int64_t getTlsTpOffset(const Symbol &s) {
   }
 }
 
-static uint64_t getRelocTargetVA(const InputFile *file, RelType type, int64_t a,
-                                 uint64_t p, const Symbol &sym, RelExpr expr) {
+uint64_t getRelocTargetVA(const InputFile *file, RelType type, int64_t a,
+                          uint64_t p, const Symbol &sym, RelExpr expr) {
   switch (expr) {
   case R_ABS:
+  case R_AARCH64_RELAX_GOT:
   case R_DTPREL:
   case R_RELAX_TLS_LD_TO_LE_ABS:
   case R_RELAX_GOT_PC_NOPIC:
@@ -919,70 +922,70 @@ void InputSectionBase::relocate(uint8_t *buf, uint8_t *bufEnd) {
 }
 
 void InputSectionBase::relocateAlloc(uint8_t *buf, uint8_t *bufEnd) {
-  assert(flags & SHF_ALLOC);
-  const unsigned bits = config->wordsize * 8;
+  target->relocateAlloc(*this, buf, bufEnd);
+  if (jumpInstrMods.empty())
+    return;
+  uint64_t outSecOff = 0;
+  if (auto *sec = dyn_cast<InputSection>(this))
+    outSecOff = sec->outSecOff;
+  for (const JumpInstrMod &mod : jumpInstrMods)
+    target->applyJumpInstrMod(buf + outSecOff + mod.offset, mod.type,
+                              mod.size);
+}
 
-  for (const Relocation &rel : relocations) {
-    uint64_t offset = rel.offset;
-    if (auto *sec = dyn_cast<InputSection>(this))
-      offset += sec->outSecOff;
-    uint8_t *bufLoc = buf + offset;
-    RelType type = rel.type;
-
-    uint64_t addrLoc = getOutputSection()->addr + offset;
-    RelExpr expr = rel.expr;
-    uint64_t targetVA = SignExtend64(
-        getRelocTargetVA(file, type, rel.addend, addrLoc, *rel.sym, expr),
-        bits);
-
-    switch (expr) {
-    case R_RELAX_GOT_PC:
-    case R_RELAX_GOT_PC_NOPIC:
-      target->relaxGot(bufLoc, type, targetVA);
-      break;
-    case R_PPC64_RELAX_TOC:
-      if (!tryRelaxPPC64TocIndirection(type, rel, bufLoc))
-        target->relocateOne(bufLoc, type, targetVA);
-      break;
-    case R_RELAX_TLS_IE_TO_LE:
-      target->relaxTlsIeToLe(bufLoc, type, targetVA);
-      break;
-    case R_RELAX_TLS_LD_TO_LE:
-    case R_RELAX_TLS_LD_TO_LE_ABS:
-      target->relaxTlsLdToLe(bufLoc, type, targetVA);
-      break;
-    case R_RELAX_TLS_GD_TO_LE:
-    case R_RELAX_TLS_GD_TO_LE_NEG:
-      target->relaxTlsGdToLe(bufLoc, type, targetVA);
-      break;
-    case R_AARCH64_RELAX_TLS_GD_TO_IE_PAGE_PC:
-    case R_RELAX_TLS_GD_TO_IE:
-    case R_RELAX_TLS_GD_TO_IE_ABS:
-    case R_RELAX_TLS_GD_TO_IE_GOT_OFF:
-    case R_RELAX_TLS_GD_TO_IE_GOTPLT:
-      target->relaxTlsGdToIe(bufLoc, type, targetVA);
+void InputSectionBase::relocateAllocSpecial(const Relocation &rel,
+                                            uint8_t *bufLoc, uint8_t *bufEnd,
+                                            uint64_t targetVA) {
+  RelType type = rel.type;
+  switch (rel.expr) {
+  case R_RELAX_GOT_PC:
+  case R_RELAX_GOT_PC_NOPIC:
+    target->relaxGot(bufLoc, type, targetVA);
+    break;
+  case R_PPC64_RELAX_TOC:
+    if (!tryRelaxPPC64TocIndirection(type, rel, bufLoc))
+      target->relocateOne(bufLoc, type, targetVA);
+    break;
+  case R_AARCH64_RELAX_GOT:
+    relaxAArch64GotLoad(bufLoc, getVA(rel.offset), targetVA);
+    break;
+  case R_RELAX_TLS_IE_TO_LE:
+    target->relaxTlsIeToLe(bufLoc, type, targetVA);
+    break;
+  case R_RELAX_TLS_LD_TO_LE:
+  case R_RELAX_TLS_LD_TO_LE_ABS:
+    target->relaxTlsLdToLe(bufLoc, type, targetVA);
+    break;
+  case R_RELAX_TLS_GD_TO_LE:
+  case R_RELAX_TLS_GD_TO_LE_NEG:
+    target->relaxTlsGdToLe(bufLoc, type, targetVA);
+    break;
+  case R_AARCH64_RELAX_TLS_GD_TO_IE_PAGE_PC:
+  case R_RELAX_TLS_GD_TO_IE:
+  case R_RELAX_TLS_GD_TO_IE_ABS:
+  case R_RELAX_TLS_GD_TO_IE_GOT_OFF:
+  case R_RELAX_TLS_GD_TO_IE_GOTPLT:
+    target->relaxTlsGdToIe(bufLoc, type, targetVA);
+    break;
+  case R_PPC64_CALL:
+    // If this is a call to __tls_get_addr, it may be part of a TLS
+    // sequence that has been relaxed and turned into a nop. In this
+    // case, we don't want to handle it as a call.
+    if (read32(bufLoc) == 0x60000000) // nop
       break;
-    case R_PPC64_CALL:
-      // If this is a call to __tls_get_addr, it may be part of a TLS
-      // sequence that has been relaxed and turned into a nop. In this
-      // case, we don't want to handle it as a call.
-      if (read32(bufLoc) == 0x60000000) // nop
-        break;
 
-      // Patch a nop (0x60000000) to a ld.
-      if (rel.sym->needsTocRestore) {
-        if (bufLoc + 8 > bufEnd || read32(bufLoc + 4) != 0x60000000) {
-          error(getErrorLocation(bufLoc) + "call lacks nop, can't restore toc");
-          break;
-        }
-        write32(bufLoc + 4, 0xe8410018); // ld %r2, 24(%r1)
+    // Patch a nop (0x60000000) to a ld.
+    if (rel.sym->needsTocRestore) {
+      if (bufLoc + 8 > bufEnd || read32(bufLoc + 4) != 0x60000000) {
+        error(getErrorLocation(bufLoc) + "call lacks nop, can't restore toc");
+        break;
       }
-      target->relocateOne(bufLoc, type, targetVA);
-      break;
-    default:
-      target->relocateOne(bufLoc, type, targetVA);
-      break;
+      write32(bufLoc + 4, 0xe8410018); // ld %r2, 24(%r1)
     }
+    target->relocateOne(bufLoc, type, targetVA);
+    break;
+  default:
+    llvm_unreachable("not a special relocation expression");
   }
 }
 
@@ -1130,6 +1133,11 @@ template <class ELFT> void InputSection::writeTo(uint8_t *buf) {
     return;
   }
 
+  // Sections selected by selectPassThroughSections() need no relocation
+  // and are copied to the output file later.
+  if (passThrough)
+    return;
+
   // Copy section contents from source object file to output file
   // and then apply relocations.
   memcpy(buf + outSecOff, data().data(), data().size());
@@ -1137,6 +1145,83 @@ template <class ELFT> void InputSection::writeTo(uint8_t *buf) {
   relocate<ELFT>(buf, bufEnd);
 }
 
+bool InputSection::canSplitWrite() const {
+  return kind() == Regular && !isCompressed() && !passThrough &&
+         type != SHT_NOBITS && type != SHT_REL && type != SHT_RELA &&
+         type != SHT_GROUP;
+}
+
+void InputSection::copyContents(uint8_t *buf, uint64_t begin, uint64_t end) {
+  memcpy(buf + outSecOff + begin, data().data() + begin, end - begin);
+}
+
+// Relocations that are applied to overlapping locations, such as pairs of
+// R_RISCV_ADD and R_RISCV_SUB, must be applied by the same thread. So the
+// beginning of a shard is moved forward to a relocation that is at least
+// 8 bytes, the size of the largest field that is relocated, after the
+// previous one. This needs the relocations to be sorted by offset.
+template <class RelTy>
+static size_t getShardBegin(ArrayRef<RelTy> rels, size_t shard,
+                            size_t numShards) {
+  size_t i = rels.size() * shard / numShards;
+  if (i == 0)
+    return 0;
+  while (i < rels.size() && rels[i].r_offset < rels[i - 1].r_offset + 8)
+    ++i;
+  return i;
+}
+
+template <class RelTy>
+static ArrayRef<RelTy> getShard(ArrayRef<RelTy> rels, size_t shard,
+                                size_t numShards) {
+  size_t begin = getShardBegin(rels, shard, numShards);
+  size_t end = getShardBegin(rels, shard + 1, numShards);
+  return rels.slice(begin, end - begin);
+}
+
+template <class RelTy>
+static size_t getNumShards(ArrayRef<RelTy> rels, size_t maxShards) {
+  // Don't bother splitting a few relocations.
+  size_t numShards = std::min(maxShards, rels.size() / 4096);
+  if (numShards <= 1)
+    return 1;
+
+  // Compilers emit relocations sorted by offset, but that is not required.
+  std::vector<uint8_t> sorted(numShards);
+  parallelForEachN(0, numShards, [&](size_t i) {
+    size_t begin = std::max<size_t>(rels.size() * i / numShards, 1);
+    size_t end = rels.size() * (i + 1) / numShards;
+    sorted[i] = std::is_sorted(rels.begin() + begin - 1, rels.begin() + end,
+                               [](const RelTy &a, const RelTy &b) {
+                                 return a.r_offset < b.r_offset;
+                               });
+  });
+  return llvm::all_of(sorted, [](uint8_t b) { return b; }) ? numShards : 1;
+}
+
+// Relocations in allocated sections may be relaxed together with the
+// instructions around them, so they are applied by one thread. This must
+// not be called from a parallel loop.
+template <class ELFT>
+size_t InputSection::getNumRelocShards(size_t maxShards) {
+  if ((flags & SHF_ALLOC) || config->relocatable)
+    return 1;
+  if (areRelocsRela)
+    return getNumShards(relas<ELFT>(), maxShards);
+  return getNumShards(rels<ELFT>(), maxShards);
+}
+
+template <class ELFT>
+void InputSection::relocateShard(uint8_t *buf, size_t shard,
+                                 size_t numShards) {
+  if (numShards == 1)
+    relocate<ELFT>(buf, buf + outSecOff + data().size());
+  else if (areRelocsRela)
+    relocateNonAlloc<ELFT>(buf, getShard(relas<ELFT>(), shard, numShards));
+  else
+    relocateNonAlloc<ELFT>(buf, getShard(rels<ELFT>(), shard, numShards));
+}
+
 void InputSection::replace(InputSection *other) {
   alignment = std::max(alignment, other->alignment);
 
@@ -1210,7 +1295,23 @@ static size_t findNull(StringRef s, size_t entSize) {
   if (entSize == 1)
     return s.find(0);
 
-  for (unsigned i = 0, n = s.size(); i != n; i += entSize) {
+  // For UTF-16 and UTF-32 strings, test the characters in 8 bytes at once.
+  // In (v - lo) & ~v & hi, the top bit of a character is set if it is zero.
+  // Characters after the first zero one may be set too because of borrows,
+  // but the lowest set one is exact.
+  size_t i = 0;
+  size_t n = s.size();
+  if (entSize == 2 || entSize == 4) {
+    uint64_t lo = entSize == 2 ? 0x0001000100010001 : 0x0000000100000001;
+    uint64_t hi = lo << (entSize * 8 - 1);
+    for (; i + 8 <= n; i += 8) {
+      uint64_t v = read64le(s.data() + i);
+      if (uint64_t m = (v - lo) & ~v & hi)
+        return i + countTrailingZeros(m) / 8 / entSize * entSize;
+    }
+  }
+
+  for (; i != n; i += entSize) {
     const char *b = s.begin() + i;
     if (std::all_of(b, b + entSize, [](char c) { return c == 0; }))
       return i;
@@ -1274,21 +1375,54 @@ MergeInputSection::MergeInputSection(uint64_t flags, uint32_t type,
 void MergeInputSection::splitIntoPieces() {
   assert(pieces.empty());
 
-  if (flags & SHF_STRINGS)
+  if (flags & SHF_STRINGS) {
     splitStrings(data(), entsize);
-  else
+    buildPieceIndex();
+  } else {
     splitNonStrings(data(), entsize);
+  }
+}
+
+// Relocations that point into string literals are so common that searching
+// the pieces of a large section for every one of them shows up in profiles.
+// Divide the section into buckets of about the average size of a piece and
+// remember the piece at the start of each bucket.
+void MergeInputSection::buildPieceIndex() {
+  if (pieces.size() < 64)
+    return;
+
+  size_t size = data().size();
+  pieceIndexShift = Log2_64(size / pieces.size());
+  pieceIndex.resize(((size - 1) >> pieceIndexShift) + 1);
+
+  size_t i = 0;
+  for (size_t b = 0, e = pieceIndex.size(); b != e; ++b) {
+    uint64_t off = (uint64_t)b << pieceIndexShift;
+    while (i + 1 != pieces.size() && pieces[i + 1].inputOff <= off)
+      ++i;
+    pieceIndex[b] = i;
+  }
 }
 
 SectionPiece *MergeInputSection::getSectionPiece(uint64_t offset) {
   if (this->data().size() <= offset)
     fatal(toString(this) + ": offset is outside the section");
 
-  // If Offset is not at beginning of a section piece, it is not in the map.
-  // In that case we need to  do a binary search of the original section piece vector.
-  auto it = partition_point(
-      pieces, [=](SectionPiece p) { return p.inputOff <= offset; });
-  return &it[-1];
+  // Records of a non-string section all have the same size.
+  if (!(flags & SHF_STRINGS))
+    return &pieces[offset / entsize];
+
+  auto isBefore = [=](const SectionPiece &p) { return p.inputOff <= offset; };
+  if (pieceIndex.empty())
+    return &partition_point(pieces, isBefore)[-1];
+
+  // The piece is between the first pieces of this and the next bucket.
+  size_t b = offset >> pieceIndexShift;
+  auto begin = pieces.begin() + pieceIndex[b];
+  auto end = pieces.end();
+  if (b + 1 != pieceIndex.size())
+    end = pieces.begin() + pieceIndex[b + 1] + 1;
+  return &std::partition_point(begin, end, isBefore)[-1];
 }
 
 // Returns the offset in an output section for a given input offset.
@@ -1298,7 +1432,7 @@ uint64_t MergeInputSection::getParentOffset(uint64_t offset) const {
   // If Offset is not at beginning of a section piece, it is not in the map.
   // In that case we need to search from the original section piece vector.
   const SectionPiece &piece =
-      *(const_cast<MergeInputSection *>(this)->getSectionPiece (offset));
+      *(const_cast<MergeInputSection *>(this)->getSectionPiece(offset));
   uint64_t addend = offset - piece.inputOff;
   return piece.outputOff + addend;
 }
@@ -1322,6 +1456,16 @@ template void InputSection::writeTo<ELF32BE>(uint8_t *);
 template void InputSection::writeTo<ELF64LE>(uint8_t *);
 template void InputSection::writeTo<ELF64BE>(uint8_t *);
 
+template size_t InputSection::getNumRelocShards<ELF32LE>(size_t);
+template size_t InputSection::getNumRelocShards<ELF32BE>(size_t);
+template size_t InputSection::getNumRelocShards<ELF64LE>(size_t);
+template size_t InputSection::getNumRelocShards<ELF64BE>(size_t);
+
+template void InputSection::relocateShard<ELF32LE>(uint8_t *, size_t, size_t);
+template void InputSection::relocateShard<ELF32BE>(uint8_t *, size_t, size_t);
+template void InputSection::relocateShard<ELF64LE>(uint8_t *, size_t, size_t);
+template void InputSection::relocateShard<ELF64BE>(uint8_t *, size_t, size_t);
+
 template MergeInputSection::MergeInputSection(ObjFile<ELF32LE> &,
                                               const ELF32LE::Shdr &, StringRef);
 template MergeInputSection::MergeInputSection(ObjFile<ELF32BE> &,
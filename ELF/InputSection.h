@@ -15,6 +15,7 @@
 #include "lld/Common/LLVM.h"
 #include "llvm/ADT/CachedHashString.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Object/ELF.h"
 
@@ -136,6 +137,14 @@ public:
 
   uint64_t getOffsetInFile() const;
 
+  bool isCompressed() const { return uncompressedSize >= 0; }
+
+  // Returns the zlib stream of a compressed section.
+  ArrayRef<uint8_t> getCompressedData() const {
+    assert(isCompressed());
+    return rawData;
+  }
+
   // Input sections are part of an output section. Special sections
   // like .eh_frame and merge sections are first combined into a
   // synthetic section that is then added to an output section. In all
@@ -180,11 +189,38 @@ public:
   template <class ELFT> void relocate(uint8_t *buf, uint8_t *bufEnd);
   void relocateAlloc(uint8_t *buf, uint8_t *bufEnd);
 
+  // The implementation of TargetInfo::relocateAlloc(). `relocateOne` is a
+  // function object that does what TargetInfo::relocateOne() does, which
+  // targets pass so that the call for each relocation is direct and can be
+  // inlined into the loop over the relocations.
+  template <class RelocateOneFn>
+  void relocateAllocWith(uint8_t *buf, uint8_t *bufEnd,
+                         RelocateOneFn relocateOne);
+
   // The native ELF reloc data type is not very convenient to handle.
   // So we convert ELF reloc records to our own records in Relocations.cpp.
   // This vector contains such "cooked" relocations.
   std::vector<Relocation> relocations;
 
+  // These are used by --optimize-bb-jumps. The last bytesDropped bytes of
+  // this section are deleted, and jumpInstrMods rewrite the jumps before
+  // them. nopFiller is set if the jump over the padding after this section
+  // was deleted, so that the padding has to be executable. keepLongJmp is
+  // set if the jump at the end of this section had to be grown back after it
+  // was shrunk, and it is not shrunk again so that the layout converges.
+  SmallVector<JumpInstrMod, 0> jumpInstrMods;
+  uint8_t bytesDropped = 0;
+  bool nopFiller = false;
+  bool keepLongJmp = false;
+
+  // Deletes the last bytesDropped bytes for good once the layout is final.
+  void trim() {
+    if (bytesDropped) {
+      rawData = rawData.drop_back(bytesDropped);
+      bytesDropped = 0;
+    }
+  }
+
   // A function compiled with -fsplit-stack calling a function
   // compiled without -fsplit-stack needs its prologue adjusted. Find
   // such functions and adjust their prologues.  This is very similar
@@ -204,6 +240,11 @@ protected:
   void parseCompressedHeader();
   void uncompress() const;
 
+  // Applies a relocation for relocateAllocWith() that relaxes code or needs
+  // other special handling.
+  void relocateAllocSpecial(const Relocation &rel, uint8_t *bufLoc,
+                            uint8_t *bufEnd, uint64_t targetVA);
+
   mutable ArrayRef<uint8_t> rawData;
 
   // This field stores the uncompressed size of the compressed data in rawData,
@@ -270,6 +311,13 @@ public:
 private:
   void splitStrings(ArrayRef<uint8_t> a, size_t size);
   void splitNonStrings(ArrayRef<uint8_t> a, size_t size);
+  void buildPieceIndex();
+
+  // For a large SHF_STRINGS section, pieceIndex[i] is the index of the piece
+  // that contains offset (i << pieceIndexShift), so that getSectionPiece()
+  // only needs to look at the pieces that start in one bucket of offsets.
+  std::vector<uint32_t> pieceIndex;
+  uint8_t pieceIndexShift = 0;
 };
 
 struct EhSectionPiece {
@@ -321,6 +369,16 @@ public:
   // beginning of the output section.
   template <class ELFT> void writeTo(uint8_t *buf);
 
+  // A large regular section can be written by multiple threads instead of
+  // writeTo(). Disjoint ranges of its contents are copied by copyContents()
+  // first, and then relocations are applied by relocateShard() for each of
+  // the shards returned by getNumRelocShards().
+  bool canSplitWrite() const;
+  void copyContents(uint8_t *buf, uint64_t begin, uint64_t end);
+  template <class ELFT> size_t getNumRelocShards(size_t maxShards);
+  template <class ELFT>
+  void relocateShard(uint8_t *buf, size_t shard, size_t numShards);
+
   uint64_t getOffset(uint64_t offset) const { return outSecOff + offset; }
 
   OutputSection *getParent() const;
@@ -341,6 +399,10 @@ public:
   // Used by ICF.
   uint32_t eqClass[2] = {0, 0};
 
+  // Set if this section is copied to the output file by
+  // copyPassThroughSections() rather than written to the output buffer.
+  bool passThrough = false;
+
   // Called by ICF to merge two input sections.
   void replace(InputSection *other);
 
@@ -356,6 +418,56 @@ private:
 // The list of all input sections.
 extern std::vector<InputSectionBase *> inputSections;
 
+uint64_t getRelocTargetVA(const InputFile *file, RelType type, int64_t a,
+                          uint64_t p, const Symbol &sym, RelExpr expr);
+
+template <class RelocateOneFn>
+void InputSectionBase::relocateAllocWith(uint8_t *buf, uint8_t *bufEnd,
+                                         RelocateOneFn relocateOne) {
+  assert(flags & llvm::ELF::SHF_ALLOC);
+  if (relocations.empty())
+    return;
+
+  const unsigned bits = config->wordsize * 8;
+  uint64_t outSecOff = 0;
+  if (auto *sec = dyn_cast<InputSection>(this))
+    outSecOff = sec->outSecOff;
+  uint64_t secAddr = getOutputSection()->addr;
+
+  for (const Relocation &rel : relocations) {
+    uint64_t offset = rel.offset + outSecOff;
+    uint8_t *bufLoc = buf + offset;
+    uint64_t targetVA =
+        llvm::SignExtend64(getRelocTargetVA(file, rel.type, rel.addend,
+                                            secAddr + offset, *rel.sym,
+                                            rel.expr),
+                           bits);
+
+    switch (rel.expr) {
+    case R_RELAX_GOT_PC:
+    case R_RELAX_GOT_PC_NOPIC:
+    case R_PPC64_RELAX_TOC:
+    case R_AARCH64_RELAX_GOT:
+    case R_RELAX_TLS_IE_TO_LE:
+    case R_RELAX_TLS_LD_TO_LE:
+    case R_RELAX_TLS_LD_TO_LE_ABS:
+    case R_RELAX_TLS_GD_TO_LE:
+    case R_RELAX_TLS_GD_TO_LE_NEG:
+    case R_AARCH64_RELAX_TLS_GD_TO_IE_PAGE_PC:
+    case R_RELAX_TLS_GD_TO_IE:
+    case R_RELAX_TLS_GD_TO_IE_ABS:
+    case R_RELAX_TLS_GD_TO_IE_GOT_OFF:
+    case R_RELAX_TLS_GD_TO_IE_GOTPLT:
+    case R_PPC64_CALL:
+      relocateAllocSpecial(rel, bufLoc, bufEnd, targetVA);
+      break;
+    default:
+      relocateOne(bufLoc, rel.type, targetVA);
+      break;
+    }
+  }
+}
+
 } // namespace elf
 
 std::string toString(const elf::InputSectionBase *);
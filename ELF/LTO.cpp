@@ -14,7 +14,9 @@
 #include "Symbols.h"
 #include "lld/Common/Args.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Filesystem.h"
 #include "lld/Common/TargetOptionsCommandFlags.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
@@ -32,10 +34,13 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <algorithm>
+#include <condition_variable>
 #include <cstddef>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <vector>
 
 using namespace llvm;
@@ -139,6 +144,14 @@ BitcodeCompiler::BitcodeCompiler() {
         config->thinLTOEmitImportsFiles, indexFile.get(), onIndexWrite);
   } else if (config->thinLTOJobs != -1U) {
     backend = lto::createInProcessThinBackend(config->thinLTOJobs);
+  } else if (config->memoryBudget) {
+    // Run as many backends as fit in the unused part of the memory budget,
+    // assuming that each of them needs about 1 GiB.
+    unsigned jobs = std::max<uint64_t>(
+        1, std::min<uint64_t>(getThreadCount(), getMemoryHeadroom() >> 30));
+    if (jobs < getThreadCount())
+      addMemoryThrottleCount();
+    backend = lto::createInProcessThinBackend(jobs);
   }
 
   ltoObj = std::make_unique<lto::LTO>(createConfig(), backend,
@@ -230,12 +243,72 @@ static void thinLTOCreateEmptyIndexFiles() {
   }
 }
 
-// Merge all the bitcode files we have seen, codegen the result
-// and return the resulting ObjectFile(s).
-std::vector<InputFile *> BitcodeCompiler::compile() {
+namespace {
+// Keeps track of the LTO backend tasks that have finished, so that their
+// native objects can be used while the other backends are still running.
+class FinishedTasks {
+public:
+  explicit FinishedTasks(unsigned numTasks) : done(numTasks) {}
+
+  void finish(size_t task) {
+    {
+      std::lock_guard<std::mutex> lock(mu);
+      done[task] = true;
+    }
+    cv.notify_all();
+  }
+
+  void finishAll() {
+    {
+      std::lock_guard<std::mutex> lock(mu);
+      allDone = true;
+    }
+    cv.notify_all();
+  }
+
+  // Waits until a task has finished. A task may never run, so this also
+  // returns once all backends are done.
+  void wait(size_t task) {
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [&] { return done[task] || allDone; });
+  }
+
+private:
+  std::mutex mu;
+  std::condition_variable cv;
+  std::vector<bool> done;
+  bool allDone = false;
+};
+
+// A stream for a native object that tells when the backend is done with it.
+class FinishingStream : public lto::NativeObjectStream {
+public:
+  FinishingStream(std::unique_ptr<raw_pwrite_stream> os,
+                  FinishedTasks &finished, size_t task)
+      : NativeObjectStream(std::move(os)), finished(finished), task(task) {}
+
+  ~FinishingStream() override {
+    OS.reset();
+    finished.finish(task);
+  }
+
+private:
+  FinishedTasks &finished;
+  size_t task;
+};
+} // namespace
+
+// Merge all the bitcode files we have seen, codegen the result and call
+// addFile for each resulting ObjectFile in task order.
+//
+// If threads are enabled, the backends run on a separate thread, and an
+// object is added as soon as its task and all tasks before it are done, so
+// that the objects are parsed while the remaining backends are running.
+void BitcodeCompiler::compile(function_ref<void(InputFile *)> addFile) {
   unsigned maxTasks = ltoObj->getMaxTasks();
   buf.resize(maxTasks);
   files.resize(maxTasks);
+  FinishedTasks finished(maxTasks);
 
   // The --thinlto-cache-dir option specifies the path to a directory in which
   // to cache native object files for ThinLTO incremental builds. If a path was
@@ -246,15 +319,41 @@ std::vector<InputFile *> BitcodeCompiler::compile() {
         lto::localCache(config->thinLTOCacheDir,
                         [&](size_t task, std::unique_ptr<MemoryBuffer> mb) {
                           files[task] = std::move(mb);
+                          finished.finish(task);
                         }));
 
-  if (!bitcodeFiles.empty())
-    checkError(ltoObj->run(
-        [&](size_t task) {
-          return std::make_unique<lto::NativeObjectStream>(
-              std::make_unique<raw_svector_ostream>(buf[task]));
-        },
-        cache));
+  auto runBackends = [&] {
+    if (!bitcodeFiles.empty())
+      checkError(ltoObj->run(
+          [&](size_t task) {
+            return std::make_unique<FinishingStream>(
+                std::make_unique<raw_svector_ostream>(buf[task]), finished,
+                task);
+          },
+          cache));
+    finished.finishAll();
+  };
+
+  // Index files are written as the backends run, so -thinlto-index-only
+  // always waits for them.
+  std::thread backendThread;
+  if (threadsEnabled && !config->thinLTOIndexOnly)
+    backendThread = std::thread(runBackends);
+  else
+    runBackends();
+
+  if (!config->thinLTOIndexOnly) {
+    for (unsigned i = 0; i != maxTasks; ++i) {
+      finished.wait(i);
+      if (!buf[i].empty())
+        addFile(createObjectFile(MemoryBufferRef(buf[i], "lto.tmp")));
+      else if (files[i])
+        addFile(createObjectFile(*files[i]));
+    }
+  }
+
+  if (backendThread.joinable())
+    backendThread.join();
 
   // Emit empty index files for non-indexed files
   for (StringRef s : thinIndices) {
@@ -275,11 +374,16 @@ std::vector<InputFile *> BitcodeCompiler::compile() {
     // distributed environment.
     if (indexFile)
       indexFile->close();
-    return {};
+    return;
   }
 
-  if (!config->thinLTOCacheDir.empty())
-    pruneCache(config->thinLTOCacheDir, config->thinLTOCachePolicy);
+  // Pruning scans the whole cache directory, and nothing else in the link
+  // depends on it.
+  if (!config->thinLTOCacheDir.empty()) {
+    std::string dir = config->thinLTOCacheDir;
+    CachePruningPolicy policy = config->thinLTOCachePolicy;
+    runInBackground([=] { pruneCache(dir, policy); });
+  }
 
   if (!config->ltoObjPath.empty()) {
     saveBuffer(buf[0], config->ltoObjPath);
@@ -292,16 +396,6 @@ std::vector<InputFile *> BitcodeCompiler::compile() {
     for (unsigned i = 1; i != maxTasks; ++i)
       saveBuffer(buf[i], config->outputFile + Twine(i) + ".lto.o");
   }
-
-  std::vector<InputFile *> ret;
-  for (unsigned i = 0; i != maxTasks; ++i)
-    if (!buf[i].empty())
-      ret.push_back(createObjectFile(MemoryBufferRef(buf[i], "lto.tmp")));
-
-  for (std::unique_ptr<MemoryBuffer> &file : files)
-    if (file)
-      ret.push_back(createObjectFile(*file));
-  return ret;
 }
 
 } // namespace elf
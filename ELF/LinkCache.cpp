@@ -0,0 +1,231 @@
+//===- LinkCache.cpp ------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --link-cache-dir.
+//
+// Build farms often link the same program from the same inputs many times,
+// for example once per test shard. With --link-cache-dir, the output file
+// and the map file of a link are stored in the cache directory under a key
+// made of the linker version, the command line and the contents of all files
+// that the link reads. A later link with the same key copies them into place
+// instead of linking.
+//
+// The key is computed once all input files, linker scripts and archives
+// have been read, which is before any symbol is resolved. The output file
+// name and the map file name are not part of the key. The copy uses the
+// FICLONE ioctl if the file system can share the blocks, so that a hit is
+// cheap. Outputs are not hard linked, because tools like strip and objcopy
+// may modify the output in place, which would modify the cache too.
+//
+// Links whose output is not a function of the key, or that write or print
+// anything other than the output file and the map file, are not cached.
+// Warnings of a cached link are not repeated when it is reused.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LinkCache.h"
+#include "Config.h"
+#include "Driver.h"
+#include "InputFiles.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Version.h"
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/xxhash.h"
+#include "llvm/Support/raw_ostream.h"
+
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+using namespace llvm;
+
+namespace lld {
+namespace elf {
+
+std::vector<std::pair<std::string, MemoryBufferRef>> linkCacheInputs;
+
+// The key of the current link, or an empty string if it is not cached.
+static std::string cacheKey;
+
+// Returns why the link cannot be cached, or an empty string if it can.
+static std::string getUnsupportedReason() {
+  if (config->incremental)
+    return "--incremental";
+  if (tar)
+    return "--reproduce";
+  if (config->outputFile == "-" || config->mapFile == "-")
+    return "output to stdout";
+  if (config->buildId == BuildIdKind::Uuid)
+    return "--build-id=uuid";
+  if (config->thinLTOIndexOnly || config->thinLTOEmitImportsFiles ||
+      config->saveTemps || !config->ltoObjPath.empty() ||
+      config->ltoCSProfileGenerate || !config->optRemarksFilename.empty() ||
+      !config->dwoDir.empty())
+    return "LTO options that write other files";
+  if (config->printGcSections || config->printIcfSections || config->trace ||
+      (config->cref && config->mapFile.empty()))
+    return "options that print to stdout";
+  return "";
+}
+
+static std::string getCachePath(StringRef suffix) {
+  SmallString<128> path(config->linkCacheDir);
+  sys::path::append(path, "link-" + cacheKey + suffix);
+  return path.str();
+}
+
+static std::string computeKey(opt::InputArgList &args) {
+  SHA1 hasher;
+  auto add = [&](StringRef s) {
+    uint8_t size[8];
+    support::endian::write64le(size, s.size());
+    hasher.update(makeArrayRef(size));
+    hasher.update(s);
+  };
+
+  add(getLLDVersion());
+  for (opt::Arg *arg : args) {
+    // Skip the options that do not affect the output.
+    switch (arg->getOption().getID()) {
+    case OPT_archive_cache_dir:
+    case OPT_error_limit:
+    case OPT_link_cache_dir:
+    case OPT_Map:
+    case OPT_o:
+    case OPT_threads:
+    case OPT_threads_eq:
+    case OPT_no_threads:
+    case OPT_time:
+    case OPT_time_json:
+    case OPT_time_trace:
+    case OPT_time_trace_file:
+    case OPT_time_trace_granularity:
+    case OPT_verbose:
+      continue;
+    }
+    add(arg->getAsString(args));
+  }
+
+  // Whether there is a map file changes what the link writes.
+  add(config->mapFile.empty() ? "" : "map");
+
+  for (std::pair<std::string, MemoryBufferRef> &p : linkCacheInputs) {
+    add(p.first);
+    add(utohexstr(xxHash64(p.second.getBuffer())));
+  }
+  return toHex(hasher.final());
+}
+
+// Copies a file to a temporary file next to `to` and renames it, so that
+// nobody sees a partially written file.
+static std::error_code copyFile(StringRef from, StringRef to) {
+  int in;
+  if (std::error_code ec = sys::fs::openFileForRead(from, in))
+    return ec;
+  auto closeIn = make_scope_exit([&] { sys::fs::closeFile(in); });
+
+  sys::fs::file_status st;
+  if (std::error_code ec = sys::fs::status(in, st))
+    return ec;
+
+  Expected<sys::fs::TempFile> temp =
+      sys::fs::TempFile::create(to + ".tmp%%%%%%");
+  if (!temp)
+    return errorToErrorCode(temp.takeError());
+
+  bool cloned = false;
+#if defined(__linux__) && defined(FICLONE)
+  cloned = ioctl(temp->FD, FICLONE, in) == 0;
+#endif
+  if (!cloned) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+        MemoryBuffer::getOpenFile(in, from, st.getSize(),
+                                  /*RequiresNullTerminator=*/false);
+    if (!mbOrErr) {
+      consumeError(temp->discard());
+      return mbOrErr.getError();
+    }
+    raw_fd_ostream os(temp->FD, /*shouldClose=*/false);
+    os << (*mbOrErr)->getBuffer();
+    os.flush();
+    if (os.has_error()) {
+      os.clear_error();
+      consumeError(temp->discard());
+      return make_error_code(errc::io_error);
+    }
+  }
+
+  if (std::error_code ec = sys::fs::setPermissions(temp->FD, st.permissions()))
+    warn("cannot set the permissions of " + to + ": " + ec.message());
+  return errorToErrorCode(temp->keep(to));
+}
+
+bool useLinkCache(opt::InputArgList &args) {
+  cacheKey.clear();
+  std::string reason = getUnsupportedReason();
+  if (!reason.empty()) {
+    log("link cache: not used because of " + reason);
+    return false;
+  }
+
+  // Files that are read after symbol resolution are part of the key too.
+  for (StringRef path : {config->ltoSampleProfile, config->ltoCSProfileFile})
+    if (!path.empty() && !readFile(path))
+      return false;
+  if (config->callGraphProfileSort)
+    if (auto *arg = args.getLastArg(OPT_call_graph_ordering_file))
+      if (!readFile(arg->getValue()))
+        return false;
+
+  cacheKey = computeKey(args);
+  std::string outPath = getCachePath(".out");
+  std::string mapPath = getCachePath(".map");
+  if (!sys::fs::exists(outPath) ||
+      (!config->mapFile.empty() && !sys::fs::exists(mapPath)))
+    return false;
+
+  // The map file goes first, so that the output is left alone if it cannot
+  // be copied.
+  if (!config->mapFile.empty())
+    if (std::error_code ec = copyFile(mapPath, config->mapFile)) {
+      log("link cache: cannot copy " + mapPath + ": " + ec.message());
+      return false;
+    }
+  if (std::error_code ec = copyFile(outPath, config->outputFile)) {
+    log("link cache: cannot copy " + outPath + ": " + ec.message());
+    return false;
+  }
+  log("link cache: using " + outPath);
+  return true;
+}
+
+void addToLinkCache() {
+  if (cacheKey.empty())
+    return;
+
+  auto fail = [&](const Twine &msg) {
+    warn("cannot add the output to the link cache: " + msg);
+  };
+  if (std::error_code ec = sys::fs::create_directories(config->linkCacheDir))
+    return fail(ec.message());
+
+  // The output goes last, as its presence tells that the entry is complete.
+  if (!config->mapFile.empty())
+    if (std::error_code ec = copyFile(config->mapFile, getCachePath(".map")))
+      return fail(config->mapFile + ": " + ec.message());
+  if (std::error_code ec = copyFile(config->outputFile, getCachePath(".out")))
+    return fail(config->outputFile + ": " + ec.message());
+}
+
+} // namespace elf
+} // namespace lld
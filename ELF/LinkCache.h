@@ -0,0 +1,37 @@
+//===- LinkCache.h ----------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_LINK_CACHE_H
+#define LLD_ELF_LINK_CACHE_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/Option/ArgList.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lld {
+namespace elf {
+
+// The files read by the link with --link-cache-dir. Their contents are part
+// of the cache key.
+extern std::vector<std::pair<std::string, MemoryBufferRef>> linkCacheInputs;
+
+// Copies the outputs of an identical previous link from --link-cache-dir
+// into place. Returns true if that was done, or if it failed with an error,
+// and false if the link needs to be done.
+bool useLinkCache(llvm::opt::InputArgList &args);
+
+// Adds the outputs of this link to --link-cache-dir.
+void addToLinkCache();
+
+} // namespace elf
+} // namespace lld
+
+#endif
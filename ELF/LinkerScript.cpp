@@ -12,6 +12,7 @@
 
 #include "LinkerScript.h"
 #include "Config.h"
+#include "Incremental.h"
 #include "InputSection.h"
 #include "OutputSections.h"
 #include "SymbolTable.h"
@@ -22,6 +23,8 @@
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/Threads.h"
+#include "llvm/ADT/CachedHashString.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/BinaryFormat/ELF.h"
@@ -320,7 +323,7 @@ void LinkerScript::assignSymbol(SymbolAssignment *cmd, bool inSec) {
   }
 }
 
-static std::string getFilename(InputFile *file) {
+static std::string getFilename(const InputFile *file) {
   if (!file)
     return "";
   if (file->archiveName.empty())
@@ -353,31 +356,41 @@ static bool matchConstraints(ArrayRef<InputSectionBase *> sections,
          (!isRW && kind == ConstraintKind::ReadOnly);
 }
 
+// Sorts sections stably by keys. The keys are computed once for each
+// section and stored next to the section's original position, so that the
+// sort itself doesn't chase section pointers and can run in parallel.
+template <class KeyT>
+static void sortByKey(MutableArrayRef<InputSectionBase *> vec,
+                      llvm::function_ref<KeyT(InputSectionBase *)> getKey) {
+  std::vector<std::pair<KeyT, size_t>> keys(vec.size());
+  parallelForEachN(0, vec.size(),
+                   [&](size_t i) { keys[i] = {getKey(vec[i]), i}; });
+  parallelSort(keys, std::less<std::pair<KeyT, size_t>>());
+
+  std::vector<InputSectionBase *> sorted(vec.size());
+  for (size_t i = 0, e = vec.size(); i != e; ++i)
+    sorted[i] = vec[keys[i].second];
+  llvm::copy(sorted, vec.begin());
+}
+
 static void sortSections(MutableArrayRef<InputSectionBase *> vec,
                          SortSectionPolicy k) {
-  auto alignmentComparator = [](InputSectionBase *a, InputSectionBase *b) {
-    // ">" is not a mistake. Sections with larger alignments are placed
-    // before sections with smaller alignments in order to reduce the
-    // amount of padding necessary. This is compatible with GNU.
-    return a->alignment > b->alignment;
-  };
-  auto nameComparator = [](InputSectionBase *a, InputSectionBase *b) {
-    return a->name < b->name;
-  };
-  auto priorityComparator = [](InputSectionBase *a, InputSectionBase *b) {
-    return getPriority(a->name) < getPriority(b->name);
-  };
-
   switch (k) {
   case SortSectionPolicy::Default:
   case SortSectionPolicy::None:
     return;
   case SortSectionPolicy::Alignment:
-    return llvm::stable_sort(vec, alignmentComparator);
+    // Sections with larger alignments are placed before sections with
+    // smaller alignments in order to reduce the amount of padding
+    // necessary. This is compatible with GNU.
+    return sortByKey<int64_t>(
+        vec, [](InputSectionBase *s) { return -int64_t(s->alignment); });
   case SortSectionPolicy::Name:
-    return llvm::stable_sort(vec, nameComparator);
+    return sortByKey<StringRef>(vec,
+                                [](InputSectionBase *s) { return s->name; });
   case SortSectionPolicy::Priority:
-    return llvm::stable_sort(vec, priorityComparator);
+    return sortByKey<int>(
+        vec, [](InputSectionBase *s) { return getPriority(s->name); });
   }
 }
 
@@ -404,6 +417,124 @@ static void sortInputSections(MutableArrayRef<InputSectionBase *> vec,
   sortSections(vec, pat.sortOuter);
 }
 
+namespace {
+// Matches input sections against all the SectionPatterns of the SECTIONS
+// commands at once. A script can have hundreds of patterns, and a link can
+// have millions of input sections, so matching every section against every
+// pattern is too slow. Instead, patterns are bucketed by the literal prefixes
+// of their globs, so that a section name is only matched against patterns
+// that it can possibly match, and the result is cached for each distinct
+// section name. File name matches are cached for each file.
+class SectionPatternMatcher {
+public:
+  void add(InputSectionDescription *cmd);
+  void match(ArrayRef<InputSectionBase *> sections);
+
+private:
+  struct Entry {
+    const InputSectionDescription *cmd;
+    SectionPattern *pat;
+  };
+
+  ArrayRef<uint32_t> matchName(StringRef name);
+  bool matchFile(const InputFile *file, const StringMatcher &m);
+
+  std::vector<Entry> entries;
+  DenseMap<CachedHashStringRef, std::vector<uint32_t>> buckets;
+  std::vector<size_t> prefixLengths;
+  DenseMap<CachedHashStringRef, std::vector<uint32_t>> nameMatches;
+  DenseMap<const InputFile *, std::string> filenames;
+  DenseMap<std::pair<const InputFile *, const StringMatcher *>, bool>
+      fileMatches;
+};
+} // namespace
+
+void SectionPatternMatcher::add(InputSectionDescription *cmd) {
+  for (SectionPattern &pat : cmd->sectionPatterns) {
+    uint32_t id = entries.size();
+    entries.push_back({cmd, &pat});
+    for (StringRef prefix : pat.sectionPat.getPrefixes()) {
+      std::vector<uint32_t> &v = buckets[CachedHashStringRef(prefix)];
+      // A pattern may have several globs with the same prefix.
+      if (v.empty() || v.back() != id)
+        v.push_back(id);
+      prefixLengths.push_back(prefix.size());
+    }
+  }
+}
+
+// Returns the IDs of the patterns that match a section name, in ascending
+// order.
+ArrayRef<uint32_t> SectionPatternMatcher::matchName(StringRef name) {
+  auto it = nameMatches.try_emplace(CachedHashStringRef(name));
+  std::vector<uint32_t> &ret = it.first->second;
+  if (!it.second)
+    return ret;
+
+  for (size_t len : prefixLengths) {
+    if (len > name.size())
+      break;
+    auto bucket = buckets.find(CachedHashStringRef(name.take_front(len)));
+    if (bucket == buckets.end())
+      continue;
+    for (uint32_t id : bucket->second)
+      if (entries[id].pat->sectionPat.match(name))
+        ret.push_back(id);
+  }
+  llvm::sort(ret);
+  ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+  return ret;
+}
+
+bool SectionPatternMatcher::matchFile(const InputFile *file,
+                                      const StringMatcher &m) {
+  auto it = fileMatches.try_emplace({file, &m});
+  if (it.second) {
+    auto name = filenames.try_emplace(file);
+    if (name.second)
+      name.first->second = getFilename(file);
+    it.first->second = m.match(name.first->second);
+  }
+  return it.first->second;
+}
+
+void SectionPatternMatcher::match(ArrayRef<InputSectionBase *> sections) {
+  llvm::sort(prefixLengths);
+  prefixLengths.erase(std::unique(prefixLengths.begin(), prefixLengths.end()),
+                      prefixLengths.end());
+
+  for (InputSectionBase *sec : sections) {
+    // For -emit-relocs we have to ignore entries like
+    //   .rela.dyn : { *(.rela.data) }
+    // which are common because they are in the default bfd script.
+    // We do not ignore SHT_REL[A] linker-synthesized sections here because
+    // want to support scripts that do custom layout for them.
+    if (isa<InputSection>(sec) &&
+        cast<InputSection>(sec)->getRelocatedSection())
+      continue;
+
+    for (uint32_t id : matchName(sec->name)) {
+      const Entry &e = entries[id];
+      if (matchFile(sec->file, e.cmd->filePat) &&
+          !matchFile(sec->file, e.pat->excludedFilePat))
+        e.pat->candidates.push_back(sec);
+    }
+  }
+}
+
+// Matches the input sections against the patterns of all the SECTIONS
+// commands. Which sections a pattern matches does not depend on which
+// sections earlier patterns took, so this is done once beforehand.
+void LinkerScript::matchSectionPatterns() {
+  SectionPatternMatcher matcher;
+  for (BaseCommand *base : sectionCommands)
+    if (auto *sec = dyn_cast<OutputSection>(base))
+      for (BaseCommand *sub : sec->sectionCommands)
+        if (auto *cmd = dyn_cast<InputSectionDescription>(sub))
+          matcher.add(cmd);
+  matcher.match(inputSections);
+}
+
 // Compute and remember which sections the InputSectionDescription matches.
 std::vector<InputSectionBase *>
 LinkerScript::computeInputSections(const InputSectionDescription *cmd) {
@@ -413,27 +544,9 @@ LinkerScript::computeInputSections(const InputSectionDescription *cmd) {
   for (const SectionPattern &pat : cmd->sectionPatterns) {
     size_t sizeBefore = ret.size();
 
-    for (InputSectionBase *sec : inputSections) {
-      if (!sec->isLive() || sec->parent)
-        continue;
-
-      // For -emit-relocs we have to ignore entries like
-      //   .rela.dyn : { *(.rela.data) }
-      // which are common because they are in the default bfd script.
-      // We do not ignore SHT_REL[A] linker-synthesized sections here because
-      // want to support scripts that do custom layout for them.
-      if (isa<InputSection>(sec) &&
-          cast<InputSection>(sec)->getRelocatedSection())
-        continue;
-
-      std::string filename = getFilename(sec->file);
-      if (!cmd->filePat.match(filename) ||
-          pat.excludedFilePat.match(filename) ||
-          !pat.sectionPat.match(sec->name))
-        continue;
-
-      ret.push_back(sec);
-    }
+    for (InputSectionBase *sec : pat.candidates)
+      if (sec->isLive() && !sec->parent)
+        ret.push_back(sec);
 
     sortInputSections(
         MutableArrayRef<InputSectionBase *>(ret).slice(sizeBefore), pat);
@@ -476,6 +589,8 @@ LinkerScript::createInputSectionList(OutputSection &outCmd) {
 
 // Create output sections described by SECTIONS commands.
 void LinkerScript::processSectionCommands() {
+  matchSectionPatterns();
+
   size_t i = 0;
   for (BaseCommand *base : sectionCommands) {
     if (auto *sec = dyn_cast<OutputSection>(base)) {
@@ -550,15 +665,6 @@ void LinkerScript::processSymbolAssignments() {
   ctx = nullptr;
 }
 
-static OutputSection *findByName(ArrayRef<BaseCommand *> vec,
-                                 StringRef name) {
-  for (BaseCommand *base : vec)
-    if (auto *sec = dyn_cast<OutputSection>(base))
-      if (sec->name == name)
-        return sec;
-  return nullptr;
-}
-
 static OutputSection *createSection(InputSectionBase *isec,
                                     StringRef outsecName) {
   OutputSection *sec = script->createOutputSection(outsecName, "<internal>");
@@ -673,6 +779,14 @@ void LinkerScript::addOrphanSections() {
   StringMap<TinyPtrVector<OutputSection *>> map;
   std::vector<OutputSection *> v;
 
+  // Output sections described by the script, by name, so that each orphan
+  // does not have to search sectionCommands. If a name is used more than
+  // once, orphans go to the first one.
+  DenseMap<StringRef, OutputSection *> scriptSections;
+  for (BaseCommand *base : sectionCommands)
+    if (auto *sec = dyn_cast<OutputSection>(base))
+      scriptSections.try_emplace(sec->name, sec);
+
   std::function<void(InputSectionBase *)> add;
   add = [&](InputSectionBase *s) {
     if (s->isLive() && !s->parent) {
@@ -683,7 +797,7 @@ void LinkerScript::addOrphanSections() {
       else if (config->orphanHandling == OrphanHandlingPolicy::Warn)
         warn(toString(s) + " is being placed in '" + name + "'");
 
-      if (OutputSection *sec = findByName(sectionCommands, name)) {
+      if (OutputSection *sec = scriptSections.lookup(name)) {
         sec->recordSection(s);
       } else {
         if (OutputSection *os = addInputSec(map, s, name))
@@ -747,6 +861,10 @@ void LinkerScript::output(InputSection *s) {
   uint64_t pos = advance(s->getSize(), s->alignment);
   s->outSecOff = pos - s->getSize() - ctx->outSec->addr;
 
+  // Leave room for the section to grow for --incremental.
+  if (uint64_t slack = getIncrementalSlack(s))
+    pos = advance(slack, 1);
+
   // Update output section size after adding each section. This is so that
   // SIZEOF works correctly in the case below:
   // .foo { *(.aaa) a = SIZEOF(.foo); *(.bbb) }
@@ -152,6 +152,11 @@ struct SectionPattern {
   StringMatcher sectionPat;
   SortSectionPolicy sortOuter;
   SortSectionPolicy sortInner;
+
+  // The input sections that match this pattern and the file pattern of its
+  // InputSectionDescription, in the order of inputSections. Computed at the
+  // start of processSectionCommands() and used by computeInputSections().
+  std::vector<InputSectionBase *> candidates;
 };
 
 struct InputSectionDescription : BaseCommand {
@@ -232,6 +237,7 @@ class LinkerScript final {
   void expandOutputSection(uint64_t size);
   void expandMemoryRegions(uint64_t size);
 
+  void matchSectionPatterns();
   std::vector<InputSectionBase *>
   computeInputSections(const InputSectionDescription *);
 
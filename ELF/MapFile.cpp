@@ -52,13 +52,19 @@ static void writeHeader(raw_ostream &os, uint64_t vma, uint64_t lma,
 
 // Returns a list of all symbols that we want to print out.
 static std::vector<Defined *> getSymbols() {
-  std::vector<Defined *> v;
-  for (InputFile *file : objectFiles)
+  std::vector<std::vector<Defined *>> fileSyms(objectFiles.size());
+  parallelForEachN(0, objectFiles.size(), [&](size_t i) {
+    InputFile *file = objectFiles[i];
     for (Symbol *b : file->getSymbols())
       if (auto *dr = dyn_cast<Defined>(b))
         if (!dr->isSection() && dr->section && dr->section->isLive() &&
             (dr->file == file || dr->needsPltAddr || dr->section->bss))
-          v.push_back(dr);
+          fileSyms[i].push_back(dr);
+  });
+
+  std::vector<Defined *> v;
+  for (std::vector<Defined *> &syms : fileSyms)
+    v.insert(v.end(), syms.begin(), syms.end());
   return v;
 }
 
@@ -71,10 +77,14 @@ static SymbolMapTy getSectionSyms(ArrayRef<Defined *> syms) {
   // Sort symbols by address. We want to print out symbols in the
   // order in the output file rather than the order they appeared
   // in the input files.
+  std::vector<SmallVector<Defined *, 4> *> lists;
   for (auto &it : ret)
-    llvm::stable_sort(it.second, [](Defined *a, Defined *b) {
+    lists.push_back(&it.second);
+  parallelForEach(lists, [](SmallVector<Defined *, 4> *list) {
+    llvm::stable_sort(*list, [](Defined *a, Defined *b) {
       return a->getVA() < b->getVA();
     });
+  });
   return ret;
 }
 
@@ -138,6 +148,64 @@ static void printEhFrame(raw_ostream &os, const EhFrameSection *sec) {
   }
 }
 
+// toString(InputFile *) caches its result in the file. Fill the caches
+// before files are printed from multiple threads.
+static void cacheFileNames() {
+  for (InputFile *file : objectFiles)
+    toString(file);
+  for (BinaryFile *file : binaryFiles)
+    toString(file);
+  for (BitcodeFile *file : bitcodeFiles)
+    toString(file);
+  for (SharedFile *file : sharedFiles)
+    toString(file);
+}
+
+// Print an output section and its contents.
+static void printOutputSection(raw_ostream &os, OutputSection *osec,
+                               const SymbolMapTy &sectionSyms,
+                               const DenseMap<Symbol *, std::string> &symStr) {
+  writeHeader(os, osec->addr, osec->getLMA(), osec->size, osec->alignment);
+  os << osec->name << '\n';
+
+  // Dump symbols for each input section.
+  for (BaseCommand *base : osec->sectionCommands) {
+    if (auto *isd = dyn_cast<InputSectionDescription>(base)) {
+      for (InputSection *isec : isd->sections) {
+        if (auto *ehSec = dyn_cast<EhFrameSection>(isec)) {
+          printEhFrame(os, ehSec);
+          continue;
+        }
+
+        writeHeader(os, isec->getVA(0), osec->getLMA() + isec->getOffset(0),
+                    isec->getSize(), isec->alignment);
+        os << indent8 << toString(isec) << '\n';
+        auto it = sectionSyms.find(isec);
+        if (it != sectionSyms.end())
+          for (Symbol *sym : it->second)
+            os << symStr.find(sym)->second << '\n';
+      }
+      continue;
+    }
+
+    if (auto *cmd = dyn_cast<ByteCommand>(base)) {
+      writeHeader(os, osec->addr + cmd->offset, osec->getLMA() + cmd->offset,
+                  cmd->size, 1);
+      os << indent8 << cmd->commandString << '\n';
+      continue;
+    }
+
+    if (auto *cmd = dyn_cast<SymbolAssignment>(base)) {
+      if (cmd->provide && !cmd->sym)
+        continue;
+      writeHeader(os, cmd->addr, osec->getLMA() + cmd->addr - osec->getVA(0),
+                  cmd->size, 1);
+      os << indent8 << cmd->commandString << '\n';
+      continue;
+    }
+  }
+}
+
 void writeMapFile() {
   if (config->mapFile.empty())
     return;
@@ -151,6 +219,7 @@ void writeMapFile() {
   }
 
   // Collect symbol info that we want to print out.
+  cacheFileNames();
   std::vector<Defined *> syms = getSymbols();
   SymbolMapTy sectionSyms = getSectionSyms(syms);
   DenseMap<Symbol *, std::string> symStr = getSymbolStrings(syms);
@@ -160,60 +229,42 @@ void writeMapFile() {
   os << right_justify("VMA", w) << ' ' << right_justify("LMA", w)
      << "     Size Align Out     In      Symbol\n";
 
-  OutputSection* osec = nullptr;
-  for (BaseCommand *base : script->sectionCommands) {
-    if (auto *cmd = dyn_cast<SymbolAssignment>(base)) {
+  // Output sections are printed into separate buffers in parallel, which are
+  // then written in order. Symbol assignments between output sections are
+  // printed relative to the output section that precedes them.
+  ArrayRef<BaseCommand *> cmds = script->sectionCommands;
+  std::vector<OutputSection *> prevOsec(cmds.size());
+  OutputSection *osec = nullptr;
+  for (size_t i = 0, e = cmds.size(); i != e; ++i) {
+    prevOsec[i] = osec;
+    if (auto *sec = dyn_cast<OutputSection>(cmds[i]))
+      osec = sec;
+  }
+
+  std::vector<std::string> bufs(cmds.size());
+  parallelForEachN(0, cmds.size(), [&](size_t i) {
+    raw_string_ostream bufOS(bufs[i]);
+    if (auto *cmd = dyn_cast<SymbolAssignment>(cmds[i])) {
       if (cmd->provide && !cmd->sym)
-        continue;
-      uint64_t lma = osec ? osec->getLMA() + cmd->addr - osec->getVA(0) : 0;
-      writeHeader(os, cmd->addr, lma, cmd->size, 1);
-      os << cmd->commandString << '\n';
-      continue;
+        return;
+      OutputSection *sec = prevOsec[i];
+      uint64_t lma = sec ? sec->getLMA() + cmd->addr - sec->getVA(0) : 0;
+      writeHeader(bufOS, cmd->addr, lma, cmd->size, 1);
+      bufOS << cmd->commandString << '\n';
+      return;
     }
+    printOutputSection(bufOS, cast<OutputSection>(cmds[i]), sectionSyms,
+                       symStr);
+  });
 
-    osec = cast<OutputSection>(base);
-    writeHeader(os, osec->addr, osec->getLMA(), osec->size, osec->alignment);
-    os << osec->name << '\n';
-
-    // Dump symbols for each input section.
-    for (BaseCommand *base : osec->sectionCommands) {
-      if (auto *isd = dyn_cast<InputSectionDescription>(base)) {
-        for (InputSection *isec : isd->sections) {
-          if (auto *ehSec = dyn_cast<EhFrameSection>(isec)) {
-            printEhFrame(os, ehSec);
-            continue;
-          }
-
-          writeHeader(os, isec->getVA(0), osec->getLMA() + isec->getOffset(0),
-                      isec->getSize(), isec->alignment);
-          os << indent8 << toString(isec) << '\n';
-          for (Symbol *sym : sectionSyms[isec])
-            os << symStr[sym] << '\n';
-        }
-        continue;
-      }
-
-      if (auto *cmd = dyn_cast<ByteCommand>(base)) {
-        writeHeader(os, osec->addr + cmd->offset, osec->getLMA() + cmd->offset,
-                    cmd->size, 1);
-        os << indent8 << cmd->commandString << '\n';
-        continue;
-      }
-
-      if (auto *cmd = dyn_cast<SymbolAssignment>(base)) {
-        if (cmd->provide && !cmd->sym)
-          continue;
-        writeHeader(os, cmd->addr, osec->getLMA() + cmd->addr - osec->getVA(0),
-                    cmd->size, 1);
-        os << indent8 << cmd->commandString << '\n';
-        continue;
-      }
-    }
+  for (std::string &buf : bufs) {
+    os << buf;
+    std::string().swap(buf);
   }
 }
 
-static void print(StringRef a, StringRef b) {
-  outs() << left_justify(a, 49) << " " << b << "\n";
+static void print(raw_ostream &os, StringRef a, StringRef b) {
+  os << left_justify(a, 49) << " " << b << "\n";
 }
 
 // Output a cross reference table to stdout. This is for --cref.
@@ -231,32 +282,45 @@ void writeCrossReferenceTable() {
   if (!config->cref)
     return;
 
-  // Collect symbols and files.
-  MapVector<Symbol *, SetVector<InputFile *>> map;
-  for (InputFile *file : objectFiles) {
-    for (Symbol *sym : file->getSymbols()) {
+  // Collect symbols and files. The symbols of each file are collected in
+  // parallel, and then added to the map in the order of the files.
+  std::vector<std::vector<Symbol *>> fileSyms(objectFiles.size());
+  parallelForEachN(0, objectFiles.size(), [&](size_t i) {
+    for (Symbol *sym : objectFiles[i]->getSymbols()) {
       if (isa<SharedSymbol>(sym))
-        map[sym].insert(file);
+        fileSyms[i].push_back(sym);
       if (auto *d = dyn_cast<Defined>(sym))
         if (!d->isLocal() && (!d->section || d->section->isLive()))
-          map[d].insert(file);
+          fileSyms[i].push_back(d);
     }
-  }
+  });
+
+  MapVector<Symbol *, SetVector<InputFile *>> map;
+  for (size_t i = 0, e = objectFiles.size(); i != e; ++i)
+    for (Symbol *sym : fileSyms[i])
+      map[sym].insert(objectFiles[i]);
 
   // Print out a header.
   outs() << "Cross Reference Table\n\n";
-  print("Symbol", "File");
+  print(outs(), "Symbol", "File");
 
-  // Print out a table.
-  for (auto kv : map) {
+  // Print out a table. Demangling symbol names is slow, so entries are
+  // formatted in parallel.
+  cacheFileNames();
+  std::vector<std::string> strs(map.size());
+  parallelForEachN(0, map.size(), [&](size_t i) {
+    auto &kv = *(map.begin() + i);
     Symbol *sym = kv.first;
     SetVector<InputFile *> &files = kv.second;
 
-    print(toString(*sym), toString(sym->file));
+    raw_string_ostream os(strs[i]);
+    print(os, toString(*sym), toString(sym->file));
     for (InputFile *file : files)
       if (file != sym->file)
-        print("", toString(file));
-  }
+        print(os, "", toString(file));
+  });
+  for (const std::string &s : strs)
+    outs() << s;
 }
 
 } // namespace elf
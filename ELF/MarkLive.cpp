@@ -29,8 +29,11 @@
 #include "Target.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
+#include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Object/ELF.h"
+#include <atomic>
 #include <functional>
 #include <vector>
 
@@ -42,7 +45,24 @@ namespace endian = llvm::support::endian;
 
 namespace lld {
 namespace elf {
+
+static Timer gcTimer("GC", Timer::root());
+
 namespace {
+// The sections that were found live and need to be visited.
+struct MarkQueue {
+  std::vector<InputSection *> sections;
+
+  // Pieces of mergeable sections that were found live by the parallel
+  // marker. Their live bits share words with their hashes, so they are set
+  // by one thread after each round.
+  std::vector<SectionPiece *> pieces;
+
+  // Symbols that were found used by the parallel marker. Symbol::used shares
+  // a word with other flags of the symbol, so it is set the same way.
+  std::vector<Symbol *> usedSymbols;
+};
+
 template <class ELFT> class MarkLive {
 public:
   MarkLive(unsigned partition) : partition(partition) {}
@@ -51,12 +71,15 @@ public:
   void moveToMain();
 
 private:
-  void enqueue(InputSectionBase *sec, uint64_t offset);
+  void enqueue(InputSectionBase *sec, uint64_t offset, MarkQueue &q);
   void markSymbol(Symbol *sym);
   void mark();
+  void markParallel();
+  void visit(InputSectionBase &sec, MarkQueue &q);
 
   template <class RelTy>
-  void resolveReloc(InputSectionBase &sec, RelTy &rel, bool isLSDA);
+  void resolveReloc(InputSectionBase &sec, RelTy &rel, bool isLSDA,
+                    MarkQueue &q);
 
   template <class RelTy>
   void scanEhFrameSection(EhInputSection &eh, ArrayRef<RelTy> rels);
@@ -65,7 +88,10 @@ private:
   unsigned partition;
 
   // A list of sections to visit.
-  SmallVector<InputSection *, 256> queue;
+  MarkQueue queue;
+
+  // True while markParallel() is running.
+  bool parallel = false;
 
   // There are normally few input sections whose names are valid C
   // identifiers, so we just store a std::vector instead of a multimap.
@@ -89,11 +115,14 @@ static uint64_t getAddend(InputSectionBase &sec,
 template <class ELFT>
 template <class RelTy>
 void MarkLive<ELFT>::resolveReloc(InputSectionBase &sec, RelTy &rel,
-                                  bool isLSDA) {
+                                  bool isLSDA, MarkQueue &q) {
   Symbol &sym = sec.getFile<ELFT>()->getRelocTargetSym(rel);
 
   // If a symbol is referenced in a live section, it is used.
-  sym.used = true;
+  if (!parallel)
+    sym.used = true;
+  else if (!sym.used)
+    q.usedSymbols.push_back(&sym);
 
   if (auto *d = dyn_cast<Defined>(&sym)) {
     auto *relSec = dyn_cast_or_null<InputSectionBase>(d->section);
@@ -105,7 +134,7 @@ void MarkLive<ELFT>::resolveReloc(InputSectionBase &sec, RelTy &rel,
       offset += getAddend<ELFT>(sec, rel);
 
     if (!isLSDA || !(relSec->flags & SHF_EXECINSTR))
-      enqueue(relSec, offset);
+      enqueue(relSec, offset, q);
     return;
   }
 
@@ -114,7 +143,7 @@ void MarkLive<ELFT>::resolveReloc(InputSectionBase &sec, RelTy &rel,
       ss->getFile().isNeeded = true;
 
   for (InputSectionBase *sec : cNamedSections.lookup(sym.getName()))
-    enqueue(sec, 0);
+    enqueue(sec, 0, q);
 }
 
 // The .eh_frame section is an unfortunate special case.
@@ -144,7 +173,7 @@ void MarkLive<ELFT>::scanEhFrameSection(EhInputSection &eh,
     if (endian::read32<ELFT::TargetEndianness>(piece.data().data() + 4) == 0) {
       // This is a CIE, we only need to worry about the first relocation. It is
       // known to point to the personality function.
-      resolveReloc(eh, rels[firstRelI], false);
+      resolveReloc(eh, rels[firstRelI], false, queue);
       continue;
     }
 
@@ -154,7 +183,7 @@ void MarkLive<ELFT>::scanEhFrameSection(EhInputSection &eh,
     uint64_t pieceEnd = piece.inputOff + piece.size;
     for (size_t j = firstRelI, end2 = rels.size(); j < end2; ++j)
       if (rels[j].r_offset < pieceEnd)
-        resolveReloc(eh, rels[j], true);
+        resolveReloc(eh, rels[j], true, queue);
   }
 }
 
@@ -176,8 +205,20 @@ static bool isReserved(InputSectionBase *sec) {
   }
 }
 
+// Sets the partition of a section to the main partition and returns true
+// if it was not in it, so that only one of the threads that find a section
+// live visits it.
+static bool markMainPartition(InputSectionBase *sec) {
+  static_assert(sizeof(std::atomic<uint8_t>) == sizeof(sec->partition),
+                "partition must be usable as an atomic");
+  auto *p = reinterpret_cast<std::atomic<uint8_t> *>(&sec->partition);
+  return p->load(std::memory_order_relaxed) != 1 &&
+         p->exchange(1, std::memory_order_relaxed) != 1;
+}
+
 template <class ELFT>
-void MarkLive<ELFT>::enqueue(InputSectionBase *sec, uint64_t offset) {
+void MarkLive<ELFT>::enqueue(InputSectionBase *sec, uint64_t offset,
+                             MarkQueue &q) {
   // Skip over discarded sections. This in theory shouldn't happen, because
   // the ELF spec doesn't allow a relocation to point to a deduplicated
   // COMDAT section directly. Unfortunately this happens in practice (e.g.
@@ -188,25 +229,36 @@ void MarkLive<ELFT>::enqueue(InputSectionBase *sec, uint64_t offset) {
   // Usually, a whole section is marked as live or dead, but in mergeable
   // (splittable) sections, each piece of data has independent liveness bit.
   // So we explicitly tell it which offset is in use.
-  if (auto *ms = dyn_cast<MergeInputSection>(sec))
-    ms->getSectionPiece(offset)->live = true;
+  if (auto *ms = dyn_cast<MergeInputSection>(sec)) {
+    SectionPiece *piece = ms->getSectionPiece(offset);
+    if (!parallel)
+      piece->live = true;
+    else if (!piece->live)
+      q.pieces.push_back(piece);
+  }
 
   // Set Sec->Partition to the meet (i.e. the "minimum") of Partition and
   // Sec->Partition in the following lattice: 1 < other < 0. If Sec->Partition
-  // doesn't change, we don't need to do anything.
-  if (sec->partition == 1 || sec->partition == partition)
-    return;
-  sec->partition = sec->partition ? 1 : partition;
+  // doesn't change, we don't need to do anything. The parallel marker only
+  // runs for the main partition, whose meet with anything is 1.
+  if (parallel) {
+    if (!markMainPartition(sec))
+      return;
+  } else {
+    if (sec->partition == 1 || sec->partition == partition)
+      return;
+    sec->partition = sec->partition ? 1 : partition;
+  }
 
   // Add input section to the queue.
   if (InputSection *s = dyn_cast<InputSection>(sec))
-    queue.push_back(s);
+    q.sections.push_back(s);
 }
 
 template <class ELFT> void MarkLive<ELFT>::markSymbol(Symbol *sym) {
   if (auto *d = dyn_cast_or_null<Defined>(sym))
     if (auto *isec = dyn_cast_or_null<InputSectionBase>(d->section))
-      enqueue(isec, d->value);
+      enqueue(isec, d->value, queue);
 }
 
 // This is the main function of the garbage collector.
@@ -258,7 +310,7 @@ template <class ELFT> void MarkLive<ELFT>::run() {
       continue;
 
     if (isReserved(sec) || script->shouldKeep(sec)) {
-      enqueue(sec, 0);
+      enqueue(sec, 0, queue);
     } else if (isValidCIdentifier(sec->name)) {
       cNamedSections[saver.save("__start_" + sec->name)].push_back(sec);
       cNamedSections[saver.save("__stop_" + sec->name)].push_back(sec);
@@ -268,22 +320,69 @@ template <class ELFT> void MarkLive<ELFT>::run() {
   mark();
 }
 
+template <class ELFT>
+void MarkLive<ELFT>::visit(InputSectionBase &sec, MarkQueue &q) {
+  if (sec.areRelocsRela) {
+    for (const typename ELFT::Rela &rel : sec.template relas<ELFT>())
+      resolveReloc(sec, rel, false, q);
+  } else {
+    for (const typename ELFT::Rel &rel : sec.template rels<ELFT>())
+      resolveReloc(sec, rel, false, q);
+  }
+
+  for (InputSectionBase *isec : sec.dependentSections)
+    enqueue(isec, 0, q);
+}
+
 template <class ELFT> void MarkLive<ELFT>::mark() {
+  if (partition == 1 && threadsEnabled) {
+    markParallel();
+    return;
+  }
+
   // Mark all reachable sections.
-  while (!queue.empty()) {
-    InputSectionBase &sec = *queue.pop_back_val();
-
-    if (sec.areRelocsRela) {
-      for (const typename ELFT::Rela &rel : sec.template relas<ELFT>())
-        resolveReloc(sec, rel, false);
-    } else {
-      for (const typename ELFT::Rel &rel : sec.template rels<ELFT>())
-        resolveReloc(sec, rel, false);
-    }
+  while (!queue.sections.empty()) {
+    InputSectionBase &sec = *queue.sections.back();
+    queue.sections.pop_back();
+    visit(sec, queue);
+  }
+}
+
+// Marks sections reachable from the queue in rounds. In each round, the
+// sections that were found live in the previous one are split into chunks
+// that are visited in parallel, each of which collects the sections it
+// finds live into its own queue.
+//
+// Each section is visited by the thread that changes its partition. Other
+// than that, threads only set SharedFile::isNeeded, which is only ever set to
+// true during marking, so it is not atomic. Symbol::used is set after each
+// round like the live bits of section pieces.
+template <class ELFT> void MarkLive<ELFT>::markParallel() {
+  const size_t chunkSize = 256;
+  parallel = true;
+
+  std::vector<InputSection *> current = std::move(queue.sections);
+  queue.sections.clear();
+  while (!current.empty()) {
+    size_t numChunks = (current.size() + chunkSize - 1) / chunkSize;
+    std::vector<MarkQueue> queues(numChunks);
+    parallelForEachN(0, numChunks, [&](size_t i) {
+      size_t end = std::min(current.size(), (i + 1) * chunkSize);
+      for (size_t j = i * chunkSize; j != end; ++j)
+        visit(*current[j], queues[i]);
+    });
 
-    for (InputSectionBase *isec : sec.dependentSections)
-      enqueue(isec, 0);
+    current.clear();
+    for (MarkQueue &q : queues) {
+      for (SectionPiece *piece : q.pieces)
+        piece->live = true;
+      for (Symbol *sym : q.usedSymbols)
+        sym->used = true;
+      current.insert(current.end(), q.sections.begin(), q.sections.end());
+    }
   }
+
+  parallel = false;
 }
 
 // Move the sections for some symbols to the main partition, specifically ifuncs
@@ -308,7 +407,7 @@ template <class ELFT> void MarkLive<ELFT>::moveToMain() {
       continue;
     if (symtab->find(("__start_" + sec->name).str()) ||
         symtab->find(("__stop_" + sec->name).str()))
-      enqueue(sec, 0);
+      enqueue(sec, 0, queue);
   }
 
   mark();
@@ -318,6 +417,8 @@ template <class ELFT> void MarkLive<ELFT>::moveToMain() {
 // input sections. This function make some or all of them on
 // so that they are emitted to the output file.
 template <class ELFT> void markLive() {
+  ScopedTimer t(gcTimer);
+
   // If -gc-sections is not given, no sections are removed.
   if (!config->gcSections) {
     for (InputSectionBase *sec : inputSections)
@@ -12,6 +12,7 @@
 #include "SymbolTable.h"
 #include "SyntheticSections.h"
 #include "Target.h"
+#include "Writer.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/Threads.h"
@@ -20,6 +21,12 @@
 #include "llvm/Support/MD5.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/SHA1.h"
+#ifdef LLD_HAS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef LLD_HAS_ZSTD
+#include <zstd.h>
+#endif
 
 using namespace llvm;
 using namespace llvm::dwarf;
@@ -27,6 +34,9 @@ using namespace llvm::object;
 using namespace llvm::support::endian;
 using namespace llvm::ELF;
 
+// Not defined by llvm/BinaryFormat/ELF.h yet.
+static constexpr uint32_t ELFCOMPRESS_ZSTD = 2;
+
 namespace lld {
 namespace elf {
 uint8_t *Out::bufferStart;
@@ -252,30 +262,160 @@ static void fill(uint8_t *buf, size_t size,
   memcpy(buf + i, filler.data(), size - i);
 }
 
+// Fill [Buf, Buf + Size) with nop instructions. This is used for the padding
+// after a section whose last jump was deleted by --optimize-bb-jumps, which
+// is executed.
+static void nopInstrFill(uint8_t *buf, size_t size) {
+  const std::vector<std::vector<uint8_t>> &nops = target->nopInstrs;
+  while (size) {
+    const std::vector<uint8_t> &nop = nops[std::min(size, nops.size()) - 1];
+    memcpy(buf, nop.data(), nop.size());
+    buf += nop.size();
+    size -= nop.size();
+  }
+}
+
+#ifdef LLD_HAS_ZLIB
+// Compresses a shard of a section into raw deflate data, without a zlib
+// header or trailer. Each shard but the last ends with a full flush, which
+// byte-aligns the output and resets the compression state, so that shards
+// compressed independently can be concatenated into one deflate stream.
+static SmallVector<uint8_t, 0> deflateShard(ArrayRef<uint8_t> in, int flush) {
+  z_stream s = {};
+  // A negative window size requests raw deflate data. 15 and 8 are the
+  // defaults.
+  if (deflateInit2(&s, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    fatal("compress failed: deflateInit2");
+  s.next_in = const_cast<uint8_t *>(in.data());
+  s.avail_in = in.size();
+
+  // Start with a buffer of half the input size, and grow it if that is not
+  // enough.
+  SmallVector<uint8_t, 0> out;
+  out.resize(std::max<size_t>(in.size() / 2, 64));
+  size_t pos = 0;
+  do {
+    if (pos == out.size())
+      out.resize(out.size() * 3 / 2);
+    s.next_out = out.data() + pos;
+    s.avail_out = out.size() - pos;
+    (void)deflate(&s, flush);
+    pos = s.next_out - out.data();
+  } while (s.avail_out == 0);
+  assert(s.avail_in == 0);
+
+  out.resize(pos);
+  deflateEnd(&s);
+  return out;
+}
+#endif
+
+#ifdef LLD_HAS_ZSTD
+// Compresses a shard of a section into a zstd frame. A zstd stream can
+// consist of any number of frames.
+static SmallVector<uint8_t, 0> zstdShard(ArrayRef<uint8_t> in) {
+  SmallVector<uint8_t, 0> out;
+  out.resize(ZSTD_compressBound(in.size()));
+  size_t n = ZSTD_compress(out.data(), out.size(), in.data(), in.size(),
+                           ZSTD_CLEVEL_DEFAULT);
+  if (ZSTD_isError(n))
+    fatal("compress failed: " + Twine(ZSTD_getErrorName(n)));
+  out.resize(n);
+  return out;
+}
+#endif
+
 // Compress section contents if this section contains debug info.
 template <class ELFT> void OutputSection::maybeCompress() {
   using Elf_Chdr = typename ELFT::Chdr;
 
   // Compress only DWARF debug sections.
-  if (!config->compressDebugSections || (flags & SHF_ALLOC) ||
-      !name.startswith(".debug_"))
+  if (config->compressDebugSections == DebugCompressionKind::None ||
+      (flags & SHF_ALLOC) || !name.startswith(".debug_"))
     return;
 
   // Create a section header.
   zDebugHeader.resize(sizeof(Elf_Chdr));
   auto *hdr = reinterpret_cast<Elf_Chdr *>(zDebugHeader.data());
-  hdr->ch_type = ELFCOMPRESS_ZLIB;
+  hdr->ch_type = config->compressDebugSections == DebugCompressionKind::Zstd
+                     ? ELFCOMPRESS_ZSTD
+                     : ELFCOMPRESS_ZLIB;
   hdr->ch_size = size;
   hdr->ch_addralign = alignment;
 
-  // Write section contents to a temporary buffer and compress it.
+  // If this section consists of one zlib-compressed input section that
+  // needs no relocation, the compressed data can be copied as it is.
+  if (config->compressDebugSections == DebugCompressionKind::Zlib) {
+    std::vector<InputSection *> sections = getInputSections(this);
+    if (sections.size() == 1) {
+      InputSection *isec = sections[0];
+      if (isec->isCompressed() && isec->numRelocations == 0 &&
+          isec->outSecOff == 0 && isec->getSize() == size) {
+        ArrayRef<uint8_t> data = isec->getCompressedData();
+        compressedShards.assign(1, SmallVector<uint8_t, 0>(data.begin(),
+                                                           data.end()));
+        size = zDebugHeader.size() + data.size();
+        flags |= SHF_COMPRESSED;
+        return;
+      }
+    }
+  }
+
+  // Write section contents to a temporary buffer and compress it. Large
+  // debug sections take much longer to compress than to link, so the buffer
+  // is split into shards that are compressed in parallel.
   std::vector<uint8_t> buf(size);
   writeTo<ELFT>(buf.data());
-  if (Error e = zlib::compress(toStringRef(buf), compressedData))
-    fatal("compress failed: " + llvm::toString(std::move(e)));
+
+  constexpr size_t shardSize = 1 << 20;
+  size_t numShards = std::max<size_t>(1, (size + shardSize - 1) / shardSize);
+  auto getShard = [&](size_t i) {
+    size_t off = i * shardSize;
+    return makeArrayRef(buf).slice(off, std::min(shardSize, buf.size() - off));
+  };
+  compressedShards.resize(numShards);
+
+  if (config->compressDebugSections == DebugCompressionKind::Zstd) {
+#ifdef LLD_HAS_ZSTD
+    parallelForEachN(0, numShards, [&](size_t i) {
+      compressedShards[i] = zstdShard(getShard(i));
+    });
+#endif
+  } else {
+#ifdef LLD_HAS_ZLIB
+    // The shards form a single deflate stream, which is wrapped in a zlib
+    // header and the Adler-32 checksum of the whole section.
+    std::vector<uint32_t> checksums(numShards);
+    parallelForEachN(0, numShards, [&](size_t i) {
+      ArrayRef<uint8_t> in = getShard(i);
+      compressedShards[i] =
+          deflateShard(in, i + 1 == numShards ? Z_FINISH : Z_FULL_FLUSH);
+      checksums[i] = adler32(1, in.data(), in.size());
+    });
+
+    uint32_t checksum = 1;
+    for (size_t i = 0; i < numShards; ++i)
+      checksum = adler32_combine(checksum, checksums[i], getShard(i).size());
+
+    // 0x78 0x9c is the zlib header for the default compression level.
+    zDebugHeader.push_back(0x78);
+    zDebugHeader.push_back(0x9c);
+    zDebugTrailer.resize(4);
+    write32be(zDebugTrailer.data(), checksum);
+#else
+    // zlib is only available through LLVM, which compresses serially.
+    SmallVector<char, 0> out;
+    if (Error e = zlib::compress(toStringRef(buf), out))
+      fatal("compress failed: " + llvm::toString(std::move(e)));
+    compressedShards.assign(1, SmallVector<uint8_t, 0>(out.begin(), out.end()));
+#endif
+  }
 
   // Update section headers.
-  size = sizeof(Elf_Chdr) + compressedData.size();
+  size = zDebugHeader.size() + zDebugTrailer.size();
+  for (const SmallVector<uint8_t, 0> &shard : compressedShards)
+    size += shard.size();
   flags |= SHF_COMPRESSED;
 }
 
@@ -299,10 +439,19 @@ template <class ELFT> void OutputSection::writeTo(uint8_t *buf) {
   // If -compress-debug-section is specified and if this is a debug seciton,
   // we've already compressed section contents. If that's the case,
   // just write it down.
-  if (!compressedData.empty()) {
+  if (!compressedShards.empty()) {
     memcpy(buf, zDebugHeader.data(), zDebugHeader.size());
-    memcpy(buf + zDebugHeader.size(), compressedData.data(),
-           compressedData.size());
+    std::vector<size_t> offsets(compressedShards.size());
+    size_t off = zDebugHeader.size();
+    for (size_t i = 0, e = compressedShards.size(); i != e; ++i) {
+      offsets[i] = off;
+      off += compressedShards[i].size();
+    }
+    parallelForEachN(0, compressedShards.size(), [&](size_t i) {
+      memcpy(buf + offsets[i], compressedShards[i].data(),
+             compressedShards[i].size());
+    });
+    memcpy(buf + off, zDebugTrailer.data(), zDebugTrailer.size());
     return;
   }
 
@@ -317,15 +466,23 @@ template <class ELFT> void OutputSection::writeTo(uint8_t *buf) {
     InputSection *isec = sections[i];
     isec->writeTo<ELFT>(buf);
 
+    // Synthetic sections may be written to by other sections later, such as
+    // .eh_frame_hdr by .eh_frame, so only regular sections are final here.
+    if (isec->kind() == SectionBase::Regular)
+      hashWrittenSection(buf + isec->outSecOff, isec->getSize());
+
     // Fill gaps between sections.
-    if (nonZeroFiller) {
+    if (nonZeroFiller || isec->nopFiller) {
       uint8_t *start = buf + isec->outSecOff + isec->getSize();
       uint8_t *end;
       if (i + 1 == sections.size())
         end = buf + size;
       else
         end = buf + sections[i + 1]->outSecOff;
-      fill(start, end - start, filler);
+      if (isec->nopFiller)
+        nopInstrFill(start, end - start);
+      else
+        fill(start, end - start, filler);
     }
   });
 
@@ -336,6 +493,182 @@ template <class ELFT> void OutputSection::writeTo(uint8_t *buf) {
       writeInt(buf + data->offset, data->expression().getValue(), data->size);
 }
 
+namespace {
+// A unit of work of writeOutputSections().
+struct WriteTask {
+  enum Kind {
+    // Writes input sections [begin, end) of an output section.
+    Sections,
+    // Copies bytes [begin, end) of the contents of an input section.
+    Contents,
+    // Copies the compressed shard `begin` to the offset `end`.
+    CompressedShard,
+  };
+
+  Kind kind;
+  size_t secIdx;
+  size_t isecIdx;
+  uint64_t begin;
+  uint64_t end;
+};
+
+struct RelocTask {
+  size_t secIdx;
+  InputSection *isec;
+  size_t shard;
+  size_t numShards;
+};
+} // namespace
+
+// The target size of a task. This is the same as the size of a chunk of
+// --build-id so that pieces of a large section can be hashed as they are.
+static const uint64_t writeTaskSize = 1024 * 1024;
+
+template <class ELFT>
+void writeOutputSections(ArrayRef<OutputSection *> sections) {
+  std::vector<std::vector<InputSection *>> inputs(sections.size());
+  std::vector<std::array<uint8_t, 4>> fillers(sections.size());
+  std::vector<WriteTask> tasks;
+  std::vector<RelocTask> relocTasks;
+
+  for (size_t secIdx = 0; secIdx != sections.size(); ++secIdx) {
+    OutputSection *sec = sections[secIdx];
+    if (sec->type == SHT_NOBITS)
+      continue;
+    uint8_t *buf = Out::bufferStart + sec->offset;
+
+    if (!sec->compressedShards.empty()) {
+      memcpy(buf, sec->zDebugHeader.data(), sec->zDebugHeader.size());
+      uint64_t off = sec->zDebugHeader.size();
+      for (size_t i = 0, e = sec->compressedShards.size(); i != e; ++i) {
+        tasks.push_back({WriteTask::CompressedShard, secIdx, 0, i, off});
+        off += sec->compressedShards[i].size();
+      }
+      memcpy(buf + off, sec->zDebugTrailer.data(), sec->zDebugTrailer.size());
+      continue;
+    }
+
+    // Write leading padding.
+    std::vector<InputSection *> &v = inputs[secIdx];
+    v = getInputSections(sec);
+    std::array<uint8_t, 4> filler = fillers[secIdx] = sec->getFiller();
+    if (read32(filler.data()) != 0)
+      fill(buf, v.empty() ? sec->size : v[0]->outSecOff, filler);
+
+    // Small input sections are batched, and large ones are split into
+    // pieces that end at writeTaskSize boundaries of the output file.
+    size_t begin = 0;
+    uint64_t batchSize = 0;
+    for (size_t i = 0, e = v.size(); i != e; ++i) {
+      InputSection *isec = v[i];
+      uint64_t size = isec->getSize();
+      if (size <= 4 * writeTaskSize || !isec->canSplitWrite()) {
+        batchSize += size;
+        if (batchSize >= writeTaskSize) {
+          tasks.push_back({WriteTask::Sections, secIdx, 0, begin, i + 1});
+          begin = i + 1;
+          batchSize = 0;
+        }
+        continue;
+      }
+
+      if (begin != i)
+        tasks.push_back({WriteTask::Sections, secIdx, 0, begin, i});
+      begin = i + 1;
+      batchSize = 0;
+
+      uint64_t start = sec->offset + isec->outSecOff;
+      for (uint64_t off = 0; off < size;) {
+        uint64_t end = std::min(size, alignTo(start + off + 1, writeTaskSize) -
+                                          start);
+        tasks.push_back({WriteTask::Contents, secIdx, i, off, end});
+        off = end;
+      }
+
+      size_t numShards =
+          isec->getNumRelocShards<ELFT>(size / writeTaskSize);
+      for (size_t shard = 0; shard != numShards; ++shard)
+        relocTasks.push_back({secIdx, isec, shard, numShards});
+    }
+    if (begin != v.size())
+      tasks.push_back({WriteTask::Sections, secIdx, 0, begin, v.size()});
+  }
+
+  // Fills the gap after the i-th input section of an output section.
+  auto fillGap = [&](size_t secIdx, size_t i) {
+    const std::array<uint8_t, 4> &filler = fillers[secIdx];
+    std::vector<InputSection *> &v = inputs[secIdx];
+    if (read32(filler.data()) == 0 && !v[i]->nopFiller)
+      return;
+    OutputSection *sec = sections[secIdx];
+    uint8_t *buf = Out::bufferStart + sec->offset;
+    uint8_t *start = buf + v[i]->outSecOff + v[i]->getSize();
+    uint8_t *end = buf + (i + 1 == v.size() ? sec->size : v[i + 1]->outSecOff);
+    if (v[i]->nopFiller)
+      nopInstrFill(start, end - start);
+    else
+      fill(start, end - start, filler);
+  };
+
+  // Relocations are applied to large sections only after all of their
+  // contents are copied.
+  parallelForEachN(0, tasks.size(), [&](size_t i) {
+    const WriteTask &t = tasks[i];
+    OutputSection *sec = sections[t.secIdx];
+    uint8_t *buf = Out::bufferStart + sec->offset;
+    switch (t.kind) {
+    case WriteTask::Sections:
+      for (size_t j = t.begin; j != t.end; ++j) {
+        InputSection *isec = inputs[t.secIdx][j];
+        isec->writeTo<ELFT>(buf);
+
+        // Synthetic sections may be written to by other sections later, such
+        // as .eh_frame_hdr by .eh_frame, so only regular sections are final
+        // here.
+        if (isec->kind() == SectionBase::Regular)
+          hashWrittenSection(buf + isec->outSecOff, isec->getSize());
+        fillGap(t.secIdx, j);
+      }
+      return;
+    case WriteTask::Contents: {
+      InputSection *isec = inputs[t.secIdx][t.isecIdx];
+      isec->copyContents(buf, t.begin, t.end);
+      if (t.end == isec->getSize())
+        fillGap(t.secIdx, t.isecIdx);
+      return;
+    }
+    case WriteTask::CompressedShard: {
+      const SmallVector<uint8_t, 0> &shard = sec->compressedShards[t.begin];
+      memcpy(buf + t.end, shard.data(), shard.size());
+      return;
+    }
+    }
+  });
+
+  parallelForEachN(0, relocTasks.size(), [&](size_t i) {
+    const RelocTask &t = relocTasks[i];
+    t.isec->relocateShard<ELFT>(Out::bufferStart + sections[t.secIdx]->offset,
+                                t.shard, t.numShards);
+  });
+
+  parallelForEachN(0, tasks.size(), [&](size_t i) {
+    const WriteTask &t = tasks[i];
+    if (t.kind == WriteTask::Contents)
+      hashWrittenSection(Out::bufferStart + sections[t.secIdx]->offset +
+                             inputs[t.secIdx][t.isecIdx]->outSecOff + t.begin,
+                         t.end - t.begin);
+  });
+
+  // Linker scripts may have BYTE()-family commands with which you
+  // can write arbitrary bytes to the output. Process them if any.
+  for (OutputSection *sec : sections)
+    if (sec->type != SHT_NOBITS && sec->compressedShards.empty())
+      for (BaseCommand *base : sec->sectionCommands)
+        if (auto *data = dyn_cast<ByteCommand>(base))
+          writeInt(Out::bufferStart + sec->offset + data->offset,
+                   data->expression().getValue(), data->size);
+}
+
 static void finalizeShtGroup(OutputSection *os,
                              InputSection *section) {
   assert(config->relocatable);
@@ -492,6 +825,11 @@ template void OutputSection::writeTo<ELF32BE>(uint8_t *Buf);
 template void OutputSection::writeTo<ELF64LE>(uint8_t *Buf);
 template void OutputSection::writeTo<ELF64BE>(uint8_t *Buf);
 
+template void writeOutputSections<ELF32LE>(ArrayRef<OutputSection *>);
+template void writeOutputSections<ELF32BE>(ArrayRef<OutputSection *>);
+template void writeOutputSections<ELF64LE>(ArrayRef<OutputSection *>);
+template void writeOutputSections<ELF64BE>(ArrayRef<OutputSection *>);
+
 template void OutputSection::maybeCompress<ELF32LE>();
 template void OutputSection::maybeCompress<ELF32BE>();
 template void OutputSection::maybeCompress<ELF64LE>();
@@ -108,18 +108,30 @@ public:
   void sortInitFini();
   void sortCtorsDtors();
 
+  std::array<uint8_t, 4> getFiller();
+
 private:
-  // Used for implementation of --compress-debug-sections option.
+  // Used for implementation of --compress-debug-sections option. The
+  // section contents are the header, the compressed shards and the trailer.
   std::vector<uint8_t> zDebugHeader;
-  llvm::SmallVector<char, 1> compressedData;
+  std::vector<llvm::SmallVector<uint8_t, 0>> compressedShards;
+  std::vector<uint8_t> zDebugTrailer;
 
-  std::array<uint8_t, 4> getFiller();
+  template <class ELFT>
+  friend void writeOutputSections(ArrayRef<OutputSection *> sections);
 };
 
 int getPriority(StringRef s);
 
 std::vector<InputSection *> getInputSections(OutputSection* os);
 
+// Writes output sections to the output buffer. This is the same as calling
+// writeTo() for each of them, but the work is split into tasks of similar
+// sizes, so that many small sections or a few huge input sections are written
+// by all threads.
+template <class ELFT>
+void writeOutputSections(ArrayRef<OutputSection *> sections);
+
 // All output sections that are handled by the linker specially are
 // globally accessible. Writer initializes them, so don't use them
 // until Writer is initialized.
@@ -0,0 +1,265 @@
+//===- PassThrough.cpp ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --copy-file-range.
+//
+// Most of the output of a link with debug info consists of .debug_* sections
+// that are copied from the input files as they are, because they have no
+// relocations, or because only their relocations are changed, as with -r on
+// RELA targets. Writing them to the mmap'ed output buffer means copying them
+// from the page cache of the inputs to that of the output in user space.
+//
+// With --copy-file-range, large non-SHF_ALLOC sections like that are left out
+// of the output buffer, which is therefore sparse, and are copied from the
+// input files to the output file once the buffer is committed. The copy uses
+// the FICLONERANGE ioctl if the file system can share the blocks, and
+// copy_file_range(2) otherwise, so the kernel does the copy, and on some file
+// systems no data is copied at all. If neither works, the bytes are written
+// from the mmap'ed input.
+//
+// The input files must not change during the link, which is already assumed
+// since they are mmap'ed. This is only implemented for Linux.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassThrough.h"
+#include "Config.h"
+#include "InputSection.h"
+#include "OutputSections.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+using namespace llvm::ELF;
+
+namespace lld {
+namespace elf {
+
+std::vector<std::pair<std::string, MemoryBufferRef>> passThroughInputs;
+
+namespace {
+// A section that is copied to the output file from an input file.
+struct PassThroughRange {
+  uint64_t outOff;
+  ArrayRef<uint8_t> data;
+  // The index of the input file in passThroughInputs and the offset of the
+  // section in it.
+  size_t input;
+  uint64_t inOff;
+};
+} // namespace
+
+static std::vector<PassThroughRange> ranges;
+
+// Smaller sections are not worth a system call.
+static const uint64_t minSize = 64 * 1024;
+
+// Returns true if `isec` is written to the output as it is in its file.
+static bool isUnmodified(InputSection *isec) {
+  if (isec->kind() != SectionBase::Regular || isec->isCompressed() ||
+      (isec->flags & SHF_ALLOC))
+    return false;
+  if (isec->type == SHT_NOBITS || isec->type == SHT_REL ||
+      isec->type == SHT_RELA || isec->type == SHT_GROUP)
+    return false;
+
+  // With -r on a RELA target, the addends of the relocations are written to
+  // the output relocation section, and the section contents are unchanged.
+  if (config->relocatable && config->isRela)
+    return true;
+  return isec->numRelocations == 0;
+}
+
+void selectPassThroughSections() {
+  ranges.clear();
+#if defined(__linux__)
+  // An incremental link patches the output in place, so it needs all of it
+  // in the buffer.
+  if (!config->copyFileRange || config->incremental ||
+      passThroughInputs.empty() || config->outputFile == "-")
+    return;
+
+  // A special file, such as /dev/null, is written from an in-memory buffer,
+  // so there is no file to copy into.
+  if (sys::fs::exists(config->outputFile) &&
+      !sys::fs::is_regular_file(config->outputFile))
+    return;
+
+  // The input that contains a section is looked up by address.
+  std::vector<std::pair<const char *, size_t>> starts;
+  for (size_t i = 0, e = passThroughInputs.size(); i != e; ++i)
+    starts.push_back({passThroughInputs[i].second.getBufferStart(), i});
+  llvm::sort(starts);
+
+  for (OutputSection *os : outputSections) {
+    if ((os->flags & SHF_ALLOC) || (os->flags & SHF_COMPRESSED) ||
+        os->type == SHT_NOBITS)
+      continue;
+
+    for (InputSection *isec : getInputSections(os)) {
+      if (!isUnmodified(isec))
+        continue;
+      ArrayRef<uint8_t> data = isec->data();
+      if (data.size() < minSize)
+        continue;
+
+      auto it = llvm::partition_point(
+          starts, [&](const std::pair<const char *, size_t> &s) {
+            return s.first <= (const char *)data.data();
+          });
+      if (it == starts.begin())
+        continue;
+      --it;
+      MemoryBufferRef mb = passThroughInputs[it->second].second;
+      const char *begin = (const char *)data.data();
+      if (begin + data.size() > mb.getBufferEnd())
+        continue;
+
+      isec->passThrough = true;
+      ranges.push_back({os->offset + isec->outSecOff, data, it->second,
+                        uint64_t(begin - mb.getBufferStart())});
+    }
+  }
+
+  llvm::sort(ranges, [](const PassThroughRange &a, const PassThroughRange &b) {
+    return a.outOff < b.outOff;
+  });
+#endif
+}
+
+ArrayRef<uint8_t> getPassThroughContents(ArrayRef<uint8_t> chunk,
+                                         std::vector<uint8_t> &scratch) {
+  if (ranges.empty() || chunk.data() < Out::bufferStart)
+    return chunk;
+
+  uint64_t begin = chunk.data() - Out::bufferStart;
+  uint64_t end = begin + chunk.size();
+  auto it = llvm::partition_point(ranges, [=](const PassThroughRange &r) {
+    return r.outOff + r.data.size() <= begin;
+  });
+  if (it == ranges.end() || it->outOff >= end)
+    return chunk;
+
+  scratch.assign(chunk.begin(), chunk.end());
+  for (; it != ranges.end() && it->outOff < end; ++it) {
+    uint64_t from = std::max(begin, it->outOff);
+    uint64_t to = std::min(end, it->outOff + it->data.size());
+    memcpy(scratch.data() + (from - begin),
+           it->data.data() + (from - it->outOff), to - from);
+  }
+  return scratch;
+}
+
+#if defined(__linux__)
+// Copies a range with FICLONERANGE or copy_file_range(2). Returns the number
+// of bytes copied, which may be less than the size of the range.
+static uint64_t copyRange(int in, int out, const PassThroughRange &r) {
+  uint64_t done = 0;
+  uint64_t size = r.data.size();
+
+#ifdef FICLONERANGE
+  // Cloning works on whole blocks except at the end of the source file,
+  // so only the aligned part of the range is cloned.
+  const uint64_t blockSize = 4096;
+  if (r.inOff % blockSize == 0 && r.outOff % blockSize == 0 &&
+      size >= blockSize) {
+    struct file_clone_range arg;
+    arg.src_fd = in;
+    arg.src_offset = r.inOff;
+    arg.src_length = alignDown(size, blockSize);
+    arg.dest_offset = r.outOff;
+    if (ioctl(out, FICLONERANGE, &arg) == 0)
+      done = arg.src_length;
+  }
+#endif
+
+#ifdef SYS_copy_file_range
+  while (done < size) {
+    loff_t inOff = r.inOff + done;
+    loff_t outOff = r.outOff + done;
+    ssize_t n = syscall(SYS_copy_file_range, in, &inOff, out, &outOff,
+                        size - done, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    done += n;
+  }
+#endif
+  return done;
+}
+
+// Writes the rest of a range from the mmap'ed input.
+static void writeRange(int out, const PassThroughRange &r, uint64_t done) {
+  while (done < r.data.size()) {
+    ssize_t n = pwrite(out, r.data.data() + done, r.data.size() - done,
+                       r.outOff + done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      error("failed to write to the output file: " +
+            std::string(strerror(n < 0 ? errno : EIO)));
+      return;
+    }
+    done += n;
+  }
+}
+#endif
+
+void copyPassThroughSections() {
+#if defined(__linux__)
+  if (ranges.empty())
+    return;
+
+  int out;
+  if (std::error_code ec = sys::fs::openFileForWrite(
+          config->outputFile, out, sys::fs::CD_OpenExisting,
+          sys::fs::OF_None)) {
+    error("cannot open " + config->outputFile + ": " + ec.message());
+    return;
+  }
+
+  // Each input is opened once. If it cannot be, its sections are written
+  // from memory.
+  std::vector<int> fds(passThroughInputs.size(), -1);
+  for (const PassThroughRange &r : ranges) {
+    int &fd = fds[r.input];
+    if (fd == -1 &&
+        sys::fs::openFileForRead(passThroughInputs[r.input].first, fd))
+      fd = -2;
+  }
+
+  parallelForEach(ranges, [&](const PassThroughRange &r) {
+    int in = fds[r.input];
+    writeRange(out, r, in >= 0 ? copyRange(in, out, r) : 0);
+  });
+
+  for (int fd : fds)
+    if (fd >= 0)
+      sys::Process::SafelyCloseFileDescriptor(fd);
+  if (std::error_code ec = sys::Process::SafelyCloseFileDescriptor(out))
+    error("failed to write to the output file: " + ec.message());
+  log("copy-file-range: copied " + Twine(ranges.size()) + " sections");
+#endif
+}
+
+} // namespace elf
+} // namespace lld
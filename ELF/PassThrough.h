@@ -0,0 +1,43 @@
+//===- PassThrough.h --------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_PASS_THROUGH_H
+#define LLD_ELF_PASS_THROUGH_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lld {
+namespace elf {
+
+// The files read by the link with --copy-file-range, whose sections may be
+// copied to the output file directly from disk.
+extern std::vector<std::pair<std::string, MemoryBufferRef>> passThroughInputs;
+
+// Selects the input sections that are copied to the output file after it is
+// committed instead of being written to the output buffer. Must be called
+// after file offsets are assigned.
+void selectPassThroughSections();
+
+// Returns the contents of a part of the output buffer as they will be in the
+// output file. If the part overlaps a section selected above, it is copied to
+// `scratch` together with the section's contents.
+ArrayRef<uint8_t> getPassThroughContents(ArrayRef<uint8_t> chunk,
+                                         std::vector<uint8_t> &scratch);
+
+// Copies the selected sections to the committed output file.
+void copyPassThroughSections();
+
+} // namespace elf
+} // namespace lld
+
+#endif
@@ -0,0 +1,156 @@
+//===- Prefetch.cpp -------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --prefetch-inputs.
+//
+// Input files are mapped into memory and their pages are faulted in when the
+// linker first reads them, which happens on one thread while the files are
+// parsed. On a cold page cache, and in particular on network file systems,
+// parsing then waits for one page after another.
+//
+// With --prefetch-inputs=willneed, each file is madvise'd with MADV_WILLNEED
+// as soon as it is mapped, which starts asynchronous readahead of the whole
+// file while the rest of the command line is processed. Archives are
+// prefetched as a whole, including members that may not be used.
+//
+// --prefetch-inputs=prefault additionally touches every page of the inputs
+// from all threads once all of them are open, so that parsing does not take
+// any page faults that need I/O.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Prefetch.h"
+#include "Config.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include <chrono>
+
+#ifdef LLVM_ON_UNIX
+#include <sys/mman.h>
+#endif
+
+using namespace llvm;
+
+namespace lld {
+namespace elf {
+
+std::vector<MemoryBufferRef> prefetchedInputs;
+
+static Timer prefaultTimer("Prefault Inputs", Timer::root());
+
+// Returns the page-aligned range that contains a buffer.
+static std::pair<uintptr_t, size_t> getPages(MemoryBufferRef mb) {
+  uint64_t pageSize = sys::Process::getPageSizeEstimate();
+  uintptr_t begin = alignDown((uintptr_t)mb.getBufferStart(), pageSize);
+  uintptr_t end = alignTo((uintptr_t)mb.getBufferEnd(), pageSize);
+  return {begin, end - begin};
+}
+
+void prefetchInput(MemoryBufferRef mb) {
+  if (config->prefetchInputs == PrefetchKind::None ||
+      mb.getBufferSize() == 0)
+    return;
+
+  // Reading ahead adds to the resident set before the file is needed.
+  if (isNearMemoryBudget()) {
+    addMemoryThrottleCount();
+    return;
+  }
+  prefetchedInputs.push_back(mb);
+
+#ifdef LLVM_ON_UNIX
+  // A small file may have been read into the heap rather than mapped, in
+  // which case this has no effect.
+  std::pair<uintptr_t, size_t> pages = getPages(mb);
+  posix_madvise((void *)pages.first, pages.second, POSIX_MADV_WILLNEED);
+#endif
+}
+
+// Returns the number of bytes of a buffer that are in memory.
+static uint64_t getResidentSize(MemoryBufferRef mb) {
+#if defined(__linux__)
+  uint64_t pageSize = sys::Process::getPageSizeEstimate();
+  std::pair<uintptr_t, size_t> pages = getPages(mb);
+  std::vector<unsigned char> vec(pages.second / pageSize);
+  if (mincore((void *)pages.first, pages.second, vec.data()))
+    return 0;
+  uint64_t ret = 0;
+  for (unsigned char c : vec)
+    if (c & 1)
+      ret += pageSize;
+  return ret;
+#else
+  return 0;
+#endif
+}
+
+void prefaultInputs() {
+  if (config->prefetchInputs == PrefetchKind::None)
+    return;
+
+  uint64_t totalSize = 0;
+  for (MemoryBufferRef mb : prefetchedInputs)
+    totalSize += mb.getBufferSize();
+
+  // Counting resident pages is not free, so do it only if it is logged.
+  if (errorHandler().verbose) {
+    std::vector<uint64_t> resident(prefetchedInputs.size());
+    parallelForEachN(0, prefetchedInputs.size(), [&](size_t i) {
+      resident[i] = getResidentSize(prefetchedInputs[i]);
+    });
+    uint64_t residentSize = 0;
+    for (uint64_t size : resident)
+      residentSize += size;
+    log("prefetch-inputs: " + Twine(prefetchedInputs.size()) + " files, " +
+        Twine(totalSize) + " bytes, " + Twine(residentSize) +
+        " bytes already in memory");
+  }
+
+  // Prefaulting brings all the inputs into memory at once, so it is skipped
+  // if they don't fit in the memory budget.
+  if (config->prefetchInputs == PrefetchKind::Prefault &&
+      totalSize > getMemoryHeadroom()) {
+    addMemoryThrottleCount();
+    log("prefetch-inputs: not prefaulting " + Twine(totalSize) +
+        " bytes, which exceed the memory budget");
+  } else if (config->prefetchInputs == PrefetchKind::Prefault) {
+    ScopedTimer t(prefaultTimer);
+    auto start = std::chrono::steady_clock::now();
+
+    // Split the inputs so that large files are spread over threads.
+    const size_t chunkSize = 1024 * 1024;
+    std::vector<ArrayRef<uint8_t>> chunks;
+    for (MemoryBufferRef mb : prefetchedInputs) {
+      ArrayRef<uint8_t> data = arrayRefFromStringRef(mb.getBuffer());
+      for (size_t off = 0; off < data.size(); off += chunkSize)
+        chunks.push_back(data.slice(off, std::min(chunkSize,
+                                                  data.size() - off)));
+    }
+
+    uint64_t pageSize = sys::Process::getPageSizeEstimate();
+    parallelForEach(chunks, [&](ArrayRef<uint8_t> chunk) {
+      for (size_t off = 0; off < chunk.size(); off += pageSize)
+        (void)*(volatile const uint8_t *)(chunk.data() + off);
+    });
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    log("prefetch-inputs: prefaulted " + Twine(totalSize) + " bytes in " +
+        Twine(elapsed.count()) + " ms");
+  }
+
+  prefetchedInputs.clear();
+}
+
+} // namespace elf
+} // namespace lld
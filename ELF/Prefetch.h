@@ -0,0 +1,34 @@
+//===- Prefetch.h -----------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_PREFETCH_H
+#define LLD_ELF_PREFETCH_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <vector>
+
+namespace lld {
+namespace elf {
+
+// The files that prefetchInput() was called for.
+extern std::vector<MemoryBufferRef> prefetchedInputs;
+
+// With --prefetch-inputs, asks the kernel to start reading a file that was
+// just mapped into memory, so that the I/O overlaps with opening the rest of
+// the inputs.
+void prefetchInput(MemoryBufferRef mb);
+
+// With --prefetch-inputs=prefault, touches every page of the prefetched files
+// in parallel before they are parsed. Also logs prefetch statistics.
+void prefaultInputs();
+
+} // namespace elf
+} // namespace lld
+
+#endif
@@ -0,0 +1,114 @@
+//===- ReleaseMemory.cpp --------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --release-input-memory.
+//
+// Input files stay mapped until the linker exits. Their pages are part of
+// the resident set once they have been read, so while the output is written,
+// the peak memory usage of the linker is roughly the size of the inputs plus
+// the size of the output. That matters when many large programs are linked
+// in parallel on the same machine.
+//
+// Once an output section has been written, the contents of its input
+// sections are no longer needed. With --release-input-memory, the pages that
+// only hold those contents are released with MADV_DONTNEED. The files stay
+// mapped, so if anything reads the pages again, the kernel reads them back
+// from the page cache or the file. Only files that are really mapped into
+// memory can be released this way, because madvise would clear the heap
+// memory that small files are read into. The relocation vectors of the input
+// sections are freed as well.
+//
+// The memory is released the same way under --memory-budget once the
+// resident set of the linker comes close to the budget.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ReleaseMemory.h"
+#include "Config.h"
+#include "InputSection.h"
+#include "OutputSections.h"
+#include "SyntheticSections.h"
+#include "lld/Common/Threads.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+
+#ifdef LLVM_ON_UNIX
+#include <sys/mman.h>
+#endif
+
+using namespace llvm;
+
+namespace lld {
+namespace elf {
+
+std::vector<MemoryBufferRef> mappedInputs;
+
+void addMappedInput(const MemoryBuffer &mb) {
+  if ((!config->releaseInputMemory && !config->memoryBudget) ||
+      mb.getBufferKind() != MemoryBuffer::MemoryBuffer_MMap)
+    return;
+  mappedInputs.push_back(mb.getMemBufferRef());
+}
+
+void sortMappedInputs() {
+  llvm::sort(mappedInputs, [](MemoryBufferRef a, MemoryBufferRef b) {
+    return a.getBufferStart() < b.getBufferStart();
+  });
+}
+
+// Returns true if [begin, end) is in a file that is mapped into memory.
+static bool isMapped(const uint8_t *begin, const uint8_t *end) {
+  auto it = llvm::upper_bound(
+      mappedInputs, (const char *)begin,
+      [](const char *p, MemoryBufferRef mb) { return p < mb.getBufferStart(); });
+  if (it == mappedInputs.begin())
+    return false;
+  --it;
+  return (const char *)end <= it->getBufferEnd();
+}
+
+void releaseInputMemory(OutputSection *sec) {
+  // Under --memory-budget, the memory is released once the budget is close.
+  if (!config->releaseInputMemory) {
+    if (!isNearMemoryBudget())
+      return;
+    addMemoryThrottleCount();
+  }
+
+  uint64_t pageSize = sys::Process::getPageSizeEstimate();
+  for (InputSection *isec : getInputSections(sec)) {
+    if (isa<SyntheticSection>(isec))
+      continue;
+
+    // Incremental links record facts about the relocations after the output
+    // is written.
+    if (!config->incremental)
+      std::vector<Relocation>().swap(isec->relocations);
+
+    // A compressed section is uncompressed into the heap, which is freed at
+    // exit.
+    if (isec->isCompressed())
+      continue;
+    ArrayRef<uint8_t> data = isec->data();
+    if (data.empty() || !isMapped(data.begin(), data.end()))
+      continue;
+
+    // Pages that are shared with other sections or headers are kept.
+    uintptr_t begin = alignTo((uintptr_t)data.begin(), pageSize);
+    uintptr_t end = alignDown((uintptr_t)data.end(), pageSize);
+    if (begin >= end)
+      continue;
+#ifdef LLVM_ON_UNIX
+    madvise((void *)begin, end - begin, MADV_DONTNEED);
+#endif
+  }
+}
+
+} // namespace elf
+} // namespace lld
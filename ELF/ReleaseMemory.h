@@ -0,0 +1,38 @@
+//===- ReleaseMemory.h ------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_RELEASE_MEMORY_H
+#define LLD_ELF_RELEASE_MEMORY_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <vector>
+
+namespace lld {
+namespace elf {
+
+class OutputSection;
+
+// The input files that are mapped into memory rather than read into the heap.
+extern std::vector<MemoryBufferRef> mappedInputs;
+
+// With --release-input-memory, remembers a file if it is mapped into memory.
+void addMappedInput(const MemoryBuffer &mb);
+
+// Sorts mappedInputs by address. Must be called before the output is written,
+// since releaseInputMemory is called from the threads that write partitions.
+void sortMappedInputs();
+
+// With --release-input-memory, releases the memory of the input sections of
+// an output section that has been written.
+void releaseInputMemory(OutputSection *sec);
+
+} // namespace elf
+} // namespace lld
+
+#endif
@@ -52,6 +52,7 @@
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/raw_ostream.h"
@@ -479,13 +480,11 @@ static SmallSet<SharedSymbol *, 4> getSymbolsAt(SharedSymbol &ss) {
   using Elf_Sym = typename ELFT::Sym;
 
   SharedFile &file = ss.getFile();
+  ArrayRef<Elf_Sym> syms = file.template getGlobalELFSyms<ELFT>();
 
   SmallSet<SharedSymbol *, 4> ret;
-  for (const Elf_Sym &s : file.template getGlobalELFSyms<ELFT>()) {
-    if (s.st_shndx == SHN_UNDEF || s.st_shndx == SHN_ABS ||
-        s.getType() == STT_TLS || s.st_value != ss.value)
-      continue;
-    StringRef name = check(s.getName(file.getStringTable()));
+  for (uint32_t i : file.template getSymbolsAt<ELFT>(ss.value)) {
+    StringRef name = check(syms[i].getName(file.getStringTable()));
     Symbol *sym = symtab->find(name);
     if (auto *alias = dyn_cast_or_null<SharedSymbol>(sym))
       ret.insert(alias);
@@ -505,10 +504,8 @@ static void replaceWithDefined(Symbol &sym, SectionBase *sec, uint64_t value,
   sym.replace(Defined{sym.file, sym.getName(), sym.binding, sym.stOther,
                       sym.type, value, size, sec});
 
-  sym.pltIndex = old.pltIndex;
-  sym.gotIndex = old.gotIndex;
+  sym.auxIdx = old.auxIdx;
   sym.verdefIndex = old.verdefIndex;
-  sym.ppc64BranchltIndex = old.ppc64BranchltIndex;
   sym.exportDynamic = true;
   sym.isUsedInRegularObj = true;
 }
@@ -835,10 +832,21 @@ template <class ELFT> void reportUndefinedSymbols() {
       firstRef[undef.sym] = &undef;
   }
 
-  // Enable spell corrector for the first 2 diagnostics.
-  for (auto it : enumerate(undefs))
-    if (!it.value().locs.empty())
-      reportUndefinedSymbol<ELFT>(it.value(), it.index() < 2);
+  // Looking up the source locations of the references parses debug info,
+  // which is the slow part, so the diagnostics are built in parallel. They
+  // are still printed in order. Batches of --error-limit diagnostics are
+  // built at a time, as the link stops once the limit is reached. Enable
+  // spell corrector for the first 2 diagnostics.
+  size_t batchSize = errorHandler().errorLimit;
+  if (batchSize == 0)
+    batchSize = undefs.size();
+  for (size_t begin = 0; begin < undefs.size(); begin += batchSize) {
+    size_t end = std::min(begin + batchSize, undefs.size());
+    parallelForEachN(begin, end, [&](size_t i) {
+      if (!undefs[i].locs.empty())
+        reportUndefinedSymbol<ELFT>(undefs[i], i < 2);
+    });
+  }
   undefs.clear();
 }
 
@@ -930,9 +938,11 @@ private:
 };
 } // namespace
 
+// If shard is given, the relocation is added to that shard of the dynamic
+// relocation section rather than to the section itself.
 static void addRelativeReloc(InputSectionBase *isec, uint64_t offsetInSec,
                              Symbol *sym, int64_t addend, RelExpr expr,
-                             RelType type) {
+                             RelType type, Optional<size_t> shard = None) {
   Partition &part = isec->getPartition();
 
   // Add a relative relocation. If relrDyn section is enabled, and the
@@ -943,11 +953,18 @@ static void addRelativeReloc(InputSectionBase *isec, uint64_t offsetInSec,
   // address.
   if (part.relrDyn && isec->alignment >= 2 && offsetInSec % 2 == 0) {
     isec->relocations.push_back({expr, type, offsetInSec, addend, sym});
-    part.relrDyn->relocs.push_back({isec, offsetInSec});
+    if (shard)
+      part.relrDyn->addRelocToShard(*shard, {isec, offsetInSec});
+    else
+      part.relrDyn->relocs.push_back({isec, offsetInSec});
     return;
   }
-  part.relaDyn->addReloc(target->relativeRel, isec, offsetInSec, sym, addend,
-                         expr, type);
+  if (shard)
+    part.relaDyn->addRelocToShard(*shard, target->relativeRel, isec,
+                                  offsetInSec, sym, addend, expr, type);
+  else
+    part.relaDyn->addReloc(target->relativeRel, isec, offsetInSec, sym,
+                           addend, expr, type);
 }
 
 template <class ELFT, class GotPltSection>
@@ -1131,9 +1148,10 @@ static void processRelocAux(InputSectionBase &sec, RelExpr expr, RelType type,
       if (!sym.isInPlt())
         addPltEntry<ELFT>(in.plt, in.gotPlt, in.relaPlt, target->pltRel, sym);
       if (!sym.isDefined())
-        replaceWithDefined(
-            sym, in.plt,
-            target->pltHeaderSize + target->pltEntrySize * sym.pltIndex, 0);
+        replaceWithDefined(sym, in.plt,
+                           target->pltHeaderSize +
+                               target->pltEntrySize * sym.aux().pltIndex,
+                           0);
       sym.needsPltAddr = true;
       sec.relocations.push_back({expr, type, offset, addend, &sym});
       return;
@@ -1161,6 +1179,38 @@ static void processRelocAux(InputSectionBase &sec, RelExpr expr, RelType type,
               getLocation(sec, sym, offset));
 }
 
+// Relaxes the AArch64 GOT load of a non-preemptible symbol that starts at rel
+// and ends at the relocation at i, so that the symbol doesn't need a GOT
+// entry. See canRelaxAArch64GotLoad(). Returns true and advances i if that
+// was done.
+//
+// -fix-cortex-a53-843419 copies the original instructions into patches, so
+// it is incompatible with this.
+template <class ELFT, class RelTy>
+static bool relaxAArch64Got(InputSectionBase &sec, OffsetGetter &getOffset,
+                            RelTy &rel, RelTy *&i, RelTy *end,
+                            Symbol &sym, uint64_t offset, int64_t addend) {
+  if (i == end || config->fixCortexA53Errata843419 || sym.isPreemptible ||
+      sym.isGnuIFunc() || !sym.isDefined() || isAbsoluteValue(sym))
+    return false;
+
+  const RelTy &next = *i;
+  if (next.getType(config->isMips64EL) != R_AARCH64_LD64_GOT_LO12_NC ||
+      next.getSymbol(config->isMips64EL) != rel.getSymbol(config->isMips64EL) ||
+      next.r_offset != rel.r_offset + 4 ||
+      rel.r_offset + 8 > sec.data().size() ||
+      computeAddend<ELFT>(next, end, sec, R_GOT, sym.isLocal()) != addend ||
+      !canRelaxAArch64GotLoad(sec.data().begin() + rel.r_offset))
+    return false;
+
+  sec.relocations.push_back(
+      {R_AARCH64_PAGE_PC, R_AARCH64_ADR_GOT_PAGE, offset, addend, &sym});
+  sec.relocations.push_back({R_AARCH64_RELAX_GOT, R_AARCH64_LD64_GOT_LO12_NC,
+                             getOffset.get(next.r_offset), addend, &sym});
+  ++i;
+  return true;
+}
+
 template <class ELFT, class RelTy>
 static void scanReloc(InputSectionBase &sec, OffsetGetter &getOffset, RelTy *&i,
                       RelTy *end) {
@@ -1218,6 +1268,10 @@ static void scanReloc(InputSectionBase &sec, OffsetGetter &getOffset, RelTy *&i,
   // Read an addend.
   int64_t addend = computeAddend<ELFT>(rel, end, sec, expr, sym.isLocal());
 
+  if (config->emachine == EM_AARCH64 && type == R_AARCH64_ADR_GOT_PAGE &&
+      relaxAArch64Got<ELFT>(sec, getOffset, rel, i, end, sym, offset, addend))
+    return;
+
   // Relax relocations.
   //
   // If we know that a PLT entry will be resolved within the same ELF module, we
@@ -1340,9 +1394,10 @@ static void scanReloc(InputSectionBase &sec, OffsetGetter &getOffset, RelTy *&i,
       // that's really needed to create the IRELATIVE is the section and value,
       // so ideally we should just need to copy those.
       auto *directSym = make<Defined>(cast<Defined>(sym));
+      directSym->auxIdx = -1;
       addPltEntry<ELFT>(in.iplt, in.igotPlt, in.relaIplt, target->iRelativeRel,
                         *directSym);
-      sym.pltIndex = directSym->pltIndex;
+      sym.allocateAux().pltIndex = directSym->aux().pltIndex;
     }
     if (needsGot(expr)) {
       // Redirect GOT accesses to point to the Igot.
@@ -1354,7 +1409,7 @@ static void scanReloc(InputSectionBase &sec, OffsetGetter &getOffset, RelTy *&i,
     } else if (!needsPlt(expr)) {
       // Make the ifunc's PLT entry canonical by changing the value of its
       // symbol to redirect all references to point to it.
-      unsigned entryOffset = sym.pltIndex * target->pltEntrySize;
+      unsigned entryOffset = sym.aux().pltIndex * target->pltEntrySize;
       if (config->zRetpolineplt)
         entryOffset += target->pltHeaderSize;
 
@@ -1404,11 +1459,114 @@ static void scanRelocs(InputSectionBase &sec, ArrayRef<RelTy> rels) {
                       });
 }
 
-template <class ELFT> void scanRelocations(InputSectionBase &s) {
+template <class ELFT>
+void scanRelocations(InputSectionBase &s, size_t begin) {
   if (s.areRelocsRela)
-    scanRelocs<ELFT>(s, s.relas<ELFT>());
+    scanRelocs<ELFT>(s, s.relas<ELFT>().slice(begin));
   else
-    scanRelocs<ELFT>(s, s.rels<ELFT>());
+    scanRelocs<ELFT>(s, s.rels<ELFT>().slice(begin));
+}
+
+// The subset of scanReloc for relocations that are resolved at link time and
+// only add an entry to sec.relocations, or that also need a relative dynamic
+// relocation, which is added to the given shard.  Returns false if the
+// relocation may need anything else: a GOT or PLT entry, another dynamic
+// relocation, TLS or ifunc handling, or a diagnostic.
+template <class ELFT, class RelTy>
+static bool scanLinkTimeReloc(InputSectionBase &sec, OffsetGetter &getOffset,
+                              const RelTy *i, const RelTy *end, size_t shard) {
+  const RelTy &rel = *i;
+  ObjFile<ELFT> *file = sec.getFile<ELFT>();
+  uint32_t symIndex = rel.getSymbol(config->isMips64EL);
+  if (symIndex >= file->getSymbols().size())
+    return false;
+  Symbol &sym = file->getSymbol(symIndex);
+  RelType type = rel.getType(config->isMips64EL);
+
+  uint64_t offset = getOffset.get(rel.r_offset);
+  if (offset == uint64_t(-1))
+    return true;
+
+  if (symIndex != 0 && sym.isUndefined() && !sym.isWeak())
+    return false;
+  if (sym.isGnuIFunc() || sym.isTls())
+    return false;
+
+  const uint8_t *relocatedAddr = sec.data().begin() + rel.r_offset;
+  RelExpr expr = target->getRelExpr(type, sym, relocatedAddr);
+  if (oneof<R_HINT, R_NONE>(expr))
+    return true;
+  if (config->emachine == EM_PPC64 && isPPC64SmallCodeModelTocReloc(type))
+    return false;
+
+  int64_t addend = computeAddend<ELFT>(rel, end, sec, expr, sym.isLocal());
+
+  if (!sym.isPreemptible) {
+    if (expr == R_GOT_PC && !isAbsoluteValue(sym)) {
+      expr = target->adjustRelaxExpr(type, relocatedAddr, expr);
+    } else {
+      if (config->emachine == EM_PPC && expr == R_PPC32_PLTREL)
+        addend = 0;
+      expr = fromPlt(expr);
+    }
+  }
+
+  if (needsPlt(expr) || needsGot(expr) ||
+      oneof<R_GOTPLTONLY_PC, R_GOTPLTREL, R_GOTPLT, R_TLSGD_GOTPLT,
+            R_GOTONLY_PC, R_GOTREL, R_PPC64_TOCBASE, R_PPC64_RELAX_TOC>(expr))
+    return false;
+
+  if (!config->shared && sym.isUndefWeak()) {
+    sec.relocations.push_back({expr, type, offset, addend, &sym});
+    return true;
+  }
+  // isStaticLinkTimeConstant reports relative relocations to absolute
+  // symbols, which are left for scanReloc.
+  if (isAbsoluteValue(sym) && isRelExpr(expr))
+    return false;
+  if (isStaticLinkTimeConstant(expr, type, sym, sec, offset)) {
+    sec.relocations.push_back({expr, type, offset, addend, &sym});
+    return true;
+  }
+
+  // This is the relative relocation case of processRelocAux, which is the
+  // most common dynamic relocation in a PIE or a shared object.
+  bool canWrite = (sec.flags & SHF_WRITE) || !config->zText;
+  if (!canWrite || sym.isPreemptible ||
+      target->getDynRel(type) != target->symbolicRel)
+    return false;
+  addRelativeReloc(&sec, offset, &sym, addend, expr, type, shard);
+  return true;
+}
+
+template <class ELFT, class RelTy>
+static size_t scanLinkTimeRelocs(InputSectionBase &sec, ArrayRef<RelTy> rels,
+                                 size_t shard) {
+  OffsetGetter getOffset(sec);
+  sec.relocations.reserve(rels.size());
+  for (size_t i = 0, e = rels.size(); i != e; ++i)
+    if (!scanLinkTimeReloc<ELFT>(sec, getOffset, &rels[i], rels.end(), shard))
+      return i;
+
+  if (config->emachine == EM_RISCV ||
+      (config->emachine == EM_PPC64 && sec.name == ".toc"))
+    llvm::stable_sort(sec.relocations,
+                      [](const Relocation &lhs, const Relocation &rhs) {
+                        return lhs.offset < rhs.offset;
+                      });
+  return rels.size();
+}
+
+template <class ELFT>
+size_t scanLinkTimeRelocations(InputSectionBase &s, size_t shard) {
+  // MIPS handles GOT entries and relocation pairs differently, and the pieces
+  // of .eh_frame are only known to be valid by the serial scan.
+  if (config->emachine == EM_MIPS || isa<EhInputSection>(s) ||
+      !s.relocations.empty())
+    return 0;
+  if (s.areRelocsRela)
+    return scanLinkTimeRelocs<ELFT>(s, s.relas<ELFT>(), shard);
+  return scanLinkTimeRelocs<ELFT>(s, s.rels<ELFT>(), shard);
 }
 
 static bool mergeCmp(const InputSection *a, const InputSection *b) {
@@ -1741,6 +1899,102 @@ bool ThunkCreator::normalizeExistingThunk(Relocation &rel, uint64_t src) {
   return false;
 }
 
+// Records the address of every input section, and returns the ranges of
+// addresses, in terms of the previous pass, whose sections all moved by the
+// same amount since then.
+std::vector<ThunkCreator::AddressMove> ThunkCreator::updateSectionAddresses(
+    ArrayRef<OutputSection *> outputSections) {
+  std::vector<AddressMove> moves;
+  for (OutputSection *os : outputSections) {
+    // .tbss overlaps the sections that follow it.
+    if (!(os->flags & SHF_ALLOC) ||
+        ((os->flags & SHF_TLS) && os->type == SHT_NOBITS))
+      continue;
+    for (InputSection *isec : getInputSections(os)) {
+      uint64_t va = isec->getVA(0);
+      auto it = sectionAddrs.try_emplace(isec, va);
+      if (!it.second) {
+        moves.push_back({it.first->second, int64_t(va - it.first->second),
+                         true});
+        it.first->second = va;
+      }
+    }
+  }
+
+  llvm::sort(moves, [](const AddressMove &a, const AddressMove &b) {
+    return a.start < b.start;
+  });
+  std::vector<AddressMove> ret;
+  for (const AddressMove &m : moves) {
+    if (!ret.empty() && ret.back().start == m.start) {
+      // Empty sections at the same address that moved differently.
+      if (ret.back().delta != m.delta)
+        ret.back().valid = false;
+      continue;
+    }
+    if (ret.empty() || !ret.back().valid || ret.back().delta != m.delta)
+      ret.push_back(m);
+  }
+  return ret;
+}
+
+// Returns true if the relocations of a section do not need to be checked
+// again. That is the case if none of them needed a new thunk in the previous
+// pass, and the section and the sections that they refer to all moved by the
+// same amount since then, so that the distances between them are the same.
+bool ThunkCreator::canSkipSection(InputSection *isec,
+                                  ArrayRef<AddressMove> moves) {
+  auto it = sectionChecks.find(isec);
+  if (it == sectionChecks.end() || it->second.recheck)
+    return false;
+  SectionCheck &c = it->second;
+
+  auto m = llvm::partition_point(
+      moves, [&](const AddressMove &m) { return m.start <= c.lo; });
+  if (m == moves.begin())
+    return false;
+  if (m != moves.end() && m->start <= c.hi)
+    return false;
+  --m;
+  // Some targets care about the alignment of the branch and its target.
+  if (!m->valid || m->delta % 4 != 0)
+    return false;
+  c.lo += m->delta;
+  c.hi += m->delta;
+  return true;
+}
+
+// Adds the start address of the section that a relocation refers to to the
+// range [lo, hi], or returns false if the target does not move along with an
+// input section.
+static bool addTargetSection(const Relocation &rel, uint64_t &lo,
+                             uint64_t &hi) {
+  auto add = [&](InputSection *isec) {
+    uint64_t va = isec->getVA(0);
+    lo = std::min(lo, va);
+    hi = std::max(hi, va);
+  };
+
+  Symbol &sym = *rel.sym;
+  if (sym.isInPlt()) {
+    add(sym.isInIplt ? in.iplt : in.plt);
+    if (oneof<R_PLT_PC, R_PPC32_PLTREL, R_PPC64_CALL_PLT>(rel.expr))
+      return true;
+  }
+
+  auto *d = dyn_cast<Defined>(&sym);
+  if (!d || !d->section || d->isTls())
+    return false;
+  SectionBase *sec = d->section->repl;
+  if (auto *ms = dyn_cast<MergeInputSection>(sec))
+    sec = ms->getParent();
+  auto *isec = dyn_cast_or_null<InputSection>(sec);
+  if (!isec || !isec->getParent())
+    return false;
+  add(isec);
+  return true;
+}
+
 // Process all relocations from the InputSections that have been assigned
 // to InputSectionDescriptions and redirect through Thunks if needed. The
 // function should be called iteratively until it returns false.
@@ -1772,27 +2026,72 @@ bool ThunkCreator::createThunks(ArrayRef<OutputSection *> outputSections) {
   if (pass == 0 && target->getThunkSectionSpacing())
     createInitialThunkSections(outputSections);
 
+  // Most sections do not move relative to what their relocations refer to
+  // from one pass to the next, so only the others are checked again.
+  std::vector<AddressMove> moves = updateSectionAddresses(outputSections);
+  std::vector<InputSection *> sections;
+  forEachInputSectionDescription(
+      outputSections, [&](OutputSection *os, InputSectionDescription *isd) {
+        for (InputSection *isec : isd->sections)
+          if (!canSkipSection(isec, moves))
+            sections.push_back(isec);
+      });
+
+  // Find the relocations that need a new thunk. This is done in parallel
+  // since it does not create anything.
+  struct CheckResult {
+    std::vector<uint32_t> needThunk;
+    SectionCheck check;
+  };
+  std::vector<CheckResult> results(sections.size());
+  parallelForEachN(0, sections.size(), [&](size_t i) {
+    InputSection *isec = sections[i];
+    CheckResult &r = results[i];
+    r.check.lo = r.check.hi = isec->getVA(0);
+    r.check.recheck = false;
+
+    for (size_t j = 0, e = isec->relocations.size(); j != e; ++j) {
+      Relocation &rel = isec->relocations[j];
+      uint64_t src = isec->getVA(rel.offset);
+
+      // If we are a relocation to an existing Thunk, check if it is
+      // still in range. If not then Rel will be altered to point to its
+      // original target so another Thunk can be generated.
+      if (pass > 0) {
+        Symbol *sym = rel.sym;
+        if (normalizeExistingThunk(rel, src)) {
+          r.check.recheck |= !addTargetSection(rel, r.check.lo, r.check.hi);
+          continue;
+        }
+        r.check.recheck |= rel.sym != sym;
+      }
+
+      if (target->needsThunk(rel.expr, rel.type, isec->file, src, *rel.sym))
+        r.needThunk.push_back(j);
+      else
+        r.check.recheck |= !addTargetSection(rel, r.check.lo, r.check.hi);
+    }
+    r.check.recheck |= !r.needThunk.empty();
+  });
+
   // Create all the Thunks and insert them into synthetic ThunkSections. The
   // ThunkSections are later inserted back into InputSectionDescriptions.
   // We separate the creation of ThunkSections from the insertion of the
   // ThunkSections as ThunkSections are not always inserted into the same
   // InputSectionDescription as the caller.
+  size_t next = 0;
   forEachInputSectionDescription(
       outputSections, [&](OutputSection *os, InputSectionDescription *isd) {
-        for (InputSection *isec : isd->sections)
-          for (Relocation &rel : isec->relocations) {
+        for (InputSection *isec : isd->sections) {
+          if (next == sections.size() || sections[next] != isec)
+            continue;
+          CheckResult &r = results[next++];
+          sectionChecks[isec] = r.check;
+
+          for (uint32_t j : r.needThunk) {
+            Relocation &rel = isec->relocations[j];
             uint64_t src = isec->getVA(rel.offset);
 
-            // If we are a relocation to an existing Thunk, check if it is
-            // still in range. If not then Rel will be altered to point to its
-            // original target so another Thunk can be generated.
-            if (pass > 0 && normalizeExistingThunk(rel, src))
-              continue;
-
-            if (!target->needsThunk(rel.expr, rel.type, isec->file, src,
-                                    *rel.sym))
-              continue;
-
             Thunk *t;
             bool isNew;
             std::tie(t, isNew) = getThunk(isec, rel, src);
@@ -1817,6 +2116,7 @@ bool ThunkCreator::createThunks(ArrayRef<OutputSection *> outputSections) {
             if (config->emachine == EM_PPC && rel.type == R_PPC_PLTREL24)
               rel.addend = 0;
           }
+        }
 
         for (auto &p : isd->thunkSections)
           addressesChanged |= p.first->assignOffsets();
@@ -1831,10 +2131,14 @@ bool ThunkCreator::createThunks(ArrayRef<OutputSection *> outputSections) {
   return addressesChanged;
 }
 
-template void scanRelocations<ELF32LE>(InputSectionBase &);
-template void scanRelocations<ELF32BE>(InputSectionBase &);
-template void scanRelocations<ELF64LE>(InputSectionBase &);
-template void scanRelocations<ELF64BE>(InputSectionBase &);
+template void scanRelocations<ELF32LE>(InputSectionBase &, size_t);
+template void scanRelocations<ELF32BE>(InputSectionBase &, size_t);
+template void scanRelocations<ELF64LE>(InputSectionBase &, size_t);
+template void scanRelocations<ELF64BE>(InputSectionBase &, size_t);
+template size_t scanLinkTimeRelocations<ELF32LE>(InputSectionBase &, size_t);
+template size_t scanLinkTimeRelocations<ELF32BE>(InputSectionBase &, size_t);
+template size_t scanLinkTimeRelocations<ELF64LE>(InputSectionBase &, size_t);
+template size_t scanLinkTimeRelocations<ELF64BE>(InputSectionBase &, size_t);
 template void reportUndefinedSymbols<ELF32LE>();
 template void reportUndefinedSymbols<ELF32BE>();
 template void reportUndefinedSymbols<ELF64LE>();
@@ -79,6 +79,7 @@ enum RelExpr {
   // unique to a target. Such relocation are marked with R_<TARGET_NAME>.
   R_AARCH64_GOT_PAGE_PC,
   R_AARCH64_PAGE_PC,
+  R_AARCH64_RELAX_GOT,
   R_AARCH64_RELAX_TLS_GD_TO_IE_PAGE_PC,
   R_AARCH64_TLSDESC_PAGE,
   R_ARM_SBREL,
@@ -108,10 +109,32 @@ struct Relocation {
   Symbol *sym;
 };
 
+// A target-specific type of a jump instruction, used by --optimize-bb-jumps.
+using JumpModType = uint32_t;
+
+// Rewrites the opcode of a jump instruction at the given offset of an input
+// section to the given type, with a displacement of the given size in bytes.
+// This is used to flip and shrink the jumps at the ends of basic block
+// sections.
+struct JumpInstrMod {
+  uint64_t offset;
+  JumpModType type;
+  unsigned size;
+};
+
 // This function writes undefined symbol diagnostics to an internal buffer.
 // Call reportUndefinedSymbols() after calling scanRelocations() to emit
-// the diagnostics.
-template <class ELFT> void scanRelocations(InputSectionBase &);
+// the diagnostics.  Relocations before `begin` are skipped.
+template <class ELFT>
+void scanRelocations(InputSectionBase &, size_t begin = 0);
+
+// Scans the leading relocations of a section that are resolved at link time
+// without any GOT, PLT or dynamic relocation other than a relative one, and
+// returns how many there are.  The rest must be passed to scanRelocations().
+// This only modifies the section itself and the given shard of the dynamic
+// relocation sections, so it can run on many sections at once.
+template <class ELFT>
+size_t scanLinkTimeRelocations(InputSectionBase &, size_t shard);
 
 template <class ELFT> void reportUndefinedSymbols();
 
@@ -150,6 +173,19 @@ private:
 
   bool normalizeExistingThunk(Relocation &rel, uint64_t src);
 
+  // A range of addresses whose contents all moved by the same amount since
+  // the previous pass. The range extends up to the start of the next one.
+  struct AddressMove {
+    uint64_t start;
+    int64_t delta;
+    bool valid;
+  };
+
+  std::vector<AddressMove>
+  updateSectionAddresses(ArrayRef<OutputSection *> outputSections);
+
+  bool canSkipSection(InputSection *isec, ArrayRef<AddressMove> moves);
+
   // Record all the available Thunks for a Symbol
   llvm::DenseMap<std::pair<SectionBase *, uint64_t>, std::vector<Thunk *>>
       thunkedSymbolsBySection;
@@ -164,6 +200,22 @@ private:
   // so we need to make sure that there is only one of them.
   // The Mips LA25 Thunk is an example of an inline ThunkSection.
   llvm::DenseMap<InputSection *, ThunkSection *> thunkedSections;
+
+  // The addresses of all input sections in the previous pass.
+  llvm::DenseMap<InputSection *, uint64_t> sectionAddrs;
+
+  // What the previous pass found out about the relocations of a section
+  // that may need thunks. If none needed a new thunk and the sections that
+  // they refer to did not move relative to it, there is no need to check
+  // them again.
+  struct SectionCheck {
+    // The range of the start addresses of the section and the sections
+    // that its relocations refer to.
+    uint64_t lo;
+    uint64_t hi;
+    bool recheck;
+  };
+  llvm::DenseMap<InputSection *, SectionCheck> sectionChecks;
 };
 
 // Return a int64_t to make sure we get the sign extension out of the way as
@@ -32,6 +32,7 @@
 #include "llvm/Support/Path.h"
 #include <cassert>
 #include <limits>
+#include <type_traits>
 #include <vector>
 
 using namespace llvm;
@@ -41,6 +42,25 @@ using namespace llvm::support::endian;
 namespace lld {
 namespace elf {
 namespace {
+// An expression as it is being parsed. If it consists only of numbers and
+// operators, its value is known, and operators on such expressions are
+// folded into constants, so that the expressions of a script are nested
+// only as deep as their references to symbols and sections.
+struct ParsedExpr {
+  template <class Fn, class = typename std::enable_if<
+                          !std::is_same<Fn, ParsedExpr>::value>::type>
+  ParsedExpr(Fn f) : fn(std::move(f)) {}
+
+  static ParsedExpr constant(uint64_t val) {
+    ParsedExpr e([=] { return val; });
+    e.value = val;
+    return e;
+  }
+
+  Expr fn;
+  Optional<uint64_t> value;
+};
+
 class ScriptParser final : ScriptLexer {
 public:
   ScriptParser(MemoryBufferRef mb) : ScriptLexer(mb) {
@@ -107,12 +127,12 @@ private:
   uint64_t readMemoryAssignment(StringRef, StringRef, StringRef);
   std::pair<uint32_t, uint32_t> readMemoryAttributes();
 
-  Expr combine(StringRef op, Expr l, Expr r);
+  ParsedExpr combine(StringRef op, ParsedExpr l, ParsedExpr r);
   Expr readExpr();
-  Expr readExpr1(Expr lhs, int minPrec);
+  ParsedExpr readExpr1(ParsedExpr lhs, int minPrec);
   StringRef readParenLiteral();
-  Expr readPrimary();
-  Expr readTernary(Expr cond);
+  ParsedExpr readPrimary();
+  ParsedExpr readTernary(ParsedExpr cond);
   Expr readParenExpr();
 
   // For parsing version script.
@@ -945,12 +965,22 @@ Expr ScriptParser::readExpr() {
   // they apply different tokenization rules.
   bool orig = inExpr;
   inExpr = true;
-  Expr e = readExpr1(readPrimary(), 0);
+  Expr e = readExpr1(readPrimary(), 0).fn;
   inExpr = orig;
   return e;
 }
 
-Expr ScriptParser::combine(StringRef op, Expr l, Expr r) {
+ParsedExpr ScriptParser::combine(StringRef op, ParsedExpr lhs,
+                                 ParsedExpr rhs) {
+  // Operators on constants are evaluated now, except division by zero,
+  // which is an error only if the expression is used.
+  if (lhs.value && rhs.value && !((op == "/" || op == "%") && !*rhs.value)) {
+    Expr e = combine(op, lhs.fn, rhs.fn).fn;
+    return ParsedExpr::constant(e().getValue());
+  }
+
+  Expr l = lhs.fn;
+  Expr r = rhs.fn;
   if (op == "+")
     return [=] { return add(l(), r()); };
   if (op == "-")
@@ -1004,7 +1034,7 @@ Expr ScriptParser::combine(StringRef op, Expr l, Expr r) {
 
 // This is a part of the operator-precedence parser. This function
 // assumes that the remaining token stream starts with an operator.
-Expr ScriptParser::readExpr1(Expr lhs, int minPrec) {
+ParsedExpr ScriptParser::readExpr1(ParsedExpr lhs, int minPrec) {
   while (!atEOF() && !errorCount()) {
     // Read an operator and an expression.
     if (consume("?"))
@@ -1013,7 +1043,7 @@ Expr ScriptParser::readExpr1(Expr lhs, int minPrec) {
     if (precedence(op1) < minPrec)
       break;
     skip();
-    Expr rhs = readPrimary();
+    ParsedExpr rhs = readPrimary();
 
     // Evaluate the remaining part of the expression first if the
     // next operator has greater precedence than the previous one.
@@ -1117,21 +1147,30 @@ static void checkIfExists(OutputSection *cmd, StringRef location) {
     error(location + ": undefined section " + cmd->name);
 }
 
-Expr ScriptParser::readPrimary() {
-  if (peek() == "(")
-    return readParenExpr();
+ParsedExpr ScriptParser::readPrimary() {
+  if (consume("(")) {
+    ParsedExpr e = readExpr1(readPrimary(), 0);
+    expect(")");
+    return e;
+  }
 
   if (consume("~")) {
-    Expr e = readPrimary();
-    return [=] { return ~e().getValue(); };
+    ParsedExpr e = readPrimary();
+    if (e.value)
+      return ParsedExpr::constant(~*e.value);
+    return [=] { return ~e.fn().getValue(); };
   }
   if (consume("!")) {
-    Expr e = readPrimary();
-    return [=] { return !e().getValue(); };
+    ParsedExpr e = readPrimary();
+    if (e.value)
+      return ParsedExpr::constant(!*e.value);
+    return [=] { return !e.fn().getValue(); };
   }
   if (consume("-")) {
-    Expr e = readPrimary();
-    return [=] { return -e().getValue(); };
+    ParsedExpr e = readPrimary();
+    if (e.value)
+      return ParsedExpr::constant(-*e.value);
+    return [=] { return -e.fn().getValue(); };
   }
 
   StringRef tok = next();
@@ -1276,7 +1315,7 @@ Expr ScriptParser::readPrimary() {
 
   // Tok is a literal number.
   if (Optional<uint64_t> val = parseInt(tok))
-    return [=] { return *val; };
+    return ParsedExpr::constant(*val);
 
   // Tok is a symbol name.
   if (!isValidCIdentifier(tok))
@@ -1285,11 +1324,14 @@ Expr ScriptParser::readPrimary() {
   return [=] { return script->getSymbolValue(tok, location); };
 }
 
-Expr ScriptParser::readTernary(Expr cond) {
+ParsedExpr ScriptParser::readTernary(ParsedExpr cond) {
   Expr l = readExpr();
   expect(":");
   Expr r = readExpr();
-  return [=] { return cond().getValue() ? l() : r(); };
+  if (cond.value)
+    return *cond.value ? l : r;
+  Expr c = cond.fn;
+  return [=] { return c().getValue() ? l() : r(); };
 }
 
 Expr ScriptParser::readParenExpr() {
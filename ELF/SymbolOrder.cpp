@@ -0,0 +1,202 @@
+//===- SymbolOrder.cpp ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the binary form of --symbol-ordering-file.
+//
+// A symbol ordering file generated by a profiler can list millions of
+// symbols. Reading it means splitting it into lines, removing duplicates and
+// hashing every line into a map before the link can look up a single
+// symbol. The index written by --print-symbol-ordering-index does that once.
+// It is a little-endian file that consists of
+//
+//  - a header,
+//  - an open-addressed hash table of (hash, entry + 1) pairs, whose size is
+//    a power of two,
+//  - the entries, which are (offset, size) pairs of the names in the string
+//    table, in the order of the ordering file,
+//  - and the string table.
+//
+// so that the linker only hashes the names of the symbols it looks up.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SymbolOrder.h"
+#include "lld/Common/ErrorHandler.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <cstring>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::support;
+
+namespace lld {
+namespace elf {
+
+namespace {
+struct Header {
+  char magic[8];
+  ulittle32_t version;
+  ulittle32_t numSymbols;
+  ulittle32_t numBuckets;
+  ulittle32_t stringsSize;
+};
+
+struct Bucket {
+  ulittle32_t hash;
+  ulittle32_t entry;
+};
+
+struct Entry {
+  ulittle32_t offset;
+  ulittle32_t size;
+};
+} // namespace
+
+static const char magic[8] = {'\x7f', 'L', 'L', 'D', 'S', 'Y', 'M', 'O'};
+static const uint32_t version = 1;
+
+static const Header *getHeader(StringRef data) {
+  return reinterpret_cast<const Header *>(data.data());
+}
+
+static const Bucket *getBuckets(StringRef data) {
+  return reinterpret_cast<const Bucket *>(data.data() + sizeof(Header));
+}
+
+static const Entry *getEntries(StringRef data) {
+  return reinterpret_cast<const Entry *>(getBuckets(data) +
+                                         getHeader(data)->numBuckets);
+}
+
+static const char *getStrings(StringRef data) {
+  return reinterpret_cast<const char *>(getEntries(data) +
+                                        getHeader(data)->numSymbols);
+}
+
+static uint32_t hashName(StringRef name) { return xxHash64(name); }
+
+bool SymbolOrderIndex::isIndex(MemoryBufferRef mb) {
+  return mb.getBuffer().startswith(StringRef(magic, sizeof(magic)));
+}
+
+bool SymbolOrderIndex::verify(MemoryBufferRef mb) {
+  StringRef data = mb.getBuffer();
+  auto fail = [&](const Twine &msg) {
+    error(mb.getBufferIdentifier() + ": invalid symbol ordering index: " + msg);
+    return false;
+  };
+
+  if (data.size() < sizeof(Header))
+    return fail("file is too short");
+  const Header *hdr = getHeader(data);
+  if (hdr->version != version)
+    return fail("unsupported version " + Twine(hdr->version));
+  if (!isPowerOf2_32(hdr->numBuckets) || hdr->numBuckets <= hdr->numSymbols)
+    return fail("bad hash table size");
+
+  uint64_t size = sizeof(Header) + uint64_t(hdr->numBuckets) * sizeof(Bucket) +
+                  uint64_t(hdr->numSymbols) * sizeof(Entry) + hdr->stringsSize;
+  if (size != data.size())
+    return fail("file size does not match the header");
+
+  const Entry *entries = getEntries(data);
+  for (uint32_t i = 0, e = hdr->numSymbols; i != e; ++i)
+    if (uint64_t(entries[i].offset) + entries[i].size > hdr->stringsSize)
+      return fail("symbol name is out of bounds");
+
+  // find() stops at an empty bucket, so there must be one.
+  const Bucket *buckets = getBuckets(data);
+  uint32_t used = 0;
+  for (uint32_t i = 0, e = hdr->numBuckets; i != e; ++i) {
+    if (buckets[i].entry > hdr->numSymbols)
+      return fail("hash table entry is out of bounds");
+    if (buckets[i].entry != 0)
+      ++used;
+  }
+  if (used > hdr->numSymbols)
+    return fail("hash table has too many entries");
+  return true;
+}
+
+uint32_t SymbolOrderIndex::size() const { return getHeader(data)->numSymbols; }
+
+StringRef SymbolOrderIndex::getName(uint32_t i) const {
+  const Entry &ent = getEntries(data)[i];
+  return StringRef(getStrings(data) + ent.offset, ent.size);
+}
+
+int64_t SymbolOrderIndex::find(StringRef name) const {
+  uint32_t hash = hashName(name);
+  uint32_t mask = getHeader(data)->numBuckets - 1;
+  const Bucket *buckets = getBuckets(data);
+
+  // The table is never full, so there is always an empty bucket to stop at.
+  for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+    const Bucket &b = buckets[i];
+    if (b.entry == 0)
+      return -1;
+    if (b.hash == hash && getName(b.entry - 1) == name)
+      return b.entry - 1;
+  }
+}
+
+void writeSymbolOrderIndex(StringRef path, ArrayRef<StringRef> symbols) {
+  uint64_t stringsSize = 0;
+  for (StringRef s : symbols)
+    stringsSize += s.size();
+  if (symbols.size() >= UINT32_MAX / 2 || stringsSize > UINT32_MAX) {
+    error("--print-symbol-ordering-index: too many symbols");
+    return;
+  }
+
+  // Keep the load factor of the hash table under 3/4.
+  uint32_t numBuckets = PowerOf2Ceil(symbols.size() * 4 / 3 + 1);
+  std::vector<Bucket> buckets(numBuckets);
+  std::vector<Entry> entries(symbols.size());
+  uint32_t offset = 0;
+  for (size_t i = 0, e = symbols.size(); i != e; ++i) {
+    entries[i].offset = offset;
+    entries[i].size = symbols[i].size();
+    offset += symbols[i].size();
+
+    uint32_t hash = hashName(symbols[i]);
+    uint32_t j = hash & (numBuckets - 1);
+    while (buckets[j].entry != 0)
+      j = (j + 1) & (numBuckets - 1);
+    buckets[j].hash = hash;
+    buckets[j].entry = i + 1;
+  }
+
+  Header hdr;
+  memcpy(hdr.magic, magic, sizeof(magic));
+  hdr.version = version;
+  hdr.numSymbols = symbols.size();
+  hdr.numBuckets = numBuckets;
+  hdr.stringsSize = stringsSize;
+
+  std::error_code ec;
+  raw_fd_ostream os(path, ec, sys::fs::OF_None);
+  if (ec) {
+    error("cannot open " + path + ": " + ec.message());
+    return;
+  }
+  os.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+  os.write(reinterpret_cast<const char *>(buckets.data()),
+           buckets.size() * sizeof(Bucket));
+  os.write(reinterpret_cast<const char *>(entries.data()),
+           entries.size() * sizeof(Entry));
+  for (StringRef s : symbols)
+    os << s;
+}
+
+} // namespace elf
+} // namespace lld
@@ -0,0 +1,50 @@
+//===- SymbolOrder.h --------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_SYMBOL_ORDER_H
+#define LLD_ELF_SYMBOL_ORDER_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+
+namespace lld {
+namespace elf {
+
+// A symbol ordering file in a binary form, which is a hash table of the
+// symbols that can be used as it is mapped into memory. It is written by
+// --print-symbol-ordering-index and read by --symbol-ordering-file.
+class SymbolOrderIndex {
+public:
+  explicit SymbolOrderIndex(StringRef data) : data(data) {}
+
+  // Returns true if a file is an index rather than a list of symbols.
+  static bool isIndex(MemoryBufferRef mb);
+
+  // Checks that a file is a well-formed index, and reports an error if not.
+  static bool verify(MemoryBufferRef mb);
+
+  uint32_t size() const;
+  StringRef getName(uint32_t i) const;
+
+  // Returns the position of a symbol in the ordering file, or -1 if it is
+  // not in it.
+  int64_t find(StringRef name) const;
+
+private:
+  StringRef data;
+};
+
+// Writes an index of a list of symbols, which must not contain duplicates.
+void writeSymbolOrderIndex(StringRef path, ArrayRef<StringRef> symbols);
+
+} // namespace elf
+} // namespace lld
+
+#endif
@@ -21,7 +21,11 @@
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
+#include "lld/Common/Threads.h"
+#include "llvm/ADT/CachedHashString.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/GlobPattern.h"
 
 using namespace llvm;
 using namespace llvm::object;
@@ -48,8 +52,7 @@ void SymbolTable::wrap(Symbol *sym, Symbol *real, Symbol *wrap) {
   real->setName(s);
 }
 
-// Find an existing symbol or create a new one.
-Symbol *SymbolTable::insert(StringRef name) {
+CachedHashStringRef SymbolTable::getKey(StringRef name) {
   // <name>@@<version> means the symbol is the default version. In that
   // case <name>@@<version> will be used to resolve references to <name>.
   //
@@ -59,8 +62,15 @@ Symbol *SymbolTable::insert(StringRef name) {
   size_t pos = name.find('@');
   if (pos != StringRef::npos && pos + 1 < name.size() && name[pos + 1] == '@')
     name = name.take_front(pos);
+  return CachedHashStringRef(name);
+}
 
-  auto p = symMap.insert({CachedHashStringRef(name), (int)symVector.size()});
+Symbol *SymbolTable::insert(StringRef name) { return insert(getKey(name)); }
+
+// Find an existing symbol or create a new one.
+Symbol *SymbolTable::insert(CachedHashStringRef key) {
+  StringRef name = key.val();
+  auto p = symMap.insert({key, (int)symVector.size()});
   int &symIndex = p.first->second;
   bool isNew = p.second;
 
@@ -103,6 +113,60 @@ Symbol *SymbolTable::find(StringRef name) {
   return sym;
 }
 
+Symbol *SymbolTable::loadLazyShared(StringRef name) {
+  if (Symbol *sym = find(name))
+    return sym;
+
+  // A symbol defined in a lazily added shared file would have been found if
+  // the file had been added eagerly. name may be a temporary string.
+  for (SharedFile *file : lazySharedFiles) {
+    if (uint32_t i = file->findLazySymbol(name)) {
+      Symbol *sym = insert(saver.save(name));
+      file->addLazySymbol(sym, i);
+      return sym;
+    }
+  }
+  return nullptr;
+}
+
+void SymbolTable::addLazySharedFile(SharedFile *file) {
+  lazySharedFiles.push_back(file);
+
+  // Resolve the symbols that the file would have resolved if it had been
+  // added eagerly. The others can't be resolved by any shared file anymore.
+  llvm::erase_if(unresolvedSymbols, [&](Symbol *sym) {
+    if (!sym->isUndefined() && !sym->isLazy() && !sym->isPlaceholder())
+      return true;
+    if (uint32_t i = file->findLazySymbol(sym->getName()))
+      file->addLazySymbol(sym, i);
+    return !sym->isUndefined() && !sym->isLazy() && !sym->isPlaceholder();
+  });
+}
+
+bool SymbolTable::resolveLazyShared(Symbol *sym) {
+  for (SharedFile *file : lazySharedFiles) {
+    if (uint32_t i = file->findLazySymbol(sym->getName())) {
+      file->addLazySymbol(sym, i);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns the demangled names of the defined and common symbols, with the
+// same indices as symVector. Other names are empty.
+ArrayRef<std::string> SymbolTable::getDemangledNames() {
+  if (!demangledNames) {
+    demangledNames.emplace(symVector.size());
+    parallelForEachN(0, symVector.size(), [&](size_t i) {
+      Symbol *sym = symVector[i];
+      if (sym->isDefined() || sym->isCommon())
+        (*demangledNames)[i] = demangleItanium(sym->getName());
+    });
+  }
+  return *demangledNames;
+}
+
 // Initialize demangledSyms with a map from demangled symbols to symbol
 // objects. Used to handle "extern C++" directive in version scripts.
 //
@@ -115,14 +179,15 @@ Symbol *SymbolTable::find(StringRef name) {
 // "llvm::*::foo(int, ?)". Obviously, there's no way to handle this
 // other than trying to match a pattern against all demangled symbols.
 // So, if "extern C++" feature is used, we need to demangle all known
-// symbols.
+// symbols. The names are demangled in parallel.
 StringMap<std::vector<Symbol *>> &SymbolTable::getDemangledSyms() {
   if (!demangledSyms) {
+    ArrayRef<std::string> names = getDemangledNames();
     demangledSyms.emplace();
-    for (Symbol *sym : symVector) {
-      if (!sym->isDefined() && !sym->isCommon())
-        continue;
-      (*demangledSyms)[demangleItanium(sym->getName())].push_back(sym);
+    for (size_t i = 0, e = symVector.size(); i != e; ++i) {
+      Symbol *sym = symVector[i];
+      if (sym->isDefined() || sym->isCommon())
+        (*demangledSyms)[names[i]].push_back(sym);
     }
   }
   return *demangledSyms;
@@ -137,35 +202,130 @@ std::vector<Symbol *> SymbolTable::findByVersion(SymbolVersion ver) {
   return {};
 }
 
-std::vector<Symbol *> SymbolTable::findAllByVersion(SymbolVersion ver) {
-  std::vector<Symbol *> res;
-  StringMatcher m(ver.name);
+namespace {
+// Matches symbol names against the wildcard patterns of version scripts and
+// dynamic lists. A version script can have thousands of patterns, and a
+// link can have millions of symbols, so matching every symbol against every
+// pattern is too slow. Instead, patterns are bucketed by the literal
+// prefixes of their globs, and a name is only matched against the patterns
+// whose prefix it starts with and whose literal suffix it ends with.
+class SymbolPatternMatcher {
+public:
+  // Adds a pattern with an ID. IDs must be added in ascending order.
+  void add(StringRef pattern, uint32_t id);
+
+  // Must be called after the patterns are added and before match().
+  void finalize();
+
+  // Returns the lowest ID of the patterns that match a name, or UINT32_MAX
+  // if none does. This can be called from multiple threads.
+  uint32_t match(StringRef name) const;
+
+  bool empty() const { return patterns.empty(); }
+
+private:
+  struct Pattern {
+    GlobPattern glob;
+    StringRef suffix;
+    uint32_t id;
+  };
 
-  if (ver.isExternCpp) {
-    for (auto &p : getDemangledSyms())
-      if (m.match(p.first()))
-        res.insert(res.end(), p.second.begin(), p.second.end());
-    return res;
+  std::vector<Pattern> patterns;
+  DenseMap<CachedHashStringRef, std::vector<uint32_t>> buckets;
+  std::vector<size_t> prefixLengths;
+};
+} // namespace
+
+void SymbolPatternMatcher::add(StringRef pattern, uint32_t id) {
+  Expected<GlobPattern> glob = GlobPattern::create(pattern);
+  if (!glob) {
+    error(toString(glob.takeError()));
+    return;
   }
 
-  for (Symbol *sym : symVector)
-    if ((sym->isDefined() || sym->isCommon()) && m.match(sym->getName()))
-      res.push_back(sym);
-  return res;
+  // The text before the first and after the last metacharacter is literal.
+  // A backslash makes the next character literal, so the suffix after it
+  // can be used too.
+  StringRef prefix = pattern.substr(0, pattern.find_first_of("?*[\\"));
+  StringRef suffix = pattern.substr(pattern.find_last_of("?*[]\\") + 1);
+  buckets[CachedHashStringRef(prefix)].push_back(patterns.size());
+  prefixLengths.push_back(prefix.size());
+  patterns.push_back({*glob, suffix, id});
+}
+
+void SymbolPatternMatcher::finalize() {
+  llvm::sort(prefixLengths);
+  prefixLengths.erase(std::unique(prefixLengths.begin(), prefixLengths.end()),
+                      prefixLengths.end());
+}
+
+uint32_t SymbolPatternMatcher::match(StringRef name) const {
+  uint32_t ret = UINT32_MAX;
+  for (size_t len : prefixLengths) {
+    if (len > name.size())
+      break;
+    auto it = buckets.find(CachedHashStringRef(name.take_front(len)));
+    if (it == buckets.end())
+      continue;
+    // A bucket is sorted by ID, so the first match is the best in it.
+    for (uint32_t i : it->second) {
+      const Pattern &pat = patterns[i];
+      if (pat.id >= ret)
+        break;
+      if (name.endswith(pat.suffix) && pat.glob.match(name)) {
+        ret = pat.id;
+        break;
+      }
+    }
+  }
+  return ret;
+}
+
+// Matches the defined and common symbols against C and C++ wildcard
+// patterns in parallel, and calls fn with each symbol and the lowest ID of
+// the patterns that match it. Symbols that no pattern matches are skipped.
+// fn is called from multiple threads, but only once for each symbol.
+void SymbolTable::matchWildcards(
+    ArrayRef<std::pair<SymbolVersion, uint32_t>> pats,
+    function_ref<void(Symbol *, uint32_t)> fn) {
+  SymbolPatternMatcher c, cxx;
+  for (const std::pair<SymbolVersion, uint32_t> &p : pats)
+    (p.first.isExternCpp ? cxx : c).add(p.first.name, p.second);
+  c.finalize();
+  cxx.finalize();
+  if (c.empty() && cxx.empty())
+    return;
+
+  ArrayRef<std::string> demangled;
+  if (!cxx.empty())
+    demangled = getDemangledNames();
+
+  parallelForEachN(0, symVector.size(), [&](size_t i) {
+    Symbol *sym = symVector[i];
+    if (!sym->isDefined() && !sym->isCommon())
+      return;
+    uint32_t id = c.match(sym->getName());
+    if (!cxx.empty())
+      id = std::min(id, cxx.match(demangled[i]));
+    if (id != UINT32_MAX)
+      fn(sym, id);
+  });
 }
 
 // Handles -dynamic-list.
 void SymbolTable::handleDynamicList() {
+  std::vector<std::pair<SymbolVersion, uint32_t>> wildcards;
   for (SymbolVersion &ver : config->dynamicList) {
-    std::vector<Symbol *> syms;
-    if (ver.hasWildcard)
-      syms = findAllByVersion(ver);
-    else
-      syms = findByVersion(ver);
-
-    for (Symbol *sym : syms)
+    if (ver.hasWildcard) {
+      wildcards.push_back({ver, 0});
+      continue;
+    }
+    for (Symbol *sym : findByVersion(ver))
       sym->inDynamicList = true;
   }
+
+  matchWildcards(wildcards,
+                 [](Symbol *sym, uint32_t) { sym->inDynamicList = true; });
 }
 
 // Set symbol versions to symbols. This function handles patterns
@@ -214,17 +374,6 @@ void SymbolTable::assignExactVersion(SymbolVersion ver, uint16_t versionId,
   }
 }
 
-void SymbolTable::assignWildcardVersion(SymbolVersion ver, uint16_t versionId) {
-  // Exact matching takes precendence over fuzzy matching,
-  // so we set a version to a symbol only if no version has been assigned
-  // to the symbol. This behavior is compatible with GNU.
-  for (Symbol *sym : findAllByVersion(ver))
-    if (sym->verdefIndex == UINT32_C(-1)) {
-      sym->verdefIndex = 0;
-      sym->versionId = versionId;
-    }
-}
-
 // This function processes version scripts by updating the versionId
 // member of symbols.
 // If there's only one anonymous version definition in a version
@@ -239,18 +388,33 @@ void SymbolTable::scanVersionScript() {
 
   // Next, assign versions to wildcards that are not "*". Note that because the
   // last match takes precedence over previous matches, we iterate over the
-  // definitions in the reverse order.
+  // definitions in the reverse order. Then, assign versions to "*". In GNU
+  // linkers they have lower priority than other wildcards. A symbol gets the
+  // version of the first pattern in that order that matches it.
+  std::vector<std::pair<SymbolVersion, uint32_t>> wildcards;
+  std::vector<uint16_t> versionIds;
+  auto addWildcard = [&](const SymbolVersion &pat, uint16_t versionId) {
+    wildcards.push_back({pat, versionIds.size()});
+    versionIds.push_back(versionId);
+  };
   for (VersionDefinition &v : llvm::reverse(config->versionDefinitions))
     for (SymbolVersion &pat : v.patterns)
       if (pat.hasWildcard && pat.name != "*")
-        assignWildcardVersion(pat, v.id);
-
-  // Then, assign versions to "*". In GNU linkers they have lower priority than
-  // other wildcards.
+        addWildcard(pat, v.id);
   for (VersionDefinition &v : config->versionDefinitions)
     for (SymbolVersion &pat : v.patterns)
       if (pat.hasWildcard && pat.name == "*")
-        assignWildcardVersion(pat, v.id);
+        addWildcard(pat, v.id);
+
+  // Exact matching takes precendence over fuzzy matching,
+  // so we set a version to a symbol only if no version has been assigned
+  // to the symbol. This behavior is compatible with GNU.
+  matchWildcards(wildcards, [&](Symbol *sym, uint32_t id) {
+    if (sym->verdefIndex == UINT32_C(-1)) {
+      sym->verdefIndex = 0;
+      sym->versionId = versionIds[id];
+    }
+  });
 
   // Symbol themselves might know their versions because symbols
   // can contain versions in the form of <name>@<version>.
@@ -43,12 +43,36 @@ public:
 
   Symbol *insert(StringRef name);
 
+  // Returns the key that insert() looks a symbol name up by. Computing it
+  // does not touch the symbol table, so it can be done ahead of time on any
+  // thread, and the symbol then inserted with the second overload.
+  static llvm::CachedHashStringRef getKey(StringRef name);
+  Symbol *insert(llvm::CachedHashStringRef key);
+
   Symbol *addSymbol(const Symbol &newSym);
 
   void scanVersionScript();
 
   Symbol *find(StringRef name);
 
+  // Like find(), but with --lazy-shared-symbols, also adds the symbol from
+  // the first lazily added shared file that defines it. Unlike find(), this
+  // may insert into the symbol table, so it must not be called in parallel.
+  Symbol *loadLazyShared(StringRef name);
+
+  // Makes a shared file's defined symbols available to be added when they
+  // are referenced, and resolves the symbols that are already referenced.
+  // See SharedFile::findLazySymbol.
+  void addLazySharedFile(SharedFile *file);
+
+  // Resolves a symbol with the first lazily added shared file that defines
+  // it, if any.
+  bool resolveLazyShared(Symbol *sym);
+
+  // With --lazy-shared-symbols, the symbols that were undefined or lazy when
+  // they were added, which shared files added later may resolve.
+  std::vector<Symbol *> unresolvedSymbols;
+
   void handleDynamicList();
 
   // Set of .so files to not link the same shared object file more than once.
@@ -61,12 +85,13 @@ public:
 
 private:
   std::vector<Symbol *> findByVersion(SymbolVersion ver);
-  std::vector<Symbol *> findAllByVersion(SymbolVersion ver);
+  void matchWildcards(ArrayRef<std::pair<SymbolVersion, uint32_t>> pats,
+                      llvm::function_ref<void(Symbol *, uint32_t)> fn);
 
+  ArrayRef<std::string> getDemangledNames();
   llvm::StringMap<std::vector<Symbol *>> &getDemangledSyms();
   void assignExactVersion(SymbolVersion ver, uint16_t versionId,
                           StringRef versionName);
-  void assignWildcardVersion(SymbolVersion ver, uint16_t versionId);
 
   // The order the global symbols are in is not defined. We can use an arbitrary
   // order, but it has to be reproducible. That is true even when cross linking.
@@ -78,11 +103,17 @@ private:
   llvm::DenseMap<llvm::CachedHashStringRef, int> symMap;
   std::vector<Symbol *> symVector;
 
+  // The shared files added by addLazySharedFile in command line order.
+  std::vector<SharedFile *> lazySharedFiles;
+
   // A map from demangled symbol names to their symbol objects.
   // This mapping is 1:N because two symbols with different versions
   // can have the same name. We use this map to handle "extern C++ {}"
   // directive in version scripts.
   llvm::Optional<llvm::StringMap<std::vector<Symbol *>>> demangledSyms;
+
+  // The demangled names of the symbols in symVector.
+  llvm::Optional<std::vector<std::string>> demangledNames;
 };
 
 extern SymbolTable *symtab;
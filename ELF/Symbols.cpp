@@ -10,6 +10,7 @@
 #include "InputFiles.h"
 #include "InputSection.h"
 #include "OutputSections.h"
+#include "SymbolTable.h"
 #include "SyntheticSections.h"
 #include "Target.h"
 #include "Writer.h"
@@ -37,6 +38,9 @@ std::string toELFString(const Archive::Symbol &b) {
 }
 
 namespace elf {
+std::vector<SymbolAux> symAux;
+const SymbolAux SymbolAux::none{};
+
 Defined *ElfSym::bss;
 Defined *ElfSym::etext1;
 Defined *ElfSym::etext2;
@@ -148,7 +152,9 @@ uint64_t Symbol::getGotVA() const {
   return in.got->getVA() + getGotOffset();
 }
 
-uint64_t Symbol::getGotOffset() const { return gotIndex * config->wordsize; }
+uint64_t Symbol::getGotOffset() const {
+  return aux().gotIndex * config->wordsize;
+}
 
 uint64_t Symbol::getGotPltVA() const {
   if (isInIplt)
@@ -158,19 +164,19 @@ uint64_t Symbol::getGotPltVA() const {
 
 uint64_t Symbol::getGotPltOffset() const {
   if (isInIplt)
-    return pltIndex * config->wordsize;
-  return (pltIndex + target->gotPltHeaderEntriesNum) * config->wordsize;
+    return aux().pltIndex * config->wordsize;
+  return (aux().pltIndex + target->gotPltHeaderEntriesNum) * config->wordsize;
 }
 
 uint64_t Symbol::getPPC64LongBranchOffset() const {
-  assert(ppc64BranchltIndex != 0xffff);
-  return ppc64BranchltIndex * config->wordsize;
+  assert(isInPPC64Branchlt());
+  return aux().ppc64BranchltIndex * config->wordsize;
 }
 
 uint64_t Symbol::getPltVA() const {
   PltSection *plt = isInIplt ? in.iplt : in.plt;
   uint64_t outVA =
-      plt->getVA() + plt->headerSize + pltIndex * target->pltEntrySize;
+      plt->getVA() + plt->headerSize + aux().pltIndex * target->pltEntrySize;
   // While linking microMIPS code PLT code are always microMIPS
   // code. Set the less-significant bit to track that fact.
   // See detailed comment in the `getSymVA` function.
@@ -180,9 +186,9 @@ uint64_t Symbol::getPltVA() const {
 }
 
 uint64_t Symbol::getPPC64LongBranchTableVA() const {
-  assert(ppc64BranchltIndex != 0xffff);
+  assert(isInPPC64Branchlt());
   return in.ppc64LongBranchTarget->getVA() +
-         ppc64BranchltIndex * config->wordsize;
+         aux().ppc64BranchltIndex * config->wordsize;
 }
 
 uint64_t Symbol::getSize() const {
@@ -367,10 +373,19 @@ void Symbol::mergeProperties(const Symbol &other) {
 }
 
 void Symbol::resolve(const Symbol &other) {
+  // With --lazy-shared-symbols, a reference to a new name first resolves the
+  // symbol with the shared file that would have added it, so that the result
+  // is the same as if the shared files' symbols had been added eagerly.
+  if (config->lazySharedSymbols && isPlaceholder() &&
+      (other.isUndefined() || other.isLazy()))
+    symtab->resolveLazyShared(this);
+
   mergeProperties(other);
 
   if (isPlaceholder()) {
     replace(other);
+    if (config->lazySharedSymbols && (isUndefined() || isLazy()))
+      symtab->unresolvedSymbols.push_back(this);
     return;
   }
 
@@ -52,6 +52,25 @@ struct StringRefZ {
   const uint32_t size;
 };
 
+// Symbol attributes that only symbols with GOT, PLT or dynamic symbol table
+// entries need. Since that is a small fraction of all symbols, they are stored
+// in symAux rather than in Symbol, which keeps Symbol small and the hot fields
+// of a symbol in the same cache line.
+struct SymbolAux {
+  uint32_t gotIndex = -1;
+  uint32_t pltIndex = -1;
+  uint32_t globalDynIndex = -1;
+  uint32_t dynsymIndex = 0;
+
+  // An index into the .branch_lt section on PPC64.
+  uint16_t ppc64BranchltIndex = -1;
+
+  // The attributes of a symbol that has no entry in symAux.
+  static const SymbolAux none;
+};
+
+extern std::vector<SymbolAux> symAux;
+
 // The base class for real symbol classes.
 class Symbol {
 public:
@@ -75,11 +94,8 @@ protected:
   mutable uint32_t nameSize;
 
 public:
-  uint32_t dynsymIndex = 0;
-  uint32_t gotIndex = -1;
-  uint32_t pltIndex = -1;
-
-  uint32_t globalDynIndex = -1;
+  // An index into symAux, or -1 if this symbol does not have an entry in it.
+  uint32_t auxIdx = -1;
 
   // This field is a index to the symbol's version definition.
   uint32_t verdefIndex = -1;
@@ -87,9 +103,6 @@ public:
   // Version definition index.
   uint16_t versionId;
 
-  // An index into the .branch_lt section on PPC64.
-  uint16_t ppc64BranchltIndex = -1;
-
   // Symbol binding. This is not overwritten by replace() to track
   // changes during resolution. In particular:
   //  - An undefined weak is still weak when it resolves to a shared library.
@@ -179,9 +192,23 @@ public:
 
   void parseSymbolVersion();
 
-  bool isInGot() const { return gotIndex != -1U; }
-  bool isInPlt() const { return pltIndex != -1U; }
-  bool isInPPC64Branchlt() const { return ppc64BranchltIndex != 0xffff; }
+  const SymbolAux &aux() const {
+    return auxIdx == -1U ? SymbolAux::none : symAux[auxIdx];
+  }
+
+  // Returns this symbol's entry in symAux, creating one if it does not exist.
+  // The returned reference is invalidated when another entry is created.
+  SymbolAux &allocateAux() {
+    if (auxIdx == -1U) {
+      auxIdx = symAux.size();
+      symAux.emplace_back();
+    }
+    return symAux[auxIdx];
+  }
+
+  bool isInGot() const { return aux().gotIndex != -1U; }
+  bool isInPlt() const { return aux().pltIndex != -1U; }
+  bool isInPPC64Branchlt() const { return aux().ppc64BranchltIndex != 0xffff; }
 
   uint64_t getVA(int64_t addend = 0) const;
 
@@ -398,7 +425,12 @@ public:
 class LazyArchive : public Symbol {
 public:
   LazyArchive(InputFile &file, const llvm::object::Archive::Symbol s)
-      : Symbol(LazyArchiveKind, &file, s.getName(), llvm::ELF::STB_GLOBAL,
+      : LazyArchive(file, s, s.getName()) {}
+
+  // For a symbol whose name is already known.
+  LazyArchive(InputFile &file, const llvm::object::Archive::Symbol s,
+              StringRef name)
+      : Symbol(LazyArchiveKind, &file, name, llvm::ELF::STB_GLOBAL,
                llvm::ELF::STV_DEFAULT, llvm::ELF::STT_NOTYPE),
         sym(s) {}
 
@@ -472,9 +504,10 @@ union SymbolUnion {
 };
 
 // It is important to keep the size of SymbolUnion small for performance and
-// memory usage reasons. 80 bytes is a soft limit based on the size of Defined
-// on a 64-bit system.
-static_assert(sizeof(SymbolUnion) <= 80, "SymbolUnion too large");
+// memory usage reasons. 64 bytes is a soft limit based on the size of Defined
+// on a 64-bit system, so that a symbol does not span more cache lines than
+// necessary. Rarely used attributes belong in SymbolAux.
+static_assert(sizeof(SymbolUnion) <= 64, "SymbolUnion too large");
 
 template <typename T> struct AssertSymbol {
   static_assert(std::is_trivially_destructible<T>(),
@@ -27,16 +27,24 @@
 #include "lld/Common/Strings.h"
 #include "lld/Common/Threads.h"
 #include "lld/Common/Version.h"
+#include "llvm/ADT/CachedHashString.h"
 #include "llvm/ADT/SetOperations.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/DebugInfo/DWARF/DWARFAcceleratorTable.h"
 #include "llvm/DebugInfo/DWARF/DWARFDebugPubTable.h"
 #include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Support/Compression.h"
+#include "llvm/Support/DJB.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/xxhash.h"
+#include <atomic>
 #include <cstdlib>
+#include <map>
+#include <numeric>
 #include <thread>
 
 using namespace llvm;
@@ -51,7 +59,8 @@ using llvm::support::endian::write64le;
 
 namespace lld {
 namespace elf {
-constexpr size_t MergeNoTailSection::numShards;
+constexpr size_t MergeSyntheticSection::numShards;
+constexpr size_t StringTableSection::numShards;
 
 static uint64_t readUint(uint8_t *buf) {
   return config->is64 ? read64(buf) : read32(buf);
@@ -345,27 +354,17 @@ BssSection::BssSection(StringRef name, uint64_t size, uint32_t alignment)
 EhFrameSection::EhFrameSection()
     : SyntheticSection(SHF_ALLOC, SHT_PROGBITS, 1, ".eh_frame") {}
 
-// Search for an existing CIE record or create a new one.
-// CIE records from input object files are uniquified by their contents
-// and where their relocations point to.
+// Returns the personality function of a CIE. CIE records from input object
+// files are uniquified by their contents and where their relocations point
+// to.
 template <class ELFT, class RelTy>
-CieRecord *EhFrameSection::addCie(EhSectionPiece &cie, ArrayRef<RelTy> rels) {
-  Symbol *personality = nullptr;
+Symbol *EhFrameSection::getPersonality(EhSectionPiece &cie,
+                                       ArrayRef<RelTy> rels) {
   unsigned firstRelI = cie.firstRelocation;
-  if (firstRelI != (unsigned)-1)
-    personality =
-        &cie.sec->template getFile<ELFT>()->getRelocTargetSym(rels[firstRelI]);
-
-  // Search for an existing CIE by CIE contents/relocation target pair.
-  CieRecord *&rec = cieMap[{cie.data(), personality}];
-
-  // If not found, create a new one.
-  if (!rec) {
-    rec = make<CieRecord>();
-    rec->cie = &cie;
-    cieRecords.push_back(rec);
-  }
-  return rec;
+  if (firstRelI == (unsigned)-1)
+    return nullptr;
+  return &cie.sec->template getFile<ELFT>()->getRelocTargetSym(
+      rels[firstRelI]);
 }
 
 // There is one FDE per function. Returns true if a given FDE
@@ -396,11 +395,12 @@ bool EhFrameSection::isFdeLive(EhSectionPiece &fde, ArrayRef<RelTy> rels) {
 
 // .eh_frame is a sequence of CIE or FDE records. In general, there
 // is one CIE record per input object file which is followed by
-// a list of FDEs. This function searches an existing CIE or create a new
-// one and associates FDEs to the CIE.
+// a list of FDEs. This function collects the CIEs of a section and the
+// live FDEs along with the CIEs they refer to. It is called in parallel,
+// so it must not modify anything but `ret`.
 template <class ELFT, class RelTy>
-void EhFrameSection::addRecords(EhInputSection *sec, ArrayRef<RelTy> rels) {
-  offsetToCie.clear();
+void EhFrameSection::addRecords(EhInputSection *sec, ArrayRef<RelTy> rels,
+                                EhSectionRecords &ret) {
   for (EhSectionPiece &piece : sec->pieces) {
     // The empty record is the end marker.
     if (piece.size == 4)
@@ -409,30 +409,95 @@ void EhFrameSection::addRecords(EhInputSection *sec, ArrayRef<RelTy> rels) {
     size_t offset = piece.inputOff;
     uint32_t id = read32(piece.data().data() + 4);
     if (id == 0) {
-      offsetToCie[offset] = addCie<ELFT>(piece, rels);
+      Symbol *personality = getPersonality<ELFT>(piece, rels);
+      unsigned hash = hash_combine(hash_value(piece.data()), personality);
+      ret.cies.push_back({&piece, personality, hash});
       continue;
     }
 
+    // An FDE refers to a preceding CIE. Pieces are sorted by offset, so we
+    // can binary search for it.
     uint32_t cieOffset = offset + 4 - id;
-    CieRecord *rec = offsetToCie[cieOffset];
-    if (!rec)
+    auto it = partition_point(ret.cies, [=](const EhSectionRecords::Cie &c) {
+      return c.piece->inputOff < cieOffset;
+    });
+    if (it == ret.cies.end() || it->piece->inputOff != cieOffset)
       fatal(toString(sec) + ": invalid CIE reference");
 
     if (!isFdeLive<ELFT>(piece, rels))
       continue;
-    rec->fdes.push_back(&piece);
-    numFdes++;
+    ret.fdes.push_back({uint32_t(it - ret.cies.begin()), &piece});
   }
 }
 
 template <class ELFT>
-void EhFrameSection::addSectionAux(EhInputSection *sec) {
+void EhFrameSection::addSectionAux(EhInputSection *sec,
+                                   EhSectionRecords &ret) {
   if (!sec->isLive())
     return;
   if (sec->areRelocsRela)
-    addRecords<ELFT>(sec, sec->template relas<ELFT>());
+    addRecords<ELFT>(sec, sec->template relas<ELFT>(), ret);
   else
-    addRecords<ELFT>(sec, sec->template rels<ELFT>());
+    addRecords<ELFT>(sec, sec->template rels<ELFT>(), ret);
+}
+
+// Creates cieRecords from the records of all input sections. CIEs are
+// uniquified in parallel with a sharded map, and CieRecords are then created
+// in input order, so that the output does not depend on the number of
+// threads.
+void EhFrameSection::mergeRecords(ArrayRef<EhSectionRecords> records) {
+  size_t numShards = 32;
+  size_t concurrency = 1;
+  if (threadsEnabled)
+    concurrency =
+        std::min<size_t>(PowerOf2Floor(getThreadCount()), numShards);
+  size_t shift = 32 - countTrailingZeros(numShards);
+
+  // For each CIE, the section and CIE indices of the first identical CIE.
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> leaders(
+      records.size());
+  for (size_t i = 0, e = records.size(); i < e; ++i)
+    leaders[i].resize(records[i].cies.size());
+
+  std::vector<DenseMap<std::pair<ArrayRef<uint8_t>, Symbol *>,
+                       std::pair<uint32_t, uint32_t>>>
+      map(numShards);
+  parallelForEachN(0, concurrency, [&](size_t threadId) {
+    for (uint32_t i = 0, e = records.size(); i < e; ++i) {
+      ArrayRef<EhSectionRecords::Cie> cies = records[i].cies;
+      for (uint32_t j = 0, f = cies.size(); j < f; ++j) {
+        size_t shardId = cies[j].hash >> shift;
+        if ((shardId & (concurrency - 1)) != threadId)
+          continue;
+        std::pair<ArrayRef<uint8_t>, Symbol *> key = {cies[j].piece->data(),
+                                                      cies[j].personality};
+        leaders[i][j] = map[shardId].insert({key, {i, j}}).first->second;
+      }
+    }
+  });
+
+  // make<> is not thread-safe, so CieRecords are created here. A CIE is
+  // always visited after its leader, so each FDE can be appended to the
+  // record of its CIE's leader.
+  std::vector<std::vector<CieRecord *>> recs(records.size());
+  for (size_t i = 0, e = records.size(); i < e; ++i) {
+    recs[i].resize(records[i].cies.size());
+    for (size_t j = 0, f = records[i].cies.size(); j < f; ++j) {
+      std::pair<uint32_t, uint32_t> leader = leaders[i][j];
+      if (leader.first != i || leader.second != j) {
+        recs[i][j] = recs[leader.first][leader.second];
+        continue;
+      }
+      CieRecord *rec = make<CieRecord>();
+      rec->cie = records[i].cies[j].piece;
+      cieRecords.push_back(rec);
+      recs[i][j] = rec;
+    }
+
+    for (const std::pair<uint32_t, EhSectionPiece *> &fde : records[i].fdes)
+      recs[i][fde.first]->fdes.push_back(fde.second);
+    numFdes += records[i].fdes.size();
+  }
 }
 
 void EhFrameSection::addSection(EhInputSection *sec) {
@@ -460,26 +525,28 @@ static void writeCieFde(uint8_t *buf, ArrayRef<uint8_t> d) {
 void EhFrameSection::finalizeContents() {
   assert(!this->size); // Not finalized.
 
-  switch (config->ekind) {
-  case ELFNoneKind:
-    llvm_unreachable("invalid ekind");
-  case ELF32LEKind:
-    for (EhInputSection *sec : sections)
-      addSectionAux<ELF32LE>(sec);
-    break;
-  case ELF32BEKind:
-    for (EhInputSection *sec : sections)
-      addSectionAux<ELF32BE>(sec);
-    break;
-  case ELF64LEKind:
-    for (EhInputSection *sec : sections)
-      addSectionAux<ELF64LE>(sec);
-    break;
-  case ELF64BEKind:
-    for (EhInputSection *sec : sections)
-      addSectionAux<ELF64BE>(sec);
-    break;
-  }
+  // Reading records is the expensive part because it has to look up the
+  // relocation targets of all FDEs, so it is done in parallel.
+  std::vector<EhSectionRecords> records(sections.size());
+  parallelForEachN(0, sections.size(), [&](size_t i) {
+    switch (config->ekind) {
+    case ELFNoneKind:
+      llvm_unreachable("invalid ekind");
+    case ELF32LEKind:
+      addSectionAux<ELF32LE>(sections[i], records[i]);
+      break;
+    case ELF32BEKind:
+      addSectionAux<ELF32BE>(sections[i], records[i]);
+      break;
+    case ELF64LEKind:
+      addSectionAux<ELF64LE>(sections[i], records[i]);
+      break;
+    case ELF64BEKind:
+      addSectionAux<ELF64BE>(sections[i], records[i]);
+      break;
+    }
+  });
+  mergeRecords(records);
 
   size_t off = 0;
   for (CieRecord *rec : cieRecords) {
@@ -571,26 +638,27 @@ uint64_t EhFrameSection::getFdePc(uint8_t *buf, size_t fdeOff,
 }
 
 void EhFrameSection::writeTo(uint8_t *buf) {
-  // Write CIE and FDE records.
+  // Write CIE and FDE records. Usually all input files share a few CIEs,
+  // so FDEs are written in parallel rather than CIE records.
   for (CieRecord *rec : cieRecords) {
     size_t cieOffset = rec->cie->outputOff;
     writeCieFde(buf + cieOffset, rec->cie->data());
 
-    for (EhSectionPiece *fde : rec->fdes) {
+    parallelForEach(rec->fdes, [&](EhSectionPiece *fde) {
       size_t off = fde->outputOff;
       writeCieFde(buf + off, fde->data());
 
       // FDE's second word should have the offset to an associated CIE.
       // Write it.
       write32(buf + off + 4, off + 4 - cieOffset);
-    }
+    });
   }
 
   // Apply relocations. .eh_frame section contents are not contiguous
   // in the output buffer, but relocateAlloc() still works because
   // getOffset() takes care of discontiguous section pieces.
-  for (EhInputSection *s : sections)
-    s->relocateAlloc(buf, nullptr);
+  parallelForEach(sections,
+                  [&](EhInputSection *s) { s->relocateAlloc(buf, nullptr); });
 
   if (getPartition().ehFrameHdr && getPartition().ehFrameHdr->getParent())
     getPartition().ehFrameHdr->write();
@@ -607,14 +675,15 @@ GotSection::GotSection()
 }
 
 void GotSection::addEntry(Symbol &sym) {
-  sym.gotIndex = numEntries;
+  sym.allocateAux().gotIndex = numEntries;
   ++numEntries;
 }
 
 bool GotSection::addDynTlsEntry(Symbol &sym) {
-  if (sym.globalDynIndex != -1U)
+  SymbolAux &aux = sym.allocateAux();
+  if (aux.globalDynIndex != -1U)
     return false;
-  sym.globalDynIndex = numEntries;
+  aux.globalDynIndex = numEntries;
   // Global Dynamic TLS entries take two GOT slots.
   numEntries += 2;
   return true;
@@ -631,11 +700,11 @@ bool GotSection::addTlsIndex() {
 }
 
 uint64_t GotSection::getGlobalDynAddr(const Symbol &b) const {
-  return this->getVA() + b.globalDynIndex * config->wordsize;
+  return this->getVA() + b.aux().globalDynIndex * config->wordsize;
 }
 
 uint64_t GotSection::getGlobalDynOffset(const Symbol &b) const {
-  return b.globalDynIndex * config->wordsize;
+  return b.aux().globalDynIndex * config->wordsize;
 }
 
 void GotSection::finalizeContents() {
@@ -783,22 +852,48 @@ unsigned MipsGotSection::getLocalEntriesNum() const {
          gots.front().local16.size();
 }
 
-bool MipsGotSection::tryMergeGots(FileGot &dst, FileGot &src, bool isPrimary) {
-  FileGot tmp = dst;
-  set_union(tmp.pagesMap, src.pagesMap);
-  set_union(tmp.local16, src.local16);
-  set_union(tmp.global, src.global);
-  set_union(tmp.relocs, src.relocs);
-  set_union(tmp.tls, src.tls);
-  set_union(tmp.dynTlsSymbols, src.dynTlsSymbols);
+// Returns the number of keys of `src` that are not in `dst`.
+template <class MapTy>
+static size_t getNumNewKeys(const MapTy &dst, const MapTy &src) {
+  size_t num = 0;
+  for (const auto &p : src)
+    if (!dst.count(p.first))
+      ++num;
+  return num;
+}
 
+bool MipsGotSection::tryMergeGots(FileGot &dst, FileGot &src, bool isPrimary) {
+  // Count the entries of the merged GOT without building it, so that a
+  // merge costs time proportional to the size of `src` rather than to the
+  // size of `dst`, which grows with every merged file. This keeps multi-GOT
+  // construction linear in the number of entries.
+  size_t pages = dst.getPageEntriesNum();
+  for (const std::pair<const OutputSection *, FileGot::PageBlock> &p :
+       src.pagesMap)
+    if (!dst.pagesMap.count(p.first))
+      pages += p.second.count;
+  size_t local16 = dst.local16.size() + getNumNewKeys(dst.local16, src.local16);
+  size_t global = dst.global.size() + getNumNewKeys(dst.global, src.global);
+  size_t relocs = dst.relocs.size() + getNumNewKeys(dst.relocs, src.relocs);
+  size_t tls = dst.tls.size() + getNumNewKeys(dst.tls, src.tls);
+  size_t dynTls = dst.dynTlsSymbols.size() +
+                  getNumNewKeys(dst.dynTlsSymbols, src.dynTlsSymbols);
+
+  // This is getIndexedEntriesNum() of the merged GOT.
   size_t count = isPrimary ? headerEntriesNum : 0;
-  count += tmp.getIndexedEntriesNum();
+  count += pages + local16 + global;
+  if (tls || dynTls)
+    count += relocs + tls + dynTls * 2;
 
   if (count * config->wordsize > config->mipsGotSize)
     return false;
 
-  std::swap(tmp, dst);
+  set_union(dst.pagesMap, src.pagesMap);
+  set_union(dst.local16, src.local16);
+  set_union(dst.global, src.global);
+  set_union(dst.relocs, src.relocs);
+  set_union(dst.tls, src.tls);
+  set_union(dst.dynTlsSymbols, src.dynTlsSymbols);
   return true;
 }
 
@@ -928,12 +1023,12 @@ void MipsGotSection::build() {
     }
   }
 
-  // Update Symbol::gotIndex field to use this
+  // Update SymbolAux::gotIndex field to use this
   // value later in the `sortMipsSymbols` function.
   for (auto &p : primGot->global)
-    p.first->gotIndex = p.second;
+    p.first->allocateAux().gotIndex = p.second;
   for (auto &p : primGot->relocs)
-    p.first->gotIndex = p.second;
+    p.first->allocateAux().gotIndex = p.second;
 
   // Create dynamic relocations.
   for (FileGot &got : gots) {
@@ -1092,7 +1187,7 @@ GotPltSection::GotPltSection()
 }
 
 void GotPltSection::addEntry(Symbol &sym) {
-  assert(sym.pltIndex == entries.size());
+  assert(sym.aux().pltIndex == entries.size());
   entries.push_back(&sym);
 }
 
@@ -1136,7 +1231,7 @@ IgotPltSection::IgotPltSection()
                        config->wordsize, getIgotPltName()) {}
 
 void IgotPltSection::addEntry(Symbol &sym) {
-  assert(sym.pltIndex == entries.size());
+  assert(sym.aux().pltIndex == entries.size());
   entries.push_back(&sym);
 }
 
@@ -1164,7 +1259,8 @@ StringTableSection::StringTableSection(StringRef name, bool dynamic)
 // them with some other string that happens to be the same.
 unsigned StringTableSection::addString(StringRef s, bool hashIt) {
   if (hashIt) {
-    auto r = stringMap.insert(std::make_pair(s, this->size));
+    CachedHashStringRef key(s);
+    auto r = stringMaps[getShardId(key.hash())].insert({key, this->size});
     if (!r.second)
       return r.first->second;
   }
@@ -1174,12 +1270,117 @@ unsigned StringTableSection::addString(StringRef s, bool hashIt) {
   return ret;
 }
 
-void StringTableSection::writeTo(uint8_t *buf) {
-  for (StringRef s : strings) {
-    memcpy(buf, s.data(), s.size());
-    buf[s.size()] = '\0';
-    buf += s.size() + 1;
+// Adds strings with duplicate checking and returns their offsets. The result
+// is the same as calling addString() for each of them in order, but it is
+// computed in parallel, as there may be tens of millions of local symbols.
+std::vector<unsigned> StringTableSection::addStrings(ArrayRef<StringRef> strs) {
+  size_t n = strs.size();
+  std::vector<CachedHashStringRef> keys(n);
+  parallelForEachN(0, n,
+                   [&](size_t i) { keys[i] = CachedHashStringRef(strs[i]); });
+
+  // Find the first occurrence of each string. Each thread handles the strings
+  // of some shards in order, so the result does not depend on threading.
+  // firsts[i] is i if strs[i] is new, the index of its first occurrence if it
+  // is a duplicate of a new string, and -1 if it is already in the table.
+  size_t concurrency = 1;
+  if (threadsEnabled)
+    concurrency =
+        std::min<size_t>(PowerOf2Floor(getThreadCount()), numShards);
+
+  std::vector<unsigned> ret(n);
+  std::vector<size_t> firsts(n);
+  parallelForEachN(0, concurrency, [&](size_t threadId) {
+    DenseMap<CachedHashStringRef, size_t> seen;
+    for (size_t i = 0; i < n; ++i) {
+      size_t shardId = getShardId(keys[i].hash());
+      if ((shardId & (concurrency - 1)) != threadId)
+        continue;
+      auto it = stringMaps[shardId].find(keys[i]);
+      if (it != stringMaps[shardId].end()) {
+        ret[i] = it->second;
+        firsts[i] = -1;
+        continue;
+      }
+      firsts[i] = seen.insert({keys[i], i}).first->second;
+    }
+  });
+
+  // Compute the offsets of the new strings from prefix sums over chunks.
+  const size_t chunkSize = 1 << 16;
+  size_t numChunks = (n + chunkSize - 1) / chunkSize;
+  std::vector<uint64_t> chunkSizes(numChunks);
+  std::vector<size_t> chunkCounts(numChunks);
+  parallelForEachN(0, numChunks, [&](size_t c) {
+    for (size_t i = c * chunkSize, e = std::min(n, i + chunkSize); i < e; ++i) {
+      if (firsts[i] == i) {
+        chunkSizes[c] += strs[i].size() + 1;
+        ++chunkCounts[c];
+      }
+    }
+  });
+
+  std::vector<uint64_t> chunkOffsets(numChunks);
+  std::vector<size_t> chunkIndexes(numChunks);
+  for (size_t c = 0; c < numChunks; ++c) {
+    chunkOffsets[c] = size;
+    chunkIndexes[c] = strings.size();
+    size += chunkSizes[c];
+    strings.resize(strings.size() + chunkCounts[c]);
   }
+
+  parallelForEachN(0, numChunks, [&](size_t c) {
+    uint64_t off = chunkOffsets[c];
+    size_t idx = chunkIndexes[c];
+    for (size_t i = c * chunkSize, e = std::min(n, i + chunkSize); i < e; ++i) {
+      if (firsts[i] != i)
+        continue;
+      ret[i] = off;
+      off += strs[i].size() + 1;
+      strings[idx++] = strs[i];
+    }
+  });
+
+  // Resolve duplicates and remember the new strings.
+  parallelForEachN(0, n, [&](size_t i) {
+    if (firsts[i] != i && firsts[i] != (size_t)-1)
+      ret[i] = ret[firsts[i]];
+  });
+  parallelForEachN(0, concurrency, [&](size_t threadId) {
+    for (size_t i = 0; i < n; ++i) {
+      size_t shardId = getShardId(keys[i].hash());
+      if ((shardId & (concurrency - 1)) == threadId && firsts[i] == i)
+        stringMaps[shardId].insert({keys[i], ret[i]});
+    }
+  });
+  return ret;
+}
+
+void StringTableSection::writeTo(uint8_t *buf) {
+  // Write the strings in parallel chunks, each of which starts after the
+  // strings of the chunks before it.
+  const size_t chunkSize = 1 << 16;
+  size_t numChunks = (strings.size() + chunkSize - 1) / chunkSize;
+  std::vector<size_t> chunkOffsets(numChunks);
+  parallelForEachN(0, numChunks, [&](size_t c) {
+    size_t e = std::min(strings.size(), (c + 1) * chunkSize);
+    for (size_t i = c * chunkSize; i < e; ++i)
+      chunkOffsets[c] += strings[i].size() + 1;
+  });
+  size_t off = 0;
+  for (size_t &chunkOff : chunkOffsets)
+    off += std::exchange(chunkOff, off);
+
+  parallelForEachN(0, numChunks, [&](size_t c) {
+    uint8_t *p = buf + chunkOffsets[c];
+    size_t e = std::min(strings.size(), (c + 1) * chunkSize);
+    for (size_t i = c * chunkSize; i < e; ++i) {
+      StringRef s = strings[i];
+      memcpy(p, s.data(), s.size());
+      p[s.size()] = '\0';
+      p += s.size() + 1;
+    }
+  });
 }
 
 // Returns the number of entries in .gnu.version_d: the number of
@@ -1462,7 +1663,7 @@ template <class ELFT> void DynamicSection<ELFT>::finalizeContents() {
     add(DT_MIPS_LOCAL_GOTNO, [] { return in.mipsGot->getLocalEntriesNum(); });
 
     if (const Symbol *b = in.mipsGot->getFirstGlobalEntry())
-      addInt(DT_MIPS_GOTSYM, b->dynsymIndex);
+      addInt(DT_MIPS_GOTSYM, b->aux().dynsymIndex);
     else
       addInt(DT_MIPS_GOTSYM, part.dynSymTab->getNumSymbols());
     addInSec(DT_PLTGOT, in.mipsGot);
@@ -1554,6 +1755,26 @@ void RelocationBaseSection::addReloc(const DynamicReloc &reloc) {
   relocs.push_back(reloc);
 }
 
+// This is the same as addReloc() except that the relocation is added to a
+// shard, which only the task that owns the shard may touch. The task must
+// also own inputSec.
+void RelocationBaseSection::addRelocToShard(size_t shard, RelType dynType,
+                                            InputSectionBase *inputSec,
+                                            uint64_t offsetInSec, Symbol *sym,
+                                            int64_t addend, RelExpr expr,
+                                            RelType type) {
+  if (config->writeAddends && (expr != R_ADDEND || addend != 0))
+    inputSec->relocations.push_back({expr, type, offsetInSec, addend, sym});
+  shards[shard].push_back(
+      {dynType, inputSec, offsetInSec, expr != R_ADDEND, sym, addend});
+}
+
+void RelocationBaseSection::mergeShard(size_t shard) {
+  for (const DynamicReloc &reloc : shards[shard])
+    addReloc(reloc);
+  shards[shard] = {};
+}
+
 void RelocationBaseSection::finalizeContents() {
   SymbolTableBaseSection *symTab = getPartition().dynSymTab;
 
@@ -1576,6 +1797,11 @@ RelrBaseSection::RelrBaseSection()
                        config->useAndroidRelrTags ? SHT_ANDROID_RELR : SHT_RELR,
                        config->wordsize, ".relr.dyn") {}
 
+void RelrBaseSection::mergeShard(size_t shard) {
+  relocs.insert(relocs.end(), shards[shard].begin(), shards[shard].end());
+  shards[shard] = {};
+}
+
 template <class ELFT>
 static void encodeDynamicReloc(SymbolTableBaseSection *symTab,
                                typename ELFT::Rela *p,
@@ -1675,6 +1901,20 @@ bool AndroidPackedRelocationSection<ELFT>::updateAllocSize() {
 
   size_t oldSize = relocData.size();
 
+  // Encode the relocations. This is called until the layout converges, but
+  // usually only the first iteration or two change any address, so the
+  // relocations are packed again only if r_offset or r_addend of any of them
+  // changed. Unused r_addend fields are left zero so that they compare equal.
+  std::vector<Elf_Rela> encoded(relocs.size());
+  parallelForEachN(0, relocs.size(), [&](size_t i) {
+    encodeDynamicReloc<ELFT>(getPartition().dynSymTab, &encoded[i], relocs[i]);
+  });
+  if (oldSize && encoded.size() == encodedRelocs.size() &&
+      (encoded.empty() || memcmp(encoded.data(), encodedRelocs.data(),
+                                 encoded.size() * sizeof(Elf_Rela)) == 0))
+    return false;
+  encodedRelocs = std::move(encoded);
+
   relocData = {'A', 'P', 'S', '2'};
   raw_svector_ostream os(relocData);
   auto add = [&](int64_t v) { encodeSLEB128(v, os); };
@@ -1687,17 +1927,14 @@ bool AndroidPackedRelocationSection<ELFT>::updateAllocSize() {
 
   std::vector<Elf_Rela> relatives, nonRelatives;
 
-  for (const DynamicReloc &rel : relocs) {
-    Elf_Rela r;
-    encodeDynamicReloc<ELFT>(getPartition().dynSymTab, &r, rel);
-
+  for (const Elf_Rela &r : encodedRelocs) {
     if (r.getType(config->isMips64EL) == target->relativeRel)
       relatives.push_back(r);
     else
       nonRelatives.push_back(r);
   }
 
-  llvm::sort(relatives, [](const Elf_Rel &a, const Elf_Rel &b) {
+  parallelSort(relatives, [](const Elf_Rel &a, const Elf_Rel &b) {
     return a.r_offset < b.r_offset;
   });
 
@@ -1902,7 +2139,6 @@ template <class ELFT> bool RelrSection<ELFT>::updateAllocSize() {
   // 2. Just a simple list of addresses is a valid encoding.
 
   size_t oldSize = relrRelocs.size();
-  relrRelocs.clear();
 
   // Same as Config->Wordsize but faster because this is a compile-time
   // constant.
@@ -1912,11 +2148,37 @@ template <class ELFT> bool RelrSection<ELFT>::updateAllocSize() {
   // Must be either 63 or 31.
   const size_t nBits = wordsize * 8 - 1;
 
-  // Get offsets for all relative relocations and sort them.
-  std::vector<uint64_t> offsets;
-  for (const RelativeReloc &rel : relocs)
-    offsets.push_back(rel.getOffset());
-  llvm::sort(offsets);
+  // Get offsets for all relative relocations in the order in which they were
+  // sorted by the last iteration. Later iterations of the layout only move
+  // sections by thunks or by the sizes of packed relocation sections, which
+  // rarely reorders relocations, so the offsets are usually still sorted. If
+  // none of them moved, the contents of this section do not change either.
+  if (order.size() != relocs.size()) {
+    order.resize(relocs.size());
+    std::iota(order.begin(), order.end(), 0);
+    offsets.clear();
+  }
+
+  std::vector<uint64_t> newOffsets(order.size());
+  parallelForEachN(0, order.size(), [&](size_t i) {
+    newOffsets[i] = relocs[order[i]].getOffset();
+  });
+  if (oldSize && newOffsets == offsets)
+    return false;
+
+  if (!std::is_sorted(newOffsets.begin(), newOffsets.end())) {
+    std::vector<std::pair<uint64_t, uint32_t>> v(order.size());
+    for (size_t i = 0, e = order.size(); i != e; ++i)
+      v[i] = {newOffsets[i], order[i]};
+    parallelSort(v, [](const std::pair<uint64_t, uint32_t> &a,
+                       const std::pair<uint64_t, uint32_t> &b) {
+      return a < b;
+    });
+    for (size_t i = 0, e = order.size(); i != e; ++i)
+      std::tie(newOffsets[i], order[i]) = v[i];
+  }
+  offsets = std::move(newOffsets);
+  relrRelocs.clear();
 
   // For each leading relocation, find following ones that can be folded
   // as a bitmap and fold them.
@@ -1982,7 +2244,7 @@ static bool sortMipsSymbols(const SymbolTableEntry &l,
   // Sort entries related to non-local preemptible symbols by GOT indexes.
   // All other entries go to the beginning of a dynsym in arbitrary order.
   if (l.sym->isInGot() && r.sym->isInGot())
-    return l.sym->gotIndex < r.sym->gotIndex;
+    return l.sym->aux().gotIndex < r.sym->aux().gotIndex;
   if (!l.sym->isInGot() && !r.sym->isInGot())
     return false;
   return !l.sym->isInGot();
@@ -2016,7 +2278,7 @@ void SymbolTableBaseSection::finalizeContents() {
   if (this == mainPart->dynSymTab) {
     size_t i = 0;
     for (const SymbolTableEntry &s : symbols)
-      s.sym->dynsymIndex = ++i;
+      s.sym->allocateAux().dynsymIndex = ++i;
   }
 }
 
@@ -2059,12 +2321,25 @@ void SymbolTableBaseSection::addSymbol(Symbol *b) {
   symbols.push_back({b, strTabSec.addString(b->getName(), hashIt)});
 }
 
-size_t SymbolTableBaseSection::getSymbolIndex(Symbol *sym) {
-  if (this == mainPart->dynSymTab)
-    return sym->dynsymIndex;
+// Adds local symbols in order. This is the same as calling addSymbol() for
+// each of them, but their names are added to the string table in parallel.
+void SymbolTableBaseSection::addLocalSymbols(ArrayRef<Symbol *> syms) {
+  assert(this->type != SHT_DYNSYM);
+  std::vector<StringRef> names(syms.size());
+  parallelForEachN(0, syms.size(),
+                   [&](size_t i) { names[i] = syms[i]->getName(); });
+  std::vector<unsigned> offsets = strTabSec.addStrings(names);
 
-  // Initializes symbol lookup tables lazily. This is used only for -r,
-  // -emit-relocs and dynsyms in partitions other than the main one.
+  size_t begin = symbols.size();
+  symbols.resize(begin + syms.size());
+  parallelForEachN(0, syms.size(), [&](size_t i) {
+    symbols[begin + i] = {syms[i], offsets[i]};
+  });
+}
+
+// Initializes symbol lookup tables lazily. This is used only for -r,
+// -emit-relocs and dynsyms in partitions other than the main one.
+void SymbolTableBaseSection::initIndexMaps() {
   llvm::call_once(onceFlag, [&] {
     symbolIndexMap.reserve(symbols.size());
     size_t i = 0;
@@ -2075,6 +2350,28 @@ size_t SymbolTableBaseSection::getSymbolIndex(Symbol *sym) {
         symbolIndexMap[e.sym] = ++i;
     }
   });
+}
+
+// For -r and --emit-relocs, copyRelocations needs the symbol table index of
+// the target symbol of every relocation. Instead of looking up each of them
+// in the maps, this computes a table of the indices of each file's symbols,
+// which are usually far fewer than the relocations, in parallel.
+void SymbolTableBaseSection::initFileSymbolIndices() {
+  initIndexMaps();
+  parallelForEach(objectFiles, [&](InputFile *file) {
+    auto *f = cast<ELFFileBase>(file);
+    ArrayRef<Symbol *> syms = f->getSymbols();
+    f->symtabIndices.resize(syms.size());
+    for (size_t i = 0, e = syms.size(); i != e; ++i)
+      f->symtabIndices[i] = getSymbolIndex(syms[i]);
+  });
+}
+
+size_t SymbolTableBaseSection::getSymbolIndex(Symbol *sym) {
+  if (this == mainPart->dynSymTab)
+    return sym->aux().dynsymIndex;
+
+  initIndexMaps();
 
   // Section symbols are mapped based on their output sections
   // to maintain their semantics.
@@ -2113,9 +2410,12 @@ template <class ELFT> void SymbolTableSection<ELFT>::writeTo(uint8_t *buf) {
   memset(buf, 0, sizeof(Elf_Sym));
   buf += sizeof(Elf_Sym);
 
-  auto *eSym = reinterpret_cast<Elf_Sym *>(buf);
+  auto *eSyms = reinterpret_cast<Elf_Sym *>(buf);
 
-  for (SymbolTableEntry &ent : symbols) {
+  // Each entry only depends on its symbol, so they are written in parallel.
+  parallelForEachN(0, symbols.size(), [&](size_t i) {
+    const SymbolTableEntry &ent = symbols[i];
+    Elf_Sym *eSym = eSyms + i;
     Symbol *sym = ent.sym;
     bool isDefinedHere = type == SHT_SYMTAB || sym->partition == partition;
 
@@ -2158,9 +2458,7 @@ template <class ELFT> void SymbolTableSection<ELFT>::writeTo(uint8_t *buf) {
       eSym->st_value = sym->getVA();
     else
       eSym->st_value = 0;
-
-    ++eSym;
-  }
+  });
 
   // On MIPS we need to mark symbol which has a PLT entry and requires
   // pointer equality by STO_MIPS_PLT flag. That is necessary to help
@@ -2278,6 +2576,15 @@ void GnuHashTableSection::finalizeContents() {
   // bits for each symbol. It must be a power of two.
   if (symbols.empty()) {
     maskWords = 1;
+  } else if (config->tuneGnuHash) {
+    // With --tune-gnu-hash, allocate at least 16 bits for each symbol, which
+    // makes the false positive rate of the 2-bit filter about 1.4% or less.
+    // The bits of the hash above the ones that choose the word and the first
+    // bit are used for the second bit, so that the two bits are independent.
+    unsigned c = config->wordsize * 8;
+    uint64_t numBits = std::max<uint64_t>(PowerOf2Ceil(symbols.size() * 16), c);
+    maskWords = numBits / c;
+    shift2 = std::min<uint32_t>(Log2_64(numBits), 32 - Log2_32(c));
   } else {
     uint64_t numBits = symbols.size() * 12;
     maskWords = NextPowerOf2(numBits / (config->wordsize * 8));
@@ -2299,7 +2606,7 @@ void GnuHashTableSection::writeTo(uint8_t *buf) {
   write32(buf, nBuckets);
   write32(buf + 4, getPartition().dynSymTab->getNumSymbols() - symbols.size());
   write32(buf + 8, maskWords);
-  write32(buf + 12, Shift2);
+  write32(buf + 12, shift2);
   buf += 16;
 
   // Write a bloom filter and a hash table.
@@ -2316,39 +2623,42 @@ void GnuHashTableSection::writeTo(uint8_t *buf) {
 // [1] Ulrich Drepper (2011), "How To Write Shared Libraries" (Ver. 4.1.2),
 //     p.9, https://www.akkadia.org/drepper/dsohowto.pdf
 void GnuHashTableSection::writeBloomFilter(uint8_t *buf) {
+  // Many symbols set bits in the same word, so the words are updated
+  // atomically when symbols are added in parallel.
   unsigned c = config->is64 ? 64 : 32;
-  for (const Entry &sym : symbols) {
+  std::vector<std::atomic<uint64_t>> words(maskWords);
+  parallelForEach(symbols, [&](const Entry &sym) {
     // When C = 64, we choose a word with bits [6:...] and set 1 to two bits in
     // the word using bits [0:5] and [26:31].
     size_t i = (sym.hash / c) & (maskWords - 1);
-    uint64_t val = readUint(buf + i * config->wordsize);
-    val |= uint64_t(1) << (sym.hash % c);
-    val |= uint64_t(1) << ((sym.hash >> Shift2) % c);
-    writeUint(buf + i * config->wordsize, val);
-  }
+    uint64_t val = uint64_t(1) << (sym.hash % c);
+    val |= uint64_t(1) << ((sym.hash >> shift2) % c);
+    words[i].fetch_or(val, std::memory_order_relaxed);
+  });
+  for (size_t i = 0; i != maskWords; ++i)
+    writeUint(buf + i * config->wordsize, words[i]);
 }
 
 void GnuHashTableSection::writeHashTable(uint8_t *buf) {
   uint32_t *buckets = reinterpret_cast<uint32_t *>(buf);
-  uint32_t oldBucket = -1;
   uint32_t *values = buckets + nBuckets;
-  for (auto i = symbols.begin(), e = symbols.end(); i != e; ++i) {
+  size_t numSymbols = symbols.size();
+  parallelForEachN(0, numSymbols, [&](size_t i) {
     // Write a hash value. It represents a sequence of chains that share the
     // same hash modulo value. The last element of each chain is terminated by
     // LSB 1.
-    uint32_t hash = i->hash;
-    bool isLastInChain = (i + 1) == e || i->bucketIdx != (i + 1)->bucketIdx;
-    hash = isLastInChain ? hash | 1 : hash & ~1;
-    write32(values++, hash);
+    const Entry &ent = symbols[i];
+    bool isLastInChain =
+        i + 1 == numSymbols || ent.bucketIdx != symbols[i + 1].bucketIdx;
+    write32(values + i, isLastInChain ? ent.hash | 1 : ent.hash & ~1);
 
-    if (i->bucketIdx == oldBucket)
-      continue;
+    if (i != 0 && ent.bucketIdx == symbols[i - 1].bucketIdx)
+      return;
     // Write a hash bucket. Hash buckets contain indices in the following hash
     // value table.
-    write32(buckets + i->bucketIdx,
-            getPartition().dynSymTab->getSymbolIndex(i->sym));
-    oldBucket = i->bucketIdx;
-  }
+    write32(buckets + ent.bucketIdx,
+            getPartition().dynSymTab->getSymbolIndex(ent.sym));
+  });
 }
 
 static uint32_t hashGnu(StringRef name) {
@@ -2383,17 +2693,26 @@ void GnuHashTableSection::addSymbols(std::vector<SymbolTableEntry> &v) {
   if (mid == v.end())
     return;
 
-  for (SymbolTableEntry &ent : llvm::make_range(mid, v.end())) {
-    Symbol *b = ent.sym;
-    uint32_t hash = hashGnu(b->getName());
-    uint32_t bucketIdx = hash % nBuckets;
-    symbols.push_back({b, ent.strTabOffset, hash, bucketIdx});
-  }
-
-  llvm::stable_sort(symbols, [](const Entry &l, const Entry &r) {
-    return l.bucketIdx < r.bucketIdx;
+  // Hash the symbol names in parallel.
+  size_t numSymbols = v.end() - mid;
+  std::vector<Entry> entries(numSymbols);
+  parallelForEachN(0, numSymbols, [&](size_t i) {
+    SymbolTableEntry &ent = mid[i];
+    uint32_t hash = hashGnu(ent.sym->getName());
+    entries[i] = {ent.sym, ent.strTabOffset, hash, uint32_t(hash % nBuckets)};
   });
 
+  // Sort the symbols by bucket. Bucket indices are dense, so a counting sort,
+  // which is stable, does it in linear time.
+  std::vector<uint32_t> bucketStart(nBuckets + 1);
+  for (const Entry &ent : entries)
+    ++bucketStart[ent.bucketIdx + 1];
+  for (size_t i = 1; i <= nBuckets; ++i)
+    bucketStart[i] += bucketStart[i - 1];
+  symbols.resize(numSymbols);
+  for (const Entry &ent : entries)
+    symbols[bucketStart[ent.bucketIdx]++] = ent;
+
   v.erase(mid, v.end());
   for (const Entry &ent : symbols)
     v.push_back({ent.sym, ent.strTabOffset});
@@ -2436,7 +2755,7 @@ void HashTableSection::writeTo(uint8_t *buf) {
   for (const SymbolTableEntry &s : symTab->getSymbols()) {
     Symbol *sym = s.sym;
     StringRef name = sym->getName();
-    unsigned i = sym->dynsymIndex;
+    unsigned i = sym->aux().dynsymIndex;
     uint32_t hash = hashSysV(name) % numSymbols;
     chains[i] = buckets[hash];
     write32(buckets + hash, i);
@@ -2481,16 +2800,66 @@ void PltSection::writeTo(uint8_t *buf) {
     unsigned relOff = relSec->entsize * i + pltOff;
     uint64_t got = b->getGotPltVA();
     uint64_t plt = this->getVA() + off;
-    target->writePlt(buf + off, got, plt, b->pltIndex, relOff);
+    target->writePlt(buf + off, got, plt, b->aux().pltIndex, relOff);
     off += target->pltEntrySize;
   }
 }
 
 template <class ELFT> void PltSection::addEntry(Symbol &sym) {
-  sym.pltIndex = entries.size();
+  sym.allocateAux().pltIndex = entries.size();
   entries.push_back(&sym);
 }
 
+// PLT entries are created in the order in which relocations are scanned, so
+// the entries of the functions that are called most often end up all over
+// the PLT. For --sort-plt-entries, this moves them to the start of the PLT,
+// along with their .got.plt slots and .rel[a].plt relocations. The functions
+// listed in --symbol-ordering-file come first in that order, followed by the
+// ones in the call graph profile from the most to the least often called.
+void PltSection::sortEntries() {
+  assert(!isIplt);
+  assert(in.relaPlt->relocs.size() == entries.size());
+
+  DenseMap<StringRef, size_t> priority;
+  for (size_t i = 0, e = config->symbolOrderingFile.size(); i != e; ++i)
+    priority.try_emplace(config->symbolOrderingFile[i], i);
+
+  std::vector<std::tuple<size_t, uint64_t, size_t>> keys(entries.size());
+  for (size_t i = 0, e = entries.size(); i != e; ++i) {
+    const Symbol *sym = entries[i];
+    auto it = priority.find(sym->getName());
+    size_t prio = it == priority.end() ? SIZE_MAX : it->second;
+    uint64_t count = config->pltCallCounts.lookup(sym);
+    keys[i] = std::make_tuple(prio, UINT64_MAX - count, i);
+  }
+
+  std::vector<size_t> order(entries.size());
+  std::iota(order.begin(), order.end(), 0);
+  llvm::sort(order, [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+
+  // The relocations have the symbols that are mutable.
+  std::vector<const Symbol *> sorted;
+  std::vector<DynamicReloc> relocs;
+  for (size_t i = 0, e = order.size(); i != e; ++i) {
+    DynamicReloc rel = in.relaPlt->relocs[order[i]];
+    Symbol *sym = rel.sym;
+    sym->allocateAux().pltIndex = i;
+    rel.offsetInSec = sym->getGotPltOffset();
+
+    // A canonical PLT entry is the address of its symbol.
+    if (auto *d = dyn_cast<Defined>(sym))
+      if (d->section == this)
+        d->value = target->pltHeaderSize + target->pltEntrySize * i;
+
+    sorted.push_back(sym);
+    relocs.push_back(rel);
+  }
+
+  entries = sorted;
+  in.gotPlt->setEntries(std::move(sorted));
+  in.relaPlt->relocs = std::move(relocs);
+}
+
 size_t PltSection::getSize() const {
   return headerSize + entries.size() * target->pltEntrySize;
 }
@@ -2556,39 +2925,68 @@ static std::vector<GdbIndexSection::CuEntry> readCuList(DWARFContext &dwarf) {
   return ret;
 }
 
-static std::vector<GdbIndexSection::AddressEntry>
-readAddressAreas(DWARFContext &dwarf, InputSection *sec) {
-  std::vector<GdbIndexSection::AddressEntry> ret;
-
+namespace {
+// An address range of a compilation unit as it is in the object file, before
+// it is matched against the sections of this link.
+struct RawAddressEntry {
+  uint64_t sectionIndex;
+  uint64_t lowPC;
+  uint64_t highPC;
+  uint32_t cuIndex;
+};
+
+// What --gdb-index reads from the DWARF of an object file. It only depends on
+// the file contents, so it can be kept in --gdb-index-cache-dir.
+struct GdbIndexInput {
+  std::vector<GdbIndexSection::CuEntry> cus;
+  std::vector<RawAddressEntry> ranges;
+  std::vector<GdbIndexSection::NameAttrEntry> nameAttrs;
+};
+} // namespace
+
+static bool readAddressRanges(DWARFContext &dwarf, InputSection *sec,
+                              std::vector<RawAddressEntry> &ret) {
   uint32_t cuIdx = 0;
   for (std::unique_ptr<DWARFUnit> &cu : dwarf.compile_units()) {
     if (Error e = cu->tryExtractDIEsIfNeeded(false)) {
       error(toString(sec) + ": " + toString(std::move(e)));
-      return {};
+      ret.clear();
+      return false;
     }
     Expected<DWARFAddressRangesVector> ranges = cu->collectAddressRanges();
     if (!ranges) {
       error(toString(sec) + ": " + toString(ranges.takeError()));
-      return {};
+      ret.clear();
+      return false;
     }
 
-    ArrayRef<InputSectionBase *> sections = sec->file->getSections();
     for (DWARFAddressRange &r : *ranges) {
       if (r.SectionIndex == -1ULL)
         continue;
-      InputSectionBase *s = sections[r.SectionIndex];
-      if (!s || s == &InputSection::discarded || !s->isLive())
-        continue;
       // Range list with zero size has no effect.
       if (r.LowPC == r.HighPC)
         continue;
-      auto *isec = cast<InputSection>(s);
-      uint64_t offset = isec->getOffsetInFile();
-      ret.push_back({isec, r.LowPC - offset, r.HighPC - offset, cuIdx});
+      ret.push_back({r.SectionIndex, r.LowPC, r.HighPC, cuIdx});
     }
     ++cuIdx;
   }
+  return true;
+}
 
+static std::vector<GdbIndexSection::AddressEntry>
+readAddressAreas(ArrayRef<RawAddressEntry> ranges, InputSection *sec) {
+  std::vector<GdbIndexSection::AddressEntry> ret;
+  ArrayRef<InputSectionBase *> sections = sec->file->getSections();
+  for (const RawAddressEntry &r : ranges) {
+    if (r.sectionIndex >= sections.size())
+      continue;
+    InputSectionBase *s = sections[r.sectionIndex];
+    if (!s || s == &InputSection::discarded || !s->isLive())
+      continue;
+    auto *isec = cast<InputSection>(s);
+    uint64_t offset = isec->getOffsetInFile();
+    ret.push_back({isec, r.lowPC - offset, r.highPC - offset, r.cuIndex});
+  }
   return ret;
 }
 
@@ -2643,7 +3041,7 @@ createSymbols(ArrayRef<std::vector<GdbIndexSection::NameAttrEntry>> nameAttrs,
   size_t concurrency = 1;
   if (threadsEnabled)
     concurrency =
-        std::min<size_t>(PowerOf2Floor(hardware_concurrency()), numShards);
+        std::min<size_t>(PowerOf2Floor(getThreadCount()), numShards);
 
   // A sharded map to uniquify symbols by name.
   std::vector<DenseMap<CachedHashStringRef, size_t>> map(numShards);
@@ -2700,6 +3098,151 @@ createSymbols(ArrayRef<std::vector<GdbIndexSection::NameAttrEntry>> nameAttrs,
   return ret;
 }
 
+// The relocated DWARF only depends on the contents of the file if all the
+// relocations of its debug sections refer to local symbols, which is what
+// compilers emit. Other files are not cached.
+template <class ELFT> static bool isGdbIndexCacheable(ObjFile<ELFT> *file) {
+  size_t firstGlobal = file->template getELFSyms<ELFT>().size() -
+                       file->template getGlobalELFSyms<ELFT>().size();
+  auto isLocal = [&](const auto &rel) {
+    return rel.getSymbol(config->isMips64EL) < firstGlobal;
+  };
+  for (InputSectionBase *s : file->getSections()) {
+    if (!s || s == &InputSection::discarded || !s->name.startswith(".debug_"))
+      continue;
+    if (s->areRelocsRela ? !llvm::all_of(s->template relas<ELFT>(), isLocal)
+                         : !llvm::all_of(s->template rels<ELFT>(), isLocal))
+      return false;
+  }
+  return true;
+}
+
+static const char gdbIndexCacheMagic[] = "LLDGIDX1";
+
+static std::string getGdbIndexCachePath(MemoryBufferRef mb) {
+  SmallString<128> path(config->gdbIndexCacheDir);
+  sys::path::append(path, "gdb-" + utohexstr(xxHash64(mb.getBuffer())));
+  return path.str();
+}
+
+// A cache file starts with the magic and the lld version, followed by the
+// CU list, the address ranges and the names as little-endian integers.
+static void writeGdbIndexCache(StringRef path, const GdbIndexInput &in) {
+  std::string buf;
+  raw_string_ostream os(buf);
+  support::endian::Writer w(os, support::little);
+  std::string version = getLLDVersion();
+  os << gdbIndexCacheMagic;
+  w.write<uint32_t>(version.size());
+  os << version;
+
+  w.write<uint32_t>(in.cus.size());
+  for (const GdbIndexSection::CuEntry &cu : in.cus) {
+    w.write<uint64_t>(cu.cuOffset);
+    w.write<uint64_t>(cu.cuLength);
+  }
+  w.write<uint32_t>(in.ranges.size());
+  for (const RawAddressEntry &r : in.ranges) {
+    w.write<uint64_t>(r.sectionIndex);
+    w.write<uint64_t>(r.lowPC);
+    w.write<uint64_t>(r.highPC);
+    w.write<uint32_t>(r.cuIndex);
+  }
+  w.write<uint32_t>(in.nameAttrs.size());
+  for (const GdbIndexSection::NameAttrEntry &ent : in.nameAttrs) {
+    w.write<uint32_t>(ent.cuIndexAndAttrs);
+    w.write<uint32_t>(ent.name.size());
+    os << ent.name.val();
+  }
+  os.flush();
+
+  // Write a temporary file and rename it, so that concurrent links never
+  // read a partially written file. Failures just leave the entry uncached.
+  int fd;
+  SmallString<128> tmp;
+  if (sys::fs::createUniqueFile(path + ".tmp%%%%%%", fd, tmp))
+    return;
+  {
+    raw_fd_ostream out(fd, /*shouldClose=*/true);
+    out << buf;
+  }
+  if (sys::fs::rename(tmp, path))
+    sys::fs::remove(tmp);
+}
+
+// Reads a cache file written by writeGdbIndexCache. The names in `in` refer
+// to `mb`. Returns false if there is no valid cache file.
+static bool readGdbIndexCache(StringRef path, GdbIndexInput &in,
+                              std::unique_ptr<MemoryBuffer> &mb) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+      MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                            /*RequiresNullTerminator=*/false);
+  if (!mbOrErr)
+    return false;
+  StringRef data = (*mbOrErr)->getBuffer();
+
+  std::string version = getLLDVersion();
+  StringRef magic(gdbIndexCacheMagic);
+  if (!data.startswith(magic))
+    return false;
+  DataExtractor d(data, true, 8);
+  uint64_t off = magic.size();
+  auto has = [&](uint64_t size) { return size <= data.size() - off; };
+
+  if (!has(4) || d.getU32(&off) != version.size() || !has(version.size()) ||
+      data.substr(off, version.size()) != version)
+    return false;
+  off += version.size();
+
+  GdbIndexInput ret;
+  if (!has(4))
+    return false;
+  uint32_t numCus = d.getU32(&off);
+  if (!has(numCus * 16ULL))
+    return false;
+  for (uint32_t i = 0; i != numCus; ++i) {
+    uint64_t cuOffset = d.getU64(&off);
+    uint64_t cuLength = d.getU64(&off);
+    ret.cus.push_back({cuOffset, cuLength});
+  }
+
+  if (!has(4))
+    return false;
+  uint32_t numRanges = d.getU32(&off);
+  if (!has(numRanges * 28ULL))
+    return false;
+  for (uint32_t i = 0; i != numRanges; ++i) {
+    RawAddressEntry r;
+    r.sectionIndex = d.getU64(&off);
+    r.lowPC = d.getU64(&off);
+    r.highPC = d.getU64(&off);
+    r.cuIndex = d.getU32(&off);
+    ret.ranges.push_back(r);
+  }
+
+  if (!has(4))
+    return false;
+  uint32_t numNames = d.getU32(&off);
+  for (uint32_t i = 0; i != numNames; ++i) {
+    if (!has(8))
+      return false;
+    uint32_t cuIndexAndAttrs = d.getU32(&off);
+    uint32_t size = d.getU32(&off);
+    if (!has(size))
+      return false;
+    StringRef name = data.substr(off, size);
+    off += size;
+    ret.nameAttrs.push_back(
+        {CachedHashStringRef(name, computeGdbHash(name)), cuIndexAndAttrs});
+  }
+  if (off != data.size())
+    return false;
+
+  in = std::move(ret);
+  mb = std::move(*mbOrErr);
+  return true;
+}
+
 // Returns a newly-created .gdb_index section.
 template <class ELFT> GdbIndexSection *GdbIndexSection::create() {
   std::vector<InputSection *> sections = getDebugInfoSections();
@@ -2711,24 +3254,59 @@ template <class ELFT> GdbIndexSection *GdbIndexSection::create() {
     if (s->name == ".debug_gnu_pubnames" || s->name == ".debug_gnu_pubtypes")
       s->markDead();
 
+  StringRef cacheDir = config->gdbIndexCacheDir;
+  if (!cacheDir.empty())
+    if (std::error_code ec = sys::fs::create_directories(cacheDir))
+      warn("cannot create --gdb-index-cache-dir " + cacheDir + ": " +
+           ec.message());
+
   std::vector<GdbChunk> chunks(sections.size());
   std::vector<std::vector<NameAttrEntry>> nameAttrs(sections.size());
+  std::vector<std::unique_ptr<MemoryBuffer>> cacheBuffers(sections.size());
+  std::vector<GdbIndexInput> inputs(sections.size());
+  std::vector<std::string> cachePaths(sections.size());
 
   parallelForEachN(0, sections.size(), [&](size_t i) {
     ObjFile<ELFT> *file = sections[i]->getFile<ELFT>();
-    DWARFContext dwarf(std::make_unique<LLDDwarfObj<ELFT>>(file));
+    if (!cacheDir.empty() && isGdbIndexCacheable(file)) {
+      cachePaths[i] = getGdbIndexCachePath(file->mb);
+      if (readGdbIndexCache(cachePaths[i], inputs[i], cacheBuffers[i]))
+        cachePaths[i].clear();
+    }
+  });
+
+  // Uncompress the debug sections of the files that are not in the cache.
+  std::vector<InputFile *> files;
+  for (size_t i = 0, e = sections.size(); i != e; ++i)
+    if (!cacheBuffers[i])
+      files.push_back(sections[i]->file);
+  uncompressDwarfSections(files);
+
+  parallelForEachN(0, sections.size(), [&](size_t i) {
+    ObjFile<ELFT> *file = sections[i]->getFile<ELFT>();
+    GdbIndexInput &in = inputs[i];
+    const std::string &cachePath = cachePaths[i];
+
+    if (!cacheBuffers[i]) {
+      DWARFContext dwarf(std::make_unique<LLDDwarfObj<ELFT>>(file));
+      in.cus = readCuList(dwarf);
+      bool ok = readAddressRanges(dwarf, sections[i], in.ranges);
+      in.nameAttrs = readPubNamesAndTypes<ELFT>(
+          static_cast<const LLDDwarfObj<ELFT> &>(dwarf.getDWARFObj()), in.cus);
+      if (ok && !cachePath.empty())
+        writeGdbIndexCache(cachePath, in);
+    }
 
     chunks[i].sec = sections[i];
-    chunks[i].compilationUnits = readCuList(dwarf);
-    chunks[i].addressAreas = readAddressAreas(dwarf, sections[i]);
-    nameAttrs[i] = readPubNamesAndTypes<ELFT>(
-        static_cast<const LLDDwarfObj<ELFT> &>(dwarf.getDWARFObj()),
-        chunks[i].compilationUnits);
+    chunks[i].compilationUnits = std::move(in.cus);
+    chunks[i].addressAreas = readAddressAreas(in.ranges, sections[i]);
+    nameAttrs[i] = std::move(in.nameAttrs);
   });
 
   auto *ret = make<GdbIndexSection>();
   ret->chunks = std::move(chunks);
   ret->symbols = createSymbols(nameAttrs, ret->chunks);
+  ret->cacheBuffers = std::move(cacheBuffers);
   ret->initOutputSize();
   return ret;
 }
@@ -2803,6 +3381,418 @@ void GdbIndexSection::writeTo(uint8_t *buf) {
 
 bool GdbIndexSection::isNeeded() const { return !chunks.empty(); }
 
+DebugNamesSection::DebugNamesSection()
+    : SyntheticSection(0, SHT_PROGBITS, 4, ".debug_names") {}
+
+static bool isSupportedDebugNamesForm(uint32_t form) {
+  switch (form) {
+  case DW_FORM_data1:
+  case DW_FORM_data2:
+  case DW_FORM_data4:
+  case DW_FORM_data8:
+  case DW_FORM_ref1:
+  case DW_FORM_ref2:
+  case DW_FORM_ref4:
+  case DW_FORM_ref8:
+  case DW_FORM_udata:
+  case DW_FORM_ref_udata:
+  case DW_FORM_flag_present:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static size_t getDebugNamesFormSize(uint32_t form, uint64_t value) {
+  switch (form) {
+  case DW_FORM_data1:
+  case DW_FORM_ref1:
+    return 1;
+  case DW_FORM_data2:
+  case DW_FORM_ref2:
+    return 2;
+  case DW_FORM_data4:
+  case DW_FORM_ref4:
+    return 4;
+  case DW_FORM_data8:
+  case DW_FORM_ref8:
+    return 8;
+  case DW_FORM_udata:
+  case DW_FORM_ref_udata:
+    return getULEB128Size(value);
+  default:
+    return 0;
+  }
+}
+
+static uint8_t *writeDebugNamesForm(uint8_t *buf, uint32_t form,
+                                    uint64_t value) {
+  switch (form) {
+  case DW_FORM_data1:
+  case DW_FORM_ref1:
+    *buf = value;
+    break;
+  case DW_FORM_data2:
+  case DW_FORM_ref2:
+    write16(buf, value);
+    break;
+  case DW_FORM_data4:
+  case DW_FORM_ref4:
+    write32(buf, value);
+    break;
+  case DW_FORM_data8:
+  case DW_FORM_ref8:
+    write64(buf, value);
+    break;
+  case DW_FORM_udata:
+  case DW_FORM_ref_udata:
+    encodeULEB128(value, buf);
+    break;
+  }
+  return buf + getDebugNamesFormSize(form, value);
+}
+
+// Reads the name indexes in the .debug_names section of an object file.
+// Returns false if the section cannot be merged, in which case it is copied
+// to the output as it is.
+template <class ELFT>
+static bool readDebugNames(const LLDDwarfObj<ELFT> &obj,
+                           DebugNamesSection::NamesChunk &chunk) {
+  using Abbrev = DebugNamesSection::Abbrev;
+  const auto &namesSec =
+      static_cast<const LLDDWARFSection &>(obj.getNamesSection());
+  chunk.namesSec = namesSec.sec;
+  chunk.infoSec = cast<InputSection>(obj.getInfoSection().sec);
+
+  DWARFDataExtractor data(obj, namesSec, config->isLE, config->wordsize);
+  DataExtractor strData(obj.getStrSection(), config->isLE, config->wordsize);
+  DWARFDebugNames index(data, strData);
+  if (Error e = index.extract()) {
+    warn(toString(namesSec.sec) + ": " + toString(std::move(e)) +
+         "; not merging it");
+    return false;
+  }
+
+  for (const DWARFDebugNames::NameIndex &ni : index) {
+    if (ni.getLocalTUCount() || ni.getForeignTUCount()) {
+      warn(toString(namesSec.sec) +
+           ": type units are not supported; not merging it");
+      return false;
+    }
+
+    uint32_t cuBase = chunk.cuOffsets.size();
+    for (uint32_t i = 0, e = ni.getCUCount(); i != e; ++i)
+      chunk.cuOffsets.push_back(ni.getCUOffset(i));
+
+    // Abbreviation codes are local to each name index.
+    DenseMap<const DWARFDebugNames::Abbrev *, uint32_t> abbrevIndexes;
+
+    for (const DWARFDebugNames::NameTableEntry &nte : ni) {
+      const char *name = nte.getString();
+      if (!name) {
+        warn(toString(namesSec.sec) + ": invalid string offset 0x" +
+             utohexstr(nte.getStringOffset()) + "; not merging it");
+        return false;
+      }
+
+      StringRef s(name);
+      chunk.names.push_back({CachedHashStringRef(s, caseFoldingDjbHash(s)),
+                             obj.getStrInputSection(), nte.getStringOffset(),
+                             {}, 0});
+      std::vector<DebugNamesSection::Entry> &entries =
+          chunk.names.back().entries;
+
+      uint64_t offset = nte.getEntryOffset();
+      for (;;) {
+        // The list of entries is terminated by a sentinel, which is reported
+        // as an error.
+        Expected<DWARFDebugNames::Entry> ent = ni.getEntry(&offset);
+        if (!ent) {
+          consumeError(ent.takeError());
+          break;
+        }
+
+        const DWARFDebugNames::Abbrev &abbr = ent->getAbbrev();
+        auto it = abbrevIndexes.try_emplace(&abbr, chunk.abbrevs.size());
+        if (it.second) {
+          Abbrev a{abbr.Tag, {}};
+          for (const DWARFDebugNames::AttributeEncoding &attr :
+               abbr.Attributes) {
+            // Parent references are offsets in the input entry pool, so
+            // they are dropped; DW_IDX_parent is optional.
+            if (attr.Index == DW_IDX_compile_unit ||
+                attr.Index == DW_IDX_parent)
+              continue;
+            if (!isSupportedDebugNamesForm(attr.Form)) {
+              warn(toString(namesSec.sec) + ": unsupported form 0x" +
+                   utohexstr(attr.Form) + "; not merging it");
+              return false;
+            }
+            a.attrs.push_back({attr.Index, attr.Form});
+          }
+          chunk.abbrevs.push_back(std::move(a));
+        }
+
+        DebugNamesSection::Entry out{it.first->second, cuBase, {}};
+        ArrayRef<DWARFFormValue> values = ent->getValues();
+        for (size_t i = 0, e = values.size(); i != e; ++i) {
+          uint32_t idx = abbr.Attributes[i].Index;
+          if (idx == DW_IDX_compile_unit)
+            out.cuIndex = cuBase + values[i].getRawUValue();
+          else if (idx != DW_IDX_parent)
+            out.values.push_back(values[i].getRawUValue());
+        }
+        if (out.cuIndex >= chunk.cuOffsets.size()) {
+          warn(toString(namesSec.sec) +
+               ": invalid compile unit index; not merging it");
+          return false;
+        }
+        entries.push_back(std::move(out));
+      }
+    }
+  }
+  return true;
+}
+
+// Merges the names of all chunks by uniquifying them by name. This is done
+// in parallel in the same way as createSymbols() for .gdb_index.
+void DebugNamesSection::mergeNames() {
+  // Abbreviations are shared by the whole output index. There are only a
+  // few of them, so this is done serially.
+  std::map<std::pair<uint32_t, std::vector<std::pair<uint32_t, uint32_t>>>,
+           uint32_t>
+      abbrevMap;
+  std::vector<std::vector<uint32_t>> abbrevRemaps(chunks.size());
+  for (size_t i = 0, e = chunks.size(); i != e; ++i) {
+    for (Abbrev &a : chunks[i].abbrevs) {
+      auto it = abbrevMap.insert({{a.tag, a.attrs}, (uint32_t)abbrevs.size()});
+      if (it.second)
+        abbrevs.push_back(a);
+      abbrevRemaps[i].push_back(it.first->second);
+    }
+  }
+
+  // For each chunk, compute the number of compilation units preceding it.
+  uint32_t cuIdx = 0;
+  std::vector<uint32_t> cuIdxs(chunks.size());
+  for (uint32_t i = 0, e = chunks.size(); i != e; ++i) {
+    cuIdxs[i] = cuIdx;
+    cuIdx += chunks[i].cuOffsets.size();
+  }
+
+  size_t numShards = 32;
+  size_t concurrency = 1;
+  if (threadsEnabled)
+    concurrency =
+        std::min<size_t>(PowerOf2Floor(getThreadCount()), numShards);
+
+  std::vector<DenseMap<CachedHashStringRef, size_t>> map(numShards);
+  std::vector<std::vector<NameData>> shards(numShards);
+  size_t shift = 32 - countTrailingZeros(numShards);
+
+  parallelForEachN(0, concurrency, [&](size_t threadId) {
+    for (size_t i = 0, e = chunks.size(); i != e; ++i) {
+      for (NameData &nd : chunks[i].names) {
+        size_t shardId = nd.name.hash() >> shift;
+        if ((shardId & (concurrency - 1)) != threadId)
+          continue;
+
+        for (Entry &ent : nd.entries) {
+          ent.abbrevIndex = abbrevRemaps[i][ent.abbrevIndex];
+          ent.cuIndex += cuIdxs[i];
+        }
+
+        size_t &idx = map[shardId][nd.name];
+        if (idx) {
+          std::vector<Entry> &v = shards[shardId][idx - 1].entries;
+          v.insert(v.end(), std::make_move_iterator(nd.entries.begin()),
+                   std::make_move_iterator(nd.entries.end()));
+          continue;
+        }
+
+        idx = shards[shardId].size() + 1;
+        shards[shardId].push_back(std::move(nd));
+      }
+    }
+  });
+
+  for (NamesChunk &chunk : chunks)
+    chunk.names.clear();
+  for (std::vector<NameData> &shard : shards)
+    for (NameData &nd : shard)
+      names.push_back(std::move(nd));
+}
+
+// Computes the hash table layout and the output section size.
+void DebugNamesSection::initOutputSize() {
+  // The same heuristic as LLVM uses when it creates the index.
+  if (names.size() > 1024)
+    bucketCount = names.size() / 4;
+  else if (names.size() > 16)
+    bucketCount = names.size() / 2;
+  else
+    bucketCount = std::max<size_t>(names.size(), 1);
+
+  // Names are sorted by bucket, as a bucket refers to its first name.
+  parallelSort(names, [&](const NameData &a, const NameData &b) {
+    uint32_t x = a.name.hash() % bucketCount;
+    uint32_t y = b.name.hash() % bucketCount;
+    if (x != y)
+      return x < y;
+    if (a.name.hash() != b.name.hash())
+      return a.name.hash() < b.name.hash();
+    return a.name.val() < b.name.val();
+  });
+
+  abbrevTableSize = 1;
+  for (size_t i = 0, e = abbrevs.size(); i != e; ++i) {
+    abbrevTableSize += getULEB128Size(i + 1) + getULEB128Size(abbrevs[i].tag) +
+                       getULEB128Size(DW_IDX_compile_unit) +
+                       getULEB128Size(DW_FORM_data4) + 2;
+    for (std::pair<uint32_t, uint32_t> attr : abbrevs[i].attrs)
+      abbrevTableSize +=
+          getULEB128Size(attr.first) + getULEB128Size(attr.second);
+  }
+
+  // Each list of entries is terminated by a zero abbreviation code.
+  std::vector<uint32_t> entrySizes(names.size());
+  parallelForEachN(0, names.size(), [&](size_t i) {
+    uint32_t sz = 1;
+    for (const Entry &ent : names[i].entries) {
+      const Abbrev &a = abbrevs[ent.abbrevIndex];
+      sz += getULEB128Size(ent.abbrevIndex + 1) + 4;
+      for (size_t j = 0, e = a.attrs.size(); j != e; ++j)
+        sz += getDebugNamesFormSize(a.attrs[j].second, ent.values[j]);
+    }
+    entrySizes[i] = sz;
+  });
+
+  uint32_t off = 0;
+  for (size_t i = 0, e = names.size(); i != e; ++i) {
+    names[i].entryOffset = off;
+    off += entrySizes[i];
+  }
+
+  size_t numCus = 0;
+  for (const NamesChunk &chunk : chunks)
+    numCus += chunk.cuOffsets.size();
+
+  // The header is 36 bytes, followed by the CU list, the buckets, the
+  // hashes, the string offsets and the entry offsets.
+  size = 36 + numCus * 4 + bucketCount * 4 + names.size() * 12 +
+         abbrevTableSize + off;
+}
+
+// Returns a newly-created .debug_names section.
+template <class ELFT> DebugNamesSection *DebugNamesSection::create() {
+  std::vector<ObjFile<ELFT> *> files;
+  for (InputFile *f : objectFiles) {
+    auto *file = cast<ObjFile<ELFT>>(f);
+    bool hasInfo = false, hasNames = false;
+    for (InputSectionBase *s : file->getSections()) {
+      if (!s || s == &InputSection::discarded)
+        continue;
+      hasInfo |= s->name == ".debug_info";
+      hasNames |= s->name == ".debug_names";
+    }
+    if (hasInfo && hasNames)
+      files.push_back(file);
+  }
+
+  uncompressDwarfSections(std::vector<InputFile *>(files.begin(), files.end()));
+
+  std::vector<NamesChunk> chunks(files.size());
+  std::vector<uint8_t> merged(files.size());
+  parallelForEachN(0, files.size(), [&](size_t i) {
+    LLDDwarfObj<ELFT> obj(files[i]);
+    merged[i] = readDebugNames(obj, chunks[i]);
+  });
+
+  auto *ret = make<DebugNamesSection>();
+  for (size_t i = 0, e = chunks.size(); i != e; ++i) {
+    if (!merged[i])
+      continue;
+    // The input index is replaced by the merged one.
+    chunks[i].namesSec->markDead();
+    ret->chunks.push_back(std::move(chunks[i]));
+  }
+  ret->mergeNames();
+  ret->initOutputSize();
+  return ret;
+}
+
+void DebugNamesSection::writeTo(uint8_t *buf) {
+  size_t numCus = 0;
+  for (const NamesChunk &chunk : chunks)
+    numCus += chunk.cuOffsets.size();
+
+  // Write the header.
+  write32(buf, size - 4);
+  write16(buf + 4, 5);
+  write16(buf + 6, 0);
+  write32(buf + 8, numCus);
+  write32(buf + 12, 0);
+  write32(buf + 16, 0);
+  write32(buf + 20, bucketCount);
+  write32(buf + 24, names.size());
+  write32(buf + 28, abbrevTableSize);
+  write32(buf + 32, 0);
+  buf += 36;
+
+  // Write the CU list.
+  for (const NamesChunk &chunk : chunks) {
+    for (uint64_t cuOffset : chunk.cuOffsets) {
+      write32(buf, chunk.infoSec->outSecOff + cuOffset);
+      buf += 4;
+    }
+  }
+
+  // Write the hash table. A bucket holds the 1-based index of its first name.
+  uint8_t *buckets = buf;
+  uint8_t *hashes = buckets + bucketCount * 4;
+  uint8_t *strOffsets = hashes + names.size() * 4;
+  uint8_t *entryOffsets = strOffsets + names.size() * 4;
+  memset(buckets, 0, bucketCount * 4);
+  for (size_t i = names.size(); i != 0; --i)
+    write32(buckets + (names[i - 1].name.hash() % bucketCount) * 4, i);
+  parallelForEachN(0, names.size(), [&](size_t i) {
+    const NameData &nd = names[i];
+    write32(hashes + i * 4, nd.name.hash());
+    write32(strOffsets + i * 4, nd.strSec->getVA(nd.strOffset));
+    write32(entryOffsets + i * 4, nd.entryOffset);
+  });
+  buf = entryOffsets + names.size() * 4;
+
+  // Write the abbreviation table.
+  for (size_t i = 0, e = abbrevs.size(); i != e; ++i) {
+    buf += encodeULEB128(i + 1, buf);
+    buf += encodeULEB128(abbrevs[i].tag, buf);
+    buf += encodeULEB128(DW_IDX_compile_unit, buf);
+    buf += encodeULEB128(DW_FORM_data4, buf);
+    for (std::pair<uint32_t, uint32_t> attr : abbrevs[i].attrs) {
+      buf += encodeULEB128(attr.first, buf);
+      buf += encodeULEB128(attr.second, buf);
+    }
+    *buf++ = 0;
+    *buf++ = 0;
+  }
+  *buf++ = 0;
+
+  // Write the entry pool.
+  parallelForEach(names, [&](const NameData &nd) {
+    uint8_t *p = buf + nd.entryOffset;
+    for (const Entry &ent : nd.entries) {
+      const Abbrev &a = abbrevs[ent.abbrevIndex];
+      p += encodeULEB128(ent.abbrevIndex + 1, p);
+      write32(p, ent.cuIndex);
+      p += 4;
+      for (size_t j = 0, e = a.attrs.size(); j != e; ++j)
+        p = writeDebugNamesForm(p, a.attrs[j].second, ent.values[j]);
+    }
+    *p = 0;
+  });
+}
+
 EhFrameHeader::EhFrameHeader()
     : SyntheticSection(SHF_ALLOC, SHT_PROGBITS, 4, ".eh_frame_hdr") {}
 
@@ -3034,33 +4024,103 @@ void MergeSyntheticSection::addSection(MergeInputSection *ms) {
   alignment = std::max(alignment, ms->alignment);
 }
 
-MergeTailSection::MergeTailSection(StringRef name, uint32_t type,
-                                   uint64_t flags, uint32_t alignment)
-    : MergeSyntheticSection(name, type, flags, alignment),
-      builder(StringTableBuilder::RAW, alignment) {}
+size_t MergeSyntheticSection::getConcurrency() {
+  if (!threadsEnabled)
+    return 1;
+  return std::min<size_t>(PowerOf2Floor(getThreadCount()), numShards);
+}
 
-size_t MergeTailSection::getSize() const { return builder.getSize(); }
+void MergeTailSection::writeTo(uint8_t *buf) {
+  parallelForEach(strings, [&](const std::pair<StringRef, uint64_t> &p) {
+    memcpy(buf + p.second, p.first.data(), p.first.size());
+  });
+}
 
-void MergeTailSection::writeTo(uint8_t *buf) { builder.write(buf); }
+// Returns true if a should come before b in a tail-merged string table:
+// strings are sorted in descending order of their reversed contents, so that
+// a string comes right after the longest one that it is a suffix of. This is
+// the order that StringTableBuilder uses.
+static bool isTailMergeOrdered(StringRef a, StringRef b) {
+  size_t n = std::min(a.size(), b.size());
+  for (size_t i = 1; i <= n; ++i) {
+    unsigned char x = a[a.size() - i];
+    unsigned char y = b[b.size() - i];
+    if (x != y)
+      return x > y;
+  }
+  return a.size() > b.size();
+}
 
+// This is the same as StringTableBuilder::finalize() for a RAW table, which
+// is serial and can take seconds for large inputs, but runs in parallel.
+// Strings are deduplicated in shards as in MergeNoTailSection and then
+// sorted in parallel. One linear pass over the sorted strings then places
+// each string at the end of the previous one if it is a suffix of that and
+// the alignment allows it, or after everything else otherwise, which gives
+// the same section contents as StringTableBuilder.
 void MergeTailSection::finalizeContents() {
-  // Add all string pieces to the string table builder to create section
-  // contents.
-  for (MergeInputSection *sec : sections)
-    for (size_t i = 0, e = sec->pieces.size(); i != e; ++i)
-      if (sec->pieces[i].live)
-        builder.add(sec->getData(i));
+  size_t concurrency = getConcurrency();
+
+  // Deduplicate the strings. For now, the index of each piece's string in
+  // its shard is stored as its output offset.
+  std::vector<std::vector<StringRef>> shards(numShards);
+  std::vector<DenseMap<CachedHashStringRef, uint32_t>> maps(numShards);
+  parallelForEachN(0, concurrency, [&](size_t threadId) {
+    for (MergeInputSection *sec : sections) {
+      for (size_t i = 0, e = sec->pieces.size(); i != e; ++i) {
+        SectionPiece &piece = sec->pieces[i];
+        if (!piece.live)
+          continue;
+        size_t shardId = getShardId(piece.hash);
+        if ((shardId & (concurrency - 1)) != threadId)
+          continue;
+        StringRef s = sec->getData(i);
+        auto it = maps[shardId].try_emplace(CachedHashStringRef(s, piece.hash),
+                                            shards[shardId].size());
+        if (it.second)
+          shards[shardId].push_back(s);
+        piece.outputOff = it.first->second;
+      }
+    }
+  });
 
-  // Fix the string table content. After this, the contents will never change.
-  builder.finalize();
+  size_t shardBase[numShards];
+  std::vector<StringRef> all;
+  for (size_t i = 0; i < numShards; ++i) {
+    shardBase[i] = all.size();
+    all.insert(all.end(), shards[i].begin(), shards[i].end());
+  }
 
-  // finalize() fixed tail-optimized strings, so we can now get
-  // offsets of strings. Get an offset for each string and save it
-  // to a corresponding SectionPiece for easy access.
-  for (MergeInputSection *sec : sections)
-    for (size_t i = 0, e = sec->pieces.size(); i != e; ++i)
-      if (sec->pieces[i].live)
-        sec->pieces[i].outputOff = builder.getOffset(sec->getData(i));
+  std::vector<uint32_t> order(all.size());
+  std::iota(order.begin(), order.end(), 0);
+  parallelSort(order, [&](uint32_t a, uint32_t b) {
+    return isTailMergeOrdered(all[a], all[b]);
+  });
+
+  std::vector<uint64_t> offsets(all.size());
+  StringRef prev;
+  for (uint32_t i : order) {
+    StringRef s = all[i];
+    if (prev.endswith(s)) {
+      uint64_t pos = size - s.size();
+      if (!(pos & (alignment - 1))) {
+        offsets[i] = pos;
+        continue;
+      }
+    }
+    size = alignTo(size, alignment);
+    offsets[i] = size;
+    strings.push_back({s, size});
+    size += s.size();
+    prev = s;
+  }
+
+  parallelForEach(sections, [&](MergeInputSection *sec) {
+    for (SectionPiece &piece : sec->pieces)
+      if (piece.live)
+        piece.outputOff =
+            offsets[shardBase[getShardId(piece.hash)] + piece.outputOff];
+  });
 }
 
 void MergeNoTailSection::writeTo(uint8_t *buf) {
@@ -3081,12 +4141,7 @@ void MergeNoTailSection::finalizeContents() {
   for (size_t i = 0; i < numShards; ++i)
     shards.emplace_back(StringTableBuilder::RAW, alignment);
 
-  // Concurrency level. Must be a power of 2 to avoid expensive modulo
-  // operations in the following tight loop.
-  size_t concurrency = 1;
-  if (threadsEnabled)
-    concurrency =
-        std::min<size_t>(PowerOf2Floor(hardware_concurrency()), numShards);
+  size_t concurrency = getConcurrency();
 
   // Add section pieces to the builders.
   parallelForEachN(0, concurrency, [&](size_t threadId) {
@@ -3096,7 +4151,8 @@ void MergeNoTailSection::finalizeContents() {
           continue;
         size_t shardId = getShardId(sec->pieces[i].hash);
         if ((shardId & (concurrency - 1)) == threadId)
-          sec->pieces[i].outputOff = shards[shardId].add(sec->getData(i));
+          sec->pieces[i].outputOff = shards[shardId].add(
+              CachedHashStringRef(sec->getData(i), sec->pieces[i].hash));
       }
     }
   });
@@ -3429,8 +4485,8 @@ PPC64LongBranchTargetSection::PPC64LongBranchTargetSection()
                        ".branch_lt") {}
 
 void PPC64LongBranchTargetSection::addEntry(Symbol &sym) {
-  assert(sym.ppc64BranchltIndex == 0xffff);
-  sym.ppc64BranchltIndex = entries.size();
+  assert(!sym.isInPPC64Branchlt());
+  sym.allocateAux().ppc64BranchltIndex = entries.size();
   entries.push_back(&sym);
 }
 
@@ -3596,6 +4652,11 @@ template GdbIndexSection *GdbIndexSection::create<ELF32BE>();
 template GdbIndexSection *GdbIndexSection::create<ELF64LE>();
 template GdbIndexSection *GdbIndexSection::create<ELF64BE>();
 
+template DebugNamesSection *DebugNamesSection::create<ELF32LE>();
+template DebugNamesSection *DebugNamesSection::create<ELF32BE>();
+template DebugNamesSection *DebugNamesSection::create<ELF64LE>();
+template DebugNamesSection *DebugNamesSection::create<ELF64BE>();
+
 template void splitSections<ELF32LE>();
 template void splitSections<ELF32BE>();
 template void splitSections<ELF64LE>();
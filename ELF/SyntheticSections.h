@@ -90,29 +90,38 @@ public:
   ArrayRef<CieRecord *> getCieRecords() const { return cieRecords; }
 
 private:
-  // This is used only when parsing EhInputSection. We keep it here to avoid
-  // allocating one for each EhInputSection.
-  llvm::DenseMap<size_t, CieRecord *> offsetToCie;
+  // The records of an input section, which are read in parallel before
+  // they are added to cieRecords.
+  struct EhSectionRecords {
+    struct Cie {
+      EhSectionPiece *piece;
+      Symbol *personality;
+      unsigned hash;
+    };
+    std::vector<Cie> cies;
+    // Live FDEs and the indices of their CIEs in `cies`.
+    std::vector<std::pair<uint32_t, EhSectionPiece *>> fdes;
+  };
 
   uint64_t size = 0;
 
   template <class ELFT, class RelTy>
-  void addRecords(EhInputSection *s, llvm::ArrayRef<RelTy> rels);
+  void addRecords(EhInputSection *s, llvm::ArrayRef<RelTy> rels,
+                  EhSectionRecords &ret);
   template <class ELFT>
-  void addSectionAux(EhInputSection *s);
+  void addSectionAux(EhInputSection *s, EhSectionRecords &ret);
 
   template <class ELFT, class RelTy>
-  CieRecord *addCie(EhSectionPiece &piece, ArrayRef<RelTy> rels);
+  Symbol *getPersonality(EhSectionPiece &piece, ArrayRef<RelTy> rels);
 
   template <class ELFT, class RelTy>
   bool isFdeLive(EhSectionPiece &piece, ArrayRef<RelTy> rels);
 
+  void mergeRecords(ArrayRef<EhSectionRecords> records);
+
   uint64_t getFdePc(uint8_t *buf, size_t off, uint8_t enc) const;
 
   std::vector<CieRecord *> cieRecords;
-
-  // CIE records are uniquified by their contents and personality functions.
-  llvm::DenseMap<std::pair<ArrayRef<uint8_t>, Symbol *>, CieRecord *> cieMap;
 };
 
 class GotSection : public SyntheticSection {
@@ -372,6 +381,7 @@ class GotPltSection final : public SyntheticSection {
 public:
   GotPltSection();
   void addEntry(Symbol &sym);
+  void setEntries(std::vector<const Symbol *> v) { entries = std::move(v); }
   size_t getSize() const override;
   void writeTo(uint8_t *buf) override;
   bool isNeeded() const override;
@@ -404,16 +414,25 @@ class StringTableSection final : public SyntheticSection {
 public:
   StringTableSection(StringRef name, bool dynamic);
   unsigned addString(StringRef s, bool hashIt = true);
+  std::vector<unsigned> addStrings(ArrayRef<StringRef> strs);
   void writeTo(uint8_t *buf) override;
   size_t getSize() const override { return size; }
   bool isDynamic() const { return dynamic; }
 
 private:
+  // The strings that are checked for duplicates are kept in maps sharded
+  // by hash, so that addStrings() can look them up in parallel.
+  constexpr static size_t numShards = 32;
+
+  static size_t getShardId(uint32_t hash) {
+    return hash >> (32 - llvm::countTrailingZeros(numShards));
+  }
+
   const bool dynamic;
 
   uint64_t size = 0;
 
-  llvm::DenseMap<StringRef, unsigned> stringMap;
+  llvm::DenseMap<llvm::CachedHashStringRef, unsigned> stringMaps[numShards];
   std::vector<StringRef> strings;
 };
 
@@ -495,12 +514,23 @@ public:
                 uint64_t offsetInSec, Symbol *sym, int64_t addend, RelExpr expr,
                 RelType type);
   void addReloc(const DynamicReloc &reloc);
+
+  // Relocations can also be added by tasks that run in parallel, each to a
+  // shard of its own. The shards are then appended to relocs one by one by
+  // mergeShard(), so the result doesn't depend on scheduling.
+  void initShards(size_t n) { shards.resize(n); }
+  void addRelocToShard(size_t shard, RelType dynType, InputSectionBase *isec,
+                       uint64_t offsetInSec, Symbol *sym, int64_t addend,
+                       RelExpr expr, RelType type);
+  void mergeShard(size_t shard);
+
   bool isNeeded() const override { return !relocs.empty(); }
   size_t getSize() const override { return relocs.size() * this->entsize; }
   size_t getRelativeRelocCount() const { return numRelativeRelocs; }
   void finalizeContents() override;
   int32_t dynamicTag, sizeDynamicTag;
   std::vector<DynamicReloc> relocs;
+  std::vector<std::vector<DynamicReloc>> shards;
 
 protected:
   size_t numRelativeRelocs = 0;
@@ -535,6 +565,9 @@ public:
 
 private:
   SmallVector<char, 0> relocData;
+
+  // The relocations as they were encoded by the last updateAllocSize().
+  std::vector<Elf_Rela> encodedRelocs;
 };
 
 struct RelativeReloc {
@@ -548,7 +581,16 @@ class RelrBaseSection : public SyntheticSection {
 public:
   RelrBaseSection();
   bool isNeeded() const override { return !relocs.empty(); }
+
+  // See RelocationBaseSection::initShards.
+  void initShards(size_t n) { shards.resize(n); }
+  void addRelocToShard(size_t shard, const RelativeReloc &reloc) {
+    shards[shard].push_back(reloc);
+  }
+  void mergeShard(size_t shard);
+
   std::vector<RelativeReloc> relocs;
+  std::vector<std::vector<RelativeReloc>> shards;
 };
 
 // RelrSection is used to encode offsets for relative relocations.
@@ -569,6 +611,11 @@ public:
 
 private:
   std::vector<Elf_Relr> relrRelocs;
+
+  // The offsets of the relocations as of the last updateAllocSize(), sorted,
+  // and the indices of the relocations in `relocs` in that order.
+  std::vector<uint64_t> offsets;
+  std::vector<uint32_t> order;
 };
 
 struct SymbolTableEntry {
@@ -582,12 +629,17 @@ public:
   void finalizeContents() override;
   size_t getSize() const override { return getNumSymbols() * entsize; }
   void addSymbol(Symbol *sym);
+  void addLocalSymbols(ArrayRef<Symbol *> syms);
   unsigned getNumSymbols() const { return symbols.size() + 1; }
   size_t getSymbolIndex(Symbol *sym);
   ArrayRef<SymbolTableEntry> getSymbols() const { return symbols; }
 
+  // Sets ELFFileBase::symtabIndices of all object files.
+  void initFileSymbolIndices();
+
 protected:
   void sortSymTabSymbols();
+  void initIndexMaps();
 
   // A vector of symbols and their string table offsets.
   std::vector<SymbolTableEntry> symbols;
@@ -632,9 +684,6 @@ public:
   void addSymbols(std::vector<SymbolTableEntry> &symbols);
 
 private:
-  // See the comment in writeBloomFilter.
-  enum { Shift2 = 26 };
-
   void writeBloomFilter(uint8_t *buf);
   void writeHashTable(uint8_t *buf);
 
@@ -649,6 +698,10 @@ private:
   size_t maskWords;
   size_t nBuckets = 0;
   size_t size = 0;
+
+  // The shift count of the second bit of the bloom filter. See the comment in
+  // writeBloomFilter.
+  uint32_t shift2 = 26;
 };
 
 class HashTableSection final : public SyntheticSection {
@@ -674,6 +727,7 @@ public:
   bool isNeeded() const override { return !entries.empty(); }
   void addSymbols();
   template <class ELFT> void addEntry(Symbol &sym);
+  void sortEntries();
 
   size_t headerSize;
 
@@ -740,9 +794,68 @@ private:
   // A symbol table for this .gdb_index section.
   std::vector<GdbSymbol> symbols;
 
+  // The --gdb-index-cache-dir files that symbol names point into.
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> cacheBuffers;
+
   size_t size;
 };
 
+// --debug-names merges the DWARF v5 .debug_names name indexes of the input
+// files into a single index covering all compilation units, so that
+// debuggers do not have to read one index per object file. The format is
+// described in section 6.1.1 of the DWARF v5 standard.
+class DebugNamesSection final : public SyntheticSection {
+public:
+  struct Abbrev {
+    uint32_t tag;
+    // DW_IDX_* and DW_FORM_* pairs. DW_IDX_compile_unit is not included, as
+    // every entry of the merged index has one.
+    std::vector<std::pair<uint32_t, uint32_t>> attrs;
+  };
+
+  struct Entry {
+    uint32_t abbrevIndex;
+    uint32_t cuIndex;
+    llvm::SmallVector<uint64_t, 2> values;
+  };
+
+  struct NameData {
+    llvm::CachedHashStringRef name;
+    // The name in an input .debug_str, whose output offset is only known
+    // when the section is written.
+    InputSectionBase *strSec;
+    uint64_t strOffset;
+    std::vector<Entry> entries;
+    uint32_t entryOffset;
+  };
+
+  // The name indexes of a single object file.
+  struct NamesChunk {
+    InputSectionBase *namesSec;
+    InputSection *infoSec;
+    std::vector<uint64_t> cuOffsets;
+    std::vector<Abbrev> abbrevs;
+    std::vector<NameData> names;
+  };
+
+  DebugNamesSection();
+  template <typename ELFT> static DebugNamesSection *create();
+  void writeTo(uint8_t *buf) override;
+  size_t getSize() const override { return size; }
+  bool isNeeded() const override { return !names.empty(); }
+
+private:
+  void mergeNames();
+  void initOutputSize();
+
+  std::vector<NamesChunk> chunks;
+  std::vector<Abbrev> abbrevs;
+  std::vector<NameData> names;
+  uint32_t bucketCount = 0;
+  uint32_t abbrevTableSize = 0;
+  size_t size = 0;
+};
+
 // --eh-frame-hdr option tells linker to construct a header for all the
 // .eh_frame sections. This header is placed to a section named .eh_frame_hdr
 // and also to a PT_GNU_EH_FRAME segment.
@@ -844,19 +957,41 @@ protected:
   MergeSyntheticSection(StringRef name, uint32_t type, uint64_t flags,
                         uint32_t alignment)
       : SyntheticSection(flags, type, alignment, name) {}
+
+  // Strings are deduplicated in parallel in shards.
+  constexpr static size_t numShards = 32;
+
+  // We use the most significant bits of a hash as a shard ID.
+  // The reason why we don't want to use the least significant bits is
+  // because DenseMap also uses lower bits to determine a bucket ID.
+  // If we use lower bits, it significantly increases the probability of
+  // hash collisons.
+  static size_t getShardId(uint32_t hash) {
+    assert((hash >> 31) == 0);
+    return hash >> (31 - llvm::countTrailingZeros(numShards));
+  }
+
+  // The number of threads to use for deduplication. It is a power of 2 to
+  // avoid expensive modulo operations in tight loops.
+  static size_t getConcurrency();
 };
 
 class MergeTailSection final : public MergeSyntheticSection {
 public:
   MergeTailSection(StringRef name, uint32_t type, uint64_t flags,
-                   uint32_t alignment);
+                   uint32_t alignment)
+      : MergeSyntheticSection(name, type, flags, alignment) {}
 
-  size_t getSize() const override;
+  size_t getSize() const override { return size; }
   void writeTo(uint8_t *buf) override;
   void finalizeContents() override;
 
 private:
-  llvm::StringTableBuilder builder;
+  // Section size
+  size_t size = 0;
+
+  // The strings that are not tail-merged into others, and their offsets.
+  std::vector<std::pair<StringRef, uint64_t>> strings;
 };
 
 class MergeNoTailSection final : public MergeSyntheticSection {
@@ -870,21 +1005,10 @@ public:
   void finalizeContents() override;
 
 private:
-  // We use the most significant bits of a hash as a shard ID.
-  // The reason why we don't want to use the least significant bits is
-  // because DenseMap also uses lower bits to determine a bucket ID.
-  // If we use lower bits, it significantly increases the probability of
-  // hash collisons.
-  size_t getShardId(uint32_t hash) {
-    assert((hash >> 31) == 0);
-    return hash >> (31 - llvm::countTrailingZeros(numShards));
-  }
-
   // Section size
   size_t size;
 
   // String table contents
-  constexpr static size_t numShards = 32;
   std::vector<llvm::StringTableBuilder> shards;
   size_t shardOffsets[numShards];
 };
@@ -1054,6 +1178,16 @@ public:
   void writeTo(uint8_t *buf) override {}
 };
 
+// An empty section that aligns the position it is placed at. It is used for
+// the boundaries of the hot text region for -z hugepage-hot-text.
+class AlignmentSection final : public SyntheticSection {
+public:
+  AlignmentSection(uint64_t flags, uint32_t alignment, StringRef name)
+      : SyntheticSection(flags, llvm::ELF::SHT_PROGBITS, alignment, name) {}
+  size_t getSize() const override { return 0; }
+  void writeTo(uint8_t *buf) override {}
+};
+
 // This section is used to store the addresses of functions that are called
 // in range-extending thunks on PowerPC64. When producing position dependant
 // code the addresses are link-time constants and the table is written out to
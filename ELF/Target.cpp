@@ -143,6 +143,26 @@ bool TargetInfo::inBranchRange(RelType type, uint64_t src, uint64_t dst) const {
   return true;
 }
 
+bool TargetInfo::deleteFallThruJmpInsn(InputSection &is,
+                                       InputSection *nextIS) const {
+  return false;
+}
+
+bool TargetInfo::relaxJmpInsn(InputSection &is) const { return false; }
+
+void TargetInfo::applyJumpInstrMod(uint8_t *loc, JumpModType type,
+                                   unsigned size) const {
+  llvm_unreachable("Should not have rewritten a jump");
+}
+
+void TargetInfo::relocateAlloc(InputSectionBase &sec, uint8_t *buf,
+                               uint8_t *bufEnd) const {
+  sec.relocateAllocWith(
+      buf, bufEnd, [&](uint8_t *loc, RelType type, uint64_t val) {
+        relocateOne(loc, type, val);
+      });
+}
+
 void TargetInfo::writeIgotPlt(uint8_t *buf, const Symbol &s) const {
   writeGotPlt(buf, s);
 }
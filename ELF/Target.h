@@ -77,8 +77,29 @@ public:
   virtual bool inBranchRange(RelType type, uint64_t src,
                              uint64_t dst) const;
 
+  // The following three are used by --optimize-bb-jumps. This one deletes
+  // the jump at the end of is if it jumps to nextIS, possibly by flipping the
+  // conditional jump before it, and returns true if it did.
+  virtual bool deleteFallThruJmpInsn(InputSection &is,
+                                     InputSection *nextIS) const;
+
+  // Shrinks the jump at the end of is to a shorter encoding if its target is
+  // in range, or grows it back if it was shrunk and no longer is. Returns
+  // true if is changed.
+  virtual bool relaxJmpInsn(InputSection &is) const;
+
+  // Writes the opcode of a jump rewritten by the other two.
+  virtual void applyJumpInstrMod(uint8_t *loc, JumpModType type,
+                                 unsigned size) const;
+
   virtual void relocateOne(uint8_t *loc, RelType type, uint64_t val) const = 0;
 
+  // Applies the relocations of an SHF_ALLOC section. Targets with many
+  // relocations override this to call InputSectionBase::relocateAllocWith()
+  // with their own relocateOne(), so that it is not a virtual call.
+  virtual void relocateAlloc(InputSectionBase &sec, uint8_t *buf,
+                             uint8_t *bufEnd) const;
+
   virtual ~TargetInfo();
 
   unsigned defaultCommonPageSize = 4096;
@@ -116,6 +137,10 @@ public:
   // executable OutputSections.
   std::array<uint8_t, 4> trapInstr;
 
+  // Nop instructions of increasing sizes, starting from 1 byte, used to pad
+  // executable code that is run through. Empty if the target has none.
+  std::vector<std::vector<uint8_t>> nopInstrs;
+
   // If a target needs to rewrite calls to __morestack to instead call
   // __morestack_non_split when a split-stack enabled caller calls a
   // non-split-stack callee this will return true. Otherwise returns false.
@@ -184,6 +209,8 @@ bool isPPC64SmallCodeModelTocReloc(RelType type);
 
 uint64_t getPPC64TocBase();
 uint64_t getAArch64Page(uint64_t expr);
+bool canRelaxAArch64GotLoad(const uint8_t *loc);
+void relaxAArch64GotLoad(uint8_t *loc, uint64_t p, uint64_t val);
 
 extern const TargetInfo *target;
 TargetInfo *getTarget();
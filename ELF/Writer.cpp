@@ -11,10 +11,14 @@
 #include "ARMErrataFix.h"
 #include "CallGraphSort.h"
 #include "Config.h"
+#include "Determinism.h"
 #include "LinkerScript.h"
 #include "MapFile.h"
 #include "OutputSections.h"
+#include "PassThrough.h"
+#include "ReleaseMemory.h"
 #include "Relocations.h"
+#include "SymbolOrder.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "SyntheticSections.h"
@@ -23,6 +27,7 @@
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/RandomNumberGenerator.h"
@@ -38,6 +43,15 @@ using namespace llvm::support::endian;
 
 namespace lld {
 namespace elf {
+
+static Timer finalizeSectionsTimer("Finalize Sections", Timer::root());
+static Timer scanRelocationsTimer("Scan Relocations", finalizeSectionsTimer);
+static Timer thunksTimer("Create Thunks", finalizeSectionsTimer);
+static Timer assignFileOffsetsTimer("Assign File Offsets", Timer::root());
+static Timer writeSectionsTimer("Write Sections", Timer::root());
+static Timer buildIdTimer("Write Build ID", Timer::root());
+static Timer diskCommitTimer("Commit Output File", Timer::root());
+
 namespace {
 // The writer writes a SymbolTable result to a file.
 template <class ELFT> class Writer {
@@ -57,6 +71,8 @@ private:
   void resolveShfLinkOrder();
   void finalizeAddressDependentContent();
   void sortInputSections();
+  void placeHotText(OutputSection *sec,
+                    const DenseMap<const InputSectionBase *, int> &order);
   void finalizeSections();
   void checkExecuteOnly();
   void setReservedSymbolSections();
@@ -74,6 +90,7 @@ private:
   void writeHeader();
   void writeSections();
   void writeSectionsBinary();
+  void startBuildId();
   void writeBuildId();
 
   std::unique_ptr<FileOutputBuffer> &buffer;
@@ -81,9 +98,15 @@ private:
   void addRelIpltSymbols();
   void addStartEndSymbols();
   void addStartStopSymbols(OutputSection *sec);
+  void addHotTextSymbols();
 
   uint64_t fileSize;
   uint64_t sectionHeaderOff;
+
+  // Empty sections at the start and the end of the hot text region for
+  // -z hugepage-hot-text.
+  InputSection *hotTextStart = nullptr;
+  InputSection *hotTextEnd = nullptr;
 };
 } // anonymous namespace
 
@@ -113,10 +136,13 @@ StringRef getOutputSectionName(const InputSectionBase *s) {
   // When enabled, this allows identifying the hot code region (.text.hot) in
   // the final binary which can be selectively mapped to huge pages or mlocked,
   // for instance.
+  //
+  // -z hugepage-hot-text gathers hot code at the start of .text instead.
   if (config->zKeepTextSectionPrefix)
     for (StringRef v :
          {".text.hot.", ".text.unlikely.", ".text.startup.", ".text.exit."})
-      if (isSectionPrefix(v, s->name))
+      if (isSectionPrefix(v, s->name) &&
+          !(config->zHugepageHotText && v == ".text.hot."))
         return v.drop_back();
 
   for (StringRef v :
@@ -497,6 +523,8 @@ template <class ELFT> void createSyntheticSections() {
 
   if (config->gdbIndex)
     add(GdbIndexSection::create<ELFT>());
+  if (config->debugNames)
+    add(DebugNamesSection::create<ELFT>());
 
   // We always need to add rel[a].plt to output if it has entries.
   // Even for static linking it can contain R_[*]_IRELATIVE relocations.
@@ -552,7 +580,10 @@ template <class ELFT> void Writer<ELFT>::run() {
   // completes section contents. For example, we need to add strings
   // to the string table, and add entries to .got and .plt.
   // finalizeSections does that.
-  finalizeSections();
+  {
+    ScopedTimer t(finalizeSectionsTimer);
+    finalizeSections();
+  }
   checkExecuteOnly();
   if (errorCount())
     return;
@@ -572,10 +603,13 @@ template <class ELFT> void Writer<ELFT>::run() {
   for (Partition &part : partitions)
     removeEmptyPTLoad(part.phdrs);
 
-  if (!config->oFormatBinary)
-    assignFileOffsets();
-  else
-    assignFileOffsetsBinary();
+  {
+    ScopedTimer t(assignFileOffsetsTimer);
+    if (!config->oFormatBinary)
+      assignFileOffsets();
+    else
+      assignFileOffsetsBinary();
+  }
 
   for (Partition &part : partitions)
     setPhdrs(part);
@@ -590,34 +624,50 @@ template <class ELFT> void Writer<ELFT>::run() {
   // It does not make sense try to open the file if we have error already.
   if (errorCount())
     return;
+  selectPassThroughSections();
   // Write the result down to a file.
   openFile();
   if (errorCount())
     return;
 
-  if (!config->oFormatBinary) {
-    if (config->zSeparate != SeparateSegmentKind::None)
-      writeTrapInstr();
-    writeHeader();
-    writeSections();
-  } else {
-    writeSectionsBinary();
+  startBuildId();
+  {
+    ScopedTimer t(writeSectionsTimer);
+    if (!config->oFormatBinary) {
+      if (config->zSeparate != SeparateSegmentKind::None)
+        writeTrapInstr();
+      writeHeader();
+      writeSections();
+    } else {
+      writeSectionsBinary();
+    }
   }
 
   // Backfill .note.gnu.build-id section content. This is done at last
   // because the content is usually a hash value of the entire output file.
-  writeBuildId();
+  {
+    ScopedTimer t(buildIdTimer);
+    writeBuildId();
+  }
   if (errorCount())
     return;
 
+  if (!config->determinismLog.empty() || !config->verifyDeterminism.empty())
+    checkDeterminism({buffer->getBufferStart(), buffer->getBufferSize()});
+
   // Handle -Map and -cref options.
   writeMapFile();
   writeCrossReferenceTable();
   if (errorCount())
     return;
 
-  if (auto e = buffer->commit())
-    error("failed to write to the output file: " + toString(std::move(e)));
+  // Pass-through sections are copied into the output file after it has been
+  // committed. If the time is reported, commit right away so that it is
+  // measured.
+  ScopedTimer t(diskCommitTimer);
+  bool sync = config->showTiming || !config->timeJsonFile.empty();
+  commitOutput(std::move(buffer), "failed to write to the output file: ",
+               sync, copyPassThroughSections);
 }
 
 static bool shouldKeepInSymtab(const Defined &sym) {
@@ -677,8 +727,12 @@ static bool includeInSymtab(const Symbol &b) {
 template <class ELFT> void Writer<ELFT>::copyLocalSymbols() {
   if (!in.symTab)
     return;
-  for (InputFile *file : objectFiles) {
-    ObjFile<ELFT> *f = cast<ObjFile<ELFT>>(file);
+
+  // Files are scanned in parallel. The symbols are then added in the order of
+  // the files, so the output does not depend on threading.
+  std::vector<std::vector<Symbol *>> syms(objectFiles.size());
+  parallelForEachN(0, objectFiles.size(), [&](size_t i) {
+    ObjFile<ELFT> *f = cast<ObjFile<ELFT>>(objectFiles[i]);
     for (Symbol *b : f->getLocalSymbols()) {
       if (!b->isLocal())
         fatal(toString(f) +
@@ -692,9 +746,18 @@ template <class ELFT> void Writer<ELFT>::copyLocalSymbols() {
         continue;
       if (!shouldKeepInSymtab(*dr))
         continue;
-      in.symTab->addSymbol(b);
+      syms[i].push_back(b);
     }
-  }
+  });
+
+  size_t numSyms = 0;
+  for (const std::vector<Symbol *> &v : syms)
+    numSyms += v.size();
+  std::vector<Symbol *> all;
+  all.reserve(numSyms);
+  for (const std::vector<Symbol *> &v : syms)
+    all.insert(all.end(), v.begin(), v.end());
+  in.symTab->addLocalSymbols(all);
 }
 
 // Create a section symbol for each output section so that we can represent
@@ -1202,36 +1265,46 @@ static DenseMap<const InputSectionBase *, int> buildSectionOrder() {
   if (!config->callGraphProfile.empty())
     return computeCallGraphProfileOrder();
 
-  if (config->symbolOrderingFile.empty())
+  if (config->symbolOrderingFile.empty() && config->symbolOrderingIndex.empty())
     return sectionOrder;
 
-  struct SymbolOrderEntry {
-    int priority;
-    bool present;
+  // Build a map from symbols to their positions in the symbol ordering file,
+  // unless the file is an index, which is such a map already. Symbols that
+  // didn't appear in the symbol ordering file have the lowest priority 0.
+  // All explicitly mentioned symbols have negative (higher) priorities.
+  SymbolOrderIndex index(config->symbolOrderingIndex);
+  bool useIndex = !config->symbolOrderingIndex.empty();
+  size_t numSymbols =
+      useIndex ? index.size() : config->symbolOrderingFile.size();
+
+  DenseMap<StringRef, int> symbolOrder;
+  if (!useIndex)
+    for (size_t i = 0; i != numSymbols; ++i)
+      symbolOrder.insert({config->symbolOrderingFile[i], i});
+
+  auto find = [&](StringRef name) -> int {
+    if (useIndex)
+      return index.find(name);
+    auto it = symbolOrder.find(name);
+    return it == symbolOrder.end() ? -1 : it->second;
   };
 
-  // Build a map from symbols to their priorities. Symbols that didn't
-  // appear in the symbol ordering file have the lowest priority 0.
-  // All explicitly mentioned symbols have negative (higher) priorities.
-  DenseMap<StringRef, SymbolOrderEntry> symbolOrder;
-  int priority = -config->symbolOrderingFile.size();
-  for (StringRef s : config->symbolOrderingFile)
-    symbolOrder.insert({s, {priority++, false}});
+  std::vector<bool> present(numSymbols);
+  int firstPriority = -numSymbols;
 
   // Build a map from sections to their priorities.
   auto addSym = [&](Symbol &sym) {
-    auto it = symbolOrder.find(sym.getName());
-    if (it == symbolOrder.end())
+    int i = find(sym.getName());
+    if (i < 0)
       return;
-    SymbolOrderEntry &ent = it->second;
-    ent.present = true;
+    present[i] = true;
 
     maybeWarnUnorderableSymbol(&sym);
 
     if (auto *d = dyn_cast<Defined>(&sym)) {
       if (auto *sec = dyn_cast_or_null<InputSectionBase>(d->section)) {
         int &priority = sectionOrder[cast<InputSectionBase>(sec->repl)];
-        priority = std::min(priority, ent.priority);
+        priority = std::min(priority, firstPriority + i);
       }
     }
   };
@@ -1249,31 +1322,116 @@ static DenseMap<const InputSectionBase *, int> buildSectionOrder() {
         addSym(*sym);
 
   if (config->warnSymbolOrdering)
-    for (auto orderEntry : symbolOrder)
-      if (!orderEntry.second.present)
-        warn("symbol ordering file: no such symbol: " + orderEntry.first);
+    for (size_t i = 0; i != numSymbols; ++i)
+      if (!present[i])
+        warn("symbol ordering file: no such symbol: " +
+             (useIndex ? index.getName(i) : config->symbolOrderingFile[i]));
 
   return sectionOrder;
 }
 
+// Adds the data sections in --data-ordering-file to the section order. They
+// get priorities below those of any other ordered section so that they are
+// placed first in their output sections. A list of symbols is placed in the
+// order of the list, and a profile by access count per byte.
+static void
+addDataSectionOrder(DenseMap<const InputSectionBase *, int> &sectionOrder) {
+  DenseMap<StringRef, size_t> symbolIndex;
+  for (size_t i = 0, e = config->dataOrderingFile.size(); i != e; ++i)
+    symbolIndex.insert({config->dataOrderingFile[i].first, i});
+
+  // For each section, the lowest index of its symbols in the list, or the
+  // sum of the access counts of its symbols.
+  MapVector<InputSectionBase *, uint64_t> sections;
+  std::vector<bool> present(config->dataOrderingFile.size());
+
+  auto addSym = [&](Symbol &sym) {
+    auto it = symbolIndex.find(sym.getName());
+    if (it == symbolIndex.end())
+      return;
+    present[it->second] = true;
+
+    auto *d = dyn_cast<Defined>(&sym);
+    if (!d || !d->section)
+      return;
+    auto *sec = cast<InputSectionBase>(d->section->repl);
+    if (!(sec->flags & SHF_ALLOC) || (sec->flags & SHF_EXECINSTR))
+      return;
+
+    auto p = sections.insert({sec, config->dataOrderingProfile
+                                       ? 0
+                                       : std::numeric_limits<uint64_t>::max()});
+    if (config->dataOrderingProfile)
+      p.first->second += config->dataOrderingFile[it->second].second;
+    else
+      p.first->second = std::min<uint64_t>(p.first->second, it->second);
+  };
+
+  symtab->forEachSymbol([&](Symbol *sym) {
+    if (!sym->isLazy())
+      addSym(*sym);
+  });
+  for (InputFile *file : objectFiles)
+    for (Symbol *sym : file->getSymbols())
+      if (sym->isLocal())
+        addSym(*sym);
+
+  if (config->warnSymbolOrdering)
+    for (size_t i = 0, e = present.size(); i != e; ++i)
+      if (!present[i])
+        warn("data ordering file: no such symbol: " +
+             config->dataOrderingFile[i].first);
+
+  std::vector<std::pair<InputSectionBase *, uint64_t>> v =
+      sections.takeVector();
+  if (config->dataOrderingProfile) {
+    // Hottest sections per byte first.
+    auto density = [](const std::pair<InputSectionBase *, uint64_t> &p) {
+      return (double)p.second / std::max<uint64_t>(p.first->getSize(), 1);
+    };
+    llvm::stable_sort(v, [&](const std::pair<InputSectionBase *, uint64_t> &a,
+                             const std::pair<InputSectionBase *, uint64_t> &b) {
+      return density(a) > density(b);
+    });
+  } else {
+    llvm::stable_sort(v, [](const std::pair<InputSectionBase *, uint64_t> &a,
+                            const std::pair<InputSectionBase *, uint64_t> &b) {
+      return a.second < b.second;
+    });
+  }
+
+  int priority = INT_MIN;
+  for (std::pair<InputSectionBase *, uint64_t> &p : v)
+    sectionOrder[p.first] = priority++;
+}
+
 // Sorts the sections in ISD according to the provided section order.
 static void
 sortISDBySectionOrder(InputSectionDescription *isd,
-                      const DenseMap<const InputSectionBase *, int> &order) {
+                      const DenseMap<const InputSectionBase *, int> &order,
+                      bool executable) {
   std::vector<InputSection *> unorderedSections;
-  std::vector<std::pair<InputSection *, int>> orderedSections;
   uint64_t unorderedSize = 0;
 
-  for (InputSection *isec : isd->sections) {
-    auto i = order.find(isec);
-    if (i == order.end()) {
-      unorderedSections.push_back(isec);
-      unorderedSize += isec->getSize();
+  // Look up the priorities in parallel, using INT_MAX for the sections that
+  // are not ordered, and sort (priority, index) pairs so that the sort
+  // doesn't need to access the sections.
+  std::vector<int> priorities(isd->sections.size());
+  parallelForEachN(0, isd->sections.size(), [&](size_t i) {
+    auto it = order.find(isd->sections[i]);
+    priorities[i] = it == order.end() ? INT_MAX : it->second;
+  });
+
+  std::vector<std::pair<int, size_t>> orderedSections;
+  for (size_t i = 0, e = isd->sections.size(); i != e; ++i) {
+    if (priorities[i] == INT_MAX) {
+      unorderedSections.push_back(isd->sections[i]);
+      unorderedSize += isd->sections[i]->getSize();
       continue;
     }
-    orderedSections.push_back({isec, i->second});
+    orderedSections.push_back({priorities[i], i});
   }
-  llvm::sort(orderedSections, llvm::less_second());
+  parallelSort(orderedSections, std::less<std::pair<int, size_t>>());
 
   // Find an insertion point for the ordered section list in the unordered
   // section list. On targets with limited-range branches, this is the mid-point
@@ -1303,7 +1461,8 @@ sortISDBySectionOrder(InputSectionDescription *isd,
   // we effectively double the amount of code that could potentially call into
   // the hot code without a thunk.
   size_t insPt = 0;
-  if (target->getThunkSectionSpacing() && !orderedSections.empty()) {
+  if (executable && target->getThunkSectionSpacing() &&
+      !orderedSections.empty()) {
     uint64_t unorderedPos = 0;
     for (; insPt != unorderedSections.size(); ++insPt) {
       unorderedPos += unorderedSections[insPt]->getSize();
@@ -1312,13 +1471,15 @@ sortISDBySectionOrder(InputSectionDescription *isd,
     }
   }
 
-  isd->sections.clear();
+  std::vector<InputSection *> sections;
+  sections.reserve(isd->sections.size());
   for (InputSection *isec : makeArrayRef(unorderedSections).slice(0, insPt))
-    isd->sections.push_back(isec);
-  for (std::pair<InputSection *, int> p : orderedSections)
-    isd->sections.push_back(p.first);
+    sections.push_back(isec);
+  for (std::pair<int, size_t> p : orderedSections)
+    sections.push_back(isd->sections[p.second]);
   for (InputSection *isec : makeArrayRef(unorderedSections).slice(insPt))
-    isd->sections.push_back(isec);
+    sections.push_back(isec);
+  isd->sections = std::move(sections);
 }
 
 static void sortSection(OutputSection *sec,
@@ -1363,11 +1524,38 @@ static void sortSection(OutputSection *sec,
   }
 
   // Sort input sections by priority using the list provided
-  // by --symbol-ordering-file.
+  // by --symbol-ordering-file or --data-ordering-file.
   if (!order.empty())
     for (BaseCommand *b : sec->sectionCommands)
       if (auto *isd = dyn_cast<InputSectionDescription>(b))
-        sortISDBySectionOrder(isd, order);
+        sortISDBySectionOrder(isd, order, sec->flags & SHF_EXECINSTR);
+}
+
+// For -z hugepage-hot-text, moves hot code to the start of .text, between
+// two empty sections aligned to a huge page. Hot code is .text.hot.* and the
+// sections ordered by the call graph profile.
+template <class ELFT>
+void Writer<ELFT>::placeHotText(
+    OutputSection *sec, const DenseMap<const InputSectionBase *, int> &order) {
+  auto isHot = [&](const InputSection *isec) {
+    return isSectionPrefix(".text.hot.", isec->name) ||
+           (!config->callGraphProfile.empty() && order.count(isec));
+  };
+
+  // Without a SECTIONS command, an output section has one
+  // InputSectionDescription.
+  for (BaseCommand *base : sec->sectionCommands) {
+    auto *isd = dyn_cast<InputSectionDescription>(base);
+    if (!isd)
+      continue;
+    std::vector<InputSection *> &v = isd->sections;
+    size_t numHot =
+        std::stable_partition(v.begin(), v.end(), isHot) - v.begin();
+    v.insert(v.begin() + numHot, hotTextEnd);
+    v.insert(v.begin(), hotTextStart);
+    sec->alignment = std::max(sec->alignment, hotTextStart->alignment);
+    return;
+  }
 }
 
 // If no layout was provided by linker script, we want to apply default
@@ -1375,9 +1563,14 @@ static void sortSection(OutputSection *sec,
 template <class ELFT> void Writer<ELFT>::sortInputSections() {
   // Build the order once since it is expensive.
   DenseMap<const InputSectionBase *, int> order = buildSectionOrder();
+  if (!config->dataOrderingFile.empty())
+    addDataSectionOrder(order);
   for (BaseCommand *base : script->sectionCommands)
     if (auto *sec = dyn_cast<OutputSection>(base))
       sortSection(sec, order);
+
+  if (hotTextStart)
+    placeHotText(hotTextStart->getParent(), order);
 }
 
 template <class ELFT> void Writer<ELFT>::sortSections() {
@@ -1542,6 +1735,62 @@ template <class ELFT> void Writer<ELFT>::resolveShfLinkOrder() {
   }
 }
 
+// The following two functions implement --optimize-bb-jumps. This one calls
+// fn in parallel for each regular section of each executable output section
+// with the section that follows it, and returns true if fn returned true for
+// any of them.
+static bool
+forEachBBSection(function_ref<bool(InputSection &, InputSection *)> fn) {
+  bool changed = false;
+  for (OutputSection *os : outputSections) {
+    if (!(os->flags & SHF_EXECINSTR))
+      continue;
+    std::vector<InputSection *> sections = getInputSections(os);
+    std::vector<uint8_t> result(sections.size());
+    parallelForEachN(0, sections.size(), [&](size_t i) {
+      if (sections[i]->kind() != SectionBase::Regular)
+        return;
+      InputSection *next = i + 1 == sections.size() ? nullptr : sections[i + 1];
+      result[i] = fn(*sections[i], next);
+    });
+    changed |= llvm::is_contained(result, 1);
+  }
+  return changed;
+}
+
+// Once the layout is final, moves the symbols in the deleted ends of sections
+// to the new ends, shrinks the symbols that cover them, and then deletes the
+// ends for good.
+template <class ELFT> static void finalizeBBSections() {
+  auto fix = [](Symbol *sym) {
+    auto *d = dyn_cast<Defined>(sym);
+    if (!d || !d->section)
+      return;
+    auto *isec = dyn_cast<InputSectionBase>(d->section->repl);
+    if (!isec || !isec->bytesDropped)
+      return;
+    uint64_t newSize = isec->getSize();
+    uint64_t oldSize = newSize + isec->bytesDropped;
+    if (d->value > newSize) {
+      if (d->value <= oldSize)
+        d->value = newSize;
+    } else if (d->value + d->size > newSize && d->value + d->size <= oldSize) {
+      d->size = newSize - d->value;
+    }
+  };
+
+  parallelForEach(objectFiles, [&](InputFile *file) {
+    for (Symbol *sym : cast<ObjFile<ELFT>>(file)->getLocalSymbols())
+      fix(sym);
+  });
+  symtab->forEachSymbol(fix);
+
+  for (OutputSection *os : outputSections)
+    if (os->flags & SHF_EXECINSTR)
+      for (InputSection *isec : getInputSections(os))
+        isec->trim();
+}
+
 // We need to generate and finalize the content that depends on the address of
 // InputSections. As the generation of the content may also alter InputSection
 // addresses we must converge to a fixed point. We do that here. See the comment
@@ -1552,6 +1801,15 @@ template <class ELFT> void Writer<ELFT>::finalizeAddressDependentContent() {
   ARMErr657417Patcher a32p;
   script->assignAddresses();
 
+  // Jumps to the next section only depend on the order of sections, so they
+  // are deleted once. Shrinking jumps depends on addresses, so it is done in
+  // the loop below until the layout converges.
+  if (config->optimizeBBJumps &&
+      forEachBBSection([](InputSection &isec, InputSection *next) {
+        return target->deleteFallThruJmpInsn(isec, next);
+      }))
+    script->assignAddresses();
+
   int assignPasses = 0;
   for (;;) {
     bool changed = target->needsThunks && tc.createThunks(outputSections);
@@ -1573,6 +1831,13 @@ template <class ELFT> void Writer<ELFT>::finalizeAddressDependentContent() {
         script->assignAddresses();
       changed |= a32p.createFixes();
     }
+    if (config->optimizeBBJumps) {
+      if (changed)
+        script->assignAddresses();
+      changed |= forEachBBSection([](InputSection &isec, InputSection *) {
+        return target->relaxJmpInsn(isec);
+      });
+    }
 
     if (in.mipsGot)
       in.mipsGot->updateAllocSize();
@@ -1597,6 +1862,23 @@ template <class ELFT> void Writer<ELFT>::finalizeAddressDependentContent() {
       }
     }
   }
+
+  if (config->optimizeBBJumps)
+    finalizeBBSections<ELFT>();
+}
+
+// Calls fn for the main partition and then for the other partitions. If
+// there are several of those, they are processed in parallel. Nested
+// parallel loops run serially, so a single other partition is processed
+// on its own to keep the parallelism within it.
+static void forEachLoadablePartition(llvm::function_ref<void(Partition &)> fn) {
+  fn(*mainPart);
+  MutableArrayRef<Partition> rest = makeMutableArrayRef(partitions).slice(1);
+  if (rest.size() > 1)
+    parallelForEach(rest, fn);
+  else
+    for (Partition &part : rest)
+      fn(part);
 }
 
 static void finalizeSynthetic(SyntheticSection *sec) {
@@ -1682,6 +1964,8 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
     for (BaseCommand *base : script->sectionCommands)
       if (auto *sec = dyn_cast<OutputSection>(base))
         addStartStopSymbols(sec);
+    if (config->zHugepageHotText)
+      addHotTextSymbols();
   }
 
   // Add _DYNAMIC symbol. Unlike GNU gold, our _DYNAMIC symbol has no type.
@@ -1745,11 +2029,49 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
   // we can correctly decide if a dynamic relocation is needed. This is called
   // after processSymbolAssignments() because it needs to know whether a
   // linker-script-defined symbol is absolute.
+  //
+  // Most relocations are resolved at link time and don't need any GOT, PLT or
+  // dynamic relocation other than a relative one, so each section is first
+  // scanned in parallel up to its first relocation that may need one.
+  // The relative relocations found that way are added to per-section shards
+  // of the dynamic relocation sections.  Then, for each section in the usual
+  // order, its shard is merged and the rest of it is scanned serially, so
+  // that GOT and PLT entries, dynamic relocations and diagnostics come out in
+  // the same order as before.
   if (!config->relocatable) {
-    forEachRelSec(scanRelocations<ELFT>);
+    ScopedTimer t(scanRelocationsTimer);
+    std::vector<InputSectionBase *> relSecs;
+    forEachRelSec([&](InputSectionBase &sec) { relSecs.push_back(&sec); });
+    for (Partition &part : partitions) {
+      part.relaDyn->initShards(relSecs.size());
+      if (part.relrDyn)
+        part.relrDyn->initShards(relSecs.size());
+    }
+
+    std::vector<size_t> scanned(relSecs.size());
+    parallelForEachN(0, relSecs.size(), [&](size_t i) {
+      scanned[i] = scanLinkTimeRelocations<ELFT>(*relSecs[i], i);
+    });
+    for (size_t i = 0, e = relSecs.size(); i != e; ++i) {
+      for (Partition &part : partitions) {
+        part.relaDyn->mergeShard(i);
+        if (part.relrDyn)
+          part.relrDyn->mergeShard(i);
+      }
+      if (scanned[i] != relSecs[i]->numRelocations)
+        scanRelocations<ELFT>(*relSecs[i], scanned[i]);
+    }
+
+    for (Partition &part : partitions) {
+      part.relaDyn->shards.clear();
+      if (part.relrDyn)
+        part.relrDyn->shards.clear();
+    }
     reportUndefinedSymbols<ELFT>();
   }
 
+  if (config->sortPltEntries && in.plt && in.plt->isNeeded())
+    in.plt->sortEntries();
   if (in.plt && in.plt->isNeeded())
     in.plt->addSymbols();
   if (in.iplt && in.iplt->isNeeded())
@@ -1890,7 +2212,7 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
 
   // Dynamic section must be the last one in this list and dynamic
   // symbol table section (dynSymTab) must be the first one.
-  for (Partition &part : partitions) {
+  auto finalizePartition = [](Partition &part) {
     finalizeSynthetic(part.armExidx);
     finalizeSynthetic(part.dynSymTab);
     finalizeSynthetic(part.gnuHashTab);
@@ -1902,7 +2224,12 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
     finalizeSynthetic(part.verSym);
     finalizeSynthetic(part.verNeed);
     finalizeSynthetic(part.dynamic);
-  }
+  };
+
+  // The main partition stores dynamic symbol indices in the symbols, and the
+  // other partitions only use their own sections, so they are finalized in
+  // parallel after the main one.
+  forEachLoadablePartition(finalizePartition);
 
   if (!script->hasSectionsCommand && !config->relocatable)
     fixSectionAlignments();
@@ -1934,7 +2261,10 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
   // 3) Assign the final values for the linker script symbols. Linker scripts
   //    sometimes using forward symbol declarations. We want to set the correct
   //    values. They also might change after adding the thunks.
-  finalizeAddressDependentContent();
+  {
+    ScopedTimer t(thunksTimer);
+    finalizeAddressDependentContent();
+  }
 
   // finalizeAddressDependentContent may have added local symbols to the static symbol table.
   finalizeSynthetic(in.symTab);
@@ -2017,6 +2347,29 @@ void Writer<ELFT>::addStartStopSymbols(OutputSection *sec) {
   addOptionalRegular(saver.save("__stop_" + s), sec, -1, STV_PROTECTED);
 }
 
+// For -z hugepage-hot-text, creates the empty sections that delimit the hot
+// text region, and defines __hot_text_start and __hot_text_end relative to
+// them. The sections are aligned to 2 MiB, the size of a huge page on x86-64
+// and on AArch64 with 4 KiB pages, so the region is padded to whole huge pages.
+template <class ELFT> void Writer<ELFT>::addHotTextSymbols() {
+  OutputSection *text = findSection(".text");
+  if (!text || script->hasSectionsCommand)
+    return;
+
+  auto create = [&] {
+    auto *isec = make<AlignmentSection>(SHF_ALLOC | SHF_EXECINSTR,
+                                        /*alignment=*/2 * 1024 * 1024,
+                                        ".text.hot");
+    isec->partition = text->partition;
+    isec->parent = text;
+    return isec;
+  };
+  hotTextStart = create();
+  hotTextEnd = create();
+  addOptionalRegular("__hot_text_start", hotTextStart, 0);
+  addOptionalRegular("__hot_text_end", hotTextEnd, 0);
+}
+
 static bool needsPtLoad(OutputSection *sec) {
   if (!(sec->flags & SHF_ALLOC) || sec->noload)
     return false;
@@ -2595,7 +2948,10 @@ template <class ELFT> void Writer<ELFT>::openFile() {
   if (!config->relocatable)
     flags = FileOutputBuffer::F_executable;
   Expected<std::unique_ptr<FileOutputBuffer>> bufferOrErr =
-      FileOutputBuffer::create(config->outputFile, fileSize, flags);
+      config->stageOutput
+          ? createStagedOutputBuffer(config->outputFile, fileSize, flags,
+                                     config->stageOutputDir)
+          : FileOutputBuffer::create(config->outputFile, fileSize, flags);
 
   if (!bufferOrErr) {
     error("failed to open " + config->outputFile + ": " +
@@ -2652,46 +3008,164 @@ template <class ELFT> void Writer<ELFT>::writeSections() {
   // In -r or -emit-relocs mode, write the relocation sections first as in
   // ELf_Rel targets we might find out that we need to modify the relocated
   // section while doing it.
+  if (config->copyRelocs)
+    in.symTab->initFileSymbolIndices();
+  sortMappedInputs();
+
+  std::vector<OutputSection *> relSecs;
   for (OutputSection *sec : outputSections)
     if (sec->type == SHT_REL || sec->type == SHT_RELA)
-      sec->writeTo<ELFT>(Out::bufferStart + sec->offset);
+      relSecs.push_back(sec);
+
+  // Each relocation section modifies only the section it applies to. With
+  // -r, there are usually as many of them as there are input sections with
+  // relocations, so they are written in parallel. Otherwise, most
+  // relocations are in a few large sections whose contents are written in
+  // parallel by writeTo.
+  auto write = [](OutputSection *sec) {
+    sec->writeTo<ELFT>(Out::bufferStart + sec->offset);
+  };
+  if (config->relocatable)
+    parallelForEach(relSecs, write);
+  else
+    llvm::for_each(relSecs, write);
 
+  // The sections of a loadable partition other than the main one don't
+  // depend on other partitions, so partitions are written in parallel.
+  std::vector<std::vector<OutputSection *>> partSecs(partitions.size());
   for (OutputSection *sec : outputSections)
     if (sec->type != SHT_REL && sec->type != SHT_RELA)
-      sec->writeTo<ELFT>(Out::bufferStart + sec->offset);
+      partSecs[std::max<int>(sec->partition, 1) - 1].push_back(sec);
+
+  forEachLoadablePartition([&](Partition &part) {
+    std::vector<OutputSection *> &secs = partSecs[&part - &partitions[0]];
+    writeOutputSections<ELFT>(secs);
+    for (OutputSection *sec : secs)
+      releaseInputMemory(sec);
+  });
 }
 
-// Split one uint8 array into small pieces of uint8 arrays.
-static std::vector<ArrayRef<uint8_t>> split(ArrayRef<uint8_t> arr,
-                                            size_t chunkSize) {
-  std::vector<ArrayRef<uint8_t>> ret;
-  while (arr.size() > chunkSize) {
-    ret.push_back(arr.take_front(chunkSize));
-    arr = arr.drop_front(chunkSize);
+// Build IDs other than UUIDs and hex strings are computed as a tree of
+// hashes. In order to utilize multiple cores, we split the output into 1MB
+// chunks, compute a hash for each chunk, and then compute a hash value of
+// the hash values.
+static const size_t buildIdChunkSize = 1024 * 1024;
+
+using HashFn = std::function<void(uint8_t *dest, ArrayRef<uint8_t> arr)>;
+
+static HashFn getBuildIdHashFn(size_t hashSize) {
+  switch (config->buildId) {
+  case BuildIdKind::Fast:
+    return [](uint8_t *dest, ArrayRef<uint8_t> arr) {
+      write64le(dest, xxHash64(arr));
+    };
+  case BuildIdKind::Md5:
+    return [=](uint8_t *dest, ArrayRef<uint8_t> arr) {
+      memcpy(dest, MD5::hash(arr).data(), hashSize);
+    };
+  case BuildIdKind::Sha1:
+    return [=](uint8_t *dest, ArrayRef<uint8_t> arr) {
+      memcpy(dest, SHA1::hash(arr).data(), hashSize);
+    };
+  default:
+    return nullptr;
   }
-  if (!arr.empty())
-    ret.push_back(arr);
-  return ret;
 }
 
-// Computes a hash value of Data using a given hash function.
-// In order to utilize multiple cores, we first split data into 1MB
-// chunks, compute a hash for each chunk, and then compute a hash value
-// of the hash values.
-static void
-computeHash(llvm::MutableArrayRef<uint8_t> hashBuf,
-            llvm::ArrayRef<uint8_t> data,
-            std::function<void(uint8_t *dest, ArrayRef<uint8_t> arr)> hashFn) {
-  std::vector<ArrayRef<uint8_t>> chunks = split(data, 1024 * 1024);
-  std::vector<uint8_t> hashes(chunks.size() * hashBuf.size());
-
-  // Compute hash values.
-  parallelForEachN(0, chunks.size(), [&](size_t i) {
-    hashFn(hashes.data() + i * hashBuf.size(), chunks[i]);
+// Hashes the I-th chunk of an output buffer. Sections that are not in the
+// output buffer yet because of --copy-file-range are hashed from their input
+// files.
+static void hashChunk(const HashFn &hashFn, uint8_t *dest,
+                      ArrayRef<uint8_t> buf, size_t i) {
+  std::vector<uint8_t> scratch;
+  ArrayRef<uint8_t> chunk = buf.slice(
+      i * buildIdChunkSize,
+      std::min(buildIdChunkSize, buf.size() - i * buildIdChunkSize));
+  hashFn(dest, getPassThroughContents(chunk, scratch));
+}
+
+// The hashes of the chunks of the output buffer that are computed while it
+// is being written. A chunk that lies within a single input section is
+// hashed right after the section is written, when its contents are likely
+// to be still in the CPU cache. This saves most of the second pass over the
+// output that would otherwise be needed for a large file.
+namespace {
+struct StreamingBuildId {
+  HashFn hashFn;
+  size_t hashSize;
+  ArrayRef<uint8_t> buf;
+  std::vector<uint8_t> hashes;
+  // Each element is written by at most one thread.
+  std::vector<uint8_t> done;
+};
+} // namespace
+
+static std::unique_ptr<StreamingBuildId> streamingBuildId;
+
+void hashWrittenSection(const uint8_t *loc, uint64_t size) {
+  StreamingBuildId *s = streamingBuildId.get();
+  if (!s || loc < s->buf.data() || loc + size > s->buf.end())
+    return;
+  uint64_t off = loc - s->buf.data();
+  size_t begin = (off + buildIdChunkSize - 1) / buildIdChunkSize;
+  size_t end = (off + size) / buildIdChunkSize;
+  // The last chunk of the file may be shorter.
+  if (off + size == s->buf.size())
+    end = (off + size + buildIdChunkSize - 1) / buildIdChunkSize;
+  for (size_t i = begin; i < end; ++i) {
+    hashChunk(s->hashFn, s->hashes.data() + i * s->hashSize, s->buf, i);
+    s->done[i] = true;
+  }
+}
+
+void computeBuildId(MutableArrayRef<uint8_t> buildId, ArrayRef<uint8_t> buf) {
+  size_t hashSize = buildId.size();
+  if (config->buildId == BuildIdKind::Uuid) {
+    if (auto ec = llvm::getRandomBytes(buildId.data(), hashSize))
+      error("entropy source failure: " + ec.message());
+    return;
+  }
+
+  HashFn hashFn = getBuildIdHashFn(hashSize);
+  if (!hashFn)
+    llvm_unreachable("unknown BuildIdKind");
+
+  size_t numChunks = (buf.size() + buildIdChunkSize - 1) / buildIdChunkSize;
+  std::vector<uint8_t> hashes(numChunks * hashSize);
+  StreamingBuildId *s = streamingBuildId.get();
+  bool streamed = s && s->buf.data() == buf.data() &&
+                  s->buf.size() == buf.size() && s->hashSize == hashSize;
+  if (streamed)
+    hashes = std::move(s->hashes);
+
+  // Compute the hash values that have not been computed yet.
+  parallelForEachN(0, numChunks, [&](size_t i) {
+    if (!streamed || !s->done[i])
+      hashChunk(hashFn, hashes.data() + i * hashSize, buf, i);
   });
 
   // Write to the final output buffer.
-  hashFn(hashBuf.data(), hashes);
+  hashFn(buildId.data(), hashes);
+}
+
+// Prepares to hash chunks of the output for --build-id as they are written.
+template <class ELFT> void Writer<ELFT>::startBuildId() {
+  streamingBuildId.reset();
+  if (!mainPart->buildId || !mainPart->buildId->getParent())
+    return;
+
+  size_t hashSize = mainPart->buildId->hashSize;
+  HashFn hashFn = getBuildIdHashFn(hashSize);
+  if (!hashFn)
+    return;
+
+  size_t numChunks = (fileSize + buildIdChunkSize - 1) / buildIdChunkSize;
+  streamingBuildId = std::make_unique<StreamingBuildId>();
+  streamingBuildId->hashFn = hashFn;
+  streamingBuildId->hashSize = hashSize;
+  streamingBuildId->buf = {Out::bufferStart, size_t(fileSize)};
+  streamingBuildId->hashes.resize(numChunks * hashSize);
+  streamingBuildId->done.resize(numChunks);
 }
 
 template <class ELFT> void Writer<ELFT>::writeBuildId() {
@@ -2705,33 +3179,9 @@ template <class ELFT> void Writer<ELFT>::writeBuildId() {
   }
 
   // Compute a hash of all sections of the output file.
-  size_t hashSize = mainPart->buildId->hashSize;
-  std::vector<uint8_t> buildId(hashSize);
-  llvm::ArrayRef<uint8_t> buf{Out::bufferStart, size_t(fileSize)};
-
-  switch (config->buildId) {
-  case BuildIdKind::Fast:
-    computeHash(buildId, buf, [](uint8_t *dest, ArrayRef<uint8_t> arr) {
-      write64le(dest, xxHash64(arr));
-    });
-    break;
-  case BuildIdKind::Md5:
-    computeHash(buildId, buf, [&](uint8_t *dest, ArrayRef<uint8_t> arr) {
-      memcpy(dest, MD5::hash(arr).data(), hashSize);
-    });
-    break;
-  case BuildIdKind::Sha1:
-    computeHash(buildId, buf, [&](uint8_t *dest, ArrayRef<uint8_t> arr) {
-      memcpy(dest, SHA1::hash(arr).data(), hashSize);
-    });
-    break;
-  case BuildIdKind::Uuid:
-    if (auto ec = llvm::getRandomBytes(buildId.data(), hashSize))
-      error("entropy source failure: " + ec.message());
-    break;
-  default:
-    llvm_unreachable("unknown BuildIdKind");
-  }
+  std::vector<uint8_t> buildId(mainPart->buildId->hashSize);
+  computeBuildId(buildId, {Out::bufferStart, size_t(fileSize)});
+  streamingBuildId.reset();
   for (Partition &part : partitions)
     part.buildId->writeBuildId(buildId);
 }
@@ -25,6 +25,16 @@ template <class ELFT> void createSyntheticSections();
 void combineEhSections();
 template <class ELFT> void writeResult();
 
+// Computes the value of --build-id, other than that of a hex string, for an
+// output file. The build ID itself must be zero in the buffer.
+void computeBuildId(llvm::MutableArrayRef<uint8_t> buildId,
+                    llvm::ArrayRef<uint8_t> buf);
+
+// Called when an input section has been written to the output buffer, so
+// that the parts of the build ID hash that only depend on it can be computed
+// while it is still in cache.
+void hashWrittenSection(const uint8_t *loc, uint64_t size);
+
 // This describes a program header entry.
 // Each contains type, access flags and range of output sections that will be
 // placed in it.
@@ -0,0 +1,52 @@
+//===- COFFBenchmarks.cpp -------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "Inputs.h"
+#include "COFF/Config.h"
+#include "COFF/SymbolTable.h"
+#include "lld/Common/Memory.h"
+#include "benchmark/benchmark.h"
+
+using namespace llvm;
+using namespace lld;
+using namespace lld::coff;
+
+static void setUp() {
+  freeArena();
+  config = make<Configuration>();
+  symtab = make<SymbolTable>();
+}
+
+static void BM_COFFSymbolTableInsert(benchmark::State &state) {
+  std::vector<std::string> names = bench::getSymbolNames(state.range(0));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    setUp();
+    state.ResumeTiming();
+
+    for (const std::string &name : names)
+      benchmark::DoNotOptimize(symtab->addUndefined(name));
+  }
+  state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_COFFSymbolTableInsert)->Arg(1 << 17);
+
+// Half of the names are in the symbol table.
+static void BM_COFFSymbolTableFind(benchmark::State &state) {
+  std::vector<std::string> names = bench::getSymbolNames(state.range(0));
+  setUp();
+  for (size_t i = 0; i < names.size(); i += 2)
+    symtab->addUndefined(names[i]);
+
+  for (auto _ : state)
+    for (const std::string &name : names)
+      benchmark::DoNotOptimize(symtab->find(name));
+  state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_COFFSymbolTableFind)->Arg(1 << 17);
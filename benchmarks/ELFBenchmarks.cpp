@@ -0,0 +1,235 @@
+//===- ELFBenchmarks.cpp --------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "Inputs.h"
+#include "ELF/Config.h"
+#include "ELF/ICF.h"
+#include "ELF/InputFiles.h"
+#include "ELF/InputSection.h"
+#include "ELF/LinkerScript.h"
+#include "ELF/OutputSections.h"
+#include "ELF/SymbolTable.h"
+#include "ELF/SyntheticSections.h"
+#include "ELF/Target.h"
+#include "lld/Common/Memory.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "benchmark/benchmark.h"
+
+using namespace llvm;
+using namespace llvm::ELF;
+using namespace llvm::object;
+using namespace lld;
+using namespace lld::elf;
+
+// Resets the global state of the linker to what the driver sets up before
+// reading the inputs.
+static void setUp(ELFKind ekind, uint16_t emachine) {
+  inputSections.clear();
+  objectFiles.clear();
+  freeArena();
+
+  config = make<Configuration>();
+  config->ekind = ekind;
+  config->emachine = emachine;
+  config->is64 = ekind == ELF64LEKind || ekind == ELF64BEKind;
+  config->isLE = ekind == ELF32LEKind || ekind == ELF64LEKind;
+  config->wordsize = config->is64 ? 8 : 4;
+  script = make<LinkerScript>();
+  symtab = make<SymbolTable>();
+  partitions = {Partition()};
+  target = getTarget();
+}
+
+// Applies relocations of the given types in a round-robin fashion. The
+// values are small and aligned, so that no relocation overflows.
+static void BM_RelocateOne(benchmark::State &state, ELFKind ekind,
+                           uint16_t emachine, ArrayRef<RelType> types) {
+  setUp(ekind, emachine);
+
+  const size_t n = 4096;
+  std::vector<uint8_t> buf(n * 8);
+  std::vector<uint64_t> vals(n);
+  for (size_t i = 0; i < n; ++i)
+    vals[i] = (i * 0x9e3779b1) & 0xfffff8;
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < n; ++i)
+      target->relocateOne(buf.data() + i * 8, types[i % types.size()],
+                          vals[i]);
+    benchmark::DoNotOptimize(buf.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+static const RelType x86Relocs[] = {R_386_PC32, R_386_PLT32, R_386_32};
+static const RelType x86_64Relocs[] = {R_X86_64_PC32, R_X86_64_PLT32,
+                                       R_X86_64_64};
+static const RelType aarch64Relocs[] = {
+    R_AARCH64_CALL26, R_AARCH64_ADR_PREL_PG_HI21, R_AARCH64_ADD_ABS_LO12_NC,
+    R_AARCH64_LDST64_ABS_LO12_NC, R_AARCH64_ABS64};
+static const RelType armRelocs[] = {R_ARM_CALL, R_ARM_ABS32, R_ARM_MOVW_ABS_NC,
+                                    R_ARM_MOVT_ABS};
+static const RelType mipsRelocs[] = {R_MIPS_32, R_MIPS_26, R_MIPS_HI16,
+                                     R_MIPS_LO16};
+static const RelType ppc64Relocs[] = {R_PPC64_REL24, R_PPC64_ADDR64,
+                                      R_PPC64_ADDR16_HA, R_PPC64_ADDR16_LO};
+static const RelType riscvRelocs[] = {R_RISCV_CALL, R_RISCV_HI20,
+                                      R_RISCV_LO12_I, R_RISCV_64};
+
+BENCHMARK_CAPTURE(BM_RelocateOne, x86, ELF32LEKind, EM_386, x86Relocs);
+BENCHMARK_CAPTURE(BM_RelocateOne, x86_64, ELF64LEKind, EM_X86_64,
+                  x86_64Relocs);
+BENCHMARK_CAPTURE(BM_RelocateOne, aarch64, ELF64LEKind, EM_AARCH64,
+                  aarch64Relocs);
+BENCHMARK_CAPTURE(BM_RelocateOne, arm, ELF32LEKind, EM_ARM, armRelocs);
+BENCHMARK_CAPTURE(BM_RelocateOne, mipsel, ELF32LEKind, EM_MIPS, mipsRelocs);
+BENCHMARK_CAPTURE(BM_RelocateOne, ppc64le, ELF64LEKind, EM_PPC64,
+                  ppc64Relocs);
+BENCHMARK_CAPTURE(BM_RelocateOne, riscv64, ELF64LEKind, EM_RISCV,
+                  riscvRelocs);
+
+static void BM_SplitStrings(benchmark::State &state) {
+  setUp(ELF64LEKind, EM_X86_64);
+  std::string data = bench::getStringLiterals(state.range(0));
+  ArrayRef<uint8_t> a(reinterpret_cast<const uint8_t *>(data.data()),
+                      data.size());
+
+  for (auto _ : state) {
+    MergeInputSection sec(SHF_ALLOC | SHF_MERGE | SHF_STRINGS, SHT_PROGBITS,
+                          1, a, ".rodata.str1.1");
+    sec.splitIntoPieces();
+    benchmark::DoNotOptimize(sec.pieces.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_SplitStrings)->Arg(1 << 16)->Arg(1 << 22);
+
+// Returns an object file with a section per function, as with
+// -ffunction-sections. The contents of a function depend on its number
+// modulo 64, and each function calls another one, so ICF has to compare
+// both the contents and the relocations to find the identical functions.
+static std::string getICFInput(size_t n) {
+  std::string yaml;
+  raw_string_ostream os(yaml);
+  os << "--- !ELF\n"
+        "FileHeader:\n"
+        "  Class:   ELFCLASS64\n"
+        "  Data:    ELFDATA2LSB\n"
+        "  Type:    ET_REL\n"
+        "  Machine: EM_X86_64\n"
+        "Sections:\n";
+  for (size_t i = 0; i < n; ++i) {
+    os << "  - Name:    .text.f" << i << "\n"
+       << "    Type:    SHT_PROGBITS\n"
+       << "    Flags:   [ SHF_ALLOC, SHF_EXECINSTR ]\n"
+       << "    Content: E800000000B8" << format("%02X", (unsigned)(i % 64))
+       << "000000C3\n"
+       << "  - Name:    .rela.text.f" << i << "\n"
+       << "    Type:    SHT_RELA\n"
+       << "    Info:    .text.f" << i << "\n"
+       << "    Relocations:\n"
+       << "      - Offset: 1\n"
+       << "        Symbol: f" << (i * 61 + 7) % n << "\n"
+       << "        Type:   R_X86_64_PLT32\n"
+       << "        Addend: -4\n";
+  }
+  os << "Symbols:\n";
+  for (size_t i = 0; i < n; ++i)
+    os << "  - Name:    f" << i << "\n"
+       << "    Type:    STT_FUNC\n"
+       << "    Section: .text.f" << i << "\n";
+  return bench::yamlToObject(os.str());
+}
+
+static void BM_ICF(benchmark::State &state) {
+  std::string obj = getICFInput(state.range(0));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    setUp(ELF64LEKind, EM_X86_64);
+    config->icf = ICFLevel::All;
+
+    InputFile *file = createObjectFile(MemoryBufferRef(obj, "icf.o"));
+    parseFile(file);
+    auto *osec =
+        make<OutputSection>(".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR);
+    for (InputSectionBase *s : file->getSections()) {
+      if (!s || s == &InputSection::discarded)
+        continue;
+      s->markLive();
+      s->parent = osec;
+      inputSections.push_back(s);
+    }
+    state.ResumeTiming();
+
+    doIcf<ELF64LE>();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ICF)->Arg(1 << 14)->Unit(benchmark::kMillisecond);
+
+static void BM_ELFSymbolTableInsert(benchmark::State &state) {
+  std::vector<std::string> names = bench::getSymbolNames(state.range(0));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    setUp(ELF64LEKind, EM_X86_64);
+    state.ResumeTiming();
+
+    for (const std::string &name : names)
+      benchmark::DoNotOptimize(symtab->insert(name));
+  }
+  state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_ELFSymbolTableInsert)->Arg(1 << 17);
+
+// Half of the names are in the symbol table, as when the undefined symbols
+// of a file are looked up in the definitions of the others.
+static void BM_ELFSymbolTableFind(benchmark::State &state) {
+  std::vector<std::string> names = bench::getSymbolNames(state.range(0));
+  setUp(ELF64LEKind, EM_X86_64);
+  for (size_t i = 0; i < names.size(); i += 2)
+    symtab->insert(names[i]);
+
+  for (auto _ : state)
+    for (const std::string &name : names)
+      benchmark::DoNotOptimize(symtab->find(name));
+  state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_ELFSymbolTableFind)->Arg(1 << 17);
+
+// Every string is added twice, so half of the lookups find a duplicate.
+static void BM_StringTableAddString(benchmark::State &state) {
+  setUp(ELF64LEKind, EM_X86_64);
+  std::vector<std::string> names = bench::getSymbolNames(state.range(0));
+
+  for (auto _ : state) {
+    StringTableSection strTab(".strtab", false);
+    for (size_t i = 0, e = names.size() * 2; i != e; ++i)
+      strTab.addString(names[(i * 7) % names.size()]);
+    benchmark::DoNotOptimize(strTab.getSize());
+  }
+  state.SetItemsProcessed(state.iterations() * names.size() * 2);
+}
+BENCHMARK(BM_StringTableAddString)->Arg(1 << 17);
+
+static void BM_StringTableAddStrings(benchmark::State &state) {
+  setUp(ELF64LEKind, EM_X86_64);
+  std::vector<std::string> names = bench::getSymbolNames(state.range(0));
+  std::vector<StringRef> strs;
+  for (size_t i = 0, e = names.size() * 2; i != e; ++i)
+    strs.push_back(names[(i * 7) % names.size()]);
+
+  for (auto _ : state) {
+    StringTableSection strTab(".strtab", false);
+    benchmark::DoNotOptimize(strTab.addStrings(strs));
+  }
+  state.SetItemsProcessed(state.iterations() * strs.size());
+}
+BENCHMARK(BM_StringTableAddStrings)->Arg(1 << 17);
@@ -0,0 +1,88 @@
+//===- Inputs.cpp ---------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "Inputs.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ObjectYAML/yaml2obj.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdlib>
+
+using namespace llvm;
+using namespace lld;
+
+namespace {
+// A small linear congruential generator. std::minstd_rand would do as well,
+// but the distributions of <random> are not the same on every platform.
+class Random {
+public:
+  uint32_t next() {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return state >> 33;
+  }
+
+private:
+  uint64_t state = 1;
+};
+} // namespace
+
+static const char *const words[] = {
+    "llvm",    "lld",   "elf",    "object", "detail", "std",
+    "Symbol",  "Chunk", "Writer", "Reader", "Table",  "Section",
+    "getName", "write", "Vector", "Map",    "parse",  "Iterator"};
+
+std::vector<std::string> bench::getSymbolNames(size_t n) {
+  Random r;
+  std::vector<std::string> ret;
+  ret.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    std::string s = "_ZN";
+    for (size_t j = 0, e = 2 + r.next() % 4; j != e; ++j) {
+      StringRef w = words[r.next() % array_lengthof(words)];
+      s += std::to_string(w.size()) + w.str();
+    }
+    // The last component makes the name unique.
+    std::string id = "f" + std::to_string(i);
+    s += std::to_string(id.size()) + id + "E";
+    s += (r.next() % 2) ? "v" : "RKS0_";
+    ret.push_back(std::move(s));
+  }
+  return ret;
+}
+
+std::string bench::getStringLiterals(size_t size) {
+  static const char *const formats[] = {
+      "%s: %s", "error: cannot open ", "\n>>> defined at ", "", ".text",
+      "unknown relocation type: %d in %s at offset 0x%llx"};
+
+  Random r;
+  std::vector<std::string> names = getSymbolNames(1024);
+  std::string ret;
+  ret.reserve(size + 256);
+  while (ret.size() < size) {
+    if (r.next() % 4)
+      ret += formats[r.next() % array_lengthof(formats)];
+    else
+      ret += names[r.next() % names.size()];
+    ret += '\0';
+  }
+  return ret;
+}
+
+std::string bench::yamlToObject(StringRef yaml) {
+  std::string ret;
+  raw_string_ostream os(ret);
+  yaml::Input yin(yaml);
+  if (!yaml::convertYAML(yin, os, [](const Twine &msg) {
+        errs() << "yaml2obj: " << msg << "\n";
+      })) {
+    errs() << "cannot generate the input of a benchmark\n";
+    exit(1);
+  }
+  return os.str();
+}
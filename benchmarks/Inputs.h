@@ -0,0 +1,39 @@
+//===- Inputs.h -------------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Generators for the inputs of the benchmarks. The inputs are generated with
+// a fixed seed, so that every run measures the same work.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_BENCHMARKS_INPUTS_H
+#define LLD_BENCHMARKS_INPUTS_H
+
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <vector>
+
+namespace lld {
+namespace bench {
+
+// Returns `n` distinct names that look like the mangled names of a large C++
+// program: nested names of a few common words, with long shared prefixes.
+std::vector<std::string> getSymbolNames(size_t n);
+
+// Returns about `size` bytes of NUL-terminated strings, as in a
+// .rodata.str1.1 section, with a mix of short and long strings.
+std::string getStringLiterals(size_t size);
+
+// Converts a description in the format of yaml2obj to an object file.
+// Exits if the description is invalid.
+std::string yamlToObject(llvm::StringRef yaml);
+
+} // namespace bench
+} // namespace lld
+
+#endif
@@ -0,0 +1,25 @@
+//===- Main.cpp -----------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// lld-kernels measures the loops that dominate the profiles of large links,
+// each on its own with a representative input, so that a change to one of
+// them can be evaluated without the noise of a full link. Full links are
+// measured with utils/benchmark.py and utils/compare-links.py instead.
+//
+// The benchmarks set up the global state of the linker that the kernels use
+// themselves, and free the arena between runs. They must not be run in
+// parallel with each other.
+//
+// Example:
+//   lld-kernels --benchmark_filter=ICF --benchmark_repetitions=10
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+
+BENCHMARK_MAIN();
@@ -0,0 +1,161 @@
+//===- WasmBenchmarks.cpp -------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "Inputs.h"
+#include "wasm/Config.h"
+#include "wasm/InputChunks.h"
+#include "wasm/InputFiles.h"
+#include "wasm/SymbolTable.h"
+#include "lld/Common/Memory.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/raw_ostream.h"
+#include "benchmark/benchmark.h"
+
+using namespace llvm;
+using namespace llvm::wasm;
+using namespace lld;
+using namespace lld::wasm;
+
+static void setUp() {
+  freeArena();
+  config = make<Configuration>();
+  symtab = make<SymbolTable>();
+}
+
+static void BM_WasmSymbolTableInsert(benchmark::State &state) {
+  std::vector<std::string> names = bench::getSymbolNames(state.range(0));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    setUp();
+    state.ResumeTiming();
+
+    for (const std::string &name : names)
+      benchmark::DoNotOptimize(
+          symtab->addUndefinedData(name, WASM_SYMBOL_UNDEFINED, nullptr));
+  }
+  state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_WasmSymbolTableInsert)->Arg(1 << 17);
+
+// Half of the names are in the symbol table.
+static void BM_WasmSymbolTableFind(benchmark::State &state) {
+  std::vector<std::string> names = bench::getSymbolNames(state.range(0));
+  setUp();
+  for (size_t i = 0; i < names.size(); i += 2)
+    symtab->addUndefinedData(names[i], WASM_SYMBOL_UNDEFINED, nullptr);
+
+  for (auto _ : state)
+    for (const std::string &name : names)
+      benchmark::DoNotOptimize(symtab->find(name));
+  state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_WasmSymbolTableFind)->Arg(1 << 17);
+
+// Returns an object file of `n` functions that each make `calls` calls to
+// other functions. The calls are relocated with R_WASM_FUNCTION_INDEX_LEB,
+// whose padded 5-byte immediates --compress-relocations shrinks.
+static std::string getCodeInput(size_t n, size_t calls) {
+  uint32_t bodySize = 1 + calls * 6 + 1;
+  uint32_t funcSize = getULEB128Size(bodySize) + bodySize;
+
+  std::string yaml;
+  raw_string_ostream os(yaml);
+  os << "--- !WASM\n"
+        "FileHeader:\n"
+        "  Version: 0x00000001\n"
+        "Sections:\n"
+        "  - Type: TYPE\n"
+        "    Signatures:\n"
+        "      - Index: 0\n"
+        "        ParamTypes:\n"
+        "        ReturnTypes:\n"
+        "  - Type: FUNCTION\n"
+        "    FunctionTypes: [ ";
+  for (size_t i = 0; i < n; ++i)
+    os << (i ? ", 0" : "0");
+  os << " ]\n"
+        "  - Type: CODE\n"
+        "    Relocations:\n";
+
+  auto getTarget = [&](size_t i, size_t j) { return (i * 31 + j * 17) % n; };
+  uint64_t offset = getULEB128Size(n);
+  for (size_t i = 0; i < n; ++i) {
+    // Skip the size of the function, the locals and the call opcode.
+    uint64_t callOffset = offset + getULEB128Size(bodySize) + 2;
+    for (size_t j = 0; j < calls; ++j)
+      os << "      - Type: R_WASM_FUNCTION_INDEX_LEB\n"
+         << "        Index: " << getTarget(i, j) << "\n"
+         << "        Offset: " << (callOffset + j * 6) << "\n";
+    offset += funcSize;
+  }
+
+  os << "    Functions:\n";
+  for (size_t i = 0; i < n; ++i) {
+    os << "      - Index: " << i << "\n"
+       << "        Locals:\n"
+       << "        Body: ";
+    for (size_t j = 0; j < calls; ++j) {
+      uint8_t buf[5];
+      encodeULEB128(getTarget(i, j), buf, 5);
+      os << "10";
+      for (uint8_t c : buf)
+        os << format("%02X", c);
+    }
+    os << "0B\n";
+  }
+
+  os << "  - Type: CUSTOM\n"
+        "    Name: linking\n"
+        "    Version: 2\n"
+        "    SymbolTable:\n";
+  for (size_t i = 0; i < n; ++i)
+    os << "      - Index: " << i << "\n"
+       << "        Kind: FUNCTION\n"
+       << "        Name: f" << i << "\n"
+       << "        Flags: [ VISIBILITY_HIDDEN ]\n"
+       << "        Function: " << i << "\n";
+  return bench::yamlToObject(os.str());
+}
+
+// Measures the size computation and the writing of the functions of an
+// object file with --compress-relocations, which decodes and re-encodes
+// every relocated immediate.
+static void BM_InputFunctionCompress(benchmark::State &state) {
+  std::string obj = getCodeInput(state.range(0), 16);
+  setUp();
+  config->compressRelocations = true;
+
+  auto *file = cast<ObjFile>(createObjectFile(MemoryBufferRef(obj, "code.o")));
+  symtab->addFile(file);
+  for (size_t i = 0, e = file->functions.size(); i != e; ++i)
+    file->functions[i]->setFunctionIndex(i);
+  file->computeRelocIndices();
+
+  ArrayRef<WasmFunction> funcs = file->getWasmObj()->functions();
+  std::vector<uint8_t> buf(file->codeSection->Content.size());
+
+  for (auto _ : state) {
+    // calculateSize() can only be called once per function, so the
+    // functions are created again on each iteration. This is cheap, as the
+    // constructor only copies a few pointers.
+    int32_t offset = 0;
+    for (size_t i = 0, e = funcs.size(); i != e; ++i) {
+      InputFunction fn(file->functions[i]->signature, &funcs[i], file);
+      fn.setRelocations(file->functions[i]->getRelocations());
+      fn.calculateSize();
+      fn.outputOffset = offset;
+      fn.writeTo(buf.data());
+      offset += fn.getSize();
+    }
+    benchmark::DoNotOptimize(buf.data());
+  }
+  state.SetItemsProcessed(state.iterations() * funcs.size());
+}
+BENCHMARK(BM_InputFunctionCompress)->Arg(1 << 14);
@@ -37,6 +37,12 @@ std::vector<StringRef> getLines(MemoryBufferRef mb);
 
 StringRef getFilenameWithoutExe(StringRef path);
 
+// Sets threadsEnabled and the thread count from the last of the options that
+// turn threads on or off or that give the thread count. An unset option ID
+// may be passed as 0.
+void setThreads(llvm::opt::InputArgList &args, unsigned threads,
+                unsigned noThreads, unsigned threadsEq);
+
 } // namespace args
 } // namespace lld
 
@@ -15,6 +15,7 @@
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
 #include "llvm/DebugInfo/DWARF/DWARFDebugLine.h"
 #include <memory>
+#include <mutex>
 #include <string>
 
 namespace llvm {
@@ -23,6 +24,10 @@ struct DILineInfo;
 
 namespace lld {
 
+// Looks up source locations in the debug info of an object file. The line
+// table of a compile unit is parsed when an address is looked up in it, and
+// the variables are collected when one is looked up for the first time. The
+// member functions may be called from multiple threads.
 class DWARFCache {
 public:
   DWARFCache(std::unique_ptr<llvm::DWARFContext> dwarf);
@@ -32,14 +37,29 @@ public:
   getVariableLoc(StringRef name);
 
 private:
+  struct Unit {
+    llvm::DWARFUnit *cu;
+    const llvm::DWARFDebugLine::LineTable *lt = nullptr;
+    bool parsed = false;
+    // The address ranges of the unit, empty if they are unknown.
+    llvm::DWARFAddressRangesVector ranges;
+    bool rangesParsed = false;
+  };
+
+  const llvm::DWARFDebugLine::LineTable *getLineTable(Unit &u);
+  bool mayContain(Unit &u, uint64_t offset, uint64_t sectionIndex);
+  void collectVariables();
+
+  std::mutex mu;
   std::unique_ptr<llvm::DWARFContext> dwarf;
-  std::vector<const llvm::DWARFDebugLine::LineTable *> lineTables;
+  std::vector<Unit> units;
   struct VarLoc {
     const llvm::DWARFDebugLine::LineTable *lt;
     unsigned file;
     unsigned line;
   };
   llvm::DenseMap<StringRef, VarLoc> variableLoc;
+  bool variablesCollected = false;
 };
 
 } // namespace lld
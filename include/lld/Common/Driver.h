@@ -10,7 +10,9 @@
 #define LLD_COMMON_DRIVER_H
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
+#include <vector>
 
 namespace lld {
 namespace coff {
@@ -34,8 +36,22 @@ bool link(llvm::ArrayRef<const char *> args, bool canExitEarly,
 }
 
 namespace wasm {
+// When canExitEarly is false, the input files and the objects decoded from
+// them are kept for the next call as long as they don't change on disk.
 bool link(llvm::ArrayRef<const char *> args, bool canExitEarly,
           llvm::raw_ostream &diag = llvm::errs());
+
+// Links the given buffers, as if their identifiers were appended to args, and
+// writes the output module to output instead of a file. Paths in args that
+// name one of the buffers also refer to it. The buffers are not copied; they
+// must stay alive until the call returns.
+bool link(llvm::ArrayRef<const char *> args,
+          llvm::ArrayRef<llvm::MemoryBufferRef> inputs,
+          std::vector<uint8_t> &output,
+          llvm::raw_ostream &diag = llvm::errs());
+
+// Releases the inputs kept by earlier calls to link.
+void clearInputCache();
 }
 }
 
@@ -61,7 +61,9 @@
 //
 // It is not recommended to use llvm::outs() or llvm::errs() directly in lld
 // because they are not thread-safe. The functions declared in this file are
-// thread-safe.
+// thread-safe. Diagnostics reported by the tasks of parallelForEach and
+// parallelForEachN are buffered and printed when the loop finishes, in the
+// order in which a serial loop would have printed them.
 //
 //===----------------------------------------------------------------------===//
 
@@ -73,6 +75,10 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileOutputBuffer.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
 
 namespace llvm {
 class DiagnosticInfo;
@@ -80,9 +86,35 @@ class DiagnosticInfo;
 
 namespace lld {
 
+// Holds the diagnostics reported on a thread while the buffer is installed
+// with setCurrent(), instead of printing them right away.
+class DiagnosticBuffer {
+public:
+  // Makes the diagnostics reported on this thread go to b, or be printed if b
+  // is null. Returns the previous buffer.
+  static DiagnosticBuffer *setCurrent(DiagnosticBuffer *b);
+  static DiagnosticBuffer *getCurrent();
+
+  // Moves the diagnostics of buffers, in order, to the current buffer of this
+  // thread, or prints them if there is none.
+  static void flush(llvm::MutableArrayRef<DiagnosticBuffer> buffers);
+
+private:
+  friend class ErrorHandler;
+
+  enum Kind { Log, Message, Warning, Error };
+
+  void add(Kind kind, std::string msg);
+
+  std::vector<std::pair<Kind, std::string>> diags;
+  // The number of errors, including those that were not kept because they
+  // would be past the error limit anyway.
+  uint64_t numErrors = 0;
+};
+
 class ErrorHandler {
 public:
-  uint64_t errorCount = 0;
+  std::atomic<uint64_t> errorCount{0};
   uint64_t errorLimit = 20;
   StringRef errorLimitExceededMsg = "too many errors emitted, stopping now";
   StringRef logName = "lld";
@@ -100,10 +132,16 @@ public:
 
   std::unique_ptr<llvm::FileOutputBuffer> outputBuffer;
 
+  // Set by each port to finish the files it is still writing, such as the
+  // --reproduce tar file. Called by exitLld().
+  std::function<void()> cleanupCallback;
+
 private:
+  friend class DiagnosticBuffer;
   using Colors = raw_ostream::Colors;
 
   std::string getLocation(const Twine &msg);
+  bool print(DiagnosticBuffer::Kind kind, const Twine &msg, uint64_t index);
 };
 
 /// Returns the default error handler.
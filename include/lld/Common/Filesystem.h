@@ -10,11 +10,42 @@
 #define LLD_FILESYSTEM_H
 
 #include "lld/Common/LLVM.h"
+#include <functional>
+#include <memory>
 #include <system_error>
 
+namespace llvm {
+class FileOutputBuffer;
+}
+
 namespace lld {
 void unlinkAsync(StringRef path);
 std::error_code tryCreateFile(StringRef path);
+
+// Creates an output buffer for path that is not backed by a file next to
+// path. The output is built in anonymous memory, or in a temporary file in
+// stagingDir if it is not empty, and commit() writes it to path with large
+// sequential writes and renames it into place. This is much faster than
+// FileOutputBuffer if path is on a network file system.
+llvm::Expected<std::unique_ptr<llvm::FileOutputBuffer>>
+createStagedOutputBuffer(StringRef path, size_t size, unsigned flags,
+                         StringRef stagingDir);
+
+// Commits buffer and then calls fn, if given. If the process is going to
+// exit right after the link, this is done on a background thread unless sync
+// is true. Failures are reported as msg followed by the reason.
+void commitOutput(std::unique_ptr<llvm::FileOutputBuffer> buffer,
+                  const Twine &msg, bool sync,
+                  std::function<void()> fn = nullptr);
+
+// Waits for the outputs that are being committed in the background.
+void waitForOutputs();
+
+// Runs fn, which the rest of the link must not depend on, on a background
+// thread if the process is going to exit after the link, and right away
+// otherwise. exitLld() waits for it to finish.
+void runInBackground(std::function<void()> fn);
+void waitForBackgroundTasks();
 } // namespace lld
 
 #endif
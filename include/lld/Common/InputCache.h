@@ -0,0 +1,42 @@
+//===- InputCache.h ---------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// A cache of the contents of input files that outlives a link. It is used by
+// the link server (see LinkServer.h) so that the system libraries, archives
+// and CRT objects that every link of a build reads stay in memory between
+// links.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_INPUT_CACHE_H
+#define LLD_INPUT_CACHE_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+
+namespace lld {
+// True if the drivers should read input files through readCachedInput.
+extern bool inputCacheEnabled;
+
+// Returns the contents of the file at path. The file is read from disk if it
+// is not in the cache or if its size or modification time changed since it
+// was cached. Files with identical contents share a buffer. The buffer stays
+// valid until the next call to trimInputCache.
+llvm::ErrorOr<MemoryBufferRef> readCachedInput(StringRef path);
+
+// Sets the number of bytes that trimInputCache keeps in the cache.
+void setInputCacheLimit(uint64_t bytes);
+
+// Evicts the least recently used files until the cache fits in its limit.
+// Must be called between links only.
+void trimInputCache();
+} // namespace lld
+
+#endif
@@ -0,0 +1,45 @@
+//===- InputLoader.h --------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Reads the input files named on the command line in the background, so
+// that the latency of opening and reading many small files on a cold cache
+// overlaps with parsing the files that have already arrived. The drivers
+// call startPreloadingInputs with the input paths before they walk the
+// command line, and readFile takes each file from the loader when it gets
+// to it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_INPUT_LOADER_H
+#define LLD_INPUT_LOADER_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lld {
+// Starts reading the files at `paths` on a pool of I/O threads, in the
+// given order. Does nothing if only one thread may be used.
+void startPreloadingInputs(std::vector<std::string> paths,
+                           bool requiresNullTerminator);
+
+// If `path` was passed to startPreloadingInputs and has not been taken yet,
+// waits until it has been read and returns the result. Otherwise returns
+// None, and the caller reads the file itself.
+llvm::Optional<llvm::ErrorOr<std::unique_ptr<MemoryBuffer>>>
+takePreloadedInput(StringRef path);
+
+// Waits for the I/O threads and frees the files that were not taken.
+void finishPreloadingInputs();
+} // namespace lld
+
+#endif
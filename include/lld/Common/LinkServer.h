@@ -0,0 +1,43 @@
+//===- LinkServer.h ---------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// A link server is a long-running lld process that links on behalf of other
+// lld processes. Inputs stay in the input cache (see InputCache.h) between
+// links, so a build that runs many links does not read the same libraries
+// over and over.
+//
+// The server is started with "lld --link-server=<socket>", and lld forwards
+// a link to it if LLD_LINK_SERVER is set to the socket path. The client
+// passes its working directory, its command line and its stdout and stderr,
+// so the link behaves as if it ran in the client. Environment variables are
+// not forwarded.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_LINK_SERVER_H
+#define LLD_LINK_SERVER_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
+#include <vector>
+
+namespace lld {
+// Listens on socketPath and calls link for each request, one at a time.
+// link returns the exit code of the link. Returns only if the server cannot
+// be started.
+int runLinkServer(StringRef socketPath,
+                  llvm::function_ref<int(std::vector<const char *> &)> link);
+
+// Asks the server listening on socketPath to link args and returns the exit
+// code, or None if there is no server.
+llvm::Optional<int> forwardToLinkServer(StringRef socketPath,
+                                        ArrayRef<const char *> args);
+} // namespace lld
+
+#endif
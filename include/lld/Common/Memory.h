@@ -22,36 +22,184 @@
 #define LLD_COMMON_MEMORY_H
 
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/StringSaver.h"
+#include "llvm/Support/TypeName.h"
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 namespace lld {
 
+// The memory held by an arena.
+struct ArenaUsage {
+  std::string name;
+  size_t bytes = 0;
+  size_t objects = 0;
+};
+
+// An arena that gives each thread a BumpPtrAllocator of its own, so that it
+// can be used from parallelForEach bodies. A thread looks up its allocator
+// through a thread-local pointer, so allocation does not take a lock once
+// the thread has allocated for the first time. There is only one instance,
+// bAlloc.
+class ArenaAllocator : public llvm::AllocatorBase<ArenaAllocator> {
+public:
+  struct Shard {
+    llvm::BumpPtrAllocator alloc;
+    // Strings are kept apart so that their memory can be told apart.
+    llvm::BumpPtrAllocator stringAlloc;
+    llvm::StringSaver saver{stringAlloc};
+    size_t numAllocations = 0;
+    size_t numStrings = 0;
+  };
+
+  void *Allocate(size_t size, size_t alignment) {
+    Shard &shard = getShard();
+    ++shard.numAllocations;
+    return shard.alloc.Allocate(size, alignment);
+  }
+  using AllocatorBase<ArenaAllocator>::Allocate;
+
+  void Deallocate(const void *ptr, size_t size) {}
+  using AllocatorBase<ArenaAllocator>::Deallocate;
+
+  Shard &getShard() {
+    static LLVM_THREAD_LOCAL Shard *shard;
+    if (!shard)
+      shard = addShard();
+    return *shard;
+  }
+
+  // The allocator behind saver when it is passed as a plain StringSaver,
+  // which is not thread-safe.
+  llvm::BumpPtrAllocator &getUnshardedAllocator() { return unsharded; }
+
+  void Reset();
+  size_t getBytesAllocated() const;
+  // Adds the usage of bAlloc and of saver to v.
+  void addUsage(std::vector<ArenaUsage> &v) const;
+
+private:
+  Shard *addShard();
+
+  mutable std::mutex mu;
+  std::vector<std::unique_ptr<Shard>> shards;
+  llvm::BumpPtrAllocator unsharded;
+};
+
+// Saves strings to the arena of the calling thread. It converts to a plain
+// StringSaver for the command line parsers, which is not thread-safe.
+class ArenaStringSaver {
+public:
+  explicit ArenaStringSaver(ArenaAllocator &arena)
+      : arena(arena), unsharded(arena.getUnshardedAllocator()) {}
+
+  llvm::StringRef save(const char *s) { return save(llvm::StringRef(s)); }
+  llvm::StringRef save(llvm::StringRef s) {
+    ArenaAllocator::Shard &shard = arena.getShard();
+    ++shard.numStrings;
+    return shard.saver.save(s);
+  }
+  llvm::StringRef save(const llvm::Twine &s) {
+    ArenaAllocator::Shard &shard = arena.getShard();
+    ++shard.numStrings;
+    return shard.saver.save(s);
+  }
+  llvm::StringRef save(const std::string &s) {
+    return save(llvm::StringRef(s));
+  }
+
+  operator llvm::StringSaver &() { return unsharded; }
+
+private:
+  ArenaAllocator &arena;
+  llvm::StringSaver unsharded;
+};
+
 // Use this arena if your object doesn't have a destructor.
-extern llvm::BumpPtrAllocator bAlloc;
-extern llvm::StringSaver saver;
+extern ArenaAllocator bAlloc;
+extern ArenaStringSaver saver;
 
 void freeArena();
 
+// Returns the number of bytes allocated from bAlloc and by make<>() so far.
+size_t getArenaMemoryUsage();
+
+// Returns the usage of bAlloc, saver and each make<>() arena, largest first.
+std::vector<ArenaUsage> getArenaUsage();
+
+// Set by --print-arena-usage. If true, the usage of each arena is recorded
+// whenever a top-level Timer stops, for printArenaUsage().
+extern bool arenaUsageEnabled;
+
+void recordArenaUsage(llvm::StringRef phase);
+
+// Prints the growth of the arenas in each recorded phase, and the usage of
+// each arena now.
+void printArenaUsage();
+
 // These two classes are hack to keep track of all
 // SpecificBumpPtrAllocator instances.
 struct SpecificAllocBase {
-  SpecificAllocBase() { instances.push_back(this); }
+  SpecificAllocBase();
   virtual ~SpecificAllocBase() = default;
   virtual void reset() = 0;
+  virtual size_t getBytesAllocated() const = 0;
+  virtual size_t getObjectsAllocated() const = 0;
+  virtual llvm::StringRef getName() const = 0;
   static std::vector<SpecificAllocBase *> instances;
 };
 
+// Like ArenaAllocator, each thread allocates from a shard of its own.
 template <class T> struct SpecificAlloc : public SpecificAllocBase {
-  void reset() override { alloc.DestroyAll(); }
-  llvm::SpecificBumpPtrAllocator<T> alloc;
+  struct Shard {
+    llvm::SpecificBumpPtrAllocator<T> alloc;
+    size_t numAllocated = 0;
+  };
+
+  Shard *addShard() {
+    std::lock_guard<std::mutex> lock(mu);
+    shards.push_back(std::make_unique<Shard>());
+    return shards.back().get();
+  }
+
+  void reset() override {
+    std::lock_guard<std::mutex> lock(mu);
+    for (std::unique_ptr<Shard> &shard : shards) {
+      shard->alloc.DestroyAll();
+      shard->numAllocated = 0;
+    }
+  }
+
+  size_t getBytesAllocated() const override {
+    std::lock_guard<std::mutex> lock(mu);
+    size_t ret = 0;
+    for (const std::unique_ptr<Shard> &shard : shards)
+      ret += shard->numAllocated * sizeof(T);
+    return ret;
+  }
+
+  size_t getObjectsAllocated() const override {
+    return getBytesAllocated() / sizeof(T);
+  }
+
+  llvm::StringRef getName() const override { return llvm::getTypeName<T>(); }
+
+  mutable std::mutex mu;
+  std::vector<std::unique_ptr<Shard>> shards;
 };
 
 // Use this arena if your object has a destructor.
 // Your destructor will be invoked from freeArena().
 template <typename T, typename... U> T *make(U &&... args) {
   static SpecificAlloc<T> alloc;
-  return new (alloc.alloc.Allocate()) T(std::forward<U>(args)...);
+  static LLVM_THREAD_LOCAL typename SpecificAlloc<T>::Shard *shard;
+  if (!shard)
+    shard = alloc.addShard();
+  ++shard->numAllocated;
+  return new (shard->alloc.Allocate()) T(std::forward<U>(args)...);
 }
 
 } // namespace lld
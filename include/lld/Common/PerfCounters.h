@@ -0,0 +1,62 @@
+//===- PerfCounters.h -------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Hardware and software event counters for --perf-counters. When they are
+// enabled, every ScopedTimer also counts the events of its thread, and the
+// counts are reported per phase and per thread along with the phase times.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_COMMON_PERF_COUNTERS_H
+#define LLD_COMMON_PERF_COUNTERS_H
+
+#include "lld/Common/LLVM.h"
+#include <array>
+#include <cstdint>
+
+namespace lld {
+enum PerfEvent {
+  PerfCycles,
+  PerfInstructions,
+  PerfLLCMisses,
+  PerfDTLBMisses,
+  PerfPageFaults,
+  NumPerfEvents
+};
+
+struct PerfCounts {
+  std::array<uint64_t, NumPerfEvents> values{};
+
+  PerfCounts &operator+=(const PerfCounts &other) {
+    for (unsigned i = 0; i != NumPerfEvents; ++i)
+      values[i] += other.values[i];
+    return *this;
+  }
+};
+
+// True if the timers count events. Set by enablePerfCounters.
+extern bool perfCountersEnabled;
+
+// Checks that the events can be counted and enables the counters. Reports
+// a warning and returns false otherwise.
+bool enablePerfCounters();
+
+// Returns the counts of the calling thread so far. The counters of a thread
+// are opened the first time it calls this. Events that the machine cannot
+// count stay zero.
+PerfCounts readPerfCounters();
+
+// Returns a small number that identifies the calling thread in reports. The
+// thread that calls this first gets 0.
+unsigned getPerfThreadIndex();
+
+// Returns the name of an event as it appears in reports, e.g. "llc-misses".
+StringRef getPerfEventName(unsigned event);
+} // namespace lld
+
+#endif
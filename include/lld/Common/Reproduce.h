@@ -12,8 +12,14 @@
 #include "lld/Common/LLVM.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 namespace llvm {
+class TarWriter;
 namespace opt { class Arg; }
 }
 
@@ -29,6 +35,43 @@ std::string quote(StringRef s);
 
 // Returns the string form of the given argument.
 std::string toString(const llvm::opt::Arg &arg);
+
+// Writes the tar file of --reproduce on a background thread, so that adding
+// an input file to it does not block the link. append() copies the data and
+// blocks only if too much of it is waiting to be written. The members are
+// written in the order they were appended. The destructor waits for them,
+// so the tar file is complete once the writer is destroyed.
+class AsyncTarWriter {
+public:
+  static llvm::Expected<std::unique_ptr<AsyncTarWriter>>
+  create(StringRef outputPath, StringRef baseDir);
+
+  ~AsyncTarWriter();
+
+  void append(StringRef path, StringRef data);
+
+  // Waits until all members appended so far are written.
+  void wait();
+
+private:
+  struct Member {
+    std::string path;
+    std::string data;
+  };
+
+  explicit AsyncTarWriter(std::unique_ptr<llvm::TarWriter> tar);
+  void run();
+
+  std::unique_ptr<llvm::TarWriter> tar;
+  std::thread thread;
+  std::mutex mu;
+  std::condition_variable workCond;
+  std::condition_variable doneCond;
+  std::deque<Member> queue;
+  uint64_t queuedBytes = 0;
+  bool writing = false;
+  bool stopping = false;
+};
 }
 
 #endif
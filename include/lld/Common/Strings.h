@@ -35,8 +35,13 @@ public:
 
   bool match(llvm::StringRef s) const;
 
+  // Returns the literal prefix of each pattern, which a string has to start
+  // with to match the pattern.
+  llvm::ArrayRef<std::string> getPrefixes() const { return prefixes; }
+
 private:
   std::vector<llvm::GlobPattern> patterns;
+  std::vector<std::string> prefixes;
 };
 
 } // namespace lld
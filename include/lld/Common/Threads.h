@@ -58,33 +58,269 @@
 #ifndef LLD_COMMON_THREADS_H
 #define LLD_COMMON_THREADS_H
 
-#include "llvm/Support/Parallel.h"
+#include "lld/Common/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <iterator>
+#include <mutex>
+#include <vector>
 
 namespace lld {
 
 extern bool threadsEnabled;
 
-template <typename R, class FuncTy> void parallelForEach(R &&range, FuncTy fn) {
-  if (threadsEnabled)
-    for_each(llvm::parallel::par, std::begin(range), std::end(range), fn);
-  else
-    for_each(llvm::parallel::seq, std::begin(range), std::end(range), fn);
+// Sets the number of threads that run parallel tasks, counting the thread
+// that waits for them. 0 means one per hardware thread, which is the default.
+void setThreadCount(unsigned n);
+
+// Returns the number of threads that run parallel tasks. This is 1 if
+// threading is disabled.
+unsigned getThreadCount();
+
+// Makes the worker threads NUMA-aware if enabled is true. Each worker is
+// pinned to the CPUs of one node, threads steal tasks from their own node
+// first, and the tasks of a parallel loop are spread over the nodes in
+// contiguous ranges of iterations, so that the same iterations of loops of
+// the same size run on the same node and find the memory they first touched
+// there. This has no effect on machines with one node, or on systems other
+// than Linux. This must not be called while tasks are running.
+void setNumaAware(bool enabled);
+
+// Returns the number of NUMA nodes that tasks are spread over. This is 1
+// unless NUMA-aware threading is enabled and there are several nodes.
+unsigned getNumaNodeCount();
+
+// Parses a list of CPUs such as "0-3,8-11" as found in the cpulist files of
+// the NUMA nodes in /sys. Ranges that cannot be parsed are skipped.
+std::vector<unsigned> parseCpuList(StringRef s);
+
+// Sets the amount of memory in bytes that the resident set of the process
+// should stay within. Once the resident set comes close to the budget,
+// parallel loops and tasks run on the calling thread, so that the link gets
+// slower rather than running out of memory. 0 means there is no budget. This
+// also resets the count returned by getMemoryThrottleCount().
+void setMemoryBudget(uint64_t bytes);
+
+uint64_t getMemoryBudget();
+
+// Returns true if there is a memory budget and the resident set is close to
+// it. The resident set is sampled at most once every few milliseconds.
+bool isNearMemoryBudget();
+
+// Returns the part of the memory budget that is not in use, or UINT64_MAX if
+// there is no budget.
+uint64_t getMemoryHeadroom();
+
+// Returns how many times parallel work ran serially because of the memory
+// budget.
+uint64_t getMemoryThrottleCount();
+
+// Counts an operation that was held back because of the memory budget.
+void addMemoryThrottleCount();
+
+// A set of tasks that may run in parallel. Tasks are run by a pool of worker
+// threads that steal work from each other. wait() runs pending tasks on the
+// calling thread instead of just blocking, so a task may create its own
+// TaskGroup and wait for it without starving the pool.
+class TaskGroup {
+public:
+  TaskGroup() = default;
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+  ~TaskGroup() { wait(); }
+
+  // Runs fn asynchronously, or right away if threading is disabled. If
+  // node is given and NUMA-aware threading is enabled, fn preferably runs on
+  // that node.
+  void spawn(std::function<void()> fn, int node = -1);
+
+  // Waits until all tasks spawned in this group have finished.
+  void wait();
+
+private:
+  std::atomic<size_t> pending{0};
+  std::mutex mu;
+  std::condition_variable cond;
+};
+
+// Returns the number of iterations that each task runs when n iterations
+// are split into tasks. If grainSize is 0, a size is chosen that creates
+// enough tasks to balance the load between threads.
+size_t getTaskSize(size_t n, size_t grainSize);
+
+// Calls fn(i) for each i in [begin, end). At least grainSize iterations run
+// in each task.
+void parallelForEachN(size_t begin, size_t end,
+                      llvm::function_ref<void(size_t)> fn,
+                      size_t grainSize = 0);
+
+namespace detail {
+template <class IterTy, class FuncTy>
+void parallelForEach(IterTy begin, IterTy end, FuncTy &fn, size_t grainSize,
+                     std::random_access_iterator_tag) {
+  parallelForEachN(
+      0, end - begin, [&](size_t i) { fn(begin[i]); }, grainSize);
 }
 
-inline void parallelForEachN(size_t begin, size_t end,
-                             llvm::function_ref<void(size_t)> fn) {
-  if (threadsEnabled)
-    for_each_n(llvm::parallel::par, begin, end, fn);
-  else
-    for_each_n(llvm::parallel::seq, begin, end, fn);
+template <class IterTy, class FuncTy>
+void parallelForEach(IterTy begin, IterTy end, FuncTy &fn, size_t,
+                     std::input_iterator_tag) {
+  if (getThreadCount() == 1) {
+    std::for_each(begin, end, fn);
+    return;
+  }
+  TaskGroup tg;
+  for (; begin != end; ++begin)
+    tg.spawn([begin, &fn] { fn(*begin); });
+}
+
+template <class IterTy, class Comparator>
+IterTy medianOf3(IterTy start, IterTy end, const Comparator &comp) {
+  IterTy mid = start + (std::distance(start, end) / 2);
+  return comp(*start, *(end - 1))
+             ? (comp(*mid, *(end - 1)) ? (comp(*start, *mid) ? mid : start)
+                                       : end - 1)
+             : (comp(*mid, *start) ? (comp(*(end - 1), *mid) ? mid : end - 1)
+                                   : start);
+}
+
+template <class IterTy, class Comparator>
+void parallelQuickSort(IterTy start, IterTy end, const Comparator &comp,
+                       TaskGroup &tg, size_t depth) {
+  // Sort small ranges sequentially, and give up splitting if the pivots
+  // turn out to be bad.
+  if (std::distance(start, end) < 1024 || depth == 0) {
+    llvm::sort(start, end, comp);
+    return;
+  }
+
+  // Partition around a pivot, which ends up at its final position.
+  IterTy pivot = medianOf3(start, end, comp);
+  std::swap(*(end - 1), *pivot);
+  pivot = std::partition(start, end - 1, [&](decltype(*start) v) {
+    return comp(v, *(end - 1));
+  });
+  std::swap(*pivot, *(end - 1));
+
+  tg.spawn([=, &comp, &tg] {
+    parallelQuickSort(start, pivot, comp, tg, depth - 1);
+  });
+  parallelQuickSort(pivot + 1, end, comp, tg, depth - 1);
+}
+} // namespace detail
+
+template <typename R, class FuncTy>
+void parallelForEach(R &&range, FuncTy fn, size_t grainSize = 0) {
+  auto begin = std::begin(range);
+  detail::parallelForEach(
+      begin, std::end(range), fn, grainSize,
+      typename std::iterator_traits<decltype(begin)>::iterator_category());
 }
 
 template <typename R, class FuncTy> void parallelSort(R &&range, FuncTy fn) {
-  if (threadsEnabled)
-    sort(llvm::parallel::par, std::begin(range), std::end(range), fn);
-  else
-    sort(llvm::parallel::seq, std::begin(range), std::end(range), fn);
+  auto begin = std::begin(range);
+  auto end = std::end(range);
+  if (getThreadCount() == 1) {
+    llvm::sort(begin, end, fn);
+    return;
+  }
+  TaskGroup tg;
+  detail::parallelQuickSort(begin, end, fn, tg,
+                            llvm::Log2_64(std::distance(begin, end)) + 1);
+}
+
+// Returns reduce(... reduce(reduce(init, transform(begin)),
+// transform(begin + 1)) ..., transform(end - 1)), except that the iterations
+// run in parallel in an unspecified grouping. reduce must be associative,
+// and init must be an identity of it, because each task starts from init.
+template <class T, class ReduceFuncTy, class TransformFuncTy>
+T parallelTransformReduceN(size_t begin, size_t end, T init,
+                           ReduceFuncTy reduce, TransformFuncTy transform,
+                           size_t grainSize = 0) {
+  if (begin >= end)
+    return init;
+  size_t taskSize = getTaskSize(end - begin, grainSize);
+  size_t numTasks = (end - begin + taskSize - 1) / taskSize;
+  std::vector<T> results(numTasks, init);
+  parallelForEachN(
+      0, numTasks,
+      [&](size_t task) {
+        size_t first = begin + task * taskSize;
+        size_t last = std::min(first + taskSize, end);
+        T result = init;
+        for (size_t i = first; i < last; ++i)
+          result = reduce(std::move(result), transform(i));
+        results[task] = std::move(result);
+      },
+      1);
+
+  T result = std::move(init);
+  for (T &r : results)
+    result = reduce(std::move(result), std::move(r));
+  return result;
+}
+
+template <class R, class T, class ReduceFuncTy, class TransformFuncTy>
+T parallelTransformReduce(R &&range, T init, ReduceFuncTy reduce,
+                          TransformFuncTy transform, size_t grainSize = 0) {
+  auto begin = std::begin(range);
+  return parallelTransformReduceN(
+      0, std::distance(begin, std::end(range)), std::move(init), reduce,
+      [&](size_t i) { return transform(begin[i]); }, grainSize);
+}
+
+// Replaces each element of v with the combination, by op, of init and all
+// elements before it, and returns the combination of init and all elements.
+// For example, {1, 2, 3} becomes {0, 1, 3} and 6 is returned if init is 0 and
+// op is +. op must be associative.
+template <class T, class BinaryOpTy = std::plus<T>>
+T parallelExclusiveScan(MutableArrayRef<T> v, T init,
+                        BinaryOpTy op = BinaryOpTy(), size_t grainSize = 0) {
+  if (v.empty())
+    return init;
+  size_t taskSize = getTaskSize(v.size(), grainSize);
+  size_t numTasks = (v.size() + taskSize - 1) / taskSize;
+
+  // Sum up each chunk.
+  std::vector<T> totals(numTasks);
+  parallelForEachN(
+      0, numTasks,
+      [&](size_t task) {
+        ArrayRef<T> chunk = v.slice(task * taskSize).take_front(taskSize);
+        T sum = chunk[0];
+        for (size_t i = 1, e = chunk.size(); i < e; ++i)
+          sum = op(sum, chunk[i]);
+        totals[task] = std::move(sum);
+      },
+      1);
+
+  // Compute the starting value of each chunk, then scan the chunks.
+  T sum = std::move(init);
+  for (T &total : totals) {
+    T next = op(sum, total);
+    total = std::move(sum);
+    sum = std::move(next);
+  }
+
+  parallelForEachN(
+      0, numTasks,
+      [&](size_t task) {
+        MutableArrayRef<T> chunk =
+            v.slice(task * taskSize).take_front(taskSize);
+        T acc = std::move(totals[task]);
+        for (T &x : chunk) {
+          T next = op(acc, x);
+          x = std::move(acc);
+          acc = std::move(next);
+        }
+      },
+      1);
+  return sum;
 }
 
 } // namespace lld
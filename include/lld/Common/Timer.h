@@ -9,17 +9,31 @@
 #ifndef LLD_COMMON_TIMER_H
 #define LLD_COMMON_TIMER_H
 
+#include "lld/Common/PerfCounters.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringRef.h"
 #include <assert.h>
+#include <atomic>
 #include <chrono>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace llvm {
+namespace json {
+class OStream;
+}
+} // namespace llvm
 
 namespace lld {
 
 class Timer;
 
+// Measures the time from its construction to stop() or its destruction in t.
+// Scoped timers of the same Timer may run on several threads at once.
 struct ScopedTimer {
   explicit ScopedTimer(Timer &t);
 
@@ -28,6 +42,10 @@ struct ScopedTimer {
   void stop();
 
   Timer *t = nullptr;
+  std::chrono::high_resolution_clock::time_point startTime;
+  // The event counts of this thread when the timer started, with
+  // --perf-counters.
+  PerfCounts startCounts;
 };
 
 class Timer {
@@ -36,23 +54,61 @@ public:
 
   static Timer &root();
 
-  void start();
-  void stop();
   void print();
 
+  // Writes this timer and its children as a JSON object.
+  void writeJSON(llvm::json::OStream &j) const;
+
+  // The wall time during which the timer was running on at least one thread.
   double millis() const;
+  // The CPU time that the whole process used during millis().
+  double cpuMillis() const;
+  // The sum of the times of all runs, which exceeds millis() if the timer
+  // ran on several threads at once.
+  double busyMillis() const;
+  // The number of times the timer was run.
+  uint64_t getCount() const;
+
+  llvm::StringRef getName() const { return name; }
+  std::vector<Timer *> getChildren() const;
+  bool isTopLevel() const { return !parent || parent == &root(); }
 
 private:
+  friend struct ScopedTimer;
+
   explicit Timer(llvm::StringRef name);
   void print(int depth, double totalDuration, bool recurse = true) const;
 
+  void start();
+  void stop(std::chrono::nanoseconds busy);
+  void addPerfCounts(unsigned thread, const PerfCounts &counts);
+  void printPerfCounts(int depth) const;
+
+  std::atomic<bool> registered{false};
+  mutable std::mutex mu;
+  // The number of threads on which the timer is running.
+  unsigned numRunning = 0;
   std::chrono::time_point<std::chrono::high_resolution_clock> startTime;
-  std::chrono::nanoseconds total;
+  std::chrono::nanoseconds startCPUTime;
+  std::chrono::nanoseconds total{0};
+  std::chrono::nanoseconds cpuTotal{0};
+  std::chrono::nanoseconds busyTotal{0};
+  uint64_t count = 0;
+  // The arena memory usage when the timer was last stopped. This is only
+  // recorded for the root timer and its children.
+  size_t arenaMemory = 0;
+  // With --perf-counters, the events counted while the timer was running, in
+  // total and by thread index.
+  PerfCounts perfTotal;
+  std::map<unsigned, PerfCounts> perfByThread;
   std::vector<Timer *> children;
   std::string name;
   Timer *parent;
 };
 
+// Writes the timer tree to path as JSON.
+void writeTimersJSON(llvm::StringRef path);
+
 } // namespace lld
 
 #endif
@@ -10,6 +10,7 @@
 #define LLD_CORE_ARCHIVE_LIBRARY_FILE_H
 
 #include "lld/Core/File.h"
+#include "llvm/ADT/ArrayRef.h"
 #include <set>
 
 namespace lld {
@@ -33,6 +34,11 @@ public:
   /// specified name and return the File object for that member, or nullptr.
   virtual File *find(StringRef name) = 0;
 
+  /// Hints that find() is about to be called for the given names. Archives
+  /// may use it to parse the members defining them ahead of time, for
+  /// example in parallel. The default implementation does nothing.
+  virtual void prefetch(ArrayRef<StringRef> names) {}
+
   virtual std::error_code
   parseAllMembers(std::vector<std::unique_ptr<File>> &result) = 0;
 
@@ -283,6 +283,15 @@ public:
   /// content.
   virtual ArrayRef<uint8_t> rawContent() const = 0;
 
+  /// Returns the hash of the content of this atom, which is used to coalesce
+  /// atoms that are merged by content. Files with many such atoms can
+  /// compute the hash when the file is parsed and return it from here.
+  virtual unsigned contentHash() const;
+
+  /// Utility function for computing contentHash().
+  static unsigned hashContent(uint64_t size, ContentType type,
+                              ArrayRef<uint8_t> content);
+
   /// This class abstracts iterating over the sequence of References
   /// in an Atom.  Concrete instances of DefinedAtom must implement
   /// the derefIterator() and incrementIterator() methods.
@@ -8,6 +8,8 @@
 ///
 /// \file
 /// Provide an Instrumentation API that optionally uses VTune interfaces.
+/// Without VTune, tasks are recorded by the LLVM time trace profiler when it
+/// has been enabled with -time-trace.
 ///
 //===----------------------------------------------------------------------===//
 
@@ -15,6 +17,7 @@
 #define LLD_CORE_INSTRUMENTATION_H
 
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/TimeProfiler.h"
 #include <utility>
 
 #ifdef LLD_HAS_VTUNE
@@ -106,14 +109,41 @@ public:
 };
 
 class StringHandle {
+  const char *_name;
+
 public:
-  StringHandle(const char *name) {}
+  StringHandle(const char *name) : _name(name) {}
+
+  operator const char *() const { return _name; }
 };
 
+/// A task recorded as a time trace event. The time trace profiler is not
+/// thread-safe, so tasks must only be created on the main thread.
 class ScopedTask {
+  bool _active;
+
+  ScopedTask(const ScopedTask &) = delete;
+  ScopedTask &operator=(const ScopedTask &) = delete;
+
 public:
-  ScopedTask(const Domain &d, const StringHandle &s) {}
-  void end() {}
+  ScopedTask(const Domain &d, const StringHandle &s)
+      : _active(llvm::timeTraceProfilerEnabled()) {
+    if (_active)
+      llvm::timeTraceProfilerBegin(static_cast<const char *>(s), "");
+  }
+
+  ScopedTask(ScopedTask &&other) : _active(other._active) {
+    other._active = false;
+  }
+
+  /// Prematurely end this task.
+  void end() {
+    if (_active)
+      llvm::timeTraceProfilerEnd();
+    _active = false;
+  }
+
+  ~ScopedTask() { end(); }
 };
 
 class Marker {
@@ -17,8 +17,8 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/Support/ErrorOr.h"
+#include <atomic>
 #include <set>
-#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -68,7 +68,7 @@ private:
   void removeCoalescedAwayAtoms();
   llvm::Expected<bool> forEachUndefines(File &file, UndefCallback callback);
 
-  void markLive(const Atom *atom);
+  bool isLive(const Atom *atom) const;
 
   class MergedFile : public SimpleFile {
   public:
@@ -80,10 +80,10 @@ private:
   SymbolTable _symbolTable;
   std::vector<OwningAtomPtr<Atom>>     _atoms;
   std::set<const Atom *>        _deadStripRoots;
-  llvm::DenseSet<const Atom *>  _liveAtoms;
+  llvm::DenseMap<const Atom *, uint32_t> _atomIndex;
+  std::vector<std::atomic<bool>> _liveAtoms;
   llvm::DenseSet<const Atom *>  _deadAtoms;
   std::unique_ptr<MergedFile>   _result;
-  std::unordered_multimap<const Atom *, const Atom *> _reverseRef;
 
   // --start-group and --end-group
   std::vector<File *> _files;
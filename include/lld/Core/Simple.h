@@ -202,7 +202,7 @@ public:
                     Reference::KindValue kindValue, uint64_t off,
                     const Atom *target, Reference::Addend a) override {
     assert(target && "trying to create reference to nothing");
-    auto node = new (_file.allocator())
+    auto node = new (referenceAllocator())
         SimpleReference(ns, arch, kindValue, off, target, a);
     _references.push_back(node);
   }
@@ -233,8 +233,32 @@ public:
     }
   }
 
+  /// Move the references, in their current order, into one contiguous array
+  /// allocated from \p alloc, so that walking them does not chase pointers
+  /// all over memory.
+  void packReferences(llvm::BumpPtrAllocator &alloc) const {
+    size_t count = std::distance(_references.begin(), _references.end());
+    if (count == 0)
+      return;
+    SimpleReference *packed = alloc.Allocate<SimpleReference>(count);
+    SimpleReference *p = packed;
+    for (const SimpleReference &ref : _references)
+      new (p++) SimpleReference(ref.kindNamespace(), ref.kindArch(),
+                                ref.kindValue(), ref.offsetInAtom(),
+                                ref.target(), ref.addend());
+    _references.clearAndLeakNodesUnsafely();
+    for (size_t i = 0; i != count; ++i)
+      _references.push_back(&packed[i]);
+  }
+
   void setOrdinal(uint64_t ord) { _ordinal = ord; }
 
+protected:
+  /// Returns the allocator for the references added to this atom.
+  virtual llvm::BumpPtrAllocator &referenceAllocator() const {
+    return _file.allocator();
+  }
+
 private:
   typedef llvm::ilist<SimpleReference> RefList;
 
@@ -25,6 +25,7 @@ namespace lld {
 
 namespace mach_o {
 class ArchHandler;
+class IncrementalLinker;
 class MachODylibFile;
 class MachOFile;
 class SectCreateFile;
@@ -149,11 +150,28 @@ public:
   void addInputFileDependency(StringRef path) const;
   void addInputFileNotFound(StringRef path) const;
   void addOutputFileDependency(StringRef path) const;
+  bool hasDependencyFile() const { return _dependencyInfo != nullptr; }
+
+  /// Enables -incremental. \p argsHash identifies the command line.
+  void setIncremental(uint64_t argsHash);
+  /// Returns the incremental linker, or null without -incremental.
+  mach_o::IncrementalLinker *incrementalLinker() const {
+    return _incremental.get();
+  }
+  /// Tries to patch the previous output instead of linking. Returns true if
+  /// that was done or failed with an error, and false if a full link is
+  /// needed.
+  bool linkIncrementally();
+  void recordResolvedAtomsForIncremental(const File &merged);
+  void writeIncrementalState();
 
   bool minOS(StringRef mac, StringRef iOS) const;
   void setDoNothing(bool value) { _doNothing = value; }
   bool doNothing() const { return _doNothing; }
   bool printAtoms() const { return _printAtoms; }
+  /// The path to write the time trace to, or empty if -time-trace was not
+  /// given.
+  StringRef timeTraceFile() const { return _timeTraceFile; }
   bool testingFileUsage() const { return _testingFileUsage; }
   const StringRefVector &searchDirs() const { return _searchDirs; }
   const StringRefVector &frameworkDirs() const { return _frameworkDirs; }
@@ -317,6 +335,7 @@ public:
 
   void setBundleLoader(StringRef loader) { _bundleLoader = loader; }
   void setPrintAtoms(bool value=true) { _printAtoms = value; }
+  void setTimeTraceFile(StringRef path) { _timeTraceFile = path; }
   void setTestingFileUsage(bool value = true) {
     _testingFileUsage = value;
   }
@@ -484,6 +503,7 @@ private:
   bool _generateFunctionStartsLoadCommand = false;
   bool _generateDataInCodeLoadCommand = false;
   StringRef _bundleLoader;
+  std::string _timeTraceFile;
   mutable std::unique_ptr<mach_o::ArchHandler> _archHandler;
   mutable std::unique_ptr<Writer> _writer;
   std::vector<SectionAlign> _sectAligns;
@@ -496,6 +516,7 @@ private:
   llvm::StringSet<> _exportedSymbols;
   DebugInfoMode _debugInfoMode = DebugInfoMode::addDebugMap;
   std::unique_ptr<llvm::raw_fd_ostream> _dependencyInfo;
+  std::unique_ptr<mach_o::IncrementalLinker> _incremental;
   llvm::StringMap<std::vector<OrderFileNode>> _orderFiles;
   unsigned _orderFileEntries = 0;
   File *_flatNamespaceFile = nullptr;
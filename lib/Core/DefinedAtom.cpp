@@ -9,6 +9,8 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "lld/Core/DefinedAtom.h"
 #include "lld/Core/File.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Hashing.h"
 
 namespace lld {
 
@@ -78,4 +80,15 @@ DefinedAtom::ContentPermissions DefinedAtom::permissions(ContentType type) {
   llvm_unreachable("unknown content type");
 }
 
+unsigned DefinedAtom::contentHash() const {
+  return hashContent(size(), contentType(), rawContent());
+}
+
+unsigned DefinedAtom::hashContent(uint64_t size, ContentType type,
+                                  ArrayRef<uint8_t> content) {
+  return llvm::hash_combine(size, type,
+                            llvm::hash_combine_range(content.begin(),
+                                                     content.end()));
+}
+
 } // namespace
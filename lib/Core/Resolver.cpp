@@ -8,6 +8,7 @@
 
 #include "lld/Core/Resolver.h"
 #include "lld/Common/LLVM.h"
+#include "lld/Common/Threads.h"
 #include "lld/Core/ArchiveLibraryFile.h"
 #include "lld/Core/Atom.h"
 #include "lld/Core/File.h"
@@ -23,6 +24,7 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <utility>
 #include <vector>
@@ -73,8 +75,24 @@ llvm::Expected<bool> Resolver::forEachUndefines(File &file,
 
 llvm::Expected<bool> Resolver::handleArchiveFile(File &file) {
   ArchiveLibraryFile *archiveFile = cast<ArchiveLibraryFile>(&file);
+  // Let the archive parse the members for the pending undefines up front.
+  // Undefines added by the members loaded below are passed on as the next
+  // batch the first time the callback runs after they were added.
+  size_t prefetched = _undefineIndex[&file];
   return forEachUndefines(file,
                           [&](StringRef undefName) -> llvm::Expected<bool> {
+    if (prefetched < _undefines.size()) {
+      std::vector<StringRef> names;
+      for (; prefetched < _undefines.size(); ++prefetched) {
+        StringRef name = _undefines[prefetched];
+        if (name.empty())
+          continue;
+        const Atom *atom = _symbolTable.findByName(name);
+        if (isa<UndefinedAtom>(atom) && !_symbolTable.isCoalescedAway(atom))
+          names.push_back(name);
+      }
+      archiveFile->prefetch(names);
+    }
     if (File *member = archiveFile->find(undefName)) {
       member->setOrdinal(_ctx.getNextOrdinalAndIncrement());
       return handleFile(*member);
@@ -315,21 +333,32 @@ void Resolver::updateReferences() {
   }
 }
 
-// For dead code stripping, recursively mark atoms "live"
-void Resolver::markLive(const Atom *atom) {
-  // Mark the atom is live. If it's already marked live, then stop recursion.
-  auto exists = _liveAtoms.insert(atom);
-  if (!exists.second)
-    return;
-
-  // Mark all atoms it references as live
-  if (const DefinedAtom *defAtom = dyn_cast<DefinedAtom>(atom)) {
-    for (const Reference *ref : *defAtom)
-      markLive(ref->target());
-    for (auto &p : llvm::make_range(_reverseRef.equal_range(defAtom))) {
-      const Atom *target = p.second;
-      markLive(target);
-    }
+// For dead code stripping, mark all atoms reachable from the given frontier
+// "live". Node I of the reference graph has the out-edges
+// edges[offsets[I]] to edges[offsets[I + 1] - 1]. The graph is traversed
+// breadth-first, and each frontier is visited in parallel.
+static void markLive(std::vector<uint32_t> frontier,
+                     ArrayRef<uint32_t> offsets, ArrayRef<uint32_t> edges,
+                     std::vector<std::atomic<bool>> &live) {
+  const size_t chunkSize = 1024;
+  while (!frontier.empty()) {
+    std::vector<std::vector<uint32_t>> next(
+        (frontier.size() + chunkSize - 1) / chunkSize);
+    parallelForEachN(0, next.size(), [&](size_t chunk) {
+      size_t end = std::min(frontier.size(), (chunk + 1) * chunkSize);
+      for (size_t i = chunk * chunkSize; i != end; ++i) {
+        uint32_t node = frontier[i];
+        for (uint32_t j = offsets[node], e = offsets[node + 1]; j != e; ++j) {
+          uint32_t target = edges[j];
+          if (!live[target].load(std::memory_order_relaxed) &&
+              !live[target].exchange(true, std::memory_order_relaxed))
+            next[chunk].push_back(target);
+        }
+      }
+    });
+    frontier.clear();
+    for (std::vector<uint32_t> &v : next)
+      frontier.insert(frontier.end(), v.begin(), v.end());
   }
 }
 
@@ -339,6 +368,11 @@ static bool isBackref(const Reference *ref) {
   return (ref->kindValue() == lld::Reference::kindLayoutAfter);
 }
 
+bool Resolver::isLive(const Atom *atom) const {
+  auto it = _atomIndex.find(atom);
+  return it != _atomIndex.end() && _liveAtoms[it->second];
+}
+
 // remove all atoms not actually used
 void Resolver::deadStripOptimize() {
   DEBUG_WITH_TYPE("resolver",
@@ -348,19 +382,6 @@ void Resolver::deadStripOptimize() {
   if (!_ctx.deadStrip())
     return;
 
-  // Some type of references prevent referring atoms to be dead-striped.
-  // Make a reverse map of such references before traversing the graph.
-  // While traversing the list of atoms, mark AbsoluteAtoms as live
-  // in order to avoid reclaim.
-  for (const OwningAtomPtr<Atom> &atom : _atoms) {
-    if (const DefinedAtom *defAtom = dyn_cast<DefinedAtom>(atom.get()))
-      for (const Reference *ref : *defAtom)
-        if (isBackref(ref))
-          _reverseRef.insert(std::make_pair(ref->target(), atom.get()));
-    if (const AbsoluteAtom *absAtom = dyn_cast<AbsoluteAtom>(atom.get()))
-      markLive(absAtom);
-  }
-
   // By default, shared libraries are built with all globals as dead strip roots
   if (_ctx.globalsAreDeadStripRoots())
     for (const OwningAtomPtr<Atom> &atom : _atoms)
@@ -375,14 +396,83 @@ void Resolver::deadStripOptimize() {
     _deadStripRoots.insert(symAtom);
   }
 
-  // mark all roots as live, and recursively all atoms they reference
+  // Number the atoms so that the reference graph can be stored in flat
+  // arrays. Roots and reference targets are normally in _atoms, but any
+  // that are not get nodes of their own, which are numbered (and whose
+  // references are followed) as they are found.
+  std::vector<const Atom *> nodes;
+  nodes.reserve(_atoms.size());
+  _atomIndex.clear();
+  _atomIndex.reserve(_atoms.size());
+  auto getIndex = [&](const Atom *atom) {
+    auto p = _atomIndex.insert(std::make_pair(atom, (uint32_t)nodes.size()));
+    if (p.second)
+      nodes.push_back(atom);
+    return p.first->second;
+  };
+  for (const OwningAtomPtr<Atom> &atom : _atoms)
+    getIndex(atom.get());
+
+  // AbsoluteAtoms are always live in order to avoid reclaim.
+  std::vector<uint32_t> roots;
+  for (const OwningAtomPtr<Atom> &atom : _atoms)
+    if (isa<AbsoluteAtom>(atom.get()))
+      roots.push_back(_atomIndex[atom.get()]);
   for (const Atom *dsrAtom : _deadStripRoots)
-    markLive(dsrAtom);
+    roots.push_back(getIndex(dsrAtom));
+
+  // Count the out-edges of each node. A defined atom keeps alive the atoms
+  // it references, and some type of references also prevent the referring
+  // atoms to be dead-striped, which adds an edge in the reverse direction.
+  std::vector<uint32_t> numForward;
+  std::vector<uint32_t> numReverse;
+  std::vector<std::pair<uint32_t, uint32_t>> backrefs;
+  numForward.reserve(nodes.size());
+  for (size_t i = 0; i != nodes.size(); ++i) {
+    uint32_t n = 0;
+    if (const DefinedAtom *defAtom = dyn_cast<DefinedAtom>(nodes[i])) {
+      for (const Reference *ref : *defAtom) {
+        uint32_t target = getIndex(ref->target());
+        if (isBackref(ref))
+          backrefs.push_back(std::make_pair(target, (uint32_t)i));
+        ++n;
+      }
+    }
+    numForward.push_back(n);
+  }
+  numReverse.resize(nodes.size());
+  for (const std::pair<uint32_t, uint32_t> &p : backrefs)
+    ++numReverse[p.first];
+
+  std::vector<uint32_t> offsets(nodes.size() + 1);
+  for (size_t i = 0, e = nodes.size(); i != e; ++i)
+    offsets[i + 1] = offsets[i] + numForward[i] + numReverse[i];
+
+  // Each node's forward edges come first, followed by its reverse edges.
+  std::vector<uint32_t> edges(offsets.back());
+  parallelForEachN(0, nodes.size(), [&](size_t i) {
+    if (const DefinedAtom *defAtom = dyn_cast<DefinedAtom>(nodes[i])) {
+      uint32_t j = offsets[i];
+      for (const Reference *ref : *defAtom)
+        edges[j++] = _atomIndex.find(ref->target())->second;
+    }
+  });
+  for (const std::pair<uint32_t, uint32_t> &p : backrefs)
+    edges[offsets[p.first] + numForward[p.first] + --numReverse[p.first]] =
+        p.second;
+
+  // mark all roots as live, and transitively all atoms they reference
+  _liveAtoms = std::vector<std::atomic<bool>>(nodes.size());
+  std::vector<uint32_t> frontier;
+  for (uint32_t root : roots)
+    if (!_liveAtoms[root].exchange(true))
+      frontier.push_back(root);
+  markLive(std::move(frontier), offsets, edges, _liveAtoms);
 
   // now remove all non-live atoms from _atoms
   _atoms.erase(std::remove_if(_atoms.begin(), _atoms.end(),
                               [&](OwningAtomPtr<Atom> &a) {
-                 return _liveAtoms.count(a.get()) == 0;
+                 return !isLive(a.get());
                }),
                _atoms.end());
 }
@@ -398,7 +488,7 @@ bool Resolver::checkUndefines() {
     // When dead code stripping, we don't care if dead atoms are undefined.
     undefinedAtoms.erase(
         std::remove_if(undefinedAtoms.begin(), undefinedAtoms.end(),
-                       [&](const Atom *a) { return _liveAtoms.count(a) == 0; }),
+                       [&](const Atom *a) { return !isLive(a); }),
         undefinedAtoms.end());
   }
 
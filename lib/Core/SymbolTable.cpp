@@ -211,11 +211,7 @@ bool SymbolTable::addByName(const Atom &newAtom) {
 }
 
 unsigned SymbolTable::AtomMappingInfo::getHashValue(const DefinedAtom *atom) {
-  auto content = atom->rawContent();
-  return llvm::hash_combine(atom->size(),
-                            atom->contentType(),
-                            llvm::hash_combine_range(content.begin(),
-                                                     content.end()));
+  return atom->contentHash();
 }
 
 bool SymbolTable::AtomMappingInfo::isEqual(const DefinedAtom * const l,
@@ -242,12 +238,10 @@ bool SymbolTable::AtomMappingInfo::isEqual(const DefinedAtom * const l,
 }
 
 bool SymbolTable::addByContent(const DefinedAtom &newAtom) {
-  AtomContentSet::iterator pos = _contentTable.find(&newAtom);
-  if (pos == _contentTable.end()) {
-    _contentTable.insert(&newAtom);
+  auto pos = _contentTable.insert(&newAtom);
+  if (pos.second)
     return true;
-  }
-  const Atom* existing = *pos;
+  const Atom* existing = *pos.first;
   // New atom is not being used.  Add it to replacement table.
   _replacedAtoms[&newAtom] = existing;
   return false;
@@ -15,6 +15,8 @@
 #include "lld/Common/Args.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/LLVM.h"
+#include "lld/Common/Threads.h"
+#include "lld/Common/Version.h"
 #include "lld/Core/ArchiveLibraryFile.h"
 #include "lld/Core/Error.h"
 #include "lld/Core/File.h"
@@ -42,11 +44,14 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 #include <algorithm>
 #include <cstdint>
 #include <memory>
@@ -311,6 +316,28 @@ static void parseLLVMOptions(const LinkingContext &ctx) {
   }
 }
 
+// Returns a hash of the linker version and the options that affect the
+// output, which -incremental uses to tell whether it may patch the previous
+// output.
+static uint64_t getArgsHash(const llvm::opt::InputArgList &parsedArgs) {
+  std::string s = getLLDVersion();
+  for (const llvm::opt::Arg *arg : parsedArgs) {
+    switch (arg->getOption().getID()) {
+    case OPT_t:
+    case OPT_v:
+    case OPT_error_limit:
+    case OPT_time_trace:
+    case OPT_time_trace_file:
+    case OPT_time_trace_granularity:
+    case OPT_threads_eq:
+      continue;
+    }
+    s += '\0';
+    s += arg->getAsString(parsedArgs);
+  }
+  return llvm::xxHash64(s);
+}
+
 namespace lld {
 namespace mach_o {
 
@@ -335,6 +362,10 @@ bool parse(llvm::ArrayRef<const char *> args, MachOLinkingContext &ctx) {
 
   errorHandler().verbose = parsedArgs.hasArg(OPT_v);
   errorHandler().errorLimit = args::getInteger(parsedArgs, OPT_error_limit, 20);
+  args::setThreads(parsedArgs, 0, 0, OPT_threads_eq);
+
+  if (parsedArgs.hasArg(OPT_incremental))
+    ctx.setIncremental(getArgsHash(parsedArgs));
 
   // Figure out output kind ( -dylib, -r, -bundle, -preload, or -static )
   llvm::MachO::HeaderFileType fileType = llvm::MachO::MH_EXECUTE;
@@ -556,6 +587,23 @@ bool parse(llvm::ArrayRef<const char *> args, MachOLinkingContext &ctx) {
   if (parsedArgs.getLastArg(OPT_t))
     ctx.setLogInputFiles(true);
 
+  // Handle -time-trace. The profiler is started here so that the rest of
+  // the link is covered.
+  if (parsedArgs.hasArg(OPT_time_trace)) {
+    unsigned granularity = 500;
+    if (auto *arg = parsedArgs.getLastArg(OPT_time_trace_granularity)) {
+      if (StringRef(arg->getValue()).getAsInteger(10, granularity)) {
+        error("invalid value for -time-trace-granularity: " +
+              Twine(arg->getValue()));
+        return false;
+      }
+    }
+    StringRef path = parsedArgs.getLastArgValue(OPT_time_trace_file);
+    ctx.setTimeTraceFile(path.empty() ? (ctx.outputPath() + ".time-trace").str()
+                                      : path.str());
+    llvm::timeTraceProfilerInitialize(granularity, args[0]);
+  }
+
   // Handle -demangle option.
   if (parsedArgs.getLastArg(OPT_demangle))
     ctx.setDemangleSymbols(true);
@@ -1161,9 +1209,23 @@ bool link(llvm::ArrayRef<const char *> args, bool CanExitEarly,
   if (ctx.getNodes().empty())
     return false;
 
+  if (ctx.incrementalLinker() && ctx.linkIncrementally()) {
+    if (CanExitEarly)
+      exitLld(errorCount() ? 1 : 0);
+    return !errorCount();
+  }
+
+  // Parse the input files in parallel. Each file is converted to atoms
+  // independently of the others, and the resolver then visits the parsed files
+  // in order, so the result does not depend on the order of parsing. Errors
+  // are reported when the resolver visits the file.
+  std::vector<File *> files;
   for (std::unique_ptr<Node> &ie : ctx.getNodes())
     if (FileNode *node = dyn_cast<FileNode>(ie.get()))
-      node->getFile()->parse();
+      files.push_back(node->getFile());
+  ScopedTask parseTask(getDefaultDomain(), "Parse input files");
+  parallelForEach(files, [](File *file) { file->parse(); });
+  parseTask.end();
 
   createFiles(ctx, false /* Implicit */);
 
@@ -1187,6 +1249,8 @@ bool link(llvm::ArrayRef<const char *> args, bool CanExitEarly,
     members.insert(members.begin(),
                    std::make_unique<FileNode>(std::move(mergedFile)));
   }
+  if (ctx.incrementalLinker())
+    ctx.recordResolvedAtomsForIncremental(*merged);
   resolveTask.end();
 
   // Run passes on linked atoms.
@@ -1216,6 +1280,18 @@ bool link(llvm::ArrayRef<const char *> args, bool CanExitEarly,
                           std::string());
     return false;
   }
+  ctx.writeIncrementalState();
+  writeTask.end();
+
+  if (!ctx.timeTraceFile().empty()) {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(ctx.timeTraceFile(), ec, llvm::sys::fs::OF_Text);
+    if (ec)
+      error("cannot open " + ctx.timeTraceFile() + ": " + ec.message());
+    else
+      llvm::timeTraceProfilerWrite(os);
+    llvm::timeTraceProfilerCleanup();
+  }
 
   // Call exit() if we can to avoid calling destructors.
   if (CanExitEarly)
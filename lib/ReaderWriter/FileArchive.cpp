@@ -7,9 +7,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "lld/Common/LLVM.h"
+#include "lld/Common/Threads.h"
 #include "lld/Core/ArchiveLibraryFile.h"
 #include "lld/Core/File.h"
 #include "lld/Core/Reader.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/BinaryFormat/Magic.h"
@@ -48,26 +50,27 @@ public:
   /// Check if any member of the archive contains an Atom with the
   /// specified name and return the File object for that member, or nullptr.
   File *find(StringRef name) override {
-    auto member = _symbolMemberMap.find(name);
-    if (member == _symbolMemberMap.end())
+    Archive::Child c(nullptr, nullptr, nullptr);
+    const char *memberStart;
+    if (!findMember(name, c, memberStart))
       return nullptr;
-    Archive::Child c = member->second;
 
     // Don't return a member already returned
-    Expected<StringRef> buf = c.getBuffer();
-    if (!buf) {
-      // TODO: Actually report errors helpfully.
-      consumeError(buf.takeError());
-      return nullptr;
-    }
-    const char *memberStart = buf->data();
     if (_membersInstantiated.count(memberStart))
       return nullptr;
     _membersInstantiated.insert(memberStart);
 
+    // Use the file parsed by prefetch() if there is one. A member that
+    // failed to parse there is parsed again here to get the error.
     std::unique_ptr<File> result;
-    if (instantiateMember(c, result))
+    auto pre = _membersPrefetched.find(memberStart);
+    if (pre != _membersPrefetched.end()) {
+      result = std::move(pre->second);
+      _membersPrefetched.erase(pre);
+    }
+    if (!result && instantiateMember(c, result))
       return nullptr;
+    logMember(c);
 
     File *file = result.get();
     _filesReturned.push_back(std::move(result));
@@ -76,6 +79,36 @@ public:
     return file;
   }
 
+  /// Parse the members defining the given names in parallel, so that find()
+  /// only has to hand them out.
+  void prefetch(ArrayRef<StringRef> names) override {
+    std::vector<Archive::Child> members;
+    std::vector<const char *> starts;
+    for (StringRef name : names) {
+      Archive::Child c(nullptr, nullptr, nullptr);
+      const char *memberStart;
+      if (!findMember(name, c, memberStart))
+        continue;
+      if (_membersInstantiated.count(memberStart) ||
+          !_membersPrefetched.insert({memberStart, nullptr}).second)
+        continue;
+      members.push_back(c);
+      starts.push_back(memberStart);
+    }
+
+    std::vector<std::unique_ptr<File>> files(members.size());
+    parallelForEachN(0, members.size(), [&](size_t i) {
+      if (instantiateMember(members[i], files[i]))
+        files[i].reset();
+    });
+    for (size_t i = 0, e = files.size(); i < e; ++i) {
+      if (files[i])
+        _membersPrefetched[starts[i]] = std::move(files[i]);
+      else
+        _membersPrefetched.erase(starts[i]);
+    }
+  }
+
   /// parse each member
   std::error_code
   parseAllMembers(std::vector<std::unique_ptr<File>> &result) override {
@@ -91,6 +124,7 @@ public:
         consumeError(std::move(err));
         return ec;
       }
+      logMember(*mf);
       result.push_back(std::move(file));
     }
     if (err)
@@ -135,18 +169,49 @@ protected:
   }
 
 private:
+  /// Look up the member defining \p name. Returns false if there is none or
+  /// its contents cannot be read.
+  bool findMember(StringRef name, Archive::Child &member,
+                  const char *&memberStart) const {
+    auto it = _symbolMemberMap.find(name);
+    if (it == _symbolMemberMap.end())
+      return false;
+    Expected<Archive::Child> memberOrErr = it->second.getMember();
+    if (!memberOrErr) {
+      // TODO: Actually report errors helpfully.
+      consumeError(memberOrErr.takeError());
+      return false;
+    }
+    Expected<StringRef> buf = memberOrErr->getBuffer();
+    if (!buf) {
+      consumeError(buf.takeError());
+      return false;
+    }
+    member = *memberOrErr;
+    memberStart = buf->data();
+    return true;
+  }
+
+  /// Print the path of a loaded member if requested. This is kept out of
+  /// instantiateMember() so that prefetching does not log members which end
+  /// up unused, and the output stays in resolution order.
+  void logMember(const Archive::Child &member) const {
+    if (!_logLoading)
+      return;
+    Expected<StringRef> nameOrErr = member.getName();
+    if (!nameOrErr) {
+      consumeError(nameOrErr.takeError());
+      return;
+    }
+    llvm::errs() << _archive->getFileName() << "(" << *nameOrErr << ")\n";
+  }
+
   std::error_code instantiateMember(Archive::Child member,
                                     std::unique_ptr<File> &result) const {
     Expected<llvm::MemoryBufferRef> mbOrErr = member.getMemoryBufferRef();
     if (!mbOrErr)
       return errorToErrorCode(mbOrErr.takeError());
     llvm::MemoryBufferRef mb = mbOrErr.get();
-    std::string memberPath = (_archive->getFileName() + "("
-                           + mb.getBufferIdentifier() + ")").str();
-
-    if (_logLoading)
-      llvm::errs() << memberPath << "\n";
-
     std::unique_ptr<MemoryBuffer> memberMB(MemoryBuffer::getMemBuffer(
         mb.getBuffer(), mb.getBufferIdentifier(), false));
 
@@ -169,30 +234,27 @@ private:
     DEBUG_WITH_TYPE("FileArchive", llvm::dbgs()
                                        << "Table of contents for archive '"
                                        << _archive->getFileName() << "':\n");
+    // The archive's symbol table already is an index of the members, so only
+    // the names are read here. The member headers are not decoded until a
+    // symbol is looked up.
     for (const Archive::Symbol &sym : _archive->symbols()) {
       StringRef name = sym.getName();
-      Expected<Archive::Child> memberOrErr = sym.getMember();
-      if (!memberOrErr)
-        return errorToErrorCode(memberOrErr.takeError());
-      Archive::Child member = memberOrErr.get();
-      DEBUG_WITH_TYPE("FileArchive",
-                      llvm::dbgs()
-                          << llvm::format("0x%08llX ",
-                                          member.getBuffer()->data())
-                          << "'" << name << "'\n");
-      _symbolMemberMap.insert(std::make_pair(name, member));
+      DEBUG_WITH_TYPE("FileArchive", llvm::dbgs() << "'" << name << "'\n");
+      _symbolMemberMap.insert(std::make_pair(name, sym));
     }
     return std::error_code();
   }
 
-  typedef std::unordered_map<StringRef, Archive::Child> MemberMap;
+  typedef std::unordered_map<StringRef, Archive::Symbol> MemberMap;
   typedef std::set<const char *> InstantiatedSet;
+  typedef llvm::DenseMap<const char *, std::unique_ptr<File>> PrefetchedMap;
 
   std::shared_ptr<MemoryBuffer> _mb;
   const Registry &_registry;
   std::unique_ptr<Archive> _archive;
   MemberMap _symbolMemberMap;
   InstantiatedSet _membersInstantiated;
+  PrefetchedMap _membersPrefetched;
   bool _logLoading;
   std::vector<std::unique_ptr<MemoryBuffer>> _memberBuffers;
   std::vector<std::unique_ptr<File>> _filesReturned;
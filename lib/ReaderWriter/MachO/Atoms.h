@@ -31,7 +31,12 @@ public:
                    const ArrayRef<uint8_t> content, Alignment align)
       : SimpleDefinedAtom(f), _name(name), _content(content),
         _align(align), _contentType(type), _scope(scope), _merge(merge),
-        _thumb(thumb), _noDeadStrip(noDeadStrip) {}
+        _thumb(thumb), _noDeadStrip(noDeadStrip) {
+    // Literals are hashed here, while the file is parsed, so that the
+    // resolver does not need to hash them again when it coalesces them.
+    if (merge == mergeByContent)
+      _contentHash = hashContent(content.size(), type, content);
+  }
 
   // Constructor for zero-fill content
   MachODefinedAtom(const File &f, const StringRef name, Scope scope,
@@ -71,8 +76,17 @@ public:
     return _content;
   }
 
+  unsigned contentHash() const override {
+    if (_merge == mergeByContent)
+      return _contentHash;
+    return DefinedAtom::contentHash();
+  }
+
   bool isThumb() const { return _thumb; }
 
+protected:
+  llvm::BumpPtrAllocator &referenceAllocator() const override;
+
 private:
   const StringRef _name;
   const ArrayRef<uint8_t> _content;
@@ -82,6 +96,7 @@ private:
   const Merge _merge;
   const bool _thumb;
   const bool _noDeadStrip;
+  unsigned _contentHash = 0;
 };
 
 class MachODefinedCustomSectionAtom : public MachODefinedAtom {
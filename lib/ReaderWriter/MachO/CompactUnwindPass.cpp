@@ -17,11 +17,13 @@
 #include "MachONormalizedFileBinaryUtils.h"
 #include "MachOPasses.h"
 #include "lld/Common/LLVM.h"
+#include "lld/Common/Threads.h"
 #include "lld/Core/DefinedAtom.h"
 #include "lld/Core/File.h"
 #include "lld/Core/Reference.h"
 #include "lld/Core/Simple.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Format.h"
 
@@ -205,19 +207,38 @@ public:
     }
   }
 
+  /// Add the regular second level pages. Their contents are encoded in
+  /// parallel, and then their references are added in order.
   void addSecondLevelPages(std::vector<UnwindInfoPage> &pages) {
-    for (auto &page : pages) {
-      addRegularSecondLevelPage(page);
+    const uint32_t headerSize = sizeof(uint32_t) + 2 * sizeof(uint16_t);
+    std::vector<uint32_t> pageOffsets;
+    pageOffsets.reserve(pages.size());
+    uint32_t offset = _contents.size();
+    for (const UnwindInfoPage &page : pages) {
+      pageOffsets.push_back(offset);
+      offset += headerSize + 2 * page.entries.size() * sizeof(uint32_t);
     }
-  }
+    _contents.resize(offset);
+
+    parallelForEachN(0, pages.size(), [&](size_t i) {
+      writeRegularSecondLevelPage(pages[i], pageOffsets[i], headerSize);
+    });
 
-  void addRegularSecondLevelPage(const UnwindInfoPage &page) {
-    uint32_t curPageOffset = _contents.size();
-    const int16_t headerSize = sizeof(uint32_t) + 2 * sizeof(uint16_t);
-    uint32_t curPageSize =
-        headerSize + 2 * page.entries.size() * sizeof(uint32_t);
-    _contents.resize(curPageOffset + curPageSize);
+    for (size_t i = 0, e = pages.size(); i != e; ++i) {
+      uint32_t pagePos = pageOffsets[i] + headerSize;
+      for (const CompactUnwindEntry &entry : pages[i].entries) {
+        addImageReference(pagePos, entry.rangeStart);
+        if ((entry.encoding & 0x0f000000U) ==
+            _archHandler.dwarfCompactUnwindType())
+          addEhFrameReference(pagePos + sizeof(uint32_t), entry.ehFrame);
+        pagePos += 2 * sizeof(uint32_t);
+      }
+    }
+  }
 
+  void writeRegularSecondLevelPage(const UnwindInfoPage &page,
+                                   uint32_t curPageOffset,
+                                   uint32_t headerSize) {
     using normalized::write32;
     using normalized::write16;
     // 2 => regular page
@@ -227,15 +248,9 @@ public:
     write16(&_contents[curPageOffset + 6], page.entries.size(), _isBig);
 
     uint32_t pagePos = curPageOffset + headerSize;
-    for (auto &entry : page.entries) {
-      addImageReference(pagePos, entry.rangeStart);
-
+    for (const CompactUnwindEntry &entry : page.entries) {
       write32(_contents.data() + pagePos + sizeof(uint32_t), entry.encoding,
               _isBig);
-      if ((entry.encoding & 0x0f000000U) ==
-          _archHandler.dwarfCompactUnwindType())
-        addEhFrameReference(pagePos + sizeof(uint32_t), entry.ehFrame);
-
       pagePos += 2 * sizeof(uint32_t);
     }
   }
@@ -283,8 +298,8 @@ private:
   llvm::Error perform(SimpleFile &mergedFile) override {
     LLVM_DEBUG(llvm::dbgs() << "MachO Compact Unwind pass\n");
 
-    std::map<const Atom *, CompactUnwindEntry> unwindLocs;
-    std::map<const Atom *, const Atom *> dwarfFrames;
+    UnwindLocs unwindLocs;
+    DwarfFrames dwarfFrames;
     std::vector<const Atom *> personalities;
     uint32_t numLSDAs = 0;
 
@@ -357,17 +372,28 @@ private:
     return llvm::Error::success();
   }
 
-  void collectCompactUnwindEntries(
-      const SimpleFile &mergedFile,
-      std::map<const Atom *, CompactUnwindEntry> &unwindLocs,
-      std::vector<const Atom *> &personalities, uint32_t &numLSDAs) {
+  typedef llvm::DenseMap<const Atom *, CompactUnwindEntry> UnwindLocs;
+  typedef llvm::DenseMap<const Atom *, const Atom *> DwarfFrames;
+
+  void collectCompactUnwindEntries(const SimpleFile &mergedFile,
+                                   UnwindLocs &unwindLocs,
+                                   std::vector<const Atom *> &personalities,
+                                   uint32_t &numLSDAs) {
     LLVM_DEBUG(llvm::dbgs() << "  Collecting __compact_unwind entries\n");
 
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      if (atom->contentType() != DefinedAtom::typeCompactUnwindInfo)
-        continue;
+    std::vector<const DefinedAtom *> unwindAtoms;
+    for (const DefinedAtom *atom : mergedFile.defined())
+      if (atom->contentType() == DefinedAtom::typeCompactUnwindInfo)
+        unwindAtoms.push_back(atom);
+
+    // Decode the entries in parallel, then record them in order.
+    std::vector<CompactUnwindEntry> unwindEntries(unwindAtoms.size());
+    parallelForEachN(0, unwindAtoms.size(), [&](size_t i) {
+      unwindEntries[i] = extractCompactUnwindEntry(unwindAtoms[i]);
+    });
 
-      auto unwindEntry = extractCompactUnwindEntry(atom);
+    unwindLocs.reserve(unwindEntries.size());
+    for (const CompactUnwindEntry &unwindEntry : unwindEntries) {
       unwindLocs.insert(std::make_pair(unwindEntry.rangeStart, unwindEntry));
 
       LLVM_DEBUG(llvm::dbgs() << "    Entry for "
@@ -426,18 +452,24 @@ private:
     return entry;
   }
 
-  void
-  collectDwarfFrameEntries(const SimpleFile &mergedFile,
-                           std::map<const Atom *, const Atom *> &dwarfFrames) {
-    for (const DefinedAtom *ehFrameAtom : mergedFile.defined()) {
-      if (ehFrameAtom->contentType() != DefinedAtom::typeCFI)
-        continue;
-      if (ArchHandler::isDwarfCIE(_isBig, ehFrameAtom))
-        continue;
+  void collectDwarfFrameEntries(const SimpleFile &mergedFile,
+                                DwarfFrames &dwarfFrames) {
+    std::vector<const DefinedAtom *> ehFrameAtoms;
+    for (const DefinedAtom *atom : mergedFile.defined())
+      if (atom->contentType() == DefinedAtom::typeCFI)
+        ehFrameAtoms.push_back(atom);
+
+    // Find the functions of the FDEs in parallel. If there are several FDEs
+    // for a function, the last one wins.
+    std::vector<const Atom *> functions(ehFrameAtoms.size());
+    parallelForEachN(0, ehFrameAtoms.size(), [&](size_t i) {
+      if (!ArchHandler::isDwarfCIE(_isBig, ehFrameAtoms[i]))
+        functions[i] = _archHandler.fdeTargetFunction(ehFrameAtoms[i]);
+    });
 
-      if (const Atom *function = _archHandler.fdeTargetFunction(ehFrameAtom))
-        dwarfFrames[function] = ehFrameAtom;
-    }
+    for (size_t i = 0, e = ehFrameAtoms.size(); i != e; ++i)
+      if (functions[i])
+        dwarfFrames[functions[i]] = ehFrameAtoms[i];
   }
 
   /// Every atom defined in __TEXT,__text needs an entry in the final
@@ -447,28 +479,31 @@ private:
   ///   + A synthesised reference to __eh_frame if there's no __compact_unwind
   ///     or too many personality functions to be accommodated.
   std::vector<CompactUnwindEntry> createUnwindInfoEntries(
-      const SimpleFile &mergedFile,
-      const std::map<const Atom *, CompactUnwindEntry> &unwindLocs,
+      const SimpleFile &mergedFile, const UnwindLocs &unwindLocs,
       const std::vector<const Atom *> &personalities,
-      const std::map<const Atom *, const Atom *> &dwarfFrames) {
-    std::vector<CompactUnwindEntry> unwindInfos;
-
+      const DwarfFrames &dwarfFrames) {
     LLVM_DEBUG(llvm::dbgs() << "  Creating __unwind_info entries\n");
     // The final order in the __unwind_info section must be derived from the
     // order of typeCode atoms, since that's how they'll be put into the object
     // file eventually (yuck!).
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      if (atom->contentType() != DefinedAtom::typeCode)
-        continue;
-
-      unwindInfos.push_back(finalizeUnwindInfoEntryForAtom(
-          atom, unwindLocs, personalities, dwarfFrames));
+    std::vector<const DefinedAtom *> functions;
+    for (const DefinedAtom *atom : mergedFile.defined())
+      if (atom->contentType() == DefinedAtom::typeCode)
+        functions.push_back(atom);
+
+    std::vector<CompactUnwindEntry> unwindInfos(functions.size());
+    parallelForEachN(0, functions.size(), [&](size_t i) {
+      unwindInfos[i] = finalizeUnwindInfoEntryForAtom(
+          functions[i], unwindLocs, personalities, dwarfFrames);
+    });
 
-      LLVM_DEBUG(llvm::dbgs()
-                 << "    Entry for " << atom->name() << ", final encoding="
-                 << llvm::format("0x%08x", unwindInfos.back().encoding)
-                 << '\n');
-    }
+    LLVM_DEBUG({
+      for (size_t i = 0, e = functions.size(); i != e; ++i)
+        llvm::dbgs() << "    Entry for " << functions[i]->name()
+                     << ", final encoding="
+                     << llvm::format("0x%08x", unwindInfos[i].encoding)
+                     << '\n';
+    });
 
     return unwindInfos;
   }
@@ -477,11 +512,10 @@ private:
   ///
   /// An EH frame is considered unused if there is a corresponding compact
   /// unwind atom that doesn't require the EH frame.
-  void pruneUnusedEHFrames(
-                   SimpleFile &mergedFile,
-                   const std::vector<CompactUnwindEntry> &unwindInfos,
-                   const std::map<const Atom *, CompactUnwindEntry> &unwindLocs,
-                   const std::map<const Atom *, const Atom *> &dwarfFrames) {
+  void pruneUnusedEHFrames(SimpleFile &mergedFile,
+                           const std::vector<CompactUnwindEntry> &unwindInfos,
+                           const UnwindLocs &unwindLocs,
+                           const DwarfFrames &dwarfFrames) {
 
     // Worklist of all 'used' FDEs.
     std::vector<const DefinedAtom *> usedDwarfWorklist;
@@ -499,11 +533,12 @@ private:
         usedDwarfWorklist.push_back(cast<DefinedAtom>(entry.second));
 
     // Add all transitively referenced CFI atoms by processing the worklist.
-    std::set<const Atom *> usedDwarfFrames;
+    llvm::DenseSet<const Atom *> usedDwarfFrames;
     while (!usedDwarfWorklist.empty()) {
       const DefinedAtom *cfiAtom = usedDwarfWorklist.back();
       usedDwarfWorklist.pop_back();
-      usedDwarfFrames.insert(cfiAtom);
+      if (!usedDwarfFrames.insert(cfiAtom).second)
+        continue;
       for (const auto *ref : *cfiAtom) {
         const DefinedAtom *cfiTarget = dyn_cast<DefinedAtom>(ref->target());
         if (cfiTarget->contentType() == DefinedAtom::typeCFI)
@@ -521,10 +556,9 @@ private:
   }
 
   CompactUnwindEntry finalizeUnwindInfoEntryForAtom(
-      const DefinedAtom *function,
-      const std::map<const Atom *, CompactUnwindEntry> &unwindLocs,
+      const DefinedAtom *function, const UnwindLocs &unwindLocs,
       const std::vector<const Atom *> &personalities,
-      const std::map<const Atom *, const Atom *> &dwarfFrames) {
+      const DwarfFrames &dwarfFrames) {
     auto unwindLoc = unwindLocs.find(function);
 
     CompactUnwindEntry entry;
@@ -237,6 +237,23 @@ public:
   DebugInfo* debugInfo() const { return _debugInfo.get(); }
   std::unique_ptr<DebugInfo> takeDebugInfo() { return std::move(_debugInfo); }
 
+  /// Returns the allocator for the references of the atoms of this file.
+  /// While the file is parsed, references are allocated on the side, and
+  /// packReferences() then moves them into the file's allocator.
+  llvm::BumpPtrAllocator &referenceAllocator() const {
+    return _referencesPacked ? allocator() : _parseAllocator;
+  }
+
+  /// Moves the references of each atom into one contiguous array, once all
+  /// of them have been added and sorted.
+  void packReferences() {
+    for (const DefinedAtom *atom : defined())
+      static_cast<const SimpleDefinedAtom *>(atom)->packReferences(
+          allocator());
+    _parseAllocator.Reset();
+    _referencesPacked = true;
+  }
+
 protected:
   std::error_code doParse() override {
     // Convert binary file to normalized mach-o.
@@ -278,6 +295,8 @@ private:
   uint32_t                       _swiftVersion = 0;
   normalized::FileFlags        _flags = llvm::MachO::MH_SUBSECTIONS_VIA_SYMBOLS;
   std::unique_ptr<DebugInfo>   _debugInfo;
+  mutable llvm::BumpPtrAllocator _parseAllocator;
+  bool                         _referencesPacked = false;
 };
 
 class MachODylibFile : public SharedLibraryFile {
@@ -90,34 +90,32 @@ private:
 ///
 class GOTPass : public Pass {
 public:
-  GOTPass(const MachOLinkingContext &context)
-      : _ctx(context), _archHandler(_ctx.archHandler()),
+  GOTPass(const MachOLinkingContext &context, const ReferenceUses &uses)
+      : _ctx(context), _archHandler(_ctx.archHandler()), _uses(uses),
         _file(*_ctx.make_file<MachOFile>("<mach-o GOT Pass>")) {
     _file.setOrdinal(_ctx.getNextOrdinalAndIncrement());
   }
 
 private:
   llvm::Error perform(SimpleFile &mergedFile) override {
-    // Scan all references in all atoms.
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      for (const Reference *ref : *atom) {
-        // Look at instructions accessing the GOT.
-        bool canBypassGOT;
-        if (!_archHandler.isGOTAccess(*ref, canBypassGOT))
-          continue;
-        const Atom *target = ref->target();
-        assert(target != nullptr);
-
-        if (!shouldReplaceTargetWithGOTAtom(target, canBypassGOT)) {
-          // Update reference kind to reflect that target is a direct accesss.
-          _archHandler.updateReferenceToGOT(ref, false);
-        } else {
-          // Replace the target with a reference to a GOT entry.
-          const DefinedAtom *gotEntry = makeGOTEntry(target);
-          const_cast<Reference *>(ref)->setTarget(gotEntry);
-          // Update reference kind to reflect that target is now a GOT entry.
-          _archHandler.updateReferenceToGOT(ref, true);
-        }
+    // Look at all instructions accessing the GOT.
+    for (const AtomReference &use : _uses.gotAccesses) {
+      const Reference *ref = use.second;
+      bool canBypassGOT;
+      // This is a GOT access; only canBypassGOT is not known yet.
+      _archHandler.isGOTAccess(*ref, canBypassGOT);
+      const Atom *target = ref->target();
+      assert(target != nullptr);
+
+      if (!shouldReplaceTargetWithGOTAtom(target, canBypassGOT)) {
+        // Update reference kind to reflect that target is a direct accesss.
+        _archHandler.updateReferenceToGOT(ref, false);
+      } else {
+        // Replace the target with a reference to a GOT entry.
+        const DefinedAtom *gotEntry = makeGOTEntry(target);
+        const_cast<Reference *>(ref)->setTarget(gotEntry);
+        // Update reference kind to reflect that target is now a GOT entry.
+        _archHandler.updateReferenceToGOT(ref, true);
       }
     }
 
@@ -170,13 +168,15 @@ private:
 
   const MachOLinkingContext &_ctx;
   mach_o::ArchHandler                             &_archHandler;
+  const ReferenceUses                             &_uses;
   MachOFile                                       &_file;
   llvm::DenseMap<const Atom*, const GOTEntryAtom*> _targetToGOT;
 };
 
-void addGOTPass(PassManager &pm, const MachOLinkingContext &ctx) {
+void addGOTPass(PassManager &pm, const MachOLinkingContext &ctx,
+                const ReferenceUses &uses) {
   assert(ctx.needsGOTPass());
-  pm.add(std::make_unique<GOTPass>(ctx));
+  pm.add(std::make_unique<GOTPass>(ctx, uses));
 }
 
 } // end namesapce mach_o
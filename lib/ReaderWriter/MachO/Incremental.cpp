@@ -0,0 +1,1041 @@
+//===- lib/ReaderWriter/MachO/Incremental.cpp -----------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements -incremental.
+//
+// In a typical edit-compile-link cycle only a few object files change between
+// two links, and usually only the code of their functions changes. With
+// -incremental, a full link writes <output>.incremental, which records for
+// each object file where its atoms ended up in the output and what their
+// references resolved to after the passes, and leaves some room after each
+// function so that it can grow. The next link with the same command line
+// compares the inputs against the state file, and if only object files
+// changed, and only in the code of their functions, copies the new code over
+// the old one and applies its fixups.
+//
+// Since no atom moves, the symbol table, the export trie, the function starts
+// and the stubs and GOT entries of the output stay valid. The rebase and bind
+// information and the data-in-code table stay valid as long as the pointers
+// and data-in-code markers of the patched functions stay the same, which is
+// checked.
+//
+// Anything else makes the linker fall back to a full link, which writes a new
+// state file. This includes added or removed atoms and symbols, changes to
+// anything but code, functions that outgrow their room, and references that
+// need a stub, a GOT entry or a target that the previous link did not have.
+// The output of an incremental link is not the same as that of a full link;
+// it is only equivalent to it.
+//
+// Only x86_64 images are supported.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Incremental.h"
+#include "ArchHandler.h"
+#include "File.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
+#include "lld/Core/DefinedAtom.h"
+#include "lld/Core/Simple.h"
+#include "lld/ReaderWriter/MachOLinkingContext.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/BinaryFormat/MachO.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <map>
+#include <set>
+
+using namespace llvm::support::endian;
+using llvm::xxHash64;
+
+namespace lld {
+namespace mach_o {
+
+// A segment of the output, which maps addresses to file offsets.
+struct OutputSegment {
+  uint64_t address;
+  uint64_t fileOff;
+  uint64_t fileSize;
+};
+
+namespace {
+const char stateMagic[] = "LLDMACHOINCR1";
+
+// The state file is a sequence of little-endian integers and length-prefixed
+// strings.
+class StateWriter {
+public:
+  void u8(uint8_t v) { buf.push_back(v); }
+
+  void u32(uint32_t v) {
+    char b[4];
+    write32le(b, v);
+    buf.append(b, 4);
+  }
+
+  void u64(uint64_t v) {
+    char b[8];
+    write64le(b, v);
+    buf.append(b, 8);
+  }
+
+  void str(StringRef s) {
+    u64(s.size());
+    buf.append(s.begin(), s.end());
+  }
+
+  std::string buf;
+};
+
+// Reads what StateWriter wrote. Reading past the end returns zeros and makes
+// ok() return false.
+class StateReader {
+public:
+  explicit StateReader(StringRef data) : data(data) {}
+
+  uint8_t u8() {
+    const uint8_t *p = take(1);
+    return p ? *p : 0;
+  }
+
+  uint32_t u32() {
+    const uint8_t *p = take(4);
+    return p ? read32le(p) : 0;
+  }
+
+  uint64_t u64() {
+    const uint8_t *p = take(8);
+    return p ? read64le(p) : 0;
+  }
+
+  StringRef str() {
+    uint64_t size = u64();
+    const uint8_t *p = take(size);
+    return p ? StringRef(reinterpret_cast<const char *>(p), size) : "";
+  }
+
+  bool ok() const { return !failed; }
+  bool atEnd() const { return pos == data.size(); }
+
+private:
+  const uint8_t *take(uint64_t size) {
+    if (failed || size > data.size() - pos) {
+      failed = true;
+      return nullptr;
+    }
+    pos += size;
+    return reinterpret_cast<const uint8_t *>(data.data()) + pos - size;
+  }
+
+  StringRef data;
+  size_t pos = 0;
+  bool failed = false;
+};
+
+// How an atom of an object file is handled when the file changes.
+enum AtomKind : uint8_t {
+  // Not part of the output, like dead-stripped and coalesced-away atoms.
+  Ignored,
+  // Must not change.
+  Fixed,
+  // A function, which may change and grow up to its capacity.
+  Patch,
+};
+
+struct AtomState {
+  AtomKind kind = Ignored;
+  // For Fixed atoms, the hash of the contents and the references. For Patch
+  // atoms, the hash of the references that must not change.
+  uint64_t hash = 0;
+
+  // For Patch atoms.
+  uint64_t address = 0;
+  uint64_t fileOff = 0;
+  uint64_t size = 0;
+  uint64_t capacity = 0;
+};
+
+// What the references of a given kind from an object file to a target ended
+// up as after the passes, which may have redirected them to a stub or a GOT
+// entry and changed their kind.
+struct Resolution {
+  std::string targetKey;
+  Reference::KindValue kind = 0;
+  Reference::KindValue finalKind = 0;
+  uint64_t address = 0;
+  uint64_t sectionAddress = 0;
+};
+
+// The state of a patchable object file.
+struct FileState {
+  void write(StateWriter &w) const;
+  bool read(StringRef data);
+
+  uint64_t fingerprint = 0;
+  std::vector<AtomState> atoms;
+  std::vector<Resolution> resolutions;
+};
+
+// An input file of the link.
+struct InputState {
+  std::string path;
+  uint64_t size = 0;
+  uint64_t mtime = 0;
+  uint64_t hash = 0;
+  // The serialized FileState, or empty if the file is not patchable.
+  std::string block;
+};
+
+struct StateHeader {
+  uint64_t argsHash = 0;
+  uint64_t outputSize = 0;
+  uint64_t outputTime = 0;
+  // The address of the last function, whose size ends the range that
+  // __unwind_info covers, or UINT64_MAX if there is no __unwind_info.
+  uint64_t unwindEndAddress = UINT64_MAX;
+};
+
+// Used to create the atoms that fixups are applied with.
+class PatchAtom : public SimpleDefinedAtom {
+public:
+  PatchAtom(const File &f, const DefinedAtom &atom)
+      : SimpleDefinedAtom(f), _atom(atom) {}
+
+  uint64_t size() const override { return _atom.size(); }
+  ContentType contentType() const override { return _atom.contentType(); }
+  ArrayRef<uint8_t> rawContent() const override { return _atom.rawContent(); }
+
+private:
+  const DefinedAtom &_atom;
+};
+
+class TargetAtom : public SimpleDefinedAtom {
+public:
+  explicit TargetAtom(const File &f) : SimpleDefinedAtom(f) {}
+
+  uint64_t size() const override { return 0; }
+  ContentType contentType() const override { return typeUnknown; }
+  ArrayRef<uint8_t> rawContent() const override { return {}; }
+};
+} // namespace
+
+void FileState::write(StateWriter &w) const {
+  w.u64(fingerprint);
+  w.u64(atoms.size());
+  for (const AtomState &s : atoms) {
+    w.u8(s.kind);
+    switch (s.kind) {
+    case Ignored:
+      break;
+    case Fixed:
+      w.u64(s.hash);
+      break;
+    case Patch:
+      w.u64(s.hash);
+      w.u64(s.address);
+      w.u64(s.fileOff);
+      w.u64(s.size);
+      w.u64(s.capacity);
+      break;
+    }
+  }
+
+  w.u64(resolutions.size());
+  for (const Resolution &r : resolutions) {
+    w.str(r.targetKey);
+    w.u32(r.kind);
+    w.u32(r.finalKind);
+    w.u64(r.address);
+    w.u64(r.sectionAddress);
+  }
+}
+
+bool FileState::read(StringRef data) {
+  StateReader r(data);
+  fingerprint = r.u64();
+  atoms.resize(std::min<uint64_t>(r.u64(), data.size()));
+  for (AtomState &s : atoms) {
+    s.kind = AtomKind(r.u8());
+    switch (s.kind) {
+    case Ignored:
+      break;
+    case Fixed:
+      s.hash = r.u64();
+      break;
+    case Patch:
+      s.hash = r.u64();
+      s.address = r.u64();
+      s.fileOff = r.u64();
+      s.size = r.u64();
+      s.capacity = r.u64();
+      break;
+    default:
+      return false;
+    }
+    if (!r.ok())
+      return false;
+  }
+
+  resolutions.resize(std::min<uint64_t>(r.u64(), data.size()));
+  for (Resolution &res : resolutions) {
+    res.targetKey = r.str();
+    res.kind = r.u32();
+    res.finalKind = r.u32();
+    res.address = r.u64();
+    res.sectionAddress = r.u64();
+  }
+  return r.ok() && r.atEnd();
+}
+
+typedef llvm::DenseMap<const Atom *, uint32_t> AtomIndices;
+
+// Returns a name for the target of a reference that stays the same when the
+// file is parsed again, or an empty string if there is none. Literals are
+// named by their contents, global atoms by their names, and the other atoms
+// of the same file by their index.
+static std::string getTargetKey(const Atom *target,
+                                const AtomIndices &indices) {
+  if (auto *d = dyn_cast<DefinedAtom>(target)) {
+    if (d->merge() == DefinedAtom::mergeByContent) {
+      // Atoms like CFStrings are merged by their references too.
+      if (d->begin() != d->end())
+        return "";
+      return "=" + llvm::utostr(d->contentType()) + ":" +
+             llvm::toHex(d->rawContent());
+    }
+    if (d->scope() == DefinedAtom::scopeTranslationUnit ||
+        d->name().empty()) {
+      auto it = indices.find(target);
+      return it == indices.end() ? "" : "#" + llvm::utostr(it->second);
+    }
+  }
+  if (target->name().empty())
+    return "";
+  return ("$" + target->name()).str();
+}
+
+static std::string getResolutionKey(StringRef targetKey,
+                                    Reference::KindValue kind) {
+  return (llvm::utostr(kind) + ":" + targetKey).str();
+}
+
+static std::string getAtomName(const DefinedAtom &atom) {
+  if (atom.name().empty())
+    return "an anonymous atom";
+  return atom.name().str();
+}
+
+static void addReference(StateWriter &w, const Reference &ref,
+                         StringRef targetKey) {
+  w.u64(ref.offsetInAtom());
+  w.u8(uint8_t(ref.kindNamespace()));
+  w.u8(uint8_t(ref.kindArch()));
+  w.u32(ref.kindValue());
+  w.str(targetKey);
+  w.u64(ref.addend());
+}
+
+// Returns true if a reference of a function must not change when the
+// function is patched: the rebase and bind information comes from pointers
+// and the data-in-code table from transitions, and the references that are
+// not fixups describe the layout.
+static bool isPinned(const Reference &ref, ArchHandler &handler) {
+  if (ref.kindNamespace() != Reference::KindNamespace::mach_o)
+    return true;
+  return handler.isPointer(ref) || handler.isLazyPointer(ref) ||
+         handler.isDataInCodeTransition(ref.kindValue());
+}
+
+static uint64_t getPinnedHash(const DefinedAtom &atom, ArchHandler &handler,
+                              const AtomIndices &indices) {
+  StateWriter w;
+  for (const Reference *ref : atom)
+    if (isPinned(*ref, handler))
+      addReference(w, *ref, getTargetKey(ref->target(), indices));
+  return xxHash64(w.buf);
+}
+
+static uint64_t getContentHash(const DefinedAtom &atom,
+                               const AtomIndices &indices) {
+  StateWriter w;
+  w.u32(atom.contentType());
+  w.u64(atom.size());
+  ArrayRef<uint8_t> content = atom.rawContent();
+  if (atom.contentType() == DefinedAtom::typeCompactUnwindInfo &&
+      content.size() >= 12) {
+    // The length of the function may change. The compact unwind pass only
+    // uses it for the last function, see patchAtom().
+    w.str(toStringRef(content.take_front(8)));
+    w.str(toStringRef(content.drop_front(12)));
+  } else {
+    w.str(toStringRef(content));
+  }
+  for (const Reference *ref : atom)
+    addReference(w, *ref, getTargetKey(ref->target(), indices));
+  return xxHash64(w.buf);
+}
+
+// Returns a hash of the parts of an object file that must stay the same for
+// the file to be patched. The sizes of the functions may change.
+static uint64_t getFingerprint(const MachOFile &file,
+                               ArrayRef<AtomState> atoms) {
+  StateWriter w;
+  w.u8(file.subsectionsViaSymbols());
+  w.u32(file.minVersion());
+  w.u32(file.minVersionLoadCommandKind());
+  w.u32(file.objcConstraint());
+  w.u32(file.swiftVersion());
+  w.u8(file.debugInfo() != nullptr);
+
+  size_t i = 0;
+  for (const DefinedAtom *atom : file.defined()) {
+    w.str(atom->name());
+    w.u8(atom->scope());
+    w.u8(atom->interposable());
+    w.u8(atom->merge());
+    w.u32(atom->contentType());
+    w.u64(atom->alignment().value);
+    w.u64(atom->alignment().modulus);
+    w.u8(atom->sectionChoice());
+    w.str(atom->customSectionName());
+    w.u8(atom->deadStrip());
+    w.u8(atom->dynamicExport());
+    w.u8(atom->codeModel());
+    w.u8(atom->permissions());
+    if (i >= atoms.size() || atoms[i].kind != Patch)
+      w.u64(atom->size());
+    ++i;
+  }
+  for (const UndefinedAtom *atom : file.undefined()) {
+    w.str(atom->name());
+    w.u8(atom->canBeNull());
+  }
+  for (const SharedLibraryAtom *atom : file.sharedLibrary()) {
+    w.str(atom->name());
+    w.str(atom->loadName());
+    w.u8(atom->canBeNullAtRuntime());
+  }
+  for (const AbsoluteAtom *atom : file.absolute()) {
+    w.str(atom->name());
+    w.u8(atom->scope());
+    w.u64(atom->value());
+  }
+  return xxHash64(w.buf);
+}
+
+static AtomIndices getAtomIndices(const File &file) {
+  AtomIndices indices;
+  uint32_t i = 0;
+  for (const DefinedAtom *atom : file.defined())
+    indices[atom] = i++;
+  return indices;
+}
+
+static bool getFileStatus(StringRef path, uint64_t &size, uint64_t &mtime) {
+  llvm::sys::fs::file_status st;
+  if (llvm::sys::fs::status(path, st))
+    return false;
+  size = st.getSize();
+  mtime = st.getLastModificationTime().time_since_epoch().count();
+  return true;
+}
+
+// Reads the segments of a Mach-O image, so that the addresses of atoms can be
+// mapped to offsets in it.
+static bool readSegments(StringRef path,
+                         std::vector<OutputSegment> &segments) {
+  auto mbOrErr = MemoryBuffer::getFile(path, -1, false);
+  if (!mbOrErr)
+    return false;
+  StringRef data = (*mbOrErr)->getBuffer();
+
+  llvm::MachO::mach_header_64 header;
+  if (data.size() < sizeof(header))
+    return false;
+  memcpy(&header, data.data(), sizeof(header));
+  if (llvm::sys::IsBigEndianHost)
+    llvm::MachO::swapStruct(header);
+  if (header.magic != llvm::MachO::MH_MAGIC_64)
+    return false;
+
+  uint64_t off = sizeof(header);
+  for (uint32_t i = 0; i != header.ncmds; ++i) {
+    llvm::MachO::load_command lc;
+    if (off + sizeof(lc) > data.size())
+      return false;
+    memcpy(&lc, data.data() + off, sizeof(lc));
+    if (llvm::sys::IsBigEndianHost)
+      llvm::MachO::swapStruct(lc);
+    if (lc.cmdsize < sizeof(lc) || off + lc.cmdsize > data.size())
+      return false;
+
+    if (lc.cmd == llvm::MachO::LC_SEGMENT_64) {
+      llvm::MachO::segment_command_64 seg;
+      if (lc.cmdsize < sizeof(seg))
+        return false;
+      memcpy(&seg, data.data() + off, sizeof(seg));
+      if (llvm::sys::IsBigEndianHost)
+        llvm::MachO::swapStruct(seg);
+      segments.push_back({seg.vmaddr, seg.fileoff, seg.filesize});
+    }
+    off += lc.cmdsize;
+  }
+  return true;
+}
+
+static uint64_t getFileOffset(ArrayRef<OutputSegment> segments,
+                              uint64_t address, uint64_t size) {
+  for (const OutputSegment &seg : segments)
+    if (address >= seg.address && address + size <= seg.address + seg.fileSize)
+      return seg.fileOff + address - seg.address;
+  return UINT64_MAX;
+}
+
+static bool readStateFile(MemoryBufferRef mb, StateHeader &hdr,
+                          std::vector<InputState> &inputs) {
+  StateReader r(mb.getBuffer());
+  if (r.str() != stateMagic)
+    return false;
+  hdr.argsHash = r.u64();
+  hdr.outputSize = r.u64();
+  hdr.outputTime = r.u64();
+  hdr.unwindEndAddress = r.u64();
+
+  inputs.resize(std::min<uint64_t>(r.u64(), mb.getBufferSize()));
+  for (InputState &in : inputs) {
+    in.path = r.str();
+    in.size = r.u64();
+    in.mtime = r.u64();
+    in.hash = r.u64();
+    in.block = r.str();
+  }
+  return r.ok() && r.atEnd();
+}
+
+static void writeStateFile(StringRef path, const StateHeader &hdr,
+                           ArrayRef<InputState> inputs) {
+  StateWriter w;
+  w.str(stateMagic);
+  w.u64(hdr.argsHash);
+  w.u64(hdr.outputSize);
+  w.u64(hdr.outputTime);
+  w.u64(hdr.unwindEndAddress);
+  w.u64(inputs.size());
+  for (const InputState &in : inputs) {
+    w.str(in.path);
+    w.u64(in.size);
+    w.u64(in.mtime);
+    w.u64(in.hash);
+    w.str(in.block);
+  }
+
+  // Write to a temporary file first so that a failed write does not leave a
+  // state file that does not match the output.
+  std::string tmp = (path + ".tmp").str();
+  {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(tmp, ec, llvm::sys::fs::OF_None);
+    if (ec) {
+      error("cannot open " + tmp + ": " + ec.message());
+      return;
+    }
+    os << w.buf;
+  }
+  if (std::error_code ec = llvm::sys::fs::rename(tmp, path))
+    error("cannot rename " + tmp + " to " + path + ": " + ec.message());
+}
+
+namespace {
+// Patches the previous output.
+class Relinker {
+public:
+  Relinker(MachOLinkingContext &ctx, uint64_t argsHash, StringRef statePath,
+           ArrayRef<std::string> currentInputs)
+      : ctx(ctx), handler(ctx.archHandler()), argsHash(argsHash),
+        statePath(statePath), currentInputs(currentInputs) {}
+
+  // Returns false with the reason set if a full link is needed.
+  bool run();
+
+  std::string reason;
+
+private:
+  bool fail(const Twine &msg) {
+    reason = msg.str();
+    return false;
+  }
+
+  bool findChangedInputs(std::vector<size_t> &changed);
+  bool patchFile(InputState &in);
+  bool patchAtom(StringRef path, const DefinedAtom &atom, AtomState &s,
+                 const AtomIndices &indices,
+                 const llvm::StringMap<const Resolution *> &resolutions);
+
+  MachOLinkingContext &ctx;
+  ArchHandler &handler;
+  uint64_t argsHash;
+  StringRef statePath;
+  ArrayRef<std::string> currentInputs;
+  StateHeader hdr;
+  std::vector<InputState> inputs;
+  uint8_t *out = nullptr;
+};
+} // namespace
+
+// Finds the inputs that changed since the previous link.
+bool Relinker::findChangedInputs(std::vector<size_t> &changed) {
+  llvm::StringSet<> known;
+  for (const InputState &in : inputs)
+    known.insert(in.path);
+  for (const std::string &path : currentInputs)
+    if (!known.count(path))
+      return fail(path + " is a new input");
+
+  for (size_t i = 0, e = inputs.size(); i != e; ++i) {
+    InputState &in = inputs[i];
+    uint64_t size, mtime;
+    if (!getFileStatus(in.path, size, mtime))
+      return fail("cannot stat " + in.path);
+    if (size == in.size && mtime == in.mtime)
+      continue;
+
+    auto mbOrErr = MemoryBuffer::getFile(in.path, -1, false);
+    if (!mbOrErr)
+      return fail("cannot read " + in.path);
+    in.size = size;
+    in.mtime = mtime;
+    uint64_t hash = xxHash64((*mbOrErr)->getBuffer());
+    if (hash == in.hash)
+      continue;
+    if (in.block.empty())
+      return fail(in.path + " changed and cannot be patched");
+    in.hash = hash;
+    changed.push_back(i);
+  }
+  return true;
+}
+
+bool Relinker::run() {
+  auto mbOrErr = MemoryBuffer::getFile(statePath, -1, false);
+  if (!mbOrErr)
+    return fail("no state from a previous link");
+  std::unique_ptr<MemoryBuffer> stateBuf = std::move(*mbOrErr);
+  if (!readStateFile(stateBuf->getMemBufferRef(), hdr, inputs))
+    return fail(statePath + " is corrupted");
+  if (hdr.argsHash != argsHash)
+    return fail("the command line changed");
+
+  StringRef output = ctx.outputPath();
+  uint64_t size, mtime;
+  if (!getFileStatus(output, size, mtime) || size != hdr.outputSize ||
+      mtime != hdr.outputTime)
+    return fail(output + " was changed by another program");
+
+  std::vector<size_t> changed;
+  if (!findChangedInputs(changed))
+    return false;
+
+  if (changed.empty()) {
+    // Touch the output so that build systems see that it is up to date.
+    int fd;
+    if (std::error_code ec = llvm::sys::fs::openFileForReadWrite(
+            output, fd, llvm::sys::fs::CD_OpenExisting,
+            llvm::sys::fs::OF_None))
+      return fail("cannot open " + output + ": " + ec.message());
+    std::error_code ec = llvm::sys::fs::setLastAccessAndModificationTime(
+        fd, std::chrono::system_clock::now());
+    llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+    if (ec)
+      return fail("cannot touch " + output + ": " + ec.message());
+    log("incremental: output is up to date");
+  } else {
+    auto oldOrErr = MemoryBuffer::getFile(output, -1, false);
+    if (!oldOrErr)
+      return fail("cannot read " + output);
+    if ((*oldOrErr)->getBufferSize() != hdr.outputSize)
+      return fail(output + " was changed by another program");
+
+    llvm::Expected<std::unique_ptr<llvm::FileOutputBuffer>> bufferOrErr =
+        llvm::FileOutputBuffer::create(output, hdr.outputSize,
+                                       llvm::FileOutputBuffer::F_executable);
+    if (!bufferOrErr) {
+      error("failed to open " + output + ": " +
+            llvm::toString(bufferOrErr.takeError()));
+      return true;
+    }
+    std::unique_ptr<llvm::FileOutputBuffer> buffer = std::move(*bufferOrErr);
+    out = buffer->getBufferStart();
+    memcpy(out, (*oldOrErr)->getBufferStart(), hdr.outputSize);
+
+    for (size_t i : changed)
+      if (!patchFile(inputs[i]))
+        return false;
+
+    if (llvm::Error e = buffer->commit()) {
+      error("failed to write to the output file: " + toString(std::move(e)));
+      return true;
+    }
+    for (size_t i : changed)
+      log("incremental: patched " + inputs[i].path);
+  }
+
+  if (!getFileStatus(output, hdr.outputSize, hdr.outputTime))
+    error("cannot stat " + output);
+  else
+    writeStateFile(statePath, hdr, inputs);
+  return true;
+}
+
+bool Relinker::patchFile(InputState &in) {
+  FileState state;
+  if (!state.read(in.block))
+    return fail(statePath + " is corrupted");
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+      ctx.getMemoryBuffer(in.path);
+  if (!mbOrErr)
+    return fail("cannot read " + in.path);
+  ErrorOr<std::unique_ptr<File>> fileOrErr =
+      ctx.registry().loadFile(std::move(*mbOrErr));
+  if (std::error_code ec = fileOrErr.getError())
+    return fail(in.path + ": " + ec.message());
+  std::unique_ptr<File> f = std::move(*fileOrErr);
+  if (std::error_code ec = f->parse())
+    return fail(in.path + ": " + ec.message());
+  auto *file = dyn_cast<MachOFile>(f.get());
+  if (!file)
+    return fail(in.path + " is no longer a Mach-O object file");
+  if (file->defined().size() != state.atoms.size() ||
+      getFingerprint(*file, state.atoms) != state.fingerprint)
+    return fail(in.path + ": the atoms or symbols changed");
+
+  AtomIndices indices = getAtomIndices(*file);
+  llvm::StringMap<const Resolution *> resolutions;
+  for (const Resolution &r : state.resolutions)
+    resolutions[getResolutionKey(r.targetKey, r.kind)] = &r;
+
+  size_t i = 0;
+  for (const DefinedAtom *atom : file->defined()) {
+    AtomState &s = state.atoms[i++];
+    if (s.kind == Fixed && getContentHash(*atom, indices) != s.hash)
+      return fail(in.path + ": " + getAtomName(*atom) + " changed");
+    if (s.kind == Patch &&
+        !patchAtom(in.path, *atom, s, indices, resolutions))
+      return false;
+  }
+
+  StateWriter w;
+  state.write(w);
+  in.block = std::move(w.buf);
+  return true;
+}
+
+bool Relinker::patchAtom(
+    StringRef path, const DefinedAtom &atom, AtomState &s,
+    const AtomIndices &indices,
+    const llvm::StringMap<const Resolution *> &resolutions) {
+  std::string name = getAtomName(atom);
+  uint64_t size = atom.size();
+  if (s.fileOff + s.capacity > hdr.outputSize)
+    return fail(statePath + " is corrupted");
+  if (size > s.capacity)
+    return fail(path + ": " + name + " grew too much");
+  if (size != s.size && s.address == hdr.unwindEndAddress)
+    return fail(path + ": " + name +
+                " ends the range of __unwind_info and changed its size");
+  if (getPinnedHash(atom, handler, indices) != s.hash)
+    return fail(path + ": the pointers or data-in-code markers of " + name +
+                " changed");
+
+  // Rebuild the function with its references pointing where the passes
+  // pointed them in the previous link, and let the ArchHandler apply the
+  // fixups. The references that are not fixups do not affect the contents.
+  SimpleFile scratch(path, File::kindMachObject);
+  auto *patched = new (scratch.allocator()) PatchAtom(scratch, atom);
+  llvm::DenseMap<const Atom *, const Resolution *> targets;
+  for (const Reference *ref : atom) {
+    if (ref->kindNamespace() != Reference::KindNamespace::mach_o)
+      continue;
+    std::string key = getTargetKey(ref->target(), indices);
+    const Resolution *res = nullptr;
+    if (!key.empty())
+      res = resolutions.lookup(getResolutionKey(key, ref->kindValue()));
+    if (!res)
+      return fail(path + ": " + name + " has a reference that the previous "
+                  "link did not resolve");
+    auto *target = new (scratch.allocator()) TargetAtom(scratch);
+    targets[target] = res;
+    patched->addReference(Reference::KindNamespace::mach_o, ref->kindArch(),
+                          res->finalKind, ref->offsetInAtom(), target,
+                          ref->addend());
+  }
+
+  auto findAddress = [&](const Atom &a) -> uint64_t {
+    if (&a == patched)
+      return s.address;
+    return targets.lookup(&a)->address;
+  };
+  auto findSectionAddress = [&](const Atom &a) -> uint64_t {
+    return targets.lookup(&a)->sectionAddress;
+  };
+  uint8_t *buf = out + s.fileOff;
+  handler.generateAtomContent(*patched, false, findAddress, findSectionAddress,
+                              ctx.baseAddress(),
+                              llvm::MutableArrayRef<uint8_t>(buf, size));
+  memset(buf + size, 0, s.capacity - size);
+  s.size = size;
+  return true;
+}
+
+std::string IncrementalLinker::getUnsupportedReason() const {
+  if (_ctx.arch() != MachOLinkingContext::arch_x86_64)
+    return "only x86_64 is supported";
+  if (_ctx.outputMachOType() == llvm::MachO::MH_OBJECT)
+    return "-r is not supported";
+  if (_ctx.printAtoms())
+    return "-print_atoms is not supported";
+  if (_ctx.testingFileUsage())
+    return "-test_file_usage is not supported";
+  if (_ctx.hasDependencyFile())
+    return "-dependency_info is not supported";
+  return "";
+}
+
+std::string IncrementalLinker::getStatePath() const {
+  return (_ctx.outputPath() + ".incremental").str();
+}
+
+void IncrementalLinker::addInput(StringRef path) {
+  std::lock_guard<std::mutex> lock(_inputsMutex);
+  _inputs.push_back(path.str());
+}
+
+uint64_t IncrementalLinker::getSlack(const DefinedAtom *atom) const {
+  // Only functions are patched. Other atoms, like data and literals, must
+  // stay the same.
+  if (atom->contentType() != DefinedAtom::typeCode ||
+      atom->sectionChoice() != DefinedAtom::sectionBasedOnContent ||
+      atom->size() == 0)
+    return 0;
+  auto *file = dyn_cast<MachOFile>(&atom->file());
+  if (!file || !file->archivePath().empty())
+    return 0;
+  return std::max<uint64_t>(atom->size() / 4, 16);
+}
+
+bool IncrementalLinker::relink() {
+  std::vector<std::string> inputs;
+  {
+    std::lock_guard<std::mutex> lock(_inputsMutex);
+    inputs = _inputs;
+  }
+  std::string statePath = getStatePath();
+  Relinker relinker(_ctx, _argsHash, statePath, inputs);
+  if (relinker.run())
+    return true;
+  if (!errorCount())
+    log("incremental: " + relinker.reason + "; doing a full link");
+  return false;
+}
+
+void IncrementalLinker::recordResolvedAtoms(const File &merged) {
+  // Object files that are not archive members can be patched. A file given
+  // twice cannot, since its path would not identify it.
+  llvm::DenseSet<const Atom *> live;
+  std::vector<const MachOFile *> files;
+  llvm::DenseSet<const MachOFile *> seen;
+  llvm::StringMap<unsigned> pathCounts;
+  for (const DefinedAtom *atom : merged.defined()) {
+    live.insert(atom);
+    auto *file = dyn_cast<MachOFile>(&atom->file());
+    if (file && file->archivePath().empty() && seen.insert(file).second) {
+      files.push_back(file);
+      ++pathCounts[file->path()];
+    }
+  }
+  llvm::erase_if(files, [&](const MachOFile *file) {
+    return pathCounts[file->path()] > 1;
+  });
+
+  ArchHandler &handler = _ctx.archHandler();
+  _files.clear();
+  _files.resize(files.size());
+  parallelForEachN(0, files.size(), [&](size_t i) {
+    ResolvedFile &rf = _files[i];
+    rf.file = files[i];
+    AtomIndices indices = getAtomIndices(*rf.file);
+    for (const DefinedAtom *atom : rf.file->defined()) {
+      bool isLive = live.count(atom);
+      rf.live.push_back(isLive);
+      rf.contentHashes.push_back(getContentHash(*atom, indices));
+      rf.pinnedHashes.push_back(getPinnedHash(*atom, handler, indices));
+      if (!isLive)
+        continue;
+      for (const Reference *ref : *atom)
+        if (ref->kindNamespace() == Reference::KindNamespace::mach_o)
+          rf.refs.push_back({ref, getTargetKey(ref->target(), indices),
+                             ref->kindValue(), ref->addend()});
+    }
+  });
+}
+
+void IncrementalLinker::recordPlacement(const DefinedAtom *atom,
+                                        uint64_t address, uint64_t capacity,
+                                        uint64_t sectionAddress) {
+  _placements[atom] = {address, capacity, sectionAddress};
+}
+
+std::string
+IncrementalLinker::getFileBlock(const ResolvedFile &rf,
+                                ArrayRef<OutputSegment> segments) const {
+  const MachOFile &file = *rf.file;
+  // The debug map records the sizes of the functions.
+  if (file.debugInfo() &&
+      _ctx.debugInfoMode() == MachOLinkingContext::DebugInfoMode::addDebugMap)
+    return "";
+
+  FileState state;
+  size_t i = 0;
+  for (const DefinedAtom *atom : file.defined()) {
+    AtomState s;
+    if (rf.live[i]) {
+      auto it = _placements.find(atom);
+      uint64_t fileOff = UINT64_MAX;
+      if (it != _placements.end() && getSlack(atom))
+        fileOff = getFileOffset(segments, it->second.address,
+                                it->second.capacity);
+      if (fileOff != UINT64_MAX) {
+        s.kind = Patch;
+        s.hash = rf.pinnedHashes[i];
+        s.address = it->second.address;
+        s.fileOff = fileOff;
+        s.size = atom->size();
+        s.capacity = it->second.capacity;
+      } else {
+        s.kind = Fixed;
+        s.hash = rf.contentHashes[i];
+      }
+    }
+    state.atoms.push_back(s);
+    ++i;
+  }
+  state.fingerprint = getFingerprint(file, state.atoms);
+
+  // References of the same kind to the same target must have been resolved
+  // the same way. Those that were not, and those whose target is not in the
+  // output, cannot be resolved by a later link.
+  typedef std::pair<std::string, Reference::KindValue> Key;
+  std::map<Key, Resolution> resolutions;
+  std::set<Key> conflicts;
+  for (const ResolvedReference &r : rf.refs) {
+    if (r.targetKey.empty())
+      continue;
+    const Reference &ref = *r.ref;
+    Key key(r.targetKey, r.kind);
+    Resolution res;
+    res.targetKey = r.targetKey;
+    res.kind = r.kind;
+    res.finalKind = ref.kindValue();
+    bool ok = ref.addend() == r.addend;
+    if (auto *target = dyn_cast<DefinedAtom>(ref.target())) {
+      auto it = _placements.find(target);
+      if (it == _placements.end()) {
+        ok = false;
+      } else {
+        res.address = it->second.address;
+        res.sectionAddress = it->second.sectionAddress;
+      }
+    }
+    if (!ok) {
+      conflicts.insert(key);
+      continue;
+    }
+    auto ins = resolutions.insert({key, res});
+    const Resolution &prev = ins.first->second;
+    if (!ins.second &&
+        (prev.finalKind != res.finalKind || prev.address != res.address ||
+         prev.sectionAddress != res.sectionAddress))
+      conflicts.insert(key);
+  }
+  for (auto &p : resolutions)
+    if (!conflicts.count(p.first))
+      state.resolutions.push_back(p.second);
+
+  StateWriter w;
+  state.write(w);
+  return std::move(w.buf);
+}
+
+void IncrementalLinker::writeState() {
+  std::string path = getStatePath();
+  StringRef output = _ctx.outputPath();
+  StateHeader hdr;
+  hdr.argsHash = _argsHash;
+  if (!getFileStatus(output, hdr.outputSize, hdr.outputTime)) {
+    error("cannot stat " + output);
+    return;
+  }
+  std::vector<OutputSegment> segments;
+  if (!readSegments(output, segments)) {
+    log("incremental: cannot read the segments of " + output +
+        "; not saving the link state");
+    llvm::sys::fs::remove(path);
+    return;
+  }
+
+  // The compact unwind pass uses the size of the last function for the end
+  // of the range that __unwind_info covers.
+  bool hasUnwindInfo = false;
+  uint64_t lastFunction = 0;
+  for (auto &p : _placements) {
+    DefinedAtom::ContentType type = p.first->contentType();
+    if (type == DefinedAtom::typeProcessedUnwindInfo)
+      hasUnwindInfo = true;
+    else if (type == DefinedAtom::typeCode)
+      lastFunction = std::max(lastFunction, p.second.address);
+  }
+  if (hasUnwindInfo)
+    hdr.unwindEndAddress = lastFunction;
+
+  llvm::StringMap<const ResolvedFile *> patchable;
+  for (const ResolvedFile &rf : _files)
+    patchable[rf.file->path()] = &rf;
+
+  // An input may be read more than once, like an archive given twice.
+  std::vector<InputState> inputs;
+  llvm::StringSet<> seen;
+  for (const std::string &input : _inputs) {
+    if (!seen.insert(input).second)
+      continue;
+    inputs.emplace_back();
+    inputs.back().path = input;
+  }
+
+  parallelForEachN(0, inputs.size(), [&](size_t i) {
+    InputState &input = inputs[i];
+    getFileStatus(input.path, input.size, input.mtime);
+    if (auto mbOrErr = MemoryBuffer::getFile(input.path, -1, false))
+      input.hash = xxHash64((*mbOrErr)->getBuffer());
+    if (const ResolvedFile *rf = patchable.lookup(input.path))
+      input.block = getFileBlock(*rf, segments);
+  });
+  writeStateFile(path, hdr, inputs);
+}
+
+} // namespace mach_o
+} // namespace lld
@@ -0,0 +1,102 @@
+//===- lib/ReaderWriter/MachO/Incremental.h ---------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_READER_WRITER_MACHO_INCREMENTAL_H
+#define LLD_READER_WRITER_MACHO_INCREMENTAL_H
+
+#include "lld/Common/LLVM.h"
+#include "lld/Core/Reference.h"
+#include "llvm/ADT/DenseMap.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lld {
+class DefinedAtom;
+class File;
+class MachOLinkingContext;
+
+namespace mach_o {
+class MachOFile;
+struct OutputSegment;
+
+/// Implements -incremental, see Incremental.cpp.
+class IncrementalLinker {
+public:
+  IncrementalLinker(MachOLinkingContext &ctx, uint64_t argsHash)
+      : _ctx(ctx), _argsHash(argsHash) {}
+
+  /// Returns why the link does not support -incremental, or an empty string
+  /// if it does.
+  std::string getUnsupportedReason() const;
+
+  /// Records that the link reads \p path.
+  void addInput(StringRef path);
+
+  /// Returns the number of bytes to leave free after \p atom in the output,
+  /// so that a later link can patch a larger version of it in place.
+  uint64_t getSlack(const DefinedAtom *atom) const;
+
+  /// Tries to update the previous output by patching the object files that
+  /// changed since it was linked. Returns true if that was done, or if it
+  /// failed with an error, and false if a full link is needed.
+  bool relink();
+
+  /// Records the resolved atom graph, and where the references of the object
+  /// files point to, before the passes rewrite them.
+  void recordResolvedAtoms(const File &merged);
+
+  /// Records where the writer placed \p atom, and how many bytes it may use
+  /// there.
+  void recordPlacement(const DefinedAtom *atom, uint64_t address,
+                       uint64_t capacity, uint64_t sectionAddress);
+
+  /// Writes the state that relink() needs next to the output.
+  void writeState();
+
+private:
+  struct Placement {
+    uint64_t address;
+    uint64_t capacity;
+    uint64_t sectionAddress;
+  };
+
+  /// A reference of an object file and what it pointed to after resolution.
+  struct ResolvedReference {
+    const Reference *ref;
+    std::string targetKey;
+    Reference::KindValue kind;
+    Reference::Addend addend;
+  };
+
+  /// What recordResolvedAtoms() learned about an object file.
+  struct ResolvedFile {
+    const MachOFile *file;
+    std::vector<bool> live;
+    std::vector<uint64_t> contentHashes;
+    std::vector<uint64_t> pinnedHashes;
+    std::vector<ResolvedReference> refs;
+  };
+
+  std::string getStatePath() const;
+  std::string getFileBlock(const ResolvedFile &rf,
+                           ArrayRef<OutputSegment> segments) const;
+
+  MachOLinkingContext &_ctx;
+  uint64_t _argsHash;
+  std::mutex _inputsMutex;
+  std::vector<std::string> _inputs;
+  std::vector<ResolvedFile> _files;
+  llvm::DenseMap<const DefinedAtom *, Placement> _placements;
+};
+
+} // namespace mach_o
+} // namespace lld
+
+#endif // LLD_READER_WRITER_MACHO_INCREMENTAL_H
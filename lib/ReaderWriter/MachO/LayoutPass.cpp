@@ -8,12 +8,12 @@
 
 #include "LayoutPass.h"
 #include "lld/Core/Instrumentation.h"
+#include "lld/Common/Threads.h"
 #include "lld/Core/PassManager.h"
 #include "lld/ReaderWriter/MachOLinkingContext.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/Debug.h"
-#include "llvm/Support/Parallel.h"
 #include <algorithm>
 #include <set>
 #include <utility>
@@ -194,9 +194,12 @@ static bool compareAtomsSub(const LayoutPass::SortKey &lc,
     return lc._override < rc._override;
   }
 
+  const LayoutPass::SortKey::RootInfo &leftInfo = lc._rootInfo;
+  const LayoutPass::SortKey::RootInfo &rightInfo = rc._rootInfo;
+
   // Sort same permissions together.
-  DefinedAtom::ContentPermissions leftPerms = leftRoot->permissions();
-  DefinedAtom::ContentPermissions rightPerms = rightRoot->permissions();
+  DefinedAtom::ContentPermissions leftPerms = leftInfo.perms;
+  DefinedAtom::ContentPermissions rightPerms = rightInfo.perms;
 
   if (leftPerms != rightPerms) {
     LLVM_DEBUG(
@@ -205,8 +208,8 @@ static bool compareAtomsSub(const LayoutPass::SortKey &lc,
   }
 
   // Sort same content types together.
-  DefinedAtom::ContentType leftType = leftRoot->contentType();
-  DefinedAtom::ContentType rightType = rightRoot->contentType();
+  DefinedAtom::ContentType leftType = leftInfo.type;
+  DefinedAtom::ContentType rightType = rightInfo.type;
 
   if (leftType != rightType) {
     LLVM_DEBUG(reason =
@@ -222,22 +225,19 @@ static bool compareAtomsSub(const LayoutPass::SortKey &lc,
   }
 
   // Sort by .o order.
-  const File *leftFile = &leftRoot->file();
-  const File *rightFile = &rightRoot->file();
-
-  if (leftFile != rightFile) {
-    LLVM_DEBUG(reason = formatReason(".o order", (int)leftFile->ordinal(),
-                                     (int)rightFile->ordinal()));
-    return leftFile->ordinal() < rightFile->ordinal();
+  if (leftInfo.file != rightInfo.file) {
+    LLVM_DEBUG(reason = formatReason(".o order", (int)leftInfo.fileOrdinal,
+                                     (int)rightInfo.fileOrdinal));
+    return leftInfo.fileOrdinal < rightInfo.fileOrdinal;
   }
 
   // Sort by atom order with .o file.
-  uint64_t leftOrdinal = leftRoot->ordinal();
-  uint64_t rightOrdinal = rightRoot->ordinal();
+  uint64_t leftOrdinal = leftInfo.ordinal;
+  uint64_t rightOrdinal = rightInfo.ordinal;
 
   if (leftOrdinal != rightOrdinal) {
-    LLVM_DEBUG(reason = formatReason("ordinal", (int)leftRoot->ordinal(),
-                                     (int)rightRoot->ordinal()));
+    LLVM_DEBUG(reason = formatReason("ordinal", (int)leftOrdinal,
+                                     (int)rightOrdinal));
     return leftOrdinal < rightOrdinal;
   }
 
@@ -263,13 +263,35 @@ static bool compareAtoms(const LayoutPass::SortKey &lc,
 LayoutPass::LayoutPass(const Registry &registry, SortOverride sorter)
     : _registry(registry), _customSorter(std::move(sorter)) {}
 
+// Returns the root of the followon chain of the given atom. When a chain is
+// merged into another chain, only the root of the merged chain is remapped,
+// so the other atoms of the merged chain reach their new root through the
+// old one. The links are shortened as they are followed, so that merging
+// chains takes nearly linear time in total.
+const DefinedAtom *LayoutPass::findRoot(const DefinedAtom *atom) {
+  const DefinedAtom *root = atom;
+  for (;;) {
+    AtomToAtomT::iterator it = _followOnRoots.find(root);
+    assert(it != _followOnRoots.end());
+    if (it->second == root)
+      break;
+    root = it->second;
+  }
+  while (atom != root) {
+    const DefinedAtom *&parent = _followOnRoots.find(atom)->second;
+    atom = parent;
+    parent = root;
+  }
+  return root;
+}
+
 // Returns the atom immediately followed by the given atom in the followon
 // chain.
 const DefinedAtom *LayoutPass::findAtomFollowedBy(
     const DefinedAtom *targetAtom) {
   // Start from the beginning of the chain and follow the chain until
   // we find the targetChain.
-  const DefinedAtom *atom = _followOnRoots[targetAtom];
+  const DefinedAtom *atom = findRoot(targetAtom);
   while (true) {
     const DefinedAtom *prevAtom = atom;
     AtomToAtomT::iterator targetFollowOnAtomsIter = _followOnNexts.find(atom);
@@ -287,7 +309,7 @@ const DefinedAtom *LayoutPass::findAtomFollowedBy(
 // atom and the targetAtom (specified by layout-after) need to be of size zero
 // in this case. Otherwise the desired layout is impossible.
 bool LayoutPass::checkAllPrevAtomsZeroSize(const DefinedAtom *targetAtom) {
-  const DefinedAtom *atom = _followOnRoots[targetAtom];
+  const DefinedAtom *atom = findRoot(targetAtom);
   while (true) {
     if (atom == targetAtom)
       return true;
@@ -303,17 +325,13 @@ bool LayoutPass::checkAllPrevAtomsZeroSize(const DefinedAtom *targetAtom) {
 }
 
 // Set the root of all atoms in targetAtom's chain to the given root.
+// targetAtom must be the root of its chain. The other atoms of the chain are
+// mapped to targetAtom directly or indirectly, so only targetAtom is
+// remapped; see findRoot().
 void LayoutPass::setChainRoot(const DefinedAtom *targetAtom,
                               const DefinedAtom *root) {
-  // Walk through the followon chain and override each node's root.
-  while (true) {
-    _followOnRoots[targetAtom] = root;
-    AtomToAtomT::iterator targetFollowOnAtomsIter =
-        _followOnNexts.find(targetAtom);
-    if (targetFollowOnAtomsIter == _followOnNexts.end())
-      return;
-    targetAtom = targetFollowOnAtomsIter->second;
-  }
+  assert(findRoot(targetAtom) == targetAtom);
+  _followOnRoots.find(targetAtom)->second = root;
 }
 
 /// This pass builds the followon tables described by two DenseMaps
@@ -361,15 +379,15 @@ void LayoutPass::buildFollowOnTable(const File::AtomRange<DefinedAtom> &range) {
         // becomes invalid, and that invalid reference would be used as the RHS
         // value of the expression.
         // Copy the value to workaround.
-        const DefinedAtom *tmp = _followOnRoots[ai];
+        const DefinedAtom *tmp = findRoot(ai);
         _followOnRoots[targetAtom] = tmp;
         continue;
       }
-      if (iter->second == targetAtom) {
+      if (findRoot(targetAtom) == targetAtom) {
         // If the targetAtom is the root of a chain, the chain becomes part of
         // the current chain. Rewrite the subchain's root to the current
         // chain's root.
-        setChainRoot(targetAtom, _followOnRoots[ai]);
+        setChainRoot(targetAtom, findRoot(ai));
         continue;
       }
       // The targetAtom is already a part of a chain. If the current atom is
@@ -383,16 +401,25 @@ void LayoutPass::buildFollowOnTable(const File::AtomRange<DefinedAtom> &range) {
       if (currentAtomSize == 0) {
         const DefinedAtom *targetPrevAtom = findAtomFollowedBy(targetAtom);
         _followOnNexts[targetPrevAtom] = ai;
-        const DefinedAtom *tmp = _followOnRoots[targetPrevAtom];
+        const DefinedAtom *tmp = findRoot(targetPrevAtom);
         _followOnRoots[ai] = tmp;
         continue;
       }
       if (!checkAllPrevAtomsZeroSize(targetAtom))
         break;
-      _followOnNexts[ai] = _followOnRoots[targetAtom];
-      setChainRoot(_followOnRoots[targetAtom], _followOnRoots[ai]);
+      const DefinedAtom *targetRoot = findRoot(targetAtom);
+      _followOnNexts[ai] = targetRoot;
+      setChainRoot(targetRoot, findRoot(ai));
     }
   }
+
+  // Map every atom directly to its root for the users of the table.
+  std::vector<const DefinedAtom *> atoms;
+  atoms.reserve(_followOnRoots.size());
+  for (const auto &kv : _followOnRoots)
+    atoms.push_back(kv.first);
+  for (const DefinedAtom *atom : atoms)
+    findRoot(atom);
 }
 
 /// Build an ordinal override map by traversing the followon chain, and
@@ -461,10 +488,10 @@ llvm::Error LayoutPass::perform(SimpleFile &mergedFile) {
   });
 
   std::vector<LayoutPass::SortKey> vec = decorate(atomRange);
-  sort(llvm::parallel::par, vec.begin(), vec.end(),
-       [&](const LayoutPass::SortKey &l, const LayoutPass::SortKey &r) -> bool {
-         return compareAtoms(l, r, _customSorter);
-       });
+  parallelSort(vec, [&](const LayoutPass::SortKey &l,
+                        const LayoutPass::SortKey &r) -> bool {
+    return compareAtoms(l, r, _customSorter);
+  });
   LLVM_DEBUG(checkTransitivity(vec, _customSorter));
   undecorate(atomRange, vec);
 
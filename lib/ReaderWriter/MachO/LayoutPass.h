@@ -32,17 +32,31 @@ namespace mach_o {
 class LayoutPass : public Pass {
 public:
   struct SortKey {
+    // The properties of the chain root that atoms are sorted by are read
+    // once here, so that comparing two keys does not make virtual calls.
+    struct RootInfo {
+      DefinedAtom::ContentPermissions perms;
+      DefinedAtom::ContentType type;
+      const File *file;
+      uint64_t fileOrdinal;
+      uint64_t ordinal;
+    };
+
     SortKey(OwningAtomPtr<DefinedAtom> &&atom,
             const DefinedAtom *root, uint64_t override)
-    : _atom(std::move(atom)), _root(root), _override(override) {}
+    : _atom(std::move(atom)), _root(root), _override(override),
+      _rootInfo({root->permissions(), root->contentType(), &root->file(),
+                 root->file().ordinal(), root->ordinal()}) {}
     OwningAtomPtr<DefinedAtom> _atom;
     const DefinedAtom *_root;
     uint64_t _override;
+    RootInfo _rootInfo;
 
     // Note, these are only here to appease MSVC bots which didn't like
     // the same methods being implemented/deleted in OwningAtomPtr.
     SortKey(SortKey &&key) : _atom(std::move(key._atom)), _root(key._root),
-                             _override(key._override) {
+                             _override(key._override),
+                             _rootInfo(key._rootInfo) {
       key._root = nullptr;
     }
 
@@ -51,6 +65,7 @@ public:
       _root = key._root;
       key._root = nullptr;
       _override = key._override;
+      _rootInfo = key._rootInfo;
       return *this;
     }
 
@@ -92,12 +107,15 @@ private:
 
   // A map to be used to sort atoms. It's a map from an atom to its root of
   // follow-on chain. A root atom is mapped to itself. If an atom is not in
-  // _followOnNexts, the atom is not in this map, and vice versa.
+  // _followOnNexts, the atom is not in this map, and vice versa. While the
+  // chains are being built, an atom may be mapped to an atom that is no
+  // longer a root; use findRoot() to find its root.
   AtomToAtomT _followOnRoots;
 
   AtomToOrdinalT _ordinalOverrideMap;
 
   // Helper methods for buildFollowOnTable().
+  const DefinedAtom *findRoot(const DefinedAtom *atom);
   const DefinedAtom *findAtomFollowedBy(const DefinedAtom *targetAtom);
   bool checkAllPrevAtomsZeroSize(const DefinedAtom *targetAtom);
 
@@ -11,6 +11,7 @@
 #include "ArchHandler.h"
 #include "File.h"
 #include "FlatNamespaceFile.h"
+#include "Incremental.h"
 #include "MachONormalizedFile.h"
 #include "MachOPasses.h"
 #include "SectCreateFile.h"
@@ -636,16 +637,11 @@ void MachOLinkingContext::addPasses(PassManager &pm) {
   if (needsObjCPass())
     mach_o::addObjCPass(pm, *this);
   mach_o::addLayoutPass(pm, *this);
-  if (needsStubsPass())
-    mach_o::addStubsPass(pm, *this);
   if (needsCompactUnwindPass())
     mach_o::addCompactUnwindPass(pm, *this);
-  if (needsGOTPass())
-    mach_o::addGOTPass(pm, *this);
-  if (needsTLVPass())
-    mach_o::addTLVPass(pm, *this);
-  if (needsShimPass())
-    mach_o::addShimPass(pm, *this); // Shim pass must run after stubs pass.
+  // The stubs, GOT, TLV and shim passes share one scan over all references,
+  // which must see the references added by the compact unwind pass.
+  mach_o::addReferencePasses(pm, *this);
 }
 
 Writer &MachOLinkingContext::writer() const {
@@ -910,6 +906,8 @@ std::error_code MachOLinkingContext::createDependencyFile(StringRef path) {
 
 void MachOLinkingContext::addInputFileDependency(StringRef path) const {
   addDependencyInfoHelper(_dependencyInfo.get(), 0x10, path);
+  if (_incremental)
+    _incremental->addInput(path);
 }
 
 void MachOLinkingContext::addInputFileNotFound(StringRef path) const {
@@ -920,6 +918,30 @@ void MachOLinkingContext::addOutputFileDependency(StringRef path) const {
   addDependencyInfoHelper(_dependencyInfo.get(), 0x40, path);
 }
 
+void MachOLinkingContext::setIncremental(uint64_t argsHash) {
+  _incremental = std::make_unique<mach_o::IncrementalLinker>(*this, argsHash);
+}
+
+bool MachOLinkingContext::linkIncrementally() {
+  std::string reason = _incremental->getUnsupportedReason();
+  if (!reason.empty()) {
+    warn("-incremental: " + reason + "; ignoring");
+    _incremental.reset();
+    return false;
+  }
+  return _incremental->relink();
+}
+
+void MachOLinkingContext::recordResolvedAtomsForIncremental(
+    const File &merged) {
+  _incremental->recordResolvedAtoms(merged);
+}
+
+void MachOLinkingContext::writeIncrementalState() {
+  if (_incremental)
+    _incremental->writeState();
+}
+
 void MachOLinkingContext::appendOrderedSymbol(StringRef symbol,
                                               StringRef filename) {
   // To support sorting static functions which may have the same name in
@@ -87,6 +87,7 @@ static std::error_code appendRelocations(Relocations &relocs, StringRef buffer,
   const any_relocation_info* relocsArray =
             reinterpret_cast<const any_relocation_info*>(buffer.begin()+reloff);
 
+  relocs.reserve(relocs.size() + nreloc);
   for(uint32_t i=0; i < nreloc; ++i) {
     relocs.push_back(unpackRelocation(relocsArray[i], bigEndian));
   }
@@ -103,6 +104,7 @@ appendIndirectSymbols(IndirectSymbols &isyms, StringRef buffer, bool isBig,
     return make_error_code(llvm::errc::executable_format_error);
   const uint8_t *indirectSymbolArray = (const uint8_t *)buffer.data();
 
+  isyms.reserve(isyms.size() + count);
   for(uint32_t i=0; i < count; ++i) {
     isyms.push_back(read32(
         indirectSymbolArray + (startIndex + i) * sizeof(uint32_t), isBig));
@@ -291,6 +293,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
         // Verify sections don't extend beyond end of segment load command.
         if (lcSize > size)
           return true;
+        f->sections.reserve(f->sections.size() + sectionCount);
         for (unsigned i=0; i < sectionCount; ++i) {
           const section_64 *sect = &sects[i];
           Section section;
@@ -304,8 +307,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
           const uint8_t *content =
             (const uint8_t *)start + read32(&sect->offset, isBig);
           size_t contentSize = read64(&sect->size, isBig);
-          // Note: this assign() is copying the content bytes.  Ideally,
-          // we can use a custom allocator for vector to avoid the copy.
+          // The content refers to the buffer in place; it is not copied.
           section.content = llvm::makeArrayRef(content, contentSize);
           appendRelocations(section.relocations, mb->getBuffer(), isBig,
                             read32(&sect->reloff, isBig),
@@ -318,7 +320,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
                                   read32(&sect->reserved1, isBig),
                                   contentSize/4);
           }
-          f->sections.push_back(section);
+          f->sections.push_back(std::move(section));
         }
       }
       break;
@@ -334,6 +336,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
         // Verify sections don't extend beyond end of segment load command.
         if (lcSize > size)
           return true;
+        f->sections.reserve(f->sections.size() + sectionCount);
         for (unsigned i=0; i < sectionCount; ++i) {
           const section *sect = &sects[i];
           Section section;
@@ -348,8 +351,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
           const uint8_t *content =
             (const uint8_t *)start + read32(&sect->offset, isBig);
           size_t contentSize = read32(&sect->size, isBig);
-          // Note: this assign() is copying the content bytes.  Ideally,
-          // we can use a custom allocator for vector to avoid the copy.
+          // The content refers to the buffer in place; it is not copied.
           section.content = llvm::makeArrayRef(content, contentSize);
           appendRelocations(section.relocations, mb->getBuffer(), isBig,
                             read32(&sect->reloff, isBig),
@@ -360,7 +362,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
                 indirectSymbolTableOffset, indirectSymbolTableCount,
                 read32(&sect->reserved1, isBig), contentSize / 4);
           }
-          f->sections.push_back(section);
+          f->sections.push_back(std::move(section));
         }
       }
       break;
@@ -48,6 +48,9 @@ public:
     _ostream << str;
     append_byte(0);
   }
+  void append_buffer(ByteBuffer &other) {
+    _ostream << other._ostream.str();
+  }
   void align(unsigned alignment) {
     while ( (_ostream.tell() % alignment) != 0 )
       append_byte(0);
@@ -23,12 +23,11 @@
 #include "MachONormalizedFile.h"
 #include "MachONormalizedFileBinaryUtils.h"
 #include "lld/Common/LLVM.h"
+#include "lld/Common/Threads.h"
 #include "lld/Core/Error.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
-#include "llvm/ADT/ilist.h"
-#include "llvm/ADT/ilist_node.h"
 #include "llvm/BinaryFormat/MachO.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/Debug.h"
@@ -50,57 +49,33 @@ namespace lld {
 namespace mach_o {
 namespace normalized {
 
-struct TrieNode; // Forward declaration.
-
-struct TrieEdge : public llvm::ilist_node<TrieEdge> {
-  TrieEdge(StringRef s, TrieNode *node) : _subString(s), _child(node) {}
-
-  StringRef          _subString;
-  struct TrieNode   *_child;
-};
-
-} // namespace normalized
-} // namespace mach_o
-} // namespace lld
-
-
-namespace llvm {
-using lld::mach_o::normalized::TrieEdge;
-template <>
-struct ilist_alloc_traits<TrieEdge> : ilist_noalloc_traits<TrieEdge> {};
-} // namespace llvm
-
-
-namespace lld {
-namespace mach_o {
-namespace normalized {
+/// Builds the export trie from the exported symbols sorted by name. Nodes
+/// are created in the order in which they are written, and they and their
+/// edges live in two flat arrays. Edge strings point into the export names.
+class TrieBuilder {
+public:
+  TrieBuilder(ArrayRef<const Export *> exports) { addNode(0, exports); }
 
-struct TrieNode {
-  typedef llvm::ilist<TrieEdge> TrieEdgeList;
+  void writeTo(ByteBuffer &out);
 
-  TrieNode(StringRef s)
-      : _cummulativeString(s), _address(0), _flags(0), _other(0),
-        _trieOffset(0), _hasExportInfo(false) {}
-  ~TrieNode() = default;
+private:
+  struct Node {
+    const Export *exp = nullptr;
+    uint32_t firstEdge = 0;
+    uint32_t numEdges = 0;
+    uint32_t trieOffset = 0;
+  };
 
-  void addSymbol(const Export &entry, BumpPtrAllocator &allocator,
-                 std::vector<TrieNode *> &allNodes);
+  struct Edge {
+    StringRef subString;
+    uint32_t child;
+  };
 
-  void addOrderedNodes(const Export &entry,
-                       std::vector<TrieNode *> &allNodes);
-  bool updateOffset(uint32_t &offset);
-  void appendToByteBuffer(ByteBuffer &out);
+  uint32_t addNode(size_t prefixLen, ArrayRef<const Export *> exports);
+  static uint32_t exportInfoSize(const Export &exp);
 
-private:
-  StringRef                 _cummulativeString;
-  TrieEdgeList              _children;
-  uint64_t                  _address;
-  uint64_t                  _flags;
-  uint64_t                  _other;
-  StringRef                 _importedName;
-  uint32_t                  _trieOffset;
-  bool                      _hasExportInfo;
-  bool                      _ordered = false;
+  std::vector<Node> _nodes;
+  std::vector<Edge> _edges;
 };
 
 /// Utility class for writing a mach-o binary file given an in-memory
@@ -127,7 +102,7 @@ private:
   void        buildFileOffsets();
   void        writeMachHeader();
   llvm::Error writeLoadCommands();
-  void        writeSectionContent();
+  void        addSectionContentWriters(std::vector<std::function<void()>> &v);
   void        writeRelocations();
   void        writeSymbolTable();
   void        writeRebaseInfo();
@@ -136,10 +111,8 @@ private:
   void        writeExportInfo();
   void        writeFunctionStartsInfo();
   void        writeDataInCodeInfo();
-  void        writeLinkEditContent();
+  void        addLinkEditWriters(std::vector<std::function<void()>> &v);
   void        buildLinkEditInfo();
-  void        buildRebaseInfo();
-  void        buildBindInfo();
   void        buildLazyBindInfo();
   void        buildExportTrie();
   void        computeFunctionStartsSize();
@@ -1017,7 +990,8 @@ llvm::Error MachOFileLayout::writeLoadCommands() {
   return llvm::Error::success();
 }
 
-void MachOFileLayout::writeSectionContent() {
+void MachOFileLayout::addSectionContentWriters(
+    std::vector<std::function<void()>> &v) {
   for (const Section &s : _file.sections) {
     // Copy all section content to output buffer.
     if (isZeroFillSection(s.type))
@@ -1026,16 +1000,16 @@ void MachOFileLayout::writeSectionContent() {
       continue;
     uint32_t offset = _sectInfo[&s].fileOffset;
     assert(offset >= _endOfLoadCommands);
-    uint8_t *p = &_buffer[offset];
-    memcpy(p, &s.content[0], s.content.size());
-    p += s.content.size();
+    ArrayRef<uint8_t> content = s.content;
+    v.push_back(
+        [=] { memcpy(&_buffer[offset], content.data(), content.size()); });
   }
 }
 
 void MachOFileLayout::writeRelocations() {
   uint32_t relOffset = _startOfRelocations;
-  for (Section sect : _file.sections) {
-    for (Relocation r : sect.relocations) {
+  for (const Section &sect : _file.sections) {
+    for (const Relocation &r : sect.relocations) {
       any_relocation_info* rb = reinterpret_cast<any_relocation_info*>(
                                                            &_buffer[relOffset]);
       *rb = packRelocation(r, _swap, _bigEndianArch);
@@ -1153,83 +1127,306 @@ void MachOFileLayout::writeExportInfo() {
   memcpy(&_buffer[_startOfExportTrie], _exportTrie.bytes(), _exportTrie.size());
 }
 
-void MachOFileLayout::buildLinkEditInfo() {
-  buildRebaseInfo();
-  buildBindInfo();
-  buildLazyBindInfo();
-  buildExportTrie();
-  computeSymbolTableSizes();
-  computeFunctionStartsSize();
-  computeDataInCodeSize();
+/// Sorts the rebase or bind entries by address, and returns them split by
+/// segment.
+template <typename T>
+static std::vector<ArrayRef<T>> splitBySegment(std::vector<T> &entries) {
+  llvm::stable_sort(entries, [](const T &a, const T &b) {
+    if (a.segIndex != b.segIndex)
+      return a.segIndex < b.segIndex;
+    return uint64_t(a.segOffset) < uint64_t(b.segOffset);
+  });
+  std::vector<ArrayRef<T>> chunks;
+  ArrayRef<T> rest = entries;
+  while (!rest.empty()) {
+    uint8_t segIndex = rest.front().segIndex;
+    size_t n = 1;
+    while (n < rest.size() && rest[n].segIndex == segIndex)
+      ++n;
+    chunks.push_back(rest.take_front(n));
+    rest = rest.drop_front(n);
+  }
+  return chunks;
 }
 
-void MachOFileLayout::buildSectionRelocations() {
+/// Encodes the rebase entries of a segment, which are sorted by address.
+/// Runs of pointers that are next to each other, or the same distance apart,
+/// are rebased by one opcode.
+static void encodeRebases(ByteBuffer &out, ArrayRef<RebaseLocation> entries,
+                          unsigned pointerSize) {
+  // The address that the next rebase opcode applies to, which each rebase
+  // moves past the pointer it rebased.
+  uint64_t address = 0;
+  for (size_t i = 0, e = entries.size(); i != e;) {
+    const RebaseLocation &entry = entries[i];
+    uint64_t offset = entry.segOffset;
+    if (i == 0 || entry.kind != entries[i - 1].kind)
+      out.append_byte(REBASE_OPCODE_SET_TYPE_IMM | entry.kind);
+    if (i == 0 || offset < address) {
+      out.append_byte(REBASE_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB
+                      | entry.segIndex);
+      out.append_uleb128(offset);
+    } else if (offset != address) {
+      uint64_t delta = offset - address;
+      if (delta % pointerSize == 0 &&
+          delta / pointerSize <= REBASE_IMMEDIATE_MASK) {
+        out.append_byte(REBASE_OPCODE_ADD_ADDR_IMM_SCALED
+                        | (delta / pointerSize));
+      } else {
+        out.append_byte(REBASE_OPCODE_ADD_ADDR_ULEB);
+        out.append_uleb128(delta);
+      }
+    }
+
+    // Returns the number of entries from i on that have the same kind and
+    // are stride bytes apart.
+    auto countRun = [&](uint64_t stride) {
+      size_t j = i + 1;
+      while (j != e && entries[j].kind == entry.kind &&
+             uint64_t(entries[j].segOffset) ==
+                 uint64_t(entries[j - 1].segOffset) + stride)
+        ++j;
+      return j - i;
+    };
+
+    // Rebase a run of adjacent pointers, or a pointer that is not followed
+    // by another one of the same kind.
+    size_t n = countRun(pointerSize);
+    uint64_t stride = 0;
+    if (n == 1 && i + 1 != e && entries[i + 1].kind == entry.kind)
+      stride = uint64_t(entries[i + 1].segOffset) - offset;
+    if (n > 1 || stride < pointerSize) {
+      if (n <= REBASE_IMMEDIATE_MASK) {
+        out.append_byte(REBASE_OPCODE_DO_REBASE_IMM_TIMES | n);
+      } else {
+        out.append_byte(REBASE_OPCODE_DO_REBASE_ULEB_TIMES);
+        out.append_uleb128(n);
+      }
+      address = offset + n * pointerSize;
+      i += n;
+      continue;
+    }
 
+    // Otherwise, rebase the pointers that follow at the same distance, or
+    // this one and move to the next.
+    n = countRun(stride);
+    if (n > 2) {
+      out.append_byte(REBASE_OPCODE_DO_REBASE_ULEB_TIMES_SKIPPING_ULEB);
+      out.append_uleb128(n);
+      out.append_uleb128(stride - pointerSize);
+      address = offset + n * stride;
+      i += n;
+      continue;
+    }
+    out.append_byte(REBASE_OPCODE_DO_REBASE_ADD_ADDR_ULEB);
+    out.append_uleb128(stride - pointerSize);
+    address = offset + stride;
+    ++i;
+  }
 }
 
-void MachOFileLayout::buildRebaseInfo() {
-  // TODO: compress rebasing info.
-  for (const RebaseLocation& entry : _file.rebasingInfo) {
-    _rebaseInfo.append_byte(REBASE_OPCODE_SET_TYPE_IMM | entry.kind);
-    _rebaseInfo.append_byte(REBASE_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB
-                            | entry.segIndex);
-    _rebaseInfo.append_uleb128(entry.segOffset);
-    _rebaseInfo.append_uleb128(REBASE_OPCODE_DO_REBASE_IMM_TIMES | 1);
+namespace {
+/// A bind opcode and its operands, before it is encoded.
+struct BindOpcode {
+  uint8_t opcode;
+  uint64_t operand;
+  uint64_t operand2;
+  StringRef symbolName;
+};
+} // namespace
+
+static bool isBindStateOpcode(uint8_t opcode) {
+  switch (opcode) {
+  case BIND_OPCODE_SET_DYLIB_ORDINAL_ULEB:
+  case BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM:
+  case BIND_OPCODE_SET_TYPE_IMM:
+  case BIND_OPCODE_SET_ADDEND_SLEB:
+    return true;
+  default:
+    return false;
   }
-  _rebaseInfo.append_byte(REBASE_OPCODE_DONE);
-  _rebaseInfo.align(_is64 ? 8 : 4);
 }
 
-void MachOFileLayout::buildBindInfo() {
-  // TODO: compress bind info.
-  uint64_t lastAddend = 0;
-  int lastOrdinal = 0x80000000;
-  StringRef lastSymbolName;
-  BindType lastType = (BindType)0;
-  Hex32 lastSegOffset = ~0U;
-  uint8_t lastSegIndex = (uint8_t)~0U;
-  for (const BindLocation& entry : _file.bindingInfo) {
-    if (entry.ordinal != lastOrdinal) {
-      if (entry.ordinal <= 0)
-        _bindingInfo.append_byte(BIND_OPCODE_SET_DYLIB_SPECIAL_IMM |
-                                 (entry.ordinal & BIND_IMMEDIATE_MASK));
-      else if (entry.ordinal <= BIND_IMMEDIATE_MASK)
-        _bindingInfo.append_byte(BIND_OPCODE_SET_DYLIB_ORDINAL_IMM |
-                                 entry.ordinal);
-      else {
-        _bindingInfo.append_byte(BIND_OPCODE_SET_DYLIB_ORDINAL_ULEB);
-        _bindingInfo.append_uleb128(entry.ordinal);
-      }
-      lastOrdinal = entry.ordinal;
+/// Encodes the bind entries of a segment, which are sorted by address. Each
+/// entry is first turned into opcodes of its own, which are then combined:
+/// an address change after a bind becomes part of the bind, and runs of the
+/// same bind the same distance apart become one opcode.
+static void encodeBinds(ByteBuffer &out, ArrayRef<BindLocation> entries,
+                        unsigned pointerSize) {
+  std::vector<BindOpcode> ops;
+  uint64_t address = 0;
+  uint64_t addend = 0;
+  for (size_t i = 0, e = entries.size(); i != e; ++i) {
+    const BindLocation &entry = entries[i];
+    const BindLocation *prev = i ? &entries[i - 1] : nullptr;
+    uint64_t offset = entry.segOffset;
+    if (!prev || entry.ordinal != prev->ordinal)
+      ops.push_back({BIND_OPCODE_SET_DYLIB_ORDINAL_ULEB,
+                     uint64_t(entry.ordinal), 0, StringRef()});
+    if (!prev || entry.symbolName != prev->symbolName)
+      ops.push_back({BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM, 0, 0,
+                     entry.symbolName});
+    if (!prev || entry.kind != prev->kind)
+      ops.push_back({BIND_OPCODE_SET_TYPE_IMM, entry.kind, 0, StringRef()});
+    if (entry.addend != addend) {
+      addend = entry.addend;
+      ops.push_back({BIND_OPCODE_SET_ADDEND_SLEB, addend, 0, StringRef()});
     }
-
-    if (lastSymbolName != entry.symbolName) {
-      _bindingInfo.append_byte(BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM);
-      _bindingInfo.append_string(entry.symbolName);
-      lastSymbolName = entry.symbolName;
+    if (!prev || offset < address)
+      ops.push_back({BIND_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB, entry.segIndex,
+                     offset, StringRef()});
+    else if (offset != address)
+      ops.push_back({BIND_OPCODE_ADD_ADDR_ULEB, offset - address, 0,
+                     StringRef()});
+    ops.push_back({BIND_OPCODE_DO_BIND, 0, 0, StringRef()});
+    address = offset + pointerSize;
+  }
+  // The next segment expects the addend to be zero.
+  if (addend)
+    ops.push_back({BIND_OPCODE_SET_ADDEND_SLEB, 0, 0, StringRef()});
+
+  // Fold address changes into the preceding bind. The opcodes that set the
+  // symbol and its attributes do not depend on the address, so the address
+  // change may be moved before them.
+  std::vector<BindOpcode> folded;
+  size_t lastBind = SIZE_MAX;
+  for (const BindOpcode &op : ops) {
+    if (op.opcode == BIND_OPCODE_ADD_ADDR_ULEB && lastBind != SIZE_MAX) {
+      folded[lastBind].opcode = BIND_OPCODE_DO_BIND_ADD_ADDR_ULEB;
+      folded[lastBind].operand = op.operand;
+      lastBind = SIZE_MAX;
+      continue;
     }
+    if (op.opcode == BIND_OPCODE_DO_BIND)
+      lastBind = folded.size();
+    else if (!isBindStateOpcode(op.opcode))
+      lastBind = SIZE_MAX;
+    folded.push_back(op);
+  }
 
-    if (lastType != entry.kind) {
-      _bindingInfo.append_byte(BIND_OPCODE_SET_TYPE_IMM | entry.kind);
-      lastType = entry.kind;
+  // Combine runs of binds with the same distance between them. A plain bind
+  // moves past the pointer it bound, like a bind that skips zero bytes.
+  auto getSkip = [](const BindOpcode &op, uint64_t &skip) {
+    if (op.opcode == BIND_OPCODE_DO_BIND)
+      skip = 0;
+    else if (op.opcode == BIND_OPCODE_DO_BIND_ADD_ADDR_ULEB)
+      skip = op.operand;
+    else
+      return false;
+    return true;
+  };
+  ops.clear();
+  for (size_t i = 0, e = folded.size(); i != e;) {
+    uint64_t skip, nextSkip;
+    size_t n = 1;
+    if (getSkip(folded[i], skip))
+      while (i + n != e && getSkip(folded[i + n], nextSkip) &&
+             nextSkip == skip)
+        ++n;
+    if (n > 1) {
+      ops.push_back({BIND_OPCODE_DO_BIND_ULEB_TIMES_SKIPPING_ULEB, n, skip,
+                     StringRef()});
+    } else {
+      ops.push_back(folded[i]);
+      BindOpcode &op = ops.back();
+      if (op.opcode == BIND_OPCODE_DO_BIND_ADD_ADDR_ULEB &&
+          op.operand % pointerSize == 0 &&
+          op.operand / pointerSize <= BIND_IMMEDIATE_MASK) {
+        op.opcode = BIND_OPCODE_DO_BIND_ADD_ADDR_IMM_SCALED;
+        op.operand /= pointerSize;
+      }
     }
+    i += n;
+  }
 
-    if (lastSegIndex != entry.segIndex || lastSegOffset != entry.segOffset) {
-      _bindingInfo.append_byte(BIND_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB
-                               | entry.segIndex);
-      _bindingInfo.append_uleb128(entry.segOffset);
-      lastSegIndex = entry.segIndex;
-      lastSegOffset = entry.segOffset;
+  for (const BindOpcode &op : ops) {
+    switch (op.opcode) {
+    case BIND_OPCODE_SET_DYLIB_ORDINAL_ULEB: {
+      int ordinal = int(op.operand);
+      if (ordinal <= 0) {
+        out.append_byte(BIND_OPCODE_SET_DYLIB_SPECIAL_IMM |
+                        (ordinal & BIND_IMMEDIATE_MASK));
+      } else if (ordinal <= BIND_IMMEDIATE_MASK) {
+        out.append_byte(BIND_OPCODE_SET_DYLIB_ORDINAL_IMM | ordinal);
+      } else {
+        out.append_byte(BIND_OPCODE_SET_DYLIB_ORDINAL_ULEB);
+        out.append_uleb128(ordinal);
+      }
+      break;
     }
-    if (entry.addend != lastAddend) {
-      _bindingInfo.append_byte(BIND_OPCODE_SET_ADDEND_SLEB);
-      _bindingInfo.append_sleb128(entry.addend);
-      lastAddend = entry.addend;
+    case BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM:
+      out.append_byte(BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM);
+      out.append_string(op.symbolName);
+      break;
+    case BIND_OPCODE_SET_TYPE_IMM:
+    case BIND_OPCODE_DO_BIND_ADD_ADDR_IMM_SCALED:
+      out.append_byte(op.opcode | op.operand);
+      break;
+    case BIND_OPCODE_SET_ADDEND_SLEB:
+      out.append_byte(op.opcode);
+      out.append_sleb128(op.operand);
+      break;
+    case BIND_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB:
+      out.append_byte(op.opcode | op.operand);
+      out.append_uleb128(op.operand2);
+      break;
+    case BIND_OPCODE_DO_BIND_ADD_ADDR_ULEB:
+      out.append_byte(op.opcode);
+      out.append_uleb128(op.operand);
+      break;
+    case BIND_OPCODE_DO_BIND_ULEB_TIMES_SKIPPING_ULEB:
+      out.append_byte(op.opcode);
+      out.append_uleb128(op.operand);
+      out.append_uleb128(op.operand2);
+      break;
+    default:
+      out.append_byte(op.opcode);
+      break;
     }
-    _bindingInfo.append_byte(BIND_OPCODE_DO_BIND);
   }
+}
+
+void MachOFileLayout::buildLinkEditInfo() {
+  // Rebase and bind entries are sorted by address and split by segment. The
+  // opcodes of each segment set all the state they use, so the segments are
+  // encoded into buffers of their own, in parallel with each other and with
+  // the other encoders, and then concatenated.
+  std::vector<RebaseLocation> rebases = _file.rebasingInfo;
+  std::vector<BindLocation> binds = _file.bindingInfo;
+  std::vector<ArrayRef<RebaseLocation>> rebaseChunks = splitBySegment(rebases);
+  std::vector<ArrayRef<BindLocation>> bindChunks = splitBySegment(binds);
+  std::vector<ByteBuffer> rebaseBuffers(rebaseChunks.size());
+  std::vector<ByteBuffer> bindBuffers(bindChunks.size());
+  unsigned pointerSize = _is64 ? 8 : 4;
+
+  std::vector<std::function<void()>> builders = {
+      [&] { buildLazyBindInfo(); }, [&] { buildExportTrie(); }};
+  for (size_t i = 0, e = rebaseChunks.size(); i != e; ++i)
+    builders.push_back([&, i] {
+      encodeRebases(rebaseBuffers[i], rebaseChunks[i], pointerSize);
+    });
+  for (size_t i = 0, e = bindChunks.size(); i != e; ++i)
+    builders.push_back([&, i] {
+      encodeBinds(bindBuffers[i], bindChunks[i], pointerSize);
+    });
+  parallelForEach(builders, [](std::function<void()> &f) { f(); });
+
+  for (ByteBuffer &buffer : rebaseBuffers)
+    _rebaseInfo.append_buffer(buffer);
+  _rebaseInfo.append_byte(REBASE_OPCODE_DONE);
+  _rebaseInfo.align(pointerSize);
+  for (ByteBuffer &buffer : bindBuffers)
+    _bindingInfo.append_buffer(buffer);
   _bindingInfo.append_byte(BIND_OPCODE_DONE);
-  _bindingInfo.align(_is64 ? 8 : 4);
+  _bindingInfo.align(pointerSize);
+
+  computeSymbolTableSizes();
+  computeFunctionStartsSize();
+  computeDataInCodeSize();
+}
+
+void MachOFileLayout::buildSectionRelocations() {
+
 }
 
 void MachOFileLayout::buildLazyBindInfo() {
@@ -1256,170 +1453,137 @@ void MachOFileLayout::buildLazyBindInfo() {
   _lazyBindingInfo.align(_is64 ? 8 : 4);
 }
 
-void TrieNode::addSymbol(const Export& entry,
-                         BumpPtrAllocator &allocator,
-                         std::vector<TrieNode*> &allNodes) {
-  StringRef partialStr = entry.name.drop_front(_cummulativeString.size());
-  for (TrieEdge &edge : _children) {
-    StringRef edgeStr = edge._subString;
-    if (partialStr.startswith(edgeStr)) {
-      // Already have matching edge, go down that path.
-      edge._child->addSymbol(entry, allocator, allNodes);
-      return;
-    }
-    // See if string has commmon prefix with existing edge.
-    for (int n=edgeStr.size()-1; n > 0; --n) {
-      if (partialStr.substr(0, n).equals(edgeStr.substr(0, n))) {
-        // Splice in new node:  was A -> C,  now A -> B -> C
-        StringRef bNodeStr = edge._child->_cummulativeString;
-        bNodeStr = bNodeStr.drop_back(edgeStr.size()-n).copy(allocator);
-        auto *bNode = new (allocator) TrieNode(bNodeStr);
-        allNodes.push_back(bNode);
-        TrieNode* cNode = edge._child;
-        StringRef abEdgeStr = edgeStr.substr(0,n).copy(allocator);
-        StringRef bcEdgeStr = edgeStr.substr(n).copy(allocator);
-        DEBUG_WITH_TYPE("trie-builder", llvm::dbgs()
-                        << "splice in TrieNode('" << bNodeStr
-                        << "') between edge '"
-                        << abEdgeStr << "' and edge='"
-                        << bcEdgeStr<< "'\n");
-        TrieEdge& abEdge = edge;
-        abEdge._subString = abEdgeStr;
-        abEdge._child = bNode;
-        auto *bcEdge = new (allocator) TrieEdge(bcEdgeStr, cNode);
-        bNode->_children.insert(bNode->_children.end(), bcEdge);
-        bNode->addSymbol(entry, allocator, allNodes);
-        return;
-      }
-    }
+// Adds the node for the common prefix of length prefixLen of the given
+// names, which are sorted, followed by the subtrie below it. Returns the
+// index of the node.
+uint32_t TrieBuilder::addNode(size_t prefixLen,
+                              ArrayRef<const Export *> exports) {
+  uint32_t index = _nodes.size();
+  _nodes.emplace_back();
+
+  // The shortest name comes first, and may end at this node.
+  if (!exports.empty() && exports.front()->name.size() == prefixLen) {
+    _nodes[index].exp = exports.front();
+    while (!exports.empty() && exports.front()->name.size() == prefixLen)
+      exports = exports.drop_front();
   }
-  if (entry.flags & EXPORT_SYMBOL_FLAGS_REEXPORT) {
-    assert(entry.otherOffset != 0);
+
+  // Split the other names by their next character. Each group gets an edge
+  // that is labeled with the longest common prefix of its names. Because the
+  // names are sorted, that is the common prefix of the first and the last.
+  std::vector<std::pair<StringRef, ArrayRef<const Export *>>> groups;
+  while (!exports.empty()) {
+    StringRef first = exports.front()->name;
+    char next = first[prefixLen];
+    size_t n = 1;
+    while (n < exports.size() && exports[n]->name[prefixLen] == next)
+      ++n;
+    StringRef last = exports[n - 1]->name;
+    size_t len = prefixLen + 1;
+    while (len < first.size() && len < last.size() && first[len] == last[len])
+      ++len;
+    groups.push_back(std::make_pair(first.slice(prefixLen, len),
+                                    exports.take_front(n)));
+    exports = exports.drop_front(n);
   }
-  if (entry.flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER) {
-    assert(entry.otherOffset != 0);
+  assert(groups.size() < 256);
+
+  uint32_t firstEdge = _edges.size();
+  _nodes[index].firstEdge = firstEdge;
+  _nodes[index].numEdges = groups.size();
+  _edges.resize(firstEdge + groups.size());
+  for (size_t i = 0, e = groups.size(); i != e; ++i) {
+    StringRef subString = groups[i].first;
+    uint32_t child = addNode(prefixLen + subString.size(), groups[i].second);
+    _edges[firstEdge + i] = {subString, child};
   }
-  // No commonality with any existing child, make a new edge.
-  auto *newNode = new (allocator) TrieNode(entry.name.copy(allocator));
-  auto *newEdge = new (allocator) TrieEdge(partialStr, newNode);
-  _children.insert(_children.end(), newEdge);
-  DEBUG_WITH_TYPE("trie-builder", llvm::dbgs()
-                   << "new TrieNode('" << entry.name << "') with edge '"
-                   << partialStr << "' from node='"
-                   << _cummulativeString << "'\n");
-  newNode->_address = entry.offset;
-  newNode->_flags = entry.flags | entry.kind;
-  newNode->_other = entry.otherOffset;
-  if ((entry.flags & EXPORT_SYMBOL_FLAGS_REEXPORT) && !entry.otherName.empty())
-    newNode->_importedName = entry.otherName.copy(allocator);
-  newNode->_hasExportInfo = true;
-  allNodes.push_back(newNode);
+  return index;
 }
 
-void TrieNode::addOrderedNodes(const Export& entry,
-                               std::vector<TrieNode*> &orderedNodes) {
-  if (!_ordered) {
-    orderedNodes.push_back(this);
-    _ordered = true;
+// Returns the size of the export info of a node, not including the uleb128
+// size that precedes it.
+uint32_t TrieBuilder::exportInfoSize(const Export &exp) {
+  uint64_t flags = exp.flags | exp.kind;
+  if (flags & EXPORT_SYMBOL_FLAGS_REEXPORT) {
+    // flags, ordinal, import-name
+    return llvm::getULEB128Size(flags) + llvm::getULEB128Size(exp.otherOffset) +
+           exp.otherName.size() + 1;
   }
+  // flags, address, and for stubs with resolvers, other
+  uint32_t size =
+      llvm::getULEB128Size(flags) + llvm::getULEB128Size(exp.offset);
+  if (flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER)
+    size += llvm::getULEB128Size(exp.otherOffset);
+  return size;
+}
 
-  StringRef partialStr = entry.name.drop_front(_cummulativeString.size());
-  for (TrieEdge &edge : _children) {
-    StringRef edgeStr = edge._subString;
-    if (partialStr.startswith(edgeStr)) {
-      // Already have matching edge, go down that path.
-      edge._child->addOrderedNodes(entry, orderedNodes);
-      return;
+void TrieBuilder::writeTo(ByteBuffer &out) {
+  // The sizes of the export infos and edge strings do not change, so only
+  // the uleb128 sizes of the child offsets need to be recomputed when
+  // assigning offsets.
+  std::vector<uint32_t> fixedSizes(_nodes.size());
+  for (size_t i = 0, e = _nodes.size(); i != e; ++i) {
+    const Node &node = _nodes[i];
+    uint32_t size = 1; // Length when no export info
+    if (node.exp) {
+      uint32_t infoSize = exportInfoSize(*node.exp);
+      size = llvm::getULEB128Size(infoSize) + infoSize;
     }
+    ++size; // Byte for number of children.
+    for (uint32_t j = 0; j != node.numEdges; ++j)
+      size += _edges[node.firstEdge + j].subString.size() + 1;
+    fixedSizes[i] = size;
   }
-}
 
-bool TrieNode::updateOffset(uint32_t& offset) {
-  uint32_t nodeSize = 1; // Length when no export info
-  if (_hasExportInfo) {
-    if (_flags & EXPORT_SYMBOL_FLAGS_REEXPORT) {
-      nodeSize = llvm::getULEB128Size(_flags);
-      nodeSize += llvm::getULEB128Size(_other); // Other contains ordinal.
-      nodeSize += _importedName.size();
-      ++nodeSize; // Trailing zero in imported name.
-    } else {
-      nodeSize = llvm::getULEB128Size(_flags) + llvm::getULEB128Size(_address);
-      if (_flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER)
-        nodeSize += llvm::getULEB128Size(_other);
+  // Assign each node an offset in the trie stream, iterating until all
+  // uleb128 sizes have stabilized. Offsets only grow from one iteration to
+  // the next, so this takes a few cheap passes over the flat node array.
+  bool more;
+  do {
+    uint32_t offset = 0;
+    more = false;
+    for (size_t i = 0, e = _nodes.size(); i != e; ++i) {
+      Node &node = _nodes[i];
+      if (node.trieOffset != offset)
+        more = true;
+      node.trieOffset = offset;
+      offset += fixedSizes[i];
+      for (uint32_t j = 0; j != node.numEdges; ++j)
+        offset += llvm::getULEB128Size(
+            _nodes[_edges[node.firstEdge + j].child].trieOffset);
     }
-    // Overall node size so far is uleb128 of export info + actual export info.
-    nodeSize += llvm::getULEB128Size(nodeSize);
-  }
-  // Compute size of all child edges.
-  ++nodeSize; // Byte for number of chidren.
-  for (TrieEdge &edge : _children) {
-    nodeSize += edge._subString.size() + 1 // String length.
-              + llvm::getULEB128Size(edge._child->_trieOffset); // Offset len.
-  }
-  // On input, 'offset' is new prefered location for this node.
-  bool result = (_trieOffset != offset);
-  // Store new location in node object for use by parents.
-  _trieOffset = offset;
-  // Update offset for next iteration.
-  offset += nodeSize;
-  // Return true if _trieOffset was changed.
-  return result;
-}
+  } while (more);
 
-void TrieNode::appendToByteBuffer(ByteBuffer &out) {
-  if (_hasExportInfo) {
-    if (_flags & EXPORT_SYMBOL_FLAGS_REEXPORT) {
-      if (!_importedName.empty()) {
-        // nodes with re-export info: size, flags, ordinal, import-name
-        uint32_t nodeSize = llvm::getULEB128Size(_flags)
-                          + llvm::getULEB128Size(_other)
-                          + _importedName.size() + 1;
-        assert(nodeSize < 256);
-        out.append_byte(nodeSize);
-        out.append_uleb128(_flags);
-        out.append_uleb128(_other);
-        out.append_string(_importedName);
+  // Serialize the nodes.
+  for (const Node &node : _nodes) {
+    if (const Export *exp = node.exp) {
+      uint64_t flags = exp->flags | exp->kind;
+      out.append_uleb128(exportInfoSize(*exp));
+      out.append_uleb128(flags);
+      if (flags & EXPORT_SYMBOL_FLAGS_REEXPORT) {
+        // nodes with re-export info: flags, ordinal, import-name
+        assert(exp->otherOffset != 0);
+        out.append_uleb128(exp->otherOffset);
+        out.append_string(exp->otherName);
       } else {
-        // nodes without re-export info: size, flags, ordinal, empty-string
-        uint32_t nodeSize = llvm::getULEB128Size(_flags)
-                          + llvm::getULEB128Size(_other) + 1;
-        assert(nodeSize < 256);
-        out.append_byte(nodeSize);
-        out.append_uleb128(_flags);
-        out.append_uleb128(_other);
-        out.append_byte(0);
+        // Nodes with export info: flags, address, other
+        out.append_uleb128(exp->offset);
+        if (flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER) {
+          assert(exp->otherOffset != 0);
+          out.append_uleb128(exp->otherOffset);
+        }
       }
-    } else if ( _flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER ) {
-      // Nodes with export info: size, flags, address, other
-      uint32_t nodeSize = llvm::getULEB128Size(_flags)
-                        + llvm::getULEB128Size(_address)
-                        + llvm::getULEB128Size(_other);
-      assert(nodeSize < 256);
-      out.append_byte(nodeSize);
-      out.append_uleb128(_flags);
-      out.append_uleb128(_address);
-      out.append_uleb128(_other);
     } else {
-      // Nodes with export info: size, flags, address
-      uint32_t nodeSize = llvm::getULEB128Size(_flags)
-                        + llvm::getULEB128Size(_address);
-      assert(nodeSize < 256);
-      out.append_byte(nodeSize);
-      out.append_uleb128(_flags);
-      out.append_uleb128(_address);
+      // Node with no export info.
+      out.append_byte(0);
+    }
+    // Add number of children, and each child edge substring and node offset.
+    out.append_byte(node.numEdges);
+    for (uint32_t j = 0; j != node.numEdges; ++j) {
+      const Edge &edge = _edges[node.firstEdge + j];
+      out.append_string(edge.subString);
+      out.append_uleb128(_nodes[edge.child].trieOffset);
     }
-  } else {
-    // Node with no export info.
-    uint32_t nodeSize = 0;
-    out.append_byte(nodeSize);
-  }
-  // Add number of children.
-  assert(_children.size() < 256);
-  out.append_byte(_children.size());
-  // Append each child edge substring and node offset.
-  for (TrieEdge &edge : _children) {
-    out.append_string(edge._subString);
-    out.append_uleb128(edge._child->_trieOffset);
   }
 }
 
@@ -1427,40 +1591,16 @@ void MachOFileLayout::buildExportTrie() {
   if (_file.exportInfo.empty())
     return;
 
-  // For all temporary strings and objects used building trie.
-  BumpPtrAllocator allocator;
-
-  // Build trie of all exported symbols.
-  auto *rootNode = new (allocator) TrieNode(StringRef());
-  std::vector<TrieNode*> allNodes;
-  allNodes.reserve(_file.exportInfo.size()*2);
-  allNodes.push_back(rootNode);
-  for (const Export& entry : _file.exportInfo) {
-    rootNode->addSymbol(entry, allocator, allNodes);
-  }
-
-  std::vector<TrieNode*> orderedNodes;
-  orderedNodes.reserve(allNodes.size());
-
-  for (const Export& entry : _file.exportInfo)
-    rootNode->addOrderedNodes(entry, orderedNodes);
-
-  // Assign each node in the vector an offset in the trie stream, iterating
-  // until all uleb128 sizes have stabilized.
-  bool more;
-  do {
-    uint32_t offset = 0;
-    more = false;
-    for (TrieNode* node : orderedNodes) {
-      if (node->updateOffset(offset))
-        more = true;
-    }
-  } while (more);
+  std::vector<const Export *> exports;
+  exports.reserve(_file.exportInfo.size());
+  for (const Export &entry : _file.exportInfo)
+    exports.push_back(&entry);
+  std::stable_sort(exports.begin(), exports.end(),
+                   [](const Export *a, const Export *b) {
+                     return a->name < b->name;
+                   });
 
-  // Serialize trie to ByteBuffer.
-  for (TrieNode* node : orderedNodes) {
-    node->appendToByteBuffer(_exportTrie);
-  }
+  TrieBuilder(exports).writeTo(_exportTrie);
   _exportTrie.align(_is64 ? 8 : 4);
 }
 
@@ -1505,22 +1645,20 @@ void MachOFileLayout::computeDataInCodeSize() {
   _dataInCodeSize = _file.dataInCode.size() * sizeof(data_in_code_entry);
 }
 
-void MachOFileLayout::writeLinkEditContent() {
+void MachOFileLayout::addLinkEditWriters(
+    std::vector<std::function<void()>> &v) {
   if (_file.fileType == llvm::MachO::MH_OBJECT) {
-    writeRelocations();
-    writeFunctionStartsInfo();
-    writeDataInCodeInfo();
-    writeSymbolTable();
+    v.push_back([&] { writeRelocations(); });
   } else {
-    writeRebaseInfo();
-    writeBindingInfo();
-    writeLazyBindingInfo();
+    v.push_back([&] { writeRebaseInfo(); });
+    v.push_back([&] { writeBindingInfo(); });
+    v.push_back([&] { writeLazyBindingInfo(); });
     // TODO: add weak binding info
-    writeExportInfo();
-    writeFunctionStartsInfo();
-    writeDataInCodeInfo();
-    writeSymbolTable();
+    v.push_back([&] { writeExportInfo(); });
   }
+  v.push_back([&] { writeFunctionStartsInfo(); });
+  v.push_back([&] { writeDataInCodeInfo(); });
+  v.push_back([&] { writeSymbolTable(); });
 }
 
 llvm::Error MachOFileLayout::writeBinary(StringRef path) {
@@ -1541,8 +1679,12 @@ llvm::Error MachOFileLayout::writeBinary(StringRef path) {
   writeMachHeader();
   if (auto ec = writeLoadCommands())
     return ec;
-  writeSectionContent();
-  writeLinkEditContent();
+  // The section contents and the LINKEDIT regions have been laid out and do
+  // not overlap, so they are written in parallel.
+  std::vector<std::function<void()>> writers;
+  addSectionContentWriters(writers);
+  addLinkEditWriters(writers);
+  parallelForEach(writers, [](std::function<void()> &f) { f(); });
   if (Error E = fob->commit())
     return E;
 
@@ -21,9 +21,11 @@
 
 #include "ArchHandler.h"
 #include "DebugInfo.h"
+#include "Incremental.h"
 #include "MachONormalizedFile.h"
 #include "MachONormalizedFileBinaryUtils.h"
 #include "lld/Common/LLVM.h"
+#include "lld/Common/Threads.h"
 #include "lld/Core/Error.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSwitch.h"
@@ -121,6 +123,8 @@ public:
   void      copySectionInfo(NormalizedFile &file);
   void      updateSectionInfo(NormalizedFile &file);
   void      buildAtomToAddressMap();
+  void      recordPlacements(SectionInfo *sect,
+                             mach_o::IncrementalLinker *inc);
   llvm::Error synthesizeDebugNotes(NormalizedFile &file);
   llvm::Error addSymbols(const lld::File &atomFile, NormalizedFile &file);
   void      addIndirectSymbols(const lld::File &atomFile, NormalizedFile &file);
@@ -392,8 +396,11 @@ void Util::appendAtom(SectionInfo *sect, const DefinedAtom *atom) {
   // Assign atom to this section with this offset.
   AtomInfo ai = {atom, offset};
   sect->atomsAndOffsets.push_back(ai);
-  // Update section size to include this atom.
+  // Update section size to include this atom, and the room that
+  // -incremental leaves for it to grow.
   sect->size = offset + atom->size();
+  if (mach_o::IncrementalLinker *inc = _ctx.incrementalLinker())
+    sect->size += inc->getSlack(atom);
 }
 
 void Util::processDefinedAtoms(const lld::File &atomFile) {
@@ -660,13 +667,26 @@ void Util::copySectionContent(NormalizedFile &file) {
     return pos->second;
   };
 
+  llvm::DenseMap<const Atom *, uint64_t> atomToSectionAddress;
+  for (const SectionInfo *sectInfo : _sectionInfos)
+    for (const AtomInfo &atomInfo : sectInfo->atomsAndOffsets)
+      atomToSectionAddress[atomInfo.atom] = sectInfo->address;
+
   auto sectionAddrForAtom = [&] (const Atom &atom) -> uint64_t {
-    for (const SectionInfo *sectInfo : _sectionInfos)
-      for (const AtomInfo &atomInfo : sectInfo->atomsAndOffsets)
-        if (atomInfo.atom == &atom)
-          return sectInfo->address;
-    llvm_unreachable("atom not assigned to section");
+    auto pos = atomToSectionAddress.find(&atom);
+    if (pos == atomToSectionAddress.end())
+      llvm_unreachable("atom not assigned to section");
+    return pos->second;
+  };
+
+  // Once addresses are assigned, the content of each atom only depends on the
+  // atom itself, so allocate the section buffers first and then apply the
+  // fixups of all atoms in parallel.
+  struct AtomContent {
+    const DefinedAtom *atom;
+    llvm::MutableArrayRef<uint8_t> buffer;
   };
+  std::vector<AtomContent> contents;
 
   for (SectionInfo *si : _sectionInfos) {
     Section *normSect = &file.sections[si->normalizedSectionIndex];
@@ -679,6 +699,8 @@ void Util::copySectionContent(NormalizedFile &file) {
     llvm::MutableArrayRef<uint8_t> sectionContent;
     if (si->size) {
       uint8_t *sectContent = file.ownedAllocations.Allocate<uint8_t>(si->size);
+      // Zero the padding between atoms.
+      memset(sectContent, 0, si->size);
       sectionContent = llvm::MutableArrayRef<uint8_t>(sectContent, si->size);
       normSect->content = sectionContent;
     }
@@ -690,11 +712,15 @@ void Util::copySectionContent(NormalizedFile &file) {
       }
       auto atomContent = sectionContent.slice(ai.offsetInSection,
                                               ai.atom->size());
-      _archHandler.generateAtomContent(*ai.atom, r, addrForAtom,
-                                       sectionAddrForAtom, _ctx.baseAddress(),
-                                       atomContent);
+      contents.push_back({ai.atom, atomContent});
     }
   }
+
+  parallelForEach(contents, [&](const AtomContent &c) {
+    _archHandler.generateAtomContent(*c.atom, r, addrForAtom,
+                                     sectionAddrForAtom, _ctx.baseAddress(),
+                                     c.buffer);
+  });
 }
 
 void Util::copySectionInfo(NormalizedFile &file) {
@@ -735,10 +761,28 @@ void Util::copyEntryPointAddress(NormalizedFile &nFile) {
   }
 }
 
+/// Tells -incremental where the atoms of \p sect are, and how many bytes each
+/// of them may use, which is up to the next atom.
+void Util::recordPlacements(SectionInfo *sect,
+                            mach_o::IncrementalLinker *inc) {
+  std::vector<uint64_t> offsets;
+  for (const AtomInfo &info : sect->atomsAndOffsets)
+    offsets.push_back(info.offsetInSection);
+  std::sort(offsets.begin(), offsets.end());
+  for (const AtomInfo &info : sect->atomsAndOffsets) {
+    uint64_t offset = info.offsetInSection;
+    auto next = std::upper_bound(offsets.begin(), offsets.end(), offset);
+    uint64_t end = next == offsets.end() ? sect->size : *next;
+    inc->recordPlacement(info.atom, sect->address + offset, end - offset,
+                         sect->address);
+  }
+}
+
 void Util::buildAtomToAddressMap() {
   DEBUG_WITH_TYPE("WriterMachO-address", llvm::dbgs()
                    << "assign atom addresses:\n");
   const bool lookForEntry = _ctx.outputTypeHasEntry();
+  mach_o::IncrementalLinker *inc = _ctx.incrementalLinker();
   for (SectionInfo *sect : _sectionInfos) {
     for (const AtomInfo &info : sect->atomsAndOffsets) {
       _atomToAddress[info.atom] = sect->address + info.offsetInSection;
@@ -761,11 +805,17 @@ void Util::buildAtomToAddressMap() {
                       << info.atom->contentType()
                       << "\n");
     }
+    if (inc)
+      recordPlacements(sect, inc);
   }
   DEBUG_WITH_TYPE("WriterMachO-address", llvm::dbgs()
                   << "assign header alias atom addresses:\n");
   for (const Atom *atom : _machHeaderAliasAtoms) {
     _atomToAddress[atom] = _ctx.baseAddress();
+    if (inc)
+      if (auto *definedAtom = dyn_cast<DefinedAtom>(atom))
+        inc->recordPlacement(definedAtom, _ctx.baseAddress(), 0,
+                             _ctx.baseAddress());
 #ifndef NDEBUG
     if (auto *definedAtom = dyn_cast<DefinedAtom>(atom)) {
       DEBUG_WITH_TYPE("WriterMachO-address", llvm::dbgs()
@@ -1419,6 +1419,13 @@ dylibToAtoms(const NormalizedFile &normalizedFile, StringRef path,
 
 } // anonymous namespace
 
+llvm::BumpPtrAllocator &MachODefinedAtom::referenceAllocator() const {
+  // Atoms of other files, such as the linker-defined symbols, are not packed.
+  if (const auto *machoFile = dyn_cast<MachOFile>(&file()))
+    return machoFile->referenceAllocator();
+  return file().allocator();
+}
+
 namespace normalized {
 
 static bool isObjCImageInfo(const Section &sect) {
@@ -1553,6 +1560,9 @@ normalizedObjectToAtoms(MachOFile *file,
   if (auto err = parseDebugInfo(*file, normalizedFile, copyRefs))
     return err;
 
+  // No more references are added while parsing, so store them compactly.
+  file->packReferences();
+
   return llvm::Error::success();
 }
 
@@ -9,19 +9,40 @@
 #ifndef LLD_READER_WRITER_MACHO_PASSES_H
 #define LLD_READER_WRITER_MACHO_PASSES_H
 
+#include "lld/Core/DefinedAtom.h"
 #include "lld/Core/PassManager.h"
+#include "lld/Core/Reference.h"
 #include "lld/ReaderWriter/MachOLinkingContext.h"
+#include <utility>
+#include <vector>
 
 namespace lld {
 namespace mach_o {
 
+/// A reference and the atom that contains it.
+typedef std::pair<const DefinedAtom *, const Reference *> AtomReference;
+
+/// The references that the stubs, GOT, TLV and shim passes rewrite, in atom
+/// order. They are found by a single scan over the merged file.
+struct ReferenceUses {
+  std::vector<AtomReference> callSites;
+  std::vector<AtomReference> gotAccesses;
+  std::vector<AtomReference> tlvAccesses;
+  std::vector<AtomReference> nonCallBranches;
+};
+
 void addLayoutPass(PassManager &pm, const MachOLinkingContext &ctx);
-void addStubsPass(PassManager &pm, const MachOLinkingContext &ctx);
-void addGOTPass(PassManager &pm, const MachOLinkingContext &ctx);
-void addTLVPass(PassManager &pm, const MachOLinkingContext &ctx);
+void addReferencePasses(PassManager &pm, const MachOLinkingContext &ctx);
+void addStubsPass(PassManager &pm, const MachOLinkingContext &ctx,
+                  const ReferenceUses &uses);
+void addGOTPass(PassManager &pm, const MachOLinkingContext &ctx,
+                const ReferenceUses &uses);
+void addTLVPass(PassManager &pm, const MachOLinkingContext &ctx,
+                const ReferenceUses &uses);
 void addCompactUnwindPass(PassManager &pm, const MachOLinkingContext &ctx);
 void addObjCPass(PassManager &pm, const MachOLinkingContext &ctx);
-void addShimPass(PassManager &pm, const MachOLinkingContext &ctx);
+void addShimPass(PassManager &pm, const MachOLinkingContext &ctx,
+                 const ReferenceUses &uses);
 
 } // namespace mach_o
 } // namespace lld
@@ -0,0 +1,109 @@
+//===- lib/ReaderWriter/MachO/ReferenceScanPass.cpp -------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This linker pass finds all references that the stubs, GOT, TLV and shim
+/// passes rewrite, in a single traversal of the merged file. Visiting every
+/// reference of every atom is the expensive part of those passes, so they
+/// share the result of this scan instead of each doing their own.
+///
+/// The atoms are scanned in parallel in fixed-size chunks. The results of
+/// the chunks are concatenated in atom order, so the passes see the same
+/// references in the same order as they would with a serial scan.
+///
+//===----------------------------------------------------------------------===//
+
+#include "ArchHandler.h"
+#include "MachOPasses.h"
+#include "lld/Common/LLVM.h"
+#include "lld/Common/Threads.h"
+#include "lld/Core/DefinedAtom.h"
+#include "lld/Core/File.h"
+#include "lld/Core/Reference.h"
+#include "lld/Core/Simple.h"
+#include <algorithm>
+
+namespace lld {
+namespace mach_o {
+
+class ReferenceScanPass : public Pass {
+public:
+  ReferenceScanPass(const MachOLinkingContext &context)
+      : _ctx(context), _archHandler(_ctx.archHandler()) {}
+
+  const ReferenceUses &uses() const { return _uses; }
+
+  llvm::Error perform(SimpleFile &mergedFile) override {
+    const auto defined = mergedFile.defined();
+    const size_t chunkSize = 1024;
+    std::vector<ReferenceUses> chunks((defined.size() + chunkSize - 1) /
+                                      chunkSize);
+
+    // Only look for the references of the passes that will run.
+    bool stubs = _ctx.needsStubsPass();
+    bool got = _ctx.needsGOTPass();
+    bool tlv = _ctx.needsTLVPass();
+    bool shims = _ctx.needsShimPass();
+
+    parallelForEachN(0, chunks.size(), [&](size_t i) {
+      ReferenceUses &uses = chunks[i];
+      size_t end = std::min(defined.size(), (i + 1) * chunkSize);
+      for (size_t j = i * chunkSize; j != end; ++j) {
+        const DefinedAtom *atom = defined[j].get();
+        for (const Reference *ref : *atom) {
+          AtomReference use = std::make_pair(atom, ref);
+          bool canBypassGOT;
+          if (stubs && _archHandler.isCallSite(*ref))
+            uses.callSites.push_back(use);
+          if (got && _archHandler.isGOTAccess(*ref, canBypassGOT))
+            uses.gotAccesses.push_back(use);
+          if (tlv && _archHandler.isTLVAccess(*ref))
+            uses.tlvAccesses.push_back(use);
+          if (shims && _archHandler.isNonCallBranch(*ref))
+            uses.nonCallBranches.push_back(use);
+        }
+      }
+    });
+
+    _uses = ReferenceUses();
+    for (const ReferenceUses &chunk : chunks) {
+      append(_uses.callSites, chunk.callSites);
+      append(_uses.gotAccesses, chunk.gotAccesses);
+      append(_uses.tlvAccesses, chunk.tlvAccesses);
+      append(_uses.nonCallBranches, chunk.nonCallBranches);
+    }
+    return llvm::Error::success();
+  }
+
+private:
+  static void append(std::vector<AtomReference> &to,
+                     const std::vector<AtomReference> &from) {
+    to.insert(to.end(), from.begin(), from.end());
+  }
+
+  const MachOLinkingContext &_ctx;
+  mach_o::ArchHandler       &_archHandler;
+  ReferenceUses              _uses;
+};
+
+void addReferencePasses(PassManager &pm, const MachOLinkingContext &ctx) {
+  auto scan = std::make_unique<ReferenceScanPass>(ctx);
+  const ReferenceUses &uses = scan->uses();
+  pm.add(std::move(scan));
+  if (ctx.needsStubsPass())
+    addStubsPass(pm, ctx, uses);
+  if (ctx.needsGOTPass())
+    addGOTPass(pm, ctx, uses);
+  if (ctx.needsTLVPass())
+    addTLVPass(pm, ctx, uses);
+  if (ctx.needsShimPass())
+    addShimPass(pm, ctx, uses); // Shim pass must run after stubs pass.
+}
+
+} // end namespace mach_o
+} // end namespace lld
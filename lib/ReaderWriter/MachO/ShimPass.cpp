@@ -39,28 +39,26 @@ namespace mach_o {
 
 class ShimPass : public Pass {
 public:
-  ShimPass(const MachOLinkingContext &context)
+  ShimPass(const MachOLinkingContext &context, const ReferenceUses &uses)
       : _ctx(context), _archHandler(_ctx.archHandler()),
-        _stubInfo(_archHandler.stubInfo()),
+        _stubInfo(_archHandler.stubInfo()), _uses(uses),
         _file(*_ctx.make_file<MachOFile>("<mach-o shim pass>")) {
     _file.setOrdinal(_ctx.getNextOrdinalAndIncrement());
   }
 
   llvm::Error perform(SimpleFile &mergedFile) override {
-    // Scan all references in all atoms.
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      for (const Reference *ref : *atom) {
-        // Look at non-call branches.
-        if (!_archHandler.isNonCallBranch(*ref))
-          continue;
-        const Atom *target = ref->target();
-        assert(target != nullptr);
-        if (const lld::DefinedAtom *daTarget = dyn_cast<DefinedAtom>(target)) {
-          bool atomIsThumb = _archHandler.isThumbFunction(*atom);
-          bool targetIsThumb = _archHandler.isThumbFunction(*daTarget);
-          if (atomIsThumb != targetIsThumb)
-            updateBranchToUseShim(atomIsThumb, *daTarget, ref);
-        }
+    // Look at non-call branches. The stubs pass has already run, so their
+    // targets may have been switched to stubs.
+    for (const AtomReference &use : _uses.nonCallBranches) {
+      const DefinedAtom *atom = use.first;
+      const Reference *ref = use.second;
+      const Atom *target = ref->target();
+      assert(target != nullptr);
+      if (const lld::DefinedAtom *daTarget = dyn_cast<DefinedAtom>(target)) {
+        bool atomIsThumb = _archHandler.isThumbFunction(*atom);
+        bool targetIsThumb = _archHandler.isThumbFunction(*daTarget);
+        if (atomIsThumb != targetIsThumb)
+          updateBranchToUseShim(atomIsThumb, *daTarget, ref);
       }
     }
     // Exit early if no shims needed.
@@ -114,14 +112,16 @@ private:
   const MachOLinkingContext &_ctx;
   mach_o::ArchHandler                            &_archHandler;
   const ArchHandler::StubInfo                    &_stubInfo;
+  const ReferenceUses                            &_uses;
   MachOFile                                      &_file;
   llvm::DenseMap<const Atom*, const DefinedAtom*> _targetToShim;
 };
 
 
 
-void addShimPass(PassManager &pm, const MachOLinkingContext &ctx) {
-  pm.add(std::make_unique<ShimPass>(ctx));
+void addShimPass(PassManager &pm, const MachOLinkingContext &ctx,
+                 const ReferenceUses &uses) {
+  pm.add(std::make_unique<ShimPass>(ctx, uses));
 }
 
 } // end namespace mach_o
@@ -207,9 +207,9 @@ private:
 
 class StubsPass : public Pass {
 public:
-  StubsPass(const MachOLinkingContext &context)
+  StubsPass(const MachOLinkingContext &context, const ReferenceUses &uses)
       : _ctx(context), _archHandler(_ctx.archHandler()),
-        _stubInfo(_archHandler.stubInfo()),
+        _stubInfo(_archHandler.stubInfo()), _uses(uses),
         _file(*_ctx.make_file<MachOFile>("<mach-o Stubs pass>")) {
     _file.setOrdinal(_ctx.getNextOrdinalAndIncrement());
   }
@@ -219,26 +219,22 @@ public:
     if (!this->noTextRelocs())
       return llvm::Error::success();
 
-    // Scan all references in all atoms.
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      for (const Reference *ref : *atom) {
-        // Look at call-sites.
-        if (!this->isCallSite(*ref))
-          continue;
-        const Atom *target = ref->target();
-        assert(target != nullptr);
-        if (isa<SharedLibraryAtom>(target)) {
-          // Calls to shared libraries go through stubs.
-          _targetToUses[target].push_back(ref);
-          continue;
-        }
-        const DefinedAtom *defTarget = dyn_cast<DefinedAtom>(target);
-        if (defTarget && defTarget->interposable() != DefinedAtom::interposeNo){
-          // Calls to interposable functions in same linkage unit must also go
-          // through a stub.
-          assert(defTarget->scope() != DefinedAtom::scopeTranslationUnit);
-          _targetToUses[target].push_back(ref);
-        }
+    // Look at all call-sites.
+    for (const AtomReference &use : _uses.callSites) {
+      const Reference *ref = use.second;
+      const Atom *target = ref->target();
+      assert(target != nullptr);
+      if (isa<SharedLibraryAtom>(target)) {
+        // Calls to shared libraries go through stubs.
+        _targetToUses[target].push_back(ref);
+        continue;
+      }
+      const DefinedAtom *defTarget = dyn_cast<DefinedAtom>(target);
+      if (defTarget && defTarget->interposable() != DefinedAtom::interposeNo) {
+        // Calls to interposable functions in same linkage unit must also go
+        // through a stub.
+        assert(defTarget->scope() != DefinedAtom::scopeTranslationUnit);
+        _targetToUses[target].push_back(ref);
       }
     }
 
@@ -329,10 +325,6 @@ private:
     return true;
   }
 
-  bool isCallSite(const Reference &ref) {
-    return _archHandler.isCallSite(ref);
-  }
-
   void addReference(SimpleDefinedAtom* atom,
                     const ArchHandler::ReferenceInfo &refInfo,
                     const lld::Atom* target) {
@@ -365,12 +357,14 @@ private:
   const MachOLinkingContext &_ctx;
   mach_o::ArchHandler                            &_archHandler;
   const ArchHandler::StubInfo                    &_stubInfo;
+  const ReferenceUses                            &_uses;
   MachOFile                                      &_file;
   TargetToUses                                    _targetToUses;
 };
 
-void addStubsPass(PassManager &pm, const MachOLinkingContext &ctx) {
-  pm.add(std::unique_ptr<Pass>(new StubsPass(ctx)));
+void addStubsPass(PassManager &pm, const MachOLinkingContext &ctx,
+                  const ReferenceUses &uses) {
+  pm.add(std::unique_ptr<Pass>(new StubsPass(ctx, uses)));
 }
 
 } // end namespace mach_o
@@ -64,8 +64,8 @@ private:
 
 class TLVPass : public Pass {
 public:
-  TLVPass(const MachOLinkingContext &context)
-      : _ctx(context), _archHandler(_ctx.archHandler()),
+  TLVPass(const MachOLinkingContext &context, const ReferenceUses &uses)
+      : _ctx(context), _archHandler(_ctx.archHandler()), _uses(uses),
         _file(*_ctx.make_file<MachOFile>("<mach-o TLV pass>")) {
     _file.setOrdinal(_ctx.getNextOrdinalAndIncrement());
   }
@@ -74,24 +74,22 @@ private:
   llvm::Error perform(SimpleFile &mergedFile) override {
     bool allowTLV = _ctx.minOS("10.7", "1.0");
 
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      for (const Reference *ref : *atom) {
-        if (!_archHandler.isTLVAccess(*ref))
-          continue;
+    for (const AtomReference &use : _uses.tlvAccesses) {
+      const DefinedAtom *atom = use.first;
+      const Reference *ref = use.second;
 
-        if (!allowTLV)
-          return llvm::make_error<GenericError>(
-            "targeted OS version does not support use of thread local "
-            "variables in " + atom->name() + " for architecture " +
-            _ctx.archName());
+      if (!allowTLV)
+        return llvm::make_error<GenericError>(
+          "targeted OS version does not support use of thread local "
+          "variables in " + atom->name() + " for architecture " +
+          _ctx.archName());
 
-        const Atom *target = ref->target();
-        assert(target != nullptr);
+      const Atom *target = ref->target();
+      assert(target != nullptr);
 
-        const DefinedAtom *tlvpEntry = makeTLVPEntry(target);
-        const_cast<Reference*>(ref)->setTarget(tlvpEntry);
-        _archHandler.updateReferenceToTLV(ref);
-      }
+      const DefinedAtom *tlvpEntry = makeTLVPEntry(target);
+      const_cast<Reference*>(ref)->setTarget(tlvpEntry);
+      _archHandler.updateReferenceToTLV(ref);
     }
 
     std::vector<const TLVPEntryAtom*> entries;
@@ -127,13 +125,15 @@ private:
 
   const MachOLinkingContext &_ctx;
   mach_o::ArchHandler &_archHandler;
+  const ReferenceUses &_uses;
   MachOFile           &_file;
   llvm::DenseMap<const Atom*, const TLVPEntryAtom*> _targetToTLVP;
 };
 
-void addTLVPass(PassManager &pm, const MachOLinkingContext &ctx) {
+void addTLVPass(PassManager &pm, const MachOLinkingContext &ctx,
+                const ReferenceUses &uses) {
   assert(ctx.needsTLVPass());
-  pm.add(std::make_unique<TLVPass>(ctx));
+  pm.add(std::make_unique<TLVPass>(ctx, uses));
 }
 
 } // end namesapce mach_o
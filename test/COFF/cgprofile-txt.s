@@ -0,0 +1,59 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc %s -o %t.obj
+
+# RUN: lld-link /subsystem:console /entry:A /opt:noref %t.obj /out:%t.exe \
+# RUN:   /lldmap:- | FileCheck --check-prefix=NOSORT %s
+
+# RUN: echo "D C 100" > %t.call_graph
+# RUN: echo "A B 10" >> %t.call_graph
+# RUN: echo "A missing 10" >> %t.call_graph
+# RUN: lld-link /subsystem:console /entry:A /opt:noref %t.obj /out:%t.exe \
+# RUN:   /call-graph-ordering-file:%t.call_graph /lldmap:- 2>&1 | FileCheck %s
+
+# RUN: lld-link /subsystem:console /entry:A /opt:noref %t.obj /out:%t.exe \
+# RUN:   /call-graph-ordering-file:%t.call_graph \
+# RUN:   /call-graph-profile-sort:no /lldmap:- | \
+# RUN:   FileCheck --check-prefix=NOSORT %s
+
+# RUN: echo "fn1" > %t.order
+# RUN: not lld-link /subsystem:console /entry:A %t.obj /out:%t.exe \
+# RUN:   /call-graph-ordering-file:%t.call_graph /order:@%t.order 2>&1 | \
+# RUN:   FileCheck --check-prefix=ORDER %s
+# ORDER: /order and /call-graph-ordering-file may not be used together
+
+# RUN: echo "A B" > %t.bad
+# RUN: not lld-link /subsystem:console /entry:A %t.obj /out:%t.exe \
+# RUN:   /call-graph-ordering-file:%t.bad 2>&1 | \
+# RUN:   FileCheck --check-prefix=PARSE %s
+# PARSE: {{.*}}.bad: parse error
+
+# NOSORT: {{ }}A{{$}}
+# NOSORT: {{ }}B{{$}}
+# NOSORT: {{ }}C{{$}}
+# NOSORT: {{ }}D{{$}}
+
+# CHECK: warning: {{.*}}.call_graph: no such symbol: missing
+# CHECK: {{ }}D{{$}}
+# CHECK: {{ }}C{{$}}
+# CHECK: {{ }}A{{$}}
+# CHECK: {{ }}B{{$}}
+
+    .section .text,"xr",one_only,A
+    .globl A
+A:
+    retq
+
+    .section .text,"xr",one_only,B
+    .globl B
+B:
+    retq
+
+    .section .text,"xr",one_only,C
+    .globl C
+C:
+    retq
+
+    .section .text,"xr",one_only,D
+    .globl D
+D:
+    retq
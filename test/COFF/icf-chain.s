@@ -0,0 +1,68 @@
+# REQUIRES: x86
+# RUN: llvm-mc -triple=x86_64-windows-msvc %s -filetype=obj -o %t.obj
+# RUN: lld-link -entry:main %t.obj -out:%t.exe -verbose > %t.log 2>&1
+# RUN: FileCheck %s < %t.log
+# RUN: FileCheck --check-prefix=NOT %s < %t.log
+
+## c1 and c2 differ, which splits the classes of b1/b2/b3 and then of
+## a1/a2/a3 in later iterations. Only the chains ending in c1 are folded.
+
+# CHECK-DAG: Removed a3
+# CHECK-DAG: Removed b3
+# NOT-NOT: Removed {{a2|b2|c1|c2}}
+
+.text
+.globl main
+main:
+  call a1
+  call a2
+  call a3
+  ret
+
+.section .text,"xr",one_only,a1
+.globl a1
+a1:
+  call b1
+  ret
+
+.section .text,"xr",one_only,a2
+.globl a2
+a2:
+  call b2
+  ret
+
+.section .text,"xr",one_only,a3
+.globl a3
+a3:
+  call b3
+  ret
+
+.section .text,"xr",one_only,b1
+.globl b1
+b1:
+  call c1
+  ret
+
+.section .text,"xr",one_only,b2
+.globl b2
+b2:
+  call c2
+  ret
+
+.section .text,"xr",one_only,b3
+.globl b3
+b3:
+  call c1
+  ret
+
+.section .text,"xr",one_only,c1
+.globl c1
+c1:
+  movl $1, %eax
+  ret
+
+.section .text,"xr",one_only,c2
+.globl c2
+c2:
+  movl $2, %eax
+  ret
@@ -0,0 +1,38 @@
+# REQUIRES: x86
+# RUN: llvm-mc %s -triple x86_64-windows-msvc -filetype=obj -o %t1.obj
+# RUN: llvm-mc %s -triple x86_64-windows-msvc -filetype=obj --defsym OBJ2=1 \
+# RUN:   -o %t2.obj
+# RUN: lld-link %t1.obj %t2.obj -dll -noentry -out:%t.dll \
+# RUN:   -merge:.xdata=.xdata
+# RUN: llvm-readobj --sections %t.dll | FileCheck %s
+# RUN: lld-link %t1.obj %t2.obj -dll -noentry -out:%t.noicf.dll \
+# RUN:   -merge:.xdata=.xdata -opt:noicf
+# RUN: llvm-readobj --sections %t.noicf.dll | FileCheck --check-prefix=NOICF %s
+
+## The functions are not COMDAT, so each object has one non-COMDAT .xdata
+## section. The sections are identical, so one of them is folded.
+# CHECK:      Name: .pdata
+# CHECK-NEXT: VirtualSize: 0x18
+# CHECK:      Name: .xdata
+# CHECK-NEXT: VirtualSize: 0x8
+
+# NOICF:      Name: .xdata
+# NOICF-NEXT: VirtualSize: 0x10
+
+	.text
+.ifdef OBJ2
+	.globl	f2
+f2:
+.seh_proc f2
+.else
+	.globl	f1
+f1:
+.seh_proc f1
+.endif
+	subq	$40, %rsp
+	.seh_stackalloc 40
+	.seh_endprologue
+	nop
+	addq	$40, %rsp
+	retq
+	.seh_endproc
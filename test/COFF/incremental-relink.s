@@ -0,0 +1,129 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc --defsym MAIN=1 %s \
+# RUN:   -o %t.main.obj
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc %s -o %t.foo.obj
+# RUN: rm -f %t.ilk
+
+# RUN: lld-link -incremental -opt:noref,noicf -verbose -entry:main \
+# RUN:   -subsystem:console -out:%t.exe %t.main.obj %t.foo.obj 2>&1 | \
+# RUN:   FileCheck --check-prefix=FULL %s
+# RUN: llvm-readobj --coff-basereloc %t.exe | FileCheck --check-prefix=RELOC1 %s
+
+# FULL: incremental: no state from a previous link; doing a full link
+
+# RELOC1:      BaseReloc [
+# RELOC1-NEXT:   Entry {
+# RELOC1-NEXT:     Type: DIR64
+# RELOC1-NEXT:     Address: 0x2000
+# RELOC1-NEXT:   }
+# RELOC1-NEXT:   Entry {
+# RELOC1-NEXT:     Type: ABSOLUTE
+# RELOC1-NEXT:     Address: 0x2000
+# RELOC1-NEXT:   }
+# RELOC1-NEXT: ]
+
+## Nothing changed.
+# RUN: lld-link -incremental -opt:noref,noicf -verbose -entry:main \
+# RUN:   -subsystem:console -out:%t.exe %t.main.obj %t.foo.obj 2>&1 | \
+# RUN:   FileCheck --check-prefix=UPTODATE %s
+
+# UPTODATE: incremental: output is up to date
+
+## foo grows within the room after it and gets a new base relocation.
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc --defsym GROW=1 %s \
+# RUN:   -o %t.foo.obj
+# RUN: lld-link -incremental -opt:noref,noicf -verbose -entry:main \
+# RUN:   -subsystem:console -out:%t.exe %t.main.obj %t.foo.obj 2>&1 | \
+# RUN:   FileCheck --check-prefix=PATCH %s
+# RUN: llvm-objdump -d %t.exe | FileCheck --check-prefix=DIS %s
+# RUN: llvm-readobj --coff-basereloc %t.exe | FileCheck --check-prefix=RELOC2 %s
+
+# PATCH-NOT: doing a full link
+# PATCH:     incremental: patched {{.*}}.foo.obj
+# PATCH-NOT: doing a full link
+
+# DIS:      nop
+# DIS-NEXT: nop
+# DIS-NEXT: movabsq $0x14000200{{[0-9a-f]}}, %rax
+# DIS-NEXT: retq
+# DIS-NEXT: int3
+
+# RELOC2:      BaseReloc [
+# RELOC2-NEXT:   Entry {
+# RELOC2-NEXT:     Type: DIR64
+# RELOC2-NEXT:     Address: 0x1{{[0-9A-F]+}}
+# RELOC2-NEXT:   }
+# RELOC2-NEXT:   Entry {
+# RELOC2-NEXT:     Type: ABSOLUTE
+# RELOC2-NEXT:     Address: 0x1000
+# RELOC2-NEXT:   }
+# RELOC2-NEXT:   Entry {
+# RELOC2-NEXT:     Type: DIR64
+# RELOC2-NEXT:     Address: 0x2000
+# RELOC2-NEXT:   }
+# RELOC2-NEXT:   Entry {
+# RELOC2-NEXT:     Type: ABSOLUTE
+# RELOC2-NEXT:     Address: 0x2000
+# RELOC2-NEXT:   }
+# RELOC2-NEXT: ]
+
+## foo outgrows its room.
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc --defsym BIG=1 %s \
+# RUN:   -o %t.foo.obj
+# RUN: lld-link -incremental -opt:noref,noicf -verbose -entry:main \
+# RUN:   -subsystem:console -out:%t.exe %t.main.obj %t.foo.obj 2>&1 | \
+# RUN:   FileCheck --check-prefix=GROWN %s
+
+# GROWN: incremental: {{.*}}.foo.obj: .text grew too much; doing a full link
+
+## A new external symbol changes the symbol table.
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc --defsym BAR=1 %s \
+# RUN:   -o %t.foo.obj
+# RUN: lld-link -incremental -opt:noref,noicf -verbose -entry:main \
+# RUN:   -subsystem:console -out:%t.exe %t.main.obj %t.foo.obj 2>&1 | \
+# RUN:   FileCheck --check-prefix=SYMTAB %s
+
+# SYMTAB: incremental: {{.*}}.foo.obj: the section or symbol table changed;
+
+## /debug is not supported, and the link state is removed.
+# RUN: lld-link -incremental -opt:noref,noicf -verbose -debug -entry:main \
+# RUN:   -subsystem:console -out:%t.exe %t.main.obj %t.foo.obj 2>&1 | \
+# RUN:   FileCheck --check-prefix=DEBUG %s
+# RUN: not ls %t.ilk
+
+# DEBUG: incremental: /debug is not supported; doing a full link
+# DEBUG: incremental: /debug is not supported; not saving the link state
+
+.ifdef MAIN
+  .text
+  .globl main
+main:
+  callq foo
+  retq
+
+  .data
+ptr:
+  .quad main
+.else
+  .text
+  .globl foo
+foo:
+.ifdef GROW
+  nop
+  nop
+  movabsq $foo_data, %rax
+.endif
+.ifdef BIG
+  .fill 64, 1, 0x90
+.endif
+  retq
+.ifdef BAR
+  .globl bar
+bar:
+  retq
+.endif
+
+  .data
+foo_data:
+  .long 1
+.endif
@@ -0,0 +1,59 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc --defsym MAIN=1 %s \
+# RUN:   -o %t.main.obj
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc --defsym FOO=1 %s \
+# RUN:   -o %t.foo.obj
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc --defsym BAR=1 %s \
+# RUN:   -o %t.bar.obj
+# RUN: rm -f %t.lib
+# RUN: llvm-ar rcs %t.lib %t.bar.obj
+
+## Object files are parsed in parallel, but the result must not depend on it.
+# RUN: lld-link -entry:main -subsystem:console -out:%t1.exe -verbose \
+# RUN:   %t.main.obj %t.lib %t.foo.obj 2>&1 | FileCheck %s
+# RUN: lld-link -entry:main -subsystem:console -out:%t2.exe -threads:no \
+# RUN:   %t.main.obj %t.lib %t.foo.obj
+# RUN: cmp %t1.exe %t2.exe
+# RUN: llvm-objdump -d %t1.exe | FileCheck --check-prefix=DIS %s
+
+# CHECK:      Reading {{.*}}.main.obj
+# CHECK-NEXT: Reading {{.*}}.lib
+# CHECK-NEXT: Reading {{.*}}.foo.obj
+# CHECK:      Reading {{.*}}.bar.obj
+# CHECK-NEXT: Loaded {{.*}}.bar.obj for bar
+
+## The COMDAT from main.obj, which comes first, is chosen.
+# DIS:      <f>:
+# DIS-NEXT: movl $1, %eax
+
+.section .text,"xr",one_only,f
+.globl f
+f:
+.ifdef MAIN
+  movl $1, %eax
+.else
+  movl $2, %eax
+.endif
+  retq
+
+.text
+.ifdef MAIN
+.globl main
+main:
+  callq foo
+  callq bar
+  callq f
+  retq
+.endif
+
+.ifdef FOO
+.globl foo
+foo:
+  retq
+.endif
+
+.ifdef BAR
+.globl bar
+bar:
+  retq
+.endif
@@ -0,0 +1,35 @@
+; REQUIRES: x86
+; RUN: rm -fr %t && mkdir %t && cd %t
+; RUN: opt -thinlto-bc -o main.obj %s
+; RUN: opt -thinlto-bc -o foo.obj %S/Inputs/lto-dep.ll
+
+;; Each backend job is run by the command, which creates the native object
+;; that is linked in.
+; RUN: lld-link -out:main.exe -entry:main -subsystem:console main.obj foo.obj \
+; RUN:   "-thinlto-backend-command:llc -filetype=obj %%module -o %%out"
+; RUN: ls main.obj.thinlto.bc foo.obj.thinlto.bc
+; RUN: llvm-nm main.obj.thinlto.obj | FileCheck --check-prefix=MAIN %s
+; RUN: llvm-objdump -d main.exe | FileCheck --check-prefix=DIS %s
+
+; MAIN: U foo
+; DIS: <foo>:
+
+; RUN: not lld-link -out:main.exe -entry:main -subsystem:console \
+; RUN:   main.obj foo.obj -thinlto-backend-command:no-such-program 2>&1 | \
+; RUN:   FileCheck --check-prefix=NOPROG %s
+; NOPROG: -thinlto-backend-command: cannot find no-such-program
+
+; RUN: not lld-link -out:main.exe -entry:main -subsystem:console \
+; RUN:   main.obj foo.obj -thinlto-index-only -thinlto-backend-command:llc \
+; RUN:   2>&1 | FileCheck --check-prefix=INDEX %s
+; INDEX: -thinlto-backend-command: cannot be used with -thinlto-index-only
+
+target datalayout = "e-m:w-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-windows-msvc"
+
+define i32 @main() {
+  call void @foo()
+  ret i32 0
+}
+
+declare void @foo()
@@ -0,0 +1,39 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-msvc %s -o %t.obj
+
+## The default output file name.
+# RUN: lld-link -entry:main -out:%t1.exe -time-trace \
+# RUN:   -time-trace-granularity:0 %t.obj
+# RUN: FileCheck --input-file=%t1.exe.time-trace %s
+
+## A specified output file name.
+# RUN: lld-link -entry:main -out:%t2.exe -time-trace \
+# RUN:   -time-trace-file:%t2.json -time-trace-granularity:0 %t.obj
+# RUN: FileCheck --input-file=%t2.json %s
+
+# CHECK:     "traceEvents": [
+# CHECK-DAG: "name": "Input File Reading"
+# CHECK-DAG: "name": "Code Layout"
+# CHECK-DAG: "name": "Total Link Time"
+# CHECK-DAG: "detail": "arena memory: {{[0-9]+}} bytes"
+
+## With /print-arena-usage, /time reports the arena memory after each
+## top-level phase.
+# RUN: lld-link -entry:main -out:%t3.exe -time -print-arena-usage %t.obj | \
+# RUN:   FileCheck --check-prefix=TIME %s
+# RUN: lld-link -entry:main -out:%t3.exe -time %t.obj | \
+# RUN:   FileCheck --check-prefix=NOARENA %s
+
+# TIME: Input File Reading: {{.*}} MB arena
+# TIME: Total Link Time: {{.*}} MB arena
+
+# NOARENA: Input File Reading:
+# NOARENA-NOT: MB arena
+
+# RUN: not lld-link -entry:main -out:%t4.exe -time-trace-granularity:x \
+# RUN:   %t.obj 2>&1 | FileCheck --check-prefix=ERR %s
+# ERR: -time-trace-granularity: number expected, but got x
+
+.globl main
+main:
+  retq
@@ -0,0 +1,16 @@
+# Prints the value of --build-id=sha1 for a little-endian output file, which
+# is computed as the SHA-1 of the SHA-1s of its 1 MiB chunks with the build
+# ID itself zeroed.
+import hashlib
+import struct
+import sys
+
+data = bytearray(open(sys.argv[1], 'rb').read())
+header = struct.pack('<III', 4, 20, 3) + b'GNU\0'
+offset = data.index(header) + len(header)
+data[offset:offset + 20] = b'\0' * 20
+
+chunkSize = 1024 * 1024
+hashes = b''.join(hashlib.sha1(data[i:i + chunkSize]).digest()
+                  for i in range(0, len(data), chunkSize))
+print(hashlib.sha1(hashes).hexdigest())
@@ -0,0 +1,73 @@
+.section .debug_str,"MS",@progbits,1
+.Lstr_foo:
+  .asciz "foo"
+.Lstr_shared:
+  .asciz "shared"
+
+.section .debug_abbrev,"",@progbits
+  .byte 1                         # Abbreviation code
+  .byte 0x11                      # DW_TAG_compile_unit
+  .byte 1                         # DW_CHILDREN_yes
+  .byte 0, 0
+  .byte 2                         # Abbreviation code
+  .byte 0x2e                      # DW_TAG_subprogram
+  .byte 0                         # DW_CHILDREN_no
+  .byte 0x03, 0x0e                # DW_AT_name, DW_FORM_strp
+  .byte 0, 0
+  .byte 0
+
+.section .debug_info,"",@progbits
+.Lcu_begin:
+  .long .Lcu_end - .Lcu_start     # Length of Unit
+.Lcu_start:
+  .short 5                        # DWARF version number
+  .byte 1                         # DW_UT_compile
+  .byte 8                         # Address Size
+  .long .debug_abbrev             # Offset Into Abbrev. Section
+  .byte 1                         # DW_TAG_compile_unit
+.Ldie_foo:
+  .byte 2                         # DW_TAG_subprogram
+  .long .Lstr_foo                  # DW_AT_name
+.Ldie_shared:
+  .byte 2                         # DW_TAG_subprogram
+  .long .Lstr_shared                  # DW_AT_name
+  .byte 0
+.Lcu_end:
+
+.section .debug_names,"",@progbits
+  .long .Lnames_end - .Lnames_start # Header: unit length
+.Lnames_start:
+  .short 5                        # Header: version
+  .short 0                        # Header: padding
+  .long 1                         # Header: compilation unit count
+  .long 0                         # Header: local type unit count
+  .long 0                         # Header: foreign type unit count
+  .long 1                         # Header: bucket count
+  .long 2                         # Header: name count
+  .long .Labbrev_end - .Labbrev_start # Header: abbreviation table size
+  .long 0                         # Header: augmentation string size
+  .long .Lcu_begin                # Compilation unit 0
+  .long 1                         # Bucket 0
+  .long 0xb887389                        # Hash in Bucket 0
+  .long 0x1bb15c9c                        # Hash in Bucket 0
+  .long .Lstr_foo                  # String in Bucket 0: foo
+  .long .Lstr_shared                  # String in Bucket 0: shared
+  .long .Lentry_foo - .Lentries    # Offset in Bucket 0
+  .long .Lentry_shared - .Lentries    # Offset in Bucket 0
+.Labbrev_start:
+  .byte 1                         # Abbrev code
+  .byte 0x2e                      # DW_TAG_subprogram
+  .byte 3, 0x13                   # DW_IDX_die_offset, DW_FORM_ref4
+  .byte 0, 0                      # End of abbrev
+  .byte 0                         # End of abbrev list
+.Labbrev_end:
+.Lentries:
+.Lentry_foo:
+  .byte 1                         # Abbreviation code
+  .long .Ldie_foo - .Lcu_begin     # DW_IDX_die_offset
+  .byte 0                         # End of list: foo
+.Lentry_shared:
+  .byte 1                         # Abbreviation code
+  .long .Ldie_shared - .Lcu_begin     # DW_IDX_die_offset
+  .byte 0                         # End of list: shared
+.Lnames_end:
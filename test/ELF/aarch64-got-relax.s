@@ -0,0 +1,73 @@
+# REQUIRES: aarch64
+# RUN: llvm-mc -filetype=obj -triple=aarch64-none-linux %s -o %t.o
+# RUN: echo "SECTIONS { \
+# RUN:   .text 0x10000 : { *(.text) } \
+# RUN:   .data 0x20000 : { *(.data) } \
+# RUN:   .far 0x10000000 : { *(.far) } }" > %t.script
+
+## Loads of the addresses of non-preemptible symbols from the GOT are relaxed,
+## and the symbols don't get GOT entries.
+# RUN: ld.lld %t.o -T %t.script -o %t
+# RUN: llvm-objdump -d --no-show-raw-insn %t | FileCheck %s
+# RUN: llvm-readelf -S -r %t | FileCheck --check-prefix=SEC %s
+
+# CHECK:      _start:
+# CHECK-NEXT:   10000: nop
+# CHECK-NEXT:   10004: adr x0, #65532
+# CHECK-NEXT:   10008: adrp x1, #268369920
+# CHECK-NEXT:   1000c: add x1, x1, #0
+## An ldr that doesn't overwrite the register of the adrp is not relaxed.
+# CHECK-NEXT:   10010: adrp x2, #{{[0-9]+}}
+# CHECK-NEXT:   10014: ldr x3, [x2, #{{[0-9]+}}]
+
+# SEC:     .got PROGBITS {{[0-9a-f]+}} {{[0-9a-f]+}} 000008
+# SEC-NOT: .got
+# SEC:     There are no relocations in this file.
+
+## Preemptible symbols and ifuncs still use the GOT.
+# RUN: ld.lld %t.o -T %t.script -shared -o %t.so
+# RUN: llvm-objdump -d --no-show-raw-insn %t.so | \
+# RUN:   FileCheck --check-prefix=SHARED %s
+# RUN: llvm-readobj -r %t.so | FileCheck --check-prefix=SHARED-REL %s
+
+# SHARED:      _start:
+# SHARED-NEXT:   10000: adrp x0, #{{[0-9]+}}
+# SHARED-NEXT:   10004: ldr x0, [x0, #{{[0-9]+}}]
+# SHARED-NEXT:   10008: nop
+# SHARED-NEXT:   1000c: adr x4, #{{[0-9]+}}
+
+# SHARED-REL:      R_AARCH64_GLOB_DAT near 0x0
+# SHARED-REL-NEXT: R_AARCH64_GLOB_DAT far 0x0
+# SHARED-REL-NEXT: R_AARCH64_GLOB_DAT other 0x0
+
+## -fix-cortex-a53-843419 disables the relaxation.
+# RUN: ld.lld %t.o -T %t.script --fix-cortex-a53-843419 -o %t2
+# RUN: llvm-objdump -d --no-show-raw-insn %t2 | \
+# RUN:   FileCheck --check-prefix=ERRATA %s
+
+# ERRATA:      _start:
+# ERRATA-NEXT:   10000: adrp x0, #{{[0-9]+}}
+# ERRATA-NEXT:   10004: ldr x0, [x0, #{{[0-9]+}}]
+
+.globl _start, near, far, other
+.hidden hidden
+.text
+_start:
+  adrp x0, :got:near
+  ldr  x0, [x0, :got_lo12:near]
+  adrp x1, :got:far
+  ldr  x1, [x1, :got_lo12:far]
+  adrp x2, :got:other
+  ldr  x3, [x2, :got_lo12:other]
+  adrp x4, :got:hidden
+  ldr  x4, [x4, :got_lo12:hidden]
+
+.data
+near:
+other:
+hidden:
+  .quad 0
+
+.section .far,"aw"
+far:
+  .quad 0
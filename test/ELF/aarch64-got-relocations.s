@@ -2,14 +2,17 @@
 # RUN: llvm-mc -filetype=obj -triple=aarch64-unknown-cloudabi %s -o %t.o
 # RUN: ld.lld --hash-style=sysv -pie %t.o -o %t
 # RUN: llvm-readobj -r %t | FileCheck %s
+# RUN: llvm-objdump -d --no-show-raw-insn %t | FileCheck --check-prefix=DIS %s
 
-# If we're addressing a global relatively through the GOT, we still need to
-# emit a relocation for the entry in the GOT itself.
-# CHECK: Relocations [
-# CHECK:   Section (4) .rela.dyn {
-# CHECK:     0x{{[0-9A-F]+}} R_AARCH64_RELATIVE - 0x{{[0-9A-F]+}}
-# CHECK:   }
-# CHECK: ]
+# If we're addressing a non-preemptible global relatively through the GOT, the
+# load is relaxed to compute its address directly. Neither the entry in the
+# GOT nor a relocation for it is needed.
+# CHECK:      Relocations [
+# CHECK-NEXT: ]
+
+# DIS:      _start:
+# DIS-NEXT:   adrp x8, #{{[0-9]+}}
+# DIS-NEXT:   add x8, x8, #{{[0-9]+}}
 
 	.globl	_start
 	.type	_start,@function
@@ -0,0 +1,42 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: echo '.globl foo; foo: ret' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t1.o
+# RUN: echo '.globl bar; bar: ret' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t2.o
+# RUN: echo '.globl baz; baz: ret' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t3.o
+# RUN: rm -rf %t.a %t.cache
+# RUN: llvm-ar rcs %t.a %t1.o %t2.o
+
+## The first link writes the cache, and the second one uses it.
+# RUN: ld.lld %t.o %t.a -o %t1 --archive-cache-dir=%t.cache --verbose 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=WRITE
+# RUN: ls %t.cache | count 1
+# RUN: ld.lld %t.o %t.a -o %t2 --archive-cache-dir=%t.cache --verbose 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=READ
+# RUN: ld.lld %t.o %t.a -o %t3
+# RUN: cmp %t1 %t3
+# RUN: cmp %t2 %t3
+# RUN: llvm-nm %t2 | FileCheck %s --check-prefix=NM
+
+# WRITE-NOT: using archive symbol cache
+# READ: using archive symbol cache for {{.*}}.a
+
+# NM: T bar
+# NM: T foo
+
+## A cache entry is not used once the archive changes.
+# RUN: rm -f %t.a
+# RUN: llvm-ar rcs %t.a %t1.o %t2.o %t3.o
+# RUN: ld.lld %t.o %t.a -o /dev/null --archive-cache-dir=%t.cache \
+# RUN:   --verbose 2>&1 | FileCheck %s --check-prefix=STALE
+# RUN: ld.lld %t.o %t.a -o /dev/null --archive-cache-dir=%t.cache \
+# RUN:   --verbose 2>&1 | FileCheck %s --check-prefix=READ
+
+# STALE-NOT: using archive symbol cache
+
+.globl _start
+_start:
+  call foo
+  call bar
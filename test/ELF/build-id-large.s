@@ -0,0 +1,27 @@
+# REQUIRES: x86
+
+## Chunks of the output that lie within an input section are hashed as soon
+## as the section is written. Check that the build ID is still the hash of
+## the whole output.
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t --build-id=sha1
+# RUN: llvm-readobj --notes %t > %t.txt
+# RUN: %python %S/Inputs/build-id-tree.py %t >> %t.txt
+# RUN: FileCheck %s < %t.txt
+
+# RUN: ld.lld %t.o -o %t2 --build-id=sha1 --copy-file-range
+# RUN: cmp %t %t2
+
+# CHECK:      Build ID: [[ID:[0-9a-f]+]]
+# CHECK:      {{^}}[[ID]]{{$}}
+
+.globl _start
+_start:
+  ret
+
+.data
+.fill 0x300000, 1, 0xab
+
+.section .debug_big,"",@progbits
+.fill 0x280000, 1, 0xcd
@@ -0,0 +1,51 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t
+# RUN: echo "A B 5" > %t.call_graph
+# RUN: echo "B C 50" >> %t.call_graph
+# RUN: echo "C D 40" >> %t.call_graph
+# RUN: echo "D B 10" >> %t.call_graph
+# RUN: ld.lld -e A %t --call-graph-ordering-file %t.call_graph \
+# RUN:   --call-graph-profile-sort=ext-tsp -o %t2 --print-symbol-order=%t3
+# RUN: FileCheck %s --input-file %t3
+
+## hfsort puts A last because of its low density. Ext-TSP places A before B
+## so that the call is a fall-through.
+# RUN: ld.lld -e A %t --call-graph-ordering-file %t.call_graph \
+# RUN:   --call-graph-profile-sort=hfsort -o %t2 --print-symbol-order=%t4
+# RUN: FileCheck %s --check-prefix=HFSORT --input-file %t4
+
+# RUN: not ld.lld -e A %t --call-graph-profile-sort=foo -o /dev/null 2>&1 \
+# RUN:   | FileCheck %s --check-prefix=ERR
+
+# CHECK:      A
+# CHECK-NEXT: B
+# CHECK-NEXT: C
+# CHECK-NEXT: D
+
+# HFSORT:      B
+# HFSORT-NEXT: C
+# HFSORT-NEXT: D
+# HFSORT-NEXT: A
+
+# ERR: unknown --call-graph-profile-sort= value: foo
+
+.section    .text.A,"ax",@progbits
+.globl  A
+A:
+ nop
+
+.section    .text.B,"ax",@progbits
+.globl  B
+B:
+ nop
+
+.section    .text.C,"ax",@progbits
+.globl  C
+C:
+ nop
+
+.section    .text.D,"ax",@progbits
+.globl  D
+D:
+ nop
@@ -0,0 +1,24 @@
+# REQUIRES: x86, zlib
+
+## Sections larger than a shard are compressed in parallel as one zlib stream.
+## Check that it decompresses to the original contents.
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t
+# RUN: ld.lld %t.o -o %t.z --compress-debug-sections=zlib
+# RUN: llvm-readobj -S %t.z | FileCheck %s
+# RUN: llvm-objcopy --decompress-debug-sections %t.z %t.d
+# RUN: llvm-objcopy --dump-section .debug_info=%t.info %t
+# RUN: llvm-objcopy --dump-section .debug_info=%t.d.info %t.d
+# RUN: cmp %t.info %t.d.info
+
+# CHECK:      Name: .debug_info
+# CHECK-NEXT: Type: SHT_PROGBITS
+# CHECK-NEXT: Flags [
+# CHECK-NEXT:   SHF_COMPRESSED
+
+.section .debug_info,"",@progbits
+.fill 1000000, 1, 0x41
+.ascii "BBBBBBBBBBBBBBBB"
+.fill 1500000, 2, 0x4342
+.quad 0x0123456789abcdef
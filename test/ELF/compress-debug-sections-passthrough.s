@@ -0,0 +1,18 @@
+# REQUIRES: x86, zlib
+
+## An output section that consists of one compressed input section without
+## relocations gets the compressed data of the input as it is.
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux \
+# RUN:   --compress-debug-sections=zlib %s -o %t.o
+# RUN: ld.lld %t.o -o %t --compress-debug-sections=zlib
+# RUN: llvm-readelf -x .debug_foo %t.o > %t.in.txt
+# RUN: llvm-readelf -x .debug_foo %t > %t.out.txt
+# RUN: diff %t.in.txt %t.out.txt
+
+# RUN: llvm-objcopy --decompress-debug-sections %t %t.decompressed
+# RUN: llvm-readelf -p .debug_foo %t.decompressed | FileCheck %s
+# CHECK: AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA
+
+.section .debug_foo,"",@progbits
+.asciz "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"
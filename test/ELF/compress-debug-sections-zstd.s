@@ -0,0 +1,20 @@
+# REQUIRES: x86, zstd
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t --compress-debug-sections=zstd
+# RUN: llvm-readobj -S %t | FileCheck %s --check-prefix=FLAGS
+# RUN: llvm-objdump -s %t | FileCheck %s --check-prefix=CONTENT
+
+# FLAGS:      Name: .debug_str
+# FLAGS-NEXT: Type: SHT_PROGBITS
+# FLAGS-NEXT: Flags [
+# FLAGS-NEXT:   SHF_COMPRESSED
+
+## ch_type is ELFCOMPRESS_ZSTD.
+# CONTENT:     Contents of section .debug_str:
+# CONTENT-NEXT: 0000 02000000
+# CONTENT-NOT: AAAAAAAAA
+
+.section .debug_str,"MS",@progbits,1
+  .asciz "AAAAAAAAAAAAAAAAAAAAAAAAAAA"
+  .asciz "BBBBBBBBBBBBBBBBBBBBBBBBBBB"
@@ -0,0 +1,34 @@
+# REQUIRES: x86, system-linux
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t1 --build-id
+# RUN: ld.lld %t.o -o %t2 --build-id --copy-file-range --verbose 2>&1 | \
+# RUN:   FileCheck %s
+# RUN: cmp %t1 %t2
+
+## .debug_big is copied from the input file, .debug_small and .debug_reloc
+## are written through the output buffer.
+# CHECK: copy-file-range: copied 1 sections
+
+## With -r, sections with RELA relocations are also copied, since their
+## contents do not change.
+# RUN: ld.lld -r %t.o -o %t3.o
+# RUN: ld.lld -r %t.o -o %t4.o --copy-file-range --verbose 2>&1 | \
+# RUN:   FileCheck --check-prefix=RELOCATABLE %s
+# RUN: cmp %t3.o %t4.o
+
+# RELOCATABLE: copy-file-range: copied 2 sections
+
+.globl _start
+_start:
+  ret
+
+.section .debug_big,"",@progbits
+.fill 0x20000, 1, 0xab
+
+.section .debug_small,"",@progbits
+.fill 0x100, 1, 0xcd
+
+.section .debug_reloc,"",@progbits
+.fill 0x20000, 1, 0xef
+.quad _start
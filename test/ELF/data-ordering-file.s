@@ -0,0 +1,66 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## A list of symbols is placed in its order before the other sections.
+# RUN: echo "d3" > %t.list
+# RUN: echo "b2" >> %t.list
+# RUN: echo "d2" >> %t.list
+# RUN: echo "_start" >> %t.list
+# RUN: ld.lld --data-ordering-file=%t.list %t.o -o %t
+# RUN: llvm-nm -n %t | FileCheck --check-prefix=LIST %s
+
+# LIST:      T _start
+# LIST-NEXT: d d3
+# LIST-NEXT: d d2
+# LIST-NEXT: d d1
+# LIST-NEXT: b b2
+# LIST-NEXT: b b1
+
+## A profile places the sections with the most accesses per byte first.
+# RUN: echo "d1 10" > %t.prof
+# RUN: echo "d2 100" >> %t.prof
+# RUN: echo "d3 100" >> %t.prof
+# RUN: echo "b1 1" >> %t.prof
+# RUN: echo "missing 5" >> %t.prof
+# RUN: ld.lld --data-ordering-file=%t.prof %t.o -o %t 2>&1 | \
+# RUN:   FileCheck --check-prefix=WARN %s
+# RUN: llvm-nm -n %t | FileCheck --check-prefix=PROF %s
+
+# WARN: warning: data ordering file: no such symbol: missing
+
+# PROF:      d d2
+# PROF-NEXT: d d3
+# PROF-NEXT: d d1
+# PROF-NEXT: b b1
+# PROF-NEXT: b b2
+
+# RUN: echo "d1 10" > %t.bad
+# RUN: echo "d2" >> %t.bad
+# RUN: not ld.lld --data-ordering-file=%t.bad %t.o -o /dev/null 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR %s
+# ERR: error: {{.*}}.bad: parse error: d2
+
+.section .text._start,"ax",@progbits
+.globl _start
+_start:
+  ret
+
+.section .data.d1,"aw",@progbits
+d1:
+  .quad 0
+
+.section .data.d2,"aw",@progbits
+d2:
+  .quad 0
+
+.section .data.d3,"aw",@progbits
+d3:
+  .quad 0, 0, 0, 0, 0, 0, 0, 0
+
+.section .bss.b1,"aw",@nobits
+b1:
+  .quad 0
+
+.section .bss.b2,"aw",@nobits
+b2:
+  .quad 0
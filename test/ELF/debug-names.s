@@ -0,0 +1,145 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t1.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %p/Inputs/debug-names.s -o %t2.o
+# RUN: ld.lld --debug-names %t1.o %t2.o -o %t
+# RUN: llvm-dwarfdump --debug-names %t | FileCheck %s
+
+## Without --debug-names, the input indexes are concatenated.
+# RUN: ld.lld %t1.o %t2.o -o %t.nomerge
+# RUN: llvm-dwarfdump --debug-names %t.nomerge | FileCheck --check-prefix=NOMERGE %s
+
+# NOMERGE: Name Index @ 0x0 {
+# NOMERGE: Name Index @ 0x{{[0-9a-f]+}} {
+
+## The names of both files are in one index with both compilation units.
+## "shared" is defined by both files and has an entry for each.
+
+# CHECK:      Name Index @ 0x0 {
+# CHECK:        Version: 5
+# CHECK-NEXT:   CU count: 2
+# CHECK-NEXT:   Local TU count: 0
+# CHECK-NEXT:   Foreign TU count: 0
+# CHECK-NEXT:   Bucket count: 3
+# CHECK-NEXT:   Name count: 3
+# CHECK:      Compilation Unit offsets [
+# CHECK-NEXT:   CU[0]: 0x00000000
+# CHECK-NEXT:   CU[1]: 0x00000018
+# CHECK-NEXT: ]
+# CHECK:      Abbreviation 0x1 {
+# CHECK-NEXT:   Tag: DW_TAG_subprogram
+# CHECK-NEXT:   DW_IDX_compile_unit: DW_FORM_data4
+# CHECK-NEXT:   DW_IDX_die_offset: DW_FORM_ref4
+# CHECK-NEXT: }
+
+# CHECK:      Bucket 0 [
+# CHECK:        Hash: 0xB887389
+# CHECK-NEXT:   String: 0x{{[0-9A-F]+}} "foo"
+# CHECK-NEXT:   Entry @ 0x{{[0-9A-F]+}} {
+# CHECK-NEXT:     Abbrev: 0x1
+# CHECK-NEXT:     Tag: DW_TAG_subprogram
+# CHECK-NEXT:     DW_IDX_compile_unit: 0x00000001
+# CHECK-NEXT:     DW_IDX_die_offset: 0x0000000d
+# CHECK-NEXT:   }
+# CHECK:      Bucket 1 [
+# CHECK:        Hash: 0x7C9A7F6A
+# CHECK-NEXT:   String: 0x{{[0-9A-F]+}} "main"
+# CHECK-NEXT:   Entry @ 0x{{[0-9A-F]+}} {
+# CHECK-NEXT:     Abbrev: 0x1
+# CHECK-NEXT:     Tag: DW_TAG_subprogram
+# CHECK-NEXT:     DW_IDX_compile_unit: 0x00000000
+# CHECK-NEXT:     DW_IDX_die_offset: 0x0000000d
+# CHECK-NEXT:   }
+# CHECK:      Bucket 2 [
+# CHECK:        Hash: 0x1BB15C9C
+# CHECK-NEXT:   String: 0x{{[0-9A-F]+}} "shared"
+# CHECK-NEXT:   Entry @ 0x{{[0-9A-F]+}} {
+# CHECK-NEXT:     Abbrev: 0x1
+# CHECK-NEXT:     Tag: DW_TAG_subprogram
+# CHECK-NEXT:     DW_IDX_compile_unit: 0x00000000
+# CHECK-NEXT:     DW_IDX_die_offset: 0x00000012
+# CHECK-NEXT:   }
+# CHECK-NEXT:   Entry @ 0x{{[0-9A-F]+}} {
+# CHECK-NEXT:     Abbrev: 0x1
+# CHECK-NEXT:     Tag: DW_TAG_subprogram
+# CHECK-NEXT:     DW_IDX_compile_unit: 0x00000001
+# CHECK-NEXT:     DW_IDX_die_offset: 0x00000012
+# CHECK-NEXT:   }
+# CHECK-NOT:  Name Index
+
+.globl _start
+_start:
+  ret
+
+.section .debug_str,"MS",@progbits,1
+.Lstr_main:
+  .asciz "main"
+.Lstr_shared:
+  .asciz "shared"
+
+.section .debug_abbrev,"",@progbits
+  .byte 1                         # Abbreviation code
+  .byte 0x11                      # DW_TAG_compile_unit
+  .byte 1                         # DW_CHILDREN_yes
+  .byte 0, 0
+  .byte 2                         # Abbreviation code
+  .byte 0x2e                      # DW_TAG_subprogram
+  .byte 0                         # DW_CHILDREN_no
+  .byte 0x03, 0x0e                # DW_AT_name, DW_FORM_strp
+  .byte 0, 0
+  .byte 0
+
+.section .debug_info,"",@progbits
+.Lcu_begin:
+  .long .Lcu_end - .Lcu_start     # Length of Unit
+.Lcu_start:
+  .short 5                        # DWARF version number
+  .byte 1                         # DW_UT_compile
+  .byte 8                         # Address Size
+  .long .debug_abbrev             # Offset Into Abbrev. Section
+  .byte 1                         # DW_TAG_compile_unit
+.Ldie_main:
+  .byte 2                         # DW_TAG_subprogram
+  .long .Lstr_main                  # DW_AT_name
+.Ldie_shared:
+  .byte 2                         # DW_TAG_subprogram
+  .long .Lstr_shared                  # DW_AT_name
+  .byte 0
+.Lcu_end:
+
+.section .debug_names,"",@progbits
+  .long .Lnames_end - .Lnames_start # Header: unit length
+.Lnames_start:
+  .short 5                        # Header: version
+  .short 0                        # Header: padding
+  .long 1                         # Header: compilation unit count
+  .long 0                         # Header: local type unit count
+  .long 0                         # Header: foreign type unit count
+  .long 1                         # Header: bucket count
+  .long 2                         # Header: name count
+  .long .Labbrev_end - .Labbrev_start # Header: abbreviation table size
+  .long 0                         # Header: augmentation string size
+  .long .Lcu_begin                # Compilation unit 0
+  .long 1                         # Bucket 0
+  .long 0x7c9a7f6a                        # Hash in Bucket 0
+  .long 0x1bb15c9c                        # Hash in Bucket 0
+  .long .Lstr_main                  # String in Bucket 0: main
+  .long .Lstr_shared                  # String in Bucket 0: shared
+  .long .Lentry_main - .Lentries    # Offset in Bucket 0
+  .long .Lentry_shared - .Lentries    # Offset in Bucket 0
+.Labbrev_start:
+  .byte 1                         # Abbrev code
+  .byte 0x2e                      # DW_TAG_subprogram
+  .byte 3, 0x13                   # DW_IDX_die_offset, DW_FORM_ref4
+  .byte 0, 0                      # End of abbrev
+  .byte 0                         # End of abbrev list
+.Labbrev_end:
+.Lentries:
+.Lentry_main:
+  .byte 1                         # Abbreviation code
+  .long .Ldie_main - .Lcu_begin     # DW_IDX_die_offset
+  .byte 0                         # End of list: main
+.Lentry_shared:
+  .byte 1                         # Abbreviation code
+  .long .Ldie_shared - .Lcu_begin     # DW_IDX_die_offset
+  .byte 0                         # End of list: shared
+.Lnames_end:
@@ -0,0 +1,19 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t1.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %p/Inputs/gdb-index.s -o %t2.o
+# RUN: ld.lld --gdb-index %t1.o %t2.o -o %t
+
+## The first link fills the cache. Only %t2.o has debug info.
+# RUN: rm -rf %t.cache
+# RUN: ld.lld --gdb-index --gdb-index-cache-dir=%t.cache %t1.o %t2.o -o %t.miss
+# RUN: ls %t.cache | count 1
+# RUN: cmp %t %t.miss
+
+## The second link reads the cache.
+# RUN: ld.lld --gdb-index --gdb-index-cache-dir=%t.cache %t1.o %t2.o -o %t.hit
+# RUN: ls %t.cache | count 1
+# RUN: cmp %t %t.hit
+
+.globl _start
+_start:
+  ret
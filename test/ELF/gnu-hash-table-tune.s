@@ -0,0 +1,26 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+
+# RUN: ld.lld -shared --hash-style=gnu %t.o -o %t1.so
+# RUN: llvm-readobj --gnu-hash-table %t1.so | FileCheck %s --check-prefix=DEFAULT
+
+# DEFAULT:      Num Mask Words: 1
+# DEFAULT-NEXT: Shift Count: 26
+# DEFAULT-NEXT: Bloom Filter: [0x400000000000204]
+
+## With --tune-gnu-hash, the second bit of the bloom filter is taken from the
+## hash bits right above the 6 bits that select a bit in the single word.
+# RUN: ld.lld -shared --hash-style=gnu --tune-gnu-hash %t.o -o %t2.so
+# RUN: llvm-readobj --gnu-hash-table %t2.so | FileCheck %s --check-prefix=TUNE
+
+# TUNE:      Num Buckets: 1
+# TUNE-NEXT: First Hashed Symbol Index: 1
+# TUNE-NEXT: Num Mask Words: 1
+# TUNE-NEXT: Shift Count: 6
+# TUNE-NEXT: Bloom Filter: [0x400000000004204]
+# TUNE-NEXT: Buckets: [1]
+# TUNE-NEXT: Values: [0xB8860BA, 0xB887389]
+
+.globl foo, bar
+foo:
+bar:
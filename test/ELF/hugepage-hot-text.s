@@ -0,0 +1,54 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+
+## Hot code is placed at the start of .text in a region that is aligned and
+## padded to 2 MiB.
+# RUN: ld.lld -z hugepage-hot-text %t.o -o %t
+# RUN: llvm-nm -n %t | FileCheck %s
+
+# CHECK:      0000000000400000 t __hot_text_start
+# CHECK-NEXT: 0000000000400000 t hot1
+# CHECK-NEXT: 0000000000400001 t hot2
+# CHECK-NEXT: 0000000000600000 t __hot_text_end
+# CHECK-NEXT: 0000000000600000 T _start
+# CHECK-NEXT: 0000000000600001 t cold
+
+## .text.hot.* is not kept in a separate output section.
+# RUN: ld.lld -z hugepage-hot-text -z keep-text-section-prefix %t.o -o %t2
+# RUN: llvm-nm -n %t2 | FileCheck %s
+# RUN: llvm-readelf -S %t2 | FileCheck %s --check-prefix=SEC
+# SEC-NOT: .text.hot
+
+## Call graph profile sections are hot.
+# RUN: echo "_start cold 100" > %t.call_graph
+# RUN: ld.lld -z hugepage-hot-text --call-graph-ordering-file %t.call_graph \
+# RUN:   %t.o -o %t3
+# RUN: llvm-nm -n %t3 | FileCheck %s --check-prefix=CGPROFILE
+
+# CGPROFILE:      0000000000400000 t __hot_text_start
+# CGPROFILE-NEXT: 0000000000400000 T _start
+# CGPROFILE-NEXT: 0000000000400001 t cold
+# CGPROFILE-NEXT: 0000000000400002 t hot1
+# CGPROFILE-NEXT: 0000000000400003 t hot2
+# CGPROFILE-NEXT: 0000000000600000 t __hot_text_end
+
+.globl _start
+.section .text,"ax",@progbits
+_start:
+  nop
+
+.section .text.cold,"ax",@progbits
+cold:
+  nop
+
+.section .text.hot.1,"ax",@progbits
+hot1:
+  nop
+
+.section .text.hot.2,"ax",@progbits
+hot2:
+  nop
+
+.data
+  .quad __hot_text_start
+  .quad __hot_text_end
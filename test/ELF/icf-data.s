@@ -0,0 +1,51 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t --icf=data --print-icf-sections | FileCheck %s
+# RUN: ld.lld %t.o -o %t --icf=all --print-icf-sections | \
+# RUN:   FileCheck --check-prefix=ALL %s
+
+## --icf=data folds read-only data whose address is not significant, but not
+## code.
+# CHECK:      selected section {{.*}}:(.rodata.c1)
+# CHECK-NEXT:   removing identical section {{.*}}:(.rodata.c2)
+# CHECK-NOT:  selected section
+
+# ALL-DAG: removing identical section {{.*}}:(.rodata.c2)
+# ALL-DAG: removing identical section {{.*}}:(.text.f2)
+
+.globl _start
+_start:
+  ret
+
+.section .text.f1,"ax",@progbits
+f1:
+  .cfi_startproc
+  ret
+  .cfi_endproc
+
+.section .text.f2,"ax",@progbits
+f2:
+  .cfi_startproc
+  ret
+  .cfi_endproc
+
+.section .rodata.a1,"a",@progbits
+a1:
+  .quad 1
+
+.section .rodata.a2,"a",@progbits
+a2:
+  .quad 1
+
+.section .rodata.c1,"a",@progbits
+c1:
+  .quad 2
+
+.section .rodata.c2,"a",@progbits
+c2:
+  .quad 2
+
+.addrsig
+.addrsig_sym a1
+.addrsig_sym a2
@@ -0,0 +1,66 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux --defsym FOO=1 \
+# RUN:   %s -o %t1.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux --defsym FOO=1 \
+# RUN:   --defsym GROW=1 %s -o %t2.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux --defsym FOO=1 \
+# RUN:   --defsym BAR=1 %s -o %t3.o
+# RUN: rm -f %t.exe %t.exe.incremental
+
+# RUN: cp %t1.o %t.foo.o
+# RUN: ld.lld --incremental --verbose %t.o %t.foo.o -o %t.exe 2>&1 | \
+# RUN:   FileCheck --check-prefix=FULL %s
+# FULL: incremental: no state from a previous link; doing a full link
+
+# RUN: ld.lld --incremental --verbose %t.o %t.foo.o -o %t.exe 2>&1 | \
+# RUN:   FileCheck --check-prefix=UPTODATE %s
+# UPTODATE: incremental: output is up to date
+
+## foo grows, but it still fits in the room left after it.
+# RUN: cp %t2.o %t.foo.o
+# RUN: ld.lld --incremental --verbose %t.o %t.foo.o -o %t.exe 2>&1 | \
+# RUN:   FileCheck --check-prefix=PATCH %s
+# RUN: llvm-objdump -d %t.exe | FileCheck --check-prefix=DIS %s
+# PATCH: incremental: patched {{.*}}.foo.o
+
+# DIS:      <_start>:
+# DIS-NEXT:   callq {{.*}} <foo>
+# DIS:      <foo>:
+# DIS-NEXT:   nop
+# DIS-NEXT:   nop
+# DIS-NEXT:   nop
+# DIS-NEXT:   callq {{.*}} <_start>
+# DIS-NEXT:   retq
+# DIS-NEXT:   int3
+
+## A new global symbol needs a full link.
+# RUN: cp %t3.o %t.foo.o
+# RUN: ld.lld --incremental --verbose %t.o %t.foo.o -o %t.exe 2>&1 | \
+# RUN:   FileCheck --check-prefix=FALLBACK %s
+# FALLBACK: incremental: {{.*}}.foo.o: the section or symbol table changed; doing a full link
+
+# RUN: ld.lld --incremental -r %t.o %t.foo.o -o %t.ro 2>&1 | \
+# RUN:   FileCheck --check-prefix=WARN %s
+# WARN: warning: --incremental: -r is not supported; ignoring
+
+.ifndef FOO
+.globl _start
+_start:
+  call foo
+.else
+.globl foo
+foo:
+  nop
+.ifdef GROW
+  nop
+  nop
+.endif
+  call _start
+  ret
+.ifdef BAR
+.globl bar
+bar:
+  ret
+.endif
+.endif
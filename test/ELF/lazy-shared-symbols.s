@@ -0,0 +1,62 @@
+# REQUIRES: x86
+# RUN: echo '.globl foo, bar, baz, v1, v2; .type foo,@function; \
+# RUN:   foo: bar: baz: v1: v2: ret; \
+# RUN:   .symver v1, sym@V1; .symver v2, sym@@V2' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t1.o
+# RUN: echo 'V1 {}; V2 {};' > %t.ver
+# RUN: ld.lld -shared --hash-style=gnu --version-script=%t.ver -soname=t1.so \
+# RUN:   %t1.o -o %t1.so
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+
+## Only referenced symbols of t1.so are looked up, and the result is the
+## same as without the option.
+# RUN: ld.lld --lazy-shared-symbols %t.o %t1.so -o %t
+# RUN: llvm-readelf --dyn-syms %t | FileCheck %s
+# RUN: ld.lld %t.o %t1.so -o %t2
+# RUN: llvm-readelf --dyn-syms %t2 | FileCheck %s
+
+# CHECK:     Symbol table '.dynsym'
+# CHECK-DAG: FUNC GLOBAL DEFAULT UND foo{{$}}
+# CHECK-DAG: NOTYPE GLOBAL DEFAULT UND sym@V1
+# CHECK-DAG: NOTYPE GLOBAL DEFAULT UND sym@V2
+# CHECK-NOT: bar
+# CHECK-NOT: baz
+
+## A symbol that is undefined when a DSO is added is resolved to the DSO,
+## so a later archive member that defines it is not fetched.
+# RUN: echo '.globl bar; bar: ret' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t2.o
+# RUN: rm -f %t2.a
+# RUN: llvm-ar rcs %t2.a %t2.o
+# RUN: echo '.globl _start; _start: call bar' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t3.o
+# RUN: ld.lld --lazy-shared-symbols %t3.o %t1.so %t2.a -o %t3
+# RUN: llvm-readelf --dyn-syms %t3 | FileCheck %s --check-prefix=ARCHIVE
+# ARCHIVE: GLOBAL DEFAULT UND bar
+
+## A DSO without .gnu.hash is loaded as usual.
+# RUN: ld.lld -shared --hash-style=sysv -soname=t4.so %t1.o -o %t4.so
+# RUN: ld.lld --lazy-shared-symbols %t.o %t4.so -o %t4
+# RUN: llvm-readelf --dyn-syms %t4 | FileCheck %s --check-prefix=SYSV
+# SYSV: FUNC GLOBAL DEFAULT UND foo{{$}}
+
+## The aliases of a copy relocated symbol are interposed too, although they
+## are not referenced.
+# RUN: echo '.data; .globl v, valias; .type v,@object; .type valias,@object; \
+# RUN:   .size v, 4; .size valias, 4; v: valias: .long 0' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t5.o
+# RUN: ld.lld -shared --hash-style=gnu -soname=t5.so %t5.o -o %t5.so
+# RUN: echo '.globl _start; _start: movl v(%rip), %eax' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t6.o
+# RUN: ld.lld --lazy-shared-symbols %t6.o %t5.so -o %t6
+# RUN: llvm-readelf --dyn-syms %t6 | FileCheck %s --check-prefix=COPY
+# COPY-DAG: OBJECT GLOBAL DEFAULT {{[0-9]+}} v{{$}}
+# COPY-DAG: OBJECT GLOBAL DEFAULT {{[0-9]+}} valias{{$}}
+
+.globl _start
+_start:
+  call foo
+  call v1
+  call sym
+
+.symver v1, sym@V1
@@ -0,0 +1,45 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: echo '.globl foo; foo: ret' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t1.o
+# RUN: echo '.globl foo; foo: nop; ret' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t2.o
+# RUN: rm -rf %t.cache %t.a
+# RUN: llvm-ar rcs %t.a %t1.o
+
+## The first link adds its outputs to the cache, and the second one uses them.
+# RUN: ld.lld %t.o %t.a -o %t1 -Map=%t1.map --link-cache-dir=%t.cache \
+# RUN:   --verbose 2>&1 | FileCheck %s --check-prefix=MISS
+# RUN: ls %t.cache | count 2
+# RUN: ld.lld %t.o %t.a -o %t2 -Map=%t2.map --link-cache-dir=%t.cache \
+# RUN:   --verbose 2>&1 | FileCheck %s --check-prefix=HIT
+# RUN: cmp %t1 %t2
+# RUN: cmp %t1.map %t2.map
+# RUN: test -x %t2
+
+# MISS-NOT: link cache: using
+# HIT: link cache: using {{.*}}link-{{[0-9a-f]+}}.out
+
+## A different command line or a changed input is a miss.
+# RUN: ld.lld %t.o %t.a -o %t3 --link-cache-dir=%t.cache --verbose 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=MISS
+# RUN: ld.lld %t.o %t.a -o %t3 --link-cache-dir=%t.cache --gc-sections \
+# RUN:   --verbose 2>&1 | FileCheck %s --check-prefix=MISS
+# RUN: rm -f %t.a
+# RUN: llvm-ar rcs %t.a %t2.o
+# RUN: ld.lld %t.o %t.a -o %t4 -Map=%t4.map --link-cache-dir=%t.cache \
+# RUN:   --verbose 2>&1 | FileCheck %s --check-prefix=MISS
+# RUN: llvm-objdump -d %t4 | FileCheck %s --check-prefix=DIS
+
+# DIS:      <foo>:
+# DIS-NEXT: nop
+
+## Links that are not a function of their inputs are not cached.
+# RUN: ld.lld %t.o %t.a -o %t5 --link-cache-dir=%t.cache --build-id=uuid \
+# RUN:   --verbose 2>&1 | FileCheck %s --check-prefix=UUID
+
+# UUID: link cache: not used because of --build-id=uuid
+
+.globl _start
+_start:
+  call foo
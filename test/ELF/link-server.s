@@ -0,0 +1,44 @@
+# REQUIRES: x86, shell
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: echo '.data; .byte 1' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t1.o
+# RUN: echo '.data; .byte 2' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t2.o
+
+## Socket paths are limited to about 100 characters, so a relative one is used.
+# RUN: rm -rf %t.dir && mkdir %t.dir && cd %t.dir
+
+## If there is no server, lld links by itself.
+# RUN: env LLD_LINK_SERVER=sock ld.lld %t.o %t1.o -o %t.nosrv
+# RUN: llvm-objdump -s -j .data %t.nosrv | FileCheck --check-prefix=ONE %s
+
+## With a server, the link is forwarded to it. The server reads %t.in.o through
+## its input cache, so it does not notice that the file was rewritten if its
+## size and modification time stay the same, while lld linking by itself does.
+# RUN: cp -p %t1.o %t.in.o
+# RUN: ld.lld --link-server=sock > /dev/null 2>&1 & echo $! > %t.pid
+# RUN: for i in $(seq 100); do test -S sock && break; sleep 0.1; done
+# RUN: env LLD_LINK_SERVER=sock ld.lld %t.o %t.in.o -o %t.srv1
+# RUN: cp %t2.o %t.in.o
+# RUN: touch -r %t1.o %t.in.o
+# RUN: env LLD_LINK_SERVER=sock ld.lld %t.o %t.in.o -o %t.srv2
+# RUN: not env LLD_LINK_SERVER=sock ld.lld %t.o %t.missing.o -o /dev/null \
+# RUN:   2>&1 | FileCheck --check-prefix=ERR %s
+# RUN: kill $(cat %t.pid)
+# RUN: llvm-objdump -s -j .data %t.srv1 | FileCheck --check-prefix=ONE %s
+# RUN: llvm-objdump -s -j .data %t.srv2 | FileCheck --check-prefix=ONE %s
+# RUN: ld.lld %t.o %t.in.o -o %t.local
+# RUN: llvm-objdump -s -j .data %t.local | FileCheck --check-prefix=TWO %s
+
+## Errors of a forwarded link go to the client's stderr, and the client exits
+## with the status of the link.
+# ERR: error: cannot open {{.*}}.missing.o
+
+# ONE:      Contents of section .data:
+# ONE-NEXT: {{^}} {{[0-9a-f]+}} 01
+# TWO:      Contents of section .data:
+# TWO-NEXT: {{^}} {{[0-9a-f]+}} 02
+
+.globl _start
+_start:
+  ret
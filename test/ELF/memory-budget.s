@@ -0,0 +1,25 @@
+# REQUIRES: x86, system-linux
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t1
+# RUN: ld.lld %t.o -o %t2 --memory-budget=64G 2>&1 | count 0
+# RUN: cmp %t1 %t2
+
+## A budget that the linker exceeds from the start makes it hold back work,
+## which it reports, and the output does not change.
+# RUN: ld.lld %t.o -o %t3 --memory-budget=1K 2>&1 | FileCheck %s
+# RUN: env LLD_MEMORY_BUDGET=1k ld.lld %t.o -o %t4 2>&1 | FileCheck %s
+# RUN: cmp %t1 %t3
+# RUN: cmp %t1 %t4
+# CHECK: --memory-budget: held back parallel work {{[0-9]+}} times to stay within 1024 bytes
+
+# RUN: not ld.lld %t.o -o /dev/null --memory-budget=1X 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR %s
+# RUN: env LLD_MEMORY_BUDGET=foo not ld.lld %t.o -o /dev/null 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR-ENV %s
+# ERR: invalid memory budget: 1X
+# ERR-ENV: invalid memory budget: foo
+
+.globl _start
+_start:
+  ret
@@ -0,0 +1,20 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: ld.lld -O 1 %t.o -o %t.so -shared
+# RUN: llvm-objdump -s %t.so | FileCheck %s
+
+## UTF-16 and UTF-32 strings are split at zero characters, not at zero bytes,
+## including strings that span more than one 8-byte word.
+
+# CHECK:      Contents of section .str16:
+# CHECK-NEXT: {{^ [0-9a-f]+}} 41000001 42004300 44000000
+# CHECK:      Contents of section .str32:
+# CHECK-NEXT: {{^ [0-9a-f]+}} 41000000 00000100 42000000 00000000
+
+.section .str16,"aMS",@progbits,2
+.short 0x41, 0x100, 0x42, 0x43, 0x44, 0
+.short 0x41, 0x100, 0x42, 0x43, 0x44, 0
+
+.section .str32,"aMS",@progbits,4
+.long 0x41, 0x10000, 0x42, 0
+.long 0x41, 0x10000, 0x42, 0
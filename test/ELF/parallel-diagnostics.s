@@ -0,0 +1,33 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## Sections are relocated in parallel, but their errors are printed in the
+## order of the sections, and --error-limit counts them in that order.
+# RUN: not ld.lld --threads=4 %t.o -o /dev/null 2>&1 | FileCheck %s
+# RUN: not ld.lld --threads=4 --error-limit=2 %t.o -o /dev/null 2>&1 | \
+# RUN:   FileCheck --check-prefix=LIMIT %s
+
+# CHECK:      error: {{.*}}:(.data.a+0x0): relocation R_X86_64_32 out of range
+# CHECK-NEXT: error: {{.*}}:(.data.b+0x0): relocation R_X86_64_32 out of range
+# CHECK-NEXT: error: {{.*}}:(.data.c+0x0): relocation R_X86_64_32 out of range
+# CHECK-NEXT: error: {{.*}}:(.data.d+0x0): relocation R_X86_64_32 out of range
+
+# LIMIT:      error: {{.*}}:(.data.a+0x0): relocation R_X86_64_32 out of range
+# LIMIT-NEXT: error: {{.*}}:(.data.b+0x0): relocation R_X86_64_32 out of range
+# LIMIT-NEXT: error: too many errors emitted, stopping now
+# LIMIT-NOT:  error:
+
+foo = 0x100000000
+
+.globl _start
+_start:
+  ret
+
+.section .data.a,"aw"
+.long foo
+.section .data.b,"aw"
+.long foo
+.section .data.c,"aw"
+.long foo
+.section .data.d,"aw"
+.long foo
@@ -0,0 +1,28 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: rm -f %t.a
+# RUN: llvm-ar rc %t.a %t.o
+# RUN: ld.lld %t.o -o %t --prefetch-inputs=willneed --verbose 2>&1 | \
+# RUN:   FileCheck --check-prefix=WILLNEED %s
+# RUN: ld.lld %t.o --whole-archive %t.a -o %t --prefetch-inputs=prefault \
+# RUN:   --allow-multiple-definition --verbose 2>&1 | \
+# RUN:   FileCheck --check-prefix=PREFAULT %s
+# RUN: ld.lld %t.o -o %t --prefetch-inputs=none --verbose 2>&1 | \
+# RUN:   FileCheck --check-prefix=NONE %s
+
+# WILLNEED:     prefetch-inputs: 1 files, {{[0-9]+}} bytes, {{[0-9]+}} bytes already in memory
+# WILLNEED-NOT: prefaulted
+
+# PREFAULT: prefetch-inputs: 2 files, {{[0-9]+}} bytes, {{[0-9]+}} bytes already in memory
+# PREFAULT: prefetch-inputs: prefaulted {{[0-9]+}} bytes in {{[0-9]+}} ms
+
+# NONE-NOT: prefetch-inputs
+
+# RUN: not ld.lld %t.o -o %t --prefetch-inputs=foo 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR %s
+# ERR: unknown --prefetch-inputs value: foo
+
+.globl _start
+_start:
+  ret
@@ -0,0 +1,30 @@
+# REQUIRES: x86
+## --preload-inputs reads the input files on background threads, which must
+## not change the output.
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: echo '.globl foo; foo: ret' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t.foo.o
+# RUN: rm -f %t.a
+# RUN: llvm-ar rcs %t.a %t.foo.o
+# RUN: ld.lld %t.o %t.a -o %t
+
+# RUN: ld.lld --preload-inputs %t.o %t.a -o %t.preload
+# RUN: cmp %t %t.preload
+
+## A path that is named twice is read again the second time.
+# RUN: ld.lld --preload-inputs %t.o %t.a %t.a -o %t.twice
+# RUN: cmp %t %t.twice
+
+## With one thread, the files are read as they are needed.
+# RUN: ld.lld --preload-inputs --threads=1 %t.o %t.a -o %t.threads1
+# RUN: cmp %t %t.threads1
+
+## A missing file is reported as without the option.
+# RUN: not ld.lld --preload-inputs %t.o %t.missing.o %t.a -o /dev/null 2>&1 | \
+# RUN:   FileCheck --check-prefix=MISSING %s
+# MISSING: error: cannot open {{.*}}.missing.o
+
+.globl _start
+_start:
+  call foo
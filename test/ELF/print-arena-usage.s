@@ -0,0 +1,18 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld --print-arena-usage %t.o -o %t 2>&1 | FileCheck %s
+
+# CHECK:      Arena growth by phase:
+# CHECK:        Input File Reading: {{ *}}{{[0-9.]+}} MB
+# CHECK:        Total Link Time: {{ *}}{{[0-9.]+}} MB
+# CHECK:      Arena usage:
+# CHECK-NEXT:            Bytes      Objects  Arena
+# CHECK-DAG:    {{[0-9]+}} {{ *}}1  {{.*}}lld::elf::Configuration
+# CHECK-DAG:    {{[0-9]+}} {{ *}}{{[0-9]+}}  saver
+
+## Nothing is recorded or printed without the option.
+# RUN: ld.lld %t.o -o %t 2>&1 | count 0
+
+.globl _start
+_start:
+  ret
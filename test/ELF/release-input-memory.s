@@ -0,0 +1,25 @@
+# REQUIRES: x86
+## --release-input-memory releases the memory of input sections after they
+## are written, which does not change the output.
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: %python -c "open(r'%t.data', 'wb').write(b'\x01' * 65536)"
+# RUN: ld.lld %t.o -o %t1 -b binary %t.data
+# RUN: ld.lld %t.o -o %t2 -b binary %t.data --release-input-memory
+# RUN: cmp %t1 %t2
+
+# RUN: ld.lld %t.o -o %t3 --emit-relocs --release-input-memory
+# RUN: ld.lld %t.o -o %t4 --emit-relocs
+# RUN: cmp %t3 %t4
+
+.globl _start
+_start:
+  call foo
+  .zero 16384
+
+.section .text.foo,"ax",@progbits
+foo:
+  ret
+
+.data
+  .quad foo
@@ -0,0 +1,60 @@
+# REQUIRES: x86
+# RUN: echo '.globl foo, bar, baz; foo: bar: baz: ret' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t1.o
+# RUN: ld.lld -shared -soname=t1 %t1.o -o %t1.so
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+
+# RUN: ld.lld %t.o %t1.so -o %t
+# RUN: llvm-readobj -r %t | FileCheck --check-prefix=NOSORT %s
+
+# NOSORT:      .rela.plt {
+# NOSORT-NEXT:   0x[[#%x,SLOT:]] R_X86_64_JUMP_SLOT foo 0x0
+# NOSORT-NEXT:   0x[[#SLOT+8]] R_X86_64_JUMP_SLOT bar 0x0
+# NOSORT-NEXT:   0x[[#SLOT+16]] R_X86_64_JUMP_SLOT baz 0x0
+
+## Entries are sorted by their call counts in the call graph profile, and
+## the entries that have none keep their order.
+# RUN: echo "_start baz 100" > %t.cg
+# RUN: echo "_start bar 10" >> %t.cg
+# RUN: ld.lld --sort-plt-entries --call-graph-ordering-file %t.cg \
+# RUN:   %t.o %t1.so -o %t2
+# RUN: llvm-readobj -r %t2 | FileCheck --check-prefix=CG %s
+# RUN: llvm-objdump -d --no-show-raw-insn %t2 | FileCheck --check-prefix=DIS %s
+
+# CG:      .rela.plt {
+# CG-NEXT:   0x[[#%x,SLOT:]] R_X86_64_JUMP_SLOT baz 0x0
+# CG-NEXT:   0x[[#SLOT+8]] R_X86_64_JUMP_SLOT bar 0x0
+# CG-NEXT:   0x[[#SLOT+16]] R_X86_64_JUMP_SLOT foo 0x0
+
+## The calls and the PLT entries agree with the new order. Each entry pushes
+## its index into .rela.plt.
+# DIS:      _start:
+# DIS-NEXT:   callq {{.*}} <foo@plt>
+# DIS-NEXT:   callq {{.*}} <bar@plt>
+# DIS-NEXT:   callq {{.*}} <baz@plt>
+# DIS:      baz@plt:
+# DIS-NEXT:   jmpq
+# DIS-NEXT:   pushq $0
+# DIS:      bar@plt:
+# DIS-NEXT:   jmpq
+# DIS-NEXT:   pushq $1
+# DIS:      foo@plt:
+# DIS-NEXT:   jmpq
+# DIS-NEXT:   pushq $2
+
+## --symbol-ordering-file comes first.
+# RUN: echo "foo" > %t.order
+# RUN: ld.lld --sort-plt-entries --symbol-ordering-file %t.order \
+# RUN:   --no-warn-symbol-ordering %t.o %t1.so -o %t3
+# RUN: llvm-readobj -r %t3 | FileCheck --check-prefix=ORDER %s
+
+# ORDER:      .rela.plt {
+# ORDER-NEXT:   R_X86_64_JUMP_SLOT foo 0x0
+# ORDER-NEXT:   R_X86_64_JUMP_SLOT bar 0x0
+# ORDER-NEXT:   R_X86_64_JUMP_SLOT baz 0x0
+
+.globl _start
+_start:
+  call foo
+  call bar
+  call baz
@@ -0,0 +1,24 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t
+
+## The output built in memory or in a staging directory is the same as the
+## one written through a memory mapped file, and nothing is left behind in
+## the staging directory.
+# RUN: ld.lld --stage-output %t.o -o %t.mem
+# RUN: cmp %t %t.mem
+# RUN: rm -rf %t.dir && mkdir %t.dir
+# RUN: ld.lld --stage-output-dir=%t.dir %t.o -o %t.dir.out
+# RUN: cmp %t %t.dir.out
+# RUN: ls %t.dir | count 0
+
+# RUN: not ld.lld --stage-output-dir=%t.nonexistent %t.o -o %t.err 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR %s
+# ERR: error: failed to open {{.*}}.err:
+
+.globl _start
+_start:
+  ret
+
+.data
+.quad _start
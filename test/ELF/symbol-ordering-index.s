@@ -0,0 +1,52 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+
+# RUN: echo "_foo4" > %t_order.txt
+# RUN: echo "_foo3" >> %t_order.txt
+# RUN: echo "missing" >> %t_order.txt
+# RUN: echo "_foo2" >> %t_order.txt
+# RUN: echo "_foo1" >> %t_order.txt
+
+# RUN: ld.lld --symbol-ordering-file %t_order.txt %t.o -o %t1.out \
+# RUN:   --print-symbol-ordering-index=%t_order.idx 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=WARN
+# RUN: llvm-objdump -s %t1.out | FileCheck %s
+
+# RUN: ld.lld --symbol-ordering-file %t_order.idx %t.o -o %t2.out 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=WARN
+# RUN: llvm-objdump -s %t2.out | FileCheck %s
+
+## An index can be written from an index.
+# RUN: ld.lld --symbol-ordering-file %t_order.idx %t.o -o %t3.out \
+# RUN:   --print-symbol-ordering-index=%t_order2.idx --no-warn-symbol-ordering
+# RUN: cmp %t_order.idx %t_order2.idx
+
+# WARN: warning: symbol ordering file: no such symbol: missing
+
+# CHECK:      Contents of section .foo:
+# CHECK-NEXT:  44332211
+
+# RUN: not ld.lld %t.o -o /dev/null --print-symbol-ordering-index=%t.idx 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=NOFILE
+# NOFILE: error: --print-symbol-ordering-index requires --symbol-ordering-file
+
+# RUN: %python -c "open(r'%t_bad.idx', 'wb').write(b'\x7fLLDSYMO')"
+# RUN: not ld.lld --symbol-ordering-file %t_bad.idx %t.o -o /dev/null 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=BAD
+# BAD: error: {{.*}}_bad.idx: invalid symbol ordering index: file is too short
+
+.section .foo,"ax",@progbits,unique,1
+_foo1:
+ .byte 0x11
+
+.section .foo,"ax",@progbits,unique,2
+_foo2:
+ .byte 0x22
+
+.section .foo,"ax",@progbits,unique,3
+_foo3:
+ .byte 0x33
+
+.section .foo,"ax",@progbits,unique,4
+_foo4:
+ .byte 0x44
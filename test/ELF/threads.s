@@ -0,0 +1,32 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## The output does not depend on the number of threads.
+# RUN: ld.lld --threads=1 %t.o -o %t1
+# RUN: ld.lld --threads=3 %t.o -o %t2
+# RUN: ld.lld --no-threads %t.o -o %t3
+# RUN: ld.lld --no-threads --threads=2 %t.o -o %t4
+# RUN: ld.lld --numa-threads --threads=3 %t.o -o %t5
+# RUN: ld.lld --numa-threads --no-numa-threads %t.o -o %t6
+# RUN: cmp %t1 %t2
+# RUN: cmp %t1 %t3
+# RUN: cmp %t1 %t4
+# RUN: cmp %t1 %t5
+# RUN: cmp %t1 %t6
+
+# RUN: not ld.lld --threads=0 %t.o -o /dev/null 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR0 %s
+# RUN: not ld.lld --threads=foo %t.o -o /dev/null 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERRFOO %s
+
+# ERR0:   --threads: expected a positive integer, but got '0'
+# ERRFOO: --threads: expected a positive integer, but got 'foo'
+
+.globl _start
+_start:
+  ret
+
+.section .rodata.str1.1,"aMS",@progbits,1
+.asciz "foo"
+.asciz "bar"
+.asciz "foo"
@@ -0,0 +1,26 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld --time-json=%t.json --threads=2 %t.o -o %t
+# RUN: FileCheck --input-file=%t.json %s
+
+# CHECK:      {
+# CHECK-NEXT:   "name": "Total Link Time",
+# CHECK-NEXT:   "ms": {{[0-9.e+-]+}},
+# CHECK-NEXT:   "cpu_ms": {{[0-9.e+-]+}},
+# CHECK-NEXT:   "busy_ms": {{[0-9.e+-]+}},
+# CHECK-NEXT:   "count": 1,
+# CHECK-NEXT:   "arena_bytes": {{[0-9]+}},
+# CHECK-NEXT:   "children": [
+# CHECK:          "name": "Input File Reading",
+# CHECK:          "name": "Write Sections",
+# CHECK:          "name": "Commit Output File",
+# CHECK:        ]
+# CHECK-NEXT: }
+
+# RUN: not ld.lld --time-json=%t.dir/nonexistent/t.json %t.o -o %t 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR %s
+# ERR: error: cannot open {{.*}}t.json:
+
+.globl _start
+_start:
+  ret
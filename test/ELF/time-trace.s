@@ -0,0 +1,30 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+# Test the default output file name
+# RUN: ld.lld --time-trace --time-trace-granularity=0 -o %t1.elf %t.o
+# RUN: FileCheck --input-file=%t1.elf.time-trace %s
+
+# Test specified output file name
+# RUN: ld.lld --time-trace --time-trace-file=%t2.json \
+# RUN:   --time-trace-granularity=0 -o %t2.elf %t.o
+# RUN: FileCheck --input-file=%t2.json %s
+
+# CHECK:      "traceEvents": [
+# CHECK-DAG:  "name": "Input File Reading"
+# CHECK-DAG:  "name": "Symbol Resolution"
+# CHECK-DAG:  "name": "GC"
+# CHECK-DAG:  "name": "Scan Relocations"
+# CHECK-DAG:  "name": "Write Sections"
+# CHECK-DAG:  "name": "Total Link Time"
+
+# Test --time
+# RUN: ld.lld --time -o %t3.elf %t.o 2>&1 | FileCheck %s --check-prefix=TIME
+# TIME:      Input File Reading:
+# TIME:      Finalize Sections:
+# TIME-NEXT:   Scan Relocations:
+# TIME:      Total Link Time:
+
+.globl _start
+_start:
+  ret
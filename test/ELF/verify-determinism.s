@@ -0,0 +1,36 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: echo '.globl bar; bar: ret' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t2.o
+# RUN: ld.lld -shared %t2.o -o %t2.so
+
+# RUN: ld.lld --threads=1 %t.o %t2.so -o %t --determinism-log=%t.log
+# RUN: FileCheck %s < %t.log
+# RUN: ld.lld %t.o %t2.so -o %t --verify-determinism=%t.log
+
+# CHECK:      symtab 1 local
+# CHECK-NEXT: symtab 2 _start
+# CHECK-NEXT: symtab 3 bar
+# CHECK:      got 0 bar
+# CHECK-NEXT: plt 0 bar
+# CHECK:      section .text {{[0-9A-F]+}}
+# CHECK-NOT:  section .note.gnu.build-id
+
+## A different symbol order is reported before the sections that it changes.
+# RUN: sed -e 's/symtab 2 _start/symtab 2 other/' %t.log > %t.bad
+# RUN: not ld.lld %t.o %t2.so -o %t --verify-determinism=%t.bad 2>&1 | \
+# RUN:   FileCheck --check-prefix=DIFF %s
+# DIFF:      error: --verify-determinism: output differs from the reference link at record 2 of {{.*}}.bad
+# DIFF-NEXT: >>> reference: symtab 2 other
+# DIFF-NEXT: >>> this link: symtab 2 _start
+
+# RUN: head -n 2 %t.log > %t.short
+# RUN: not ld.lld %t.o %t2.so -o %t --verify-determinism=%t.short 2>&1 | \
+# RUN:   FileCheck --check-prefix=COUNT %s
+# COUNT: error: --verify-determinism: the reference link in {{.*}}.short has 2 records, but this link has {{[0-9]+}}; the first extra record is: symtab 3 bar
+
+.globl _start
+_start:
+local:
+  call bar
+  movq bar@GOTPCREL(%rip), %rax
@@ -0,0 +1,41 @@
+# REQUIRES: x86
+
+## Input sections larger than a few MiB are copied in pieces by multiple
+## threads, and relocations in large non-allocated sections are applied in
+## shards. Check that the contents and the build ID are as expected.
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t --build-id=sha1
+# RUN: llvm-objcopy --dump-section .data=%t.data \
+# RUN:   --dump-section .debug_big=%t.debug %t
+# RUN: %python -c "import sys; d = open(sys.argv[1], 'rb').read(); \
+# RUN:   sys.exit(d != b'\xab' * 0x500000 + b'\x88\x77\x66\x55\x44\x33\x22\x11')" \
+# RUN:   %t.data
+# RUN: %python -c "import sys; d = open(sys.argv[1], 'rb').read(); \
+# RUN:   sys.exit(d != (b'\x88\x77\x66\x55\x44\x33\x22\x11' * 0x10000 + \
+# RUN:   b'\xcd' * 0x400000) * 2)" %t.debug
+
+# RUN: llvm-readobj --notes %t > %t.txt
+# RUN: %python %S/Inputs/build-id-tree.py %t >> %t.txt
+# RUN: FileCheck %s < %t.txt
+
+# CHECK:      Build ID: [[ID:[0-9a-f]+]]
+# CHECK:      {{^}}[[ID]]{{$}}
+
+.globl _start
+_start:
+  ret
+
+foo = 0x1122334455667788
+
+.data
+.fill 0x500000, 1, 0xab
+.quad foo
+
+.section .debug_big,"",@progbits
+.rept 2
+.rept 0x10000
+.quad foo
+.endr
+.fill 0x400000, 1, 0xcd
+.endr
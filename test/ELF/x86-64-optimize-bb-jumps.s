@@ -0,0 +1,66 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+
+# RUN: ld.lld --optimize-bb-jumps %t.o -o %t
+# RUN: llvm-objdump -d --no-show-raw-insn %t | FileCheck %s
+# RUN: ld.lld %t.o -o %t.noopt
+# RUN: llvm-objdump -d --no-show-raw-insn %t.noopt | \
+# RUN:   FileCheck --check-prefix=NOOPT %s
+
+# RUN: not ld.lld -r --optimize-bb-jumps %t.o -o /dev/null 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR %s
+# ERR: -r and --optimize-bb-jumps may not be used together
+
+## The jump from _start to the next section is deleted. The je to the next
+## section is inverted to jump to a.3 instead, so that the jmp after it can
+## be deleted, and then it is shrunk to the 2-byte form. The jump to far is
+## out of range of the short form and is left alone.
+
+# CHECK:      _start:
+# CHECK-NEXT:   nop
+# CHECK-EMPTY:
+# CHECK-NEXT: a.1:
+# CHECK-NEXT:   nop
+# CHECK-NEXT:   jne 6 <a.3>
+# CHECK-EMPTY:
+# CHECK-NEXT: a.2:
+# CHECK-NEXT:   nop
+# CHECK-NEXT:   jmp 257 <far>
+# CHECK-EMPTY:
+# CHECK-NEXT: a.3:
+# CHECK-NEXT:   retq
+
+# NOOPT:      _start:
+# NOOPT-NEXT:   nop
+# NOOPT-NEXT:   jmp 0 <a.1>
+# NOOPT-EMPTY:
+# NOOPT-NEXT: a.1:
+# NOOPT-NEXT:   nop
+# NOOPT-NEXT:   je 5 <a.2>
+# NOOPT-NEXT:   jmp {{.*}} <a.3>
+
+.section .text._start,"ax",@progbits
+.globl _start
+_start:
+  nop
+  jmp a.1
+
+.section .text.a.1,"ax",@progbits
+a.1:
+  nop
+  je a.2
+  jmp a.3
+
+.section .text.a.2,"ax",@progbits
+a.2:
+  nop
+  jmp far
+
+.section .text.a.3,"ax",@progbits
+a.3:
+  ret
+
+.section .text.far,"ax",@progbits
+  .space 256
+far:
+  ret
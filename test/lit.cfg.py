@@ -94,6 +94,9 @@ if (lit.util.which('cvtres', config.environment['PATH']) or
 if config.llvm_libxml2_enabled:
     config.available_features.add('libxml2')
 
+if config.have_zstd:
+    config.available_features.add('zstd')
+
 if config.have_dia_sdk:
     config.available_features.add("diasdk")
 
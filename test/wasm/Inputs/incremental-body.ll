@@ -0,0 +1,10 @@
+target triple = "wasm32-unknown-unknown"
+
+define i32 @foo() {
+  ret i32 42
+}
+
+define void @_start() {
+  call i32 @foo()
+  ret void
+}
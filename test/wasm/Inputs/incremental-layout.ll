@@ -0,0 +1,15 @@
+target triple = "wasm32-unknown-unknown"
+
+define i32 @bar() {
+  ret i32 42
+}
+
+define i32 @foo() {
+  %r = call i32 @bar()
+  ret i32 %r
+}
+
+define void @_start() {
+  call i32 @foo()
+  ret void
+}
@@ -0,0 +1,4 @@
+target triple = "wasm32-unknown-unknown"
+
+@.str = private unnamed_addr constant [4 x i8] c"foo\00", align 1
+@ptr3 = global i8* getelementptr inbounds ([4 x i8], [4 x i8]* @.str, i32 0, i32 0), align 4
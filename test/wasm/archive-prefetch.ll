@@ -0,0 +1,40 @@
+; Members that are known to be needed when an archive is read are decoded in
+; parallel ahead of time.  This must not change which members are loaded, or
+; the order in which they are added to the output.
+
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: llc -filetype=obj %S/Inputs/archive1.ll -o %t.a1.o
+; RUN: llc -filetype=obj %S/Inputs/archive2.ll -o %t.a2.o
+; RUN: llc -filetype=obj %S/Inputs/archive3.ll -o %t.a3.o
+; RUN: llc -filetype=obj %S/Inputs/hello.ll -o %t.hello.o
+; RUN: rm -f %t.a
+; RUN: llvm-ar rcs %t.a %t.a1.o %t.a2.o %t.hello.o %t.a3.o
+; RUN: wasm-ld --threads %t.o %t.a -o %t.threads.wasm
+; RUN: wasm-ld --no-threads %t.o %t.a -o %t.nothreads.wasm
+; RUN: cmp %t.threads.wasm %t.nothreads.wasm
+; RUN: obj2yaml %t.threads.wasm | FileCheck %s
+
+target triple = "wasm32-unknown-unknown"
+
+declare i32 @foo()
+declare void @hello()
+
+define void @_start() {
+entry:
+  %call = call i32 @foo()
+  call void @hello()
+  ret void
+}
+
+; CHECK:        - Type:            CUSTOM
+; CHECK-NEXT:     Name:            name
+; CHECK-NEXT:     FunctionNames:
+; CHECK-NEXT:       - Index:           0
+; CHECK-NEXT:         Name:            _start
+; CHECK-NEXT:       - Index:           1
+; CHECK-NEXT:         Name:            foo
+; CHECK-NEXT:       - Index:           2
+; CHECK-NEXT:         Name:            bar
+; CHECK-NEXT:       - Index:           3
+; CHECK-NEXT:         Name:            hello
+; CHECK-NOT:          Name:            archive3_symbol
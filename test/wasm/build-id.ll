@@ -0,0 +1,58 @@
+; RUN: llc -filetype=obj %s -o %t.o
+
+; RUN: wasm-ld --build-id %t.o -o %t.wasm
+; RUN: obj2yaml %t.wasm | FileCheck --check-prefix=DEFAULT %s
+; RUN: wasm-ld --build-id=fast %t.o -o %t2.wasm
+; RUN: cmp %t.wasm %t2.wasm
+
+; RUN: wasm-ld --build-id=md5 %t.o -o %t.wasm
+; RUN: obj2yaml %t.wasm | FileCheck --check-prefix=MD5 %s
+; RUN: wasm-ld --build-id=sha1 %t.o -o %t.wasm
+; RUN: obj2yaml %t.wasm | FileCheck --check-prefix=SHA1 %s
+; RUN: wasm-ld --build-id=tree %t.o -o %t.wasm
+; RUN: obj2yaml %t.wasm | FileCheck --check-prefix=SHA1 %s
+; RUN: wasm-ld --build-id=uuid %t.o -o %t.wasm
+; RUN: obj2yaml %t.wasm | FileCheck --check-prefix=UUID %s
+; RUN: wasm-ld --build-id=0x12345678 %t.o -o %t.wasm
+; RUN: obj2yaml %t.wasm | FileCheck --check-prefix=HEX %s
+
+; RUN: wasm-ld --build-id=none %t.o -o %t.wasm
+; RUN: obj2yaml %t.wasm | FileCheck --check-prefix=NONE %s
+; RUN: wasm-ld --build-id --build-id=none %t.o -o %t.wasm
+; RUN: obj2yaml %t.wasm | FileCheck --check-prefix=NONE %s
+
+; RUN: not wasm-ld --build-id=foo %t.o -o %t.wasm 2>&1 \
+; RUN:   | FileCheck --check-prefix=UNKNOWN %s
+; RUN: not wasm-ld --build-id --no-mmap-output-file %t.o -o %t.wasm 2>&1 \
+; RUN:   | FileCheck --check-prefix=STREAM %s
+
+target triple = "wasm32-unknown-unknown"
+
+define void @_start() {
+  ret void
+}
+
+; DEFAULT:      - Type:            CUSTOM
+; DEFAULT-NEXT:   Name:            build_id
+; DEFAULT-NEXT:   Payload:         '08{{[0-9A-F]{16}}}'
+
+; MD5:      - Type:            CUSTOM
+; MD5-NEXT:   Name:            build_id
+; MD5-NEXT:   Payload:         '10{{[0-9A-F]{32}}}'
+
+; SHA1:      - Type:            CUSTOM
+; SHA1-NEXT:   Name:            build_id
+; SHA1-NEXT:   Payload:         '14{{[0-9A-F]{40}}}'
+
+; UUID:      - Type:            CUSTOM
+; UUID-NEXT:   Name:            build_id
+; UUID-NEXT:   Payload:         '10{{[0-9A-F]{32}}}'
+
+; HEX:      - Type:            CUSTOM
+; HEX-NEXT:   Name:            build_id
+; HEX-NEXT:   Payload:         '0412345678'
+
+; NONE-NOT: build_id
+
+; UNKNOWN: error: unknown --build-id style: foo
+; STREAM: error: --build-id and --no-mmap-output-file may not be used together
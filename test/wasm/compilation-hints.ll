@@ -0,0 +1,43 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: echo "_start bar 10" > %t.cg
+; RUN: echo "bar baz 20" >> %t.cg
+; RUN: wasm-ld --call-graph-ordering-file %t.cg --compilation-hints \
+; RUN:   -o %t.wasm %t.o
+; RUN: obj2yaml %t.wasm | FileCheck %s
+
+; RUN: wasm-ld --call-graph-ordering-file %t.cg -o %t.wasm %t.o
+; RUN: obj2yaml %t.wasm | FileCheck %s --check-prefix=NONE
+
+; RUN: not wasm-ld --compilation-hints -o %t.wasm %t.o 2>&1 | \
+; RUN:   FileCheck %s --check-prefix=ERR
+
+target triple = "wasm32-unknown-unknown"
+
+define void @foo() {
+  ret void
+}
+
+define void @bar() {
+  call void @baz()
+  ret void
+}
+
+define void @baz() {
+  ret void
+}
+
+define void @_start() {
+  call void @foo()
+  call void @bar()
+  ret void
+}
+
+; Functions are laid out as _start, bar, baz and foo.  Each entry is the
+; function index followed by the calls made and received, hottest first.
+
+; CHECK:          Name:            compilation_hints
+; CHECK-NEXT:     Payload:         '0301140A020014000A00'
+
+; NONE-NOT: compilation_hints
+
+; ERR: error: --compilation-hints requires --call-graph-ordering-file
@@ -13,6 +13,10 @@
 ; RUN: wasm-ld -no-gc-sections --no-entry --shared-memory --max-memory=131072 %t.atomics.bulk-mem.o -o %t.atomics.bulk-mem.wasm
 ; RUN: obj2yaml %t.atomics.bulk-mem.wasm | FileCheck %s --check-prefixes PASSIVE
 
+; atomics, bulk memory, shared imported memory => passive segments, bss zeroed with memory.fill
+; RUN: wasm-ld -no-gc-sections --no-entry --shared-memory --import-memory --max-memory=131072 %t.atomics.bulk-mem.o -o %t.imported.wasm
+; RUN: obj2yaml %t.imported.wasm | FileCheck %s --check-prefixes IMPORTED
+
 target triple = "wasm32-unknown-unknown"
 
 @a = hidden global [6 x i8] c"hello\00", align 1
@@ -59,7 +63,7 @@ target triple = "wasm32-unknown-unknown"
 ; PASSIVE-NEXT:        Body:            0B
 ; PASSIVE-NEXT:      - Index:           1
 ; PASSIVE-NEXT:        Locals:          []
-; PASSIVE-NEXT:        Body:            41B4D60041004101FE480200044041B4D6004101427FFE0102001A054180084100410DFC08000041900841004114FC08010041A40841004190CE00FC08020041B4D6004102FE17020041B4D600417FFE0002001A0BFC0900FC0901FC09020B
+; PASSIVE-NEXT:        Body:            41B4D60041004101FE480200044041B4D6004101427FFE0102001A054180084100410DFC08000041900841004114FC08010041B4D6004102FE17020041B4D600417FFE0002001A0BFC0900FC09010B
 ; PASSIVE-NEXT:  - Index:           2
 ; PASSIVE-NEXT:    Locals:          []
 ; PASSIVE-NEXT:    Body:            0B
@@ -80,3 +84,21 @@ target triple = "wasm32-unknown-unknown"
 ; PASSIVE-NEXT:        Name:            __wasm_init_memory
 ; PASSIVE-NEXT:      - Index:           2
 ; PASSIVE-NEXT:        Name:            __wasm_init_tls
+
+; IMPORTED-LABEL: - Type:            CODE
+; IMPORTED-NEXT:    Functions:
+; IMPORTED-NEXT:      - Index:           0
+; IMPORTED-NEXT:        Locals:          []
+; IMPORTED-NEXT:        Body:            0B
+; IMPORTED-NEXT:      - Index:           1
+; IMPORTED-NEXT:        Locals:          []
+; IMPORTED-NEXT:        Body:            41B4D60041004101FE480200044041B4D6004101427FFE0102001A054180084100410DFC08000041900841004114FC08010041A40841004190CE00FC0B0041B4D6004102FE17020041B4D600417FFE0002001A0BFC0900FC09010B
+; IMPORTED:       - Type:            DATA
+; IMPORTED-NEXT:    Segments:
+; IMPORTED-NEXT:      - SectionOffset:   3
+; IMPORTED-NEXT:        InitFlags:       1
+; IMPORTED-NEXT:        Content:         636F6E7374616E74000000002B
+; IMPORTED-NEXT:      - SectionOffset:   18
+; IMPORTED-NEXT:        InitFlags:       1
+; IMPORTED-NEXT:        Content:         68656C6C6F00676F6F646279650000002A000000
+; IMPORTED-NEXT:  - Type:            CUSTOM
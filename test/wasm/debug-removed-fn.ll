@@ -6,6 +6,20 @@
 ; CHECK: 0x0000000000000005
 ; CHECK: 0x0000000000000000
 
+; With --prune-debug-info the line table sequence of bar is removed, and with
+; nothing left to describe the whole compilation unit is.
+
+; RUN: wasm-ld %t.o --no-entry --export=foo --prune-debug-info -o %t.prune.wasm
+; RUN: llvm-dwarfdump -debug-line %t.prune.wasm | FileCheck %s --check-prefix=PRUNE
+; RUN: wasm-ld %t.o --no-entry --prune-debug-info -o %t.none.wasm
+; RUN: obj2yaml %t.none.wasm | FileCheck %s --check-prefix=NONE
+
+; PRUNE: Address
+; PRUNE: 0x0000000000000005
+; PRUNE-NOT: 0x0000000000000000
+
+; NONE-NOT: .debug_
+
 ; ModuleID = 't.bc'
 target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
 target triple = "wasm32-unknown-unknown-wasm"
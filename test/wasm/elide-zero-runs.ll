@@ -0,0 +1,50 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld --no-gc-sections %t.o -o %t.wasm
+; RUN: obj2yaml %t.wasm | FileCheck --check-prefix=DEFAULT %s
+; RUN: wasm-ld --no-gc-sections --elide-zero-runs=16 %t.o -o %t.wasm
+; RUN: obj2yaml %t.wasm | FileCheck %s
+; RUN: wasm-ld --no-gc-sections --elide-zero-runs=16 --import-memory %t.o \
+; RUN:   -o %t.wasm
+; RUN: obj2yaml %t.wasm | FileCheck --check-prefix=DEFAULT %s
+; RUN: not wasm-ld -r --elide-zero-runs=16 %t.o -o /dev/null 2>&1 | \
+; RUN:   FileCheck --check-prefix=ERR %s
+
+target triple = "wasm32-unknown-unknown"
+
+@a = global <{ i32, [62 x i32], i32 }> <{ i32 1, [62 x i32] zeroinitializer, i32 2 }>, align 4
+@b = global <{ i32, [2 x i32], i32 }> <{ i32 3, [2 x i32] zeroinitializer, i32 4 }>, align 4
+
+define void @_start() {
+  ret void
+}
+
+; By default the zeros are written out. So are they if the memory is imported,
+; since it may not be zeroed.
+; DEFAULT:        - Type:            DATA
+; DEFAULT-NEXT:     Segments:
+; DEFAULT-NEXT:       - SectionOffset:
+; DEFAULT-NEXT:         InitFlags:       0
+; DEFAULT-NEXT:         Offset:
+; DEFAULT-NEXT:           Opcode:          I32_CONST
+; DEFAULT-NEXT:           Value:           1024
+; DEFAULT-NEXT:         Content:
+; DEFAULT-NEXT:   - Type:            CUSTOM
+
+; The run of 248 zeros in @a is left out. The 8 zeros in @b are shorter than
+; the minimum run and are kept.
+; CHECK:        - Type:            DATA
+; CHECK-NEXT:     Segments:
+; CHECK-NEXT:       - SectionOffset:
+; CHECK-NEXT:         InitFlags:       0
+; CHECK-NEXT:         Offset:
+; CHECK-NEXT:           Opcode:          I32_CONST
+; CHECK-NEXT:           Value:           1024
+; CHECK-NEXT:         Content:         '01000000'
+; CHECK-NEXT:       - SectionOffset:
+; CHECK-NEXT:         InitFlags:       0
+; CHECK-NEXT:         Offset:
+; CHECK-NEXT:           Opcode:          I32_CONST
+; CHECK-NEXT:           Value:           1276
+; CHECK-NEXT:         Content:         '0200000003000000000000000000000004000000'
+
+; ERR: -r and --elide-zero-runs may not be used together
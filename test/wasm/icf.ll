@@ -0,0 +1,76 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld --icf=all --print-icf-sections -o %t.wasm %t.o | \
+; RUN:     FileCheck %s -check-prefix=ALL
+; RUN: wasm-ld --icf=safe --print-icf-sections -o %t.wasm %t.o | \
+; RUN:     FileCheck %s -check-prefix=SAFE
+; RUN: wasm-ld --icf=none --print-icf-sections -o %t.wasm %t.o | \
+; RUN:     FileCheck %s -check-prefix=NONE --allow-empty
+; RUN: not wasm-ld -r --icf=all -o %t.o.wasm %t.o 2>&1 | \
+; RUN:     FileCheck %s -check-prefix=RELOC
+; RUN: wasm-ld --icf=all --print-stats=json -o %t.wasm %t.o | \
+; RUN:     FileCheck %s -check-prefix=STATS
+
+; ALL: selected function {{.*}}:(foo)
+; ALL-NEXT:   removing identical function {{.*}}:(foo2)
+; ALL-NEXT:   removing identical function {{.*}}:(baz)
+; ALL-NOT: removing identical function {{.*}}:(different)
+
+; SAFE: selected function {{.*}}:(foo)
+; SAFE-NEXT:   removing identical function {{.*}}:(foo2)
+; SAFE-NOT: removing identical function {{.*}}:(baz)
+
+; NONE-NOT: selected function
+
+; RELOC: error: -r and --icf may not be used together
+
+;; Folded functions are not counted as removed by garbage collection.
+; STATS:      "functions": {
+; STATS-NEXT:   "input": 6,
+; STATS-NEXT:   "gc_removed": 0,
+; STATS-NEXT:   "gc_removed_bytes": 0,
+; STATS-NEXT:   "icf_folded": 2,
+; STATS-NEXT:   "icf_folded_bytes": {{[1-9][0-9]*}}
+; STATS-NEXT: },
+
+target triple = "wasm32-unknown-unknown"
+
+@ptr = hidden global void ()* @baz, align 4
+
+define hidden void @bar() {
+entry:
+  ret void
+}
+
+define hidden void @foo() {
+entry:
+  call void @bar()
+  ret void
+}
+
+define hidden void @foo2() {
+entry:
+  call void @bar()
+  ret void
+}
+
+define hidden void @baz() {
+entry:
+  call void @bar()
+  ret void
+}
+
+define hidden void @different() {
+entry:
+  call void @bar()
+  call void @bar()
+  ret void
+}
+
+define hidden void @_start() {
+entry:
+  call void @foo()
+  call void @foo2()
+  call void @baz()
+  call void @different()
+  ret void
+}
@@ -0,0 +1,53 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: rm -f %t.wasm.incremental
+; RUN: wasm-ld --incremental --strip-debug --verbose %t.o -o %t.wasm 2>&1 \
+; RUN:   | FileCheck --check-prefix=FIRST %s
+; RUN: obj2yaml %t.wasm | FileCheck --check-prefix=V1 %s
+
+; FIRST: --incremental: no index from a previous link; doing a full link
+
+; Nothing changed.
+; RUN: wasm-ld --incremental --strip-debug --verbose %t.o -o %t.wasm 2>&1 \
+; RUN:   | FileCheck --check-prefix=SAME %s
+
+; SAME: --incremental: output is up to date
+
+; Only the body of foo changed, so it is rewritten in place.
+; RUN: llc -filetype=obj %p/Inputs/incremental-body.ll -o %t.o
+; RUN: wasm-ld --incremental --strip-debug --verbose %t.o -o %t.wasm 2>&1 \
+; RUN:   | FileCheck --check-prefix=PATCH %s
+; RUN: obj2yaml %t.wasm | FileCheck --check-prefix=V2 %s
+
+; PATCH: --incremental: rewrote 2 functions in place
+
+; foo now calls a new function, which changes the layout.
+; RUN: llc -filetype=obj %p/Inputs/incremental-layout.ll -o %t.o
+; RUN: wasm-ld --incremental --strip-debug --verbose %t.o -o %t.wasm 2>&1 \
+; RUN:   | FileCheck --check-prefix=LAYOUT %s
+
+; LAYOUT: --incremental: layout of {{.*}}.o changed; doing a full link
+
+; RUN: not wasm-ld --incremental %t.o -o %t.wasm 2>&1 \
+; RUN:   | FileCheck --check-prefix=DEBUG %s
+; RUN: not wasm-ld --incremental --strip-debug --compress-relocations %t.o \
+; RUN:   -o %t.wasm 2>&1 | FileCheck --check-prefix=COMPRESS %s
+
+; DEBUG: error: --incremental is incompatible with output debug information
+; COMPRESS: error: --incremental and --compress-relocations may not be used together
+
+target triple = "wasm32-unknown-unknown"
+
+define i32 @foo() {
+  ret i32 1
+}
+
+define void @_start() {
+  call i32 @foo()
+  ret void
+}
+
+; Function bodies are padded with nops before their final `end`.
+; V1:      - Type:            CODE
+; V1:            Body:            004101{{(01)+}}0B
+; V2:      - Type:            CODE
+; V2:            Body:            00412A{{(01)+}}0B
@@ -0,0 +1,52 @@
+; RUN: opt -module-summary %s -o %t1.o
+; RUN: opt -module-summary %p/Inputs/thinlto.ll -o %t2.o
+
+; Ensure lld generates an index and not a binary if requested.
+; RUN: rm -f %t3 %t1.o.thinlto.bc %t2.o.thinlto.bc
+; RUN: wasm-ld --thinlto-index-only -r %t1.o %t2.o -o %t3
+; RUN: llvm-bcanalyzer -dump %t1.o.thinlto.bc | FileCheck %s --check-prefix=BACKEND1
+; RUN: llvm-bcanalyzer -dump %t2.o.thinlto.bc | FileCheck %s --check-prefix=BACKEND2
+; RUN: not test -e %t3
+
+; Check that the list of object files is written to the given file and that
+; imports files are emitted.
+; RUN: rm -f %t1.o.imports %t2.o.imports
+; RUN: wasm-ld --thinlto-index-only=%t.list --thinlto-emit-imports-files -r \
+; RUN:   %t1.o %t2.o -o %t3
+; RUN: FileCheck %s --check-prefix=LIST < %t.list
+; RUN: FileCheck %s --check-prefix=IMPORTS < %t1.o.imports
+; RUN: count 0 < %t2.o.imports
+; RUN: not test -e %t3
+
+; Check --thinlto-prefix-replace and --thinlto-object-suffix-replace.
+; RUN: rm -rf %t.dir && mkdir -p %t.dir
+; RUN: wasm-ld --thinlto-index-only --thinlto-prefix-replace="%t;%t.dir/" \
+; RUN:   -r %t1.o %t2.o -o %t3
+; RUN: ls %t.dir/1.o.thinlto.bc %t.dir/2.o.thinlto.bc
+; RUN: not wasm-ld --thinlto-index-only --thinlto-prefix-replace=abc \
+; RUN:   -r %t1.o -o %t3 2>&1 | FileCheck %s --check-prefix=ERR
+
+; LIST: {{.*}}1.o
+; LIST: {{.*}}2.o
+; IMPORTS: {{.*}}2.o
+; ERR: --thinlto-prefix-replace= expects 'old;new' format, but got abc
+
+; BACKEND1: <MODULE_STRTAB_BLOCK
+; BACKEND1-NEXT: <ENTRY {{.*}} record string = '{{.*}}thinlto-index-only.ll.tmp{{.*}}.o'
+; BACKEND1-NEXT: <ENTRY {{.*}} record string = '{{.*}}thinlto-index-only.ll.tmp{{.*}}.o'
+; BACKEND1-NEXT: </MODULE_STRTAB_BLOCK
+
+; BACKEND2: <MODULE_STRTAB_BLOCK
+; BACKEND2-NEXT: <ENTRY {{.*}} record string = '{{.*}}2.o'
+; BACKEND2-NEXT: </MODULE_STRTAB_BLOCK
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+declare void @g(...)
+
+define void @f() {
+entry:
+  call void (...) @g()
+  ret void
+}
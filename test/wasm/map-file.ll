@@ -0,0 +1,36 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld %t.o -o %t.wasm -Map=%t.map
+; RUN: FileCheck --input-file=%t.map %s
+
+target triple = "wasm32-unknown-unknown"
+
+@data_global = global i32 1, align 4
+@bss_global = global i32 0, align 4
+
+define void @some_func() {
+  ret void
+}
+
+define void @_start() {
+  call void @some_func()
+  ret void
+}
+
+; CHECK:          Addr      Off     Size Out     In      Symbol
+; CHECK-NEXT:        -        8 {{.*}} TYPE{{$}}
+; CHECK:             - {{.*}} CODE{{$}}
+; CHECK-NEXT:        - {{.*}}         {{.*}}.o:(some_func)
+; CHECK-NEXT:        - {{.*}}                 some_func
+; CHECK-NEXT:        - {{.*}}         {{.*}}.o:(_start)
+; CHECK-NEXT:        - {{.*}}                 _start
+; CHECK-NEXT:        - {{.*}} DATA{{$}}
+; CHECK-NEXT:      400 {{.*}}        4         .data
+; CHECK-NEXT:      400 {{.*}}        4                 {{.*}}.o:(.data.data_global)
+; CHECK-NEXT:      400 {{.*}}        4                         data_global
+; CHECK-NEXT:      404        -        4         .bss
+; CHECK-NEXT:      404        -        4                 {{.*}}.o:(.bss.bss_global)
+; CHECK-NEXT:      404        -        4                         bss_global
+
+; RUN: not wasm-ld %t.o -o %t.wasm -Map=/ 2>&1 \
+; RUN:  | FileCheck -check-prefix=FAIL %s
+; FAIL: wasm-ld: error: cannot open /
@@ -0,0 +1,51 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: llc -filetype=obj %p/Inputs/merge-string.ll -o %t2.o
+
+; Identical strings are deduplicated by default.
+; RUN: wasm-ld --no-gc-sections -o %t.wasm %t.o %t2.o -Map=%t.map
+; RUN: FileCheck --input-file=%t.map %s --check-prefix=MERGE
+
+; With -O2, strings that are a suffix of another string are merged too.
+; RUN: wasm-ld --no-gc-sections -O2 -o %t.o2.wasm %t.o %t2.o -Map=%t.o2.map
+; RUN: FileCheck --input-file=%t.o2.map %s --check-prefix=TAIL
+; RUN: obj2yaml %t.o2.wasm | FileCheck %s --check-prefix=TAIL-DATA
+
+; No merging without --merge-data-segments.
+; RUN: wasm-ld --no-gc-sections --no-merge-data-segments -o %t.nomerge.wasm %t.o %t2.o
+; RUN: obj2yaml %t.nomerge.wasm | FileCheck %s --check-prefix=NOMERGE
+
+target triple = "wasm32-unknown-unknown"
+
+@.str = private unnamed_addr constant [4 x i8] c"foo\00", align 1
+@.str.1 = private unnamed_addr constant [7 x i8] c"barfoo\00", align 1
+
+@ptr1 = global i8* getelementptr inbounds ([4 x i8], [4 x i8]* @.str, i32 0, i32 0), align 4
+@ptr2 = global i8* getelementptr inbounds ([7 x i8], [7 x i8]* @.str.1, i32 0, i32 0), align 4
+
+define void @_start() {
+  ret void
+}
+
+; MERGE:      400 {{.*}}        b         .rodata
+; MERGE-NEXT: 400 {{.*}}        b                 <internal>:(.rodata)
+
+; TAIL:      400 {{.*}}        7         .rodata
+; TAIL-NEXT: 400 {{.*}}        7                 <internal>:(.rodata)
+
+; TAIL-DATA:        - Type:            DATA
+; TAIL-DATA-NEXT:     Segments:
+; TAIL-DATA-NEXT:       - SectionOffset:   7
+; TAIL-DATA-NEXT:         InitFlags:       0
+; TAIL-DATA-NEXT:         Offset:
+; TAIL-DATA-NEXT:           Opcode:          I32_CONST
+; TAIL-DATA-NEXT:           Value:           1024
+; TAIL-DATA-NEXT:         Content:         626172666F6F00
+; TAIL-DATA-NEXT:       - SectionOffset:   20
+; TAIL-DATA-NEXT:         InitFlags:       0
+; TAIL-DATA-NEXT:         Offset:
+; TAIL-DATA-NEXT:           Opcode:          I32_CONST
+; TAIL-DATA-NEXT:           Value:           1032
+; TAIL-DATA-NEXT:         Content:         '030400000004000003040000'
+
+; NOMERGE: Content:         666F6F00666F6F00
+; NOMERGE: Content:         626172666F6F00
@@ -0,0 +1,25 @@
+; Writing the output one section at a time produces the same file as
+; writing it through a memory mapping.
+
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld %t.o -o %t.mmap.wasm
+; RUN: wasm-ld --no-mmap-output-file %t.o -o %t.stream.wasm
+; RUN: cmp %t.mmap.wasm %t.stream.wasm
+; RUN: wasm-ld --no-mmap-output-file --mmap-output-file %t.o -o %t.stream.wasm
+; RUN: cmp %t.mmap.wasm %t.stream.wasm
+
+target triple = "wasm32-unknown-unknown"
+
+@str = private unnamed_addr constant [6 x i8] c"hello\00", align 1
+@ptr = global i8* getelementptr inbounds ([6 x i8], [6 x i8]* @str, i32 0, i32 0), align 4
+@bss = global [64 x i32] zeroinitializer, align 4
+
+define i8* @get() {
+  %p = load i8*, i8** @ptr, align 4
+  ret i8* %p
+}
+
+define void @_start() {
+  call i8* @get()
+  ret void
+}
@@ -0,0 +1,28 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld %t.o -o %t.wasm -Map=%t.map
+; RUN: FileCheck --check-prefix=DEFAULT --input-file=%t.map %s
+; RUN: wasm-ld --pack-data-segments %t.o -o %t.wasm -Map=%t.map
+; RUN: FileCheck --check-prefix=PACK --input-file=%t.map %s
+
+target triple = "wasm32-unknown-unknown"
+
+@a = global i8 1, align 1
+@b = global [4 x i32] [i32 1, i32 2, i32 3, i32 4], align 16
+@c = global i8 2, align 1
+@d = global [4 x i32] [i32 5, i32 6, i32 7, i32 8], align 16
+
+define void @_start() {
+  ret void
+}
+
+; By default the input segments keep their input order.
+; DEFAULT:      400 {{.*}}        1                         a
+; DEFAULT:      410 {{.*}}       10                         b
+; DEFAULT:      420 {{.*}}        1                         c
+; DEFAULT:      430 {{.*}}       10                         d
+
+; Packing places the more aligned segments first.
+; PACK:      400 {{.*}}       10                         b
+; PACK:      410 {{.*}}       10                         d
+; PACK:      420 {{.*}}        1                         a
+; PACK:      421 {{.*}}        1                         c
@@ -0,0 +1,59 @@
+; RUN: llc -relocation-model=pic -filetype=obj %s -o %t.o
+; RUN: wasm-ld --no-gc-sections --allow-undefined -pie -o %t.wasm %t.o
+; RUN: obj2yaml %t.wasm | FileCheck --check-prefix=NONE %s
+; RUN: wasm-ld --no-gc-sections --allow-undefined -pie \
+; RUN:   --pack-dyn-relocs=relr -o %t.relr.wasm %t.o
+; RUN: obj2yaml %t.relr.wasm | FileCheck --check-prefix=RELR %s
+; RUN: not wasm-ld -pie --pack-dyn-relocs=android -o %t.wasm %t.o 2>&1 \
+; RUN:   | FileCheck --check-prefix=ERROR %s
+
+target triple = "wasm32-unknown-emscripten"
+
+@data = hidden global i32 2, align 4
+@data_external = external global i32
+
+; Three relocations in consecutive words, which are encoded as an offset
+; followed by a bitmap.
+@ptrs = hidden global [3 x i32*] [i32* @data, i32* @data, i32* @data], align 4
+; A relocation against __table_base.
+@func_ptr = hidden global i32 ()* @foo, align 4
+; A relocation that goes through the GOT, which is still applied by code.
+@ext_ptr = hidden global i32* @data_external, align 4
+
+define hidden i32 @foo() {
+entry:
+  ret i32 0
+}
+
+define void @_start() {
+  ret void
+}
+
+; Without packing, the data segment only holds the data.
+; NONE:        - Type:            DATA
+; NONE-NEXT:     Segments:
+; NONE-NEXT:       - SectionOffset:   {{[0-9]+}}
+; NONE-NEXT:         InitFlags:       0
+; NONE-NEXT:         Offset:
+; NONE-NEXT:           Opcode:          GLOBAL_GET
+; NONE-NEXT:           Index:           {{[0-9]+}}
+; NONE-NEXT:         Content:         '02000000{{[0-9A-F]{40}}}'
+
+; With packing, the table follows the data.  It holds the offset 4 and a
+; bitmap for the following two words (relative to __memory_base), then the
+; offset 16 (relative to __table_base).
+; RELR:        - Type:            DATA
+; RELR-NEXT:     Segments:
+; RELR-NEXT:       - SectionOffset:   {{[0-9]+}}
+; RELR-NEXT:         InitFlags:       0
+; RELR-NEXT:         Offset:
+; RELR-NEXT:           Opcode:          GLOBAL_GET
+; RELR-NEXT:           Index:           {{[0-9]+}}
+; RELR-NEXT:         Content:         '02000000{{[0-9A-F]{40}}}040000000700000010000000'
+
+; RELR:        - Type:            CUSTOM
+; RELR-NEXT:     Name:            name
+; RELR-NEXT:     FunctionNames:
+; RELR:              Name:            __wasm_apply_relocs
+
+; ERROR: error: unknown --pack-dyn-relocs format: android
@@ -0,0 +1,38 @@
+; --preload-inputs reads the input files on background threads, which must
+; not change the output. LLD_IN_TEST=0 makes wasm-ld exit early, as it does
+; outside of tests; otherwise it keeps the inputs for another link and does
+; not preload them.
+
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: llc -filetype=obj %p/Inputs/ret32.ll -o %t.ret32.o
+; RUN: rm -f %t.a
+; RUN: llvm-ar rcs %t.a %t.ret32.o
+; RUN: wasm-ld %t.o %t.a -o %t.wasm
+
+; RUN: env LLD_IN_TEST=0 wasm-ld --preload-inputs %t.o %t.a -o %t.preload.wasm
+; RUN: cmp %t.wasm %t.preload.wasm
+
+; A path that is named twice is read again the second time.
+; RUN: env LLD_IN_TEST=0 wasm-ld --preload-inputs %t.o %t.a %t.a \
+; RUN:   -o %t.twice.wasm
+; RUN: cmp %t.wasm %t.twice.wasm
+
+; With one thread, the files are read as they are needed.
+; RUN: env LLD_IN_TEST=0 wasm-ld --preload-inputs --threads=1 %t.o %t.a \
+; RUN:   -o %t.threads1.wasm
+; RUN: cmp %t.wasm %t.threads1.wasm
+
+; A missing file is reported as without the option.
+; RUN: not env LLD_IN_TEST=0 wasm-ld --preload-inputs %t.o %t.missing.o %t.a \
+; RUN:   -o /dev/null 2>&1 | FileCheck --check-prefix=MISSING %s
+; MISSING: error: cannot open {{.*}}.missing.o
+
+target triple = "wasm32-unknown-unknown"
+
+declare i32 @ret32(float)
+
+define void @_start() {
+entry:
+  %call = call i32 @ret32(float 0.0)
+  ret void
+}
@@ -0,0 +1,56 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld --print-stats=json %t.o -o %t.wasm | FileCheck %s
+; RUN: not wasm-ld --print-stats=yaml %t.o -o %t.wasm 2>&1 \
+; RUN:   | FileCheck --check-prefix=FORMAT %s
+
+target triple = "wasm32-unknown-unknown"
+
+@used = global i32 1, align 4
+@unused_data = global i32 2, align 4
+
+define i32 @unused_func() {
+  ret i32 0
+}
+
+define i32* @_start() {
+  ret i32* @used
+}
+
+; CHECK:      {
+; CHECK-NEXT:   "version": "LLD {{.*}}",
+; CHECK-NEXT:   "output": "{{.*}}.wasm",
+; CHECK-NEXT:   "output_size": {{[1-9][0-9]*}},
+; CHECK-NEXT:   "input_bytes": {{[1-9][0-9]*}},
+; CHECK-NEXT:   "peak_rss_bytes": {{[0-9]+}},
+; CHECK-NEXT:   "phases": [
+; CHECK:          "name": "Input File Reading",
+; CHECK:          "name": "Write Sections",
+; CHECK:        "total_ms":
+; CHECK-NEXT:   "functions": {
+; CHECK-NEXT:     "input": 2,
+; CHECK-NEXT:     "gc_removed": 1,
+; CHECK-NEXT:     "gc_removed_bytes": {{[1-9][0-9]*}},
+; CHECK-NEXT:     "icf_folded": 0,
+; CHECK-NEXT:     "icf_folded_bytes": 0
+; CHECK-NEXT:   },
+; CHECK-NEXT:   "data_segments": {
+; CHECK-NEXT:     "input": 2,
+; CHECK-NEXT:     "gc_removed": 1,
+; CHECK-NEXT:     "gc_removed_bytes": 4
+; CHECK-NEXT:   },
+; CHECK-NEXT:   "relocations": {
+; CHECK-NEXT:     "R_WASM_MEMORY_ADDR_SLEB": 1
+; CHECK-NEXT:   },
+; CHECK-NEXT:   "compressed_relocations_saved_bytes": 0,
+; CHECK-NEXT:   "output_sections": [
+; CHECK-NEXT:     {
+; CHECK-NEXT:       "name": "TYPE",
+; CHECK-NEXT:       "size": {{[0-9]+}}
+; CHECK-NEXT:     },
+; CHECK:            "name": "CODE",
+; CHECK:            "name": "DATA",
+; CHECK:            "name": "CUSTOM(name)",
+; CHECK:        ]
+; CHECK-NEXT: }
+
+; FORMAT: error: unknown --print-stats format: yaml (supported formats: json)
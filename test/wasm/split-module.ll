@@ -0,0 +1,75 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: printf '_start\nhot\n' > %t.profile
+; RUN: wasm-ld --strip-debug --split-module=%t.profile -o %t.wasm %t.o
+; RUN: obj2yaml %t.wasm | FileCheck %s
+; RUN: obj2yaml %t.deferred.wasm | FileCheck --check-prefix=SECONDARY %s
+
+; RUN: not wasm-ld --split-module=%t.profile -o %t.wasm %t.o 2>&1 \
+; RUN:   | FileCheck --check-prefix=DEBUG %s
+; DEBUG: error: --split-module is incompatible with output debug information
+
+target triple = "wasm32-unknown-unknown"
+
+define hidden i32 @hot() {
+  ret i32 1
+}
+
+define hidden i32 @cold(i32 %x) {
+  %r = call i32 @hot()
+  %s = add i32 %r, %x
+  ret i32 %s
+}
+
+define void @_start() {
+  %r = call i32 @cold(i32 2)
+  ret void
+}
+
+; The primary module calls @cold through a stub, which calls through the
+; table slot that holds the placeholder until the secondary module is loaded.
+
+; CHECK:        - Type:            IMPORT
+; CHECK-NEXT:     Imports:
+; CHECK-NEXT:       - Module:          placeholder
+; CHECK-NEXT:         Field:           '1'
+; CHECK-NEXT:         Kind:            FUNCTION
+; CHECK:        - Type:            EXPORT
+; CHECK:            - Name:            __indirect_function_table
+; CHECK-NEXT:         Kind:            TABLE
+; CHECK:            - Name:            split.f[[HOT:[0-9]+]]
+; CHECK-NEXT:         Kind:            FUNCTION
+; CHECK-NEXT:         Index:           [[HOT]]
+; CHECK:        - Type:            ELEM
+; CHECK-NEXT:     Segments:
+; CHECK-NEXT:       - Offset:
+; CHECK-NEXT:           Opcode:          I32_CONST
+; CHECK-NEXT:           Value:           1
+; CHECK-NEXT:         Functions:       [ 0 ]
+; CHECK:        - Type:            CODE
+; CHECK:              Body:            2000410111{{[0-9A-F]{2}}}000B
+
+; The secondary module holds @cold, which calls @hot through an import, and
+; overwrites the placeholder in the shared table.
+
+; SECONDARY:        - Type:            IMPORT
+; SECONDARY-NEXT:     Imports:
+; SECONDARY-NEXT:       - Module:          primary
+; SECONDARY-NEXT:         Field:           memory
+; SECONDARY-NEXT:         Kind:            MEMORY
+; SECONDARY:            - Module:          primary
+; SECONDARY-NEXT:         Field:           __indirect_function_table
+; SECONDARY-NEXT:         Kind:            TABLE
+; SECONDARY:            - Module:          primary
+; SECONDARY-NEXT:         Field:           split.f{{[0-9]+}}
+; SECONDARY-NEXT:         Kind:            FUNCTION
+; SECONDARY:        - Type:            FUNCTION
+; SECONDARY-NEXT:     FunctionTypes:   [ 0 ]
+; SECONDARY:        - Type:            ELEM
+; SECONDARY-NEXT:     Segments:
+; SECONDARY-NEXT:       - Offset:
+; SECONDARY-NEXT:           Opcode:          I32_CONST
+; SECONDARY-NEXT:           Value:           1
+; SECONDARY-NEXT:         Functions:       [ 1 ]
+; SECONDARY:        - Type:            CODE
+; SECONDARY-NEXT:     Functions:
+; SECONDARY-NEXT:       - Index:           1
@@ -0,0 +1,77 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld -o %t.wasm %t.o
+; RUN: obj2yaml %t.wasm | FileCheck %s --check-prefix=DEFAULT
+
+; RUN: echo "baz" > %t.order
+; RUN: echo "missing" >> %t.order
+; RUN: echo "bar" >> %t.order
+; RUN: wasm-ld --symbol-ordering-file %t.order -o %t.wasm %t.o 2>&1 | \
+; RUN:   FileCheck %s --check-prefix=WARN
+; RUN: obj2yaml %t.wasm | FileCheck %s --check-prefix=ORDER
+
+; RUN: wasm-ld --symbol-ordering-file %t.order --no-warn-symbol-ordering \
+; RUN:   -o %t.wasm %t.o 2>&1 | count 0
+
+; RUN: echo "_start bar 10" > %t.cg
+; RUN: echo "bar baz 20" >> %t.cg
+; RUN: wasm-ld --call-graph-ordering-file %t.cg -o %t.wasm %t.o
+; RUN: obj2yaml %t.wasm | FileCheck %s --check-prefix=CG
+
+; RUN: not wasm-ld --symbol-ordering-file %t.order \
+; RUN:   --call-graph-ordering-file %t.cg -o %t.wasm %t.o 2>&1 | \
+; RUN:   FileCheck %s --check-prefix=BOTH
+
+target triple = "wasm32-unknown-unknown"
+
+define void @foo() {
+  ret void
+}
+
+define void @bar() {
+  call void @baz()
+  ret void
+}
+
+define void @baz() {
+  ret void
+}
+
+define void @_start() {
+  call void @foo()
+  call void @bar()
+  ret void
+}
+
+; DEFAULT:        FunctionNames:
+; DEFAULT-NEXT:     - Index:           0
+; DEFAULT-NEXT:       Name:            foo
+; DEFAULT-NEXT:     - Index:           1
+; DEFAULT-NEXT:       Name:            bar
+; DEFAULT-NEXT:     - Index:           2
+; DEFAULT-NEXT:       Name:            baz
+; DEFAULT-NEXT:     - Index:           3
+; DEFAULT-NEXT:       Name:            _start
+
+; WARN: warning: symbol ordering file: no such symbol: missing
+
+; ORDER:        FunctionNames:
+; ORDER-NEXT:     - Index:           0
+; ORDER-NEXT:       Name:            baz
+; ORDER-NEXT:     - Index:           1
+; ORDER-NEXT:       Name:            bar
+; ORDER-NEXT:     - Index:           2
+; ORDER-NEXT:       Name:            foo
+; ORDER-NEXT:     - Index:           3
+; ORDER-NEXT:       Name:            _start
+
+; CG:        FunctionNames:
+; CG-NEXT:     - Index:           0
+; CG-NEXT:       Name:            _start
+; CG-NEXT:     - Index:           1
+; CG-NEXT:       Name:            bar
+; CG-NEXT:     - Index:           2
+; CG-NEXT:       Name:            baz
+; CG-NEXT:     - Index:           3
+; CG-NEXT:       Name:            foo
+
+; BOTH: error: --symbol-ordering-file and --call-graph-order-file may not be used together
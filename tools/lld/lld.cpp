@@ -26,8 +26,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "lld/Common/Driver.h"
+#include "lld/Common/InputCache.h"
+#include "lld/Common/LinkServer.h"
 #include "lld/Common/Memory.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/Triple.h"
@@ -141,26 +144,61 @@ static Flavor parseFlavor(std::vector<const char *> &v) {
 // and we use it to detect whether we are running tests or not.
 static bool canExitEarly() { return StringRef(getenv("LLD_IN_TEST")) != "1"; }
 
-/// Universal linker main(). This linker emulates the gnu, darwin, or
-/// windows linker based on the argv[0] or -flavor option.
-int main(int argc, const char **argv) {
-  InitLLVM x(argc, argv);
-
-  std::vector<const char *> args(argv, argv + argc);
+static int lldMain(std::vector<const char *> &args, bool canExitEarly) {
   switch (parseFlavor(args)) {
   case Gnu:
     if (isPETarget(args))
       return !mingw::link(args);
-    return !elf::link(args, canExitEarly());
+    return !elf::link(args, canExitEarly);
   case WinLink:
-    return !coff::link(args, canExitEarly());
+    return !coff::link(args, canExitEarly);
   case Darwin:
-    return !mach_o::link(args, canExitEarly());
+    return !mach_o::link(args, canExitEarly);
   case Wasm:
-    return !wasm::link(args, canExitEarly());
+    return !wasm::link(args, canExitEarly);
   default:
     die("lld is a generic driver.\n"
         "Invoke ld.lld (Unix), ld64.lld (macOS), lld-link (Windows), wasm-ld"
         " (WebAssembly) instead");
   }
 }
+
+// Handles "lld --link-server=<socket> [--link-server-cache-limit=<MiB>]".
+static int runServer(ArrayRef<const char *> args) {
+  StringRef socketPath;
+  for (StringRef arg : args.slice(1)) {
+    if (arg.consume_front("--link-server=")) {
+      socketPath = arg;
+    } else if (arg.consume_front("--link-server-cache-limit=")) {
+      uint64_t mib;
+      if (!to_integer(arg, mib))
+        die("--link-server-cache-limit: number expected, but got " + arg);
+      setInputCacheLimit(mib * 1024 * 1024);
+    } else {
+      die("unknown argument for the link server: " + arg);
+    }
+  }
+
+  return runLinkServer(socketPath, [](std::vector<const char *> &args) {
+    // Each link parses -mllvm options again.
+    cl::ResetAllOptionOccurrences();
+    return lldMain(args, /*canExitEarly=*/false);
+  });
+}
+
+/// Universal linker main(). This linker emulates the gnu, darwin, or
+/// windows linker based on the argv[0] or -flavor option.
+int main(int argc, const char **argv) {
+  InitLLVM x(argc, argv);
+
+  std::vector<const char *> args(argv, argv + argc);
+  if (args.size() > 1 && StringRef(args[1]).startswith("--link-server="))
+    return runServer(args);
+
+  // Let the link server do the link if there is one. See LinkServer.h.
+  if (const char *socketPath = getenv("LLD_LINK_SERVER"))
+    if (Optional<int> status = forwardToLinkServer(socketPath, args))
+      return *status;
+
+  return lldMain(args, canExitEarly());
+}
@@ -0,0 +1,125 @@
+//===- lld/unittest/InputCacheTest.cpp ------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Tests for the input cache of the link server.
+///
+//===----------------------------------------------------------------------===//
+
+#include "lld/Common/InputCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Chrono.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace lld;
+
+namespace {
+class InputCacheTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("input-cache-test", dir));
+  }
+
+  void TearDown() override {
+    setInputCacheLimit(1024 * 1024 * 1024);
+    trimInputCache();
+    sys::fs::remove_directories(dir);
+  }
+
+  std::string getPath(StringRef name) {
+    SmallString<128> path(dir);
+    sys::path::append(path, name);
+    return std::string(path.str());
+  }
+
+  // Writes contents to the file and sets its modification time to mtime.
+  void writeFile(StringRef path, StringRef contents, sys::TimePoint<> mtime) {
+    {
+      std::error_code ec;
+      raw_fd_ostream os(path, ec, sys::fs::OF_None);
+      ASSERT_FALSE(ec);
+      os << contents;
+    }
+    int fd;
+    ASSERT_FALSE(sys::fs::openFileForWrite(path, fd, sys::fs::CD_OpenExisting,
+                                           sys::fs::OF_Append));
+    ASSERT_FALSE(sys::fs::setLastAccessAndModificationTime(fd, mtime));
+    sys::Process::SafelyCloseFileDescriptor(fd);
+  }
+
+  StringRef read(StringRef path) {
+    ErrorOr<MemoryBufferRef> mb = readCachedInput(path);
+    EXPECT_TRUE(bool(mb));
+    if (!mb)
+      return "";
+    EXPECT_EQ(path, mb->getBufferIdentifier());
+    return mb->getBuffer();
+  }
+
+  SmallString<128> dir;
+  sys::TimePoint<> t1 = sys::TimePoint<>(std::chrono::seconds(1000000000));
+  sys::TimePoint<> t2 = sys::TimePoint<>(std::chrono::seconds(1000000001));
+};
+} // namespace
+
+TEST_F(InputCacheTest, MissingFile) {
+  EXPECT_FALSE(bool(readCachedInput(getPath("missing"))));
+}
+
+// A file that changes in place is not read again unless its size or
+// modification time changes.
+TEST_F(InputCacheTest, Invalidation) {
+  std::string path = getPath("a");
+  writeFile(path, "aaaa", t1);
+  EXPECT_EQ("aaaa", read(path));
+
+  writeFile(path, "bbbb", t1);
+  EXPECT_EQ("aaaa", read(path));
+
+  writeFile(path, "bbbb", t2);
+  EXPECT_EQ("bbbb", read(path));
+
+  writeFile(path, "ccccc", t2);
+  EXPECT_EQ("ccccc", read(path));
+}
+
+// Files with the same contents share a buffer.
+TEST_F(InputCacheTest, Deduplication) {
+  std::string a = getPath("a");
+  std::string b = getPath("b");
+  writeFile(a, "same", t1);
+  writeFile(b, "same", t2);
+  EXPECT_EQ(read(a).data(), read(b).data());
+}
+
+// Files that are not used in a link are evicted first when the cache is over
+// its limit.
+TEST_F(InputCacheTest, Eviction) {
+  std::string a = getPath("a");
+  std::string b = getPath("b");
+  writeFile(a, "aaaa", t1);
+  writeFile(b, "bbbb", t1);
+  read(a);
+  read(b);
+  trimInputCache();
+
+  setInputCacheLimit(4);
+  read(b);
+  trimInputCache();
+
+  // a was evicted, so its new contents are read, but b is still cached.
+  writeFile(a, "AAAA", t1);
+  writeFile(b, "BBBB", t1);
+  EXPECT_EQ("AAAA", read(a));
+  EXPECT_EQ("bbbb", read(b));
+}
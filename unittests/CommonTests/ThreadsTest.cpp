@@ -0,0 +1,48 @@
+//===- lld/unittest/ThreadsTest.cpp ---------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Tests for the thread pool used by the parallel loops.
+///
+//===----------------------------------------------------------------------===//
+
+#include "lld/Common/Threads.h"
+#include "gtest/gtest.h"
+
+using namespace lld;
+
+namespace {
+using CpuList = std::vector<unsigned>;
+} // namespace
+
+TEST(ThreadsTest, ParseCpuList) {
+  EXPECT_EQ(CpuList(), parseCpuList(""));
+  EXPECT_EQ(CpuList(), parseCpuList("\n"));
+  EXPECT_EQ(CpuList({0}), parseCpuList("0\n"));
+  EXPECT_EQ(CpuList({0, 1, 2, 3}), parseCpuList("0-3\n"));
+  EXPECT_EQ(CpuList({0, 1, 8, 9, 10, 12}), parseCpuList("0-1,8-10,12\n"));
+}
+
+// Ranges that cannot be parsed are skipped, and the others are kept.
+TEST(ThreadsTest, ParseCpuListMalformed) {
+  EXPECT_EQ(CpuList({4}), parseCpuList("x,4"));
+  EXPECT_EQ(CpuList({4}), parseCpuList("0-x,4"));
+  EXPECT_EQ(CpuList({1, 2}), parseCpuList(",,1-2,"));
+  EXPECT_EQ(CpuList(), parseCpuList("3-1"));
+}
+
+// The result of a parallel loop does not depend on NUMA-aware threading,
+// which has no effect on machines with one node.
+TEST(ThreadsTest, NumaAwareLoop) {
+  setNumaAware(true);
+  std::vector<unsigned> v(1000);
+  parallelForEachN(0, v.size(), [&](size_t i) { v[i] = i * 2; });
+  setNumaAware(false);
+  for (size_t i = 0; i < v.size(); ++i)
+    EXPECT_EQ(i * 2, v[i]);
+}
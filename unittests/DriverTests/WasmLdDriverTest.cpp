@@ -0,0 +1,165 @@
+//===- lld/unittest/WasmLdDriverTest.cpp ----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// wasm-ld driver tests, for linking as a library.
+///
+//===----------------------------------------------------------------------===//
+
+#include "lld/Common/Driver.h"
+#include "lld/Common/ErrorHandler.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <cstring>
+
+using namespace llvm;
+using namespace lld;
+
+namespace {
+// A relocatable object file that defines an empty function, _start.
+const char startObject[] = "\0asm\x01\0\0\0"
+                           // Type section: () -> ()
+                           "\x01\x04\x01\x60\0\0"
+                           // Function section
+                           "\x03\x02\x01\0"
+                           // Code section
+                           "\x0a\x04\x01\x02\0\x0b"
+                           // "linking" section with a symbol table
+                           "\0\x16\x07linking\x02"
+                           "\x08\x0b\x01\0\0\0\x06_start";
+
+StringRef getStartObject() {
+  return StringRef(startObject, sizeof(startObject) - 1);
+}
+
+class WasmLdDriverTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("wasm-ld-test", dir));
+  }
+
+  void TearDown() override {
+    errorHandler().errorOS = &errs();
+    sys::fs::remove_directories(dir);
+  }
+
+  // Writes a file to the test directory and returns its path.
+  std::string writeFile(StringRef name, StringRef contents) {
+    std::string path = getPath(name);
+    std::error_code ec;
+    raw_fd_ostream os(path, ec, sys::fs::OF_None);
+    EXPECT_FALSE(ec);
+    os << contents;
+    return path;
+  }
+
+  std::string getPath(StringRef name) {
+    SmallString<128> path(dir);
+    sys::path::append(path, name);
+    return std::string(path.str());
+  }
+
+  // Links the given files to the output file, in the same process.
+  bool link(std::vector<std::string> args) {
+    std::vector<const char *> argv = {"wasm-ld"};
+    for (const std::string &arg : args)
+      argv.push_back(arg.c_str());
+    return wasm::link(argv, /*canExitEarly=*/false, diag);
+  }
+
+  SmallString<128> dir;
+  std::string diagText;
+  raw_string_ostream diag{diagText};
+};
+} // namespace
+
+// The --reproduce tar file is written on a background thread, but it must be
+// complete when link() returns.
+TEST_F(WasmLdDriverTest, ReproduceIsCompleteOnReturn) {
+  std::string obj = writeFile("a.o", getStartObject());
+  std::string tar = getPath("repro.tar");
+  ASSERT_TRUE(link({"--reproduce=" + tar, obj, "-o", getPath("a.wasm")}));
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mb = MemoryBuffer::getFile(tar);
+  ASSERT_TRUE(bool(mb));
+  StringRef contents = (*mb)->getBuffer();
+  EXPECT_NE(StringRef::npos, contents.find("repro/response.txt"));
+  EXPECT_NE(StringRef::npos, contents.find("a.o"));
+  EXPECT_NE(StringRef::npos, contents.find(getStartObject()));
+}
+
+// The in-memory overload links the given buffers and returns the module.
+TEST_F(WasmLdDriverTest, InMemory) {
+  std::vector<uint8_t> output;
+  MemoryBufferRef input(getStartObject(), "a.o");
+  ASSERT_TRUE(wasm::link({"wasm-ld"}, {input}, output, diag)) << diag.str();
+  ASSERT_GT(output.size(), 8u);
+  EXPECT_EQ(0, memcmp(output.data(), "\0asm\x01\0\0\0", 8));
+}
+
+// The in-memory buffers are named on the command line by their identifiers,
+// so they must be unique.
+TEST_F(WasmLdDriverTest, InMemoryDuplicateNames) {
+  std::vector<uint8_t> output;
+  MemoryBufferRef input(getStartObject(), "a.o");
+  EXPECT_FALSE(wasm::link({"wasm-ld"}, {input, input}, output, diag));
+  EXPECT_NE(std::string::npos,
+            diag.str().find("duplicate in-memory input: a.o"));
+}
+
+// Options that write other files than the output are rejected.
+TEST_F(WasmLdDriverTest, InMemoryRejectsFileOptions) {
+  MemoryBufferRef input(getStartObject(), "a.o");
+  std::string debugFile = "--separate-debug-file=" + getPath("a.debug");
+  std::string profile = "--split-module=" + writeFile("profile", "");
+  std::pair<const char *, const char *> tests[] = {
+      {"--incremental", "--incremental may not be used"},
+      {profile.c_str(), "--split-module may not be used"},
+      {debugFile.c_str(), "--separate-debug-file may not be used"}};
+
+  for (auto &test : tests) {
+    std::vector<uint8_t> output;
+    diagText.clear();
+    EXPECT_FALSE(wasm::link({"wasm-ld", test.first}, {input}, output, diag));
+    EXPECT_NE(std::string::npos, diag.str().find(test.second)) << diag.str();
+  }
+}
+
+// The output is left empty if the link fails.
+TEST_F(WasmLdDriverTest, InMemoryOutputClearedOnError) {
+  std::vector<uint8_t> output = {1, 2, 3};
+  MemoryBufferRef input(getStartObject(), "a.o");
+  EXPECT_FALSE(wasm::link({"wasm-ld", "--entry=missing"}, {input}, output,
+                          diag));
+  EXPECT_TRUE(output.empty());
+}
+
+// A process can link more than once. The inputs and the objects decoded from
+// them are kept for the next link, and the output is the same with and
+// without them.
+TEST_F(WasmLdDriverTest, LinkTwice) {
+  std::string obj = writeFile("a.o", getStartObject());
+  auto linkTo = [&](StringRef name) -> std::string {
+    std::string out = getPath(name);
+    EXPECT_TRUE(link({obj, "-o", out})) << diag.str();
+    ErrorOr<std::unique_ptr<MemoryBuffer>> mb = MemoryBuffer::getFile(out);
+    EXPECT_TRUE(bool(mb));
+    return mb ? (*mb)->getBuffer().str() : "";
+  };
+
+  std::string first = linkTo("1.wasm");
+  EXPECT_FALSE(first.empty());
+  EXPECT_EQ(first, linkTo("2.wasm"));
+
+  wasm::clearInputCache();
+  EXPECT_EQ(first, linkTo("3.wasm"));
+}
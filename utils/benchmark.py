@@ -28,6 +28,12 @@ parser.add_argument('--wrapper', default='')
 parser.add_argument('--machine', required=True)
 parser.add_argument('--revision', required=True)
 parser.add_argument('--threads', action='store_true')
+parser.add_argument('--linker', default='../ld.lld',
+                    help='The linker to run, relative to each benchmark '
+                    'directory')
+parser.add_argument('--print-stats', action='store_true',
+                    help='Also record the time of each link phase, as '
+                    'reported by wasm-ld --print-stats=json')
 parser.add_argument('--url', help='The lnt server url to send the results to',
                     default='http://localhost:8000/db_default/v4/link/submitRun')
 args = parser.parse_args()
@@ -77,6 +83,23 @@ def parsePerf(output):
         ret.update(parsePerfLine(l))
     return ret
 
+def parsePhases(phases, prefix, ret):
+    for p in phases:
+        name = prefix + p['name'].lower().replace(' ', '-')
+        ret[name + '-ms'] = p['ms']
+        parsePhases(p['children'], name + '.', ret)
+
+def parseStats(output):
+    # The statistics are printed to stdout before perf prints its counters.
+    start = output.find(b'{')
+    if start == -1:
+        return {}
+    stats, _ = json.JSONDecoder().raw_decode(output[start:].decode('utf-8'))
+    ret = {'peak-rss-bytes': stats['peak_rss_bytes'],
+           'total-ms': stats['total_ms']}
+    parsePhases(stats['phases'], 'phase-', ret)
+    return ret
+
 def run(cmd):
     try:
         return subprocess.check_output(cmd, stderr=subprocess.STDOUT)
@@ -100,16 +123,20 @@ def perf(cmd):
         os.unlink('t')
         out = run(wrapper_args + ['perf', 'stat'] + cmd)
         r = parsePerf(out)
+        if args.print_stats:
+            r.update(parseStats(out))
         combinePerfRun(ret, r)
     os.unlink('t')
     return ret
 
 def runBench(bench):
     thread_arg = [] if args.threads else ['--no-threads']
+    stats_arg = ['--print-stats=json'] if args.print_stats else []
     os.chdir(bench.directory)
     suffix = '-%s' % bench.variant if bench.variant else ''
     response = 'response' + suffix + '.txt'
-    ret = perf(['../ld.lld', '@' + response, '-o', 't'] + thread_arg)
+    ret = perf([args.linker, '@' + response, '-o', 't'] + thread_arg +
+               stats_arg)
     ret['name'] = str(bench)
     os.chdir('..')
     return ret
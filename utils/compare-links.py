@@ -0,0 +1,265 @@
+#!/usr/bin/env python
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+# ==------------------------------------------------------------------------==#
+#
+# Compares two lld builds on the benchmarks of a directory in the layout that
+# benchmark.py uses: <directory>/<name>/response*.txt, with the inputs next to
+# the response files.  gen-wasm-bench.py writes such a directory; large links
+# of real programs can be captured with --reproduce and unpacked into one.
+#
+# The runs of the two linkers are interleaved so that both see the same state
+# of the machine.  Each run is measured for wall time, CPU time and peak RSS,
+# and for the time of each link phase as reported by --time-json.  ld.lld,
+# lld-link and wasm-ld report phases; ld64.lld is measured for time and memory
+# only.  The flavor is chosen by the name of the linker.
+#
+# The report gives the mean of each metric with its confidence interval, and
+# the change from A to B with the confidence interval of the difference.
+# Changes whose interval does not include zero are marked with a '*'.
+#
+# Example:
+#   compare-links.py --a old/bin/ld.lld --b new/bin/ld.lld --runs 20 bench
+#
+# ==------------------------------------------------------------------------==#
+
+from __future__ import print_function
+
+import argparse
+import glob
+import json
+import math
+import os
+import re
+import subprocess
+import time
+
+parser = argparse.ArgumentParser()
+parser.add_argument('benchmark_directory')
+parser.add_argument('--a', required=True,
+                    help='The baseline linker')
+parser.add_argument('--b',
+                    help='The linker to compare with the baseline. If not '
+                    'given, only the baseline is measured')
+parser.add_argument('--runs', type=int, default=10,
+                    help='The number of measured runs of each linker')
+parser.add_argument('--filter', default='',
+                    help='Only run the benchmarks whose name matches this '
+                    'regular expression')
+parser.add_argument('--wrapper', default='',
+                    help='A comma-separated command to run the linker with, '
+                    'e.g. taskset,-c,0-7')
+parser.add_argument('--no-threads', action='store_true',
+                    help='Link with a single thread')
+parser.add_argument('--confidence', type=float, default=0.95,
+                    choices=[0.9, 0.95, 0.99])
+parser.add_argument('--json', help='Also write the measurements to this file')
+args = parser.parse_args()
+
+# Two-sided critical values of Student's t distribution by degrees of freedom.
+# Larger degrees of freedom use the last entry's limit.
+T_TABLE = {
+    0.9: [6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860, 1.833,
+          1.812, 1.796, 1.782, 1.771, 1.761, 1.753, 1.746, 1.740, 1.734,
+          1.729, 1.725, 1.721, 1.717, 1.714, 1.711, 1.708, 1.706, 1.703,
+          1.701, 1.699, 1.697],
+    0.95: [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+           2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101,
+           2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052,
+           2.048, 2.045, 2.042],
+    0.99: [63.657, 9.925, 5.841, 4.604, 4.032, 3.707, 3.499, 3.355, 3.250,
+           3.169, 3.106, 3.055, 3.012, 2.977, 2.947, 2.921, 2.898, 2.878,
+           2.861, 2.845, 2.831, 2.819, 2.807, 2.797, 2.787, 2.779, 2.771,
+           2.763, 2.756, 2.750],
+}
+T_LIMIT = {0.9: 1.645, 0.95: 1.960, 0.99: 2.576}
+
+
+def tValue(df):
+    table = T_TABLE[args.confidence]
+    if df < 1:
+        return float('inf')
+    if df > len(table):
+        return T_LIMIT[args.confidence]
+    return table[int(math.ceil(df)) - 1]
+
+
+class Bench:
+    def __init__(self, directory, variant):
+        self.directory = directory
+        self.variant = variant
+    def __str__(self):
+        if not self.variant:
+            return self.directory
+        return '%s-%s' % (self.directory, self.variant)
+
+
+def getBenchmarks():
+    ret = []
+    for i in sorted(glob.glob('*/response*.txt')):
+        m = re.match('response-(.*)\.txt', os.path.basename(i))
+        variant = m.groups()[0] if m else None
+        bench = Bench(os.path.dirname(i), variant)
+        if re.search(args.filter, str(bench)):
+            ret.append(bench)
+    return ret
+
+
+def getFlavor(linker):
+    name = os.path.basename(linker)
+    if 'lld-link' in name:
+        return 'coff'
+    if 'wasm-ld' in name:
+        return 'wasm'
+    if 'ld64' in name:
+        return 'macho'
+    return 'elf'
+
+
+def getCommand(linker, bench, timesFile):
+    suffix = '-%s' % bench.variant if bench.variant else ''
+    cmd = [linker, '@response' + suffix + '.txt']
+    flavor = getFlavor(linker)
+    if flavor == 'coff':
+        cmd += ['/out:t', '/time-json:' + timesFile]
+        if args.no_threads:
+            cmd.append('/threads:no')
+    elif flavor == 'macho':
+        cmd += ['-o', 't']
+    else:
+        cmd += ['-o', 't', '--time-json=' + timesFile]
+        if args.no_threads:
+            cmd.append('--no-threads')
+    wrapper = [x for x in args.wrapper.split(',') if x]
+    return wrapper + cmd
+
+
+def parsePhases(phase, prefix, ret):
+    name = prefix + phase['name'].lower().replace(' ', '-')
+    ret[name + '-ms'] = phase['ms']
+    for child in phase['children']:
+        parsePhases(child, name + '.', ret)
+
+
+# Runs a link and returns its metrics. The peak RSS and the CPU time come from
+# the resource usage of the child, which wait4 reports for it alone.
+def runOnce(linker, bench):
+    timesFile = os.path.abspath('times.json')
+    if os.path.exists(timesFile):
+        os.unlink(timesFile)
+    cmd = getCommand(linker, bench, timesFile)
+    with open(os.devnull, 'w') as devnull:
+        start = time.time()
+        proc = subprocess.Popen(cmd, stdout=devnull, stderr=subprocess.STDOUT)
+        _, status, usage = os.wait4(proc.pid, 0)
+        wall = time.time() - start
+    if status != 0:
+        raise RuntimeError('%s failed: %s' % (bench, ' '.join(cmd)))
+
+    ret = {
+        'wall-seconds': wall,
+        'cpu-seconds': usage.ru_utime + usage.ru_stime,
+        # ru_maxrss is in kilobytes on Linux.
+        'peak-rss-mb': usage.ru_maxrss / 1024.0,
+    }
+    if os.path.exists(timesFile):
+        with open(timesFile) as f:
+            parsePhases(json.load(f), 'phase-', ret)
+        os.unlink(timesFile)
+    if os.path.exists('t'):
+        os.unlink('t')
+    return ret
+
+
+def measure(bench):
+    linkers = [args.a] + ([args.b] if args.b else [])
+    results = [{} for _ in linkers]
+
+    # Discard the first run of each linker to warm up any system cache.
+    for linker in linkers:
+        runOnce(linker, bench)
+
+    for i in range(args.runs):
+        # Alternate which linker runs first to cancel out ordering effects.
+        order = list(range(len(linkers)))
+        if i % 2:
+            order.reverse()
+        for j in order:
+            for k, v in runOnce(linkers[j], bench).items():
+                results[j].setdefault(k, []).append(v)
+    return results
+
+
+def summarize(values):
+    n = len(values)
+    mean = sum(values) / n
+    var = sum((x - mean) ** 2 for x in values) / (n - 1) if n > 1 else 0.0
+    return mean, var, n
+
+
+def interval(var, n):
+    if n < 2:
+        return float('inf')
+    return tValue(n - 1) * math.sqrt(var / n)
+
+
+# Returns the difference of the means of b and a and the half-width of its
+# confidence interval, using Welch's approximation of the degrees of freedom.
+def compare(a, b):
+    ma, va, na = summarize(a)
+    mb, vb, nb = summarize(b)
+    if na < 2 or nb < 2:
+        return mb - ma, float('inf')
+    sa, sb = va / na, vb / nb
+    se = math.sqrt(sa + sb)
+    if se == 0:
+        return mb - ma, 0.0
+    df = (sa + sb) ** 2 / (sa ** 2 / (na - 1) + sb ** 2 / (nb - 1))
+    return mb - ma, tValue(df) * se
+
+
+def metricOrder(name):
+    if name.startswith('phase-'):
+        return (1, name)
+    return (0, name)
+
+
+def report(bench, results):
+    print('%s (%d runs, %d%% confidence)' %
+          (bench, args.runs, int(args.confidence * 100)))
+    a = results[0]
+    b = results[1] if len(results) > 1 else None
+    names = sorted(a.keys(), key=metricOrder)
+    width = max(len(x) for x in names)
+    for name in names:
+        ma, va, na = summarize(a[name])
+        line = '  %-*s  %12.3f +- %-10.3f' % (width, name, ma,
+                                              interval(va, na))
+        if b and name in b:
+            mb, vb, nb = summarize(b[name])
+            diff, ci = compare(a[name], b[name])
+            pct = 100.0 * diff / ma if ma else 0.0
+            pctCi = 100.0 * ci / ma if ma else 0.0
+            mark = '*' if abs(diff) > ci else ' '
+            line += '  %12.3f +- %-10.3f  %+7.2f%% +- %6.2f%% %s' % (
+                mb, interval(vb, nb), pct, pctCi, mark)
+        print(line)
+    print()
+
+
+os.chdir(args.benchmark_directory)
+measurements = {}
+for bench in getBenchmarks():
+    os.chdir(bench.directory)
+    results = measure(bench)
+    os.chdir('..')
+    report(bench, results)
+    measurements[str(bench)] = results
+
+if args.json:
+    with open(args.json, 'w') as f:
+        json.dump({'a': args.a, 'b': args.b, 'runs': args.runs,
+                   'benchmarks': measurements}, f, sort_keys=True, indent=2)
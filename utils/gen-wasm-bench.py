@@ -0,0 +1,236 @@
+#!/usr/bin/env python
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+# ==------------------------------------------------------------------------==#
+#
+# Generates a synthetic wasm-ld benchmark in the layout that benchmark.py
+# expects: <output>/<name>/response*.txt, with the objects and archives next
+# to them.  The workload is described by the options below and is a pure
+# function of them and of --seed, so it can be regenerated on every machine.
+#
+# Example:
+#   gen-wasm-bench.py --objects 500 --functions 200 --calls 4 --archives 4 \
+#       --comdats 50 --debug --llc bin/llc --llvm-ar bin/llvm-ar bench
+#   benchmark.py --linker ../wasm-ld --print-stats --machine ... \
+#       --revision ... --url http://.../db_default/v4/wasm_link/submitRun bench
+#
+# with wasm-ld copied or linked into the bench directory.  wasm-link.yaml is
+# the LNT schema for the results, which include the time of each link phase.
+#
+# ==------------------------------------------------------------------------==#
+
+import argparse
+import os
+import random
+import subprocess
+
+parser = argparse.ArgumentParser()
+parser.add_argument('output_directory')
+parser.add_argument('--name', default='wasm-synthetic',
+                    help='The name of the benchmark directory')
+parser.add_argument('--objects', type=int, default=100,
+                    help='The number of object files')
+parser.add_argument('--functions', type=int, default=100,
+                    help='The number of functions in each object file')
+parser.add_argument('--calls', type=int, default=4,
+                    help='The number of calls made by each function, each of '
+                    'which is a relocation')
+parser.add_argument('--data', type=int, default=10,
+                    help='The number of data segments in each object file, '
+                    'each holding pointers to functions')
+parser.add_argument('--archives', type=int, default=0,
+                    help='The number of archives that the objects after the '
+                    'first half are put in')
+parser.add_argument('--comdats', type=int, default=0,
+                    help='The number of COMDAT functions defined by every '
+                    'object, as for inline functions in C++')
+parser.add_argument('--unused', type=float, default=0.2,
+                    help='The fraction of functions that the entry point '
+                    'does not call, some of which --gc-sections removes')
+parser.add_argument('--debug', action='store_true',
+                    help='Emit DWARF for each function')
+parser.add_argument('--seed', type=int, default=0)
+parser.add_argument('--llc', default='llc')
+parser.add_argument('--llvm-ar', default='llvm-ar')
+args = parser.parse_args()
+
+rand = random.Random(args.seed)
+
+
+def funcName(obj, index):
+    return 'f%d_%d' % (obj, index)
+
+
+def comdatName(index):
+    return 'inline%d' % index
+
+
+class Metadata:
+    def __init__(self, obj):
+        self.nodes = []
+        self.file = self.add('!DIFile(filename: "obj%d.c", '
+                             'directory: "/bench")' % obj)
+        self.cu = self.add('distinct !DICompileUnit(language: DW_LANG_C99, '
+                           'file: !%d, producer: "gen-wasm-bench", '
+                           'isOptimized: false, runtimeVersion: 0, '
+                           'emissionKind: FullDebug)' % self.file)
+        self.flags = [self.add('!{i32 7, !"Dwarf Version", i32 4}'),
+                      self.add('!{i32 2, !"Debug Info Version", i32 3}')]
+        self.type = self.add('!DISubroutineType(types: !%d)' %
+                             self.add('!{}'))
+
+    def add(self, node):
+        self.nodes.append(node)
+        return len(self.nodes) - 1
+
+    def subprogram(self, name, line):
+        return self.add('distinct !DISubprogram(name: "%s", scope: !%d, '
+                        'file: !%d, line: %d, type: !%d, scopeLine: %d, '
+                        'spFlags: DISPFlagDefinition, unit: !%d)' %
+                        (name, self.file, self.file, line, self.type, line,
+                         self.cu))
+
+    def location(self, line, scope):
+        return ', !dbg !%d' % self.add(
+            '!DILocation(line: %d, column: 1, scope: !%d)' % (line, scope))
+
+    def write(self, out):
+        out.append('!llvm.dbg.cu = !{!%d}' % self.cu)
+        out.append('!llvm.module.flags = !{%s}' %
+                   ', '.join('!%d' % f for f in self.flags))
+        for i, node in enumerate(self.nodes):
+            out.append('!%d = %s' % (i, node))
+
+
+# Writes a function that passes its argument through a chain of calls, so
+# that each call is a relocation.
+def writeFunction(out, md, name, linkage, callees, line, comdat=False):
+    attrs = ' comdat' if comdat else ''
+    sp = None
+    if md:
+        sp = md.subprogram(name, line)
+        attrs += ' !dbg !%d' % sp
+    out.append('define %s i32 @%s(i32 %%x)%s {' % (linkage, name, attrs))
+    value = '%x'
+    for i, callee in enumerate(callees):
+        loc = md.location(line + i + 1, sp) if md else ''
+        out.append('  %%c%d = call i32 @%s(i32 %s)%s' % (i, callee, value, loc))
+        value = '%%c%d' % i
+    loc = md.location(line + len(callees) + 1, sp) if md else ''
+    out.append('  ret i32 %s%s' % (value, loc))
+    out.append('}')
+    out.append('')
+
+
+def writeObject(obj):
+    out = ['target triple = "wasm32-unknown-unknown"', '']
+    md = Metadata(obj) if args.debug else None
+    declared = set()
+
+    def callee():
+        # Most calls stay in the same object, as they tend to in real code.
+        if rand.random() < 0.7:
+            target = obj
+        else:
+            target = rand.randrange(args.objects)
+        name = funcName(target, rand.randrange(args.functions))
+        if target != obj:
+            declared.add(name)
+        return name
+
+    for k in range(args.comdats):
+        out.append('$%s = comdat any' % comdatName(k))
+    out.append('')
+
+    for i in range(args.data):
+        targets = [callee() for _ in range(4)]
+        out.append('@d%d_%d = hidden global [4 x i32 (i32)*] [%s]' %
+                   (obj, i, ', '.join('i32 (i32)* @%s' % t for t in targets)))
+    out.append('')
+
+    line = 1
+    for k in range(args.comdats):
+        writeFunction(out, md, comdatName(k), 'linkonce_odr hidden', [], line,
+                      comdat=True)
+        line += 2
+    for i in range(args.functions):
+        callees = [callee() for _ in range(args.calls)]
+        if args.comdats:
+            callees.append(comdatName(rand.randrange(args.comdats)))
+        writeFunction(out, md, funcName(obj, i), 'hidden', callees, line)
+        line += len(callees) + 2
+
+    for name in sorted(declared):
+        out.append('declare hidden i32 @%s(i32)' % name)
+    out.append('')
+    if md:
+        md.write(out)
+    return '\n'.join(out) + '\n'
+
+
+# Writes the entry point, which calls all the functions that are kept alive.
+def writeMain():
+    roots = [funcName(obj, i) for obj in range(args.objects)
+             for i in range(args.functions)
+             if rand.random() >= args.unused]
+    out = ['target triple = "wasm32-unknown-unknown"', '',
+           'define void @_start() {']
+    for i, root in enumerate(roots):
+        out.append('  %%c%d = call i32 @%s(i32 0)' % (i, root))
+    out += ['  ret void', '}', '']
+    for root in roots:
+        out.append('declare hidden i32 @%s(i32)' % root)
+    return '\n'.join(out) + '\n'
+
+
+def run(cmd):
+    subprocess.check_call(cmd)
+
+
+def compile(source, text):
+    with open(source, 'w') as f:
+        f.write(text)
+    obj = os.path.splitext(source)[0] + '.o'
+    run([args.llc, '-filetype=obj', source, '-o', obj])
+    os.unlink(source)
+    return os.path.basename(obj)
+
+
+directory = os.path.join(args.output_directory, args.name)
+if not os.path.isdir(directory):
+    os.makedirs(directory)
+
+objects = [compile(os.path.join(directory, 'obj%d.ll' % obj), writeObject(obj))
+           for obj in range(args.objects)]
+inputs = [compile(os.path.join(directory, 'main.ll'), writeMain())]
+
+# Put the second half of the objects in archives, so that archive member
+# loading is part of the workload.
+if args.archives:
+    half = len(objects) // 2
+    inputs += objects[:half]
+    members = objects[half:]
+    for a in range(args.archives):
+        lib = 'lib%d.a' % a
+        chunk = members[a::args.archives]
+        if not chunk:
+            continue
+        path = os.path.join(directory, lib)
+        if os.path.exists(path):
+            os.unlink(path)
+        run([args.llvm_ar, 'rcs', path] +
+            [os.path.join(directory, m) for m in chunk])
+        inputs.append(lib)
+else:
+    inputs += objects
+
+variants = {'': [], 'nogc': ['--no-gc-sections']}
+if args.debug:
+    variants['strip'] = ['--strip-debug']
+for variant, flags in variants.items():
+    suffix = '-' + variant if variant else ''
+    with open(os.path.join(directory, 'response%s.txt' % suffix), 'w') as f:
+        f.write('\n'.join(flags + inputs) + '\n')
@@ -0,0 +1,245 @@
+//===- CallGraphSort.cpp --------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// Implementation of Call-Chain Clustering from: Optimizing Function Placement
+/// for Large-Scale Data-Center Applications
+/// https://research.fb.com/wp-content/uploads/2017/01/cgo2017-hfsort-final1.pdf
+///
+/// The goal of this algorithm is to improve runtime performance of the final
+/// module by arranging functions in the CODE section such that hot functions
+/// that call each other are close together.  This also helps engines that
+/// compile a module while it is being streamed in.
+///
+/// This is a port of ELF/CallGraphSort.cpp, operating on InputFunctions
+/// rather than input sections.
+///
+/// Definitions:
+/// * Cluster
+///   * An ordered list of input functions which are layed out as a unit. At
+///     the beginning of the algorithm each input function has its own cluster
+///     and the weight of the cluster is the sum of the weight of all
+///     incomming edges.
+/// * Call-Chain Clustering (C³) Heuristic
+///   * Defines when and how clusters are combined. Pick the highest weighted
+///     input function then add it to its most likely predecessor if it wouldn't
+///     penalize it too much.
+/// * Density
+///   * The weight of the cluster divided by the size of the cluster. This is a
+///     proxy for the ammount of execution time spent per byte of the cluster.
+///
+/// It does so given a call graph profile by the following:
+/// * Build a weighted call graph from the call graph profile
+/// * Sort input functions by weight
+/// * For each input function starting with the highest weight
+///   * Find its most likely predecessor cluster
+///   * Check if the combined cluster would be too large, or would have too low
+///     a density.
+///   * If not, then combine the clusters.
+/// * Sort non-empty clusters by density
+///
+//===----------------------------------------------------------------------===//
+
+#include "CallGraphSort.h"
+#include "Config.h"
+#include "InputChunks.h"
+
+#include <numeric>
+
+using namespace llvm;
+
+namespace lld {
+namespace wasm {
+
+namespace {
+struct Edge {
+  int from;
+  uint64_t weight;
+};
+
+struct Cluster {
+  Cluster(int func, size_t s) : next(func), prev(func), size(s) {}
+
+  double getDensity() const {
+    if (size == 0)
+      return 0;
+    return double(weight) / double(size);
+  }
+
+  int next;
+  int prev;
+  size_t size = 0;
+  uint64_t weight = 0;
+  uint64_t initialWeight = 0;
+  Edge bestPred = {-1, 0};
+};
+
+class CallGraphSort {
+public:
+  CallGraphSort();
+
+  DenseMap<const InputFunction *, int> run();
+
+private:
+  std::vector<Cluster> clusters;
+  std::vector<const InputFunction *> functions;
+};
+
+// Maximum ammount the combined cluster density can be worse than the original
+// cluster to consider merging.
+constexpr int MAX_DENSITY_DEGRADATION = 8;
+
+// Maximum cluster size in bytes.
+constexpr uint64_t MAX_CLUSTER_SIZE = 1024 * 1024;
+} // end anonymous namespace
+
+using FunctionPair = std::pair<const InputFunction *, const InputFunction *>;
+
+// Take the edge list in Config->CallGraphProfile and generate a graph between
+// InputFunctions with the provided weights.
+CallGraphSort::CallGraphSort() {
+  MapVector<FunctionPair, uint64_t> &profile = config->callGraphProfile;
+  DenseMap<const InputFunction *, int> funcToCluster;
+
+  auto getOrCreateNode = [&](const InputFunction *func) -> int {
+    auto res = funcToCluster.try_emplace(func, clusters.size());
+    if (res.second) {
+      functions.push_back(func);
+      clusters.emplace_back(clusters.size(), func->getInputSize());
+    }
+    return res.first->second;
+  };
+
+  // Create the graph.
+  for (std::pair<FunctionPair, uint64_t> &c : profile) {
+    const InputFunction *fromF = c.first.first;
+    const InputFunction *toF = c.first.second;
+    uint64_t weight = c.second;
+
+    // Functions removed by garbage collection or ICF have no place in the
+    // output.
+    if (!fromF->live || !toF->live)
+      continue;
+
+    int from = getOrCreateNode(fromF);
+    int to = getOrCreateNode(toF);
+
+    clusters[to].weight += weight;
+
+    if (from == to)
+      continue;
+
+    // Remember the best edge.
+    Cluster &toC = clusters[to];
+    if (toC.bestPred.from == -1 || toC.bestPred.weight < weight) {
+      toC.bestPred.from = from;
+      toC.bestPred.weight = weight;
+    }
+  }
+  for (Cluster &c : clusters)
+    c.initialWeight = c.weight;
+}
+
+// It's bad to merge clusters which would degrade the density too much.
+static bool isNewDensityBad(Cluster &a, Cluster &b) {
+  double newDensity = double(a.weight + b.weight) / double(a.size + b.size);
+  return newDensity < a.getDensity() / MAX_DENSITY_DEGRADATION;
+}
+
+// Find the leader of V's belonged cluster (represented as an equivalence
+// class). We apply union-find path-halving technique (simple to implement) in
+// the meantime as it decreases depths and the time complexity.
+static int getLeader(std::vector<int> &leaders, int v) {
+  while (leaders[v] != v) {
+    leaders[v] = leaders[leaders[v]];
+    v = leaders[v];
+  }
+  return v;
+}
+
+static void mergeClusters(std::vector<Cluster> &cs, Cluster &into, int intoIdx,
+                          Cluster &from, int fromIdx) {
+  int tail1 = into.prev, tail2 = from.prev;
+  into.prev = tail2;
+  cs[tail2].next = intoIdx;
+  from.prev = tail1;
+  cs[tail1].next = fromIdx;
+  into.size += from.size;
+  into.weight += from.weight;
+  from.size = 0;
+  from.weight = 0;
+}
+
+// Group InputFunctions into clusters using the Call-Chain Clustering heuristic
+// then sort the clusters by density.
+DenseMap<const InputFunction *, int> CallGraphSort::run() {
+  std::vector<int> sorted(clusters.size());
+  std::vector<int> leaders(clusters.size());
+
+  std::iota(leaders.begin(), leaders.end(), 0);
+  std::iota(sorted.begin(), sorted.end(), 0);
+  llvm::stable_sort(sorted, [&](int a, int b) {
+    return clusters[a].getDensity() > clusters[b].getDensity();
+  });
+
+  for (int l : sorted) {
+    // The cluster index is the same as the index of its leader here because
+    // clusters[L] has not been merged into another cluster yet.
+    Cluster &c = clusters[l];
+
+    // Don't consider merging if the edge is unlikely.
+    if (c.bestPred.from == -1 || c.bestPred.weight * 10 <= c.initialWeight)
+      continue;
+
+    int predL = getLeader(leaders, c.bestPred.from);
+    if (l == predL)
+      continue;
+
+    Cluster *predC = &clusters[predL];
+    if (c.size + predC->size > MAX_CLUSTER_SIZE)
+      continue;
+
+    if (isNewDensityBad(*predC, c))
+      continue;
+
+    leaders[l] = predL;
+    mergeClusters(clusters, *predC, predL, c, l);
+  }
+
+  // Sort remaining non-empty clusters by density.
+  sorted.clear();
+  for (int i = 0, e = (int)clusters.size(); i != e; ++i)
+    if (clusters[i].size > 0)
+      sorted.push_back(i);
+  llvm::stable_sort(sorted, [&](int a, int b) {
+    return clusters[a].getDensity() > clusters[b].getDensity();
+  });
+
+  DenseMap<const InputFunction *, int> orderMap;
+  int curOrder = 1;
+  for (int leader : sorted)
+    for (int i = leader;;) {
+      orderMap[functions[i]] = curOrder++;
+      i = clusters[i].next;
+      if (i == leader)
+        break;
+    }
+
+  return orderMap;
+}
+
+// Sort functions by the profile data provided by --call-graph-ordering-file
+//
+// This first builds a call graph based on the profile data then merges
+// functions according to the C³ huristic. All clusters are then sorted by a
+// density metric to further improve locality.
+DenseMap<const InputFunction *, int> computeCallGraphProfileOrder() {
+  return CallGraphSort().run();
+}
+
+} // namespace wasm
+} // namespace lld
@@ -0,0 +1,24 @@
+//===- CallGraphSort.h ------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_CALL_GRAPH_SORT_H
+#define LLD_WASM_CALL_GRAPH_SORT_H
+
+#include "llvm/ADT/DenseMap.h"
+
+namespace lld {
+namespace wasm {
+
+class InputFunction;
+
+llvm::DenseMap<const InputFunction *, int> computeCallGraphProfileOrder();
+
+} // namespace wasm
+} // namespace lld
+
+#endif // LLD_WASM_CALL_GRAPH_SORT_H
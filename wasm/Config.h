@@ -9,14 +9,25 @@
 #ifndef LLD_WASM_CONFIG_H
 #define LLD_WASM_CONFIG_H
 
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/BinaryFormat/Wasm.h"
 #include "llvm/Support/CachePruning.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 namespace lld {
 namespace wasm {
 
+class InputFunction;
+
+// For --build-id.
+enum class BuildIdKind { None, Fast, Md5, Sha1, Hexstring, Uuid };
+
+// For --icf={none,safe,all}.
+enum class ICFLevel { None, Safe, All };
+
 // This struct contains the global configuration for the linker.
 // Most fields are direct mapping from the command line options
 // and such fields have the same name as the corresponding options.
@@ -24,6 +35,7 @@ namespace wasm {
 struct Configuration {
   bool allowUndefined;
   bool checkFeatures;
+  bool compilationHints;
   bool compressRelocations;
   bool demangle;
   bool disableVerify;
@@ -36,34 +48,67 @@ struct Configuration {
   bool importMemory;
   bool sharedMemory;
   bool importTable;
+  bool incremental;
   bool mergeDataSegments;
+  bool mmapOutputFile;
+  bool packDataSegments;
   bool pie;
+  bool preloadInputs;
   bool printGcSections;
+  bool printIcfSections;
+  bool printStats;
+  bool pruneDebugInfo;
   bool relocatable;
+  bool relrPackDynRelocs;
   bool saveTemps;
   bool shared;
+  bool splitModule;
   bool stripAll;
   bool stripDebug;
   bool stackFirst;
+  bool showTiming;
+  bool timeTraceEnabled;
+  bool thinLTOEmitImportsFiles;
+  bool thinLTOIndexOnly;
   bool trace;
-  uint32_t globalBase;
-  uint32_t initialMemory;
-  uint32_t maxMemory;
-  uint32_t zStackSize;
+  bool warnSymbolOrdering;
+  uint32_t elideZeroRuns;
+  uint64_t globalBase;
+  uint64_t initialMemory;
+  uint64_t maxMemory;
+  uint64_t zStackSize;
+  BuildIdKind buildId;
+  ICFLevel icf;
   unsigned ltoPartitions;
   unsigned ltoo;
   unsigned optimize;
   unsigned thinLTOJobs;
+  unsigned timeTraceGranularity;
 
   llvm::StringRef entry;
+  llvm::StringRef ltoObjPath;
+  llvm::StringRef mapFile;
   llvm::StringRef outputFile;
+  llvm::StringRef separateDebugFile;
+  llvm::StringRef splitModuleOutput;
   llvm::StringRef thinLTOCacheDir;
+  llvm::StringRef thinLTOIndexOnlyArg;
+  std::pair<llvm::StringRef, llvm::StringRef> thinLTOObjectSuffixReplace;
+  std::pair<llvm::StringRef, llvm::StringRef> thinLTOPrefixReplace;
+  llvm::StringRef timeJsonFile;
+  llvm::StringRef timeTraceFile;
 
   llvm::StringSet<> allowUndefinedSymbols;
   llvm::StringSet<> exportedSymbols;
+  llvm::StringSet<> splitModuleProfile;
+  std::vector<uint8_t> buildIdVector;
   std::vector<llvm::StringRef> searchPaths;
+  std::vector<llvm::StringRef> symbolOrderingFile;
   llvm::CachePruningPolicy thinLTOCachePolicy;
   llvm::Optional<std::vector<std::string>> features;
+  llvm::MapVector<std::pair<const InputFunction *, const InputFunction *>,
+                  uint64_t>
+      callGraphProfile;
 
   // The following config options do not directly correspond to any
   // particualr command line options.
@@ -71,6 +116,16 @@ struct Configuration {
   // True if we are creating position-independent code.
   bool isPic;
 
+  // True if the inputs and the objects decoded from them are kept for later
+  // links in the same process.
+  bool reuseInputs = false;
+
+  // Inputs given in memory by the caller, by name, and the buffer that the
+  // output is written to instead of outputFile. Both are set only by the
+  // in-memory variant of link.
+  llvm::StringMap<llvm::MemoryBufferRef> memoryInputs;
+  std::vector<uint8_t> *outputBuffer = nullptr;
+
   // The table offset at which to place function addresses.  We reserve zero
   // for the null function pointer.  This gets set to 1 for exectuables and 0
   // for shared libraries (since they always added to a dynamic offset at
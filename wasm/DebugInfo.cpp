@@ -0,0 +1,338 @@
+//===- DebugInfo.cpp ------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --prune-debug-info.
+//
+// Functions that are removed by garbage collection, COMDAT resolution or ICF
+// are still described by the debug sections of their object files, which are
+// copied to the output as they are, with relocations against the removed
+// functions resolved to zero.  This pass removes two kinds of such DWARF:
+//
+//  - All the debug sections of an object file whose .debug_info refers to
+//    functions and data that are all gone.  A compilation unit's debug
+//    sections are only referred to by each other, so they can be dropped
+//    together.
+//
+//  - The .debug_line sequences whose addresses all point into removed
+//    functions.  Each sequence covers a single function, and the state machine
+//    is reset at the end of each sequence, so it can be removed without
+//    changing the meaning of the others.  The units' lengths and the
+//    DW_AT_stmt_list references to later units are adjusted to match.
+//
+// The DIEs of removed functions in .debug_info are kept, since removing them
+// would require rewriting all the references between DIEs.
+//
+//===----------------------------------------------------------------------===//
+
+#include "DebugInfo.h"
+#include "Config.h"
+#include "InputChunks.h"
+#include "InputFiles.h"
+#include "SymbolTable.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
+#include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/LEB128.h"
+
+#define DEBUG_TYPE "lld"
+
+using namespace llvm;
+using namespace llvm::support::endian;
+using namespace llvm::wasm;
+
+namespace lld {
+namespace wasm {
+
+namespace {
+struct Range {
+  uint32_t offset;
+  uint32_t size;
+};
+
+// Walks the line number programs of a .debug_line section, looking for the
+// sequences that only describe removed functions.
+class LineTablePruner {
+public:
+  LineTablePruner(InputSection *sec, ArrayRef<uint8_t> data)
+      : sec(sec), data(data) {}
+
+  // Returns false if the section could not be parsed, in which case it
+  // should be left alone.
+  bool run();
+
+  void rewrite();
+
+  std::vector<Range> removed;
+
+private:
+  bool parseUnit(uint32_t unitOffset, uint32_t unitEnd);
+  bool isDeadAddress(uint32_t offset) const;
+  bool readULEB(uint32_t &offset, uint32_t end, uint64_t &value) const;
+
+  InputSection *sec;
+  ArrayRef<uint8_t> data;
+
+  // The offset of each unit's length field, and the number of bytes removed
+  // from the unit.
+  std::vector<std::pair<uint32_t, uint32_t>> unitShrinks;
+};
+} // namespace
+
+// Returns true if a relocation from a debug section of `file` points at a
+// function or data symbol that is not part of the output.
+static bool isDeadTarget(const ObjFile *file, const WasmRelocation &rel) {
+  const Symbol *sym = file->getSymbols()[rel.Index];
+  if (auto *f = dyn_cast<DefinedFunction>(sym))
+    // A COMDAT or ICF copy that lost to one in another file is dead, even
+    // though its symbol now refers to the winning copy.
+    return !f->function || !f->function->live || f->function->discarded ||
+           f->function->file != file;
+  if (isa<FunctionSymbol>(sym) || isa<DataSymbol>(sym))
+    return !sym->isLive() || sym->isDiscarded();
+  return false;
+}
+
+bool LineTablePruner::readULEB(uint32_t &offset, uint32_t end,
+                               uint64_t &value) const {
+  const char *err = nullptr;
+  unsigned n;
+  value = decodeULEB128(data.data() + offset, &n, data.data() + end, &err);
+  if (err)
+    return false;
+  offset += n;
+  return true;
+}
+
+bool LineTablePruner::isDeadAddress(uint32_t offset) const {
+  ArrayRef<WasmRelocation> relocs = sec->getRelocations();
+  auto it = llvm::partition_point(
+      relocs, [=](const WasmRelocation &r) { return r.Offset < offset; });
+  if (it == relocs.end() || it->Offset != offset)
+    return false;
+  return isDeadTarget(sec->file, *it);
+}
+
+bool LineTablePruner::parseUnit(uint32_t unitOffset, uint32_t unitEnd) {
+  uint32_t offset = unitOffset + 4;
+  if (offset + 2 > unitEnd)
+    return false;
+  uint16_t version = read16le(data.data() + offset);
+  offset += 2;
+  if (version < 2 || version > 5)
+    return false;
+  if (version >= 5)
+    offset += 2; // address_size, segment_selector_size
+  if (offset + 4 > unitEnd)
+    return false;
+  uint32_t headerLength = read32le(data.data() + offset);
+  offset += 4;
+  uint32_t programOffset = offset + headerLength;
+  if (programOffset > unitEnd)
+    return false;
+
+  // minimum_instruction_length, maximum_operations_per_instruction (since
+  // version 4), default_is_stmt, line_base, line_range.
+  offset += version >= 4 ? 5 : 4;
+  if (offset >= programOffset)
+    return false;
+  uint8_t opcodeBase = data[offset++];
+  if (opcodeBase == 0 || offset + opcodeBase - 1 > programOffset)
+    return false;
+  ArrayRef<uint8_t> standardOpcodeLengths = data.slice(offset, opcodeBase - 1);
+
+  std::vector<Range> unitRemoved;
+  uint32_t sequenceOffset = programOffset;
+  bool hasAddress = false;
+  bool allDead = true;
+  bool keep = false;
+  offset = programOffset;
+  while (offset < unitEnd) {
+    uint8_t opcode = data[offset++];
+    if (opcode >= opcodeBase)
+      continue;
+
+    if (opcode != 0) {
+      if (opcode == dwarf::DW_LNS_fixed_advance_pc) {
+        offset += 2;
+        continue;
+      }
+      for (uint8_t i = 0; i < standardOpcodeLengths[opcode - 1]; ++i) {
+        uint64_t operand;
+        if (!readULEB(offset, unitEnd, operand))
+          return false;
+      }
+      continue;
+    }
+
+    uint64_t length;
+    if (!readULEB(offset, unitEnd, length) || length == 0 ||
+        offset + length > unitEnd)
+      return false;
+    uint8_t subOpcode = data[offset];
+    if (subOpcode == dwarf::DW_LNE_set_address) {
+      hasAddress = true;
+      allDead &= isDeadAddress(offset + 1);
+    } else if (subOpcode == dwarf::DW_LNE_define_file) {
+      // Later sequences may refer to the file.
+      keep = true;
+    }
+    offset += length;
+
+    if (subOpcode == dwarf::DW_LNE_end_sequence) {
+      if (hasAddress && allDead && !keep)
+        unitRemoved.push_back({sequenceOffset, offset - sequenceOffset});
+      sequenceOffset = offset;
+      hasAddress = false;
+      allDead = true;
+      keep = false;
+    }
+  }
+  if (offset != unitEnd)
+    return false;
+
+  uint32_t shrink = 0;
+  for (const Range &r : unitRemoved)
+    shrink += r.size;
+  if (shrink) {
+    unitShrinks.push_back({unitOffset, shrink});
+    removed.insert(removed.end(), unitRemoved.begin(), unitRemoved.end());
+  }
+  return true;
+}
+
+bool LineTablePruner::run() {
+  uint32_t offset = 0;
+  while (offset < data.size()) {
+    if (offset + 4 > data.size())
+      return false;
+    uint32_t length = read32le(data.data() + offset);
+    // DWARF64 is not used for wasm32.
+    if (length >= 0xfffffff0 || length > data.size() - offset - 4)
+      return false;
+    uint32_t unitEnd = offset + 4 + length;
+    if (!parseUnit(offset, unitEnd))
+      return false;
+    offset = unitEnd;
+  }
+  return true;
+}
+
+void LineTablePruner::rewrite() {
+  uint32_t removedSize = 0;
+  for (const Range &r : removed)
+    removedSize += r.size;
+
+  uint8_t *buf = bAlloc.Allocate<uint8_t>(data.size() - removedSize);
+  std::vector<std::pair<uint32_t, uint32_t>> shifts;
+  uint32_t in = 0;
+  uint32_t out = 0;
+  for (const Range &r : removed) {
+    memcpy(buf + out, data.data() + in, r.offset - in);
+    out += r.offset - in;
+    in = r.offset + r.size;
+    shifts.push_back({in, in - out});
+  }
+  memcpy(buf + out, data.data() + in, data.size() - in);
+
+  sec->setPrunedContents(makeArrayRef(buf, data.size() - removedSize),
+                         std::move(shifts));
+
+  for (const std::pair<uint32_t, uint32_t> &unit : unitShrinks) {
+    uint8_t *loc = buf + sec->getChunkOffset(unit.first);
+    write32le(loc, read32le(loc) - unit.second);
+  }
+
+  // Drop the relocations of the removed sequences and move the others.
+  auto *relocs = make<std::vector<WasmRelocation>>();
+  auto r = removed.begin();
+  for (WasmRelocation rel : sec->getRelocations()) {
+    while (r != removed.end() && r->offset + r->size <= rel.Offset)
+      ++r;
+    if (r != removed.end() && r->offset <= rel.Offset)
+      continue;
+    rel.Offset = sec->getChunkOffset(rel.Offset);
+    relocs->push_back(rel);
+  }
+  sec->setRelocations(*relocs);
+}
+
+// Returns true if the debug sections of `file` only describe functions and
+// data that are not part of the output.
+static bool isDeadUnit(const ObjFile *file, const InputSection *debugInfo) {
+  bool hasCode = false;
+  for (const WasmRelocation &rel : debugInfo->getRelocations()) {
+    switch (rel.Type) {
+    case R_WASM_FUNCTION_OFFSET_I32:
+      hasCode = true;
+      LLVM_FALLTHROUGH;
+    case R_WASM_MEMORY_ADDR_I32:
+      if (!isDeadTarget(file, rel))
+        return false;
+      break;
+    default:
+      break;
+    }
+  }
+  return hasCode;
+}
+
+void pruneDebugInfo() {
+  // Parsing is done in parallel, but the sections are rewritten afterwards
+  // since that allocates.
+  ArrayRef<ObjFile *> files = symtab->objectFiles;
+  std::vector<uint8_t> deadUnits(files.size());
+  std::vector<std::unique_ptr<LineTablePruner>> pruners(files.size());
+  parallelForEachN(0, files.size(), [&](size_t i) {
+    ObjFile *file = files[i];
+    InputSection *debugInfo = nullptr;
+    InputSection *debugLine = nullptr;
+    for (InputSection *sec : file->customSections) {
+      if (sec->getName() == ".debug_info")
+        debugInfo = sec;
+      else if (sec->getName() == ".debug_line")
+        debugLine = sec;
+    }
+
+    if (debugInfo && isDeadUnit(file, debugInfo)) {
+      deadUnits[i] = true;
+      return;
+    }
+    if (!debugLine)
+      return;
+    auto pruner = std::make_unique<LineTablePruner>(
+        debugLine, debugLine->getInputContents());
+    if (!pruner->run()) {
+      warn(toString(file) + ": unable to parse .debug_line, not pruning it");
+      return;
+    }
+    if (!pruner->removed.empty())
+      pruners[i] = std::move(pruner);
+  });
+
+  uint64_t removedBytes = 0;
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (deadUnits[i]) {
+      for (InputSection *sec : files[i]->customSections) {
+        if (!sec->getName().startswith(".debug_"))
+          continue;
+        sec->discarded = true;
+        removedBytes += sec->getSize();
+      }
+    } else if (pruners[i]) {
+      for (const Range &r : pruners[i]->removed)
+        removedBytes += r.size;
+      pruners[i]->rewrite();
+    }
+  }
+  log("prune-debug-info: removed " + Twine(removedBytes) + " bytes");
+}
+
+} // namespace wasm
+} // namespace lld
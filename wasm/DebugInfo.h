@@ -0,0 +1,22 @@
+//===- DebugInfo.h ----------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_DEBUG_INFO_H
+#define LLD_WASM_DEBUG_INFO_H
+
+namespace lld {
+namespace wasm {
+
+// Removes the DWARF that only describes functions that are not part of the
+// output.  Called after garbage collection and ICF.
+void pruneDebugInfo();
+
+} // namespace wasm
+} // namespace lld
+
+#endif // LLD_WASM_DEBUG_INFO_H
@@ -8,18 +8,28 @@
 
 #include "lld/Common/Driver.h"
 #include "Config.h"
+#include "DebugInfo.h"
+#include "ICF.h"
+#include "Incremental.h"
 #include "InputChunks.h"
 #include "InputGlobal.h"
 #include "MarkLive.h"
+#include "Stats.h"
 #include "SymbolTable.h"
+#include "SyntheticSections.h"
 #include "Writer.h"
 #include "lld/Common/Args.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/InputLoader.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/PerfCounters.h"
 #include "lld/Common/Reproduce.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
 #include "lld/Common/Version.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Object/Wasm.h"
 #include "llvm/Option/Arg.h"
@@ -27,8 +37,8 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
-#include "llvm/Support/TarWriter.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
 
 #define DEBUG_TYPE "lld"
 
@@ -41,6 +51,9 @@ namespace lld {
 namespace wasm {
 Configuration *config;
 
+static Timer inputFileTimer("Input File Reading", Timer::root());
+static Timer ltoTimer("LTO", Timer::root());
+
 namespace {
 
 // Create enum with OPT_xxx values for each option in Options.td
@@ -67,6 +80,7 @@ public:
   void link(ArrayRef<const char *> argsArr);
 
 private:
+  void linkFiles(opt::InputArgList &args);
   void createFiles(opt::InputArgList &args);
   void addFile(StringRef path);
   void addLibrary(StringRef name);
@@ -78,19 +92,47 @@ private:
 };
 } // anonymous namespace
 
-bool link(ArrayRef<const char *> args, bool canExitEarly, raw_ostream &error) {
+static bool doLink(ArrayRef<const char *> args, bool canExitEarly,
+                   raw_ostream &diag, ArrayRef<MemoryBufferRef> inputs,
+                   std::vector<uint8_t> *output) {
   errorHandler().logName = args::getFilenameWithoutExe(args[0]);
-  errorHandler().errorOS = &error;
+  errorHandler().errorOS = &diag;
   errorHandler().errorLimitExceededMsg =
       "too many errors emitted, stopping now (use "
       "-error-limit=0 to see all errors)";
-  enableColors(error.has_colors());
+  enableColors(diag.has_colors());
 
+  // A caller that links more than once in the same process starts each link
+  // from a clean state, except for the inputs, which are kept for the next
+  // link in case it uses them again.
+  errorHandler().errorCount = 0;
+  errorHandler().exitEarly = canExitEarly;
   config = make<Configuration>();
+  config->reuseInputs = !canExitEarly;
+  config->outputBuffer = output;
   symtab = make<SymbolTable>();
+  out = OutStruct();
+  stats = LinkStats();
+  tar = nullptr;
+  errorHandler().cleanupCallback = [] { tar = nullptr; };
+  WasmSym::reset();
+
+  // In-memory inputs are linked as if they were named on the command line
+  // after the other arguments.
+  std::vector<const char *> argv(args.begin(), args.end());
+  for (MemoryBufferRef mb : inputs) {
+    StringRef name = saver.save(mb.getBufferIdentifier());
+    if (!config->memoryInputs.try_emplace(name, mb).second)
+      error("duplicate in-memory input: " + name);
+    argv.push_back(name.data());
+  }
 
   initLLVM();
-  LinkerDriver().link(args);
+  if (!errorCount())
+    LinkerDriver().link(argv);
+
+  // Finish the --reproduce tar file, so that it is complete when we return.
+  tar = nullptr;
 
   // Exit immediately if we don't need to return to the caller.
   // This saves time because the overhead of calling destructors
@@ -102,6 +144,19 @@ bool link(ArrayRef<const char *> args, bool canExitEarly, raw_ostream &error) {
   return !errorCount();
 }
 
+bool link(ArrayRef<const char *> args, bool canExitEarly, raw_ostream &diag) {
+  return doLink(args, canExitEarly, diag, {}, nullptr);
+}
+
+bool link(ArrayRef<const char *> args, ArrayRef<MemoryBufferRef> inputs,
+          std::vector<uint8_t> &output, raw_ostream &diag) {
+  output.clear();
+  if (doLink(args, /*canExitEarly=*/false, diag, inputs, &output))
+    return true;
+  output.clear();
+  return false;
+}
+
 // Create prefix string literals used in Options.td
 #define PREFIX(NAME, VALUE) const char *const NAME[] = VALUE;
 #include "Options.inc"
@@ -268,6 +323,16 @@ void LinkerDriver::addLibrary(StringRef name) {
 }
 
 void LinkerDriver::createFiles(opt::InputArgList &args) {
+  // With --preload-inputs, start reading the input files named on the
+  // command line while the files before them are parsed.
+  if (config->preloadInputs && !config->reuseInputs) {
+    std::vector<std::string> paths;
+    for (auto *arg : args.filtered(OPT_INPUT))
+      if (!config->memoryInputs.count(arg->getValue()))
+        paths.push_back(arg->getValue());
+    startPreloadingInputs(std::move(paths), /*requiresNullTerminator=*/true);
+  }
+
   for (auto *arg : args) {
     switch (arg->getOption().getID()) {
     case OPT_l:
@@ -284,6 +349,109 @@ void LinkerDriver::createFiles(opt::InputArgList &args) {
       break;
     }
   }
+  finishPreloadingInputs();
+}
+
+static ICFLevel getICF(opt::InputArgList &args) {
+  auto *arg = args.getLastArg(OPT_icf_none, OPT_icf_safe, OPT_icf_all);
+  if (!arg || arg->getOption().getID() == OPT_icf_none)
+    return ICFLevel::None;
+  if (arg->getOption().getID() == OPT_icf_safe)
+    return ICFLevel::Safe;
+  return ICFLevel::All;
+}
+
+// Parse the symbol ordering file and warn for any duplicate entries.
+static std::vector<StringRef> getSymbolOrderingFile(MemoryBufferRef mb) {
+  SetVector<StringRef> names;
+  for (StringRef s : args::getLines(mb))
+    if (!names.insert(s) && config->warnSymbolOrdering)
+      warn(mb.getBufferIdentifier() + ": duplicate ordered symbol: " + s);
+
+  return names.takeVector();
+}
+
+// Reads a call graph profile of the form "caller callee count" per line.
+static void readCallGraph(MemoryBufferRef mb) {
+  // Build a map from symbol name to symbol
+  DenseMap<StringRef, Symbol *> map;
+  for (ObjFile *file : symtab->objectFiles)
+    for (Symbol *sym : file->getSymbols())
+      map[sym->getName()] = sym;
+
+  auto findFunction = [&](StringRef name) -> InputFunction * {
+    Symbol *sym = map.lookup(name);
+    if (!sym) {
+      if (config->warnSymbolOrdering)
+        warn(mb.getBufferIdentifier() + ": no such symbol: " + name);
+      return nullptr;
+    }
+    if (auto *f = dyn_cast<DefinedFunction>(sym))
+      if (f->function && f->function->file)
+        return f->function;
+    if (config->warnSymbolOrdering)
+      warn(mb.getBufferIdentifier() +
+           ": unable to order non-function symbol: " + name);
+    return nullptr;
+  };
+
+  for (StringRef line : args::getLines(mb)) {
+    SmallVector<StringRef, 3> fields;
+    line.split(fields, ' ');
+    uint64_t count;
+
+    if (fields.size() != 3 || !to_integer(fields[2], count)) {
+      error(mb.getBufferIdentifier() + ": parse error");
+      return;
+    }
+
+    if (InputFunction *from = findFunction(fields[0]))
+      if (InputFunction *to = findFunction(fields[1]))
+        config->callGraphProfile[std::make_pair(from, to)] += count;
+  }
+}
+
+// Parse --build-id or --build-id=<style>. We handle "tree" as a
+// synonym for "sha1" because all our hash functions including
+// --build-id=sha1 are actually tree hashes for performance reasons.
+static std::pair<BuildIdKind, std::vector<uint8_t>>
+getBuildId(opt::InputArgList &args) {
+  auto *arg = args.getLastArg(OPT_build_id, OPT_build_id_eq);
+  if (!arg)
+    return {BuildIdKind::None, {}};
+
+  if (arg->getOption().getID() == OPT_build_id)
+    return {BuildIdKind::Fast, {}};
+
+  StringRef s = arg->getValue();
+  if (s == "fast")
+    return {BuildIdKind::Fast, {}};
+  if (s == "md5")
+    return {BuildIdKind::Md5, {}};
+  if (s == "sha1" || s == "tree")
+    return {BuildIdKind::Sha1, {}};
+  if (s == "uuid")
+    return {BuildIdKind::Uuid, {}};
+  if (s.startswith("0x"))
+    return {BuildIdKind::Hexstring, parseHex(s.substr(2))};
+
+  if (s != "none")
+    error("unknown --build-id style: " + s);
+  return {BuildIdKind::None, {}};
+}
+
+// Parses an option of the form --option=old;new.
+static std::pair<StringRef, StringRef> getOldNewOptions(opt::InputArgList &args,
+                                                        unsigned id) {
+  auto *arg = args.getLastArg(id);
+  if (!arg)
+    return {"", ""};
+
+  StringRef s = arg->getValue();
+  std::pair<StringRef, StringRef> ret = s.split(';');
+  if (ret.second.empty())
+    error(arg->getSpelling() + " expects 'old;new' format, but got " + s);
+  return ret;
 }
 
 static StringRef getEntry(opt::InputArgList &args) {
@@ -305,47 +473,120 @@ static void readConfigs(opt::InputArgList &args) {
   config->allowUndefined = args.hasArg(OPT_allow_undefined);
   config->checkFeatures =
       args.hasFlag(OPT_check_features, OPT_no_check_features, true);
+  config->compilationHints = args.hasArg(OPT_compilation_hints);
   config->compressRelocations = args.hasArg(OPT_compress_relocations);
   config->demangle = args.hasFlag(OPT_demangle, OPT_no_demangle, true);
   config->disableVerify = args.hasArg(OPT_disable_verify);
+  config->elideZeroRuns = args::getInteger(args, OPT_elide_zero_runs, 0);
   config->emitRelocs = args.hasArg(OPT_emit_relocs);
   config->entry = getEntry(args);
   config->exportAll = args.hasArg(OPT_export_all);
   config->exportTable = args.hasArg(OPT_export_table);
   config->growableTable = args.hasArg(OPT_growable_table);
+  config->icf = getICF(args);
   errorHandler().fatalWarnings =
       args.hasFlag(OPT_fatal_warnings, OPT_no_fatal_warnings, false);
   config->importMemory = args.hasArg(OPT_import_memory);
   config->sharedMemory = args.hasArg(OPT_shared_memory);
   config->importTable = args.hasArg(OPT_import_table);
+  config->incremental = args.hasArg(OPT_incremental);
   config->ltoo = args::getInteger(args, OPT_lto_O, 2);
+  config->ltoObjPath = args.getLastArgValue(OPT_lto_obj_path_eq);
   config->ltoPartitions = args::getInteger(args, OPT_lto_partitions, 1);
+  config->mapFile = args.getLastArgValue(OPT_Map);
   config->optimize = args::getInteger(args, OPT_O, 0);
-  config->outputFile = args.getLastArgValue(OPT_o);
+  // The output written to memory is named only in diagnostics.
+  config->outputFile =
+      args.getLastArgValue(OPT_o, config->outputBuffer ? "a.out" : "");
+  config->pruneDebugInfo = args.hasArg(OPT_prune_debug_info);
   config->relocatable = args.hasArg(OPT_relocatable);
+  StringRef packDynRelocs = args.getLastArgValue(OPT_pack_dyn_relocs, "none");
+  config->relrPackDynRelocs = packDynRelocs == "relr";
+  if (packDynRelocs != "none" && packDynRelocs != "relr")
+    error("unknown --pack-dyn-relocs format: " + packDynRelocs);
+  config->separateDebugFile = args.getLastArgValue(OPT_separate_debug_file);
+  config->splitModule = args.hasArg(OPT_split_module);
   config->gcSections =
       args.hasFlag(OPT_gc_sections, OPT_no_gc_sections, !config->relocatable);
   config->mergeDataSegments =
       args.hasFlag(OPT_merge_data_segments, OPT_no_merge_data_segments,
                    !config->relocatable);
+  config->mmapOutputFile =
+      config->outputBuffer ||
+      args.hasFlag(OPT_mmap_output_file, OPT_no_mmap_output_file, true);
+  config->packDataSegments =
+      args.hasFlag(OPT_pack_data_segments, OPT_no_pack_data_segments, false);
   config->pie = args.hasFlag(OPT_pie, OPT_no_pie, false);
+  config->preloadInputs =
+      args.hasFlag(OPT_preload_inputs, OPT_no_preload_inputs, false);
   config->printGcSections =
       args.hasFlag(OPT_print_gc_sections, OPT_no_print_gc_sections, false);
+  config->printIcfSections =
+      args.hasFlag(OPT_print_icf_sections, OPT_no_print_icf_sections, false);
+  if (auto *arg = args.getLastArg(OPT_print_stats)) {
+    config->printStats = true;
+    if (StringRef(arg->getValue()) != "json")
+      error("unknown --print-stats format: " + StringRef(arg->getValue()) +
+            " (supported formats: json)");
+  }
   config->saveTemps = args.hasArg(OPT_save_temps);
   config->searchPaths = args::getStrings(args, OPT_L);
   config->shared = args.hasArg(OPT_shared);
   config->stripAll = args.hasArg(OPT_strip_all);
   config->stripDebug = args.hasArg(OPT_strip_debug);
   config->stackFirst = args.hasArg(OPT_stack_first);
+  config->showTiming = args.hasArg(OPT_time);
+  config->timeJsonFile = args.getLastArgValue(OPT_time_json);
+  arenaUsageEnabled = args.hasArg(OPT_print_arena_usage);
+  perfCountersEnabled = false;
+  if (args.hasArg(OPT_perf_counters))
+    enablePerfCounters();
+  config->timeTraceEnabled = args.hasArg(OPT_time_trace);
+  config->timeTraceFile = args.getLastArgValue(OPT_time_trace_file);
+  config->timeTraceGranularity =
+      args::getInteger(args, OPT_time_trace_granularity, 500);
   config->trace = args.hasArg(OPT_trace);
+  config->warnSymbolOrdering =
+      args.hasFlag(OPT_warn_symbol_ordering, OPT_no_warn_symbol_ordering, true);
   config->thinLTOCacheDir = args.getLastArgValue(OPT_thinlto_cache_dir);
   config->thinLTOCachePolicy = CHECK(
       parseCachePruningPolicy(args.getLastArgValue(OPT_thinlto_cache_policy)),
       "--thinlto-cache-policy: invalid cache policy");
+  config->thinLTOEmitImportsFiles = args.hasArg(OPT_thinlto_emit_imports_files);
+  config->thinLTOIndexOnly = args.hasArg(OPT_thinlto_index_only) ||
+                             args.hasArg(OPT_thinlto_index_only_eq);
+  config->thinLTOIndexOnlyArg = args.getLastArgValue(OPT_thinlto_index_only_eq);
   config->thinLTOJobs = args::getInteger(args, OPT_thinlto_jobs, -1u);
+  config->thinLTOObjectSuffixReplace =
+      getOldNewOptions(args, OPT_thinlto_object_suffix_replace_eq);
+  config->thinLTOPrefixReplace =
+      getOldNewOptions(args, OPT_thinlto_prefix_replace_eq);
+  std::tie(config->buildId, config->buildIdVector) = getBuildId(args);
   errorHandler().verbose = args.hasArg(OPT_verbose);
   LLVM_DEBUG(errorHandler().verbose = true);
-  threadsEnabled = args.hasFlag(OPT_threads, OPT_no_threads, true);
+  args::setThreads(args, OPT_threads, OPT_no_threads, OPT_threads_eq);
+  // The memory budget and NUMA-aware threading are only set by ld.lld, but
+  // they are process-wide, so clear what an earlier link in this process set.
+  setNumaAware(false);
+  setMemoryBudget(0);
+
+  if (auto *arg = args.getLastArg(OPT_symbol_ordering_file)) {
+    if (args.hasArg(OPT_call_graph_ordering_file))
+      error("--symbol-ordering-file and --call-graph-order-file "
+            "may not be used together");
+    if (Optional<MemoryBufferRef> buffer = readFile(arg->getValue()))
+      config->symbolOrderingFile = getSymbolOrderingFile(*buffer);
+  }
+
+  if (config->splitModule) {
+    if (Optional<MemoryBufferRef> buffer =
+            readFile(args.getLastArgValue(OPT_split_module)))
+      for (StringRef s : args::getLines(*buffer))
+        config->splitModuleProfile.insert(s);
+    SmallString<128> path(config->outputFile);
+    sys::path::replace_extension(path, "deferred.wasm");
+    config->splitModuleOutput = saver.save(path);
+  }
 
   config->initialMemory = args::getInteger(args, OPT_initial_memory, 0);
   config->globalBase = args::getInteger(args, OPT_global_base, 1024);
@@ -382,6 +623,10 @@ static void setConfigs() {
     config->importMemory = true;
     config->allowUndefined = true;
   }
+
+  // The secondary module of --split-module imports the table.
+  if (config->splitModule && !config->importTable)
+    config->exportTable = true;
 }
 
 // Some command line options or some combinations of them are not allowed.
@@ -391,6 +636,23 @@ static void checkOptions(opt::InputArgList &args) {
     error("--compress-relocations is incompatible with output debug"
           " information. Please pass --strip-debug or --strip-all");
 
+  if (config->incremental) {
+    if (!config->stripDebug && !config->stripAll)
+      error("--incremental is incompatible with output debug information."
+            " Please pass --strip-debug or --strip-all");
+    if (config->compressRelocations)
+      error("--incremental and --compress-relocations may not be used "
+            "together");
+    if (config->icf != ICFLevel::None)
+      error("--incremental and --icf may not be used together");
+    if (config->buildId != BuildIdKind::None &&
+        config->buildId != BuildIdKind::Hexstring)
+      error("--incremental and --build-id may not be used together");
+  }
+
+  if (config->buildId != BuildIdKind::None && !config->mmapOutputFile)
+    error("--build-id and --no-mmap-output-file may not be used together");
+
   if (config->ltoo > 3)
     error("invalid optimization level for LTO: " + Twine(config->ltoo));
   if (config->ltoPartitions == 0)
@@ -404,6 +666,51 @@ static void checkOptions(opt::InputArgList &args) {
   if (config->outputFile.empty())
     error("no output file specified");
 
+  if (config->outputBuffer) {
+    if (config->incremental)
+      error("--incremental may not be used with an in-memory output");
+    if (config->splitModule)
+      error("--split-module may not be used with an in-memory output");
+    if (!config->separateDebugFile.empty())
+      error("--separate-debug-file may not be used with an in-memory output");
+  }
+
+  if (!config->separateDebugFile.empty()) {
+    if (config->emitRelocs)
+      error("--separate-debug-file and --emit-relocs may not be used "
+            "together");
+    if (config->separateDebugFile == config->outputFile)
+      error("--separate-debug-file must differ from the output file");
+  }
+
+  if (config->splitModule) {
+    if (config->relocatable)
+      error("-r and --split-module may not be used together");
+    if (config->pie || config->shared)
+      error("-shared/-pie is incompatible with --split-module");
+    if (!config->stripDebug && !config->stripAll)
+      error("--split-module is incompatible with output debug information."
+            " Please pass --strip-debug or --strip-all");
+    if (config->compressRelocations)
+      error("--split-module and --compress-relocations may not be used "
+            "together");
+    if (config->incremental)
+      error("--split-module and --incremental may not be used together");
+  }
+
+  if (config->elideZeroRuns) {
+    if (config->relocatable)
+      error("-r and --elide-zero-runs may not be used together");
+    if (config->emitRelocs)
+      error("--emit-relocs and --elide-zero-runs may not be used together");
+    if (config->incremental)
+      error("--incremental and --elide-zero-runs may not be used together");
+  }
+
+  if (config->compilationHints &&
+      !args.hasArg(OPT_call_graph_ordering_file))
+    error("--compilation-hints requires --call-graph-ordering-file");
+
   if (config->importTable && config->exportTable)
     error("--import-table and --export-table may not be used together");
 
@@ -418,6 +725,14 @@ static void checkOptions(opt::InputArgList &args) {
       error("-r -and --undefined may not be used together");
     if (config->pie)
       error("-r and -pie may not be used together");
+    if (config->icf != ICFLevel::None)
+      error("-r and --icf may not be used together");
+    if (config->incremental)
+      error("-r and --incremental may not be used together");
+    if (!config->separateDebugFile.empty())
+      error("-r and --separate-debug-file may not be used together");
+    if (config->compilationHints)
+      error("-r and --compilation-hints may not be used together");
   }
 }
 
@@ -663,8 +978,8 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
   // Handle --reproduce
   if (auto *arg = args.getLastArg(OPT_reproduce)) {
     StringRef path = arg->getValue();
-    Expected<std::unique_ptr<TarWriter>> errOrWriter =
-        TarWriter::create(path, path::stem(path));
+    Expected<std::unique_ptr<AsyncTarWriter>> errOrWriter =
+        AsyncTarWriter::create(path, path::stem(path));
     if (errOrWriter) {
       tar = std::move(*errOrWriter);
       tar->append("response.txt", createResponseFile(args));
@@ -687,6 +1002,39 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
   setConfigs();
   checkOptions(args);
 
+  if (config->timeTraceEnabled)
+    timeTraceProfilerInitialize(config->timeTraceGranularity, argsArr[0]);
+
+  {
+    ScopedTimer t(Timer::root());
+    linkFiles(args);
+  }
+
+  if (config->showTiming)
+    Timer::root().print();
+  if (!config->timeJsonFile.empty())
+    writeTimersJSON(config->timeJsonFile);
+  if (arenaUsageEnabled)
+    printArenaUsage();
+
+  if (config->printStats)
+    printStats();
+
+  if (config->timeTraceEnabled) {
+    std::string path = config->timeTraceFile.empty()
+                           ? (config->outputFile + ".time-trace").str()
+                           : config->timeTraceFile.str();
+    std::error_code ec;
+    raw_fd_ostream os(path, ec, sys::fs::OF_Text);
+    if (ec)
+      error("cannot open " + path + ": " + ec.message());
+    else
+      timeTraceProfilerWrite(os);
+    timeTraceProfilerCleanup();
+  }
+}
+
+void LinkerDriver::linkFiles(opt::InputArgList &args) {
   if (auto *arg = args.getLastArg(OPT_allow_undefined_file))
     readImportFile(arg->getValue());
 
@@ -704,16 +1052,41 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
 
   createSyntheticSymbols();
 
+  ScopedTimer t(inputFileTimer);
   createFiles(args);
   if (errorCount())
     return;
 
+  // If only function bodies changed since the last --incremental link, the
+  // previous output can be patched in place and we are done.
+  uint64_t argsHash = 0;
+  if (config->incremental) {
+    argsHash = hashCommandLine(args);
+    if (tryIncrementalLink(files, argsHash) || errorCount())
+      return;
+  }
+
+  // Decoding object files and reading the symbol tables of bitcode files is
+  // independent of symbol resolution, so do it in parallel up front.  Adding
+  // files to the symbol table must be serial.
+  // Some files may already have been decoded by tryIncrementalLink.
+  parallelForEach(files, [](InputFile *f) {
+    if (auto *obj = dyn_cast<ObjFile>(f)) {
+      if (!obj->getWasmObj())
+        obj->decode();
+    } else if (auto *bc = dyn_cast<BitcodeFile>(f)) {
+      bc->decode();
+    }
+  });
+  symtab->internNames(files);
+
   // Add all files to the symbol table. This will add almost all
   // symbols that we need to the symbol table.
   for (InputFile *f : files)
     symtab->addFile(f);
   if (errorCount())
     return;
+  t.stop();
 
   // Handle the `--undefined <sym>` options.
   for (auto *arg : args.filtered(OPT_undefined))
@@ -744,10 +1117,19 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
 
   // Do link-time optimization if given files are LLVM bitcode files.
   // This compiles bitcode files into real object files.
-  symtab->addCombinedLTOObject();
+  {
+    ScopedTimer t(ltoTimer);
+    symtab->addCombinedLTOObject();
+  }
   if (errorCount())
     return;
 
+  // If --thinlto-index-only is given, we should create only "index
+  // files" and not object files. Index file creation is already done
+  // in addCombinedLTOObject, so we are done if that's the case.
+  if (config->thinLTOIndexOnly)
+    return;
+
   // Resolve any variant symbols that were created due to signature
   // mismatchs.
   symtab->handleSymbolVariants();
@@ -782,8 +1164,26 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
   // Do size optimizations: garbage collection
   markLive();
 
+  // Fold identical functions.  This must happen after garbage collection so
+  // that only live functions are considered, and before the writer assigns
+  // function indices.
+  if (config->icf != ICFLevel::None)
+    doIcf();
+
+  // Remove the debug info of what was gced or icfed.
+  if (config->pruneDebugInfo && !config->stripDebug && !config->stripAll)
+    pruneDebugInfo();
+
+  // Read the call graph now that we know what was gced or icfed.
+  if (auto *arg = args.getLastArg(OPT_call_graph_ordering_file))
+    if (Optional<MemoryBufferRef> buffer = readFile(arg->getValue()))
+      readCallGraph(*buffer);
+
   // Write the result to the file.
   writeResult();
+
+  if (config->incremental && !errorCount())
+    writeIncrementalIndex(files, argsHash);
 }
 
 } // namespace wasm
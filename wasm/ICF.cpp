@@ -0,0 +1,399 @@
+//===- ICF.cpp ------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// ICF is short for Identical Code Folding.  This is a size optimization to
+// identify and merge two or more functions that happened to have the same
+// contents.  Template-heavy C++ code in particular tends to produce many
+// functions whose bodies are byte-for-byte identical once relocations have
+// been applied.
+//
+// Two functions are considered identical if they have the same signature,
+// the same body bytes outside of relocation sites, and relocations of the
+// same type at the same offsets whose targets are identical *in terms of
+// ICF*.  The bytes at relocation sites are not compared directly because they
+// hold input-file specific indices.
+//
+// See ELF/ICF.cpp for the details about the algorithm.  The implementation
+// here closely follows COFF/ICF.cpp.
+//
+// With --icf=safe, functions whose address may be observed by the program
+// (i.e. functions with a table entry or a GOT entry, and exported functions)
+// are not folded, since doing so would make their function pointers compare
+// equal.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ICF.h"
+#include "Config.h"
+#include "InputChunks.h"
+#include "InputFiles.h"
+#include "Stats.h"
+#include "SymbolTable.h"
+#include "Symbols.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#define DEBUG_TYPE "lld"
+
+using namespace llvm;
+using namespace llvm::wasm;
+
+namespace lld {
+namespace wasm {
+
+static Timer icfTimer("ICF", Timer::root());
+
+class ICF {
+public:
+  void run();
+
+private:
+  void markAddressSignificant(InputChunk *chunk);
+  bool isEligible(const InputFunction *f) const;
+
+  void segregate(size_t begin, size_t end, bool constant);
+
+  bool equalsConstant(const InputFunction *a, const InputFunction *b);
+  bool equalsVariable(const InputFunction *a, const InputFunction *b);
+
+  size_t findBoundary(size_t begin, size_t end);
+
+  void forEachClassRange(size_t begin, size_t end,
+                         std::function<void(size_t, size_t)> fn);
+
+  void forEachClass(std::function<void(size_t, size_t)> fn);
+
+  std::vector<InputFunction *> functions;
+  DenseSet<const InputFunction *> addressSignificant;
+  int cnt = 0;
+  std::atomic<bool> repeat = {false};
+};
+
+// Returns the number of bytes a relocation of the given type overwrites.
+static unsigned getRelocSiteSize(uint8_t type) {
+  switch (type) {
+  case R_WASM_TABLE_INDEX_I32:
+  case R_WASM_MEMORY_ADDR_I32:
+  case R_WASM_FUNCTION_OFFSET_I32:
+  case R_WASM_SECTION_OFFSET_I32:
+    return 4;
+  default:
+    // All LEB and SLEB relocation sites are padded to 5 bytes.
+    return 5;
+  }
+}
+
+static InputFunction *getTargetFunction(const ObjFile *file,
+                                        const WasmRelocation &rel) {
+  if (rel.Type == R_WASM_TYPE_INDEX_LEB)
+    return nullptr;
+  if (auto *f = dyn_cast<DefinedFunction>(file->getSymbol(rel.Index)))
+    return f->function;
+  return nullptr;
+}
+
+// Records the functions whose addresses are taken by the relocations in the
+// given chunk.  Only used for --icf=safe.
+void ICF::markAddressSignificant(InputChunk *chunk) {
+  if (!chunk->live)
+    return;
+  for (const WasmRelocation &rel : chunk->getRelocations()) {
+    switch (rel.Type) {
+    case R_WASM_TABLE_INDEX_I32:
+    case R_WASM_TABLE_INDEX_SLEB:
+    case R_WASM_TABLE_INDEX_REL_SLEB:
+    case R_WASM_GLOBAL_INDEX_LEB:
+      if (InputFunction *f = getTargetFunction(chunk->file, rel))
+        addressSignificant.insert(f);
+      break;
+    }
+  }
+}
+
+// Returns true if the function is subject to ICF.  Synthetic functions have
+// no input file and are never folded.
+bool ICF::isEligible(const InputFunction *f) const {
+  if (!f->file || !f->live || f->discarded)
+    return false;
+  return config->icf == ICFLevel::All || !addressSignificant.count(f);
+}
+
+// Split an equivalence class into smaller classes.
+void ICF::segregate(size_t begin, size_t end, bool constant) {
+  while (begin < end) {
+    // Divide [Begin, End) into two. Let Mid be the start index of the
+    // second group.
+    auto bound = std::stable_partition(
+        functions.begin() + begin + 1, functions.begin() + end,
+        [&](InputFunction *f) {
+          if (constant)
+            return equalsConstant(functions[begin], f);
+          return equalsVariable(functions[begin], f);
+        });
+    size_t mid = bound - functions.begin();
+
+    // Split [Begin, End) into [Begin, Mid) and [Mid, End). We use Mid as an
+    // equivalence class ID because every group ends with a unique index.
+    for (size_t i = begin; i < mid; ++i)
+      functions[i]->eqClass[(cnt + 1) % 2] = mid;
+
+    // If we created a group, we need to iterate the main loop again.
+    if (mid != end)
+      repeat = true;
+
+    begin = mid;
+  }
+}
+
+// Compare "non-moving" part of two functions, namely everything except
+// relocation targets that are themselves subject to ICF.
+bool ICF::equalsConstant(const InputFunction *a, const InputFunction *b) {
+  if (a->signature != b->signature)
+    return false;
+
+  ArrayRef<uint8_t> dataA = a->getInputContents();
+  ArrayRef<uint8_t> dataB = b->getInputContents();
+  ArrayRef<WasmRelocation> relsA = a->getRelocations();
+  ArrayRef<WasmRelocation> relsB = b->getRelocations();
+  if (dataA.size() != dataB.size() || relsA.size() != relsB.size())
+    return false;
+
+  size_t pos = 0;
+  for (size_t i = 0, e = relsA.size(); i != e; ++i) {
+    const WasmRelocation &r1 = relsA[i];
+    const WasmRelocation &r2 = relsB[i];
+    size_t start = r1.Offset - a->getInputSectionOffset();
+    if (r1.Type != r2.Type || r1.Addend != r2.Addend ||
+        start != r2.Offset - b->getInputSectionOffset())
+      return false;
+
+    // Compare the bytes preceding this relocation site.
+    if (dataA.slice(pos, start - pos) != dataB.slice(pos, start - pos))
+      return false;
+    pos = start + getRelocSiteSize(r1.Type);
+
+    if (r1.Type == R_WASM_TYPE_INDEX_LEB) {
+      if (a->file->getWasmObj()->types()[r1.Index] !=
+          b->file->getWasmObj()->types()[r2.Index])
+        return false;
+      continue;
+    }
+
+    Symbol *s1 = a->file->getSymbol(r1.Index);
+    Symbol *s2 = b->file->getSymbol(r2.Index);
+    if (s1 == s2)
+      continue;
+
+    // References to distinct defined functions are compared by equivalence
+    // class in equalsVariable.  Anything else must be the same symbol.
+    if (!getTargetFunction(a->file, r1) || !getTargetFunction(b->file, r2))
+      return false;
+  }
+
+  return dataA.drop_front(pos) == dataB.drop_front(pos);
+}
+
+// Compare "moving" part of two functions, namely relocation targets.
+bool ICF::equalsVariable(const InputFunction *a, const InputFunction *b) {
+  ArrayRef<WasmRelocation> relsA = a->getRelocations();
+  ArrayRef<WasmRelocation> relsB = b->getRelocations();
+  for (size_t i = 0, e = relsA.size(); i != e; ++i) {
+    InputFunction *f1 = getTargetFunction(a->file, relsA[i]);
+    InputFunction *f2 = getTargetFunction(b->file, relsB[i]);
+    if (f1 == f2)
+      continue;
+    if (f1->eqClass[cnt % 2] != f2->eqClass[cnt % 2])
+      return false;
+  }
+  return true;
+}
+
+// Find the first function after Begin that has a different class from Begin.
+size_t ICF::findBoundary(size_t begin, size_t end) {
+  for (size_t i = begin + 1; i < end; ++i)
+    if (functions[begin]->eqClass[cnt % 2] != functions[i]->eqClass[cnt % 2])
+      return i;
+  return end;
+}
+
+void ICF::forEachClassRange(size_t begin, size_t end,
+                            std::function<void(size_t, size_t)> fn) {
+  while (begin < end) {
+    size_t mid = findBoundary(begin, end);
+    fn(begin, mid);
+    begin = mid;
+  }
+}
+
+// Call Fn on each class group.
+void ICF::forEachClass(std::function<void(size_t, size_t)> fn) {
+  // If the number of functions is too small to use threading,
+  // call Fn sequentially.
+  if (functions.size() < 1024) {
+    forEachClassRange(0, functions.size(), fn);
+    ++cnt;
+    return;
+  }
+
+  // Shard into non-overlapping intervals, and call Fn in parallel.
+  // The sharding must be completed before any calls to Fn are made
+  // so that Fn can modify the functions in its shard without causing data
+  // races.
+  const size_t numShards = 256;
+  size_t step = functions.size() / numShards;
+  size_t boundaries[numShards + 1];
+  boundaries[0] = 0;
+  boundaries[numShards] = functions.size();
+  parallelForEachN(1, numShards, [&](size_t i) {
+    boundaries[i] = findBoundary((i - 1) * step, functions.size());
+  });
+  parallelForEachN(1, numShards + 1, [&](size_t i) {
+    if (boundaries[i - 1] < boundaries[i])
+      forEachClassRange(boundaries[i - 1], boundaries[i], fn);
+  });
+  ++cnt;
+}
+
+// Hashes everything in a function body except the bytes at relocation sites.
+static uint32_t hashConstant(const InputFunction *f) {
+  ArrayRef<uint8_t> data = f->getInputContents();
+  hash_code hash = hash_combine(data.size(), f->getRelocations().size());
+  size_t pos = 0;
+  for (const WasmRelocation &rel : f->getRelocations()) {
+    size_t start = rel.Offset - f->getInputSectionOffset();
+    hash = hash_combine(hash, rel.Type, start,
+                        xxHash64(data.slice(pos, start - pos)));
+    pos = start + getRelocSiteSize(rel.Type);
+  }
+  return hash_combine(hash, xxHash64(data.drop_front(pos)));
+}
+
+void ICF::run() {
+  ScopedTimer t(icfTimer);
+
+  if (config->icf == ICFLevel::Safe) {
+    for (ObjFile *file : symtab->objectFiles) {
+      for (InputChunk *c : file->functions)
+        markAddressSignificant(c);
+      for (InputChunk *c : file->segments)
+        markAddressSignificant(c);
+    }
+    for (Symbol *sym : symtab->getSymbols())
+      if (auto *f = dyn_cast<DefinedFunction>(sym))
+        if (f->function && f->isLive() && f->isExported())
+          addressSignificant.insert(f->function);
+  }
+
+  // Collect only foldable functions.  Every other function gets a unique
+  // class so that relocations against it only compare equal to
+  // relocations against the very same function.
+  uint32_t nextId = 1;
+  for (InputFunction *f : symtab->syntheticFunctions)
+    f->eqClass[0] = f->eqClass[1] = nextId++;
+  for (ObjFile *file : symtab->objectFiles) {
+    for (InputFunction *f : file->functions) {
+      if (isEligible(f))
+        functions.push_back(f);
+      else
+        f->eqClass[0] = f->eqClass[1] = nextId++;
+    }
+  }
+
+  // Initially, we use hash values to partition functions.
+  parallelForEach(functions, [&](InputFunction *f) {
+    // Set MSB to 1 to avoid collisions with non-hash IDs.
+    f->eqClass[0] = hashConstant(f) | (1U << 31);
+  });
+
+  // Combine the hashes of the functions referenced by each function into its
+  // hash.
+  for (unsigned cnt = 0; cnt != 2; ++cnt) {
+    parallelForEach(functions, [&](InputFunction *f) {
+      uint32_t hash = f->eqClass[cnt % 2];
+      for (const WasmRelocation &rel : f->getRelocations())
+        if (InputFunction *target = getTargetFunction(f->file, rel))
+          hash += target->eqClass[cnt % 2];
+      // Set MSB to 1 to avoid collisions with non-hash IDs.
+      f->eqClass[(cnt + 1) % 2] = hash | (1U << 31);
+    });
+  }
+
+  // From now on, functions are ordered so that functions in the same group
+  // are consecutive in the vector.
+  llvm::stable_sort(functions,
+                    [](const InputFunction *a, const InputFunction *b) {
+                      return a->eqClass[0] < b->eqClass[0];
+                    });
+
+  // Compare static contents and assign unique IDs for each static content.
+  forEachClass([&](size_t begin, size_t end) { segregate(begin, end, true); });
+
+  // Split groups by comparing relocations until convergence is obtained.
+  do {
+    repeat = false;
+    forEachClass(
+        [&](size_t begin, size_t end) { segregate(begin, end, false); });
+  } while (repeat);
+
+  log("ICF needed " + Twine(cnt) + " iterations");
+
+  // Merge functions in the same classes.  This is done serially so that the
+  // output of --print-icf-sections is deterministic.
+  DenseMap<const InputFunction *, InputFunction *> replacements;
+  forEachClassRange(0, functions.size(), [&](size_t begin, size_t end) {
+    if (end - begin == 1)
+      return;
+    InputFunction *kept = functions[begin];
+    if (config->printIcfSections)
+      message("selected function " + toString(kept));
+    for (size_t i = begin + 1; i < end; ++i) {
+      if (config->printIcfSections)
+        message("  removing identical function " + toString(functions[i]));
+      functions[i]->live = false;
+      replacements[functions[i]] = kept;
+      if (config->printStats)
+        stats.icfFolded.insert(functions[i]);
+    }
+  });
+
+  if (replacements.empty())
+    return;
+
+  // Redirect all function symbols that point to a folded function, so that
+  // relocations against them resolve to the function that was kept.
+  auto redirect = [&](Symbol *sym) {
+    if (auto *f = dyn_cast<DefinedFunction>(sym))
+      if (InputFunction *kept = replacements.lookup(f->function))
+        f->function = kept;
+  };
+
+  // Local symbols are owned by a single file, so they can be updated in
+  // parallel.  Global symbols are shared and are updated via the symbol
+  // table.
+  parallelForEach(symtab->objectFiles, [&](ObjFile *file) {
+    for (Symbol *sym : file->getSymbols())
+      if (sym->isLocal())
+        redirect(sym);
+  });
+  for (Symbol *sym : symtab->getSymbols())
+    redirect(sym);
+}
+
+// Entry point to ICF.
+void doIcf() { ICF().run(); }
+
+} // namespace wasm
+} // namespace lld
@@ -0,0 +1,459 @@
+//===- Incremental.cpp ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --incremental.
+//
+// A full link with --incremental pads every function body with trailing nops
+// (see writePaddedFunction) and then writes an index next to the output file.
+// For each input file the index records a hash of its contents and, for
+// object files, a hash of everything in the file that can influence the
+// layout of the output, the location of each of its functions in the output,
+// and the value that each of its code relocations resolved to.
+//
+// The layout hash covers every section of the object except the bytes of the
+// code section, of which only the relocation types, targets and addends are
+// included.  If it is unchanged then symbol resolution, garbage collection
+// and index assignment would all produce the same result as last time, and
+// so would every relocation.  The next link with the same command line can
+// then rewrite just the changed functions in the existing output, as long as
+// each of them still fits in the space reserved for it.  Anything else falls
+// back to a full link, which writes a fresh index.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Incremental.h"
+#include "Config.h"
+#include "InputChunks.h"
+#include "InputFiles.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
+#include "lld/Common/Version.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Option/ArgList.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <map>
+#include <tuple>
+
+using namespace llvm;
+using namespace llvm::object;
+using namespace llvm::wasm;
+
+namespace lld {
+namespace wasm {
+namespace {
+
+// Relocations are looked up by everything but their offset, which is free to
+// change between links.
+using RelocKey = std::tuple<uint8_t, uint32_t, int64_t>;
+
+RelocKey getRelocKey(const WasmRelocation &rel) {
+  return std::make_tuple(rel.Type, rel.Index, rel.Addend);
+}
+
+// Marks a function that is not part of the output.
+const uint32_t deadFunction = UINT32_MAX;
+
+struct IndexedFunction {
+  // Offset of the function within the body of the output code section.
+  uint32_t offset = deadFunction;
+  uint32_t size = 0;
+};
+
+struct IndexedFile {
+  std::string path;
+  uint64_t contentHash = 0;
+  // Only files that can be patched in place, i.e. object files that don't
+  // come from archives, have the following.
+  bool isObject = false;
+  uint64_t layoutHash = 0;
+  std::vector<IndexedFunction> functions;
+  std::map<RelocKey, uint32_t> relocValues;
+};
+
+struct Index {
+  uint64_t argsHash = 0;
+  uint64_t outputSize = 0;
+  uint64_t outputTime = 0;
+  std::vector<IndexedFile> files;
+
+  static Optional<Index> read(MemoryBufferRef mb);
+  void write() const;
+};
+} // namespace
+
+static std::string getIndexPath() {
+  return (config->outputFile + ".incremental").str();
+}
+
+static std::string getIndexHeader() {
+  return "wasm-ld incremental index 1 " + getLLDVersion();
+}
+
+// Fills in the size and modification time of the output file.
+static bool stampOutput(Index &index) {
+  sys::fs::file_status st;
+  if (sys::fs::status(config->outputFile, st))
+    return false;
+  index.outputSize = st.getSize();
+  index.outputTime = st.getLastModificationTime().time_since_epoch().count();
+  return true;
+}
+
+static uint64_t getLayoutHash(const ObjFile *file) {
+  const WasmObjectFile *obj = file->getWasmObj();
+  std::string buf;
+  raw_string_ostream os(buf);
+
+  for (const SectionRef &sec : obj->sections()) {
+    const WasmSection &section = obj->getWasmSection(sec);
+    // Relocations are covered by the sections they apply to.
+    if (section.Type == WASM_SEC_CUSTOM && section.Name.startswith("reloc."))
+      continue;
+
+    encodeULEB128(section.Type, os);
+    encodeULEB128(section.Name.size(), os);
+    os << section.Name;
+
+    if (section.Type != WASM_SEC_CODE) {
+      encodeULEB128(section.Content.size(), os);
+      os << toStringRef(section.Content);
+      for (const WasmRelocation &rel : section.Relocations) {
+        encodeULEB128(rel.Type, os);
+        encodeULEB128(rel.Offset, os);
+        encodeULEB128(rel.Index, os);
+        encodeSLEB128(rel.Addend, os);
+      }
+      continue;
+    }
+
+    // For the code section, record which relocations each function has but
+    // not where they are.
+    ArrayRef<WasmRelocation> relocs = section.Relocations;
+    for (const WasmFunction &func : obj->functions()) {
+      uint32_t end = func.CodeSectionOffset + func.Size;
+      size_t count = 0;
+      while (count < relocs.size() && relocs[count].Offset < end)
+        ++count;
+      encodeULEB128(count, os);
+      for (const WasmRelocation &rel : relocs.take_front(count)) {
+        encodeULEB128(rel.Type, os);
+        encodeULEB128(rel.Index, os);
+        encodeSLEB128(rel.Addend, os);
+      }
+      relocs = relocs.drop_front(count);
+    }
+  }
+  return xxHash64(os.str());
+}
+
+// The index is a text file with one record per line:
+//
+//   args <hash>
+//   output <size> <time>
+//   input <hash> <path>                    (a file that can't be patched)
+//   object <hash> <layout hash> <path>
+//   func <offset> <size>                   (the functions of the last object)
+//   func -                                 (a function not in the output)
+//   reloc <type> <index> <addend> <value>  (the relocations of the last object)
+Optional<Index> Index::read(MemoryBufferRef mb) {
+  SmallVector<StringRef, 0> lines;
+  mb.getBuffer().split(lines, '\n', -1, false);
+  if (lines.empty() || lines[0] != getIndexHeader())
+    return None;
+
+  Index index;
+  for (StringRef line : makeArrayRef(lines).drop_front()) {
+    StringRef kind, rest;
+    std::tie(kind, rest) = line.split(' ');
+    SmallVector<StringRef, 4> fields;
+    rest.split(fields, ' ', kind == "input" ? 1 : kind == "object" ? 2 : -1);
+    IndexedFile *file = index.files.empty() ? nullptr : &index.files.back();
+
+    if (kind == "args" && fields.size() == 1) {
+      if (!to_integer(fields[0], index.argsHash))
+        return None;
+    } else if (kind == "output" && fields.size() == 2) {
+      if (!to_integer(fields[0], index.outputSize) ||
+          !to_integer(fields[1], index.outputTime))
+        return None;
+    } else if (kind == "input" && fields.size() == 2) {
+      index.files.emplace_back();
+      IndexedFile &f = index.files.back();
+      f.path = fields[1];
+      if (!to_integer(fields[0], f.contentHash))
+        return None;
+    } else if (kind == "object" && fields.size() == 3) {
+      index.files.emplace_back();
+      IndexedFile &f = index.files.back();
+      f.isObject = true;
+      f.path = fields[2];
+      if (!to_integer(fields[0], f.contentHash) ||
+          !to_integer(fields[1], f.layoutHash))
+        return None;
+    } else if (kind == "func" && file && file->isObject) {
+      IndexedFunction func;
+      if (fields.size() == 2) {
+        if (!to_integer(fields[0], func.offset) ||
+            !to_integer(fields[1], func.size))
+          return None;
+      } else if (fields.size() != 1 || fields[0] != "-") {
+        return None;
+      }
+      file->functions.push_back(func);
+    } else if (kind == "reloc" && file && file->isObject &&
+               fields.size() == 4) {
+      uint8_t type;
+      uint32_t relIndex, value;
+      int64_t addend;
+      if (!to_integer(fields[0], type) || !to_integer(fields[1], relIndex) ||
+          !to_integer(fields[2], addend) || !to_integer(fields[3], value))
+        return None;
+      file->relocValues[std::make_tuple(type, relIndex, addend)] = value;
+    } else {
+      return None;
+    }
+  }
+  return index;
+}
+
+void Index::write() const {
+  std::error_code ec;
+  raw_fd_ostream os(getIndexPath(), ec, sys::fs::OF_None);
+  if (ec) {
+    warn("--incremental: cannot open " + getIndexPath() + ": " +
+         ec.message());
+    return;
+  }
+
+  os << getIndexHeader() << "\n";
+  os << "args " << argsHash << "\n";
+  os << "output " << outputSize << " " << outputTime << "\n";
+  for (const IndexedFile &f : files) {
+    if (!f.isObject) {
+      os << "input " << f.contentHash << " " << f.path << "\n";
+      continue;
+    }
+    os << "object " << f.contentHash << " " << f.layoutHash << " " << f.path
+       << "\n";
+    for (const IndexedFunction &func : f.functions) {
+      if (func.offset == deadFunction)
+        os << "func -\n";
+      else
+        os << "func " << func.offset << " " << func.size << "\n";
+    }
+    for (const auto &rel : f.relocValues)
+      os << "reloc " << unsigned(std::get<0>(rel.first)) << " "
+         << std::get<1>(rel.first) << " " << std::get<2>(rel.first) << " "
+         << rel.second << "\n";
+  }
+}
+
+uint64_t hashCommandLine(const opt::InputArgList &args) {
+  std::string buf;
+  for (const opt::Arg *arg : args) {
+    buf += arg->getAsString(args);
+    buf += '\0';
+  }
+  return xxHash64(buf);
+}
+
+void writeIncrementalIndex(ArrayRef<InputFile *> files, uint64_t argsHash) {
+  Index index;
+  index.argsHash = argsHash;
+  if (!stampOutput(index))
+    return;
+
+  index.files.resize(files.size());
+  parallelForEachN(0, files.size(), [&](size_t i) {
+    IndexedFile &f = index.files[i];
+    f.path = files[i]->getName();
+    f.contentHash = xxHash64(files[i]->getBuffer().getBuffer());
+
+    auto *obj = dyn_cast<ObjFile>(files[i]);
+    if (!obj || !obj->archiveName.empty())
+      return;
+    f.isObject = true;
+    f.layoutHash = getLayoutHash(obj);
+    for (const InputFunction *func : obj->functions) {
+      f.functions.emplace_back();
+      IndexedFunction &entry = f.functions.back();
+      if (!func->hasFunctionIndex())
+        continue;
+      entry.offset = func->outputOffset;
+      entry.size = func->getSize();
+      for (const WasmRelocation &rel : func->getRelocations())
+        f.relocValues[getRelocKey(rel)] = obj->calcNewValue(rel);
+    }
+  });
+
+  index.write();
+}
+
+// Returns the offset in the output file of the body of its code section.
+static Optional<uint64_t> findCodeSection(MemoryBufferRef mb) {
+  const uint8_t *begin = mb.getBuffer().bytes_begin();
+  const uint8_t *end = mb.getBuffer().bytes_end();
+  if (end - begin < 8 ||
+      !mb.getBuffer().startswith(StringRef(WasmMagic, sizeof(WasmMagic))))
+    return None;
+
+  const uint8_t *p = begin + 8;
+  while (p < end) {
+    uint8_t id = *p++;
+    unsigned n;
+    const char *err = nullptr;
+    uint64_t size = decodeULEB128(p, &n, end, &err);
+    if (err || size > uint64_t(end - p - n))
+      return None;
+    p += n;
+    if (id == WASM_SEC_CODE)
+      return p - begin;
+    p += size;
+  }
+  return None;
+}
+
+namespace {
+struct Patch {
+  uint32_t offset;
+  std::vector<uint8_t> data;
+};
+} // namespace
+
+static bool fullLink(const Twine &reason) {
+  log("--incremental: " + reason + "; doing a full link");
+  return false;
+}
+
+// Rewrites every function of a changed object file that is part of the
+// output using the relocation values recorded by the previous link.
+static bool patchFunctions(const ObjFile *file, const IndexedFile &entry,
+                           std::vector<Patch> &patches) {
+  const WasmObjectFile *obj = file->getWasmObj();
+  ArrayRef<WasmFunction> funcs = obj->functions();
+  if (funcs.size() != entry.functions.size())
+    return fullLink("functions of " + toString(file) + " changed");
+  if (funcs.empty())
+    return true;
+
+  const WasmSection *code = file->codeSection;
+  ArrayRef<WasmRelocation> relocs = code->Relocations;
+  for (size_t i = 0; i < funcs.size(); ++i) {
+    const WasmFunction &func = funcs[i];
+    uint32_t end = func.CodeSectionOffset + func.Size;
+    size_t count = 0;
+    while (count < relocs.size() && relocs[count].Offset < end)
+      ++count;
+    ArrayRef<WasmRelocation> funcRelocs = relocs.take_front(count);
+    relocs = relocs.drop_front(count);
+
+    const IndexedFunction &indexed = entry.functions[i];
+    if (indexed.offset == deadFunction)
+      continue;
+    if (5 + func.Size - func.CodeOffset > indexed.size)
+      return fullLink("function " + func.SymbolName + " in " +
+                      toString(file) + " outgrew its padding");
+    for (const WasmRelocation &rel : funcRelocs)
+      if (!entry.relocValues.count(getRelocKey(rel)))
+        return fullLink("relocations of " + toString(file) + " changed");
+
+    patches.push_back({indexed.offset, std::vector<uint8_t>(indexed.size)});
+    writePaddedFunction(patches.back().data.data(), indexed.size,
+                        code->Content.slice(func.CodeSectionOffset, func.Size),
+                        func.CodeSectionOffset, funcRelocs,
+                        [&](const WasmRelocation &rel) {
+                          return entry.relocValues.find(getRelocKey(rel))
+                              ->second;
+                        });
+  }
+  return true;
+}
+
+bool tryIncrementalLink(ArrayRef<InputFile *> files, uint64_t argsHash) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+      MemoryBuffer::getFile(getIndexPath());
+  if (!mbOrErr)
+    return fullLink("no index from a previous link");
+  Optional<Index> index = Index::read(**mbOrErr);
+  if (!index)
+    return fullLink("index is malformed");
+
+  if (index->argsHash != argsHash)
+    return fullLink("command line changed");
+  Index current;
+  if (!stampOutput(current) || current.outputSize != index->outputSize ||
+      current.outputTime != index->outputTime)
+    return fullLink("output file changed");
+  if (files.size() != index->files.size())
+    return fullLink("input files changed");
+
+  std::vector<uint64_t> hashes(files.size());
+  parallelForEachN(0, files.size(), [&](size_t i) {
+    hashes[i] = xxHash64(files[i]->getBuffer().getBuffer());
+  });
+
+  std::vector<Patch> patches;
+  unsigned changed = 0;
+  for (size_t i = 0; i < files.size(); ++i) {
+    IndexedFile &entry = index->files[i];
+    if (files[i]->getName() != entry.path)
+      return fullLink("input files changed");
+    if (hashes[i] == entry.contentHash)
+      continue;
+
+    auto *obj = dyn_cast<ObjFile>(files[i]);
+    if (!obj || !obj->archiveName.empty() || !entry.isObject)
+      return fullLink(toString(files[i]) + " changed");
+    obj->decode();
+    if (getLayoutHash(obj) != entry.layoutHash)
+      return fullLink("layout of " + toString(obj) + " changed");
+    if (!patchFunctions(obj, entry, patches))
+      return false;
+    entry.contentHash = hashes[i];
+    ++changed;
+  }
+
+  if (!changed) {
+    log("--incremental: output is up to date");
+    return true;
+  }
+
+  Optional<uint64_t> codeOffset;
+  {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> outOrErr =
+        MemoryBuffer::getFile(config->outputFile);
+    if (outOrErr)
+      codeOffset = findCodeSection(**outOrErr);
+  }
+  if (!codeOffset)
+    return fullLink("cannot find the code section of the output");
+
+  int fd;
+  if (std::error_code ec = sys::fs::openFileForReadWrite(
+          config->outputFile, fd, sys::fs::CD_OpenExisting, sys::fs::OF_None))
+    return fullLink("cannot open " + config->outputFile + ": " +
+                    ec.message());
+  {
+    raw_fd_ostream os(fd, /*shouldClose=*/true);
+    for (const Patch &p : patches)
+      os.pwrite(reinterpret_cast<const char *>(p.data.data()), p.data.size(),
+                *codeOffset + p.offset);
+  }
+
+  if (stampOutput(*index))
+    index->write();
+  log("--incremental: rewrote " + Twine(patches.size()) +
+      " functions in place");
+  return true;
+}
+
+} // namespace wasm
+} // namespace lld
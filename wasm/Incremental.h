@@ -0,0 +1,38 @@
+//===- Incremental.h --------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_INCREMENTAL_H
+#define LLD_WASM_INCREMENTAL_H
+
+#include "lld/Common/LLVM.h"
+
+namespace llvm {
+namespace opt {
+class InputArgList;
+}
+} // namespace llvm
+
+namespace lld {
+namespace wasm {
+
+class InputFile;
+
+uint64_t hashCommandLine(const llvm::opt::InputArgList &args);
+
+// Tries to update the output of the previous --incremental link in place.
+// Returns false if a full link is needed instead.
+bool tryIncrementalLink(ArrayRef<InputFile *> files, uint64_t argsHash);
+
+// Records the layout of the output file that was just written so that the
+// next --incremental link can reuse it.
+void writeIncrementalIndex(ArrayRef<InputFile *> files, uint64_t argsHash);
+
+} // namespace wasm
+} // namespace lld
+
+#endif
@@ -9,10 +9,16 @@
 #include "InputChunks.h"
 #include "Config.h"
 #include "OutputSegment.h"
+#include "Relocations.h"
 #include "WriterUtils.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/LLVM.h"
+#include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/MC/StringTableBuilder.h"
 #include "llvm/Support/LEB128.h"
+#include "llvm/Support/xxhash.h"
 
 #define DEBUG_TYPE "lld"
 
@@ -87,10 +93,60 @@ void InputChunk::verifyRelocTargets() const {
   }
 }
 
+// Relocated LEB fields are padded to 5 bytes, so they are written with
+// fixed-width encoders rather than the generic loops of encodeULEB128() and
+// encodeSLEB128().
+static void writePaddedUleb128(uint8_t *loc, uint32_t value) {
+  loc[0] = (value & 0x7f) | 0x80;
+  loc[1] = ((value >> 7) & 0x7f) | 0x80;
+  loc[2] = ((value >> 14) & 0x7f) | 0x80;
+  loc[3] = ((value >> 21) & 0x7f) | 0x80;
+  loc[4] = value >> 28;
+}
+
+static void writePaddedSleb128(uint8_t *loc, int32_t value) {
+  uint32_t bits = value;
+  loc[0] = (bits & 0x7f) | 0x80;
+  loc[1] = ((bits >> 7) & 0x7f) | 0x80;
+  loc[2] = ((bits >> 14) & 0x7f) | 0x80;
+  loc[3] = ((bits >> 21) & 0x7f) | 0x80;
+  loc[4] = (value >> 28) & 0x7f;
+}
+
+// Writes the value of a relocation to its (padded) location.
+static void applyRelocation(uint8_t *loc, const WasmRelocation &rel,
+                            uint32_t value) {
+  switch (rel.Type) {
+  case R_WASM_TYPE_INDEX_LEB:
+  case R_WASM_FUNCTION_INDEX_LEB:
+  case R_WASM_GLOBAL_INDEX_LEB:
+  case R_WASM_EVENT_INDEX_LEB:
+  case R_WASM_MEMORY_ADDR_LEB:
+    writePaddedUleb128(loc, value);
+    break;
+  case R_WASM_TABLE_INDEX_SLEB:
+  case R_WASM_TABLE_INDEX_REL_SLEB:
+  case R_WASM_MEMORY_ADDR_SLEB:
+  case R_WASM_MEMORY_ADDR_REL_SLEB:
+    writePaddedSleb128(loc, static_cast<int32_t>(value));
+    break;
+  case R_WASM_TABLE_INDEX_I32:
+  case R_WASM_MEMORY_ADDR_I32:
+  case R_WASM_FUNCTION_OFFSET_I32:
+  case R_WASM_SECTION_OFFSET_I32:
+    write32le(loc, value);
+    break;
+  default:
+    llvm_unreachable("unknown relocation type");
+  }
+}
+
 // Copy this input chunk to an mmap'ed output file and apply relocations.
-void InputChunk::writeTo(uint8_t *buf) const {
+void InputChunk::writeTo(uint8_t *buf) const { writeAt(buf + outputOffset); }
+
+void InputChunk::writeAt(uint8_t *buf) const {
   // Copy contents
-  memcpy(buf + outputOffset, data().data(), data().size());
+  memcpy(buf, data().data(), data().size());
 
   // Apply relocations
   if (relocations.empty())
@@ -102,11 +158,13 @@ void InputChunk::writeTo(uint8_t *buf) const {
 
   LLVM_DEBUG(dbgs() << "applying relocations: " << toString(this)
                     << " count=" << relocations.size() << "\n");
-  int32_t off = outputOffset - getInputSectionOffset();
+  uint32_t off = getInputSectionOffset();
 
   for (const WasmRelocation &rel : relocations) {
-    uint8_t *loc = buf + rel.Offset + off;
-    uint32_t value = file->calcNewValue(rel);
+    uint8_t *loc = buf + rel.Offset - off;
+    uint32_t value = file->lookupIndex(rel);
+    if (value == UINT32_MAX)
+      value = file->calcNewValue(rel);
     LLVM_DEBUG(dbgs() << "apply reloc: type=" << relocTypeToString(rel.Type));
     if (rel.Type != R_WASM_TYPE_INDEX_LEB)
       LLVM_DEBUG(dbgs() << " sym=" << file->getSymbols()[rel.Index]->getName());
@@ -114,29 +172,7 @@ void InputChunk::writeTo(uint8_t *buf) const {
                       << " value=" << value << " offset=" << rel.Offset
                       << "\n");
 
-    switch (rel.Type) {
-    case R_WASM_TYPE_INDEX_LEB:
-    case R_WASM_FUNCTION_INDEX_LEB:
-    case R_WASM_GLOBAL_INDEX_LEB:
-    case R_WASM_EVENT_INDEX_LEB:
-    case R_WASM_MEMORY_ADDR_LEB:
-      encodeULEB128(value, loc, 5);
-      break;
-    case R_WASM_TABLE_INDEX_SLEB:
-    case R_WASM_TABLE_INDEX_REL_SLEB:
-    case R_WASM_MEMORY_ADDR_SLEB:
-    case R_WASM_MEMORY_ADDR_REL_SLEB:
-      encodeSLEB128(static_cast<int32_t>(value), loc, 5);
-      break;
-    case R_WASM_TABLE_INDEX_I32:
-    case R_WASM_MEMORY_ADDR_I32:
-    case R_WASM_FUNCTION_OFFSET_I32:
-    case R_WASM_SECTION_OFFSET_I32:
-      write32le(loc, value);
-      break;
-    default:
-      llvm_unreachable("unknown relocation type");
-    }
+    applyRelocation(loc, rel, value);
   }
 }
 
@@ -225,24 +261,32 @@ static unsigned getRelocWidth(const WasmRelocation &rel, uint32_t value) {
 // This function only computes the final output size.  It must be called
 // before getSize() is used to calculate of layout of the code section.
 void InputFunction::calculateSize() {
+  if (file && config->incremental) {
+    paddedSize = getPaddedFunctionSize(function->Size - function->CodeOffset);
+    return;
+  }
+
   if (!file || !config->compressRelocations)
     return;
 
   LLVM_DEBUG(dbgs() << "calculateSize: " << getName() << "\n");
 
-  const uint8_t *secStart = file->codeSection->Content.data();
-  const uint8_t *funcStart = secStart + getInputSectionOffset();
-  uint32_t functionSizeLength;
-  decodeULEB128(funcStart, &functionSizeLength);
-
   uint32_t start = getInputSectionOffset();
   uint32_t end = start + function->Size;
 
-  uint32_t lastRelocEnd = start + functionSizeLength;
-  for (const WasmRelocation &rel : relocations) {
+  // Keep the relocation values so that writeTo doesn't have to compute them
+  // a second time.
+  relocValues = std::make_unique<uint32_t[]>(relocations.size());
+
+  uint32_t lastRelocEnd = start + function->CodeOffset;
+  for (size_t i = 0, e = relocations.size(); i != e; ++i) {
+    const WasmRelocation &rel = relocations[i];
     LLVM_DEBUG(dbgs() << "  region: " << (rel.Offset - lastRelocEnd) << "\n");
+    relocValues[i] = file->lookupIndex(rel);
+    if (relocValues[i] == UINT32_MAX)
+      relocValues[i] = file->calcNewValue(rel);
     compressedFuncSize += rel.Offset - lastRelocEnd;
-    compressedFuncSize += getRelocWidth(rel, file->calcNewValue(rel));
+    compressedFuncSize += getRelocWidth(rel, relocValues[i]);
     lastRelocEnd = rel.Offset + getRelocWidthPadded(rel);
   }
   LLVM_DEBUG(dbgs() << "  final region: " << (end - lastRelocEnd) << "\n");
@@ -258,8 +302,14 @@ void InputFunction::calculateSize() {
 }
 
 // Override the default writeTo method so that we can (optionally) write the
-// compressed version of the function.
+// compressed or padded version of the function.
 void InputFunction::writeTo(uint8_t *buf) const {
+  if (file && config->incremental)
+    return writePaddedFunction(
+        buf + outputOffset, paddedSize, getInputContents(),
+        getInputSectionOffset(), relocations,
+        [&](const WasmRelocation &rel) { return file->calcNewValue(rel); });
+
   if (!file || !config->compressRelocations)
     return InputChunk::writeTo(buf);
 
@@ -270,19 +320,18 @@ void InputFunction::writeTo(uint8_t *buf) const {
   const uint8_t *secStart = file->codeSection->Content.data();
   const uint8_t *funcStart = secStart + getInputSectionOffset();
   const uint8_t *end = funcStart + function->Size;
-  uint32_t count;
-  decodeULEB128(funcStart, &count);
-  funcStart += count;
+  funcStart += function->CodeOffset;
 
   LLVM_DEBUG(dbgs() << "write func: " << getName() << "\n");
   buf += encodeULEB128(compressedFuncSize, buf);
   const uint8_t *lastRelocEnd = funcStart;
-  for (const WasmRelocation &rel : relocations) {
+  for (size_t i = 0, e = relocations.size(); i != e; ++i) {
+    const WasmRelocation &rel = relocations[i];
     unsigned chunkSize = (secStart + rel.Offset) - lastRelocEnd;
     LLVM_DEBUG(dbgs() << "  write chunk: " << chunkSize << "\n");
     memcpy(buf, lastRelocEnd, chunkSize);
     buf += chunkSize;
-    buf += writeCompressedReloc(buf, rel, file->calcNewValue(rel));
+    buf += writeCompressedReloc(buf, rel, relocValues[i]);
     lastRelocEnd = secStart + rel.Offset + getRelocWidthPadded(rel);
   }
 
@@ -292,6 +341,34 @@ void InputFunction::writeTo(uint8_t *buf) const {
   LLVM_DEBUG(dbgs() << "  total: " << (buf + chunkSize - orig) << "\n");
 }
 
+uint32_t getPaddedFunctionSize(uint32_t bodySize) {
+  // Leave room for the body to grow by a quarter, plus a little extra so
+  // that small functions have some room too.  The size field is always
+  // written as a padded 5-byte LEB.
+  return 5 + bodySize + bodySize / 4 + 16;
+}
+
+void writePaddedFunction(
+    uint8_t *buf, uint32_t paddedSize, ArrayRef<uint8_t> input,
+    uint32_t inputSectionOffset, ArrayRef<WasmRelocation> relocs,
+    function_ref<uint32_t(const WasmRelocation &)> calcValue) {
+  unsigned sizeLength;
+  uint32_t bodySize = decodeULEB128(input.data(), &sizeLength);
+  assert(5 + bodySize <= paddedSize);
+
+  // The body ends with an `end` opcode.  Insert the nops just before it,
+  // where they are valid whatever the state of the operand stack, and after
+  // all of the relocation sites.
+  encodeULEB128(paddedSize - 5, buf, 5);
+  memcpy(buf + 5, input.data() + sizeLength, bodySize - 1);
+  memset(buf + 4 + bodySize, 0x01 /* nop */, paddedSize - 5 - bodySize);
+  buf[paddedSize - 1] = WASM_OPCODE_END;
+
+  int32_t off = 5 - int32_t(inputSectionOffset + sizeLength);
+  for (const WasmRelocation &rel : relocs)
+    applyRelocation(buf + rel.Offset + off, rel, calcValue(rel));
+}
+
 // Generate code to apply relocations to the data section at runtime.
 // This is only called when generating shared libaries (PIC) where address are
 // not known at static link time.
@@ -299,10 +376,10 @@ void InputSegment::generateRelocationCode(raw_ostream &os) const {
   LLVM_DEBUG(dbgs() << "generating runtime relocations: " << getName()
                     << " count=" << relocations.size() << "\n");
 
-  // TODO(sbc): Encode the relocations in the data section and write a loop
-  // here to apply them.
   uint32_t segmentVA = outputSeg->startVA + outputSegmentOffset;
   for (const WasmRelocation &rel : relocations) {
+    if (outputSeg->relocTable && RelocTableSegment::isPacked(this, rel))
+      continue;
     uint32_t offset = rel.Offset - getInputSectionOffset();
     uint32_t outputOffset = segmentVA + offset;
 
@@ -347,5 +424,437 @@ void InputSegment::generateRelocationCode(raw_ostream &os) const {
   }
 }
 
+// Opcodes used by the relocation table loop that are missing from
+// BinaryFormat/Wasm.h.
+enum : uint8_t {
+  opcodeBlock = 0x02,
+  opcodeLoop = 0x03,
+  opcodeBr = 0x0c,
+  opcodeBrIf = 0x0d,
+  opcodeLocalSet = 0x21,
+  opcodeLocalTee = 0x22,
+  opcodeI32Load = 0x28,
+  opcodeI32Eqz = 0x45,
+  opcodeI32GeU = 0x4f,
+  opcodeI32And = 0x71,
+  opcodeI32ShrU = 0x76,
+};
+
+// The number of words covered by one bitmap entry of a relocation table.
+static constexpr uint32_t relrBitmapWords = 31;
+
+static const WasmSegment &createRelocTableSegment() {
+  auto *seg = make<WasmSegment>();
+  seg->Data.Name = "__wasm_relr";
+  seg->Data.Alignment = 2;
+  seg->Data.Comdat = UINT32_MAX;
+  return *seg;
+}
+
+// Returns the offset of the location of `rel` within its output segment.
+static uint32_t getOutputSegmentRelocOffset(const InputSegment *seg,
+                                            const WasmRelocation &rel) {
+  return seg->outputSegmentOffset + rel.Offset - seg->getInputSectionOffset();
+}
+
+bool RelocTableSegment::isPacked(const InputSegment *seg,
+                                 const WasmRelocation &rel) {
+  if (rel.Type != R_WASM_MEMORY_ADDR_I32 && rel.Type != R_WASM_TABLE_INDEX_I32)
+    return false;
+  if (requiresGOTAccess(seg->file->getSymbol(rel)))
+    return false;
+  return getOutputSegmentRelocOffset(seg, rel) % 4 == 0;
+}
+
+// Encodes a sorted list of word aligned offsets in the SHT_RELR format.
+static void encodeRelr(ArrayRef<uint32_t> offsets, std::vector<uint8_t> &out) {
+  auto add = [&](uint32_t entry) {
+    uint8_t buf[4];
+    write32le(buf, entry);
+    out.insert(out.end(), buf, buf + 4);
+  };
+
+  for (size_t i = 0, e = offsets.size(); i != e;) {
+    add(offsets[i]);
+    uint32_t where = offsets[i] + 4;
+    ++i;
+    for (;;) {
+      uint32_t bitmap = 0;
+      for (; i != e; ++i) {
+        uint32_t delta = offsets[i] - where;
+        if (delta >= relrBitmapWords * 4)
+          break;
+        bitmap |= 1u << (delta / 4);
+      }
+      if (!bitmap)
+        break;
+      add((bitmap << 1) | 1);
+      where += relrBitmapWords * 4;
+    }
+  }
+}
+
+RelocTableSegment::RelocTableSegment(OutputSegment *seg)
+    : InputSegment(createRelocTableSegment(), nullptr) {
+  live = true;
+
+  std::vector<uint32_t> memoryRelocs;
+  std::vector<uint32_t> tableRelocs;
+  for (const InputSegment *inSeg : seg->inputSegments) {
+    for (const WasmRelocation &rel : inSeg->getRelocations()) {
+      if (!isPacked(inSeg, rel))
+        continue;
+      uint32_t offset = getOutputSegmentRelocOffset(inSeg, rel);
+      if (rel.Type == R_WASM_TABLE_INDEX_I32)
+        tableRelocs.push_back(offset);
+      else
+        memoryRelocs.push_back(offset);
+    }
+  }
+  llvm::sort(memoryRelocs);
+  llvm::sort(tableRelocs);
+
+  encodeRelr(memoryRelocs, contents);
+  memoryRelocsSize = contents.size();
+  encodeRelr(tableRelocs, contents);
+}
+
+// Writes code that adds the value of `base` to the word at the offset in the
+// output segment held in local `l`.
+static void writeApplyRelocation(raw_ostream &os, uint32_t l,
+                                 const GlobalSymbol *base, uint32_t startVA) {
+  // The address to store to.
+  writeU8(os, WASM_OPCODE_GLOBAL_GET, "GLOBAL_GET");
+  writeUleb128(os, WasmSym::memoryBase->getGlobalIndex(), "memory_base");
+  writeU8(os, WASM_OPCODE_LOCAL_GET, "LOCAL_GET");
+  writeUleb128(os, l, "local");
+  writeU8(os, WASM_OPCODE_I32_ADD, "ADD");
+
+  // The value already there plus the base.
+  writeU8(os, WASM_OPCODE_GLOBAL_GET, "GLOBAL_GET");
+  writeUleb128(os, WasmSym::memoryBase->getGlobalIndex(), "memory_base");
+  writeU8(os, WASM_OPCODE_LOCAL_GET, "LOCAL_GET");
+  writeUleb128(os, l, "local");
+  writeU8(os, WASM_OPCODE_I32_ADD, "ADD");
+  writeU8(os, opcodeI32Load, "I32_LOAD");
+  writeUleb128(os, 2, "align");
+  writeUleb128(os, startVA, "offset");
+  writeU8(os, WASM_OPCODE_GLOBAL_GET, "GLOBAL_GET");
+  writeUleb128(os, base->getGlobalIndex(), "base");
+  writeU8(os, WASM_OPCODE_I32_ADD, "ADD");
+
+  writeU8(os, WASM_OPCODE_I32_STORE, "I32_STORE");
+  writeUleb128(os, 2, "align");
+  writeUleb128(os, startVA, "offset");
+}
+
+static void writeAddToLocal(raw_ostream &os, uint32_t l, uint32_t value) {
+  writeU8(os, WASM_OPCODE_LOCAL_GET, "LOCAL_GET");
+  writeUleb128(os, l, "local");
+  writeU8(os, WASM_OPCODE_I32_CONST, "I32_CONST");
+  writeSleb128(os, int32_t(value), "value");
+  writeU8(os, WASM_OPCODE_I32_ADD, "ADD");
+  writeU8(os, opcodeLocalSet, "LOCAL_SET");
+  writeUleb128(os, l, "local");
+}
+
+// Writes a loop that decodes the entries of the table between the given
+// offsets within the output segment.  The locals used are, in order: the
+// offset of the next entry, the offset of the next word to relocate, the
+// current entry and the offset of the word being considered in a bitmap.
+void RelocTableSegment::writeApplyLoop(raw_ostream &os, uint32_t begin,
+                                       uint32_t end, const GlobalSymbol *base,
+                                       uint32_t firstLocal) const {
+  if (begin == end)
+    return;
+
+  const uint32_t next = firstLocal;
+  const uint32_t where = firstLocal + 1;
+  const uint32_t entry = firstLocal + 2;
+  const uint32_t p = firstLocal + 3;
+  const uint32_t startVA = outputSeg->startVA;
+
+  writeU8(os, WASM_OPCODE_I32_CONST, "I32_CONST");
+  writeSleb128(os, int32_t(outputSegmentOffset + begin), "table start");
+  writeU8(os, opcodeLocalSet, "LOCAL_SET");
+  writeUleb128(os, next, "local");
+
+  writeU8(os, opcodeBlock, "BLOCK");
+  writeU8(os, WASM_TYPE_NORESULT, "block type");
+  writeU8(os, opcodeLoop, "LOOP");
+  writeU8(os, WASM_TYPE_NORESULT, "loop type");
+
+  // Stop at the end of the table.
+  writeU8(os, WASM_OPCODE_LOCAL_GET, "LOCAL_GET");
+  writeUleb128(os, next, "local");
+  writeU8(os, WASM_OPCODE_I32_CONST, "I32_CONST");
+  writeSleb128(os, int32_t(outputSegmentOffset + end), "table end");
+  writeU8(os, opcodeI32GeU, "I32_GE_U");
+  writeU8(os, opcodeBrIf, "BR_IF");
+  writeUleb128(os, 1, "depth");
+
+  // Read the next entry.
+  writeU8(os, WASM_OPCODE_GLOBAL_GET, "GLOBAL_GET");
+  writeUleb128(os, WasmSym::memoryBase->getGlobalIndex(), "memory_base");
+  writeU8(os, WASM_OPCODE_LOCAL_GET, "LOCAL_GET");
+  writeUleb128(os, next, "local");
+  writeU8(os, WASM_OPCODE_I32_ADD, "ADD");
+  writeU8(os, opcodeI32Load, "I32_LOAD");
+  writeUleb128(os, 2, "align");
+  writeUleb128(os, startVA, "offset");
+  writeU8(os, opcodeLocalSet, "LOCAL_SET");
+  writeUleb128(os, entry, "local");
+  writeAddToLocal(os, next, 4);
+
+  writeU8(os, WASM_OPCODE_LOCAL_GET, "LOCAL_GET");
+  writeUleb128(os, entry, "local");
+  writeU8(os, WASM_OPCODE_I32_CONST, "I32_CONST");
+  writeSleb128(os, 1, "value");
+  writeU8(os, opcodeI32And, "I32_AND");
+  writeU8(os, opcodeI32Eqz, "I32_EQZ");
+  writeU8(os, WASM_OPCODE_IF, "IF");
+  writeU8(os, WASM_TYPE_NORESULT, "if type");
+  {
+    // An even entry is the offset of a relocation.
+    writeU8(os, WASM_OPCODE_LOCAL_GET, "LOCAL_GET");
+    writeUleb128(os, entry, "local");
+    writeU8(os, opcodeLocalSet, "LOCAL_SET");
+    writeUleb128(os, where, "local");
+    writeApplyRelocation(os, where, base, startVA);
+    writeAddToLocal(os, where, 4);
+  }
+  writeU8(os, WASM_OPCODE_ELSE, "ELSE");
+  {
+    // An odd entry is a bitmap of the relocations in the next 31 words.
+    writeU8(os, WASM_OPCODE_LOCAL_GET, "LOCAL_GET");
+    writeUleb128(os, where, "local");
+    writeU8(os, opcodeLocalSet, "LOCAL_SET");
+    writeUleb128(os, p, "local");
+
+    writeU8(os, opcodeBlock, "BLOCK");
+    writeU8(os, WASM_TYPE_NORESULT, "block type");
+    writeU8(os, opcodeLoop, "LOOP");
+    writeU8(os, WASM_TYPE_NORESULT, "loop type");
+
+    // Shift out the bit that was just handled (or the marker bit at first),
+    // and stop once no bits are left.
+    writeU8(os, WASM_OPCODE_LOCAL_GET, "LOCAL_GET");
+    writeUleb128(os, entry, "local");
+    writeU8(os, WASM_OPCODE_I32_CONST, "I32_CONST");
+    writeSleb128(os, 1, "value");
+    writeU8(os, opcodeI32ShrU, "I32_SHR_U");
+    writeU8(os, opcodeLocalTee, "LOCAL_TEE");
+    writeUleb128(os, entry, "local");
+    writeU8(os, opcodeI32Eqz, "I32_EQZ");
+    writeU8(os, opcodeBrIf, "BR_IF");
+    writeUleb128(os, 1, "depth");
+
+    writeU8(os, WASM_OPCODE_LOCAL_GET, "LOCAL_GET");
+    writeUleb128(os, entry, "local");
+    writeU8(os, WASM_OPCODE_I32_CONST, "I32_CONST");
+    writeSleb128(os, 1, "value");
+    writeU8(os, opcodeI32And, "I32_AND");
+    writeU8(os, WASM_OPCODE_IF, "IF");
+    writeU8(os, WASM_TYPE_NORESULT, "if type");
+    writeApplyRelocation(os, p, base, startVA);
+    writeU8(os, WASM_OPCODE_END, "END");
+
+    writeAddToLocal(os, p, 4);
+    writeU8(os, opcodeBr, "BR");
+    writeUleb128(os, 0, "depth");
+    writeU8(os, WASM_OPCODE_END, "END");
+    writeU8(os, WASM_OPCODE_END, "END");
+
+    writeAddToLocal(os, where, relrBitmapWords * 4);
+  }
+  writeU8(os, WASM_OPCODE_END, "END");
+
+  writeU8(os, opcodeBr, "BR");
+  writeUleb128(os, 0, "depth");
+  writeU8(os, WASM_OPCODE_END, "END");
+  writeU8(os, WASM_OPCODE_END, "END");
+}
+
+void RelocTableSegment::generateRelocationCode(raw_ostream &os,
+                                               uint32_t firstLocal) const {
+  LLVM_DEBUG(dbgs() << "generating runtime relocation loops: size="
+                    << contents.size() << "\n");
+  writeApplyLoop(os, 0, memoryRelocsSize, WasmSym::memoryBase, firstLocal);
+  writeApplyLoop(os, memoryRelocsSize, contents.size(), WasmSym::tableBase,
+                 firstLocal);
+}
+
+bool InputSegment::isMergeableString() const {
+  // Merged strings are laid out without padding, and must not need to be
+  // patched by relocations.
+  if (!file || getAlignment() != 0 || !relocations.empty())
+    return false;
+  ArrayRef<uint8_t> d = data();
+  if (d.empty() || d.back() != 0)
+    return false;
+
+  // Segments named .rodata.str* consist of NUL-terminated strings, like ELF
+  // SHF_MERGE|SHF_STRINGS sections.  Each .L.str string literal emitted by
+  // clang gets its own segment, but may contain embedded NULs, so it is
+  // treated as a single piece.
+  StringRef name = getName();
+  return name.startswith(".rodata.str") || name.startswith(".rodata..L.str");
+}
+
+void InputSegment::splitIntoPieces() {
+  ArrayRef<uint8_t> d = data();
+  auto addPiece = [&](size_t begin, size_t end) {
+    StringRef s = toStringRef(d.slice(begin, end - begin));
+    pieces.emplace_back(begin, xxHash64(s));
+  };
+
+  if (!getName().startswith(".rodata.str")) {
+    addPiece(0, d.size());
+    return;
+  }
+
+  for (size_t off = 0, e = d.size(); off != e;) {
+    size_t end = toStringRef(d).find('\0', off);
+    assert(end != StringRef::npos && "segment must be NUL-terminated");
+    addPiece(off, end + 1);
+    off = end + 1;
+  }
+}
+
+CachedHashStringRef InputSegment::getPieceData(size_t i) const {
+  ArrayRef<uint8_t> d = data();
+  size_t begin = pieces[i].inputOff;
+  size_t end = (i + 1 == pieces.size()) ? d.size() : pieces[i + 1].inputOff;
+  return {toStringRef(d.slice(begin, end - begin)), pieces[i].hash};
+}
+
+std::vector<std::pair<uint32_t, uint32_t>>
+InputSegment::getNonZeroRanges(uint32_t minZeroRun) const {
+  ArrayRef<uint8_t> d = data();
+
+  // No relocation writes more than 8 bytes.
+  std::vector<bool> relocated;
+  if (!relocations.empty()) {
+    relocated.resize(d.size());
+    for (const WasmRelocation &rel : relocations) {
+      uint32_t off = rel.Offset - getInputSectionOffset();
+      for (uint32_t i = off, e = std::min<uint32_t>(off + 8, d.size()); i < e;
+           ++i)
+        relocated[i] = true;
+    }
+  }
+
+  std::vector<std::pair<uint32_t, uint32_t>> ranges;
+  for (uint32_t i = 0, e = d.size(); i != e; ++i) {
+    if (d[i] == 0 && (relocated.empty() || !relocated[i]))
+      continue;
+    if (!ranges.empty() && i - ranges.back().second < minZeroRun)
+      ranges.back().second = i + 1;
+    else
+      ranges.push_back({i, i + 1});
+  }
+  return ranges;
+}
+
+uint32_t InputSegment::getOutputSegmentOffset(uint32_t offset) const {
+  if (!mergedInto)
+    return outputSegmentOffset + offset;
+
+  // Find the piece containing the offset.
+  auto it = llvm::partition_point(
+      pieces, [=](const SegmentPiece &p) { return p.inputOff <= offset; });
+  assert(it != pieces.begin());
+  const SegmentPiece &piece = *std::prev(it);
+  return mergedInto->outputSegmentOffset + piece.outputOff +
+         (offset - piece.inputOff);
+}
+
+static const WasmSegment &createSyntheticSegment(StringRef name) {
+  auto *seg = make<WasmSegment>();
+  seg->Data.Name = name;
+  seg->Data.Comdat = UINT32_MAX;
+  return *seg;
+}
+
+MergedStringSegment::MergedStringSegment(StringRef name)
+    : InputSegment(createSyntheticSegment(name), nullptr) {
+  live = true;
+}
+
+void MergedStringSegment::finalizeContents() {
+  // With -O2, also merge strings which are a suffix of another string.
+  // Tail merging needs all strings in a single table, so it is serial.
+  if (config->optimize >= 2) {
+    StringTableBuilder builder(StringTableBuilder::RAW);
+    for (InputSegment *seg : segments)
+      for (size_t i = 0, e = seg->pieces.size(); i != e; ++i)
+        builder.add(seg->getPieceData(i));
+    builder.finalize();
+
+    for (InputSegment *seg : segments)
+      for (size_t i = 0, e = seg->pieces.size(); i != e; ++i)
+        seg->pieces[i].outputOff = builder.getOffset(seg->getPieceData(i));
+
+    uint8_t *buf = bAlloc.Allocate<uint8_t>(builder.getSize());
+    builder.write(buf);
+    contents = makeArrayRef(buf, builder.getSize());
+    for (InputSegment *seg : segments)
+      seg->mergedInto = this;
+    return;
+  }
+
+  // Otherwise only deduplicate identical strings.  Strings are distributed
+  // among shards by hash, so that identical strings always end up in the same
+  // shard and the shards can be built in parallel.
+  constexpr size_t numShards = 32;
+  std::vector<StringTableBuilder> shards;
+  for (size_t i = 0; i < numShards; ++i)
+    shards.emplace_back(StringTableBuilder::RAW);
+
+  parallelForEachN(0, numShards, [&](size_t shardId) {
+    for (InputSegment *seg : segments)
+      for (size_t i = 0, e = seg->pieces.size(); i != e; ++i)
+        if (seg->pieces[i].hash % numShards == shardId)
+          seg->pieces[i].outputOff = shards[shardId].add(seg->getPieceData(i));
+  });
+
+  size_t shardOffsets[numShards];
+  size_t off = 0;
+  for (size_t i = 0; i < numShards; ++i) {
+    shards[i].finalizeInOrder();
+    shardOffsets[i] = off;
+    off += shards[i].getSize();
+  }
+
+  uint8_t *buf = bAlloc.Allocate<uint8_t>(off);
+  parallelForEachN(0, numShards, [&](size_t i) {
+    shards[i].write(buf + shardOffsets[i]);
+  });
+  contents = makeArrayRef(buf, off);
+
+  parallelForEach(segments, [&](InputSegment *seg) {
+    for (SegmentPiece &piece : seg->pieces)
+      piece.outputOff += shardOffsets[piece.hash % numShards];
+    seg->mergedInto = this;
+  });
+}
+
+void InputSection::setPrunedContents(
+    ArrayRef<uint8_t> contents,
+    std::vector<std::pair<uint32_t, uint32_t>> newShifts) {
+  prunedContents = contents;
+  shifts = std::move(newShifts);
+}
+
+uint32_t InputSection::getChunkOffset(uint32_t offset) const {
+  auto it = llvm::partition_point(
+      shifts, [=](const std::pair<uint32_t, uint32_t> &s) {
+        return s.first <= offset;
+      });
+  if (it == shifts.begin())
+    return offset;
+  return offset - std::prev(it)->second;
+}
+
 } // namespace wasm
 } // namespace lld
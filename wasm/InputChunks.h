@@ -24,6 +24,7 @@
 #include "InputFiles.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/LLVM.h"
+#include "llvm/ADT/CachedHashString.h"
 #include "llvm/Object/Wasm.h"
 
 namespace lld {
@@ -37,13 +38,17 @@ class InputChunk {
 public:
   enum Kind { DataSegment, Function, SyntheticFunction, Section };
 
-  Kind kind() const { return sectionKind; }
+  Kind kind() const { return static_cast<Kind>(sectionKind); }
 
   virtual uint32_t getSize() const { return data().size(); }
   virtual uint32_t getInputSize() const { return getSize(); };
 
   virtual void writeTo(uint8_t *sectionStart) const;
 
+  // Writes the contents and applies the relocations at buf, instead of at
+  // outputOffset in the section.
+  void writeAt(uint8_t *buf) const;
+
   ArrayRef<WasmRelocation> getRelocations() const { return relocations; }
   void setRelocations(ArrayRef<WasmRelocation> rs) { relocations = rs; }
 
@@ -68,6 +73,10 @@ public:
   unsigned discarded : 1;
 
 protected:
+  // There can be millions of chunks, so the kind shares a word with the bits
+  // above.
+  unsigned sectionKind : 2;
+
   InputChunk(ObjFile *f, Kind k)
       : file(f), live(!config->gcSections), discarded(false), sectionKind(k) {}
   virtual ~InputChunk() = default;
@@ -78,9 +87,21 @@ protected:
   void verifyRelocTargets() const;
 
   ArrayRef<WasmRelocation> relocations;
-  Kind sectionKind;
 };
 
+// A NUL-terminated string within a mergeable string segment.  InputOff is the
+// offset of the piece within its input segment, and OutputOff the offset of
+// its (possibly shared) copy within the merged segment.
+struct SegmentPiece {
+  SegmentPiece(uint32_t off, uint32_t hash) : inputOff(off), hash(hash) {}
+
+  uint32_t inputOff;
+  uint32_t hash;
+  uint32_t outputOff = 0;
+};
+
+class MergedStringSegment;
+
 // Represents a WebAssembly data segment which can be included as part of
 // an output data segments.  Note that in WebAssembly, unlike ELF and other
 // formats, used the term "data segment" to refer to the continous regions of
@@ -106,15 +127,97 @@ public:
     return segment.SectionOffset;
   }
 
+  // Returns true if this segment only contains string literals, which can be
+  // merged with identical strings from other segments.
+  bool isMergeableString() const;
+
+  // Splits a mergeable string segment into pieces.
+  void splitIntoPieces();
+
+  llvm::CachedHashStringRef getPieceData(size_t i) const;
+
+  // Returns the ranges of this segment, as (begin, end) offsets, that may be
+  // nonzero in the output: its nonzero bytes and the bytes that relocations
+  // write to.  Runs of fewer than `minZeroRun` zeros are kept in the ranges.
+  std::vector<std::pair<uint32_t, uint32_t>>
+  getNonZeroRanges(uint32_t minZeroRun) const;
+
+  // Translates an offset within this segment to an offset within its output
+  // segment.  This is not simply outputSegmentOffset + offset if the contents
+  // of this segment were merged.
+  uint32_t getOutputSegmentOffset(uint32_t offset) const;
+
   const OutputSegment *outputSeg = nullptr;
   int32_t outputSegmentOffset = 0;
 
+  // Set for mergeable string segments.  The contents of such a segment are
+  // not written directly; `mergedInto` holds a copy of each of its pieces.
+  std::vector<SegmentPiece> pieces;
+  const MergedStringSegment *mergedInto = nullptr;
+
 protected:
   ArrayRef<uint8_t> data() const override { return segment.Data.Content; }
 
   const WasmSegment &segment;
 };
 
+// A synthetic data segment holding the deduplicated contents of all the
+// mergeable string segments that are placed in the same output segment.
+// Identical strings are stored only once, and with -O2 strings that are a
+// suffix of another string share its storage (tail merging).
+class MergedStringSegment : public InputSegment {
+public:
+  explicit MergedStringSegment(StringRef name);
+
+  void addSegment(InputSegment *seg) { segments.push_back(seg); }
+
+  // Assigns an output offset to every piece of the added segments and builds
+  // the contents of this segment.
+  void finalizeContents();
+
+  ArrayRef<InputSegment *> getSegments() const { return segments; }
+
+protected:
+  ArrayRef<uint8_t> data() const override { return contents; }
+
+  std::vector<InputSegment *> segments;
+  ArrayRef<uint8_t> contents;
+};
+
+// With --pack-dyn-relocs=relr, the runtime relocations of a PIC output
+// segment that only need __memory_base or __table_base added to the value
+// already in place are not turned into code.  Instead, their locations are
+// collected in this segment, which is appended to the output segment.  The
+// encoding is SHT_RELR's, with 32-bit words: an even entry is the offset of
+// a relocation, and each odd entry after it is a bitmap of relocations at
+// the following 31 words.  __wasm_apply_relocs then walks the table in a
+// loop, which is much smaller than one instruction sequence per relocation.
+class RelocTableSegment : public InputSegment {
+public:
+  explicit RelocTableSegment(OutputSegment *seg);
+
+  // Returns true if `rel` of `seg` is applied by the table rather than by
+  // InputSegment::generateRelocationCode.
+  static bool isPacked(const InputSegment *seg, const WasmRelocation &rel);
+
+  // Writes the loops that apply the table, using four i32 locals starting
+  // at `firstLocal`.
+  void generateRelocationCode(raw_ostream &os, uint32_t firstLocal) const;
+
+  bool empty() const { return contents.empty(); }
+
+protected:
+  ArrayRef<uint8_t> data() const override { return contents; }
+
+  void writeApplyLoop(raw_ostream &os, uint32_t begin, uint32_t end,
+                      const GlobalSymbol *base, uint32_t firstLocal) const;
+
+  std::vector<uint8_t> contents;
+  // Size in bytes of the part of the table relative to __memory_base.  The
+  // rest is relative to __table_base.
+  uint32_t memoryRelocsSize = 0;
+};
+
 // Represents a single wasm function within and input file.  These are
 // combined to create the final output CODE section.
 class InputFunction : public InputChunk {
@@ -134,6 +237,10 @@ public:
   uint32_t getFunctionInputOffset() const { return getInputSectionOffset(); }
   uint32_t getFunctionCodeOffset() const { return function->CodeOffset; }
   uint32_t getSize() const override {
+    if (config->incremental && file) {
+      assert(paddedSize);
+      return paddedSize;
+    }
     if (config->compressRelocations && file) {
       assert(compressedSize);
       return compressedSize;
@@ -141,14 +248,20 @@ public:
     return data().size();
   }
   uint32_t getInputSize() const override { return function->Size; }
-  uint32_t getFunctionIndex() const { return functionIndex.getValue(); }
-  bool hasFunctionIndex() const { return functionIndex.hasValue(); }
+  uint32_t getFunctionIndex() const {
+    assert(hasFunctionIndex());
+    return functionIndex;
+  }
+  bool hasFunctionIndex() const { return functionIndex != INVALID_INDEX; }
   void setFunctionIndex(uint32_t index);
   uint32_t getInputSectionOffset() const override {
     return function->CodeSectionOffset;
   }
-  uint32_t getTableIndex() const { return tableIndex.getValue(); }
-  bool hasTableIndex() const { return tableIndex.hasValue(); }
+  uint32_t getTableIndex() const {
+    assert(hasTableIndex());
+    return tableIndex;
+  }
+  bool hasTableIndex() const { return tableIndex != INVALID_INDEX; }
   void setTableIndex(uint32_t index);
 
   // The size of a given input function can depend on the values of the
@@ -157,20 +270,41 @@ public:
   // called.
   void calculateSize();
 
+  // Returns the function body as it appears in the input file, including the
+  // leading size field.  Unlike data(), this can be called even when
+  // --compress-relocations is used.
+  ArrayRef<uint8_t> getInputContents() const {
+    return file->codeSection->Content.slice(getInputSectionOffset(),
+                                            function->Size);
+  }
+
   const WasmSignature &signature;
 
+  // Used by ICF.
+  uint32_t eqClass[2] = {0, 0};
+
+  // Set by --split-module for functions that are moved to the secondary
+  // module.  Their relocations are still scanned, but they are not part of
+  // the output.
+  bool deferred = false;
+
 protected:
   ArrayRef<uint8_t> data() const override {
     assert(!config->compressRelocations);
-    return file->codeSection->Content.slice(getInputSectionOffset(),
-                                            function->Size);
+    return getInputContents();
   }
 
+  // The fields are ordered to avoid padding, since there is one of these per
+  // function.
   const WasmFunction *function;
-  llvm::Optional<uint32_t> functionIndex;
-  llvm::Optional<uint32_t> tableIndex;
+  // With --compress-relocations, the values of the relocations as computed
+  // by calculateSize.
+  std::unique_ptr<uint32_t[]> relocValues;
+  uint32_t functionIndex = INVALID_INDEX;
+  uint32_t tableIndex = INVALID_INDEX;
   uint32_t compressedFuncSize = 0;
   uint32_t compressedSize = 0;
+  uint32_t paddedSize = 0;
 };
 
 class SyntheticFunction : public InputFunction {
@@ -211,18 +345,48 @@ public:
   StringRef getDebugName() const override { return StringRef(); }
   uint32_t getComdat() const override { return UINT32_MAX; }
 
+  ArrayRef<uint8_t> getInputContents() const { return section.Content; }
+
+  // Replaces the contents of this section with a copy from which some byte
+  // ranges were removed.  `shifts` holds, for the end of each removed range,
+  // the number of bytes removed up to that point.
+  void setPrunedContents(ArrayRef<uint8_t> contents,
+                         std::vector<std::pair<uint32_t, uint32_t>> shifts);
+
+  // Translates an offset within the input section to an offset within the
+  // contents of this chunk.
+  uint32_t getChunkOffset(uint32_t offset) const;
+
   OutputSection *outputSec = nullptr;
 
 protected:
-  ArrayRef<uint8_t> data() const override { return section.Content; }
+  ArrayRef<uint8_t> data() const override {
+    return prunedContents ? *prunedContents : section.Content;
+  }
 
   // Offset within the input section.  This is only zero since this chunk
   // type represents an entire input section, not part of one.
   uint32_t getInputSectionOffset() const override { return 0; }
 
   const WasmSection &section;
+  llvm::Optional<ArrayRef<uint8_t>> prunedContents;
+  std::vector<std::pair<uint32_t, uint32_t>> shifts;
 };
 
+// With --incremental each function body is padded with trailing nops so that
+// a later link can rewrite it in place.  Returns the padded size, including
+// the size field, of a function whose body is `bodySize` bytes.
+uint32_t getPaddedFunctionSize(uint32_t bodySize);
+
+// Writes a function padded to `paddedSize` bytes to `buf`.  `input` is the
+// function as it appears in its input code section at `inputSectionOffset`,
+// including the size field.  Relocations are applied using the values
+// returned by `calcValue`.
+void writePaddedFunction(
+    uint8_t *buf, uint32_t paddedSize, ArrayRef<uint8_t> input,
+    uint32_t inputSectionOffset, ArrayRef<WasmRelocation> relocs,
+    llvm::function_ref<uint32_t(const WasmRelocation &)> calcValue);
+
 } // namespace wasm
 
 std::string toString(const wasm::InputChunk *);
@@ -11,14 +11,21 @@
 #include "InputChunks.h"
 #include "InputEvent.h"
 #include "InputGlobal.h"
+#include "Stats.h"
 #include "SymbolTable.h"
+#include "lld/Common/Driver.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/InputLoader.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Reproduce.h"
+#include "lld/Common/Threads.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Object/Wasm.h"
-#include "llvm/Support/TarWriter.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <map>
+#include <mutex>
 
 #define DEBUG_TYPE "lld"
 
@@ -40,19 +47,144 @@ std::string toString(const wasm::InputFile *file) {
 }
 
 namespace wasm {
-std::unique_ptr<llvm::TarWriter> tar;
+std::unique_ptr<AsyncTarWriter> tar;
+
+namespace {
+// An input file kept open for later links by config->reuseInputs.
+struct CachedFile {
+  std::unique_ptr<MemoryBuffer> mb;
+  sys::TimePoint<> modTime;
+  uint64_t hash;
+};
+} // namespace
+
+static StringMap<CachedFile> fileCache;
+
+// The buffers of the cached files, by their start and end.  Only objects that
+// lie in one of these may be cached, since the others go away with the arena.
+static std::map<const char *, const char *> cachedRanges;
+
+// The objects decoded from the cached files, by the start of their buffer.
+// Objects are decoded on several threads at once.
+static std::mutex decodedCacheMutex;
+static DenseMap<const char *, std::shared_ptr<WasmObjectFile>> decodedCache;
+
+static bool isInCachedFile(MemoryBufferRef mb) {
+  auto it = cachedRanges.upper_bound(mb.getBufferStart());
+  if (it == cachedRanges.begin())
+    return false;
+  --it;
+  return mb.getBufferEnd() <= it->second;
+}
 
-Optional<MemoryBufferRef> readFile(StringRef path) {
-  log("Loading: " + path);
+static std::shared_ptr<WasmObjectFile> getDecoded(MemoryBufferRef mb) {
+  if (!config->reuseInputs)
+    return nullptr;
+  std::lock_guard<std::mutex> lock(decodedCacheMutex);
+  return decodedCache.lookup(mb.getBufferStart());
+}
+
+static void addDecoded(MemoryBufferRef mb,
+                       std::shared_ptr<WasmObjectFile> obj) {
+  if (!config->reuseInputs || !isInCachedFile(mb))
+    return;
+  std::lock_guard<std::mutex> lock(decodedCacheMutex);
+  decodedCache.try_emplace(mb.getBufferStart(), std::move(obj));
+}
+
+static void forgetFile(const MemoryBuffer &mb) {
+  std::vector<const char *> keys;
+  for (auto &p : decodedCache)
+    if (p.first >= mb.getBufferStart() && p.first < mb.getBufferEnd())
+      keys.push_back(p.first);
+  for (const char *key : keys)
+    decodedCache.erase(key);
+  cachedRanges.erase(mb.getBufferStart());
+}
 
-  auto mbOrErr = MemoryBuffer::getFile(path);
+void clearInputCache() {
+  decodedCache.clear();
+  cachedRanges.clear();
+  fileCache.clear();
+}
+
+// Returns the cached contents of `path` if it is unchanged since it was
+// cached.  The modification time is checked first, then the hash of the
+// contents, so that a file rewritten with the same contents keeps its cached
+// objects.
+static Optional<MemoryBufferRef> readCachedFile(StringRef path) {
+  sys::fs::file_status st;
+  bool hasStatus = !sys::fs::status(path, st);
+  sys::TimePoint<> modTime =
+      hasStatus ? st.getLastModificationTime() : sys::TimePoint<>();
+  auto it = fileCache.find(path);
+  if (it != fileCache.end() && hasStatus && it->second.modTime == modTime &&
+      it->second.mb->getBufferSize() == st.getSize())
+    return it->second.mb->getMemBufferRef();
+
+  // The file is read rather than mapped, since a build may rewrite it in
+  // place while it is cached.
+  auto mbOrErr = MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                       /*RequiresNullTerminator=*/false,
+                                       /*IsVolatile=*/true);
   if (auto ec = mbOrErr.getError()) {
     error("cannot open " + path + ": " + ec.message());
     return None;
   }
   std::unique_ptr<MemoryBuffer> &mb = *mbOrErr;
-  MemoryBufferRef mbref = mb->getMemBufferRef();
-  make<std::unique_ptr<MemoryBuffer>>(std::move(mb)); // take MB ownership
+  uint64_t hash = xxHash64(mb->getBuffer());
+
+  if (it != fileCache.end()) {
+    CachedFile &cached = it->second;
+    if (cached.hash == hash &&
+        cached.mb->getBufferSize() == mb->getBufferSize()) {
+      cached.modTime = modTime;
+      return cached.mb->getMemBufferRef();
+    }
+    forgetFile(*cached.mb);
+  }
+
+  CachedFile &cached = fileCache[path];
+  cached.mb = std::move(mb);
+  cached.modTime = modTime;
+  cached.hash = hash;
+  cachedRanges[cached.mb->getBufferStart()] = cached.mb->getBufferEnd();
+  return cached.mb->getMemBufferRef();
+}
+
+Optional<MemoryBufferRef> readFile(StringRef path) {
+  log("Loading: " + path);
+
+  // Buffers given in memory are owned by the caller and never cached, since
+  // they may be reused for something else after the link.
+  auto it = config->memoryInputs.find(path);
+  if (it != config->memoryInputs.end()) {
+    stats.inputBytes += it->second.getBufferSize();
+    if (tar)
+      tar->append(relativeToRoot(path), it->second.getBuffer());
+    return it->second;
+  }
+
+  MemoryBufferRef mbref;
+  if (config->reuseInputs) {
+    Optional<MemoryBufferRef> cached = readCachedFile(path);
+    if (!cached)
+      return None;
+    mbref = *cached;
+  } else {
+    Optional<ErrorOr<std::unique_ptr<MemoryBuffer>>> preloaded =
+        takePreloadedInput(path);
+    auto mbOrErr =
+        preloaded ? std::move(*preloaded) : MemoryBuffer::getFile(path);
+    if (auto ec = mbOrErr.getError()) {
+      error("cannot open " + path + ": " + ec.message());
+      return None;
+    }
+    std::unique_ptr<MemoryBuffer> &mb = *mbOrErr;
+    mbref = mb->getMemBufferRef();
+    make<std::unique_ptr<MemoryBuffer>>(std::move(mb)); // take MB ownership
+  }
+  stats.inputBytes += mbref.getBufferSize();
 
   if (tar)
     tar->append(relativeToRoot(path), mbref.getBuffer());
@@ -63,6 +195,9 @@ InputFile *createObjectFile(MemoryBufferRef mb,
                                        StringRef archiveName) {
   file_magic magic = identify_magic(mb.getBuffer());
   if (magic == file_magic::wasm_object) {
+    // Only relocatable objects are cached.
+    if (getDecoded(mb))
+      return make<ObjFile>(mb, archiveName);
     std::unique_ptr<Binary> bin =
         CHECK(createBinary(mb), mb.getBufferIdentifier());
     auto *obj = cast<WasmObjectFile>(bin.get());
@@ -109,8 +244,10 @@ uint32_t ObjFile::calcNewAddend(const WasmRelocation &reloc) const {
   case R_WASM_MEMORY_ADDR_I32:
   case R_WASM_FUNCTION_OFFSET_I32:
     return reloc.Addend;
-  case R_WASM_SECTION_OFFSET_I32:
-    return getSectionSymbol(reloc.Index)->section->outputOffset + reloc.Addend;
+  case R_WASM_SECTION_OFFSET_I32: {
+    const InputSection *section = getSectionSymbol(reloc.Index)->section;
+    return section->outputOffset + section->getChunkOffset(reloc.Addend);
+  }
   default:
     llvm_unreachable("unexpected relocation type");
   }
@@ -207,13 +344,31 @@ uint32_t ObjFile::calcNewValue(const WasmRelocation &reloc) const {
     return f->function->outputOffset + f->function->getFunctionCodeOffset() +
            reloc.Addend;
   }
-  case R_WASM_SECTION_OFFSET_I32:
-    return getSectionSymbol(reloc.Index)->section->outputOffset + reloc.Addend;
+  case R_WASM_SECTION_OFFSET_I32: {
+    const InputSection *section = getSectionSymbol(reloc.Index)->section;
+    return section->outputOffset + section->getChunkOffset(reloc.Addend);
+  }
   default:
     llvm_unreachable("unknown relocation type");
   }
 }
 
+void ObjFile::computeRelocIndices() {
+  functionIndices.assign(symbols.size(), UINT32_MAX);
+  globalIndices.assign(symbols.size(), UINT32_MAX);
+  for (size_t i = 0, e = symbols.size(); i != e; ++i) {
+    if (auto *f = dyn_cast_or_null<FunctionSymbol>(symbols[i])) {
+      if (!f->isLive())
+        functionIndices[i] = 0;
+      else if (f->hasFunctionIndex())
+        functionIndices[i] = f->getFunctionIndex();
+    } else if (auto *g = dyn_cast_or_null<GlobalSymbol>(symbols[i])) {
+      if (g->hasGlobalIndex())
+        globalIndices[i] = g->getGlobalIndex();
+    }
+  }
+}
+
 template <class T>
 static void setRelocs(const std::vector<T *> &chunks,
                       const WasmSection *section) {
@@ -245,11 +400,18 @@ static void setRelocs(const std::vector<T *> &chunks,
   }
 }
 
-void ObjFile::parse(bool ignoreComdats) {
+void ObjFile::decode() {
   // Parse a memory buffer as a wasm file.
-  LLVM_DEBUG(dbgs() << "Parsing object: " << toString(this) << "\n");
-  std::unique_ptr<Binary> bin = CHECK(createBinary(mb), toString(this));
+  LLVM_DEBUG(dbgs() << "Decoding object: " << toString(this) << "\n");
+  if (std::shared_ptr<WasmObjectFile> obj = getDecoded(mb)) {
+    wasmObj = std::move(obj);
+    scanObject();
+    return;
+  }
+  decode(CHECK(createBinary(mb), toString(this)));
+}
 
+void ObjFile::decode(std::unique_ptr<Binary> bin) {
   auto *obj = dyn_cast<WasmObjectFile>(bin.get());
   if (!obj)
     fatal(toString(this) + ": not a wasm file");
@@ -258,7 +420,11 @@ void ObjFile::parse(bool ignoreComdats) {
 
   bin.release();
   wasmObj.reset(obj);
+  addDecoded(mb, wasmObj);
+  scanObject();
+}
 
+void ObjFile::scanObject() {
   // Build up a map of function indices to table indices for use when
   // verifying the existing table index relocations
   uint32_t totalFunctions =
@@ -275,15 +441,13 @@ void ObjFile::parse(bool ignoreComdats) {
     }
   }
 
-  uint32_t sectionIndex = 0;
-
   // Bool for each symbol, true if called directly.  This allows us to implement
   // a weaker form of signature checking where undefined functions that are not
   // called directly (i.e. only address taken) don't have to match the defined
   // function's signature.  We cannot do this for directly called functions
   // because those signatures are checked at validation times.
   // See https://bugs.llvm.org/show_bug.cgi?id=40412
-  std::vector<bool> isCalledDirectly(wasmObj->getNumberOfSymbols(), false);
+  isCalledDirectly.assign(wasmObj->getNumberOfSymbols(), false);
   for (const SectionRef &sec : wasmObj->sections()) {
     const WasmSection &section = wasmObj->getWasmSection(sec);
     // Wasm objects can have at most one code and one data section.
@@ -293,17 +457,42 @@ void ObjFile::parse(bool ignoreComdats) {
     } else if (section.Type == WASM_SEC_DATA) {
       assert(!dataSection);
       dataSection = &section;
-    } else if (section.Type == WASM_SEC_CUSTOM) {
-      customSections.emplace_back(make<InputSection>(section, this));
-      customSections.back()->setRelocations(section.Relocations);
-      customSectionsByIndex[sectionIndex] = customSections.back();
     }
-    sectionIndex++;
-    // Scans relocations to dermine determine if a function symbol is called
-    // directly
-    for (const WasmRelocation &reloc : section.Relocations)
+  }
+
+  // Scans relocations to determine if a function symbol is called directly.
+  // Calls only appear in the code section, so the relocations of the data and
+  // custom sections, which for objects built with -g are usually most of them,
+  // don't need to be looked at.
+  if (codeSection)
+    for (const WasmRelocation &reloc : codeSection->Relocations)
       if (reloc.Type == R_WASM_FUNCTION_INDEX_LEB)
         isCalledDirectly[reloc.Index] = true;
+}
+
+void ObjFile::parse(bool ignoreComdats) {
+  // Files added to the symbol table directly have already been decoded by the
+  // driver, but archive members and LTO output have not.
+  if (!wasmObj)
+    decode();
+  LLVM_DEBUG(dbgs() << "Parsing object: " << toString(this) << "\n");
+
+  bool stripDebug = config->stripDebug || config->stripAll;
+  uint32_t sectionIndex = 0;
+  for (const SectionRef &sec : wasmObj->sections()) {
+    const WasmSection &section = wasmObj->getWasmSection(sec);
+    if (section.Type == WASM_SEC_CUSTOM) {
+      auto *customSec = make<InputSection>(section, this);
+      // Debug sections that are going to be stripped are never written, so
+      // there is no point in scanning or applying their relocations.
+      if (stripDebug && customSec->getName().startswith(".debug_"))
+        customSec->discarded = true;
+      else
+        customSec->setRelocations(section.Relocations);
+      customSections.emplace_back(customSec);
+      customSectionsByIndex[sectionIndex] = customSec;
+    }
+    sectionIndex++;
   }
 
   typeMap.resize(getWasmObj()->types().size());
@@ -471,6 +660,9 @@ void ArchiveFile::parse() {
   LLVM_DEBUG(dbgs() << "Parsing library: " << toString(this) << "\n");
   file = CHECK(Archive::create(mb), toString(this));
 
+  if (threadsEnabled)
+    prefetchMembers();
+
   // Read the symbol table to construct Lazy symbols.
   int count = 0;
   for (const Archive::Symbol &sym : file->symbols()) {
@@ -480,6 +672,75 @@ void ArchiveFile::parse() {
   LLVM_DEBUG(dbgs() << "Read " << count << " symbols\n");
 }
 
+// Members that define a symbol which is already undefined are going to be
+// loaded as soon as parse() adds their lazy symbols, so decode them on worker
+// threads up front.  Only the decoding moves; addMember still adds members to
+// the symbol table one at a time in the usual order, so the output is the
+// same.  Anything that fails to decode here is left for addMember to report.
+void ArchiveFile::prefetchMembers() {
+  std::vector<MemoryBufferRef> members;
+  std::vector<uint64_t> offsets;
+  DenseSet<uint64_t> wanted;
+  for (const Archive::Symbol &sym : file->symbols()) {
+    Symbol *s = symtab->find(sym.getName());
+    if (!s || !s->isUndefined() || s->isWeak())
+      continue;
+
+    Expected<Archive::Child> c = sym.getMember();
+    if (!c) {
+      consumeError(c.takeError());
+      continue;
+    }
+    if (!wanted.insert(c->getChildOffset()).second)
+      continue;
+    Expected<MemoryBufferRef> mbOrErr = c->getMemoryBufferRef();
+    if (!mbOrErr) {
+      consumeError(mbOrErr.takeError());
+      continue;
+    }
+    if (identify_magic(mbOrErr->getBuffer()) != file_magic::wasm_object)
+      continue;
+    members.push_back(*mbOrErr);
+    offsets.push_back(c->getChildOffset());
+  }
+  if (members.size() < 2)
+    return;
+
+  LLVM_DEBUG(dbgs() << "Prefetching " << members.size()
+                    << " members of: " << toString(this) << "\n");
+
+  // Members decoded by an earlier link are left for decode() to pick up.
+  std::vector<std::unique_ptr<Binary>> bins(members.size());
+  parallelForEachN(0, members.size(), [&](size_t i) {
+    if (getDecoded(members[i]))
+      return;
+    Expected<std::unique_ptr<Binary>> binOrErr = createBinary(members[i]);
+    if (binOrErr)
+      bins[i] = std::move(*binOrErr);
+    else
+      consumeError(binOrErr.takeError());
+  });
+
+  // Allocating the files uses the arena, which is not thread-safe.
+  std::vector<ObjFile *> objs(members.size());
+  for (size_t i = 0; i < members.size(); ++i) {
+    auto *obj = dyn_cast_or_null<WasmObjectFile>(bins[i].get());
+    if (!obj && !getDecoded(members[i]))
+      continue;
+    if (obj && (!obj->isRelocatableObject() || obj->isSharedObject()))
+      continue;
+    objs[i] = make<ObjFile>(members[i], getName());
+    prefetched[offsets[i]] = objs[i];
+  }
+
+  parallelForEachN(0, members.size(), [&](size_t i) {
+    if (objs[i] && bins[i])
+      objs[i]->decode(std::move(bins[i]));
+    else if (objs[i])
+      objs[i]->decode();
+  });
+}
+
 void ArchiveFile::addMember(const Archive::Symbol *sym) {
   const Archive::Child &c =
       CHECK(sym->getMember(),
@@ -493,6 +754,12 @@ void ArchiveFile::addMember(const Archive::Symbol *sym) {
   LLVM_DEBUG(dbgs() << "loading lazy: " << sym->getName() << "\n");
   LLVM_DEBUG(dbgs() << "from archive: " << toString(this) << "\n");
 
+  auto it = prefetched.find(c.getChildOffset());
+  if (it != prefetched.end()) {
+    symtab->addFile(it->second);
+    return;
+  }
+
   MemoryBufferRef mb =
       CHECK(c.getMemoryBufferRef(),
             "could not get the buffer for the member defining symbol " +
@@ -537,9 +804,18 @@ static Symbol *createBitcodeSymbol(const std::vector<bool> &keptComdats,
   return symtab->addDefinedData(name, flags, &f, nullptr, 0, 0);
 }
 
+void BitcodeFile::decode() {
+  std::string path = mb.getBufferIdentifier().str();
+  if (config->thinLTOIndexOnly)
+    path = replaceThinLTOSuffix(mb.getBufferIdentifier());
+  ltoName = archiveName + path;
+  obj = check(lto::InputFile::create(MemoryBufferRef(mb.getBuffer(), ltoName)));
+}
+
 void BitcodeFile::parse() {
-  obj = check(lto::InputFile::create(MemoryBufferRef(
-      mb.getBuffer(), saver.save(archiveName + mb.getBufferIdentifier()))));
+  // Archive members were not decoded ahead of time.
+  if (!obj)
+    decode();
   Triple t(obj->getTargetTriple());
   if (t.getArch() != Triple::wasm32) {
     error(toString(mb.getBufferIdentifier()) + ": machine type must be wasm32");
@@ -553,5 +829,14 @@ void BitcodeFile::parse() {
     symbols.push_back(createBitcodeSymbol(keptComdats, objSym, *this));
 }
 
+std::string replaceThinLTOSuffix(StringRef path) {
+  StringRef suffix = config->thinLTOObjectSuffixReplace.first;
+  StringRef repl = config->thinLTOObjectSuffixReplace.second;
+
+  if (path.consume_back(suffix))
+    return (path + repl).str();
+  return path;
+}
+
 } // namespace wasm
 } // namespace lld
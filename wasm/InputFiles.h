@@ -19,11 +19,9 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include <vector>
 
-namespace llvm {
-class TarWriter;
-}
-
 namespace lld {
+class AsyncTarWriter;
+
 namespace wasm {
 
 class InputChunk;
@@ -35,7 +33,7 @@ class InputSection;
 
 // If --reproduce option is given, all input files are written
 // to this tar archive.
-extern std::unique_ptr<llvm::TarWriter> tar;
+extern std::unique_ptr<AsyncTarWriter> tar;
 
 class InputFile {
 public:
@@ -53,6 +51,8 @@ public:
 
   Kind kind() const { return fileKind; }
 
+  MemoryBufferRef getBuffer() const { return mb; }
+
   // An archive file name if this file is created from an archive.
   std::string archiveName;
 
@@ -82,8 +82,14 @@ public:
   void parse();
 
 private:
+  void prefetchMembers();
+
   std::unique_ptr<llvm::object::Archive> file;
   llvm::DenseSet<uint64_t> seen;
+
+  // Members decoded ahead of time by prefetchMembers, keyed by their offset
+  // in the archive.
+  llvm::DenseMap<uint64_t, InputFile *> prefetched;
 };
 
 // .o file (wasm object file)
@@ -95,6 +101,12 @@ public:
   }
   static bool classof(const InputFile *f) { return f->kind() == ObjectKind; }
 
+  // Decodes the underlying wasm object, or reuses the one decoded by an
+  // earlier link if the input is cached.  This neither allocates from the
+  // arena nor touches the symbol table, so it may run on many files in
+  // parallel.  Called by parse() if it hasn't already been done.
+  void decode();
+  void decode(std::unique_ptr<llvm::object::Binary> bin);
   void parse(bool ignoreComdats = false);
 
   // Returns the underlying wasm file.
@@ -110,11 +122,32 @@ public:
     return symbols[reloc.Index];
   };
 
+  // Fills the tables that lookupIndex() uses. This must be called once all
+  // output indices have been assigned.
+  void computeRelocIndices();
+
+  // Returns what calcNewValue() returns for a function or global index
+  // relocation, which are most of the relocations of code sections, from
+  // tables indexed by symbol, or UINT32_MAX if calcNewValue() has to be
+  // used.
+  uint32_t lookupIndex(const WasmRelocation &reloc) const {
+    if (reloc.Type == llvm::wasm::R_WASM_FUNCTION_INDEX_LEB &&
+        reloc.Index < functionIndices.size())
+      return functionIndices[reloc.Index];
+    if (reloc.Type == llvm::wasm::R_WASM_GLOBAL_INDEX_LEB &&
+        reloc.Index < globalIndices.size())
+      return globalIndices[reloc.Index];
+    return UINT32_MAX;
+  }
+
   const WasmSection *codeSection = nullptr;
   const WasmSection *dataSection = nullptr;
 
   // Maps input type indices to output type indices
   std::vector<uint32_t> typeMap;
+  // Map symbol indices to output function and global indices
+  std::vector<uint32_t> functionIndices;
+  std::vector<uint32_t> globalIndices;
   std::vector<bool> typeIsUsed;
   // Maps function indices to table indices
   std::vector<uint32_t> tableEntries;
@@ -138,8 +171,13 @@ private:
   Symbol *createUndefined(const WasmSymbol &sym, bool isCalledDirectly);
 
   bool isExcludedByComdat(InputChunk *chunk) const;
+  void scanObject();
 
-  std::unique_ptr<WasmObjectFile> wasmObj;
+  // Shared with the input cache, which may keep it for later links.
+  std::shared_ptr<WasmObjectFile> wasmObj;
+
+  // True for each symbol that is the target of a direct call.
+  std::vector<bool> isCalledDirectly;
 };
 
 // .so file.
@@ -159,14 +197,26 @@ public:
   static bool classof(const InputFile *f) { return f->kind() == BitcodeKind; }
 
   void parse();
+
+  // Reads the symbol table of the module, which is the expensive part of
+  // adding a bitcode file. Unlike parse(), this may be called in parallel.
+  void decode();
+
   std::unique_ptr<llvm::lto::InputFile> obj;
+
+private:
+  // The unique name that LTO knows this file by.
+  std::string ltoName;
 };
 
 // Will report a fatal() error if the input buffer is not a valid bitcode
 // or wasm object file.
 InputFile *createObjectFile(MemoryBufferRef mb, StringRef archiveName = "");
 
-// Opens a given file.
+std::string replaceThinLTOSuffix(StringRef path);
+
+// Opens a given file.  If config->reuseInputs is set, the file is kept open
+// for later links and reused by them for as long as it doesn't change.
 llvm::Optional<MemoryBufferRef> readFile(StringRef path);
 
 } // namespace wasm
@@ -0,0 +1,217 @@
+//===- MapFile.cpp --------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the -Map option. It shows lists in order and
+// hierarchically the output sections, output segments, input chunks and
+// symbols:
+//
+//     Addr      Off     Size Out     In      Symbol
+//        -        8        a TYPE
+//        -       51       33 CODE
+//        -       54        e         test.o:(foo)
+//        -       54        e                 foo
+//      400       8a       1c DATA
+//      400       90       10         .rodata
+//      400       90       10                 test.o:(.rodata.str)
+//      400       90        6                         str
+//
+// Addr is the address in linear memory, and Off is the offset in the output
+// file. Both are in hexadecimal.
+//
+//===----------------------------------------------------------------------===//
+
+#include "MapFile.h"
+#include "Config.h"
+#include "InputChunks.h"
+#include "InputFiles.h"
+#include "OutputSections.h"
+#include "OutputSegment.h"
+#include "SymbolTable.h"
+#include "Symbols.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Strings.h"
+#include "lld/Common/Threads.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace llvm::wasm;
+
+namespace lld {
+namespace wasm {
+using SymbolMapTy = DenseMap<const InputChunk *, SmallVector<Symbol *, 4>>;
+
+static constexpr char indent8[] = "        ";          // 8 spaces
+static constexpr char indent16[] = "                "; // 16 spaces
+static constexpr char indent24[] = "                        "; // 24 spaces
+
+// Print out the first three columns of a line. Wasm has no linear memory
+// address for anything other than data, in which case "-" is printed.
+static void writeHeader(raw_ostream &os, int64_t addr, int64_t off,
+                        uint64_t size) {
+  if (addr < 0)
+    os << "       - ";
+  else
+    os << format("%8llx ", addr);
+  if (off < 0)
+    os << "       - ";
+  else
+    os << format("%8llx ", off);
+  os << format("%8llx ", size);
+}
+
+// Returns the file offset of the start of the given section's body.
+static int64_t getBodyOffset(const OutputSection *sec) {
+  return sec->getOffset() + sec->header.size();
+}
+
+// Returns a list of all live defined function and data symbols, in the order
+// of the input files that define them.
+static std::vector<Symbol *> getSymbols() {
+  std::vector<Symbol *> v;
+  for (ObjFile *file : symtab->objectFiles) {
+    for (Symbol *sym : file->getSymbols()) {
+      if (sym->getFile() != file || !sym->isLive())
+        continue;
+      if (auto *f = dyn_cast<DefinedFunction>(sym))
+        if (f->function)
+          v.push_back(f);
+      if (auto *d = dyn_cast<DefinedData>(sym))
+        if (d->segment)
+          v.push_back(d);
+    }
+  }
+  return v;
+}
+
+static const InputChunk *getChunk(const Symbol *sym) {
+  if (auto *f = dyn_cast<DefinedFunction>(sym))
+    return f->function;
+  // Symbols in merged string segments are listed under the merged segment.
+  const InputSegment *seg = cast<DefinedData>(sym)->segment;
+  if (seg->mergedInto)
+    return seg->mergedInto;
+  return seg;
+}
+
+// Returns a map from input chunks to their symbols.
+static SymbolMapTy getChunkSyms(ArrayRef<Symbol *> syms) {
+  SymbolMapTy ret;
+  for (Symbol *sym : syms)
+    ret[getChunk(sym)].push_back(sym);
+
+  // Sort data symbols by address. We want to print out symbols in the
+  // order in the output file rather than the order they appeared in the
+  // input files.
+  for (auto &it : ret)
+    llvm::stable_sort(it.second, [](Symbol *a, Symbol *b) {
+      auto *da = dyn_cast<DefinedData>(a);
+      auto *db = dyn_cast<DefinedData>(b);
+      return da && db && da->getVirtualAddress() < db->getVirtualAddress();
+    });
+  return ret;
+}
+
+// Construct a map from symbols to their stringified representations.
+// Demangling symbols (which is what toString() does) is slow, so
+// we do that in batch using parallel-for.
+static DenseMap<Symbol *, std::string>
+getSymbolStrings(ArrayRef<Symbol *> syms, int64_t codeOffset,
+                 int64_t dataOffset) {
+  std::vector<std::string> str(syms.size());
+  parallelForEachN(0, syms.size(), [&](size_t i) {
+    raw_string_ostream os(str[i]);
+    if (auto *f = dyn_cast<DefinedFunction>(syms[i])) {
+      InputFunction *func = f->function;
+      writeHeader(os, -1, codeOffset + func->outputOffset, func->getSize());
+      os << indent16 << toString(*f);
+      return;
+    }
+    auto *d = cast<DefinedData>(syms[i]);
+    const OutputSegment *seg = d->segment->outputSeg;
+    int64_t off = -1;
+    if (!seg->isBss)
+      off = dataOffset + seg->sectionOffset + seg->header.size() +
+            d->getOutputSegmentOffset();
+    writeHeader(os, d->getVirtualAddress(), off, d->getSize());
+    os << indent24 << toString(*d);
+  });
+
+  DenseMap<Symbol *, std::string> ret;
+  for (size_t i = 0, e = syms.size(); i < e; ++i)
+    ret[syms[i]] = std::move(str[i]);
+  return ret;
+}
+
+void writeMapFile(ArrayRef<OutputSection *> outputSections) {
+  if (config->mapFile.empty())
+    return;
+
+  // Open a map file for writing.
+  std::error_code ec;
+  raw_fd_ostream os(config->mapFile, ec, sys::fs::OF_None);
+  if (ec) {
+    error("cannot open " + config->mapFile + ": " + ec.message());
+    return;
+  }
+
+  int64_t codeOffset = 0;
+  int64_t dataOffset = 0;
+  for (const OutputSection *sec : outputSections) {
+    if (sec->type == WASM_SEC_CODE)
+      codeOffset = getBodyOffset(sec);
+    else if (sec->type == WASM_SEC_DATA)
+      dataOffset = getBodyOffset(sec);
+  }
+
+  // Collect symbol info that we want to print out.
+  std::vector<Symbol *> syms = getSymbols();
+  SymbolMapTy chunkSyms = getChunkSyms(syms);
+  DenseMap<Symbol *, std::string> symStr =
+      getSymbolStrings(syms, codeOffset, dataOffset);
+
+  // Print out the header line.
+  os << "    Addr      Off     Size Out     In      Symbol\n";
+
+  for (const OutputSection *sec : outputSections) {
+    writeHeader(os, -1, sec->getOffset(), sec->getSize());
+    os << toString(*sec) << '\n';
+
+    if (auto *code = dyn_cast<CodeSection>(sec)) {
+      for (const InputFunction *func : code->getFunctions()) {
+        writeHeader(os, -1, codeOffset + func->outputOffset, func->getSize());
+        os << indent8 << toString(func) << '\n';
+        for (Symbol *sym : chunkSyms[func])
+          os << symStr[sym] << '\n';
+      }
+      continue;
+    }
+
+    if (auto *data = dyn_cast<DataSection>(sec)) {
+      for (const OutputSegment *seg : data->getSegments()) {
+        int64_t segOff =
+            seg->isBss ? -1
+                       : dataOffset + seg->sectionOffset + seg->header.size();
+        writeHeader(os, seg->startVA, segOff, seg->size);
+        os << indent8 << seg->name << '\n';
+        for (const InputSegment *inSeg : seg->inputSegments) {
+          int64_t off = seg->isBss ? -1 : dataOffset + inSeg->outputOffset;
+          writeHeader(os, seg->startVA + inSeg->outputSegmentOffset, off,
+                      inSeg->getSize());
+          os << indent16 << toString(inSeg) << '\n';
+          for (Symbol *sym : chunkSyms[inSeg])
+            os << symStr[sym] << '\n';
+        }
+      }
+    }
+  }
+}
+
+} // namespace wasm
+} // namespace lld
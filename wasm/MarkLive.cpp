@@ -25,6 +25,8 @@
 #include "InputGlobal.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
+#include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
 
 #define DEBUG_TYPE "lld"
 
@@ -34,6 +36,8 @@ using namespace llvm::wasm;
 namespace lld {
 namespace wasm {
 
+static Timer gcTimer("GC", Timer::root());
+
 namespace {
 
 class MarkLive {
@@ -44,6 +48,7 @@ private:
   void enqueue(Symbol *sym);
   void markSymbol(Symbol *sym);
   void mark();
+  void markParallel();
 
   // A list of chunks to visit.
   SmallVector<InputChunk *, 256> queue;
@@ -101,35 +106,68 @@ void MarkLive::run() {
   if (config->sharedMemory && !config->shared)
     enqueue(WasmSym::initMemory);
 
-  mark();
+  if (threadsEnabled)
+    markParallel();
+  else
+    mark();
+}
+
+// Returns the symbol that a relocation makes live, if any.
+static Symbol *getRelocTarget(const InputChunk *c,
+                              const WasmRelocation &reloc) {
+  if (reloc.Type == R_WASM_TYPE_INDEX_LEB)
+    return nullptr;
+  Symbol *sym = c->file->getSymbol(reloc.Index);
+
+  // If the function has been assigned the special index zero in the table,
+  // the relocation doesn't pull in the function body, since the function
+  // won't actually go in the table (the runtime will trap attempts to call
+  // that index, since we don't use it).  A function with a table index of
+  // zero is only reachable via "call", not via "call_indirect".  The stub
+  // functions used for weak-undefined symbols have this behaviour (compare
+  // equal to null pointer, only reachable via direct call).
+  if (reloc.Type == R_WASM_TABLE_INDEX_SLEB ||
+      reloc.Type == R_WASM_TABLE_INDEX_I32) {
+    auto *funcSym = cast<FunctionSymbol>(sym);
+    if (funcSym->hasTableIndex() && funcSym->getTableIndex() == 0)
+      return nullptr;
+  }
+  return sym;
 }
 
 void MarkLive::mark() {
   // Follow relocations to mark all reachable chunks.
   while (!queue.empty()) {
     InputChunk *c = queue.pop_back_val();
+    for (const WasmRelocation reloc : c->getRelocations())
+      enqueue(getRelocTarget(c, reloc));
+  }
+}
 
-    for (const WasmRelocation reloc : c->getRelocations()) {
-      if (reloc.Type == R_WASM_TYPE_INDEX_LEB)
-        continue;
-      Symbol *sym = c->file->getSymbol(reloc.Index);
-
-      // If the function has been assigned the special index zero in the table,
-      // the relocation doesn't pull in the function body, since the function
-      // won't actually go in the table (the runtime will trap attempts to call
-      // that index, since we don't use it).  A function with a table index of
-      // zero is only reachable via "call", not via "call_indirect".  The stub
-      // functions used for weak-undefined symbols have this behaviour (compare
-      // equal to null pointer, only reachable via direct call).
-      if (reloc.Type == R_WASM_TABLE_INDEX_SLEB ||
-          reloc.Type == R_WASM_TABLE_INDEX_I32) {
-        auto *funcSym = cast<FunctionSymbol>(sym);
-        if (funcSym->hasTableIndex() && funcSym->getTableIndex() == 0)
-          continue;
-      }
-
-      enqueue(sym);
-    }
+// Marks the same chunks as mark(), one generation at a time.  The relocations
+// of all the chunks found in the previous generation are scanned in parallel,
+// which is where the time goes.  Marking the symbols they refer to is done
+// serially in between, since the live bits are bitfields shared with other
+// flags and can't be set from several threads.
+void MarkLive::markParallel() {
+  std::vector<InputChunk *> chunks;
+  std::vector<std::vector<Symbol *>> found;
+  while (!queue.empty()) {
+    chunks.assign(queue.begin(), queue.end());
+    queue.clear();
+
+    found.clear();
+    found.resize(chunks.size());
+    parallelForEachN(0, chunks.size(), [&](size_t i) {
+      for (const WasmRelocation &reloc : chunks[i]->getRelocations())
+        if (Symbol *sym = getRelocTarget(chunks[i], reloc))
+          if (!sym->isLive())
+            found[i].push_back(sym);
+    });
+
+    for (ArrayRef<Symbol *> syms : found)
+      for (Symbol *sym : syms)
+        enqueue(sym);
   }
 }
 
@@ -137,6 +175,7 @@ void markLive() {
   if (!config->gcSections)
     return;
 
+  ScopedTimer t(gcTimer);
   LLVM_DEBUG(dbgs() << "markLive\n");
 
   MarkLive marker;
@@ -86,9 +86,11 @@ void CodeSection::finalizeContents() {
   os.flush();
   bodySize = codeSectionHeader.size();
 
+  // The size of each function is independent of the others.
+  parallelForEach(functions, [](InputFunction *func) { func->calculateSize(); });
+
   for (InputFunction *func : functions) {
     func->outputOffset = bodySize;
-    func->calculateSize();
     bodySize += func->getSize();
   }
 
@@ -100,7 +102,6 @@ void CodeSection::writeTo(uint8_t *buf) {
   log(" size=" + Twine(getSize()));
   log(" headersize=" + Twine(header.size()));
   log(" codeheadersize=" + Twine(codeSectionHeader.size()));
-  buf += offset;
 
   // Write section header
   memcpy(buf, header.data(), header.size());
@@ -109,9 +110,10 @@ void CodeSection::writeTo(uint8_t *buf) {
   // Write code section headers
   memcpy(buf, codeSectionHeader.data(), codeSectionHeader.size());
 
-  // Write code section bodies
-  for (const InputChunk *chunk : functions)
-    chunk->writeTo(buf);
+  // Write code section bodies.  Each function writes to its own disjoint
+  // range of the output buffer, so this can be done in parallel.
+  parallelForEach(functions,
+                  [&](const InputChunk *chunk) { chunk->writeTo(buf); });
 }
 
 uint32_t CodeSection::getNumRelocations() const {
@@ -121,16 +123,81 @@ uint32_t CodeSection::getNumRelocations() const {
   return count;
 }
 
+// Encodes the relocations of each chunk into a buffer of its own in parallel
+// and then appends the buffers to `os` in order.  This is the bulk of the
+// work for -r output of large inputs.
+static void writeChunkRelocations(raw_ostream &os,
+                                  ArrayRef<const InputChunk *> chunks) {
+  std::vector<std::string> encoded(chunks.size());
+  parallelForEachN(0, chunks.size(), [&](size_t i) {
+    raw_string_ostream chunkOS(encoded[i]);
+    chunks[i]->writeRelocations(chunkOS);
+  });
+  for (const std::string &s : encoded)
+    os << s;
+}
+
 void CodeSection::writeRelocations(raw_ostream &os) const {
-  for (const InputChunk *c : functions)
-    c->writeRelocations(os);
+  std::vector<const InputChunk *> chunks(functions.begin(), functions.end());
+  writeChunkRelocations(os, chunks);
+}
+
+// Splits an active data segment into the parts that are separated by at
+// least config->elideZeroRuns zero bytes.  The zeros before the first part
+// and after the last one are left out as well.
+static void splitAtZeroRuns(OutputSegment *segment) {
+  uint32_t minRun = config->elideZeroRuns;
+  std::vector<OutputSegment::Part> &parts = segment->parts;
+  for (InputSegment *inSeg : segment->inputSegments) {
+    for (std::pair<uint32_t, uint32_t> r : inSeg->getNonZeroRanges(minRun)) {
+      uint32_t begin = inSeg->outputSegmentOffset + r.first;
+      uint32_t end = inSeg->outputSegmentOffset + r.second;
+      if (!parts.empty() &&
+          begin - (parts.back().offset + parts.back().size) < minRun)
+        parts.back().size = end - parts.back().offset;
+      else
+        parts.push_back({begin, end - begin});
+    }
+  }
+  segment->split = true;
+}
+
+static void writeSegmentHeader(std::string &header, uint32_t initFlags,
+                               uint32_t startVA, uint32_t size) {
+  raw_string_ostream os(header);
+  writeUleb128(os, initFlags, "init flags");
+  if (initFlags & WASM_SEGMENT_HAS_MEMINDEX)
+    writeUleb128(os, 0, "memory index");
+  if ((initFlags & WASM_SEGMENT_IS_PASSIVE) == 0) {
+    WasmInitExpr initExpr;
+    if (config->isPic) {
+      initExpr.Opcode = WASM_OPCODE_GLOBAL_GET;
+      initExpr.Value.Global = WasmSym::memoryBase->getGlobalIndex();
+    } else {
+      initExpr.Opcode = WASM_OPCODE_I32_CONST;
+      initExpr.Value.Int32 = startVA;
+    }
+    writeInitExpr(os, initExpr);
+  }
+  writeUleb128(os, size, "segment size");
+  os.flush();
 }
 
 void DataSection::finalizeContents() {
+  // Only the segments whose address is a constant can be split. The zeros
+  // can only be left out if the memory is known to start out zeroed, which
+  // an imported memory is not. __wasm_init_memory only zeroes .bss.
+  if (config->elideZeroRuns && !config->isPic && !config->importMemory)
+    parallelForEach(segments, [](OutputSegment *segment) {
+      if (!segment->isBss && !(segment->initFlags & WASM_SEGMENT_IS_PASSIVE))
+        splitAtZeroRuns(segment);
+    });
+
   raw_string_ostream os(dataSectionHeader);
-  unsigned segmentCount =
-      std::count_if(segments.begin(), segments.end(),
-                    [](OutputSegment *segment) { return !segment->isBss; });
+  unsigned segmentCount = 0;
+  for (OutputSegment *segment : segments)
+    if (!segment->isBss)
+      segmentCount += segment->split ? segment->parts.size() : 1;
 
   writeUleb128(os, segmentCount, "data segment count");
   os.flush();
@@ -142,24 +209,39 @@ void DataSection::finalizeContents() {
   for (OutputSegment *segment : segments) {
     if (segment->isBss)
       continue;
-    raw_string_ostream os(segment->header);
-    writeUleb128(os, segment->initFlags, "init flags");
-    if (segment->initFlags & WASM_SEGMENT_HAS_MEMINDEX)
-      writeUleb128(os, 0, "memory index");
-    if ((segment->initFlags & WASM_SEGMENT_IS_PASSIVE) == 0) {
-      WasmInitExpr initExpr;
-      if (config->isPic) {
-        initExpr.Opcode = WASM_OPCODE_GLOBAL_GET;
-        initExpr.Value.Global = WasmSym::memoryBase->getGlobalIndex();
-      } else {
-        initExpr.Opcode = WASM_OPCODE_I32_CONST;
-        initExpr.Value.Int32 = segment->startVA;
+
+    if (segment->split) {
+      for (OutputSegment::Part &part : segment->parts) {
+        writeSegmentHeader(part.header, segment->initFlags,
+                           segment->startVA + part.offset, part.size);
+        part.sectionOffset = bodySize;
+        bodySize += part.header.size() + part.size;
+        log("Data segment: size=" + Twine(part.size) + ", startVA=" +
+            Twine::utohexstr(segment->startVA + part.offset) +
+            ", name=" + segment->name);
+      }
+
+      // The input segments that span several parts, or lie in the elided
+      // zeros, don't have a place in the file. They get the offset they
+      // would have in the part that contains or follows their start.
+      for (InputSegment *inputSeg : segment->inputSegments) {
+        uint32_t start = inputSeg->outputSegmentOffset;
+        auto it = llvm::partition_point(
+            segment->parts, [&](const OutputSegment::Part &p) {
+              return p.offset + p.size <= start;
+            });
+        if (it == segment->parts.end()) {
+          inputSeg->outputOffset = bodySize;
+          continue;
+        }
+        inputSeg->outputOffset = it->sectionOffset + it->header.size() +
+                                 start - it->offset;
       }
-      writeInitExpr(os, initExpr);
+      continue;
     }
-    writeUleb128(os, segment->size, "segment size");
-    os.flush();
 
+    writeSegmentHeader(segment->header, segment->initFlags, segment->startVA,
+                       segment->size);
     segment->sectionOffset = bodySize;
     bodySize += segment->header.size() + segment->size;
     log("Data segment: size=" + Twine(segment->size) + ", startVA=" +
@@ -176,7 +258,6 @@ void DataSection::finalizeContents() {
 void DataSection::writeTo(uint8_t *buf) {
   log("writing " + toString(*this) + " size=" + Twine(getSize()) +
       " body=" + Twine(bodySize));
-  buf += offset;
 
   // Write section header
   memcpy(buf, header.data(), header.size());
@@ -188,13 +269,30 @@ void DataSection::writeTo(uint8_t *buf) {
   for (const OutputSegment *segment : segments) {
     if (segment->isBss)
       continue;
+    if (segment->split) {
+      // The parts of a split segment are not contiguous in the file, so the
+      // segment is written to a buffer first and its parts copied from it.
+      std::vector<uint8_t> contents(segment->size);
+      uint8_t *base = contents.data();
+      parallelForEach(segment->inputSegments, [&](const InputSegment *chunk) {
+        chunk->writeAt(base + chunk->outputSegmentOffset);
+      });
+      for (const OutputSegment::Part &part : segment->parts) {
+        uint8_t *partStart = buf + part.sectionOffset;
+        memcpy(partStart, part.header.data(), part.header.size());
+        memcpy(partStart + part.header.size(), base + part.offset, part.size);
+      }
+      continue;
+    }
+
     // Write data segment header
     uint8_t *segStart = buf + segment->sectionOffset;
     memcpy(segStart, segment->header.data(), segment->header.size());
 
-    // Write segment data payload
-    for (const InputChunk *chunk : segment->inputSegments)
-      chunk->writeTo(buf);
+    // Write segment data payload.  Segments are often merged into a few
+    // large output segments, so parallelize over the input segments.
+    parallelForEach(segment->inputSegments,
+                    [&](const InputChunk *chunk) { chunk->writeTo(buf); });
   }
 }
 
@@ -207,9 +305,11 @@ uint32_t DataSection::getNumRelocations() const {
 }
 
 void DataSection::writeRelocations(raw_ostream &os) const {
+  std::vector<const InputChunk *> chunks;
   for (const OutputSegment *seg : segments)
-    for (const InputChunk *c : seg->inputSegments)
-      c->writeRelocations(os);
+    chunks.insert(chunks.end(), seg->inputSegments.begin(),
+                  seg->inputSegments.end());
+  writeChunkRelocations(os, chunks);
 }
 
 bool DataSection::isNeeded() const {
@@ -239,7 +339,6 @@ void CustomSection::writeTo(uint8_t *buf) {
       " chunks=" + Twine(inputSections.size()));
 
   assert(offset);
-  buf += offset;
 
   // Write section header
   memcpy(buf, header.data(), header.size());
@@ -247,9 +346,11 @@ void CustomSection::writeTo(uint8_t *buf) {
   memcpy(buf, nameData.data(), nameData.size());
   buf += nameData.size();
 
-  // Write custom sections payload
-  for (const InputSection *section : inputSections)
-    section->writeTo(buf);
+  // Write custom sections payload.  With debug info these are the largest
+  // sections of the output, and each input section writes to its own range
+  // and applies its own relocations, so this is done in parallel.
+  parallelForEach(inputSections,
+                  [&](const InputSection *section) { section->writeTo(buf); });
 }
 
 uint32_t CustomSection::getNumRelocations() const {
@@ -260,8 +361,9 @@ uint32_t CustomSection::getNumRelocations() const {
 }
 
 void CustomSection::writeRelocations(raw_ostream &os) const {
-  for (const InputSection *s : inputSections)
-    s->writeRelocations(os);
+  std::vector<const InputChunk *> chunks(inputSections.begin(),
+                                         inputSections.end());
+  writeChunkRelocations(os, chunks);
 }
 
 } // namespace wasm
@@ -37,9 +37,12 @@ public:
     log("setOffset: " + toString(*this) + ": " + Twine(newOffset));
     offset = newOffset;
   }
+  size_t getOffset() const { return offset; }
   void createHeader(size_t bodySize);
   virtual bool isNeeded() const { return true; }
   virtual size_t getSize() const = 0;
+  // Writes the section, header included, to buf, which points to where the
+  // section starts, not to the start of the file.
   virtual void writeTo(uint8_t *buf) = 0;
   virtual void finalizeContents() = 0;
   virtual uint32_t getNumRelocations() const { return 0; }
@@ -60,12 +63,17 @@ public:
   explicit CodeSection(ArrayRef<InputFunction *> functions)
       : OutputSection(llvm::wasm::WASM_SEC_CODE), functions(functions) {}
 
+  static bool classof(const OutputSection *sec) {
+    return sec->type == llvm::wasm::WASM_SEC_CODE;
+  }
+
   size_t getSize() const override { return header.size() + bodySize; }
   void writeTo(uint8_t *buf) override;
   uint32_t getNumRelocations() const override;
   void writeRelocations(raw_ostream &os) const override;
   bool isNeeded() const override { return functions.size() > 0; }
   void finalizeContents() override;
+  ArrayRef<InputFunction *> getFunctions() const { return functions; }
 
 protected:
   ArrayRef<InputFunction *> functions;
@@ -78,12 +86,17 @@ public:
   explicit DataSection(ArrayRef<OutputSegment *> segments)
       : OutputSection(llvm::wasm::WASM_SEC_DATA), segments(segments) {}
 
+  static bool classof(const OutputSection *sec) {
+    return sec->type == llvm::wasm::WASM_SEC_DATA;
+  }
+
   size_t getSize() const override { return header.size() + bodySize; }
   void writeTo(uint8_t *buf) override;
   uint32_t getNumRelocations() const override;
   void writeRelocations(raw_ostream &os) const override;
   bool isNeeded() const override;
   void finalizeContents() override;
+  ArrayRef<OutputSegment *> getSegments() const { return segments; }
 
 protected:
   ArrayRef<OutputSegment *> segments;
@@ -17,6 +17,7 @@ namespace lld {
 namespace wasm {
 
 class InputSegment;
+class RelocTableSegment;
 
 class OutputSegment {
 public:
@@ -31,6 +32,19 @@ public:
     size += inSeg->getSize();
   }
 
+  // Reorders the input segments by decreasing alignment, which minimizes
+  // the padding between them, and lays them out again.
+  void sortInputSegmentsByAlignment() {
+    std::vector<InputSegment *> inputs = std::move(inputSegments);
+    llvm::stable_sort(inputs, [](InputSegment *a, InputSegment *b) {
+      return a->getAlignment() > b->getAlignment();
+    });
+    inputSegments.clear();
+    size = 0;
+    for (InputSegment *inSeg : inputs)
+      addInputSegment(inSeg);
+  }
+
   StringRef name;
   bool isBss = false;
   uint32_t index = 0;
@@ -40,11 +54,27 @@ public:
   uint32_t startVA = 0;
   std::vector<InputSegment *> inputSegments;
 
+  // With --pack-dyn-relocs=relr, the table of runtime relocations applied to
+  // this segment.  It is also the last of inputSegments.
+  RelocTableSegment *relocTable = nullptr;
+
   // Sum of the size of the all the input segments
   uint32_t size = 0;
 
   // Segment header
   std::string header;
+
+  // With --elide-zero-runs, the parts of this segment that are written as
+  // data segments of their own, leaving out the long runs of zeros between
+  // them, since memory starts out zeroed.  Only used if `split` is set.
+  bool split = false;
+  struct Part {
+    uint32_t offset;
+    uint32_t size;
+    uint32_t sectionOffset = 0;
+    std::string header;
+  };
+  std::vector<Part> parts;
 };
 
 } // namespace wasm
@@ -16,8 +16,14 @@ using namespace llvm::wasm;
 
 namespace lld {
 namespace wasm {
-static bool requiresGOTAccess(const Symbol *sym) {
-  return config->isPic && !sym->isHidden() && !sym->isLocal();
+bool requiresGOTAccess(const Symbol *sym) {
+  if (!config->isPic || sym->isHidden() || sym->isLocal())
+    return false;
+  // Nothing can preempt a symbol that is defined in an executable, so its
+  // address is a known offset from __memory_base or __table_base.
+  if (config->pie && sym->isDefined())
+    return false;
+  return true;
 }
 
 static bool allowUndefined(const Symbol* sym) {
@@ -40,17 +46,19 @@ static void reportUndefined(const Symbol* sym) {
 }
 
 static void addGOTEntry(Symbol *sym) {
-  // In PIC mode a GOT entry is an imported global that the dynamic linker
-  // will assign.
-  // In non-PIC mode (i.e. when code compiled as fPIC is linked into a static
-  // binary) we create an internal wasm global with a fixed value that takes the
-  // place of th GOT entry and effectivly acts as an i32 const. This can
-  // potentially be optimized away at runtime or with a post-link tool.
+  // The GOT entry of a symbol that may be preempted is an imported global that
+  // the dynamic linker will assign.
+  // Otherwise we create an internal wasm global that takes the place of the
+  // GOT entry. In non-PIC mode (i.e. when code compiled as fPIC is linked into
+  // a static binary) it has a fixed value and effectivly acts as an i32 const.
+  // This can potentially be optimized away at runtime or with a post-link
+  // tool. In PIC mode __wasm_apply_relocs sets it relative to __memory_base or
+  // __table_base, which saves an import for each such symbol.
   // TODO(sbc): Linker relaxation might also be able to optimize this away.
-  if (config->isPic)
+  if (requiresGOTAccess(sym))
     out.importSec->addGOTEntry(sym);
   else
-    out.globalSec->addStaticGOTEntry(sym);
+    out.globalSec->addInternalGOTEntry(sym);
 }
 
 void scanRelocations(InputChunk *chunk) {
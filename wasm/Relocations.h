@@ -13,9 +13,13 @@ namespace lld {
 namespace wasm {
 
 class InputChunk;
+class Symbol;
 
 void scanRelocations(InputChunk *chunk);
 
+// Returns true if references to `sym` must go through a GOT entry.
+bool requiresGOTAccess(const Symbol *sym);
+
 } // namespace wasm
 } // namespace lld
 
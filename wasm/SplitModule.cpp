@@ -0,0 +1,385 @@
+//===- SplitModule.cpp ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --split-module=<profile>.
+//
+// The profile lists the functions that are used during startup, one symbol
+// name per line.  Every other live function is moved out of the output into
+// a secondary module, which can be fetched and instantiated later, the first
+// time that one of the functions is called.
+//
+// Each moved function gets a slot in the indirect function table, which
+// initially holds an import from the "placeholder" module whose field name is
+// the slot number.  The function itself is replaced in the primary module by
+// a stub of the same signature that calls through the slot.  The embedder's
+// placeholder is expected to load the secondary module, instantiate it with
+// the exports of the primary module as the "primary" module, and then call
+// through the slot again.  Instantiating the secondary module overwrites the
+// slots with the real functions, so that later calls only go through the
+// stub.
+//
+// The secondary module shares the memory and the table of the primary one.
+// The functions and globals of the primary module that the moved functions
+// refer to are exported from it under internal names and imported by the
+// secondary module.  Function pointers keep their values in both modules,
+// since they are table indexes and the moved functions' table entries are
+// the ones of their stubs.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SplitModule.h"
+#include "Config.h"
+#include "InputChunks.h"
+#include "InputFiles.h"
+#include "SymbolTable.h"
+#include "SyntheticSections.h"
+#include "WriterUtils.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Memory.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/LEB128.h"
+
+#define DEBUG_TYPE "lld"
+
+using namespace llvm;
+using namespace llvm::wasm;
+
+namespace lld {
+namespace wasm {
+
+static constexpr uint8_t callIndirectOpcode = 0x11;
+
+namespace {
+struct DeferredFunction {
+  InputFunction *function;
+  SyntheticFunction *stub;
+  FunctionSymbol *placeholder;
+};
+} // namespace
+
+static std::vector<DeferredFunction> deferredFunctions;
+
+// Maps each stub to the index of its function in deferredFunctions.
+static DenseMap<const InputFunction *, uint32_t> stubs;
+
+// The functions and globals of the primary module that are imported by the
+// secondary module, by their primary index, in import order.
+static MapVector<uint32_t, const WasmSignature *> importedFunctions;
+static MapVector<uint32_t, WasmGlobalType> importedGlobals;
+
+static bool canDefer(const InputFunction *func) {
+  if (!func->live || config->splitModuleProfile.count(func->getName()))
+    return false;
+  // Events are not shared with the secondary module.
+  return llvm::none_of(func->getRelocations(), [](const WasmRelocation &rel) {
+    return rel.Type == R_WASM_EVENT_INDEX_LEB;
+  });
+}
+
+void splitFunctions() {
+  // Forget the functions of an earlier link in the same process.
+  deferredFunctions.clear();
+  stubs.clear();
+  importedFunctions.clear();
+  importedGlobals.clear();
+
+  // Reserve the slots before any other table entry is added, so that they are
+  // contiguous and the secondary module needs only one element segment.
+  assert(out.elemSec->numEntries() == 0);
+
+  DenseMap<const InputFunction *, SyntheticFunction *> stubOf;
+  for (ObjFile *file : symtab->objectFiles) {
+    for (InputFunction *func : file->functions) {
+      if (!canDefer(func))
+        continue;
+
+      uint32_t slot = config->tableBase + out.elemSec->numEntries();
+      auto *placeholder = cast<FunctionSymbol>(symtab->addUndefinedFunction(
+          saver.save("__wasm_split_placeholder_" + Twine(slot)),
+          saver.save(Twine(slot)), "placeholder", WASM_SYMBOL_UNDEFINED,
+          nullptr, &func->signature, false));
+      placeholder->markLive();
+      placeholder->isUsedInRegularObj = true;
+      out.elemSec->addEntry(placeholder);
+
+      auto *stub = make<SyntheticFunction>(func->signature, func->getName(),
+                                           func->getDebugName());
+      stub->live = true;
+      symtab->syntheticFunctions.push_back(stub);
+
+      func->deferred = true;
+      stubs[stub] = deferredFunctions.size();
+      stubOf[func] = stub;
+      deferredFunctions.push_back({func, stub, placeholder});
+    }
+  }
+
+  log("split-module: deferring " + Twine(deferredFunctions.size()) +
+      " functions");
+
+  // Every symbol of a moved function now refers to its stub, which gives it
+  // its function index and table index in the primary module.
+  auto redirect = [&](Symbol *sym) {
+    if (auto *f = dyn_cast<DefinedFunction>(sym))
+      if (SyntheticFunction *stub = stubOf.lookup(f->function))
+        f->function = stub;
+  };
+  for (ObjFile *file : symtab->objectFiles)
+    for (Symbol *sym : file->getSymbols())
+      redirect(sym);
+  for (Symbol *sym : symtab->getSymbols())
+    redirect(sym);
+}
+
+// Returns the index of the secondary module's function that `sym` refers to
+// from a moved function, which is either another moved function or an
+// import from the primary module.
+static uint32_t getSecondaryFunctionIndex(const FunctionSymbol *sym) {
+  if (auto *f = dyn_cast<DefinedFunction>(sym)) {
+    auto it = stubs.find(f->function);
+    if (it != stubs.end())
+      return importedFunctions.size() + it->second;
+  }
+  return importedFunctions.find(sym->getFunctionIndex()) -
+         importedFunctions.begin();
+}
+
+static uint32_t getPrimaryGlobalIndex(const Symbol *sym) {
+  if (auto *g = dyn_cast<GlobalSymbol>(sym))
+    return g->getGlobalIndex();
+  return sym->getGOTIndex();
+}
+
+void addSplitExports() {
+  for (const DeferredFunction &d : deferredFunctions) {
+    ObjFile *file = d.function->file;
+    for (const WasmRelocation &rel : d.function->getRelocations()) {
+      if (rel.Type == R_WASM_FUNCTION_INDEX_LEB) {
+        const FunctionSymbol *sym = file->getFunctionSymbol(rel.Index);
+        if (!sym->isLive())
+          continue;
+        if (auto *f = dyn_cast<DefinedFunction>(sym))
+          if (stubs.count(f->function))
+            continue;
+        importedFunctions.insert({sym->getFunctionIndex(), sym->signature});
+      } else if (rel.Type == R_WASM_GLOBAL_INDEX_LEB) {
+        const Symbol *sym = file->getSymbols()[rel.Index];
+        WasmGlobalType type = {WASM_TYPE_I32, false};
+        if (auto *g = dyn_cast<GlobalSymbol>(sym))
+          type = *g->getGlobalType();
+        importedGlobals.insert({getPrimaryGlobalIndex(sym), type});
+      }
+    }
+  }
+
+  for (const auto &f : importedFunctions)
+    out.exportSec->exports.push_back(
+        WasmExport{saver.save("split.f" + Twine(f.first)),
+                   WASM_EXTERNAL_FUNCTION, f.first});
+  for (const auto &g : importedGlobals)
+    out.exportSec->exports.push_back(
+        WasmExport{saver.save("split.g" + Twine(g.first)),
+                   WASM_EXTERNAL_GLOBAL, g.first});
+}
+
+void createSplitStubs() {
+  for (const DeferredFunction &d : deferredFunctions) {
+    std::string bodyContent;
+    {
+      raw_string_ostream os(bodyContent);
+      writeUleb128(os, 0, "num locals");
+      for (size_t i = 0; i < d.function->signature.Params.size(); ++i) {
+        writeU8(os, WASM_OPCODE_LOCAL_GET, "local.get");
+        writeUleb128(os, i, "local index");
+      }
+      writeU8(os, WASM_OPCODE_I32_CONST, "i32.const");
+      writeSleb128(os, d.placeholder->getTableIndex(), "table index");
+      writeU8(os, callIndirectOpcode, "call_indirect");
+      writeUleb128(os, out.typeSec->lookupType(d.function->signature),
+                   "type index");
+      writeUleb128(os, 0, "table index");
+      writeU8(os, WASM_OPCODE_END, "END");
+    }
+
+    std::string functionBody;
+    {
+      raw_string_ostream os(functionBody);
+      writeUleb128(os, bodyContent.size(), "function size");
+      os << bodyContent;
+    }
+    d.stub->setBody(arrayRefFromStringRef(saver.save(functionBody)));
+  }
+}
+
+static void writeSection(raw_ostream &os, uint8_t type, StringRef body) {
+  writeU8(os, type, "section type");
+  writeUleb128(os, body.size(), "section size");
+  os << body;
+}
+
+void writeSplitModule() {
+  std::vector<const WasmSignature *> types;
+  DenseMap<WasmSignature, uint32_t> typeIndices;
+  auto getType = [&](const WasmSignature &sig) {
+    auto it = typeIndices.try_emplace(sig, types.size());
+    if (it.second)
+      types.push_back(&sig);
+    return it.first->second;
+  };
+
+  auto calcValue = [&](ObjFile *file, const WasmRelocation &rel) -> uint32_t {
+    switch (rel.Type) {
+    case R_WASM_TYPE_INDEX_LEB:
+      return getType(file->getWasmObj()->types()[rel.Index]);
+    case R_WASM_FUNCTION_INDEX_LEB: {
+      const FunctionSymbol *sym = file->getFunctionSymbol(rel.Index);
+      if (!sym->isLive())
+        return 0;
+      return getSecondaryFunctionIndex(sym);
+    }
+    case R_WASM_GLOBAL_INDEX_LEB:
+      return importedGlobals.find(
+                 getPrimaryGlobalIndex(file->getSymbols()[rel.Index])) -
+             importedGlobals.begin();
+    default:
+      // Memory addresses and table indexes are the same in both modules.
+      return file->calcNewValue(rel);
+    }
+  };
+
+  // The code section goes first, since its relocations add to the types.
+  std::string code;
+  {
+    raw_string_ostream os(code);
+    writeUleb128(os, deferredFunctions.size(), "function count");
+    for (const DeferredFunction &d : deferredFunctions) {
+      InputFunction *func = d.function;
+      ArrayRef<uint8_t> input = func->getInputContents();
+      uint32_t paddedSize = 5 + decodeULEB128(input.data());
+      std::vector<uint8_t> buf(paddedSize);
+      writePaddedFunction(buf.data(), paddedSize, input,
+                          func->getInputSectionOffset(),
+                          func->getRelocations(),
+                          [&](const WasmRelocation &rel) {
+                            return calcValue(func->file, rel);
+                          });
+      os << toStringRef(buf);
+    }
+  }
+
+  std::string functions;
+  {
+    raw_string_ostream os(functions);
+    writeUleb128(os, deferredFunctions.size(), "function count");
+    for (const DeferredFunction &d : deferredFunctions)
+      writeUleb128(os, getType(d.function->signature), "sig index");
+  }
+
+  std::string imports;
+  {
+    raw_string_ostream os(imports);
+    writeUleb128(os, 2 + importedGlobals.size() + importedFunctions.size(),
+                 "import count");
+
+    WasmImport memory;
+    memory.Module = config->importMemory ? defaultModule : "primary";
+    memory.Field = "memory";
+    memory.Kind = WASM_EXTERNAL_MEMORY;
+    memory.Memory.Flags = 0;
+    memory.Memory.Initial = out.memorySec->numMemoryPages;
+    if (out.memorySec->maxMemoryPages != 0 || config->sharedMemory) {
+      memory.Memory.Flags |= WASM_LIMITS_FLAG_HAS_MAX;
+      memory.Memory.Maximum = out.memorySec->maxMemoryPages;
+    }
+    if (config->sharedMemory)
+      memory.Memory.Flags |= WASM_LIMITS_FLAG_IS_SHARED;
+    writeImport(os, memory);
+
+    WasmImport table;
+    table.Module = config->importTable ? defaultModule : "primary";
+    table.Field = functionTableName;
+    table.Kind = WASM_EXTERNAL_TABLE;
+    table.Table.ElemType = WASM_TYPE_FUNCREF;
+    table.Table.Limits = {0, config->tableBase + out.elemSec->numEntries(), 0};
+    writeImport(os, table);
+
+    for (const auto &g : importedGlobals) {
+      WasmImport import;
+      import.Module = "primary";
+      import.Field = saver.save("split.g" + Twine(g.first));
+      import.Kind = WASM_EXTERNAL_GLOBAL;
+      import.Global = g.second;
+      writeImport(os, import);
+    }
+
+    for (const auto &f : importedFunctions) {
+      WasmImport import;
+      import.Module = "primary";
+      import.Field = saver.save("split.f" + Twine(f.first));
+      import.Kind = WASM_EXTERNAL_FUNCTION;
+      import.SigIndex = getType(*f.second);
+      writeImport(os, import);
+    }
+  }
+
+  std::string typeSection;
+  {
+    raw_string_ostream os(typeSection);
+    writeUleb128(os, types.size(), "type count");
+    for (const WasmSignature *sig : types)
+      writeSig(os, *sig);
+  }
+
+  // Overwrite the placeholders with the real functions.
+  std::string elems;
+  if (!deferredFunctions.empty()) {
+    raw_string_ostream os(elems);
+    writeUleb128(os, 1, "segment count");
+    writeUleb128(os, 0, "table index");
+    WasmInitExpr initExpr;
+    initExpr.Opcode = WASM_OPCODE_I32_CONST;
+    initExpr.Value.Int32 = deferredFunctions[0].placeholder->getTableIndex();
+    writeInitExpr(os, initExpr);
+    writeUleb128(os, deferredFunctions.size(), "elem count");
+    for (size_t i = 0; i < deferredFunctions.size(); ++i)
+      writeUleb128(os, importedFunctions.size() + i, "function index");
+  }
+
+  std::string contents;
+  {
+    raw_string_ostream os(contents);
+    writeBytes(os, WasmMagic, sizeof(WasmMagic), "wasm magic");
+    writeU32(os, WasmVersion, "wasm version");
+    if (!types.empty())
+      writeSection(os, WASM_SEC_TYPE, typeSection);
+    writeSection(os, WASM_SEC_IMPORT, imports);
+    if (!deferredFunctions.empty()) {
+      writeSection(os, WASM_SEC_FUNCTION, functions);
+      writeSection(os, WASM_SEC_ELEM, elems);
+      writeSection(os, WASM_SEC_CODE, code);
+    }
+  }
+
+  log("writing: " + config->splitModuleOutput);
+  Expected<std::unique_ptr<FileOutputBuffer>> bufferOrErr =
+      FileOutputBuffer::create(config->splitModuleOutput, contents.size());
+  if (!bufferOrErr) {
+    error("failed to open " + config->splitModuleOutput + ": " +
+          toString(bufferOrErr.takeError()));
+    return;
+  }
+  memcpy((*bufferOrErr)->getBufferStart(), contents.data(), contents.size());
+  if (Error e = (*bufferOrErr)->commit())
+    error("failed to write " + config->splitModuleOutput + ": " +
+          toString(std::move(e)));
+}
+
+} // namespace wasm
+} // namespace lld
@@ -0,0 +1,35 @@
+//===- SplitModule.h --------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_SPLIT_MODULE_H
+#define LLD_WASM_SPLIT_MODULE_H
+
+namespace lld {
+namespace wasm {
+
+// The steps of --split-module, in the order in which the writer calls them.
+
+// Chooses the functions to move to the secondary module, reserves a table
+// slot for each of them and replaces them in the primary module with stubs.
+// Called before imports are calculated.
+void splitFunctions();
+
+// Exports the functions and globals of the primary module that the moved
+// functions refer to.  Called once all indexes have been assigned.
+void addSplitExports();
+
+// Writes the bodies of the stubs.  Called after the types are calculated.
+void createSplitStubs();
+
+// Writes the secondary module to config->splitModuleOutput.
+void writeSplitModule();
+
+} // namespace wasm
+} // namespace lld
+
+#endif
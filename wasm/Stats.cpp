@@ -0,0 +1,172 @@
+//===- Stats.cpp ----------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --print-stats=json, which prints a summary of the link
+// as a single JSON object so that build systems can track linker performance
+// without scraping --verbose output. For example:
+//
+//   {
+//     "version": "LLD 10.0.0",
+//     "output": "a.out.wasm",
+//     "output_size": 1234,
+//     "input_bytes": 5678,
+//     "peak_rss_bytes": 12345678,
+//     "phases": [{"name": "Input File Reading", "ms": 1.5, ...}],
+//     "total_ms": 12.5,
+//     "functions": {"input": 10, "gc_removed": 3, "gc_removed_bytes": 120,
+//                   "icf_folded": 1, "icf_folded_bytes": 40},
+//     "data_segments": {"input": 4, "gc_removed": 1, "gc_removed_bytes": 16},
+//     "relocations": {"R_WASM_FUNCTION_INDEX_LEB": 12},
+//     "compressed_relocations_saved_bytes": 0,
+//     "output_sections": [{"name": "TYPE", "size": 8}]
+//   }
+//
+//===----------------------------------------------------------------------===//
+
+#include "Stats.h"
+#include "Config.h"
+#include "InputChunks.h"
+#include "InputFiles.h"
+#include "SymbolTable.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Timer.h"
+#include "lld/Common/Version.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+#include <map>
+
+#if LLVM_ON_UNIX
+#include <sys/resource.h>
+#endif
+
+using namespace llvm;
+
+namespace lld {
+namespace wasm {
+
+LinkStats stats;
+
+// Returns the peak resident set size of the process in bytes, or 0 if the
+// host doesn't tell us.
+static uint64_t getPeakRSS() {
+#if LLVM_ON_UNIX
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#if defined(__APPLE__)
+  return usage.ru_maxrss;
+#else
+  return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+namespace {
+struct ChunkCounts {
+  uint64_t input = 0;
+  uint64_t removed = 0;
+  uint64_t removedBytes = 0;
+  uint64_t folded = 0;
+  uint64_t foldedBytes = 0;
+
+  // Chunks that lost to a COMDAT copy in another file are counted as input
+  // only, since they were neither garbage collected nor folded.
+  void add(const InputChunk *c) {
+    ++input;
+    if (c->live || c->discarded)
+      return;
+    if (stats.icfFolded.count(c)) {
+      ++folded;
+      foldedBytes += c->getInputSize();
+    } else {
+      ++removed;
+      removedBytes += c->getInputSize();
+    }
+  }
+
+  void write(json::OStream &j, StringRef name, bool withICF) const {
+    j.attributeObject(name, [&] {
+      j.attribute("input", int64_t(input));
+      j.attribute("gc_removed", int64_t(removed));
+      j.attribute("gc_removed_bytes", int64_t(removedBytes));
+      if (withICF) {
+        j.attribute("icf_folded", int64_t(folded));
+        j.attribute("icf_folded_bytes", int64_t(foldedBytes));
+      }
+    });
+  }
+};
+} // namespace
+
+void printStats() {
+  ChunkCounts functions;
+  ChunkCounts segments;
+  std::map<uint8_t, uint64_t> relocs;
+  uint64_t compressedSavings = 0;
+
+  auto countRelocs = [&](const InputChunk *c) {
+    if (c->live)
+      for (const WasmRelocation &rel : c->getRelocations())
+        ++relocs[rel.Type];
+  };
+
+  for (ObjFile *file : symtab->objectFiles) {
+    for (InputFunction *f : file->functions) {
+      functions.add(f);
+      countRelocs(f);
+      if (f->live && config->compressRelocations && !config->incremental)
+        compressedSavings += f->getInputSize() - f->getSize();
+    }
+    for (InputSegment *seg : file->segments) {
+      segments.add(seg);
+      countRelocs(seg);
+    }
+    for (InputSection *sec : file->customSections)
+      countRelocs(sec);
+  }
+
+  std::string str;
+  raw_string_ostream os(str);
+  json::OStream j(os, 2);
+  j.object([&] {
+    j.attribute("version", getLLDVersion());
+    j.attribute("output", config->outputFile);
+    j.attribute("output_size", int64_t(stats.outputSize));
+    j.attribute("input_bytes", int64_t(stats.inputBytes));
+    j.attribute("peak_rss_bytes", int64_t(getPeakRSS()));
+    j.attributeArray("phases", [&] {
+      for (const Timer *t : Timer::root().getChildren())
+        t->writeJSON(j);
+    });
+    j.attribute("total_ms", Timer::root().millis());
+    functions.write(j, "functions", /*withICF=*/true);
+    segments.write(j, "data_segments", /*withICF=*/false);
+    j.attributeObject("relocations", [&] {
+      for (const auto &reloc : relocs)
+        j.attribute(relocTypeToString(reloc.first), int64_t(reloc.second));
+    });
+    j.attribute("compressed_relocations_saved_bytes",
+                int64_t(compressedSavings));
+    j.attributeArray("output_sections", [&] {
+      for (const auto &sec : stats.outputSections) {
+        j.object([&] {
+          j.attribute("name", sec.first);
+          j.attribute("size", int64_t(sec.second));
+        });
+      }
+    });
+  });
+  os.flush();
+  message(str);
+}
+
+} // namespace wasm
+} // namespace lld
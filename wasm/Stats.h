@@ -0,0 +1,43 @@
+//===- Stats.h --------------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_STATS_H
+#define LLD_WASM_STATS_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/ADT/DenseSet.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lld {
+namespace wasm {
+
+class InputChunk;
+
+// Figures collected during the link for --print-stats that can't be
+// recomputed from the symbol table once the link is done.
+struct LinkStats {
+  uint64_t inputBytes = 0;
+  uint64_t outputSize = 0;
+  std::vector<std::pair<std::string, uint64_t>> outputSections;
+
+  // The functions that ICF folded into an identical one. They are not live,
+  // but were not removed by garbage collection.
+  llvm::DenseSet<const InputChunk *> icfFolded;
+};
+
+extern LinkStats stats;
+
+// Prints the --print-stats report to stdout.
+void printStats();
+
+} // namespace wasm
+} // namespace lld
+
+#endif
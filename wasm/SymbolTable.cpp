@@ -14,6 +14,7 @@
 #include "WriterUtils.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/SetVector.h"
 
 #define DEBUG_TYPE "lld"
@@ -80,26 +81,49 @@ void SymbolTable::addCombinedLTOObject() {
   }
 }
 
+void SymbolTable::internNames(ArrayRef<InputFile *> files) {
+  parallelForEach(files, [&](InputFile *file) {
+    auto *obj = dyn_cast<ObjFile>(file);
+    if (!obj || !obj->getWasmObj())
+      return;
+    for (const SymbolRef &sym : obj->getWasmObj()->symbols()) {
+      const WasmSymbol &wasmSym =
+          obj->getWasmObj()->getWasmSymbol(sym.getRawDataRefImpl());
+      if (wasmSym.isBindingLocal() ||
+          wasmSym.Info.Kind == WASM_SYMBOL_TYPE_SECTION)
+        continue;
+      CachedHashStringRef name(wasmSym.Info.Name);
+      SymMapShard &shard = symMapShards[name.hash() >> (32 - symMapShardBits)];
+      std::lock_guard<std::mutex> lock(shard.mu);
+      shard.map.insert({name, -2});
+    }
+  });
+}
+
 Symbol *SymbolTable::find(StringRef name) {
-  auto it = symMap.find(CachedHashStringRef(name));
-  if (it == symMap.end() || it->second == -1)
+  CachedHashStringRef key(name);
+  auto &symMap = getSymMap(key);
+  auto it = symMap.find(key);
+  if (it == symMap.end() || it->second < 0)
     return nullptr;
   return symVector[it->second];
 }
 
 void SymbolTable::replace(StringRef name, Symbol* sym) {
-  auto it = symMap.find(CachedHashStringRef(name));
+  CachedHashStringRef key(name);
+  auto it = getSymMap(key).find(key);
   symVector[it->second] = sym;
 }
 
 std::pair<Symbol *, bool> SymbolTable::insertName(StringRef name) {
   bool trace = false;
-  auto p = symMap.insert({CachedHashStringRef(name), (int)symVector.size()});
+  CachedHashStringRef key(name);
+  auto p = getSymMap(key).insert({key, (int)symVector.size()});
   int &symIndex = p.first->second;
   bool isNew = p.second;
-  if (symIndex == -1) {
+  if (symIndex < 0) {
+    trace = symIndex == -1;
     symIndex = symVector.size();
-    trace = true;
     isNew = true;
   }
 
@@ -596,14 +620,19 @@ bool SymbolTable::getFunctionVariant(Symbol* sym, const WasmSignature *sig,
 // Set a flag for --trace-symbol so that we can print out a log message
 // if a new symbol with the same name is inserted into the symbol table.
 void SymbolTable::trace(StringRef name) {
-  symMap.insert({CachedHashStringRef(name), -1});
+  CachedHashStringRef key(name);
+  getSymMap(key).insert({key, -1});
 }
 
 void SymbolTable::wrap(Symbol *sym, Symbol *real, Symbol *wrap) {
-  // Swap symbols as instructed by -wrap.
-  int &origIdx = symMap[CachedHashStringRef(sym->getName())];
-  int &realIdx= symMap[CachedHashStringRef(real->getName())];
-  int &wrapIdx = symMap[CachedHashStringRef(wrap->getName())];
+  // Swap symbols as instructed by -wrap.  All three symbols already exist,
+  // so none of these lookups inserts into (and rehashes) a shard.
+  CachedHashStringRef origKey(sym->getName());
+  CachedHashStringRef realKey(real->getName());
+  CachedHashStringRef wrapKey(wrap->getName());
+  int &origIdx = getSymMap(origKey)[origKey];
+  int &realIdx = getSymMap(realKey)[realKey];
+  int &wrapIdx = getSymMap(wrapKey)[wrapKey];
   LLVM_DEBUG(dbgs() << "wrap: " << sym->getName() << "\n");
 
   // Anyone looking up __real symbols should get the original
@@ -15,6 +15,7 @@
 #include "lld/Common/LLVM.h"
 #include "llvm/ADT/CachedHashString.h"
 #include "llvm/ADT/DenseSet.h"
+#include <mutex>
 
 namespace lld {
 namespace wasm {
@@ -39,6 +40,12 @@ public:
 
   void addFile(InputFile *file);
 
+  // Inserts the names of the global symbols of the given (already decoded)
+  // object files into the table on multiple threads.  This doesn't resolve
+  // anything: the names are only given an entry so that the serial add*
+  // calls don't have to grow the table.
+  void internNames(ArrayRef<InputFile *> files);
+
   void addCombinedLTOObject();
 
   ArrayRef<Symbol *> getSymbols() const { return symVector; }
@@ -99,8 +106,25 @@ private:
 
   // Maps symbol names to index into the symVector.  -1 means that symbols
   // is to not yet in the vector but it should have tracing enabled if it is
-  // ever added.
-  llvm::DenseMap<llvm::CachedHashStringRef, int> symMap;
+  // ever added.  -2 means the name has been interned by internNames but the
+  // symbol hasn't been added yet.
+  //
+  // The map is split into shards by the top bits of the name's hash, each
+  // with its own lock, so that internNames can fill it from many threads.
+  // Symbols are still only added to symVector by the serial add* calls, so
+  // the order of symVector doesn't depend on threading.
+  struct SymMapShard {
+    std::mutex mu;
+    llvm::DenseMap<llvm::CachedHashStringRef, int> map;
+  };
+  static constexpr unsigned symMapShardBits = 6;
+  SymMapShard symMapShards[1 << symMapShardBits];
+
+  llvm::DenseMap<llvm::CachedHashStringRef, int> &
+  getSymMap(llvm::CachedHashStringRef name) {
+    return symMapShards[name.hash() >> (32 - symMapShardBits)].map;
+  }
+
   std::vector<Symbol *> symVector;
 
   // For certain symbols types, e.g. function symbols, we allow for muliple
@@ -16,6 +16,7 @@
 #include "OutputSegment.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Strings.h"
+#include <mutex>
 
 #define DEBUG_TYPE "lld"
 
@@ -23,8 +24,27 @@ using namespace llvm;
 using namespace llvm::wasm;
 
 namespace lld {
+// Demangling is relatively expensive, and the same symbols tend to be
+// printed more than once, by diagnostics, the map file and the name section,
+// so the results are cached.  toString can be called from several threads.
+static std::mutex demangleCacheMutex;
+static DenseMap<const wasm::Symbol *, std::string> demangleCache;
+
 std::string toString(const wasm::Symbol &sym) {
-  return maybeDemangleSymbol(sym.getName());
+  if (!wasm::config->demangle)
+    return sym.getName();
+
+  {
+    std::lock_guard<std::mutex> lock(demangleCacheMutex);
+    auto it = demangleCache.find(&sym);
+    if (it != demangleCache.end())
+      return it->second;
+  }
+
+  std::string name = demangleItanium(sym.getName());
+  std::lock_guard<std::mutex> lock(demangleCacheMutex);
+  demangleCache.try_emplace(&sym, name);
+  return name;
 }
 
 std::string maybeDemangleSymbol(StringRef name) {
@@ -78,6 +98,30 @@ DefinedData *WasmSym::definedTableBase;
 UndefinedGlobal *WasmSym::memoryBase;
 DefinedData *WasmSym::definedMemoryBase;
 
+void WasmSym::reset() {
+  callCtors = nullptr;
+  initMemory = nullptr;
+  applyRelocs = nullptr;
+  initTLS = nullptr;
+  dsoHandle = nullptr;
+  dataEnd = nullptr;
+  globalBase = nullptr;
+  heapBase = nullptr;
+  initMemoryFlag = nullptr;
+  stackPointer = nullptr;
+  tlsBase = nullptr;
+  tlsSize = nullptr;
+  tlsAlign = nullptr;
+  tableBase = nullptr;
+  definedTableBase = nullptr;
+  memoryBase = nullptr;
+  definedMemoryBase = nullptr;
+
+  // The cached names are keyed by the symbols, whose memory is reused.
+  std::lock_guard<std::mutex> lock(demangleCacheMutex);
+  demangleCache.clear();
+}
+
 WasmSymbolType Symbol::getWasmType() const {
   if (isa<FunctionSymbol>(this))
     return WASM_SYMBOL_TYPE_FUNCTION;
@@ -254,8 +298,9 @@ uint32_t DefinedData::getVirtualAddress() const {
     // the .tdata section, since they are used as offsets from __tls_base.
     // Hence, we do not add in segment->outputSeg->startVA.
     if (segment->outputSeg->name == ".tdata")
-      return segment->outputSegmentOffset + offset;
-    return segment->outputSeg->startVA + segment->outputSegmentOffset + offset;
+      return segment->getOutputSegmentOffset(offset);
+    return segment->outputSeg->startVA +
+           segment->getOutputSegmentOffset(offset);
   }
   return offset;
 }
@@ -268,7 +313,7 @@ void DefinedData::setVirtualAddress(uint32_t value) {
 
 uint32_t DefinedData::getOutputSegmentOffset() const {
   LLVM_DEBUG(dbgs() << "getOutputSegmentOffset: " << getName() << "\n");
-  return segment->outputSegmentOffset + offset;
+  return segment->getOutputSegmentOffset(offset);
 }
 
 uint32_t DefinedData::getOutputSegmentIndex() const {
@@ -489,6 +489,9 @@ struct WasmSym {
   // Used in PIC code for offset of global data
   static UndefinedGlobal *memoryBase;
   static DefinedData *definedMemoryBase;
+
+  // Forgets the symbols of the previous link in the same process.
+  static void reset();
 };
 
 // A buffer class that is large enough to hold any Symbol-derived
@@ -17,7 +17,10 @@
 #include "InputGlobal.h"
 #include "OutputSegment.h"
 #include "SymbolTable.h"
+#include "lld/Common/Threads.h"
+#include "llvm/Support/LEB128.h"
 #include "llvm/Support/Path.h"
+#include <numeric>
 
 using namespace llvm;
 using namespace llvm::wasm;
@@ -55,6 +58,30 @@ public:
 
 } // namespace
 
+size_t EntryBlocks::layout(size_t n, function_ref<size_t(size_t)> getSize) {
+  numEntries = n;
+  size_t numBlocks = (n + blockSize - 1) / blockSize;
+  offsets.assign(numBlocks + 1, 0);
+  parallelForEachN(0, numBlocks, [&](size_t i) {
+    size_t end = std::min(n, (i + 1) * blockSize);
+    for (size_t j = i * blockSize; j != end; ++j)
+      offsets[i + 1] += getSize(j);
+  });
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  return offsets.back();
+}
+
+void EntryBlocks::write(
+    uint8_t *buf, function_ref<void(uint8_t *&, size_t)> writeEntry) const {
+  parallelForEachN(0, offsets.size() - 1, [&](size_t i) {
+    uint8_t *p = buf + offsets[i];
+    size_t end = std::min(numEntries, (i + 1) * blockSize);
+    for (size_t j = i * blockSize; j != end; ++j)
+      writeEntry(p, j);
+    assert(p == buf + offsets[i + 1] && "entry size mismatch");
+  });
+}
+
 void DylinkSection::writeBody() {
   raw_ostream &os = bodyOutputStream;
 
@@ -152,37 +179,14 @@ void ImportSection::writeBody() {
     import.Table.Limits = {0, tableSize, 0};
     writeImport(os, import);
   }
+}
 
-  for (const Symbol *sym : importedSymbols) {
-    WasmImport import;
-    if (auto *f = dyn_cast<UndefinedFunction>(sym)) {
-      import.Field = f->importName;
-      import.Module = f->importModule;
-    } else if (auto *g = dyn_cast<UndefinedGlobal>(sym)) {
-      import.Field = g->importName;
-      import.Module = g->importModule;
-    } else {
-      import.Field = sym->getName();
-      import.Module = defaultModule;
-    }
-
-    if (auto *functionSym = dyn_cast<FunctionSymbol>(sym)) {
-      import.Kind = WASM_EXTERNAL_FUNCTION;
-      import.SigIndex = out.typeSec->lookupType(*functionSym->signature);
-    } else if (auto *globalSym = dyn_cast<GlobalSymbol>(sym)) {
-      import.Kind = WASM_EXTERNAL_GLOBAL;
-      import.Global = *globalSym->getGlobalType();
-    } else {
-      auto *eventSym = cast<EventSymbol>(sym);
-      import.Kind = WASM_EXTERNAL_EVENT;
-      import.Event.Attribute = eventSym->getEventType()->Attribute;
-      import.Event.SigIndex = out.typeSec->lookupType(*eventSym->signature);
-    }
-    writeImport(os, import);
-  }
-
-  for (const Symbol *sym : gotSymbols) {
-    WasmImport import;
+// Returns the i-th import of importedSymbols followed by gotSymbols. These
+// are written by writeBodyTo() after the imports that writeBody() wrote.
+WasmImport ImportSection::getImport(size_t i) const {
+  WasmImport import;
+  if (i >= importedSymbols.size()) {
+    const Symbol *sym = gotSymbols[i - importedSymbols.size()];
     import.Kind = WASM_EXTERNAL_GLOBAL;
     import.Global = {WASM_TYPE_I32, true};
     if (isa<DataSymbol>(sym))
@@ -190,8 +194,44 @@ void ImportSection::writeBody() {
     else
       import.Module = "GOT.func";
     import.Field = sym->getName();
-    writeImport(os, import);
+    return import;
+  }
+
+  const Symbol *sym = importedSymbols[i];
+  if (auto *f = dyn_cast<UndefinedFunction>(sym)) {
+    import.Field = f->importName;
+    import.Module = f->importModule;
+  } else if (auto *g = dyn_cast<UndefinedGlobal>(sym)) {
+    import.Field = g->importName;
+    import.Module = g->importModule;
+  } else {
+    import.Field = sym->getName();
+    import.Module = defaultModule;
   }
+
+  if (auto *functionSym = dyn_cast<FunctionSymbol>(sym)) {
+    import.Kind = WASM_EXTERNAL_FUNCTION;
+    import.SigIndex = out.typeSec->lookupType(*functionSym->signature);
+  } else if (auto *globalSym = dyn_cast<GlobalSymbol>(sym)) {
+    import.Kind = WASM_EXTERNAL_GLOBAL;
+    import.Global = *globalSym->getGlobalType();
+  } else {
+    auto *eventSym = cast<EventSymbol>(sym);
+    import.Kind = WASM_EXTERNAL_EVENT;
+    import.Event.Attribute = eventSym->getEventType()->Attribute;
+    import.Event.SigIndex = out.typeSec->lookupType(*eventSym->signature);
+  }
+  return import;
+}
+
+size_t ImportSection::computeBodySize() {
+  return blocks.layout(importedSymbols.size() + gotSymbols.size(),
+                       [&](size_t i) { return getImportSize(getImport(i)); });
+}
+
+void ImportSection::writeBodyTo(uint8_t *buf) {
+  blocks.write(buf,
+               [&](uint8_t *&p, size_t i) { writeImport(p, getImport(i)); });
 }
 
 void FunctionSection::writeBody() {
@@ -203,7 +243,7 @@ void FunctionSection::writeBody() {
 }
 
 void FunctionSection::addFunction(InputFunction *func) {
-  if (!func->live)
+  if (!func->live || func->deferred)
     return;
   uint32_t functionIndex =
       out.importSec->getNumImportedFunctions() + inputFunctions.size();
@@ -244,21 +284,49 @@ void GlobalSection::assignIndexes() {
   uint32_t globalIndex = out.importSec->getNumImportedGlobals();
   for (InputGlobal *g : inputGlobals)
     g->setGlobalIndex(globalIndex++);
-  for (Symbol *sym : staticGotSymbols)
+  for (Symbol *sym : internalGotSymbols)
     sym->setGOTIndex(globalIndex++);
   isSealed = true;
 }
 
-void GlobalSection::addStaticGOTEntry(Symbol *sym) {
+void GlobalSection::addInternalGOTEntry(Symbol *sym) {
   assert(!isSealed);
   if (sym->requiresGOT)
     return;
-  LLVM_DEBUG(dbgs() << "addStaticGOTEntry: " << sym->getName() << " "
+  LLVM_DEBUG(dbgs() << "addInternalGOTEntry: " << sym->getName() << " "
                     << toString(sym->kind()) << "\n");
   sym->requiresGOT = true;
   if (auto *F = dyn_cast<FunctionSymbol>(sym))
     out.elemSec->addEntry(F);
-  staticGotSymbols.push_back(sym);
+  internalGotSymbols.push_back(sym);
+}
+
+// In PIC mode the values of the internal GOT entries are not known until the
+// module is loaded, so they are mutable globals that start out as zero, and
+// __wasm_apply_relocs adds __memory_base or __table_base to them.
+void GlobalSection::generateRelocationCode(raw_ostream &os) const {
+  for (const Symbol *sym : internalGotSymbols) {
+    const GlobalSymbol *base;
+    uint32_t offset;
+    if (auto *d = dyn_cast<DefinedData>(sym)) {
+      base = WasmSym::memoryBase;
+      offset = d->getVirtualAddress();
+    } else if (auto *f = dyn_cast<FunctionSymbol>(sym)) {
+      base = WasmSym::tableBase;
+      offset = f->getTableIndex();
+    } else {
+      // An undefined weak symbol has the address zero.
+      continue;
+    }
+
+    writeU8(os, WASM_OPCODE_GLOBAL_GET, "GLOBAL_GET");
+    writeUleb128(os, base->getGlobalIndex(), "base");
+    writeU8(os, WASM_OPCODE_I32_CONST, "CONST");
+    writeSleb128(os, offset, "offset");
+    writeU8(os, WASM_OPCODE_I32_ADD, "ADD");
+    writeU8(os, WASM_OPCODE_GLOBAL_SET, "GLOBAL_SET");
+    writeUleb128(os, sym->getGOTIndex(), "got index");
+  }
 }
 
 void GlobalSection::writeBody() {
@@ -267,11 +335,13 @@ void GlobalSection::writeBody() {
   writeUleb128(os, numGlobals(), "global count");
   for (InputGlobal *g : inputGlobals)
     writeGlobal(os, g->global);
-  for (const Symbol *sym : staticGotSymbols) {
+  for (const Symbol *sym : internalGotSymbols) {
     WasmGlobal global;
-    global.Type = {WASM_TYPE_I32, false};
+    global.Type = {WASM_TYPE_I32, config->isPic};
     global.InitExpr.Opcode = WASM_OPCODE_I32_CONST;
-    if (auto *d = dyn_cast<DefinedData>(sym))
+    if (config->isPic)
+      global.InitExpr.Value.Int32 = 0;
+    else if (auto *d = dyn_cast<DefinedData>(sym))
       global.InitExpr.Value.Int32 = d->getVirtualAddress();
     else if (auto *f = dyn_cast<FunctionSymbol>(sym))
       global.InitExpr.Value.Int32 = f->getTableIndex();
@@ -317,12 +387,17 @@ void EventSection::addEvent(InputEvent *event) {
   inputEvents.push_back(event);
 }
 
-void ExportSection::writeBody() {
-  raw_ostream &os = bodyOutputStream;
+size_t ExportSection::computeBodySize() {
+  return getULEB128Size(exports.size()) +
+         blocks.layout(exports.size(), [&](size_t i) {
+           return getExportSize(exports[i]);
+         });
+}
 
-  writeUleb128(os, exports.size(), "export count");
-  for (const WasmExport &export_ : exports)
-    writeExport(os, export_);
+void ExportSection::writeBodyTo(uint8_t *buf) {
+  writeUleb128(buf, exports.size());
+  blocks.write(buf,
+               [&](uint8_t *&p, size_t i) { writeExport(p, exports[i]); });
 }
 
 bool StartSection::isNeeded() const {
@@ -356,13 +431,21 @@ void ElemSection::writeBody() {
   }
   writeInitExpr(os, initExpr);
   writeUleb128(os, indirectFunctions.size(), "elem count");
+}
 
-  uint32_t tableIndex = config->tableBase;
-  for (const FunctionSymbol *sym : indirectFunctions) {
-    assert(sym->getTableIndex() == tableIndex);
-    writeUleb128(os, sym->getFunctionIndex(), "function index");
-    ++tableIndex;
-  }
+// The function indices of the entries follow what writeBody() wrote.
+size_t ElemSection::computeBodySize() {
+  return blocks.layout(indirectFunctions.size(), [&](size_t i) {
+    return getULEB128Size(indirectFunctions[i]->getFunctionIndex());
+  });
+}
+
+void ElemSection::writeBodyTo(uint8_t *buf) {
+  blocks.write(buf, [&](uint8_t *&p, size_t i) {
+    const FunctionSymbol *sym = indirectFunctions[i];
+    assert(sym->getTableIndex() == config->tableBase + i);
+    writeUleb128(p, sym->getFunctionIndex());
+  });
 }
 
 DataCountSection::DataCountSection(ArrayRef<OutputSegment *> segments)
@@ -379,6 +462,40 @@ bool DataCountSection::isNeeded() const {
   return numSegments && config->sharedMemory;
 }
 
+// Writes one entry of the WASM_SYMBOL_TABLE subsection.
+static void writeSymtabEntry(raw_ostream &os, const Symbol *sym) {
+  assert(sym->isDefined() || sym->isUndefined());
+  WasmSymbolType kind = sym->getWasmType();
+  uint32_t flags = sym->getFlags();
+
+  writeU8(os, kind, "sym kind");
+  writeUleb128(os, flags, "sym flags");
+
+  if (auto *f = dyn_cast<FunctionSymbol>(sym)) {
+    writeUleb128(os, f->getFunctionIndex(), "index");
+    if (sym->isDefined() || (flags & WASM_SYMBOL_EXPLICIT_NAME) != 0)
+      writeStr(os, sym->getName(), "sym name");
+  } else if (auto *g = dyn_cast<GlobalSymbol>(sym)) {
+    writeUleb128(os, g->getGlobalIndex(), "index");
+    if (sym->isDefined() || (flags & WASM_SYMBOL_EXPLICIT_NAME) != 0)
+      writeStr(os, sym->getName(), "sym name");
+  } else if (auto *e = dyn_cast<EventSymbol>(sym)) {
+    writeUleb128(os, e->getEventIndex(), "index");
+    if (sym->isDefined() || (flags & WASM_SYMBOL_EXPLICIT_NAME) != 0)
+      writeStr(os, sym->getName(), "sym name");
+  } else if (isa<DataSymbol>(sym)) {
+    writeStr(os, sym->getName(), "sym name");
+    if (auto *dataSym = dyn_cast<DefinedData>(sym)) {
+      writeUleb128(os, dataSym->getOutputSegmentIndex(), "index");
+      writeUleb128(os, dataSym->getOutputSegmentOffset(), "data offset");
+      writeUleb128(os, dataSym->getSize(), "data size");
+    }
+  } else {
+    auto *s = cast<OutputSectionSymbol>(sym);
+    writeUleb128(os, s->section->sectionIndex, "sym section index");
+  }
+}
+
 void LinkingSection::writeBody() {
   raw_ostream &os = bodyOutputStream;
 
@@ -388,39 +505,18 @@ void LinkingSection::writeBody() {
     SubSection sub(WASM_SYMBOL_TABLE);
     writeUleb128(sub.os, symtabEntries.size(), "num symbols");
 
-    for (const Symbol *sym : symtabEntries) {
-      assert(sym->isDefined() || sym->isUndefined());
-      WasmSymbolType kind = sym->getWasmType();
-      uint32_t flags = sym->getFlags();
-
-      writeU8(sub.os, kind, "sym kind");
-      writeUleb128(sub.os, flags, "sym flags");
-
-      if (auto *f = dyn_cast<FunctionSymbol>(sym)) {
-        writeUleb128(sub.os, f->getFunctionIndex(), "index");
-        if (sym->isDefined() || (flags & WASM_SYMBOL_EXPLICIT_NAME) != 0)
-          writeStr(sub.os, sym->getName(), "sym name");
-      } else if (auto *g = dyn_cast<GlobalSymbol>(sym)) {
-        writeUleb128(sub.os, g->getGlobalIndex(), "index");
-        if (sym->isDefined() || (flags & WASM_SYMBOL_EXPLICIT_NAME) != 0)
-          writeStr(sub.os, sym->getName(), "sym name");
-      } else if (auto *e = dyn_cast<EventSymbol>(sym)) {
-        writeUleb128(sub.os, e->getEventIndex(), "index");
-        if (sym->isDefined() || (flags & WASM_SYMBOL_EXPLICIT_NAME) != 0)
-          writeStr(sub.os, sym->getName(), "sym name");
-      } else if (isa<DataSymbol>(sym)) {
-        writeStr(sub.os, sym->getName(), "sym name");
-        if (auto *dataSym = dyn_cast<DefinedData>(sym)) {
-          writeUleb128(sub.os, dataSym->getOutputSegmentIndex(), "index");
-          writeUleb128(sub.os, dataSym->getOutputSegmentOffset(),
-                       "data offset");
-          writeUleb128(sub.os, dataSym->getSize(), "data size");
-        }
-      } else {
-        auto *s = cast<OutputSectionSymbol>(sym);
-        writeUleb128(sub.os, s->section->sectionIndex, "sym section index");
-      }
-    }
+    // Encode blocks of symbols in parallel and concatenate the results.
+    const size_t blockSize = 1024;
+    size_t numBlocks = (symtabEntries.size() + blockSize - 1) / blockSize;
+    std::vector<std::string> encoded(numBlocks);
+    parallelForEachN(0, numBlocks, [&](size_t i) {
+      raw_string_ostream blockOS(encoded[i]);
+      size_t end = std::min(symtabEntries.size(), (i + 1) * blockSize);
+      for (size_t j = i * blockSize; j != end; ++j)
+        writeSymtabEntry(blockOS, symtabEntries[j]);
+    });
+    for (const std::string &block : encoded)
+      sub.os << block;
 
     sub.writeTo(os);
   }
@@ -501,32 +597,62 @@ unsigned NameSection::numNames() const {
   return numNames;
 }
 
-// Create the custom "name" section containing debug symbol names.
-void NameSection::writeBody() {
-  SubSection sub(WASM_NAMES_FUNCTION);
-  writeUleb128(sub.os, numNames(), "name count");
+// Create the custom "name" section containing debug symbol names. The body
+// is a single function names subsection.
+size_t NameSection::computeBodySize() {
+  ArrayRef<InputFunction *> functions = out.functionSec->inputFunctions;
+  const size_t blockSize = 1024;
+  size_t numBlocks = (functions.size() + blockSize - 1) / blockSize;
+  encoded.resize(numBlocks + 1);
 
   // Names must appear in function index order.  As it happens importedSymbols
   // and inputFunctions are numbered in order with imported functions coming
   // first.
-  for (const Symbol *s : out.importSec->importedSymbols) {
-    if (auto *f = dyn_cast<FunctionSymbol>(s)) {
-      writeUleb128(sub.os, f->getFunctionIndex(), "func index");
-      writeStr(sub.os, toString(*s), "symbol name");
-    }
-  }
-  for (const InputFunction *f : out.functionSec->inputFunctions) {
-    if (!f->getName().empty()) {
-      writeUleb128(sub.os, f->getFunctionIndex(), "func index");
-      if (!f->getDebugName().empty()) {
-        writeStr(sub.os, f->getDebugName(), "symbol name");
-      } else {
-        writeStr(sub.os, maybeDemangleSymbol(f->getName()), "symbol name");
+  {
+    raw_string_ostream os(encoded[0]);
+    writeUleb128(os, numNames(), "name count");
+    for (const Symbol *s : out.importSec->importedSymbols) {
+      if (auto *f = dyn_cast<FunctionSymbol>(s)) {
+        writeUleb128(os, f->getFunctionIndex(), "func index");
+        writeStr(os, toString(*s), "symbol name");
       }
     }
   }
 
-  sub.writeTo(bodyOutputStream);
+  // Demangling dominates the cost of this section, so blocks of functions
+  // are encoded in parallel, and then copied straight to the output.
+  parallelForEachN(0, numBlocks, [&](size_t i) {
+    raw_string_ostream os(encoded[i + 1]);
+    size_t end = std::min(functions.size(), (i + 1) * blockSize);
+    for (size_t j = i * blockSize; j != end; ++j) {
+      const InputFunction *f = functions[j];
+      if (f->getName().empty())
+        continue;
+      writeUleb128(os, f->getFunctionIndex(), "func index");
+      if (!f->getDebugName().empty())
+        writeStr(os, f->getDebugName(), "symbol name");
+      else
+        writeStr(os, maybeDemangleSymbol(f->getName()), "symbol name");
+    }
+  });
+
+  payloadSize = 0;
+  for (const std::string &block : encoded)
+    payloadSize += block.size();
+  return getULEB128Size(WASM_NAMES_FUNCTION) + getULEB128Size(payloadSize) +
+         payloadSize;
+}
+
+void NameSection::writeBodyTo(uint8_t *buf) {
+  writeUleb128(buf, WASM_NAMES_FUNCTION);
+  writeUleb128(buf, payloadSize);
+
+  std::vector<size_t> offsets(encoded.size() + 1);
+  for (size_t i = 0, e = encoded.size(); i != e; ++i)
+    offsets[i + 1] = offsets[i] + encoded[i].size();
+  parallelForEachN(0, encoded.size(), [&](size_t i) {
+    memcpy(buf + offsets[i], encoded[i].data(), encoded[i].size());
+  });
 }
 
 void ProducersSection::addInfo(const WasmProducerInfo &info) {
@@ -536,7 +662,7 @@ void ProducersSection::addInfo(const WasmProducerInfo &info) {
     for (auto &producer : *producers.first)
       if (producers.second->end() ==
           llvm::find_if(*producers.second,
-                        [&](std::pair<std::string, std::string> seen) {
+                        [&](const std::pair<std::string, std::string> &seen) {
                           return seen.first == producer.first;
                         }))
         producers.second->push_back(producer);
@@ -570,6 +696,82 @@ void TargetFeaturesSection::writeBody() {
   }
 }
 
+void ExternalDebugInfoSection::writeBody() {
+  writeStr(bodyOutputStream, config->separateDebugFile, "debug file url");
+}
+
+void CompilationHintsSection::writeBody() {
+  struct Counts {
+    uint64_t callsMade = 0;
+    uint64_t callsReceived = 0;
+  };
+  MapVector<const InputFunction *, Counts> counts;
+  for (const auto &entry : config->callGraphProfile) {
+    counts[entry.first.first].callsMade += entry.second;
+    counts[entry.first.second].callsReceived += entry.second;
+  }
+
+  // Functions that were garbage collected, folded or moved by --split-module
+  // have no index in the output.
+  std::vector<std::pair<const InputFunction *, Counts>> hot;
+  for (const auto &entry : counts)
+    if (entry.first->live && entry.first->hasFunctionIndex())
+      hot.push_back(entry);
+  llvm::stable_sort(hot, [](const std::pair<const InputFunction *, Counts> &a,
+                            const std::pair<const InputFunction *, Counts> &b) {
+    uint64_t wa = a.second.callsMade + a.second.callsReceived;
+    uint64_t wb = b.second.callsMade + b.second.callsReceived;
+    if (wa != wb)
+      return wa > wb;
+    return a.first->getFunctionIndex() < b.first->getFunctionIndex();
+  });
+
+  raw_ostream &os = bodyOutputStream;
+  writeUleb128(os, hot.size(), "function count");
+  for (const auto &entry : hot) {
+    writeUleb128(os, entry.first->getFunctionIndex(), "function index");
+    encodeULEB128(entry.second.callsMade, os);
+    encodeULEB128(entry.second.callsReceived, os);
+  }
+}
+
+static uint32_t getHashSize() {
+  switch (config->buildId) {
+  case BuildIdKind::None:
+    return 0;
+  case BuildIdKind::Fast:
+    return 8;
+  case BuildIdKind::Md5:
+  case BuildIdKind::Uuid:
+    return 16;
+  case BuildIdKind::Sha1:
+    return 20;
+  case BuildIdKind::Hexstring:
+    return config->buildIdVector.size();
+  }
+  llvm_unreachable("unknown BuildIdKind");
+}
+
+BuildIdSection::BuildIdSection()
+    : SyntheticSection(llvm::wasm::WASM_SEC_CUSTOM, "build_id"),
+      hashSize(getHashSize()) {}
+
+void BuildIdSection::writeBody() {
+  auto &os = bodyOutputStream;
+  writeUleb128(os, hashSize, "build id size");
+  os.write_zeros(hashSize);
+}
+
+void BuildIdSection::writeTo(uint8_t *buf) {
+  SyntheticSection::writeTo(buf);
+  hashPlaceholderPtr = buf + getSize() - hashSize;
+}
+
+void BuildIdSection::writeBuildId(ArrayRef<uint8_t> buf) {
+  assert(buf.size() == hashSize);
+  memcpy(hashPlaceholderPtr, buf.data(), hashSize);
+}
+
 void RelocSection::writeBody() {
   uint32_t count = sec->getNumRelocations();
   assert(sec->sectionIndex != UINT32_MAX);
@@ -33,6 +33,25 @@ struct WasmInitEntry {
   uint32_t priority;
 };
 
+// Splits the entries of a section that is written straight into the output
+// buffer into blocks, so that the entries can be sized and written in
+// parallel.
+class EntryBlocks {
+public:
+  // Computes where each block starts from the sizes of the n entries and
+  // returns their total size.
+  size_t layout(size_t n, llvm::function_ref<size_t(size_t)> getSize);
+
+  // Writes the entries to buf, each block on its own thread.
+  void write(uint8_t *buf,
+             llvm::function_ref<void(uint8_t *&, size_t)> writeEntry) const;
+
+private:
+  static const size_t blockSize = 1024;
+  size_t numEntries = 0;
+  std::vector<size_t> offsets;
+};
+
 class SyntheticSection : public OutputSection {
 public:
   SyntheticSection(uint32_t type, std::string name = "")
@@ -44,20 +63,33 @@ public:
   void writeTo(uint8_t *buf) override {
     assert(offset);
     log("writing " + toString(*this));
-    memcpy(buf + offset, header.data(), header.size());
-    memcpy(buf + offset + header.size(), body.data(), body.size());
+    memcpy(buf, header.data(), header.size());
+    memcpy(buf + header.size(), body.data(), body.size());
+    if (directBodySize)
+      writeBodyTo(buf + header.size() + body.size());
   }
 
-  size_t getSize() const override { return header.size() + body.size(); }
+  size_t getSize() const override {
+    return header.size() + body.size() + directBodySize;
+  }
 
   virtual void writeBody() {}
 
+  // Sections that can be large encode their bodies, or the part of them that
+  // follows what writeBody() wrote, straight into the output buffer instead
+  // of into body, which saves a copy and a large temporary.
+  // computeBodySize() returns the exact number of bytes that writeBodyTo()
+  // writes.
+  virtual size_t computeBodySize() { return 0; }
+  virtual void writeBodyTo(uint8_t *buf) {}
+
   virtual void assignIndexes() {}
 
   void finalizeContents() override {
     writeBody();
     bodyOutputStream.flush();
-    createHeader(body.size());
+    directBodySize = computeBodySize();
+    createHeader(body.size() + directBodySize);
   }
 
   raw_ostream &getStream() { return bodyOutputStream; }
@@ -66,6 +98,7 @@ public:
 
 protected:
   llvm::raw_string_ostream bodyOutputStream;
+  size_t directBodySize = 0;
 };
 
 // Create the custom "dylink" section containing information for the dynamic
@@ -101,6 +134,8 @@ public:
   ImportSection() : SyntheticSection(llvm::wasm::WASM_SEC_IMPORT) {}
   bool isNeeded() const override { return getNumImports() > 0; }
   void writeBody() override;
+  size_t computeBodySize() override;
+  void writeBodyTo(uint8_t *buf) override;
   void addImport(Symbol *sym);
   void addGOTEntry(Symbol *sym);
   void seal() { isSealed = true; }
@@ -121,11 +156,14 @@ public:
   std::vector<const Symbol *> importedSymbols;
 
 protected:
+  llvm::wasm::WasmImport getImport(size_t i) const;
+
   bool isSealed = false;
   unsigned numImportedGlobals = 0;
   unsigned numImportedFunctions = 0;
   unsigned numImportedEvents = 0;
   std::vector<const Symbol *> gotSymbols;
+  EntryBlocks blocks;
 };
 
 class FunctionSection : public SyntheticSection {
@@ -177,21 +215,22 @@ public:
   uint32_t numGlobals() const {
     assert(isSealed);
     return inputGlobals.size() + dataAddressGlobals.size() +
-           staticGotSymbols.size();
+           internalGotSymbols.size();
   }
   bool isNeeded() const override { return numGlobals() > 0; }
   void assignIndexes() override;
   void writeBody() override;
   void addGlobal(InputGlobal *global);
   void addDataAddressGlobal(DefinedData *global);
-  void addStaticGOTEntry(Symbol *sym);
+  void addInternalGOTEntry(Symbol *sym);
+  void generateRelocationCode(raw_ostream &os) const;
 
   std::vector<const DefinedData *> dataAddressGlobals;
 
 protected:
   bool isSealed = false;
   std::vector<InputGlobal *> inputGlobals;
-  std::vector<Symbol *> staticGotSymbols;
+  std::vector<Symbol *> internalGotSymbols;
 };
 
 // The event section contains a list of declared wasm events associated with the
@@ -218,9 +257,13 @@ class ExportSection : public SyntheticSection {
 public:
   ExportSection() : SyntheticSection(llvm::wasm::WASM_SEC_EXPORT) {}
   bool isNeeded() const override { return exports.size() > 0; }
-  void writeBody() override;
+  size_t computeBodySize() override;
+  void writeBodyTo(uint8_t *buf) override;
 
   std::vector<llvm::wasm::WasmExport> exports;
+
+protected:
+  EntryBlocks blocks;
 };
 
 class StartSection : public SyntheticSection {
@@ -241,11 +284,14 @@ public:
       : SyntheticSection(llvm::wasm::WASM_SEC_ELEM) {}
   bool isNeeded() const override { return indirectFunctions.size() > 0; };
   void writeBody() override;
+  size_t computeBodySize() override;
+  void writeBodyTo(uint8_t *buf) override;
   void addEntry(FunctionSymbol *sym);
   uint32_t numEntries() const { return indirectFunctions.size(); }
 
 protected:
   std::vector<const FunctionSymbol *> indirectFunctions;
+  EntryBlocks blocks;
 };
 
 class DataCountSection : public SyntheticSection {
@@ -286,8 +332,14 @@ public:
   bool isNeeded() const override {
     return !config->stripDebug && !config->stripAll && numNames() > 0;
   }
-  void writeBody() override;
+  size_t computeBodySize() override;
+  void writeBodyTo(uint8_t *buf) override;
   unsigned numNames() const;
+
+protected:
+  // The function names subsection, encoded in blocks in parallel.
+  std::vector<std::string> encoded;
+  size_t payloadSize = 0;
 };
 
 class ProducersSection : public SyntheticSection {
@@ -321,6 +373,51 @@ public:
   llvm::SmallSet<std::string, 8> features;
 };
 
+// Create the custom "external_debug_info" section, which tells debuggers where
+// to find the debug sections that --separate-debug-file moved out of the
+// output.
+class ExternalDebugInfoSection : public SyntheticSection {
+public:
+  ExternalDebugInfoSection()
+      : SyntheticSection(llvm::wasm::WASM_SEC_CUSTOM, "external_debug_info") {}
+  bool isNeeded() const override { return !config->separateDebugFile.empty(); }
+  void writeBody() override;
+};
+
+// Create the custom "compilation_hints" section, which lists the functions
+// of the --call-graph-ordering-file profile so that engines can optimize them
+// eagerly instead of waiting for tier-up.  Each entry is the index of a
+// function followed by the number of calls it made and received in the
+// profile.  The hottest functions come first.
+class CompilationHintsSection : public SyntheticSection {
+public:
+  CompilationHintsSection()
+      : SyntheticSection(llvm::wasm::WASM_SEC_CUSTOM, "compilation_hints") {}
+  bool isNeeded() const override {
+    return config->compilationHints && !config->callGraphProfile.empty();
+  }
+  void writeBody() override;
+};
+
+// Create the custom "build_id" section containing a unique identifier for
+// the output.  The identifier is a hash of the rest of the file, so the
+// section only reserves space for it until everything else has been written.
+class BuildIdSection : public SyntheticSection {
+public:
+  BuildIdSection();
+  void writeBody() override;
+  void writeTo(uint8_t *buf) override;
+  bool isNeeded() const override {
+    return config->buildId != BuildIdKind::None;
+  }
+  void writeBuildId(ArrayRef<uint8_t> buf);
+
+  const uint32_t hashSize;
+
+private:
+  uint8_t *hashPlaceholderPtr = nullptr;
+};
+
 class RelocSection : public SyntheticSection {
 public:
   RelocSection(StringRef name, OutputSection *sec)
@@ -350,6 +447,9 @@ struct OutStruct {
   NameSection *nameSec;
   ProducersSection *producersSec;
   TargetFeaturesSection *targetFeaturesSec;
+  ExternalDebugInfoSection *externalDebugInfoSec;
+  CompilationHintsSection *compilationHintsSec;
+  BuildIdSection *buildIdSec;
 };
 
 extern OutStruct out;
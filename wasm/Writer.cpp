@@ -7,30 +7,42 @@
 //===----------------------------------------------------------------------===//
 
 #include "Writer.h"
+#include "CallGraphSort.h"
 #include "Config.h"
 #include "InputChunks.h"
 #include "InputEvent.h"
 #include "InputGlobal.h"
+#include "MapFile.h"
 #include "OutputSections.h"
 #include "OutputSegment.h"
 #include "Relocations.h"
+#include "SplitModule.h"
+#include "Stats.h"
 #include "SymbolTable.h"
 #include "SyntheticSections.h"
 #include "WriterUtils.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Filesystem.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/BinaryFormat/Wasm.h"
 #include "llvm/Object/WasmTraits.h"
 #include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/LEB128.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/RandomNumberGenerator.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/xxhash.h"
 
 #include <cstdarg>
 #include <map>
@@ -44,8 +56,35 @@ namespace lld {
 namespace wasm {
 static constexpr int stackAlignment = 16;
 
+// The largest 32-bit linear memory, 65536 pages of 64 KiB.
+static constexpr uint64_t maxMemorySize = 1ULL << 32;
+
+// The bulk-memory opcode for memory.fill (0xfc 0x0b), which is missing from
+// BinaryFormat/Wasm.h.
+static constexpr uint8_t memoryFillOpcode = 0x0b;
+
+static Timer createOutputSegmentsTimer("Create Output Segments",
+                                       Timer::root());
+static Timer layoutMemoryTimer("Memory Layout", Timer::root());
+static Timer scanRelocationsTimer("Scan Relocations", Timer::root());
+static Timer assignIndexesTimer("Assign Indexes", Timer::root());
+static Timer finalizeSectionsTimer("Finalize Sections", Timer::root());
+static Timer writeSectionsTimer("Write Sections", Timer::root());
+static Timer diskCommitTimer("Commit Output File", Timer::root());
+
 namespace {
 
+// What populateProducers and populateTargetFeatures need from an object file,
+// computed for all files in parallel by summarizeObjectFiles.  Most files of a
+// program are compiled with the same flags, so they have the same producers
+// and target features.  The hashes let the serial merges skip the lists that
+// an earlier file already contributed.
+struct FileSummary {
+  uint64_t producersHash = 0;
+  uint64_t featuresHash = 0;
+  bool usesTLS = false;
+};
+
 // The writer writes a SymbolTable result to a file.
 class Writer {
 public:
@@ -61,6 +100,7 @@ private:
 
   void assignIndexes();
   void populateSymtab();
+  void summarizeObjectFiles();
   void populateProducers();
   void populateTargetFeatures();
   void calculateInitFunctions();
@@ -85,16 +125,24 @@ private:
 
   void writeHeader();
   void writeSections();
+  void writeBuildId();
+  void streamSections();
+  void writeDebugFile();
 
   uint64_t fileSize = 0;
+  uint64_t debugFileSize = 0;
 
   std::vector<WasmInitEntry> initFunctions;
+  std::vector<FileSummary> fileSummaries;
   llvm::StringMap<std::vector<InputSection *>> customSectionMapping;
 
   // Elements that are used to construct the final output
   std::string header;
   std::vector<OutputSection *> outputSections;
 
+  // Sections moved to the --separate-debug-file output.
+  std::vector<OutputSection *> debugSections;
+
   std::unique_ptr<FileOutputBuffer> buffer;
 
   std::vector<OutputSegment *> segments;
@@ -117,6 +165,9 @@ void Writer::calculateCustomSections() {
       // .. or it is a debug section
       if (stripDebug && name.startswith(".debug_"))
         continue;
+      // .. or its compilation unit was removed by --prune-debug-info
+      if (section->discarded)
+        continue;
       customSectionMapping[name].push_back(section);
     }
   }
@@ -168,9 +219,65 @@ void Writer::createRelocSections() {
   }
 }
 
+static uint64_t hashProducers(const WasmProducerInfo &info) {
+  hash_code h = hash_combine(info.Languages.size(), info.Tools.size(),
+                             info.SDKs.size());
+  for (auto *producers : {&info.Languages, &info.Tools, &info.SDKs})
+    for (const std::pair<std::string, std::string> &producer : *producers)
+      h = hash_combine(h, producer.first, producer.second);
+  return h;
+}
+
+static bool equalProducers(const WasmProducerInfo &a,
+                           const WasmProducerInfo &b) {
+  return a.Languages == b.Languages && a.Tools == b.Tools && a.SDKs == b.SDKs;
+}
+
+static uint64_t hashFeatures(ArrayRef<WasmFeatureEntry> features) {
+  hash_code h = hash_value(features.size());
+  for (const WasmFeatureEntry &feature : features)
+    h = hash_combine(h, feature.Prefix, feature.Name);
+  return h;
+}
+
+static bool equalFeatures(ArrayRef<WasmFeatureEntry> a,
+                          ArrayRef<WasmFeatureEntry> b) {
+  return a.size() == b.size() &&
+         std::equal(a.begin(), a.end(), b.begin(),
+                    [](const WasmFeatureEntry &x, const WasmFeatureEntry &y) {
+                      return x.Prefix == y.Prefix && x.Name == y.Name;
+                    });
+}
+
+static bool isTLS(InputSegment *segment) {
+  StringRef name = segment->getName();
+  return segment->live &&
+         (name.startswith(".tdata") || name.startswith(".tbss"));
+}
+
+void Writer::summarizeObjectFiles() {
+  ArrayRef<ObjFile *> files = symtab->objectFiles;
+  fileSummaries.resize(files.size());
+  parallelForEachN(0, files.size(), [&](size_t i) {
+    const WasmObjectFile *obj = files[i]->getWasmObj();
+    FileSummary &summary = fileSummaries[i];
+    summary.producersHash = hashProducers(obj->getProducerInfo());
+    summary.featuresHash = hashFeatures(obj->getTargetFeatures());
+    summary.usesTLS = llvm::any_of(files[i]->segments, isTLS);
+  });
+}
+
 void Writer::populateProducers() {
-  for (ObjFile *file : symtab->objectFiles) {
-    const WasmProducerInfo &info = file->getWasmObj()->getProducerInfo();
+  // Adding the same producers a second time does nothing, so only the first
+  // file with each distinct list is added.
+  ArrayRef<ObjFile *> files = symtab->objectFiles;
+  DenseMap<uint64_t, size_t> seen;
+  for (size_t i = 0; i < files.size(); ++i) {
+    const WasmProducerInfo &info = files[i]->getWasmObj()->getProducerInfo();
+    auto p = seen.insert({fileSummaries[i].producersHash, i});
+    const WasmObjectFile *first = files[p.first->second]->getWasmObj();
+    if (!p.second && equalProducers(info, first->getProducerInfo()))
+      continue;
     out.producersSec->addInfo(info);
   }
 }
@@ -183,10 +290,83 @@ void Writer::writeSections() {
   uint8_t *buf = buffer->getBufferStart();
   parallelForEach(outputSections, [buf](OutputSection *s) {
     assert(s->isNeeded());
-    s->writeTo(buf);
+    s->writeTo(buf + s->getOffset());
   });
 }
 
+// Split one uint8 array into small pieces of uint8 arrays.
+static std::vector<ArrayRef<uint8_t>> split(ArrayRef<uint8_t> arr,
+                                            size_t chunkSize) {
+  std::vector<ArrayRef<uint8_t>> ret;
+  while (arr.size() > chunkSize) {
+    ret.push_back(arr.take_front(chunkSize));
+    arr = arr.drop_front(chunkSize);
+  }
+  if (!arr.empty())
+    ret.push_back(arr);
+  return ret;
+}
+
+// Computes a hash value of Data using a given hash function.
+// In order to utilize multiple cores, we first split data into 1MB
+// chunks, compute a hash for each chunk, and then compute a hash value
+// of the hash values.
+static void
+computeHash(llvm::MutableArrayRef<uint8_t> hashBuf,
+            llvm::ArrayRef<uint8_t> data,
+            std::function<void(uint8_t *dest, ArrayRef<uint8_t> arr)> hashFn) {
+  std::vector<ArrayRef<uint8_t>> chunks = split(data, 1024 * 1024);
+  std::vector<uint8_t> hashes(chunks.size() * hashBuf.size());
+
+  // Compute hash values.
+  parallelForEachN(0, chunks.size(), [&](size_t i) {
+    hashFn(hashes.data() + i * hashBuf.size(), chunks[i]);
+  });
+
+  // Write to the final output buffer.
+  hashFn(hashBuf.data(), hashes);
+}
+
+void Writer::writeBuildId() {
+  if (!out.buildIdSec->isNeeded())
+    return;
+
+  if (config->buildId == BuildIdKind::Hexstring) {
+    out.buildIdSec->writeBuildId(config->buildIdVector);
+    return;
+  }
+
+  // Compute a hash of all sections of the output file.
+  size_t hashSize = out.buildIdSec->hashSize;
+  std::vector<uint8_t> buildId(hashSize);
+  llvm::ArrayRef<uint8_t> buf{buffer->getBufferStart(), size_t(fileSize)};
+
+  switch (config->buildId) {
+  case BuildIdKind::Fast:
+    computeHash(buildId, buf, [](uint8_t *dest, ArrayRef<uint8_t> arr) {
+      support::endian::write64le(dest, xxHash64(arr));
+    });
+    break;
+  case BuildIdKind::Md5:
+    computeHash(buildId, buf, [&](uint8_t *dest, ArrayRef<uint8_t> arr) {
+      memcpy(dest, MD5::hash(arr).data(), hashSize);
+    });
+    break;
+  case BuildIdKind::Sha1:
+    computeHash(buildId, buf, [&](uint8_t *dest, ArrayRef<uint8_t> arr) {
+      memcpy(dest, SHA1::hash(arr).data(), hashSize);
+    });
+    break;
+  case BuildIdKind::Uuid:
+    if (auto ec = llvm::getRandomBytes(buildId.data(), hashSize))
+      error("entropy source failure: " + ec.message());
+    break;
+  default:
+    llvm_unreachable("unknown BuildIdKind");
+  }
+  out.buildIdSec->writeBuildId(buildId);
+}
+
 // Fix the memory layout of the output binary.  This assigns memory offsets
 // to each of the input data sections as well as the explicit stack region.
 // The default memory layout is as follows, from low to high.
@@ -200,8 +380,11 @@ void Writer::writeSections() {
 // This can be useful since it means that stack overflow traps immediately
 // rather than overwriting global data, but also increases code size since all
 // static data loads and stores requires larger offsets.
+//
+// The layout is computed in 64 bits, so that a module that does not fit in
+// 32-bit linear memory is diagnosed instead of silently wrapping around.
 void Writer::layoutMemory() {
-  uint32_t memoryPtr = 0;
+  uint64_t memoryPtr = 0;
 
   auto placeStack = [&]() {
     if (config->relocatable || config->isPic)
@@ -229,7 +412,7 @@ void Writer::layoutMemory() {
   if (WasmSym::definedMemoryBase)
     WasmSym::definedMemoryBase->setVirtualAddress(memoryPtr);
 
-  uint32_t dataStart = memoryPtr;
+  uint64_t dataStart = memoryPtr;
 
   // Arbitrarily set __dso_handle handle to point to the start of the data
   // segments.
@@ -244,6 +427,12 @@ void Writer::layoutMemory() {
     log(formatv("mem: {0,-15} offset={1,-8} size={2,-8} align={3}", seg->name,
                 memoryPtr, seg->size, seg->alignment));
     memoryPtr += seg->size;
+    if (memoryPtr > maxMemorySize) {
+      error("output segment " + seg->name + " ends at " + Twine(memoryPtr) +
+            ", which is beyond the " + Twine(maxMemorySize) +
+            "-byte limit of 32-bit linear memory");
+      return;
+    }
 
     if (WasmSym::tlsSize && seg->name == ".tdata") {
       auto *tlsSize = cast<DefinedGlobal>(WasmSym::tlsSize);
@@ -283,9 +472,19 @@ void Writer::layoutMemory() {
   if (WasmSym::heapBase)
     WasmSym::heapBase->setVirtualAddress(memoryPtr);
 
+  if (memoryPtr > maxMemorySize) {
+    error("memory size is " + Twine(memoryPtr) +
+          " bytes, which is beyond the " + Twine(maxMemorySize) +
+          "-byte limit of 32-bit linear memory");
+    return;
+  }
+
   if (config->initialMemory != 0) {
     if (config->initialMemory != alignTo(config->initialMemory, WasmPageSize))
       error("initial memory must be " + Twine(WasmPageSize) + "-byte aligned");
+    if (config->initialMemory > maxMemorySize)
+      error("initial memory must not be larger than " + Twine(maxMemorySize) +
+            " bytes");
     if (memoryPtr > config->initialMemory)
       error("initial memory too small, " + Twine(memoryPtr) + " bytes needed");
     else
@@ -300,6 +499,9 @@ void Writer::layoutMemory() {
   if (config->maxMemory != 0 || config->sharedMemory) {
     if (config->maxMemory != alignTo(config->maxMemory, WasmPageSize))
       error("maximum memory must be " + Twine(WasmPageSize) + "-byte aligned");
+    if (config->maxMemory > maxMemorySize)
+      error("maximum memory must not be larger than " + Twine(maxMemorySize) +
+            " bytes");
     if (memoryPtr > config->maxMemory)
       error("maximum memory too small, " + Twine(memoryPtr) + " bytes needed");
     out.memorySec->maxMemoryPages = config->maxMemory / WasmPageSize;
@@ -307,9 +509,20 @@ void Writer::layoutMemory() {
   }
 }
 
+static bool isDebugSection(const OutputSection *sec) {
+  return sec->type == WASM_SEC_CUSTOM &&
+         (sec->name == "name" || StringRef(sec->name).startswith(".debug_"));
+}
+
 void Writer::addSection(OutputSection *sec) {
   if (!sec->isNeeded())
     return;
+  if (!config->separateDebugFile.empty() && isDebugSection(sec)) {
+    log("addSection: " + toString(*sec) + " (debug file)");
+    sec->sectionIndex = debugSections.size();
+    debugSections.push_back(sec);
+    return;
+  }
   log("addSection: " + toString(*sec));
   sec->sectionIndex = outputSections.size();
   outputSections.push_back(sec);
@@ -358,6 +571,9 @@ void Writer::addSections() {
   addSection(out.nameSec);
   addSection(out.producersSec);
   addSection(out.targetFeaturesSec);
+  addSection(out.externalDebugInfoSec);
+  addSection(out.compilationHintsSec);
+  addSection(out.buildIdSec);
 }
 
 void Writer::finalizeSections() {
@@ -366,6 +582,20 @@ void Writer::finalizeSections() {
     s->finalizeContents();
     fileSize += s->getSize();
   }
+
+  if (config->printStats) {
+    for (OutputSection *s : outputSections)
+      stats.outputSections.push_back({toString(*s), s->getSize()});
+    stats.outputSize = fileSize;
+  }
+
+  // The debug file is a module of its own with only custom sections in it.
+  debugFileSize = header.size();
+  for (OutputSection *s : debugSections) {
+    s->setOffset(debugFileSize);
+    s->finalizeContents();
+    debugFileSize += s->getSize();
+  }
 }
 
 void Writer::populateTargetFeatures() {
@@ -385,10 +615,23 @@ void Writer::populateTargetFeatures() {
       return;
   }
 
-  // Find the sets of used, required, and disallowed features
-  for (ObjFile *file : symtab->objectFiles) {
-    StringRef fileName(file->getName());
-    for (auto &feature : file->getWasmObj()->getTargetFeatures()) {
+  // Find the sets of used, required, and disallowed features.  Each feature
+  // is attributed to the first file that has it, so a file whose features
+  // are the same as an earlier file's adds nothing to the sets.
+  ArrayRef<ObjFile *> files = symtab->objectFiles;
+  DenseMap<uint64_t, size_t> seen;
+  for (size_t i = 0; i < files.size(); ++i) {
+    tlsUsed |= fileSummaries[i].usesTLS;
+
+    ArrayRef<WasmFeatureEntry> features =
+        files[i]->getWasmObj()->getTargetFeatures();
+    auto p = seen.insert({fileSummaries[i].featuresHash, i});
+    const WasmObjectFile *first = files[p.first->second]->getWasmObj();
+    if (!p.second && equalFeatures(features, first->getTargetFeatures()))
+      continue;
+
+    StringRef fileName(files[i]->getName());
+    for (const WasmFeatureEntry &feature : features) {
       switch (feature.Prefix) {
       case WASM_FEATURE_PREFIX_USED:
         used.insert({feature.Name, fileName});
@@ -405,15 +648,6 @@ void Writer::populateTargetFeatures() {
               std::to_string(feature.Prefix));
       }
     }
-
-    // Find TLS data segments
-    auto isTLS = [](InputSegment *segment) {
-      StringRef name = segment->getName();
-      return segment->live &&
-             (name.startswith(".tdata") || name.startswith(".tbss"));
-    };
-    tlsUsed = tlsUsed ||
-              std::any_of(file->segments.begin(), file->segments.end(), isTLS);
   }
 
   if (inferFeatures)
@@ -455,45 +689,66 @@ void Writer::populateTargetFeatures() {
     }
   }
 
-  // Validate the required and disallowed constraints for each file
-  for (ObjFile *file : symtab->objectFiles) {
-    StringRef fileName(file->getName());
+  // Validate the required and disallowed constraints for each file.  The
+  // files are checked in parallel, and the errors reported in file order.
+  std::vector<std::vector<std::string>> errors(files.size());
+  parallelForEachN(0, files.size(), [&](size_t i) {
+    StringRef fileName(files[i]->getName());
     SmallSet<std::string, 8> objectFeatures;
-    for (auto &feature : file->getWasmObj()->getTargetFeatures()) {
+    for (auto &feature : files[i]->getWasmObj()->getTargetFeatures()) {
       if (feature.Prefix == WASM_FEATURE_PREFIX_DISALLOWED)
         continue;
       objectFeatures.insert(feature.Name);
-      if (disallowed.count(feature.Name))
-        error(Twine("Target feature '") + feature.Name + "' used in " +
-              fileName + " is disallowed by " + disallowed[feature.Name] +
-              ". Use --no-check-features to suppress.");
+      auto it = disallowed.find(feature.Name);
+      if (it != disallowed.end())
+        errors[i].push_back((Twine("Target feature '") + feature.Name +
+                             "' used in " + fileName + " is disallowed by " +
+                             it->second +
+                             ". Use --no-check-features to suppress.")
+                                .str());
     }
-    for (auto &feature : required.keys()) {
-      if (!objectFeatures.count(feature))
-        error(Twine("Missing target feature '") + feature + "' in " + fileName +
-              ", required by " + required[feature] +
-              ". Use --no-check-features to suppress.");
+    for (auto &entry : required) {
+      if (!objectFeatures.count(entry.getKey()))
+        errors[i].push_back((Twine("Missing target feature '") +
+                             entry.getKey() + "' in " + fileName +
+                             ", required by " + entry.getValue() +
+                             ". Use --no-check-features to suppress.")
+                                .str());
     }
-  }
+  });
+
+  for (const std::vector<std::string> &msgs : errors)
+    for (const std::string &msg : msgs)
+      error(msg);
+}
+
+static bool shouldImport(const Symbol *sym) {
+  if (!sym->isUndefined())
+    return false;
+  if (sym->isWeak() && !config->relocatable)
+    return false;
+  if (!sym->isLive())
+    return false;
+  if (!sym->isUsedInRegularObj)
+    return false;
+  // We don't generate imports for data symbols. They however can be imported
+  // as GOT entries.
+  return !isa<DataSymbol>(sym);
 }
 
 void Writer::calculateImports() {
-  for (Symbol *sym : symtab->getSymbols()) {
-    if (!sym->isUndefined())
+  // There can be millions of symbols, of which few are imported. Test them
+  // in parallel, and add the imports in symbol table order.
+  ArrayRef<Symbol *> syms = symtab->getSymbols();
+  std::vector<uint8_t> isImport(syms.size());
+  parallelForEachN(0, syms.size(),
+                   [&](size_t i) { isImport[i] = shouldImport(syms[i]); });
+
+  for (size_t i = 0, e = syms.size(); i != e; ++i) {
+    if (!isImport[i])
       continue;
-    if (sym->isWeak() && !config->relocatable)
-      continue;
-    if (!sym->isLive())
-      continue;
-    if (!sym->isUsedInRegularObj)
-      continue;
-    // We don't generate imports for data symbols. They however can be imported
-    // as GOT entries.
-    if (isa<DataSymbol>(sym))
-      continue;
-
-    LLVM_DEBUG(dbgs() << "import: " << sym->getName() << "\n");
-    out.importSec->addImport(sym);
+    LLVM_DEBUG(dbgs() << "import: " << syms[i]->getName() << "\n");
+    out.importSec->addImport(syms[i]);
   }
 }
 
@@ -512,11 +767,18 @@ void Writer::calculateExports() {
   unsigned globalIndex =
       out.importSec->getNumImportedGlobals() + out.globalSec->numGlobals();
 
-  for (Symbol *sym : symtab->getSymbols()) {
-    if (!sym->isExported())
-      continue;
-    if (!sym->isLive())
+  // As with imports, find the exported symbols in parallel and then create
+  // the exports in symbol table order, which numbers the data globals.
+  ArrayRef<Symbol *> syms = symtab->getSymbols();
+  std::vector<uint8_t> isExport(syms.size());
+  parallelForEachN(0, syms.size(), [&](size_t i) {
+    isExport[i] = syms[i]->isExported() && syms[i]->isLive();
+  });
+
+  for (size_t i = 0, e = syms.size(); i != e; ++i) {
+    if (!isExport[i])
       continue;
+    Symbol *sym = syms[i];
 
     StringRef name = sym->getName();
     WasmExport export_;
@@ -543,6 +805,9 @@ void Writer::calculateExports() {
     LLVM_DEBUG(dbgs() << "Export: " << name << "\n");
     out.exportSec->exports.push_back(export_);
   }
+
+  if (config->splitModule)
+    addSplitExports();
 }
 
 void Writer::populateSymtab() {
@@ -561,6 +826,18 @@ void Writer::populateSymtab() {
   }
 }
 
+namespace {
+// Maps the entries of one object file's type section to output type indices.
+struct FileTypes {
+  ArrayRef<WasmSignature> types;
+  // For each local type, the first local type with the same signature.
+  std::vector<uint32_t> canonical;
+  // The output type index of each canonical local type, or UINT32_MAX if it
+  // hasn't been registered yet.
+  std::vector<uint32_t> outputIndex;
+};
+} // namespace
+
 void Writer::calculateTypes() {
   // The output type section is the union of the following sets:
   // 1. Any signature used in the TYPE relocation
@@ -568,26 +845,57 @@ void Writer::calculateTypes() {
   // 3. The signatures of all defined functions
   // 4. The signatures of all imported events
   // 5. The signatures of all defined events
+  //
+  // Signatures are vectors and relatively expensive to hash, and almost all
+  // of the ones registered here are entries in some object file's type
+  // section.  So deduplicate each file's types on its own first, in
+  // parallel, and then hash each distinct entry into the output type
+  // section only once.  Types are still registered in the same order.
+  ArrayRef<ObjFile *> files = symtab->objectFiles;
+  std::vector<FileTypes> fileTypes(files.size());
+  DenseMap<const InputFile *, FileTypes *> fileTypesMap;
+  for (size_t i = 0; i < files.size(); ++i)
+    fileTypesMap[files[i]] = &fileTypes[i];
+
+  parallelForEachN(0, files.size(), [&](size_t i) {
+    FileTypes &ft = fileTypes[i];
+    ft.types = files[i]->getWasmObj()->types();
+    ft.canonical.resize(ft.types.size());
+    ft.outputIndex.assign(ft.types.size(), UINT32_MAX);
+    DenseMap<WasmSignature, uint32_t> seen;
+    for (uint32_t j = 0; j < ft.types.size(); ++j)
+      ft.canonical[j] = seen.insert({ft.types[j], j}).first->second;
+  });
 
-  for (ObjFile *file : symtab->objectFiles) {
+  auto registerType = [&](const InputFile *file, const WasmSignature &sig) {
+    FileTypes *ft = file ? fileTypesMap.lookup(file) : nullptr;
+    if (!ft || &sig < ft->types.begin() || &sig >= ft->types.end())
+      return out.typeSec->registerType(sig);
+    uint32_t &index = ft->outputIndex[ft->canonical[&sig - ft->types.begin()]];
+    if (index == UINT32_MAX)
+      index = out.typeSec->registerType(sig);
+    return index;
+  };
+
+  for (ObjFile *file : files) {
     ArrayRef<WasmSignature> types = file->getWasmObj()->types();
     for (uint32_t i = 0; i < types.size(); i++)
       if (file->typeIsUsed[i])
-        file->typeMap[i] = out.typeSec->registerType(types[i]);
+        file->typeMap[i] = registerType(file, types[i]);
   }
 
   for (const Symbol *sym : out.importSec->importedSymbols) {
     if (auto *f = dyn_cast<FunctionSymbol>(sym))
-      out.typeSec->registerType(*f->signature);
+      registerType(sym->getFile(), *f->signature);
     else if (auto *e = dyn_cast<EventSymbol>(sym))
-      out.typeSec->registerType(*e->signature);
+      registerType(sym->getFile(), *e->signature);
   }
 
   for (const InputFunction *f : out.functionSec->inputFunctions)
-    out.typeSec->registerType(f->signature);
+    registerType(f->file, f->signature);
 
   for (const InputEvent *e : out.eventSec->inputEvents)
-    out.typeSec->registerType(e->signature);
+    registerType(e->file, e->signature);
 }
 
 static void scanRelocations() {
@@ -602,6 +910,53 @@ static void scanRelocations() {
   }
 }
 
+// Builds a function order from --symbol-ordering-file or
+// --call-graph-ordering-file.  Functions with a lower priority come first;
+// functions that are not mentioned have priority zero and are not reordered.
+static DenseMap<const InputFunction *, int> buildFunctionOrder() {
+  if (!config->callGraphProfile.empty())
+    return computeCallGraphProfileOrder();
+
+  DenseMap<const InputFunction *, int> functionOrder;
+  if (config->symbolOrderingFile.empty())
+    return functionOrder;
+
+  // Build a map from symbols to their priorities. Symbols that didn't
+  // appear in the symbol ordering file have the lowest priority 0.
+  // All explicitly mentioned symbols have negative (higher) priorities.
+  DenseMap<StringRef, int> symbolOrder;
+  int priority = -config->symbolOrderingFile.size();
+  for (StringRef s : config->symbolOrderingFile)
+    symbolOrder.insert({s, priority++});
+
+  DenseSet<StringRef> found;
+  for (ObjFile *file : symtab->objectFiles) {
+    for (Symbol *sym : file->getSymbols()) {
+      auto it = symbolOrder.find(sym->getName());
+      if (it == symbolOrder.end())
+        continue;
+      found.insert(it->first);
+
+      auto *f = dyn_cast<DefinedFunction>(sym);
+      if (!f || !f->function || f->getFile() != file) {
+        if (config->warnSymbolOrdering && !sym->isDefined())
+          warn(toString(file) + ": unable to order undefined symbol: " +
+               sym->getName());
+        continue;
+      }
+
+      int &p = functionOrder[f->function];
+      p = std::min(p, it->second);
+    }
+  }
+
+  if (config->warnSymbolOrdering)
+    for (StringRef s : config->symbolOrderingFile)
+      if (!found.count(s))
+        warn("symbol ordering file: no such symbol: " + s);
+  return functionOrder;
+}
+
 void Writer::assignIndexes() {
   // Seal the import section, since other index spaces such as function and
   // global are effected by the number of imports.
@@ -610,12 +965,29 @@ void Writer::assignIndexes() {
   for (InputFunction *func : symtab->syntheticFunctions)
     out.functionSec->addFunction(func);
 
+  // Functions are emitted into the CODE section in index order, so this is
+  // where any requested function ordering is applied.
+  std::vector<InputFunction *> functions;
   for (ObjFile *file : symtab->objectFiles) {
     LLVM_DEBUG(dbgs() << "Functions: " << file->getName() << "\n");
-    for (InputFunction *func : file->functions)
-      out.functionSec->addFunction(func);
+    functions.insert(functions.end(), file->functions.begin(),
+                     file->functions.end());
   }
 
+  DenseMap<const InputFunction *, int> order = buildFunctionOrder();
+  if (!order.empty())
+    llvm::stable_sort(functions, [&](InputFunction *a, InputFunction *b) {
+      // Ordered functions come first, in order of priority.
+      int pa = order.lookup(a);
+      int pb = order.lookup(b);
+      if (pa == 0 || pb == 0)
+        return pa != 0 && pb == 0;
+      return pa < pb;
+    });
+
+  for (InputFunction *func : functions)
+    out.functionSec->addFunction(func);
+
   for (InputGlobal *global : symtab->syntheticGlobals)
     out.globalSec->addGlobal(global);
 
@@ -658,6 +1030,13 @@ static StringRef getOutputDataSegmentName(StringRef name) {
 }
 
 void Writer::createOutputSegments() {
+  // Mergeable string segments are not added to their output segments
+  // directly.  Instead, each output segment gets one synthetic segment that
+  // holds the deduplicated strings of all of them.
+  bool mergeStrings = config->mergeDataSegments && !config->relocatable;
+  std::vector<InputSegment *> stringSegments;
+  MapVector<OutputSegment *, MergedStringSegment *> mergedSegments;
+
   for (ObjFile *file : symtab->objectFiles) {
     for (InputSegment *segment : file->segments) {
       if (!segment->live)
@@ -670,19 +1049,45 @@ void Writer::createOutputSegments() {
         if (config->sharedMemory || name == ".tdata")
           s->initFlags = WASM_SEGMENT_IS_PASSIVE;
         // Exported memories are guaranteed to be zero-initialized, so no need
-        // to emit data segments for bss sections.
-        // TODO: consider initializing bss sections with memory.fill
-        // instructions when memory is imported and bulk-memory is available.
-        if (!config->importMemory && !config->relocatable &&
-            name.startswith(".bss"))
+        // to emit data segments for bss sections.  Imported memories can
+        // instead be zeroed with memory.fill in __wasm_init_memory, which
+        // only exists when bulk memory is available.
+        if (!config->relocatable && name.startswith(".bss") &&
+            (!config->importMemory || WasmSym::initMemory))
           s->isBss = true;
         segments.push_back(s);
       }
+      if (mergeStrings && segment->isMergeableString()) {
+        MergedStringSegment *&merged = mergedSegments[s];
+        if (!merged)
+          merged = make<MergedStringSegment>(name);
+        merged->addSegment(segment);
+        stringSegments.push_back(segment);
+        continue;
+      }
       s->addInputSegment(segment);
       LLVM_DEBUG(dbgs() << "added data: " << name << ": " << s->size << "\n");
     }
   }
 
+  parallelForEach(stringSegments,
+                  [](InputSegment *segment) { segment->splitIntoPieces(); });
+
+  for (auto &it : mergedSegments) {
+    OutputSegment *s = it.first;
+    MergedStringSegment *merged = it.second;
+    merged->finalizeContents();
+    s->addInputSegment(merged);
+    for (InputSegment *segment : merged->getSegments())
+      segment->outputSeg = s;
+    LLVM_DEBUG(dbgs() << "added merged strings: " << s->name << ": "
+                      << s->size << "\n");
+  }
+
+  if (config->packDataSegments)
+    for (OutputSegment *s : segments)
+      s->sortInputSegmentsByAlignment();
+
   // Sort segments by type, placing .bss last
   std::stable_sort(segments.begin(), segments.end(),
                    [](const OutputSegment *a, const OutputSegment *b) {
@@ -697,6 +1102,20 @@ void Writer::createOutputSegments() {
                      return order(a->name) < order(b->name);
                    });
 
+  // Move the runtime relocations that only need a base address added into
+  // a table at the end of each segment.
+  if (config->isPic && config->relrPackDynRelocs) {
+    for (OutputSegment *s : segments) {
+      if (s->isBss)
+        continue;
+      auto *table = make<RelocTableSegment>(s);
+      if (table->empty())
+        continue;
+      s->addInputSegment(table);
+      s->relocTable = table;
+    }
+  }
+
   for (size_t i = 0; i < segments.size(); ++i)
     segments[i]->index = i;
 }
@@ -786,7 +1205,23 @@ void Writer::createInitMemoryFunction() {
       writeU8(os, WASM_OPCODE_ELSE, "ELSE");
 
       // Did increment 0, so conditionally initialize passive data segments
+      // and zero any bss segments in imported memory
       for (const OutputSegment *s : segments) {
+        if (s->isBss) {
+          if (!config->importMemory)
+            continue;
+          // destination address
+          writeI32Const(os, s->startVA, "destination address");
+          // fill value
+          writeI32Const(os, 0, "fill value");
+          // memory region size
+          writeI32Const(os, s->size, "memory region size");
+          // memory.fill instruction
+          writeU8(os, WASM_OPCODE_MISC_PREFIX, "bulk-memory prefix");
+          writeUleb128(os, memoryFillOpcode, "memory.fill");
+          writeU8(os, 0, "memory index immediate");
+          continue;
+        }
         if (s->initFlags & WASM_SEGMENT_IS_PASSIVE && s->name != ".tdata") {
           // destination address
           writeI32Const(os, s->startVA, "destination address");
@@ -821,7 +1256,8 @@ void Writer::createInitMemoryFunction() {
 
       // Unconditionally drop passive data segments
       for (const OutputSegment *s : segments) {
-        if (s->initFlags & WASM_SEGMENT_IS_PASSIVE && s->name != ".tdata") {
+        if (s->initFlags & WASM_SEGMENT_IS_PASSIVE && s->name != ".tdata" &&
+            !s->isBss) {
           // data.drop instruction
           writeU8(os, WASM_OPCODE_MISC_PREFIX, "bulk-memory prefix");
           writeUleb128(os, WASM_OPCODE_DATA_DROP, "data.drop");
@@ -845,10 +1281,24 @@ void Writer::createApplyRelocationsFunction() {
   std::string bodyContent;
   {
     raw_string_ostream os(bodyContent);
-    writeUleb128(os, 0, "num locals");
-    for (const OutputSegment *seg : segments)
+    bool hasRelocTable = llvm::any_of(
+        segments, [](const OutputSegment *seg) { return seg->relocTable; });
+    if (hasRelocTable) {
+      // The relocation table loops need four i32 locals.
+      writeUleb128(os, 1, "num local decls");
+      writeUleb128(os, 4, "local count");
+      writeU8(os, WASM_TYPE_I32, "local type");
+    } else {
+      writeUleb128(os, 0, "num locals");
+    }
+    // The relocations in the data segments may read the internal GOT.
+    out.globalSec->generateRelocationCode(os);
+    for (const OutputSegment *seg : segments) {
       for (const InputSegment *inSeg : seg->inputSegments)
         inSeg->generateRelocationCode(os);
+      if (seg->relocTable)
+        seg->relocTable->generateRelocationCode(os, 0);
+    }
     writeU8(os, WASM_OPCODE_END, "END");
   }
 
@@ -973,6 +1423,9 @@ void Writer::createSyntheticSections() {
   out.nameSec = make<NameSection>();
   out.producersSec = make<ProducersSection>();
   out.targetFeaturesSec = make<TargetFeaturesSection>();
+  out.externalDebugInfoSec = make<ExternalDebugInfoSection>();
+  out.compilationHintsSec = make<CompilationHintsSection>();
+  out.buildIdSec = make<BuildIdSection>();
 }
 
 void Writer::run() {
@@ -988,9 +1441,18 @@ void Writer::run() {
   }
 
   log("-- createOutputSegments");
-  createOutputSegments();
+  {
+    ScopedTimer t(createOutputSegmentsTimer);
+    createOutputSegments();
+  }
   log("-- createSyntheticSections");
   createSyntheticSections();
+  if (config->splitModule) {
+    log("-- splitFunctions");
+    splitFunctions();
+  }
+  log("-- summarizeObjectFiles");
+  summarizeObjectFiles();
   log("-- populateProducers");
   populateProducers();
   log("-- populateTargetFeatures");
@@ -998,7 +1460,10 @@ void Writer::run() {
   log("-- calculateImports");
   calculateImports();
   log("-- layoutMemory");
-  layoutMemory();
+  {
+    ScopedTimer t(layoutMemoryTimer);
+    layoutMemory();
+  }
 
   if (!config->relocatable) {
     // Create linker synthesized __start_SECNAME/__stop_SECNAME symbols
@@ -1008,9 +1473,15 @@ void Writer::run() {
   }
 
   log("-- scanRelocations");
-  scanRelocations();
+  {
+    ScopedTimer t(scanRelocationsTimer);
+    scanRelocations();
+  }
   log("-- assignIndexes");
-  assignIndexes();
+  {
+    ScopedTimer t(assignIndexesTimer);
+    assignIndexes();
+  }
   log("-- calculateInitFunctions");
   calculateInitFunctions();
 
@@ -1031,6 +1502,8 @@ void Writer::run() {
 
   log("-- calculateTypes");
   calculateTypes();
+  if (config->splitModule)
+    createSplitStubs();
   log("-- calculateExports");
   calculateExports();
   log("-- calculateCustomSections");
@@ -1052,9 +1525,40 @@ void Writer::run() {
       file->dumpInfo();
   }
 
+  // Most relocations of code sections are function and global indices, so
+  // they are looked up in tables from now on.
+  parallelForEach(symtab->objectFiles,
+                  [](ObjFile *file) { file->computeRelocIndices(); });
+
   createHeader();
   log("-- finalizeSections");
-  finalizeSections();
+  {
+    ScopedTimer t(finalizeSectionsTimer);
+    finalizeSections();
+  }
+
+  log("-- writeMapFile");
+  writeMapFile(outputSections);
+
+  if (!config->separateDebugFile.empty()) {
+    log("-- writeDebugFile");
+    writeDebugFile();
+    if (errorCount())
+      return;
+  }
+
+  if (config->splitModule) {
+    log("-- writeSplitModule");
+    writeSplitModule();
+    if (errorCount())
+      return;
+  }
+
+  if (!config->mmapOutputFile) {
+    log("-- streamSections");
+    streamSections();
+    return;
+  }
 
   log("-- openFile");
   openFile();
@@ -1064,18 +1568,53 @@ void Writer::run() {
   writeHeader();
 
   log("-- writeSections");
-  writeSections();
+  {
+    ScopedTimer t(writeSectionsTimer);
+    writeSections();
+  }
+
+  log("-- writeBuildId");
+  writeBuildId();
   if (errorCount())
     return;
 
-  if (Error e = buffer->commit())
-    fatal("failed to write the output file: " + toString(std::move(e)));
+  // If the time is reported, commit right away so that it is measured.
+  ScopedTimer t(diskCommitTimer);
+  bool sync = config->showTiming || !config->timeJsonFile.empty();
+  commitOutput(std::move(buffer), "failed to write the output file: ", sync);
 }
 
+namespace {
+// A FileOutputBuffer that writes to the caller's buffer given to the
+// in-memory variant of link, so that the output never touches the disk.
+class MemoryOutputBuffer : public FileOutputBuffer {
+public:
+  MemoryOutputBuffer(StringRef path, std::vector<uint8_t> &out, size_t size)
+      : FileOutputBuffer(path), out(out) {
+    out.assign(size, 0);
+  }
+
+  uint8_t *getBufferStart() const override { return out.data(); }
+  uint8_t *getBufferEnd() const override { return out.data() + out.size(); }
+  size_t getBufferSize() const override { return out.size(); }
+  Error commit() override { return Error::success(); }
+  void discard() override { out.clear(); }
+
+private:
+  std::vector<uint8_t> &out;
+};
+} // namespace
+
 // Open a result file.
 void Writer::openFile() {
   log("writing: " + config->outputFile);
 
+  if (config->outputBuffer) {
+    buffer = std::make_unique<MemoryOutputBuffer>(
+        config->outputFile, *config->outputBuffer, fileSize);
+    return;
+  }
+
   Expected<std::unique_ptr<FileOutputBuffer>> bufferOrErr =
       FileOutputBuffer::create(config->outputFile, fileSize,
                                FileOutputBuffer::F_executable);
@@ -1087,6 +1626,74 @@ void Writer::openFile() {
     buffer = std::move(*bufferOrErr);
 }
 
+// Write the sections collected in debugSections to --separate-debug-file.
+// This is done even if there are no debug sections so that debuggers
+// following the external_debug_info section always find a valid module.
+void Writer::writeDebugFile() {
+  log("writing: " + config->separateDebugFile);
+
+  Expected<std::unique_ptr<FileOutputBuffer>> bufferOrErr =
+      FileOutputBuffer::create(config->separateDebugFile, debugFileSize);
+  if (!bufferOrErr) {
+    error("failed to open " + config->separateDebugFile + ": " +
+          toString(bufferOrErr.takeError()));
+    return;
+  }
+
+  uint8_t *buf = (*bufferOrErr)->getBufferStart();
+  memcpy(buf, header.data(), header.size());
+  parallelForEach(debugSections, [buf](OutputSection *s) {
+    s->writeTo(buf + s->getOffset());
+  });
+
+  if (Error e = (*bufferOrErr)->commit())
+    error("failed to write " + config->separateDebugFile + ": " +
+          toString(std::move(e)));
+}
+
+// Write the output one section at a time through a temporary file, so that
+// only the largest section, not the whole file, needs to be held in memory.
+// finalizeSections has already fixed the size of every section, and writeTo
+// only writes the section it is called on.
+void Writer::streamSections() {
+  log("writing: " + config->outputFile);
+
+  using namespace sys::fs;
+  Expected<TempFile> tempOrErr = TempFile::create(
+      config->outputFile + ".tmp%%%%%%%", all_read | all_write | all_exe);
+  if (!tempOrErr) {
+    error("failed to open " + config->outputFile + ": " +
+          toString(tempOrErr.takeError()));
+    return;
+  }
+  TempFile &temp = *tempOrErr;
+
+  {
+    ScopedTimer t(writeSectionsTimer);
+    raw_fd_ostream os(temp.FD, /*shouldClose=*/false);
+    os << header;
+    std::vector<uint8_t> buf;
+    for (OutputSection *s : outputSections) {
+      buf.assign(s->getSize(), 0);
+      s->writeTo(buf.data());
+      os.write(reinterpret_cast<const char *>(buf.data()), buf.size());
+    }
+    os.flush();
+    if (std::error_code ec = os.error()) {
+      os.clear_error();
+      error("failed to write the output file: " + ec.message());
+    }
+  }
+  if (errorCount()) {
+    consumeError(temp.discard());
+    return;
+  }
+
+  ScopedTimer t(diskCommitTimer);
+  if (Error e = temp.keep(config->outputFile))
+    fatal("failed to write the output file: " + toString(std::move(e)));
+}
+
 void Writer::createHeader() {
   raw_string_ostream os(header);
   writeBytes(os, WasmMagic, sizeof(WasmMagic), "wasm magic");
@@ -228,5 +228,100 @@ void writeExport(raw_ostream &os, const WasmExport &export_) {
   }
 }
 
+size_t getStrSize(StringRef string) {
+  return getULEB128Size(string.size()) + string.size();
+}
+
+static size_t getLimitsSize(const WasmLimits &limits) {
+  size_t size = 1 + getULEB128Size(limits.Initial);
+  if (limits.Flags & WASM_LIMITS_FLAG_HAS_MAX)
+    size += getULEB128Size(limits.Maximum);
+  return size;
+}
+
+size_t getImportSize(const WasmImport &import) {
+  size_t size = getStrSize(import.Module) + getStrSize(import.Field) + 1;
+  switch (import.Kind) {
+  case WASM_EXTERNAL_FUNCTION:
+    return size + getULEB128Size(import.SigIndex);
+  case WASM_EXTERNAL_GLOBAL:
+    return size + 2;
+  case WASM_EXTERNAL_EVENT:
+    return size + getULEB128Size(import.Event.Attribute) +
+           getULEB128Size(import.Event.SigIndex);
+  case WASM_EXTERNAL_MEMORY:
+    return size + getLimitsSize(import.Memory);
+  case WASM_EXTERNAL_TABLE:
+    return size + 1 + getLimitsSize(import.Table.Limits);
+  default:
+    fatal("unsupported import type: " + Twine(import.Kind));
+  }
+}
+
+size_t getExportSize(const WasmExport &export_) {
+  switch (export_.Kind) {
+  case WASM_EXTERNAL_FUNCTION:
+  case WASM_EXTERNAL_GLOBAL:
+  case WASM_EXTERNAL_MEMORY:
+  case WASM_EXTERNAL_TABLE:
+    return getStrSize(export_.Name) + 1 + getULEB128Size(export_.Index);
+  default:
+    fatal("unsupported export type: " + Twine(export_.Kind));
+  }
+}
+
+void writeUleb128(uint8_t *&buf, uint32_t number) {
+  buf += encodeULEB128(number, buf);
+}
+
+void writeU8(uint8_t *&buf, uint8_t byte) { *buf++ = byte; }
+
+void writeStr(uint8_t *&buf, StringRef string) {
+  writeUleb128(buf, string.size());
+  memcpy(buf, string.data(), string.size());
+  buf += string.size();
+}
+
+static void writeLimits(uint8_t *&buf, const WasmLimits &limits) {
+  writeU8(buf, limits.Flags);
+  writeUleb128(buf, limits.Initial);
+  if (limits.Flags & WASM_LIMITS_FLAG_HAS_MAX)
+    writeUleb128(buf, limits.Maximum);
+}
+
+void writeImport(uint8_t *&buf, const WasmImport &import) {
+  writeStr(buf, import.Module);
+  writeStr(buf, import.Field);
+  writeU8(buf, import.Kind);
+  switch (import.Kind) {
+  case WASM_EXTERNAL_FUNCTION:
+    writeUleb128(buf, import.SigIndex);
+    break;
+  case WASM_EXTERNAL_GLOBAL:
+    writeU8(buf, import.Global.Type);
+    writeU8(buf, import.Global.Mutable);
+    break;
+  case WASM_EXTERNAL_EVENT:
+    writeUleb128(buf, import.Event.Attribute);
+    writeUleb128(buf, import.Event.SigIndex);
+    break;
+  case WASM_EXTERNAL_MEMORY:
+    writeLimits(buf, import.Memory);
+    break;
+  case WASM_EXTERNAL_TABLE:
+    writeU8(buf, WASM_TYPE_FUNCREF);
+    writeLimits(buf, import.Table.Limits);
+    break;
+  default:
+    fatal("unsupported import type: " + Twine(import.Kind));
+  }
+}
+
+void writeExport(uint8_t *&buf, const WasmExport &export_) {
+  writeStr(buf, export_.Name);
+  writeU8(buf, export_.Kind);
+  writeUleb128(buf, export_.Index);
+}
+
 } // namespace wasm
 } // namespace lld
@@ -60,6 +60,27 @@ void writeImport(raw_ostream &os, const llvm::wasm::WasmImport &import);
 
 void writeExport(raw_ostream &os, const llvm::wasm::WasmExport &export_);
 
+// The following functions encode into a buffer and advance buf past what
+// they wrote. They are used by sections that are sized before they are
+// written straight into the output. Each get*Size function returns the
+// number of bytes that the corresponding write function writes.
+
+size_t getStrSize(StringRef string);
+
+size_t getImportSize(const llvm::wasm::WasmImport &import);
+
+size_t getExportSize(const llvm::wasm::WasmExport &export_);
+
+void writeUleb128(uint8_t *&buf, uint32_t number);
+
+void writeU8(uint8_t *&buf, uint8_t byte);
+
+void writeStr(uint8_t *&buf, StringRef string);
+
+void writeImport(uint8_t *&buf, const llvm::wasm::WasmImport &import);
+
+void writeExport(uint8_t *&buf, const llvm::wasm::WasmExport &export_);
+
 } // namespace wasm
 
 std::string toString(llvm::wasm::ValType type);